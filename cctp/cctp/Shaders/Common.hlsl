@@ -1,6 +1,7 @@
 #ifndef COMMON
 #define COMMON
 #include "Octahedral.hlsl"
+#include "ShaderConstants.hlsl"
 
 #ifndef PI
 #define PI 3.14159274
@@ -12,32 +13,15 @@ struct RayPayload
     float HitDistance;
 };
 
-// The max number of probes in the probe field
-#define MAX_PROBE_COUNT 350
-// The number of rays traced from a probe. McGuire uses up to 256 rays
-#define PROBE_RAY_COUNT 32
-// The amount of texels in a square side to use to store a probes irradiance data in
-#define IRRADIANCE_PROBE_SIDE_LENGTH 8 
-// The amount of texels in a square side to use to store a probes visibility data in
-#define VISIBILITY_PROBE_SIDE_LENGTH 16 
-// Border size in pixels around each probe's data pack. Should be at least 1 to protect data from blurring with next probe
-#define PROBE_PADDING 1
-// The maximum distance a ray can travel
-#define MAX_DISTANCE 1.0
-
-// Irradiance texture dimension
-#define IRRADIANCE_TEXTURE_WIDTH 4300.0
-#define IRRADIANCE_TEXTURE_HEIGHT 16.0
-
-// Visibility texture dimension
-#define VISIBILITY_TEXTURE_WIDTH 7000.0
-#define VISIBILITY_TEXTURE_HEIGHT 32.0
-
-// The number of blur iterations to perform on each output texture
-#define IRRADIANCE_BLUR_ITERATIONS 2
-#define VISIBILITY_BLUR_ITERATIONS 0
-
-#define SHADOW_BIAS 0.04
+// Per instance data of rasterized meshes, matches Renderer::InstanceData
+struct InstanceData
+{
+    float4x4 WorldMatrix;
+    float4x4 NormalMatrix;
+    float4 Color;
+    uint Lit;
+    uint3 Padding;
+};
 
 float2 GetProbeTopLeftPosition(uint probeIndex, float singleProbeSideLength, uint padding)
 {
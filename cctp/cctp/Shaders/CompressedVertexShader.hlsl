@@ -0,0 +1,3 @@
+// Vertex shader variant for meshes using CompressedVertex1Pos1UV1Norm vertices
+#define COMPRESSED_VERTEX_INPUT
+#include "VertexShader.hlsl"
\ No newline at end of file
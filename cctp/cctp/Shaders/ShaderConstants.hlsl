@@ -0,0 +1,46 @@
+// Generated from Renderer/ShaderPermutations.h, edit the description there rather than this file
+#ifndef SHADER_CONSTANTS
+#define SHADER_CONSTANTS
+
+// The max number of probes in the probe field
+static const int MAX_PROBE_COUNT = 350;
+
+// The amount of texels in a square side to use to store a probes irradiance data in
+static const int IRRADIANCE_PROBE_SIDE_LENGTH = 8;
+
+// The amount of texels in a square side to use to store a probes visibility data in
+static const int VISIBILITY_PROBE_SIDE_LENGTH = 16;
+
+// Border size in pixels around each probe's data pack. Should be at least 1 to protect data from blurring with next probe
+static const int PROBE_PADDING = 1;
+
+// The maximum distance a ray can travel
+static const float MAX_DISTANCE = 1.0;
+
+// Irradiance texture dimension
+static const float IRRADIANCE_TEXTURE_WIDTH = 4300.0;
+static const float IRRADIANCE_TEXTURE_HEIGHT = 16.0;
+
+// Visibility texture dimension
+static const float VISIBILITY_TEXTURE_WIDTH = 7000.0;
+static const float VISIBILITY_TEXTURE_HEIGHT = 32.0;
+
+// Shadow map depth bias, scaled down on surfaces facing the light
+static const float SHADOW_BIAS = 0.04;
+
+// Options set by the compiler for each quality tier, defaulting to the Medium tier
+
+// The number of rays traced from a probe. McGuire uses up to 256 rays
+#ifndef PROBE_RAY_COUNT
+#define PROBE_RAY_COUNT 32
+#endif // PROBE_RAY_COUNT
+
+// The number of blur iterations to perform on each output texture
+#ifndef IRRADIANCE_BLUR_ITERATIONS
+#define IRRADIANCE_BLUR_ITERATIONS 2
+#endif // IRRADIANCE_BLUR_ITERATIONS
+#ifndef VISIBILITY_BLUR_ITERATIONS
+#define VISIBILITY_BLUR_ITERATIONS 0
+#endif // VISIBILITY_BLUR_ITERATIONS
+
+#endif // SHADER_CONSTANTS
@@ -7,13 +7,8 @@ struct VertexIn
     float3 VertexNormal : VERTEX_NORMAL;
 };
 
-cbuffer PerObjectConstants : register(b0)
-{
-    float4x4 WorldMatrix;
-    float4 Color;
-    float4x4 NormalMatrix;
-    uint Lit;
-}
+// Each draw binds the range holding its instances, so SV_InstanceID indexes from the draw's first instance
+StructuredBuffer<InstanceData> Instances : register(t0, space1);
 
 cbuffer PerFrameConstants : register(b1)
 {
@@ -23,8 +18,8 @@ cbuffer PerFrameConstants : register(b1)
     float4 packedData; // Stores probe count (x), probe spacing (y), light intensity (z)
 }
 
-float4 main(VertexIn input) : SV_POSITION
+float4 main(VertexIn input, uint instanceID : SV_InstanceID) : SV_POSITION
 {
-    float4 worldSpacePosition = mul(WorldMatrix, float4(input.LocalSpacePosition, 1.0f));
+    float4 worldSpacePosition = mul(Instances[instanceID].WorldMatrix, float4(input.LocalSpacePosition, 1.0f));
     return mul(LightMatrix, worldSpacePosition);
 }
\ No newline at end of file
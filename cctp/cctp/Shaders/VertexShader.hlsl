@@ -1,12 +1,7 @@
 #include "Common.hlsl"
 
-cbuffer PerObjectConstants : register(b0)
-{
-    float4x4 WorldMatrix;
-    float4 Color;
-    float4x4 NormalMatrix;
-    uint Lit;
-}
+// Each draw binds the range holding its instances, so SV_InstanceID indexes from the draw's first instance
+StructuredBuffer<InstanceData> Instances : register(t0, space1);
 
 cbuffer PerFrameConstants : register(b1)
 {
@@ -23,12 +18,22 @@ cbuffer PerPassConstants : register(b2)
     float4 CameraPositionWS;
 }
 
+#ifdef COMPRESSED_VERTEX_INPUT
+// CompressedVertex1Pos1UV1Norm, position is in [-1, 1] bounds space and dequantized by the world matrix
+struct VertexIn
+{
+    float4 LocalSpacePosition : LOCAL_SPACE_POSITION;
+    float2 OctahedralNormal : VERTEX_NORMAL;
+    float2 UV : UV;
+};
+#else
 struct VertexIn
 {
     float3 LocalSpacePosition : LOCAL_SPACE_POSITION;
     float2 UV : UV;
     float3 VertexNormal : VERTEX_NORMAL;
 };
+#endif
 
 struct VertexOut
 {
@@ -43,19 +48,29 @@ struct VertexOut
     float3 WorldPosition : POSITION_WS;
 };
 
-VertexOut main(VertexIn input)
+VertexOut main(VertexIn input, uint instanceID : SV_InstanceID)
 {
-    float4 worldSpacePosition = mul(WorldMatrix, float4(input.LocalSpacePosition, 1.0f));
+    InstanceData instance = Instances[instanceID];
+
+#ifdef COMPRESSED_VERTEX_INPUT
+    float3 localSpacePosition = input.LocalSpacePosition.xyz;
+    float3 vertexNormal = OctDecode(input.OctahedralNormal);
+#else
+    float3 localSpacePosition = input.LocalSpacePosition;
+    float3 vertexNormal = input.VertexNormal;
+#endif
+
+    float4 worldSpacePosition = mul(instance.WorldMatrix, float4(localSpacePosition, 1.0f));
     float4 viewSpacePosition = mul(ViewMatrix, worldSpacePosition);
 
     VertexOut output;
     output.ProjectionSpacePosition = mul(ProjectionMatrix, viewSpacePosition);
     output.TextureCoordinate = input.UV;
-    output.NormalWS = normalize(mul(NormalMatrix, float4(input.VertexNormal, 0.0f)).xyz);
+    output.NormalWS = normalize(mul(instance.NormalMatrix, float4(vertexNormal, 0.0f)).xyz);
     output.LightVectorWS = -normalize(LightDirectionWS.xyz);
     output.CameraVectorWS = normalize(CameraPositionWS.xyz - worldSpacePosition.xyz);
-    output.BaseColor = Color;
-    output.Lit = Lit;
+    output.BaseColor = instance.Color;
+    output.Lit = instance.Lit;
     output.LightSpacePosition = mul(LightMatrix, worldSpacePosition);
     output.WorldPosition = worldSpacePosition.xyz;
     return output;
@@ -0,0 +1,1671 @@
+#include "Pch.h"
+#include "Benchmarks.h"
+#include "Renderer/Geometry.h"
+#include "Renderer/MeshSimplifier.h"
+#include "Renderer/MeshImporter.h"
+#include "Renderer/MeshOptimizer.h"
+#include "Renderer/MeshCache.h"
+#include "Binary/Binary.h"
+#include "Math/Math.h"
+#include "Math/TransformStorage.h"
+#include "Math/TransformHierarchy.h"
+#include "Math/SpatialHashGrid.h"
+#include "Tasks/TaskSystem.h"
+#include "Renderer/FrustumCulling.h"
+#include "Renderer/OcclusionCulling.h"
+#include "Renderer/RenderGraph.h"
+#include "Renderer/CommandStream.h"
+#include "Renderer/NullCommandBackend.h"
+#include "Renderer/DescriptorAllocator.h"
+#include "Renderer/TlsfAllocator.h"
+#include "Renderer/ShaderCache.h"
+#include "Renderer/ShaderPermutations.h"
+#include <random>
+#include <map>
+
+namespace
+{
+	using BenchmarkClock = std::chrono::high_resolution_clock;
+
+	constexpr const char* IMPORT_BENCHMARK_MODELS_DIRECTORY = "Models";
+	constexpr uint32_t IMPORT_BENCHMARK_SPHERE_RESOLUTION = 512;
+	constexpr uint32_t CACHE_BENCHMARK_SPHERE_RESOLUTION = 256;
+	constexpr uint32_t TRANSFORM_BENCHMARK_COUNT = 100000;
+	// Fraction of transforms moved each frame in the partial update
+	constexpr uint32_t TRANSFORM_BENCHMARK_DYNAMIC_DIVISOR = 100;
+	constexpr uint32_t HIERARCHY_BENCHMARK_NODE_COUNT = 100000;
+	constexpr uint32_t HIERARCHY_BENCHMARK_FRAME_COUNT = 10;
+	constexpr uint32_t CULLING_BENCHMARK_BOX_COUNT = 1000000;
+	constexpr uint32_t OCCLUSION_BENCHMARK_BOX_COUNT = 10000;
+	constexpr uint32_t OCCLUSION_BENCHMARK_FRAME_COUNT = 100;
+	constexpr uint32_t OCCLUSION_BENCHMARK_WIDTH = 256;
+	constexpr uint32_t OCCLUSION_BENCHMARK_HEIGHT = 128;
+	constexpr uint32_t SPATIAL_BENCHMARK_OBJECT_COUNT = 1000000;
+	constexpr uint32_t SPATIAL_BENCHMARK_LARGE_OBJECT_COUNT = 100;
+	constexpr uint32_t SPATIAL_BENCHMARK_FRAME_COUNT = 10;
+	// Around five objects per occupied cell
+	constexpr float SPATIAL_BENCHMARK_CELL_SIZE = 8.0f;
+	constexpr uint32_t SPATIAL_BENCHMARK_QUERY_COUNT = 1000;
+	// Queries compared against a scan of every object, which is slow with a million objects
+	constexpr uint32_t SPATIAL_BENCHMARK_CHECKED_QUERY_COUNT = 10;
+	constexpr uint32_t RENDER_GRAPH_BENCHMARK_FRAME_COUNT = 1000;
+	constexpr uint32_t RENDER_GRAPH_BENCHMARK_BLOOM_LEVEL_COUNT = 5;
+	constexpr uint64_t RENDER_GRAPH_BENCHMARK_TEXTURE_ALIGNMENT = 64 * 1024;
+	constexpr uint32_t COMMAND_BENCHMARK_FRAME_COUNT = 200;
+	constexpr uint32_t COMMAND_BENCHMARK_DRAWS_PER_PASS = 500;
+	constexpr uint32_t COMMAND_BENCHMARK_MESH_COUNT = 32;
+	constexpr uint32_t DESCRIPTOR_BENCHMARK_PERSISTENT_COUNT = 65536;
+	constexpr uint32_t DESCRIPTOR_BENCHMARK_FRAME_COUNT = 1000;
+	constexpr uint32_t DESCRIPTOR_BENCHMARK_FRAMES_IN_FLIGHT = 3;
+	// Ranges allocated and freed each frame, from single descriptors up to small tables
+	constexpr uint32_t DESCRIPTOR_BENCHMARK_CHURN_PER_FRAME = 64;
+	constexpr uint32_t DESCRIPTOR_BENCHMARK_MAX_RANGE = 8;
+	constexpr uint32_t DESCRIPTOR_BENCHMARK_TRANSIENT_COUNT = 4096;
+	constexpr uint64_t GPU_MEMORY_BENCHMARK_CAPACITY = 256 * 1024 * 1024;
+	// Allocations live before churning starts, filling over half the capacity
+	constexpr uint32_t GPU_MEMORY_BENCHMARK_FILL_COUNT = 400;
+	constexpr uint32_t GPU_MEMORY_BENCHMARK_CHURN_COUNT = 100000;
+	// Sizes are spread evenly in powers of two between these, as mesh buffers and acceleration structures are
+	constexpr uint32_t GPU_MEMORY_BENCHMARK_MIN_SIZE_LOG2 = 8;
+	constexpr uint32_t GPU_MEMORY_BENCHMARK_MAX_SIZE_LOG2 = 22;
+	constexpr uint32_t SHADER_CACHE_BENCHMARK_ITERATION_COUNT = 1000;
+	// Around the size of the raytracing libraries compiled with debug information
+	constexpr size_t SHADER_CACHE_BENCHMARK_BYTECODE_SIZE = 64 * 1024;
+	// Each copy of the permutation set is keyed again, standing in for a project with more shaders
+	constexpr uint32_t SHADER_PERMUTATION_BENCHMARK_SET_COUNT = 64;
+
+	double ElapsedMilliseconds(const BenchmarkClock::time_point& start)
+	{
+		return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+	}
+
+	// Paths faster than the clock resolution measure zero, they are clamped to a tick rather than divided by
+	double SpeedupRatio(const double baselineMs, const double elapsedMs)
+	{
+		constexpr double clockTickMs = std::chrono::duration<double, std::milli>(BenchmarkClock::duration(1)).count();
+		return baselineMs / std::max(elapsedMs, clockTickMs);
+	}
+
+	struct GpuMemoryRequest
+	{
+		uint64_t Size = 0;
+		uint64_t Alignment = 0;
+		// Picks the allocation freed before this one is made, modulo the live count
+		uint32_t Victim = 0;
+	};
+
+	struct GpuMemoryLiveAllocation
+	{
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+		uint32_t Block = Renderer::TlsfAllocator::InvalidBlock;
+	};
+
+	// First fit over free ranges sorted by offset, the usual free list a sub-allocator replaces, to compare against
+	class FirstFitAllocator
+	{
+	public:
+		explicit FirstFitAllocator(const uint64_t capacity)
+		{
+			FreeRanges[0] = capacity;
+		}
+
+		bool Allocate(const uint64_t size, const uint64_t alignment, GpuMemoryLiveAllocation& outAllocation)
+		{
+			const uint64_t alignedSize = (size + Renderer::TlsfAllocator::DefaultGranularity - 1) & ~(Renderer::TlsfAllocator::DefaultGranularity - 1);
+			for (auto it = FreeRanges.begin(); it != FreeRanges.end(); ++it)
+			{
+				const uint64_t rangeOffset = it->first;
+				const uint64_t rangeEnd = it->first + it->second;
+				const uint64_t offset = (rangeOffset + alignment - 1) & ~(alignment - 1);
+				if (offset + alignedSize > rangeEnd)
+				{
+					continue;
+				}
+
+				FreeRanges.erase(it);
+				if (offset > rangeOffset)
+				{
+					FreeRanges[rangeOffset] = offset - rangeOffset;
+				}
+				if (offset + alignedSize < rangeEnd)
+				{
+					FreeRanges[offset + alignedSize] = rangeEnd - offset - alignedSize;
+				}
+				outAllocation.Offset = offset;
+				outAllocation.Size = alignedSize;
+				return true;
+			}
+			return false;
+		}
+
+		void Free(const GpuMemoryLiveAllocation& allocation)
+		{
+			uint64_t offset = allocation.Offset;
+			uint64_t size = allocation.Size;
+			auto next = FreeRanges.lower_bound(offset);
+			if (next != FreeRanges.end() && offset + size == next->first)
+			{
+				size += next->second;
+				next = FreeRanges.erase(next);
+			}
+			if (next != FreeRanges.begin() && std::prev(next)->first + std::prev(next)->second == offset)
+			{
+				std::prev(next)->second += size;
+				return;
+			}
+			FreeRanges[offset] = size;
+		}
+
+		// Share of free bytes outside the largest free range
+		float GetFragmentation() const
+		{
+			uint64_t freeBytes = 0;
+			uint64_t largest = 0;
+			for (const auto& [offset, size] : FreeRanges)
+			{
+				freeBytes += size;
+				largest = std::max(largest, size);
+			}
+			return freeBytes > 0 ? 1.0f - static_cast<float>(largest) / static_cast<float>(freeBytes) : 0.0f;
+		}
+
+	private:
+		std::map<uint64_t, uint64_t> FreeRanges;
+	};
+
+	// Makes the fill allocations, then frees one allocation and makes another for each churn request. Calls onChurnEnd before freeing
+	// the allocations left and returns the time taken until then
+	template<typename Allocate, typename Free, typename OnChurnEnd>
+	double RunGpuMemoryChurn(const std::vector<GpuMemoryRequest>& requests, Allocate allocate, Free release, OnChurnEnd onChurnEnd, uint32_t& outFailures)
+	{
+		std::vector<GpuMemoryLiveAllocation> live;
+		live.reserve(requests.size());
+		outFailures = 0;
+
+		const auto start = BenchmarkClock::now();
+		for (size_t i = 0; i < requests.size(); ++i)
+		{
+			const auto& request = requests[i];
+			if (i >= GPU_MEMORY_BENCHMARK_FILL_COUNT && !live.empty())
+			{
+				const size_t victim = request.Victim % live.size();
+				release(live[victim]);
+				live[victim] = live.back();
+				live.pop_back();
+			}
+
+			GpuMemoryLiveAllocation allocation;
+			if (allocate(request.Size, request.Alignment, allocation))
+			{
+				live.push_back(allocation);
+			}
+			else
+			{
+				++outFailures;
+			}
+		}
+		const double elapsedMs = ElapsedMilliseconds(start);
+
+		onChurnEnd();
+		for (const auto& allocation : live)
+		{
+			release(allocation);
+		}
+		return elapsedMs;
+	}
+
+	struct BenchmarkPassAccess
+	{
+		Renderer::RenderGraph::ResourceHandle Resource = Renderer::RenderGraph::InvalidHandle;
+		uint32_t Access = Renderer::RenderGraph::AccessNone;
+		bool Write = false;
+	};
+
+	// Deferred frame with a shadow map, gbuffer, ambient occlusion, lighting and a bloom chain tonemapped into an imported back buffer, then
+	// a user interface drawn over it. A debug view nothing reads is added to be culled. Texture formats are bytes per pixel.
+	// Returns the accesses each pass declared, onExecute is called with the index of each pass that runs
+	void BuildBenchmarkRenderGraph(Renderer::RenderGraph& graph, std::vector<std::vector<BenchmarkPassAccess>>& passAccesses,
+		const std::function<void(uint32_t)>& onExecute)
+	{
+		using Graph = Renderer::RenderGraph;
+
+		graph.Reset();
+		passAccesses.clear();
+
+		auto texture = [&graph](const char* name, const uint32_t width, const uint32_t height, const uint32_t bytesPerPixel)
+		{
+			Graph::TextureDesc desc;
+			desc.Width = width;
+			desc.Height = height;
+			desc.Format = bytesPerPixel;
+			return graph.CreateTexture(name, desc);
+		};
+		auto addPass = [&](const char* name)
+		{
+			const uint32_t index = graph.GetPassCount();
+			passAccesses.emplace_back();
+			return graph.AddPass(name, [&onExecute, index]() { onExecute(index); });
+		};
+		auto read = [&](const Graph::PassHandle pass, const Graph::ResourceHandle resource, const uint32_t access)
+		{
+			graph.Read(pass, resource, access);
+			passAccesses[pass].push_back({ resource, access, false });
+		};
+		auto write = [&](const Graph::PassHandle pass, const Graph::ResourceHandle resource, const uint32_t access)
+		{
+			graph.Write(pass, resource, access);
+			passAccesses[pass].push_back({ resource, access, true });
+		};
+
+		const auto backBuffer = graph.ImportTexture("Back buffer", nullptr, Graph::AccessRenderTarget, Graph::AccessRenderTarget);
+		const auto shadowMap = texture("Shadow map", 2048, 2048, 4);
+		const auto albedo = texture("Albedo", 1920, 1080, 4);
+		const auto normals = texture("Normals", 1920, 1080, 8);
+		const auto depth = texture("Depth", 1920, 1080, 4);
+		const auto ambientOcclusion = texture("Ambient occlusion", 1920, 1080, 1);
+		const auto lighting = texture("Lighting", 1920, 1080, 8);
+		const auto debugView = texture("Debug view", 1920, 1080, 4);
+
+		auto pass = addPass("Shadow map");
+		write(pass, shadowMap, Graph::AccessDepthWrite);
+
+		pass = addPass("GBuffer");
+		write(pass, albedo, Graph::AccessRenderTarget);
+		write(pass, normals, Graph::AccessRenderTarget);
+		write(pass, depth, Graph::AccessDepthWrite);
+
+		pass = addPass("Ambient occlusion");
+		read(pass, normals, Graph::AccessNonPixelShaderResource);
+		read(pass, depth, Graph::AccessNonPixelShaderResource);
+		write(pass, ambientOcclusion, Graph::AccessUnorderedAccess);
+
+		pass = addPass("Lighting");
+		read(pass, albedo, Graph::AccessPixelShaderResource);
+		read(pass, normals, Graph::AccessPixelShaderResource);
+		read(pass, depth, Graph::AccessPixelShaderResource);
+		read(pass, ambientOcclusion, Graph::AccessPixelShaderResource);
+		read(pass, shadowMap, Graph::AccessPixelShaderResource);
+		write(pass, lighting, Graph::AccessRenderTarget);
+
+		pass = addPass("Debug view");
+		read(pass, normals, Graph::AccessPixelShaderResource);
+		write(pass, debugView, Graph::AccessRenderTarget);
+
+		// Bloom downsamples the lighting level by level, then upsamples back adding each level to the one above
+		std::array<Graph::ResourceHandle, RENDER_GRAPH_BENCHMARK_BLOOM_LEVEL_COUNT> downLevels;
+		std::array<Graph::ResourceHandle, RENDER_GRAPH_BENCHMARK_BLOOM_LEVEL_COUNT> upLevels;
+		auto source = lighting;
+		for (uint32_t level = 0; level < RENDER_GRAPH_BENCHMARK_BLOOM_LEVEL_COUNT; ++level)
+		{
+			downLevels[level] = texture("Bloom down", 960 >> level, 540 >> level, 8);
+			pass = addPass("Bloom down");
+			read(pass, source, Graph::AccessNonPixelShaderResource);
+			write(pass, downLevels[level], Graph::AccessUnorderedAccess);
+			source = downLevels[level];
+		}
+		for (uint32_t level = RENDER_GRAPH_BENCHMARK_BLOOM_LEVEL_COUNT - 1; level-- > 0;)
+		{
+			upLevels[level] = texture("Bloom up", 960 >> level, 540 >> level, 8);
+			pass = addPass("Bloom up");
+			read(pass, source, Graph::AccessNonPixelShaderResource);
+			read(pass, downLevels[level], Graph::AccessNonPixelShaderResource);
+			write(pass, upLevels[level], Graph::AccessUnorderedAccess);
+			source = upLevels[level];
+		}
+
+		pass = addPass("Tonemap");
+		read(pass, lighting, Graph::AccessPixelShaderResource);
+		read(pass, source, Graph::AccessPixelShaderResource);
+		write(pass, backBuffer, Graph::AccessRenderTarget);
+
+		pass = addPass("User interface");
+		write(pass, backBuffer, Graph::AccessRenderTarget);
+	}
+
+	// Writers convert back to right handed coordinates with counter clockwise front faces so imported meshes match the originals
+
+	bool WriteOBJ(const std::string& filepath, const std::vector<Renderer::Vertex1Pos1UV1Norm>& vertices, const std::vector<uint32_t>& indices)
+	{
+		std::ofstream fs(filepath, std::ofstream::out | std::ofstream::binary);
+		if (!fs.good())
+		{
+			return false;
+		}
+
+		std::string text;
+		char line[128];
+		for (const auto& vertex : vertices)
+		{
+			snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", vertex.Position.x, vertex.Position.y, -vertex.Position.z);
+			text += line;
+		}
+		for (const auto& vertex : vertices)
+		{
+			snprintf(line, sizeof(line), "vt %.6f %.6f\n", vertex.UV.x, 1.0f - vertex.UV.y);
+			text += line;
+		}
+		for (const auto& vertex : vertices)
+		{
+			snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", vertex.Normal.x, vertex.Normal.y, -vertex.Normal.z);
+			text += line;
+		}
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n",
+				indices[i] + 1, indices[i] + 1, indices[i] + 1,
+				indices[i + 2] + 1, indices[i + 2] + 1, indices[i + 2] + 1,
+				indices[i + 1] + 1, indices[i + 1] + 1, indices[i + 1] + 1);
+			text += line;
+		}
+
+		fs.write(text.data(), text.size());
+		return fs.good();
+	}
+
+	bool WriteGLB(const std::string& filepath, const std::vector<Renderer::Vertex1Pos1UV1Norm>& vertices, const std::vector<uint32_t>& indices)
+	{
+		std::ofstream fs(filepath, std::ofstream::out | std::ofstream::binary);
+		if (!fs.good())
+		{
+			return false;
+		}
+
+		// Interleaved position, normal and uv followed by the indices
+		constexpr size_t vertexStride = sizeof(float) * 8;
+		std::vector<float> vertexData;
+		vertexData.reserve(vertices.size() * 8);
+		glm::vec3 min = vertices[0].Position * glm::vec3(1.0f, 1.0f, -1.0f);
+		glm::vec3 max = min;
+		for (const auto& vertex : vertices)
+		{
+			auto position = vertex.Position * glm::vec3(1.0f, 1.0f, -1.0f);
+			min = glm::min(min, position);
+			max = glm::max(max, position);
+			vertexData.insert(vertexData.end(), { position.x, position.y, position.z, vertex.Normal.x, vertex.Normal.y, -vertex.Normal.z,
+				vertex.UV.x, vertex.UV.y });
+		}
+
+		const size_t vertexBytes = vertexData.size() * sizeof(float);
+		const size_t indexBytes = indices.size() * sizeof(uint32_t);
+		const auto vertexCount = std::to_string(vertices.size());
+
+		std::string json = "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+			"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}],"
+			"\"buffers\":[{\"byteLength\":" + std::to_string(vertexBytes + indexBytes) + "}],"
+			"\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" + std::to_string(vertexBytes) + ",\"byteStride\":" + std::to_string(vertexStride) + "},"
+			"{\"buffer\":0,\"byteOffset\":" + std::to_string(vertexBytes) + ",\"byteLength\":" + std::to_string(indexBytes) + "}],"
+			"\"accessors\":["
+			"{\"bufferView\":0,\"byteOffset\":0,\"componentType\":5126,\"count\":" + vertexCount + ",\"type\":\"VEC3\","
+			"\"min\":[" + std::to_string(min.x) + "," + std::to_string(min.y) + "," + std::to_string(min.z) + "],"
+			"\"max\":[" + std::to_string(max.x) + "," + std::to_string(max.y) + "," + std::to_string(max.z) + "]},"
+			"{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":" + vertexCount + ",\"type\":\"VEC3\"},"
+			"{\"bufferView\":0,\"byteOffset\":24,\"componentType\":5126,\"count\":" + vertexCount + ",\"type\":\"VEC2\"},"
+			"{\"bufferView\":1,\"componentType\":5125,\"count\":" + std::to_string(indices.size()) + ",\"type\":\"SCALAR\"}]}";
+		// Chunks are 4 byte aligned, JSON is padded with spaces
+		while (json.size() % 4 != 0)
+		{
+			json += ' ';
+		}
+
+		const uint32_t header[] = { 0x46546C67, 2, static_cast<uint32_t>(12 + 8 + json.size() + 8 + vertexBytes + indexBytes) };
+		const uint32_t jsonChunkHeader[] = { static_cast<uint32_t>(json.size()), 0x4E4F534A };
+		const uint32_t binChunkHeader[] = { static_cast<uint32_t>(vertexBytes + indexBytes), 0x004E4942 };
+
+		fs.write(reinterpret_cast<const char*>(header), sizeof(header));
+		fs.write(reinterpret_cast<const char*>(jsonChunkHeader), sizeof(jsonChunkHeader));
+		fs.write(json.data(), json.size());
+		fs.write(reinterpret_cast<const char*>(binChunkHeader), sizeof(binChunkHeader));
+		fs.write(reinterpret_cast<const char*>(vertexData.data()), vertexBytes);
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			const uint32_t triangle[] = { indices[i], indices[i + 2], indices[i + 1] };
+			fs.write(reinterpret_cast<const char*>(triangle), sizeof(triangle));
+		}
+		return fs.good();
+	}
+
+	bool WriteShaderSource(const std::filesystem::path& filepath, const std::string& source)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(filepath.parent_path(), error);
+		std::ofstream fs(filepath, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+		fs.write(source.data(), static_cast<std::streamsize>(source.size()));
+		return fs.good();
+	}
+}
+
+std::string Benchmarks::RunMeshSimplificationBenchmark()
+{
+	constexpr uint32_t sphereResolutions[] = { 64, 128, 256 };
+
+	std::string report = "Mesh simplification\n";
+
+	for (const auto resolution : sphereResolutions)
+	{
+		std::vector<Renderer::Vertex1Pos1UV1Norm> vertices;
+		std::vector<uint32_t> indices;
+		Renderer::Geometry::GenerateSphereGeometry(vertices, indices, 1.0f, resolution, resolution);
+		const size_t triangleCount = indices.size() / 3;
+
+		// Simplify is timed on its own, a single halving of the full mesh
+		std::vector<uint32_t> simplifiedIndices;
+		const size_t targetIndexCount = static_cast<size_t>(triangleCount * Renderer::MeshSimplifier::LOD_TRIANGLE_RATIO) * 3;
+		auto start = BenchmarkClock::now();
+		Renderer::MeshSimplifier::Simplify(vertices, indices, targetIndexCount, Renderer::MeshSimplifier::LOD_MAX_ERROR, simplifiedIndices);
+		auto simplifyElapsedMs = ElapsedMilliseconds(start);
+
+		// The LOD chain build also runs vertex cache optimisation on every level, so it is reported separately
+		std::vector<Renderer::MeshLOD> lods;
+		start = BenchmarkClock::now();
+		Renderer::MeshSimplifier::BuildLODChain(vertices, indices, lods);
+		auto chainElapsedMs = ElapsedMilliseconds(start);
+
+		// Every level is simplified from the previous one, so the simplifier processed all but the last level
+		size_t trianglesProcessed = 0;
+		for (size_t i = 0; i + 1 < lods.size(); ++i)
+		{
+			trianglesProcessed += lods[i].IndexCount / 3;
+		}
+
+		report += "Sphere " + std::to_string(resolution) + "x" + std::to_string(resolution) + ", " + std::to_string(triangleCount) + " triangles\n";
+		report += "  Simplify to " + std::to_string(simplifiedIndices.size() / 3) + " triangles: " + std::to_string(simplifyElapsedMs) + " ms, " +
+			std::to_string(triangleCount / (simplifyElapsedMs * 1000.0)) + " M triangles/s\n";
+		report += "  LOD chain build (simplify and vertex cache optimisation): " + std::to_string(chainElapsedMs) + " ms, " +
+			std::to_string(trianglesProcessed / (chainElapsedMs * 1000.0)) + " M triangles/s\n";
+
+		for (size_t i = 1; i < lods.size(); ++i)
+		{
+			report += "  LOD " + std::to_string(i) + ": " + std::to_string(lods[i].IndexCount / 3) + " triangles, " +
+				std::to_string(triangleCount - lods[i].IndexCount / 3) + " saved, error " + std::to_string(lods[i].Error) + "\n";
+		}
+	}
+
+	DEBUG_LOG(report);
+	return report;
+}
+
+std::string Benchmarks::RunMeshImportBenchmark()
+{
+	std::vector<std::string> filepaths;
+
+	std::error_code error;
+	if (std::filesystem::is_directory(IMPORT_BENCHMARK_MODELS_DIRECTORY, error))
+	{
+		for (const auto& entry : std::filesystem::directory_iterator(IMPORT_BENCHMARK_MODELS_DIRECTORY, error))
+		{
+			auto extension = entry.path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+			if (entry.is_regular_file() && (extension == ".obj" || extension == ".glb"))
+			{
+				filepaths.push_back(entry.path().string());
+			}
+		}
+	}
+
+	std::string report = "Mesh import\n";
+
+	if (filepaths.empty())
+	{
+		std::vector<Renderer::Vertex1Pos1UV1Norm> vertices;
+		std::vector<uint32_t> indices;
+		Renderer::Geometry::GenerateSphereGeometry(vertices, indices, 1.0f, IMPORT_BENCHMARK_SPHERE_RESOLUTION, IMPORT_BENCHMARK_SPHERE_RESOLUTION);
+
+		auto directory = std::filesystem::temp_directory_path(error);
+		auto objPath = (directory / "cctp_import_benchmark.obj").string();
+		auto glbPath = (directory / "cctp_import_benchmark.glb").string();
+		if (error || !WriteOBJ(objPath, vertices, indices) || !WriteGLB(glbPath, vertices, indices))
+		{
+			report += "Failed to write generated benchmark meshes\n";
+			DEBUG_LOG(report);
+			return report;
+		}
+
+		report += "No models in " + std::string(IMPORT_BENCHMARK_MODELS_DIRECTORY) + ", using a generated " +
+			std::to_string(IMPORT_BENCHMARK_SPHERE_RESOLUTION) + "x" + std::to_string(IMPORT_BENCHMARK_SPHERE_RESOLUTION) + " sphere\n";
+		filepaths = { objPath, glbPath };
+	}
+
+	for (const auto& filepath : filepaths)
+	{
+		std::vector<Renderer::Vertex1Pos1UV1Norm> vertices;
+		std::vector<uint32_t> indices;
+		Renderer::MeshImporter::ImportStatistics statistics;
+		if (!Renderer::MeshImporter::ImportMesh(filepath, vertices, indices, &statistics))
+		{
+			report += std::filesystem::path(filepath).filename().string() + ": import failed\n";
+			continue;
+		}
+
+		report += std::filesystem::path(filepath).filename().string() + ", " + std::to_string(statistics.FileSizeBytes / (1024 * 1024)) + " MB: " +
+			std::to_string(statistics.TotalMilliseconds) + " ms, " + std::to_string(statistics.ThroughputMBPerSecond) + " MB/s\n";
+		report += "  " + std::to_string(statistics.VertexCount) + " vertices, " + std::to_string(statistics.IndexCount / 3) + " triangles, " +
+			std::to_string(statistics.DuplicateVertexCount) + " duplicates merged\n";
+		report += "  parse " + std::to_string(statistics.ParseMilliseconds) + " ms, deduplicate " + std::to_string(statistics.DeduplicateMilliseconds) + " ms\n";
+	}
+
+	DEBUG_LOG(report);
+	return report;
+}
+
+std::string Benchmarks::RunMeshCacheBenchmark()
+{
+	std::string report = "Mesh cache\n";
+
+	// Regeneration runs the same steps as the demo scene probe sphere
+	auto start = BenchmarkClock::now();
+	std::vector<Renderer::Vertex1Pos1UV1Norm> vertices;
+	std::vector<uint32_t> indices;
+	Renderer::Geometry::GenerateSphereGeometry(vertices, indices, 1.0f, CACHE_BENCHMARK_SPHERE_RESOLUTION, CACHE_BENCHMARK_SPHERE_RESOLUTION);
+	Renderer::MeshOptimizer::OptimizeMesh(vertices, indices, true);
+	std::vector<Renderer::MeshLOD> lods;
+	Renderer::MeshSimplifier::BuildLODChain(vertices, indices, lods);
+	std::vector<Renderer::CompressedVertex1Pos1UV1Norm> compressedVertices;
+	Renderer::VertexCompression::QuantizationBounds bounds;
+	Renderer::VertexCompression::CompressVertices(vertices, compressedVertices, bounds);
+	auto regenerateElapsedMs = ElapsedMilliseconds(start);
+
+	Renderer::MeshCache::MeshCacheData cacheData = {};
+	cacheData.pVertices = compressedVertices.data();
+	cacheData.VertexCount = static_cast<uint32_t>(compressedVertices.size());
+	cacheData.VertexStride = sizeof(Renderer::CompressedVertex1Pos1UV1Norm);
+	cacheData.PositionFormat = DXGI_FORMAT_R16G16B16A16_SNORM;
+	cacheData.pIndices = indices.data();
+	cacheData.IndexCount = static_cast<uint32_t>(indices.size());
+	cacheData.pLODs = lods.data();
+	cacheData.LODCount = static_cast<uint32_t>(lods.size());
+	cacheData.Bounds = bounds;
+
+	constexpr uint64_t sourceKey = CACHE_BENCHMARK_SPHERE_RESOLUTION;
+	std::error_code error;
+	auto filepath = (std::filesystem::temp_directory_path(error) / "cctp_cache_benchmark.mesh").string();
+	if (error || !Renderer::MeshCache::WriteMeshCache(filepath, sourceKey, cacheData))
+	{
+		report += "Failed to write benchmark mesh cache\n";
+		DEBUG_LOG(report);
+		return report;
+	}
+
+	// Destination stands in for the mapped upload buffers, both paths end with the mesh data copied into it
+	const size_t vertexBytes = compressedVertices.size() * sizeof(Renderer::CompressedVertex1Pos1UV1Norm);
+	const size_t indexBytes = indices.size() * sizeof(uint32_t);
+	std::vector<uint8_t> uploadBuffer(vertexBytes + indexBytes);
+
+	// Mapped cache file copied straight into the destination
+	start = BenchmarkClock::now();
+	Renderer::MeshCache::MappedMesh mappedMesh;
+	if (!mappedMesh.Open(filepath, sourceKey))
+	{
+		report += "Failed to map benchmark mesh cache\n";
+		DEBUG_LOG(report);
+		return report;
+	}
+	memcpy(uploadBuffer.data(), mappedMesh.GetVertexData(), vertexBytes);
+	memcpy(uploadBuffer.data() + vertexBytes, mappedMesh.GetIndexData(), indexBytes);
+	auto mappedElapsedMs = ElapsedMilliseconds(start);
+
+	// The same file read through an intermediate buffer first
+	start = BenchmarkClock::now();
+	BinaryBuffer fileBuffer;
+	if (Binary::ReadBinaryIntoBuffer(filepath, fileBuffer) && fileBuffer.GetBufferLength() >= sizeof(Renderer::MeshCache::MeshCacheHeader))
+	{
+		Renderer::MeshCache::MeshCacheHeader header;
+		memcpy(&header, fileBuffer.GetBufferPointer(), sizeof(header));
+		const uint64_t fileSize = fileBuffer.GetBufferLength();
+		if (header.VertexOffset <= fileSize && vertexBytes <= fileSize - header.VertexOffset &&
+			header.IndexOffset <= fileSize && indexBytes <= fileSize - header.IndexOffset)
+		{
+			memcpy(uploadBuffer.data(), fileBuffer.GetBufferPointer() + header.VertexOffset, vertexBytes);
+			memcpy(uploadBuffer.data() + vertexBytes, fileBuffer.GetBufferPointer() + header.IndexOffset, indexBytes);
+		}
+	}
+	auto readElapsedMs = ElapsedMilliseconds(start);
+
+	report += "Sphere " + std::to_string(CACHE_BENCHMARK_SPHERE_RESOLUTION) + "x" + std::to_string(CACHE_BENCHMARK_SPHERE_RESOLUTION) + ", " +
+		std::to_string(indices.size() / 3) + " triangles in " + std::to_string(lods.size()) + " levels, " +
+		std::to_string(mappedMesh.GetFileSize() / 1024) + " KB cache file\n";
+	report += "  Regenerate: " + std::to_string(regenerateElapsedMs) + " ms\n";
+	report += "  Map cache and copy: " + std::to_string(mappedElapsedMs) + " ms, " + std::to_string(SpeedupRatio(regenerateElapsedMs, mappedElapsedMs)) + "x faster\n";
+	report += "  Read cache into buffer and copy: " + std::to_string(readElapsedMs) + " ms\n";
+
+	DEBUG_LOG(report);
+	return report;
+}
+
+std::string Benchmarks::RunTransformUpdateBenchmark()
+{
+	std::string report = "Transform update\n";
+
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> positionDistribution(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> rotationDistribution(-180.0f, 180.0f);
+	std::uniform_real_distribution<float> scaleDistribution(0.1f, 5.0f);
+
+	TransformStorage transforms;
+	transforms.Resize(TRANSFORM_BENCHMARK_COUNT);
+	for (uint32_t i = 0; i < TRANSFORM_BENCHMARK_COUNT; ++i)
+	{
+		transforms.SetTransform(i, {
+			glm::vec3(positionDistribution(generator), positionDistribution(generator), positionDistribution(generator)),
+			glm::vec3(rotationDistribution(generator), rotationDistribution(generator), rotationDistribution(generator)),
+			glm::vec3(scaleDistribution(generator), scaleDistribution(generator), scaleDistribution(generator)) });
+	}
+
+	// Previous per draw path, world matrix and inverse transpose recalculated for every transform
+	std::vector<TransformMatrices> referenceMatrices(TRANSFORM_BENCHMARK_COUNT);
+	auto start = BenchmarkClock::now();
+	for (uint32_t i = 0; i < TRANSFORM_BENCHMARK_COUNT; ++i)
+	{
+		referenceMatrices[i].WorldMatrix = Math::CalculateWorldMatrix(transforms.GetTransform(i));
+		referenceMatrices[i].NormalMatrix = glm::inverse(glm::transpose(glm::mat3(referenceMatrices[i].WorldMatrix)));
+	}
+	auto perDrawElapsedMs = ElapsedMilliseconds(start);
+
+	// Batch update with every transform dirty
+	start = BenchmarkClock::now();
+	transforms.UpdateDirty();
+	auto batchElapsedMs = ElapsedMilliseconds(start);
+
+	// Batch results must match the per draw path
+	float maxWorldError = 0.0f;
+	float maxNormalError = 0.0f;
+	for (uint32_t i = 0; i < TRANSFORM_BENCHMARK_COUNT; ++i)
+	{
+		const auto& matrices = transforms.GetMatrices(i);
+		for (glm::length_t column = 0; column < 4; ++column)
+		{
+			auto worldError = glm::abs(matrices.WorldMatrix[column] - referenceMatrices[i].WorldMatrix[column]);
+			auto normalError = glm::abs(matrices.NormalMatrix[column] - referenceMatrices[i].NormalMatrix[column]);
+			maxWorldError = std::max({ maxWorldError, worldError.x, worldError.y, worldError.z, worldError.w });
+			maxNormalError = std::max({ maxNormalError, normalError.x, normalError.y, normalError.z, normalError.w });
+		}
+	}
+
+	// Typical frame, a small fraction of the transforms move
+	for (uint32_t i = 0; i < TRANSFORM_BENCHMARK_COUNT; i += TRANSFORM_BENCHMARK_DYNAMIC_DIVISOR)
+	{
+		transforms.SetPosition(i, transforms.GetPosition(i) + glm::vec3(1.0f, 0.0f, 0.0f));
+	}
+	const auto dynamicCount = transforms.GetDirtyCount();
+	start = BenchmarkClock::now();
+	transforms.UpdateDirty();
+	auto partialElapsedMs = ElapsedMilliseconds(start);
+
+	report += std::to_string(TRANSFORM_BENCHMARK_COUNT) + " transforms\n";
+	report += "  Per draw world and normal matrices: " + std::to_string(perDrawElapsedMs) + " ms\n";
+	report += "  Batch update, all dirty: " + std::to_string(batchElapsedMs) + " ms, " + std::to_string(perDrawElapsedMs / batchElapsedMs) + "x faster\n";
+	report += "  Batch update, " + std::to_string(dynamicCount) + " dirty: " + std::to_string(partialElapsedMs) + " ms\n";
+	report += "  Max error world: " + std::to_string(maxWorldError) + " normal: " + std::to_string(maxNormalError) + "\n";
+
+	DEBUG_LOG(report);
+	return report;
+}
+
+std::string Benchmarks::RunTransformHierarchyBenchmark()
+{
+	std::string report = "Transform hierarchy\n";
+
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> positionDistribution(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> rotationDistribution(-180.0f, 180.0f);
+	std::uniform_real_distribution<float> scaleDistribution(0.5f, 2.0f);
+	auto RandomTransform = [&]() -> Transform
+	{
+		return { glm::vec3(positionDistribution(generator), positionDistribution(generator), positionDistribution(generator)),
+			glm::vec3(rotationDistribution(generator), rotationDistribution(generator), rotationDistribution(generator)),
+			glm::vec3(scaleDistribution(generator), scaleDistribution(generator), scaleDistribution(generator)) };
+	};
+
+	// Random tree, each node parented to any earlier node, with one root per thousand nodes
+	TransformHierarchy hierarchy;
+	for (uint32_t i = 0; i < HIERARCHY_BENCHMARK_NODE_COUNT; ++i)
+	{
+		auto parent = i % 1000 == 0 ? TransformHierarchy::INVALID_NODE : std::uniform_int_distribution<uint32_t>(0, i - 1)(generator);
+		hierarchy.AddNode(RandomTransform(), parent);
+	}
+
+	auto start = BenchmarkClock::now();
+	auto fullUpdateCount = hierarchy.UpdateWorldMatrices();
+	auto fullElapsedMs = ElapsedMilliseconds(start);
+
+	// Flat recalculation of every node in handle order, parents come first so their world matrices are ready
+	std::vector<glm::mat4> referenceWorldMatrices(HIERARCHY_BENCHMARK_NODE_COUNT);
+	start = BenchmarkClock::now();
+	for (uint32_t node = 0; node < HIERARCHY_BENCHMARK_NODE_COUNT; ++node)
+	{
+		auto local = Math::CalculateWorldMatrix(hierarchy.GetLocalTransform(node));
+		auto parent = hierarchy.GetParent(node);
+		referenceWorldMatrices[node] = parent == TransformHierarchy::INVALID_NODE ? local : referenceWorldMatrices[parent] * local;
+	}
+	auto flatElapsedMs = ElapsedMilliseconds(start);
+
+	// Animate a small fraction of nodes per frame, only they and their descendants are recalculated
+	std::uniform_int_distribution<uint32_t> nodeDistribution(0, HIERARCHY_BENCHMARK_NODE_COUNT - 1);
+	size_t animatedUpdateCount = 0;
+	double animatedElapsedMs = 0.0;
+	for (uint32_t frame = 0; frame < HIERARCHY_BENCHMARK_FRAME_COUNT; ++frame)
+	{
+		for (uint32_t i = 0; i < HIERARCHY_BENCHMARK_NODE_COUNT / TRANSFORM_BENCHMARK_DYNAMIC_DIVISOR; ++i)
+		{
+			hierarchy.SetLocalRotation(nodeDistribution(generator), glm::vec3(rotationDistribution(generator), rotationDistribution(generator), 0.0f));
+		}
+
+		start = BenchmarkClock::now();
+		animatedUpdateCount += hierarchy.UpdateWorldMatrices();
+		animatedElapsedMs += ElapsedMilliseconds(start);
+	}
+
+	// Check the propagated result against a flat recalculation of the final frame
+	float maxRelativeError = 0.0f;
+	for (uint32_t node = 0; node < HIERARCHY_BENCHMARK_NODE_COUNT; ++node)
+	{
+		auto local = Math::CalculateWorldMatrix(hierarchy.GetLocalTransform(node));
+		auto parent = hierarchy.GetParent(node);
+		referenceWorldMatrices[node] = parent == TransformHierarchy::INVALID_NODE ? local : referenceWorldMatrices[parent] * local;
+
+		const auto& worldMatrix = hierarchy.GetWorldMatrices(node).WorldMatrix;
+		for (glm::length_t column = 0; column < 4; ++column)
+		{
+			auto error = glm::abs(worldMatrix[column] - referenceWorldMatrices[node][column]) /
+				glm::max(glm::abs(referenceWorldMatrices[node][column]), glm::vec4(1.0f));
+			maxRelativeError = std::max({ maxRelativeError, error.x, error.y, error.z, error.w });
+		}
+	}
+
+	size_t maxDepth = 0;
+	for (uint32_t node = 0; node < HIERARCHY_BENCHMARK_NODE_COUNT; ++node)
+	{
+		maxDepth = std::max<size_t>(maxDepth, hierarchy.GetDepth(node));
+	}
+
+	report += std::to_string(HIERARCHY_BENCHMARK_NODE_COUNT) + " nodes, " + std::to_string(maxDepth + 1) + " levels, " +
+		std::to_string(TaskSystem::GetWorkerCount()) + " workers\n";
+	report += "  Flat recalculation: " + std::to_string(flatElapsedMs) + " ms\n";
+	report += "  Full update: " + std::to_string(fullUpdateCount) + " nodes in " + std::to_string(fullElapsedMs) + " ms\n";
+	report += "  Animated " + std::to_string(HIERARCHY_BENCHMARK_NODE_COUNT / TRANSFORM_BENCHMARK_DYNAMIC_DIVISOR) + " nodes per frame: " +
+		std::to_string(animatedUpdateCount / HIERARCHY_BENCHMARK_FRAME_COUNT) + " nodes updated in " +
+		std::to_string(animatedElapsedMs / HIERARCHY_BENCHMARK_FRAME_COUNT) + " ms per frame\n";
+	report += "  Max relative error: " + std::to_string(maxRelativeError) + "\n";
+
+	DEBUG_LOG(report);
+	return report;
+}
+
+std::string Benchmarks::RunFrustumCullingBenchmark()
+{
+	std::string report = "Frustum culling\n";
+
+	// Boxes scattered around a camera at the origin looking down +Z, roughly a quarter of them inside the frustum
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> positionDistribution(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> extentDistribution(0.1f, 2.0f);
+	std::vector<Math::AABB> boxes(CULLING_BENCHMARK_BOX_COUNT);
+	Renderer::CullingBoxes cullingBoxes;
+	cullingBoxes.Resize(CULLING_BENCHMARK_BOX_COUNT);
+	for (uint32_t i = 0; i < CULLING_BENCHMARK_BOX_COUNT; ++i)
+	{
+		boxes[i].Center = glm::vec3(positionDistribution(generator), positionDistribution(generator), positionDistribution(generator));
+		boxes[i].HalfExtent = glm::vec3(extentDistribution(generator), extentDistribution(generator), extentDistribution(generator));
+		cullingBoxes.Set(i, boxes[i]);
+	}
+
+	const auto frustum = Math::ExtractFrustum(Math::CalculatePerspectiveProjectionMatrix(90.0f, 1920.0f, 1080.0f, 0.1f, 100.0f) *
+		Math::CalculateViewMatrix(glm::vec3(0.0f), glm::vec3(0.0f)));
+
+	// One box at a time
+	std::vector<uint32_t> scalarVisibleIndices;
+	scalarVisibleIndices.reserve(CULLING_BENCHMARK_BOX_COUNT);
+	auto start = BenchmarkClock::now();
+	for (uint32_t i = 0; i < CULLING_BENCHMARK_BOX_COUNT; ++i)
+	{
+		if (Math::IsAABBInFrustum(frustum, boxes[i]))
+		{
+			scalarVisibleIndices.push_back(i);
+		}
+	}
+	auto scalarElapsedMs = ElapsedMilliseconds(start);
+
+	// Four boxes per instruction from the separate arrays
+	std::vector<uint32_t> visibleIndices;
+	visibleIndices.reserve(CULLING_BENCHMARK_BOX_COUNT);
+	start = BenchmarkClock::now();
+	Renderer::CullBoxes(cullingBoxes, frustum, visibleIndices);
+	auto simdElapsedMs = ElapsedMilliseconds(start);
+
+	report += std::to_string(CULLING_BENCHMARK_BOX_COUNT) + " boxes, " + std::to_string(visibleIndices.size()) + " visible\n";
+	report += "  Scalar: " + std::to_string(scalarElapsedMs) + " ms\n";
+	report += "  SIMD: " + std::to_string(simdElapsedMs) + " ms, " + std::to_string(scalarElapsedMs / simdElapsedMs) + "x faster\n";
+	report += std::string("  Visible lists ") + (visibleIndices == scalarVisibleIndices ? "match" : "DO NOT match") + "\n";
+
+	DEBUG_LOG(report);
+	return report;
+}
+
+std::string Benchmarks::RunOcclusionCullingBenchmark()
+{
+	std::string report = "Occlusion culling\n";
+
+	// Camera at the origin looking down +Z at two overlapping walls, with boxes scattered in front of and behind them
+	const auto viewProjectionMatrix = Math::CalculatePerspectiveProjectionMatrix(60.0f, 1920.0f, 1080.0f, 0.1f, 200.0f) *
+		Math::CalculateViewMatrix(glm::vec3(0.0f), glm::vec3(0.0f));
+
+	std::vector<Renderer::Vertex1Pos1UV1Norm> cubeVertices;
+	std::vector<uint32_t> cubeIndices;
+	Renderer::Geometry::GenerateCubeGeometry(cubeVertices, cubeIndices, 1.0f);
+
+	Transform wallTransforms[2];
+	wallTransforms[0].Position = glm::vec3(-4.0f, 0.0f, 20.0f);
+	wallTransforms[0].Scale = glm::vec3(30.0f, 12.0f, 1.0f);
+	wallTransforms[1].Position = glm::vec3(14.0f, -4.0f, 30.0f);
+	wallTransforms[1].Scale = glm::vec3(20.0f, 20.0f, 1.0f);
+
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> positionXDistribution(-40.0f, 40.0f);
+	std::uniform_real_distribution<float> positionYDistribution(-20.0f, 20.0f);
+	std::uniform_real_distribution<float> positionZDistribution(2.0f, 100.0f);
+	std::uniform_real_distribution<float> extentDistribution(0.25f, 1.5f);
+	std::vector<Math::AABB> boxes(OCCLUSION_BENCHMARK_BOX_COUNT);
+	Renderer::CullingBoxes cullingBoxes;
+	cullingBoxes.Resize(OCCLUSION_BENCHMARK_BOX_COUNT);
+	for (uint32_t i = 0; i < OCCLUSION_BENCHMARK_BOX_COUNT; ++i)
+	{
+		boxes[i].Center = glm::vec3(positionXDistribution(generator), positionYDistribution(generator), positionZDistribution(generator));
+		boxes[i].HalfExtent = glm::vec3(extentDistribution(generator), extentDistribution(generator), extentDistribution(generator));
+		cullingBoxes.Set(i, boxes[i]);
+	}
+
+	// Only boxes passing the frustum test would be submitted, so those are the draws occlusion culling can remove
+	std::vector<uint32_t> frustumVisibleIndices;
+	Renderer::CullBoxes(cullingBoxes, Math::ExtractFrustum(viewProjectionMatrix), frustumVisibleIndices);
+
+	Renderer::OcclusionBuffer occlusionBuffer;
+	occlusionBuffer.Resize(OCCLUSION_BENCHMARK_WIDTH, OCCLUSION_BENCHMARK_HEIGHT);
+
+	std::vector<uint32_t> visibleIndices;
+	visibleIndices.reserve(frustumVisibleIndices.size());
+	double rasterizeElapsedMs = 0.0;
+	double testElapsedMs = 0.0;
+	for (uint32_t frame = 0; frame < OCCLUSION_BENCHMARK_FRAME_COUNT; ++frame)
+	{
+		auto start = BenchmarkClock::now();
+		occlusionBuffer.Clear();
+		for (const auto& wallTransform : wallTransforms)
+		{
+			occlusionBuffer.AddOccluder(cubeVertices.data(), sizeof(Renderer::Vertex1Pos1UV1Norm), cubeIndices.data(), cubeIndices.size(),
+				viewProjectionMatrix * Math::CalculateWorldMatrix(wallTransform));
+		}
+		occlusionBuffer.Rasterize();
+		rasterizeElapsedMs += ElapsedMilliseconds(start);
+
+		start = BenchmarkClock::now();
+		visibleIndices.clear();
+		for (auto i : frustumVisibleIndices)
+		{
+			if (occlusionBuffer.IsVisible(boxes[i], viewProjectionMatrix))
+			{
+				visibleIndices.push_back(i);
+			}
+		}
+		testElapsedMs += ElapsedMilliseconds(start);
+	}
+	rasterizeElapsedMs /= OCCLUSION_BENCHMARK_FRAME_COUNT;
+	testElapsedMs /= OCCLUSION_BENCHMARK_FRAME_COUNT;
+
+	// Reference depth buffer at the same resolution, testing every pixel centre against every front facing wall triangle
+	std::vector<float> referenceDepths(OCCLUSION_BENCHMARK_WIDTH * OCCLUSION_BENCHMARK_HEIGHT, 1.0f);
+	for (const auto& wallTransform : wallTransforms)
+	{
+		const auto worldViewProjectionMatrix = viewProjectionMatrix * Math::CalculateWorldMatrix(wallTransform);
+		for (size_t i = 0; i < cubeIndices.size(); i += 3)
+		{
+			glm::vec3 screen[3];
+			for (size_t j = 0; j < 3; ++j)
+			{
+				auto clip = worldViewProjectionMatrix * glm::vec4(cubeVertices[cubeIndices[i + j]].Position, 1.0f);
+				screen[j] = glm::vec3((clip.x / clip.w * 0.5f + 0.5f) * OCCLUSION_BENCHMARK_WIDTH,
+					(0.5f - clip.y / clip.w * 0.5f) * OCCLUSION_BENCHMARK_HEIGHT, clip.z / clip.w);
+			}
+			auto area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+			if (area <= 0.0f)
+			{
+				continue;
+			}
+
+			for (uint32_t y = 0; y < OCCLUSION_BENCHMARK_HEIGHT; ++y)
+			{
+				for (uint32_t x = 0; x < OCCLUSION_BENCHMARK_WIDTH; ++x)
+				{
+					auto pixel = glm::vec2(x + 0.5f, y + 0.5f);
+					float weights[3];
+					bool inside = true;
+					for (size_t j = 0; j < 3; ++j)
+					{
+						const auto& a = screen[(j + 1) % 3];
+						const auto& b = screen[(j + 2) % 3];
+						weights[j] = ((b.x - a.x) * (pixel.y - a.y) - (b.y - a.y) * (pixel.x - a.x)) / area;
+						inside &= weights[j] >= 0.0f;
+					}
+					if (inside)
+					{
+						auto& depth = referenceDepths[y * OCCLUSION_BENCHMARK_WIDTH + x];
+						depth = std::min(depth, weights[0] * screen[0].z + weights[1] * screen[1].z + weights[2] * screen[2].z);
+					}
+				}
+			}
+		}
+	}
+
+	// A box is hidden when its nearest depth is behind the reference depth at every pixel its screen rectangle touches
+	auto IsHidden = [&](const Math::AABB& box)
+	{
+		auto minPixel = glm::vec2(std::numeric_limits<float>::max());
+		auto maxPixel = glm::vec2(std::numeric_limits<float>::lowest());
+		auto minDepth = std::numeric_limits<float>::max();
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			auto corner = box.Center + box.HalfExtent * glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+			auto clip = viewProjectionMatrix * glm::vec4(corner, 1.0f);
+			if (clip.z < 0.0f)
+			{
+				return false;
+			}
+			auto pixel = glm::vec2((clip.x / clip.w * 0.5f + 0.5f) * OCCLUSION_BENCHMARK_WIDTH, (0.5f - clip.y / clip.w * 0.5f) * OCCLUSION_BENCHMARK_HEIGHT);
+			minPixel = glm::min(minPixel, pixel);
+			maxPixel = glm::max(maxPixel, pixel);
+			minDepth = std::min(minDepth, clip.z / clip.w);
+		}
+
+		auto firstX = static_cast<int32_t>(std::clamp(std::floor(minPixel.x), 0.0f, OCCLUSION_BENCHMARK_WIDTH - 1.0f));
+		auto lastX = static_cast<int32_t>(std::clamp(std::floor(maxPixel.x), 0.0f, OCCLUSION_BENCHMARK_WIDTH - 1.0f));
+		auto firstY = static_cast<int32_t>(std::clamp(std::floor(minPixel.y), 0.0f, OCCLUSION_BENCHMARK_HEIGHT - 1.0f));
+		auto lastY = static_cast<int32_t>(std::clamp(std::floor(maxPixel.y), 0.0f, OCCLUSION_BENCHMARK_HEIGHT - 1.0f));
+		for (auto y = firstY; y <= lastY; ++y)
+		{
+			for (auto x = firstX; x <= lastX; ++x)
+			{
+				if (minDepth <= referenceDepths[y * OCCLUSION_BENCHMARK_WIDTH + x])
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	};
+
+	size_t referenceCulledCount = 0;
+	size_t wronglyCulledCount = 0;
+	for (auto i : frustumVisibleIndices)
+	{
+		auto hidden = IsHidden(boxes[i]);
+		referenceCulledCount += hidden;
+		wronglyCulledCount += !hidden && !std::binary_search(visibleIndices.begin(), visibleIndices.end(), i);
+	}
+
+	const auto culledCount = frustumVisibleIndices.size() - visibleIndices.size();
+	report += std::to_string(OCCLUSION_BENCHMARK_BOX_COUNT) + " boxes, " + std::to_string(frustumVisibleIndices.size()) + " in the frustum, " +
+		std::to_string(occlusionBuffer.GetWidth()) + "x" + std::to_string(occlusionBuffer.GetHeight()) + " occlusion buffer, " +
+		std::to_string(occlusionBuffer.GetOccluderTriangleCount()) + " occluder triangles, " + std::to_string(TaskSystem::GetWorkerCount()) + " workers\n";
+	report += "  Occlusion culled: " + std::to_string(culledCount) + " (" +
+		std::to_string(100.0 * culledCount / std::max<size_t>(frustumVisibleIndices.size(), 1)) + "% of draws)\n";
+	report += "  Per pixel reference culls: " + std::to_string(referenceCulledCount) + ", visible boxes culled: " + std::to_string(wronglyCulledCount) + "\n";
+	report += "  Rasterize: " + std::to_string(rasterizeElapsedMs) + " ms per frame\n";
+	report += "  Test: " + std::to_string(testElapsedMs) + " ms per frame\n";
+
+	DEBUG_LOG(report);
+	return report;
+}
+
+std::string Benchmarks::RunSpatialIndexBenchmark()
+{
+	std::string report = "Spatial index\n";
+
+	// Small objects spread over a flat world, with a few large ones that do not fit a cell
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> horizontalDistribution(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> verticalDistribution(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> extentDistribution(0.1f, 1.0f);
+	std::uniform_real_distribution<float> velocityDistribution(-1.0f, 1.0f);
+	std::vector<Math::AABB> boxes(SPATIAL_BENCHMARK_OBJECT_COUNT);
+	std::vector<glm::vec3> velocities(SPATIAL_BENCHMARK_OBJECT_COUNT);
+	for (uint32_t i = 0; i < SPATIAL_BENCHMARK_OBJECT_COUNT; ++i)
+	{
+		boxes[i].Center = glm::vec3(horizontalDistribution(generator), verticalDistribution(generator), horizontalDistribution(generator));
+		boxes[i].HalfExtent = glm::vec3(extentDistribution(generator), extentDistribution(generator), extentDistribution(generator)) *
+			(i < SPATIAL_BENCHMARK_LARGE_OBJECT_COUNT ? 20.0f : 1.0f);
+		velocities[i] = glm::vec3(velocityDistribution(generator), velocityDistribution(generator), velocityDistribution(generator));
+	}
+
+	SpatialHashGrid grid(SPATIAL_BENCHMARK_CELL_SIZE);
+	auto start = BenchmarkClock::now();
+	grid.Build(boxes.data(), boxes.size());
+	auto buildElapsedMs = ElapsedMilliseconds(start);
+
+	SpatialHashGrid insertedGrid(SPATIAL_BENCHMARK_CELL_SIZE);
+	start = BenchmarkClock::now();
+	for (const auto& box : boxes)
+	{
+		insertedGrid.Insert(box);
+	}
+	auto insertElapsedMs = ElapsedMilliseconds(start);
+
+	report += std::to_string(SPATIAL_BENCHMARK_OBJECT_COUNT) + " objects, " + std::to_string(grid.GetCellCount()) + " cells, " +
+		std::to_string(grid.GetLargeObjectCount()) + " large objects, " + std::to_string(TaskSystem::GetWorkerCount()) + " workers\n";
+	report += "  Bulk build: " + std::to_string(buildElapsedMs) + " ms\n";
+	report += "  One at a time insert: " + std::to_string(insertElapsedMs) + " ms\n";
+
+	// Every object moves up to a unit per axis every frame, most stay in their cell
+	double moveElapsedMs = 0.0;
+	for (uint32_t frame = 0; frame < SPATIAL_BENCHMARK_FRAME_COUNT; ++frame)
+	{
+		for (uint32_t i = 0; i < SPATIAL_BENCHMARK_OBJECT_COUNT; ++i)
+		{
+			boxes[i].Center += velocities[i];
+		}
+
+		start = BenchmarkClock::now();
+		for (uint32_t i = 0; i < SPATIAL_BENCHMARK_OBJECT_COUNT; ++i)
+		{
+			grid.Move(i, boxes[i]);
+		}
+		moveElapsedMs += ElapsedMilliseconds(start);
+	}
+	moveElapsedMs /= SPATIAL_BENCHMARK_FRAME_COUNT;
+	report += "  Move every object: " + std::to_string(moveElapsedMs) + " ms per frame, " +
+		std::to_string(SPATIAL_BENCHMARK_OBJECT_COUNT / moveElapsedMs / 1000.0) + " million moves per second\n";
+
+	// Query shapes around random points of the world
+	std::vector<glm::vec3> queryCenters(SPATIAL_BENCHMARK_QUERY_COUNT);
+	for (auto& center : queryCenters)
+	{
+		center = glm::vec3(horizontalDistribution(generator), verticalDistribution(generator), horizontalDistribution(generator));
+	}
+	const float queryRadius = 8.0f;
+
+	std::vector<uint32_t> results;
+	size_t sphereResultCount = 0;
+	start = BenchmarkClock::now();
+	for (const auto& center : queryCenters)
+	{
+		grid.QuerySphere(center, queryRadius, results);
+		sphereResultCount += results.size();
+	}
+	auto sphereElapsedMs = ElapsedMilliseconds(start);
+
+	size_t boxResultCount = 0;
+	start = BenchmarkClock::now();
+	for (const auto& center : queryCenters)
+	{
+		Math::AABB queryBox;
+		queryBox.Center = center;
+		queryBox.HalfExtent = glm::vec3(queryRadius);
+		grid.QueryAABB(queryBox, results);
+		boxResultCount += results.size();
+	}
+	auto boxElapsedMs = ElapsedMilliseconds(start);
+
+	const auto frustum = Math::ExtractFrustum(Math::CalculatePerspectiveProjectionMatrix(60.0f, 1920.0f, 1080.0f, 0.1f, 100.0f) *
+		Math::CalculateViewMatrix(glm::vec3(0.0f), glm::vec3(0.0f)));
+	start = BenchmarkClock::now();
+	grid.QueryFrustum(frustum, results);
+	auto frustumElapsedMs = ElapsedMilliseconds(start);
+	auto frustumResultCount = results.size();
+
+	// Compare a few queries with a scan of every object
+	auto SortedResults = [&results]()
+	{
+		std::sort(results.begin(), results.end());
+		return results;
+	};
+	bool resultsMatch = SortedResults() == [&]()
+	{
+		std::vector<uint32_t> expected;
+		for (uint32_t i = 0; i < SPATIAL_BENCHMARK_OBJECT_COUNT; ++i)
+		{
+			if (Math::IsAABBInFrustum(frustum, boxes[i]))
+			{
+				expected.push_back(i);
+			}
+		}
+		return expected;
+	}();
+	start = BenchmarkClock::now();
+	for (uint32_t query = 0; query < SPATIAL_BENCHMARK_CHECKED_QUERY_COUNT; ++query)
+	{
+		const auto& center = queryCenters[query];
+		std::vector<uint32_t> expected;
+		for (uint32_t i = 0; i < SPATIAL_BENCHMARK_OBJECT_COUNT; ++i)
+		{
+			auto offset = glm::max(glm::abs(center - boxes[i].Center) - boxes[i].HalfExtent, glm::vec3(0.0f));
+			if (glm::dot(offset, offset) <= queryRadius * queryRadius)
+			{
+				expected.push_back(i);
+			}
+		}
+		grid.QuerySphere(center, queryRadius, results);
+		resultsMatch &= SortedResults() == expected;
+	}
+	auto scanElapsedMs = ElapsedMilliseconds(start) / SPATIAL_BENCHMARK_CHECKED_QUERY_COUNT;
+
+	report += "  Sphere queries: " + std::to_string(sphereElapsedMs * 1000.0 / SPATIAL_BENCHMARK_QUERY_COUNT) + " us each, " +
+		std::to_string(sphereResultCount / SPATIAL_BENCHMARK_QUERY_COUNT) + " objects found on average\n";
+	report += "  AABB queries: " + std::to_string(boxElapsedMs * 1000.0 / SPATIAL_BENCHMARK_QUERY_COUNT) + " us each, " +
+		std::to_string(boxResultCount / SPATIAL_BENCHMARK_QUERY_COUNT) + " objects found on average\n";
+	report += "  Frustum query: " + std::to_string(frustumElapsedMs) + " ms, " + std::to_string(frustumResultCount) + " objects found\n";
+	report += "  Linear scan sphere query: " + std::to_string(scanElapsedMs * 1000.0) + " us\n";
+	report += std::string("  Query results ") + (resultsMatch ? "match" : "DO NOT match") + " a linear scan\n";
+
+	DEBUG_LOG(report);
+	return report;
+}
+
+std::string Benchmarks::RunRenderGraphBenchmark()
+{
+	using Graph = Renderer::RenderGraph;
+
+	std::string report = "Render graph\n";
+
+	// Every texture shares one heap type here, sizes are rounded up to the usual placement alignment
+	auto queryAllocation = [](const Graph::TextureDesc& desc, const uint32_t)
+	{
+		Graph::AllocationInfo info;
+		const uint64_t size = static_cast<uint64_t>(desc.Width) * desc.Height * desc.Format;
+		info.Size = (size + RENDER_GRAPH_BENCHMARK_TEXTURE_ALIGNMENT - 1) / RENDER_GRAPH_BENCHMARK_TEXTURE_ALIGNMENT * RENDER_GRAPH_BENCHMARK_TEXTURE_ALIGNMENT;
+		info.Alignment = RENDER_GRAPH_BENCHMARK_TEXTURE_ALIGNMENT;
+		return info;
+	};
+
+	Graph graph;
+	std::vector<std::vector<BenchmarkPassAccess>> passAccesses;
+	std::function<void(uint32_t)> onExecute = [](uint32_t) {};
+
+	// Building and compiling is done every frame. Correctness of the compiled frame is covered by the RenderGraph tests
+	auto start = BenchmarkClock::now();
+	for (uint32_t frame = 0; frame < RENDER_GRAPH_BENCHMARK_FRAME_COUNT; ++frame)
+	{
+		BuildBenchmarkRenderGraph(graph, passAccesses, onExecute);
+		graph.Compile(queryAllocation);
+	}
+	auto compileElapsedMs = ElapsedMilliseconds(start) / RENDER_GRAPH_BENCHMARK_FRAME_COUNT;
+
+	std::string culledPasses;
+	for (Graph::PassHandle p = 0; p < graph.GetPassCount(); ++p)
+	{
+		if (graph.IsPassCulled(p))
+		{
+			culledPasses += (culledPasses.empty() ? "" : ", ") + graph.GetPassName(p);
+		}
+	}
+
+	const auto& statistics = graph.GetStatistics();
+	constexpr double bytesPerMegabyte = 1024.0 * 1024.0;
+	report += "  Passes: " + std::to_string(statistics.PassCount) + ", " + std::to_string(statistics.CulledPassCount) + " culled (" + culledPasses + ")\n";
+	report += "  Transients: " + std::to_string(statistics.TransientCount) + ", " + std::to_string(statistics.TransientBytes / bytesPerMegabyte) +
+		" MB placed in " + std::to_string(statistics.HeapBytes / bytesPerMegabyte) + " MB of heap\n";
+	report += "  Barriers: " + std::to_string(statistics.BarrierCount) + "\n";
+	report += "  Build and compile: " + std::to_string(compileElapsedMs * 1000.0) + " us per frame\n";
+
+	DEBUG_LOG(report);
+	return report;
+}
+
+std::string Benchmarks::RunCommandRecordingBenchmark()
+{
+	using Graph = Renderer::RenderGraph;
+
+	std::string report = "Command recording\n";
+
+	auto queryAllocation = [](const Graph::TextureDesc& desc, const uint32_t)
+	{
+		Graph::AllocationInfo info;
+		info.Size = static_cast<uint64_t>(desc.Width) * desc.Height * desc.Format;
+		return info;
+	};
+
+	// Native objects and GPU addresses are never dereferenced without a graphics API, any distinct non zero values stand in for them
+	std::vector<uint64_t> nativeResources;
+	uint64_t nativePipeline = 0;
+	uint64_t nativeRootSignature = 0;
+	uint64_t nativeHeap = 0;
+
+	// Passes record into whichever stream they are given, so they can be recorded serially into one or in parallel into one each
+	auto recordPassInto = [&](Renderer::CommandStream& stream, const uint32_t pass)
+	{
+		stream.SetViewport(0.0f, 0.0f, 1920.0f, 1080.0f, 0.0f, 1.0f, 0, 0, 1920, 1080);
+		stream.SetRenderTargets(pass + 1, 0);
+		stream.ClearRenderTarget(pass + 1, {});
+		stream.SetGraphicsPipeline(&nativePipeline, &nativeRootSignature);
+		stream.SetGraphicsRootConstantBufferView(1, 0x1000);
+		stream.SetGraphicsRootDescriptorTable(3, 0x2000);
+
+		// Draws are sorted by mesh, so buffers change once per mesh run
+		for (uint32_t draw = 0; draw < COMMAND_BENCHMARK_DRAWS_PER_PASS; ++draw)
+		{
+			const uint32_t mesh = draw * COMMAND_BENCHMARK_MESH_COUNT / COMMAND_BENCHMARK_DRAWS_PER_PASS;
+			if (draw == 0 || mesh != (draw - 1) * COMMAND_BENCHMARK_MESH_COUNT / COMMAND_BENCHMARK_DRAWS_PER_PASS)
+			{
+				stream.SetVertexBuffer(0x100000 * (mesh + 1), 0x10000, 32);
+				stream.SetIndexBuffer(0x100000 * (mesh + 1) + 0x10000, 0x8000, 42);
+			}
+			stream.SetGraphicsRootShaderResourceView(0, 0x3000 + draw * 256);
+			stream.DrawIndexedInstanced(3 * (64 + mesh * 16), 1 + draw % 4, 0, 0, 0);
+		}
+	};
+
+	auto recordBarriersInto = [&](Renderer::CommandStream& stream, const Graph::Barrier* pBarriers, const uint32_t barrierCount,
+		std::vector<Renderer::ResourceBarrier>& barriers)
+	{
+		barriers.resize(barrierCount);
+		for (uint32_t i = 0; i < barrierCount; ++i)
+		{
+			const auto& barrier = pBarriers[i];
+			barriers[i].BarrierType = barrier.BarrierType;
+			barriers[i].AccessBefore = barrier.AccessBefore;
+			barriers[i].AccessAfter = barrier.AccessAfter;
+			barriers[i].pResource = &nativeResources[barrier.Resource];
+			barriers[i].pResourceBefore = barrier.ResourceBefore != Graph::InvalidHandle ? &nativeResources[barrier.ResourceBefore] : nullptr;
+		}
+		stream.ResourceBarriers(barriers.data(), barrierCount);
+	};
+
+	Renderer::CommandStream stream;
+	std::vector<Renderer::ResourceBarrier> barriers;
+	std::function<void(uint32_t)> recordPass = [&](const uint32_t pass)
+	{
+		recordPassInto(stream, pass);
+	};
+
+	Graph graph;
+	std::vector<std::vector<BenchmarkPassAccess>> passAccesses;
+	BuildBenchmarkRenderGraph(graph, passAccesses, recordPass);
+	graph.Compile(queryAllocation);
+	nativeResources.resize(graph.GetResourceCount());
+
+	auto recordFrame = [&]()
+	{
+		stream.Reset();
+		stream.SetDescriptorHeap(&nativeHeap);
+		stream.SetPrimitiveTopology(4);
+		graph.Execute([&](const Graph::Barrier* pBarriers, const uint32_t barrierCount)
+			{
+				recordBarriersInto(stream, pBarriers, barrierCount, barriers);
+			});
+		stream.Native([](void*, void*) {}, nullptr);
+	};
+
+	// Recording
+	auto start = BenchmarkClock::now();
+	for (uint32_t frame = 0; frame < COMMAND_BENCHMARK_FRAME_COUNT; ++frame)
+	{
+		recordFrame();
+	}
+	auto recordElapsedMs = ElapsedMilliseconds(start) / COMMAND_BENCHMARK_FRAME_COUNT;
+
+	// Validating the same frame repeatedly, as a frame loop without a GPU does. Whether frames validate is covered by the CommandStream tests
+	Renderer::NullCommandBackend backend;
+	start = BenchmarkClock::now();
+	for (uint32_t frame = 0; frame < COMMAND_BENCHMARK_FRAME_COUNT; ++frame)
+	{
+		backend.Submit(stream);
+	}
+	auto submitElapsedMs = ElapsedMilliseconds(start) / COMMAND_BENCHMARK_FRAME_COUNT;
+	const auto& statistics = backend.GetStatistics();
+
+	// Parallel recording gives each live pass a stream of its own, as the renderer gives each its own command list. Every stream starts
+	// by binding the state the frame set before the passes, the final barriers get a stream after them
+	std::vector<Graph::PassHandle> livePasses;
+	for (Graph::PassHandle pass = 0; pass < graph.GetPassCount(); ++pass)
+	{
+		if (!graph.IsPassCulled(pass))
+		{
+			livePasses.push_back(pass);
+		}
+	}
+	std::vector<Renderer::CommandStream> passStreams(livePasses.size() + 1);
+	std::vector<std::vector<Renderer::ResourceBarrier>> passBarriers(passStreams.size());
+
+	start = BenchmarkClock::now();
+	for (uint32_t frame = 0; frame < COMMAND_BENCHMARK_FRAME_COUNT; ++frame)
+	{
+		TaskSystem::ParallelFor(livePasses.size(), 1, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					auto& passStream = passStreams[i];
+					const auto& graphBarriers = graph.GetPassBarriers(livePasses[i]);
+					passStream.Reset();
+					passStream.SetDescriptorHeap(&nativeHeap);
+					passStream.SetPrimitiveTopology(4);
+					recordBarriersInto(passStream, graphBarriers.data(), static_cast<uint32_t>(graphBarriers.size()), passBarriers[i]);
+					recordPassInto(passStream, livePasses[i]);
+				}
+			});
+
+		auto& finalStream = passStreams.back();
+		const auto& finalBarriers = graph.GetFinalBarriers();
+		finalStream.Reset();
+		recordBarriersInto(finalStream, finalBarriers.data(), static_cast<uint32_t>(finalBarriers.size()), passBarriers.back());
+		finalStream.Native([](void*, void*) {}, nullptr);
+	}
+	const auto parallelRecordElapsedMs = ElapsedMilliseconds(start) / COMMAND_BENCHMARK_FRAME_COUNT;
+
+	constexpr auto drawIndex = static_cast<uint32_t>(Renderer::CommandType::DrawIndexedInstanced);
+	report += "  Frame: " + std::to_string(stream.GetCommandCount()) + " commands in " + std::to_string(stream.GetByteSize() / 1024.0) + " KB, " +
+		std::to_string(statistics.CommandCounts[drawIndex] / statistics.SubmitCount) + " draws, " +
+		std::to_string(statistics.BarrierCount / statistics.SubmitCount) + " barriers\n";
+	report += "  Record: " + std::to_string(recordElapsedMs * 1000.0) + " us per frame\n";
+	report += "  Parallel record: " + std::to_string(parallelRecordElapsedMs * 1000.0) + " us per frame into " + std::to_string(passStreams.size()) +
+		" streams on " + std::to_string(TaskSystem::GetWorkerCount() + 1) + " threads (" + std::to_string(SpeedupRatio(recordElapsedMs, parallelRecordElapsedMs)) + "x)\n";
+	report += "  Null backend validation: " + std::to_string(submitElapsedMs * 1000.0) + " us per frame\n";
+
+	DEBUG_LOG(report);
+	return report;
+}
+
+std::string Benchmarks::RunDescriptorAllocatorBenchmark()
+{
+	using Allocator = Renderer::DescriptorAllocator;
+
+	std::string report = "Descriptor allocator\n";
+
+	Allocator allocator;
+	allocator.Init(DESCRIPTOR_BENCHMARK_PERSISTENT_COUNT, DESCRIPTOR_BENCHMARK_TRANSIENT_COUNT, DESCRIPTOR_BENCHMARK_FRAMES_IN_FLIGHT);
+
+	struct LiveRange
+	{
+		uint32_t Index = 0;
+		uint32_t Count = 0;
+	};
+
+	std::vector<LiveRange> liveRanges;
+	std::mt19937 generator(0);
+	std::uniform_int_distribution<uint32_t> countDistribution(1, DESCRIPTOR_BENCHMARK_MAX_RANGE);
+
+	uint64_t serial = 0;
+	uint32_t operationCount = 0;
+
+	// Fill half the heap with persistent ranges, then churn it frame by frame as a streaming scene would
+	auto start = BenchmarkClock::now();
+	auto allocate = [&]()
+	{
+		const uint32_t count = countDistribution(generator);
+		const uint32_t index = allocator.AllocatePersistent(count);
+		++operationCount;
+		if (index != Allocator::InvalidIndex)
+		{
+			liveRanges.push_back({ index, count });
+		}
+	};
+
+	while (allocator.GetStatistics().PersistentAllocatedCount < DESCRIPTOR_BENCHMARK_PERSISTENT_COUNT / 2)
+	{
+		allocate();
+	}
+
+	for (uint32_t frame = 0; frame < DESCRIPTOR_BENCHMARK_FRAME_COUNT; ++frame)
+	{
+		// Frames complete in order, the one started frames in flight ago has finished
+		++serial;
+		const uint64_t completedSerial = serial > DESCRIPTOR_BENCHMARK_FRAMES_IN_FLIGHT ? serial - DESCRIPTOR_BENCHMARK_FRAMES_IN_FLIGHT : 0;
+		allocator.BeginFrame(static_cast<uint32_t>(serial % DESCRIPTOR_BENCHMARK_FRAMES_IN_FLIGHT), completedSerial);
+
+		for (uint32_t i = 0; i < DESCRIPTOR_BENCHMARK_CHURN_PER_FRAME && !liveRanges.empty(); ++i)
+		{
+			const size_t victim = std::uniform_int_distribution<size_t>(0, liveRanges.size() - 1)(generator);
+			const auto range = liveRanges[victim];
+			liveRanges[victim] = liveRanges.back();
+			liveRanges.pop_back();
+
+			allocator.FreePersistent(range.Index, range.Count, serial);
+			++operationCount;
+		}
+
+		for (uint32_t i = 0; i < DESCRIPTOR_BENCHMARK_CHURN_PER_FRAME; ++i)
+		{
+			allocate();
+		}
+	}
+	const auto churnElapsedMs = ElapsedMilliseconds(start);
+	const auto churnStatistics = allocator.GetStatistics();
+
+	// Transient tables allocated from every thread at once, more than fit in the frame's range
+	allocator.BeginFrame(1, serial);
+	constexpr uint32_t transientTableSize = 4;
+	constexpr uint32_t transientAllocationCount = DESCRIPTOR_BENCHMARK_TRANSIENT_COUNT / transientTableSize + 16;
+	std::atomic<uint32_t> transientFailures = 0;
+	start = BenchmarkClock::now();
+	TaskSystem::ParallelFor(transientAllocationCount, 64, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				if (allocator.AllocateTransient(transientTableSize) == Allocator::InvalidIndex)
+				{
+					transientFailures.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+		});
+	const auto transientElapsedMs = ElapsedMilliseconds(start);
+
+	report += "  Persistent: " + std::to_string(operationCount) + " allocations and frees over " + std::to_string(DESCRIPTOR_BENCHMARK_FRAME_COUNT) +
+		" frames, " + std::to_string(churnElapsedMs * 1000000.0 / operationCount) + " ns each\n";
+	report += "  After churn: " + std::to_string(churnStatistics.PersistentAllocatedCount) + " live, " + std::to_string(churnStatistics.PendingFreeCount) +
+		" pending free, " + std::to_string(churnStatistics.FreeRangeCount) + " free ranges, largest " + std::to_string(churnStatistics.LargestFreeRange) + "\n";
+	report += "  Transient: " + std::to_string(transientAllocationCount) + " tables allocated across threads in " +
+		std::to_string(transientElapsedMs * 1000.0) + " us, " + std::to_string(transientFailures.load()) + " past the frame's range\n";
+
+	DEBUG_LOG(report);
+	return report;
+}
+
+std::string Benchmarks::RunGpuMemoryAllocatorBenchmark()
+{
+	using Allocator = Renderer::TlsfAllocator;
+
+	std::string report = "GPU memory sub-allocator\n";
+
+	// One in four requests is aligned as a placed texture, the rest as buffers
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> sizeLog2Distribution(static_cast<float>(GPU_MEMORY_BENCHMARK_MIN_SIZE_LOG2),
+		static_cast<float>(GPU_MEMORY_BENCHMARK_MAX_SIZE_LOG2));
+	std::uniform_int_distribution<uint32_t> textureDistribution(0, 3);
+	std::vector<GpuMemoryRequest> requests(GPU_MEMORY_BENCHMARK_FILL_COUNT + GPU_MEMORY_BENCHMARK_CHURN_COUNT);
+	for (auto& request : requests)
+	{
+		request.Size = static_cast<uint64_t>(std::exp2(sizeLog2Distribution(generator)));
+		request.Alignment = textureDistribution(generator) == 0 ? 64 * 1024 : Allocator::DefaultGranularity;
+		request.Victim = static_cast<uint32_t>(generator());
+	}
+	const uint32_t operationCount = GPU_MEMORY_BENCHMARK_FILL_COUNT + GPU_MEMORY_BENCHMARK_CHURN_COUNT * 2;
+
+	Allocator allocator;
+	auto allocateBlock = [&allocator](const uint64_t size, const uint64_t alignment, GpuMemoryLiveAllocation& outAllocation)
+	{
+		Renderer::TlsfAllocation allocation;
+		if (!allocator.Allocate(size, alignment, allocation))
+		{
+			return false;
+		}
+		outAllocation = { allocation.Offset, allocation.Size, allocation.Block };
+		return true;
+	};
+	auto freeBlock = [&allocator](const GpuMemoryLiveAllocation& allocation) { allocator.Free(allocation.Block); };
+
+	// Timed runs of the sub-allocator and of a first fit free list over the same requests
+	allocator.Init(GPU_MEMORY_BENCHMARK_CAPACITY);
+	Renderer::TlsfStatistics churnStatistics;
+	uint32_t tlsfFailures = 0;
+	const double tlsfElapsedMs = RunGpuMemoryChurn(requests, allocateBlock, freeBlock,
+		[&]() { churnStatistics = allocator.GetStatistics(); }, tlsfFailures);
+
+	FirstFitAllocator firstFit(GPU_MEMORY_BENCHMARK_CAPACITY);
+	float firstFitFragmentation = 0.0f;
+	uint32_t firstFitFailures = 0;
+	const double firstFitElapsedMs = RunGpuMemoryChurn(requests,
+		[&firstFit](const uint64_t size, const uint64_t alignment, GpuMemoryLiveAllocation& outAllocation)
+		{
+			return firstFit.Allocate(size, alignment, outAllocation);
+		},
+		[&firstFit](const GpuMemoryLiveAllocation& allocation) { firstFit.Free(allocation); },
+		[&]() { firstFitFragmentation = firstFit.GetFragmentation(); }, firstFitFailures);
+
+	constexpr double megabyte = 1024.0 * 1024.0;
+	report += "  Sub-allocator: " + std::to_string(operationCount) + " allocations and frees, " +
+		std::to_string(tlsfElapsedMs * 1000000.0 / operationCount) + " ns each, " + std::to_string(tlsfFailures) + " failed\n";
+	report += "  First fit free list: " + std::to_string(firstFitElapsedMs * 1000000.0 / operationCount) + " ns each, " +
+		std::to_string(firstFitFailures) + " failed\n";
+	report += "  After churn: " + std::to_string(churnStatistics.UsedBytes / megabyte) + " of " + std::to_string(churnStatistics.Capacity / megabyte) +
+		" MB used by " + std::to_string(churnStatistics.AllocationCount) + " allocations, " + std::to_string(churnStatistics.FreeBlockCount) +
+		" free blocks, largest " + std::to_string(churnStatistics.LargestFreeBlock / megabyte) + " MB\n";
+	report += "  Fragmentation: " + std::to_string(churnStatistics.Fragmentation * 100.0f) + "%, first fit " +
+		std::to_string(firstFitFragmentation * 100.0f) + "%\n";
+
+	DEBUG_LOG(report);
+	return report;
+}
+
+std::string Benchmarks::RunShaderCacheBenchmark()
+{
+	std::string report = "Shader cache\n";
+
+	// A shader including files from its own directory and a subdirectory, one of them twice, with includes hidden in comments and strings
+	std::error_code error;
+	const auto directory = std::filesystem::temp_directory_path(error) / "cctp_shader_cache_benchmark";
+	std::filesystem::remove_all(directory, error);
+	const std::string commonSource = "#ifndef COMMON_HLSL\n#define COMMON_HLSL\n#include \"Octahedral.hlsl\"\nstatic const float PI = 3.14159265f;\n#endif\n";
+	const std::string brdfSource = "float Lambert(float nDotL) { return nDotL / PI; }\n";
+	const std::string mainSource =
+		"#include \"Common.hlsl\"\n"
+		"// #include \"Missing.hlsl\"\n"
+		"/* #include \"Missing.hlsl\"\n*/ #include <Lib/Lighting.hlsl>\n"
+		"static const char* Text = \"#include \\\"Missing.hlsl\\\"\";\n"
+		"[shader(\"raygeneration\")] void RayGen() {}\n";
+	bool written = WriteShaderSource(directory / "Main.hlsl", mainSource) &&
+		WriteShaderSource(directory / "Common.hlsl", commonSource) &&
+		WriteShaderSource(directory / "Octahedral.hlsl", "float2 OctWrap(float2 v) { return v; }\n") &&
+		WriteShaderSource(directory / "Lib" / "Lighting.hlsl", "#include \"../Common.hlsl\"\n  #  include \"Brdf.hlsl\"\n") &&
+		WriteShaderSource(directory / "Lib" / "Brdf.hlsl", brdfSource);
+	if (error || !written)
+	{
+		report += "Failed to write benchmark shaders\n";
+		DEBUG_LOG(report);
+		return report;
+	}
+
+	const auto root = directory.generic_string() + "/";
+	std::vector<std::string> dependencies;
+	std::vector<std::string> unresolvedIncludes;
+	Renderer::ShaderCache::ScanDependencies(root + "Main.hlsl", dependencies, unresolvedIncludes);
+
+	constexpr uint64_t compilerKey = 1;
+	const Renderer::ShaderCache::ShaderCompileDesc desc = { root + "Main.hlsl", "", "lib_6_3", {} };
+	uint64_t key = 0;
+	Renderer::ShaderCache::CalculateShaderKey(desc, compilerKey, key);
+
+	// Bytecode stands in for a compiled library
+	std::mt19937 random(7);
+	std::vector<uint8_t> bytecode(SHADER_CACHE_BENCHMARK_BYTECODE_SIZE);
+	for (auto& byte : bytecode)
+	{
+		byte = static_cast<uint8_t>(random());
+	}
+
+	const auto cacheFilepath = (directory / "Cache" / Renderer::ShaderCache::GetShaderCacheName(key)).string();
+	std::vector<uint8_t> readBytecode;
+	if (!Renderer::ShaderCache::WriteCacheFile(cacheFilepath, key, bytecode.data(), bytecode.size()))
+	{
+		std::filesystem::remove_all(directory, error);
+		report += "Failed to write benchmark cache file\n";
+		DEBUG_LOG(report);
+		return report;
+	}
+
+	// A warm start costs a key and a cache read for each shader
+	auto start = BenchmarkClock::now();
+	for (uint32_t i = 0; i < SHADER_CACHE_BENCHMARK_ITERATION_COUNT; ++i)
+	{
+		Renderer::ShaderCache::CalculateShaderKey(desc, compilerKey, key);
+	}
+	auto keyElapsedMs = ElapsedMilliseconds(start);
+
+	start = BenchmarkClock::now();
+	for (uint32_t i = 0; i < SHADER_CACHE_BENCHMARK_ITERATION_COUNT; ++i)
+	{
+		Renderer::ShaderCache::ReadCacheFile(cacheFilepath, key, readBytecode);
+	}
+	auto readElapsedMs = ElapsedMilliseconds(start);
+	std::filesystem::remove_all(directory, error);
+
+	report += "Shader with " + std::to_string(dependencies.size()) + " includes, " + std::to_string(bytecode.size() / 1024) + " KB bytecode\n";
+	report += "  Key: " + std::to_string(keyElapsedMs * 1000.0 / SHADER_CACHE_BENCHMARK_ITERATION_COUNT) + " us\n";
+	report += "  Cache read: " + std::to_string(readElapsedMs * 1000.0 / SHADER_CACHE_BENCHMARK_ITERATION_COUNT) + " us\n";
+
+	DEBUG_LOG(report);
+	return report;
+}
+
+std::string Benchmarks::RunShaderPermutationBenchmark()
+{
+	using Renderer::ShaderPermutations::ShaderQualityTier;
+	std::string report = "Shader permutations\n";
+
+	std::vector<std::vector<Renderer::ShaderCache::ShaderDefine>> tierDefines;
+	for (uint32_t tier = 0; tier < Renderer::ShaderPermutations::SHADER_QUALITY_TIER_COUNT; ++tier)
+	{
+		tierDefines.push_back(Renderer::ShaderPermutations::GetTierDefines(static_cast<ShaderQualityTier>(tier)));
+	}
+
+	// A shader including the generated header, compiled once for each tier
+	std::error_code error;
+	const auto directory = std::filesystem::temp_directory_path(error) / "cctp_shader_permutation_benchmark";
+	std::filesystem::remove_all(directory, error);
+	bool headerUpdated = false;
+	const bool written = WriteShaderSource(directory / "Main.hlsl",
+		"#include \"ShaderConstants.hlsl\"\n[shader(\"raygeneration\")] void RayGen() { float rays[PROBE_RAY_COUNT]; }\n") &&
+		Renderer::ShaderPermutations::UpdateHlslHeader((directory / "ShaderConstants.hlsl").string(), headerUpdated);
+	if (error || !written)
+	{
+		report += "Failed to write benchmark shaders\n";
+		DEBUG_LOG(report);
+		return report;
+	}
+
+	const auto root = directory.generic_string() + "/";
+	std::vector<Renderer::ShaderCache::ShaderCompileDesc> descs;
+	for (uint32_t set = 0; set < SHADER_PERMUTATION_BENCHMARK_SET_COUNT; ++set)
+	{
+		for (const auto& defines : tierDefines)
+		{
+			descs.push_back({ root + "Main.hlsl", "", "lib_6_3", defines });
+		}
+	}
+
+	// Keys are calculated as the compiler does before compiling or reading the cache, serially then spread over the workers
+	constexpr uint64_t compilerKey = 1;
+	std::vector<uint64_t> keys(descs.size(), 0);
+	auto start = BenchmarkClock::now();
+	for (size_t i = 0; i < descs.size(); ++i)
+	{
+		Renderer::ShaderCache::CalculateShaderKey(descs[i], compilerKey, keys[i]);
+	}
+	auto serialElapsedMs = ElapsedMilliseconds(start);
+
+	start = BenchmarkClock::now();
+	TaskSystem::ParallelFor(descs.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				Renderer::ShaderCache::CalculateShaderKey(descs[i], compilerKey, keys[i]);
+			}
+		});
+	auto parallelElapsedMs = ElapsedMilliseconds(start);
+	std::filesystem::remove_all(directory, error);
+
+	report += std::to_string(std::size(Renderer::ShaderPermutations::SHADER_CONSTANTS)) + " constants, " +
+		std::to_string(std::size(Renderer::ShaderPermutations::SHADER_OPTIONS)) + " options, " + std::to_string(tierDefines.size()) + " tiers\n";
+	report += "Keys for " + std::to_string(descs.size()) + " permutations\n";
+	report += "  Serial: " + std::to_string(serialElapsedMs) + " ms\n";
+	report += "  Parallel: " + std::to_string(parallelElapsedMs) + " ms on " + std::to_string(TaskSystem::GetWorkerCount() + 1) + " threads (" +
+		std::to_string(SpeedupRatio(serialElapsedMs, parallelElapsedMs)) + "x)\n";
+
+	DEBUG_LOG(report);
+	return report;
+}
\ No newline at end of file
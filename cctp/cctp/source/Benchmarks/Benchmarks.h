@@ -0,0 +1,56 @@
+#pragma once
+
+// CPU benchmarks run on demand from the benchmarks menu. Each returns a printable report
+namespace Benchmarks
+{
+	// Builds level of detail chains for high resolution spheres and reports triangles simplified per second and triangles saved per level
+	std::string RunMeshSimplificationBenchmark();
+
+	// Imports every OBJ and GLB file in the models directory and reports parsing throughput. Without models, a generated high resolution
+	// sphere is written to both formats in the temp directory and imported instead
+	std::string RunMeshImportBenchmark();
+
+	// Compares regenerating the probe sphere with optimisation and levels of detail against loading it from a mesh cache file,
+	// both through a file mapping and through an intermediate read buffer
+	std::string RunMeshCacheBenchmark();
+
+	// Compares recalculating world and normal matrices per draw against the batched update of dirty transforms, and checks both agree
+	std::string RunTransformUpdateBenchmark();
+
+	// Propagates world matrices through a 100k node hierarchy, fully and with a small fraction of nodes animated per frame,
+	// and compares against recalculating every node
+	std::string RunTransformHierarchyBenchmark();
+
+	// Culls a million boxes against a camera frustum one at a time and four at a time from separate arrays, and checks both agree
+	std::string RunFrustumCullingBenchmark();
+
+	// Rasterizes two walls into a masked occlusion buffer and tests boxes scattered around them, reporting the fraction of draws culled and
+	// the time per frame. Culled boxes are checked against a per pixel reference depth buffer
+	std::string RunOcclusionCullingBenchmark();
+
+	// Builds a spatial hash grid of a million objects in bulk and one at a time, moves every object each frame, and times sphere, box and
+	// frustum queries, checking a few of them against a linear scan
+	std::string RunSpatialIndexBenchmark();
+
+	// Builds and compiles a deferred frame's render graph each frame. Reports the time taken, culled passes and memory saved by aliasing
+	std::string RunRenderGraphBenchmark();
+
+	// Records the render graph benchmark's frame with draws in every pass into a command stream, then submits it repeatedly to the null
+	// backend. Also records each pass into a stream of its own in parallel. Reports recording and validation cost per frame
+	std::string RunCommandRecordingBenchmark();
+
+	// Churns persistent descriptor ranges frame by frame with frees deferred by frames in flight, then allocates transient tables from
+	// every thread at once. Reports the cost of each operation and the state of the free list
+	std::string RunDescriptorAllocatorBenchmark();
+
+	// Fills a GPU memory range with buffer and texture sized allocations, then frees and allocates at random. Times the two level
+	// segregated fit sub-allocator against a first fit free list and compares their fragmentation
+	std::string RunGpuMemoryAllocatorBenchmark();
+
+	// Times the key and cache read a warm start costs for each shader, for a shader with includes in its own directory and a
+	// subdirectory
+	std::string RunShaderCacheBenchmark();
+
+	// Times keying a shader's permutation for each quality tier serially and spread over the workers, as shaders are compiled
+	std::string RunShaderPermutationBenchmark();
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#include "Pch.h"
+#include "Hash.h"
+
+uint64_t Binary::HashBytes(const void* pData, const size_t size, const uint64_t seed)
+{
+	constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+	auto pBytes = static_cast<const uint8_t*>(pData);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= pBytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
\ No newline at end of file
@@ -0,0 +1,7 @@
+#pragma once
+
+namespace Binary
+{
+	// FNV-1a, used to build cache keys from source contents and settings. Chain calls by passing the previous hash as the seed
+	uint64_t HashBytes(const void* pData, const size_t size, const uint64_t seed = 0xcbf29ce484222325ull);
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+// Read only view of a whole file mapped into the address space. Pages are loaded on first access, so large files can be parsed without copying
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& filepath);
+	void Close();
+
+	const uint8_t* GetData() const { return Data; }
+	size_t GetSize() const { return Size; }
+	bool IsOpen() const { return Data != nullptr; }
+
+private:
+	HANDLE FileHandle = INVALID_HANDLE_VALUE;
+	HANDLE MappingHandle = nullptr;
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+};
\ No newline at end of file
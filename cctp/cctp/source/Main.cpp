@@ -2,13 +2,15 @@
 #include "Window/Window.h"
 #include "Events/EventSystem.h"
 #include "Renderer/Renderer.h"
-#include "Binary/Binary.h"
 #include "Math/Math.h"
 
 #include "Scene/Scenes/DemoScene.h"
+#include "Benchmarks/Benchmarks.h"
+#include "Tasks/TaskSystem.h"
 
 #include "Renderer/RootSignature.h"
 #include "Renderer/SamplerType.h"
+#include "Renderer/DXC/DXCHelper.h"
 
 #define ALIGN_TO(size, alignment) (size + (alignment - 1) & ~(alignment-1))
 
@@ -78,6 +80,12 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 
 	Window::Show(SW_MAXIMIZE);
 
+	// Init task system
+	if (!TaskSystem::Init())
+	{
+		assert(false && "Failed to initialize task system.");
+	}
+
 	// Subscribe input event handler
 	EventSystem::SubscribeToEvent<InputEvent>([](InputEvent&& event)
 		{
@@ -92,7 +100,7 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 		});
 
 	// Init renderer
-	if (!Renderer::Init(Renderer::SHADER_VISIBLE_CBV_SRV_UAV_DESCRIPTOR_COUNT))
+	if (!Renderer::Init())
 	{
 		assert(false && "Failed to initialize renderer.");
 	}
@@ -144,6 +152,13 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 		assert(false && "Failed to create graphics pipeline.");
 	}
 
+	// Create compressed vertex graphics pipeline
+	std::unique_ptr<Renderer::GraphicsPipelineBase> compressedGraphicsPipeline;
+	if (!Renderer::CreateGraphicsPipeline<Renderer::CompressedGraphicsPipeline>(swapChain.get(), compressedGraphicsPipeline))
+	{
+		assert(false && "Failed to create compressed graphics pipeline.");
+	}
+
 	// Create screen pass graphics pipeline
 	std::vector<Renderer::Vertex1Pos1UV1Norm> screenVertices(4);
 	screenVertices[0].Position = glm::vec3(-1.0f, 1.0f, 0.f);
@@ -162,7 +177,7 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 	std::vector<uint32_t> screenIndices({ 0, 1, 2, 2, 1, 3 });
 
 	std::unique_ptr<Renderer::Mesh> screenMesh;
-	Renderer::CreateStagedMesh(screenVertices, screenIndices, L"ScreenMesh", screenMesh);
+	Renderer::CreateStagedMesh(std::move(screenVertices), std::move(screenIndices), L"ScreenMesh", screenMesh);
 
 	if (!Renderer::LoadStagedMeshesOntoGPU(&screenMesh, 1))
 	{
@@ -185,160 +200,118 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 	// Create demo scene
 	auto demoScene = std::make_unique<DemoScene>();
 
+	// Draws of the shadow and scene passes, recorded and sorted once per frame
+	Renderer::DrawList drawList;
+
 	// Create raytracing pipeline
 
 	// Create raytracing resources and add descriptors to resources
+	// Ray generation descriptor table holds the scene bvh then the irradiance and visibility outputs, probe texture views are shown in ImGui
+	const uint32_t rayGenDescriptorTable = Renderer::AllocateDescriptors(3);
+	const uint32_t probeTextureDescriptors = Renderer::AllocateDescriptors(2);
+	if (rayGenDescriptorTable == Renderer::INVALID_DESCRIPTOR_INDEX || probeTextureDescriptors == Renderer::INVALID_DESCRIPTOR_INDEX)
+	{
+		assert(false && "Failed to allocate raytracing descriptors.");
+	}
+
 	// Scene bvh 
 	D3D12_SHADER_RESOURCE_VIEW_DESC sceneBVHSRVDesc = {};
 	sceneBVHSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
 	sceneBVHSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	sceneBVHSRVDesc.RaytracingAccelerationStructure.Location = demoScene->GetTlas()->GetTlasResource()->GetGPUVirtualAddress();
-	Renderer::AddSRVDescriptorToShaderVisibleHeap(nullptr, &sceneBVHSRVDesc, Renderer::SCENE_BVH_SRV_DESCRIPTOR_INDEX);
+	Renderer::AddSRVDescriptorToShaderVisibleHeap(nullptr, &sceneBVHSRVDesc, rayGenDescriptorTable);
 
 	// Create GBuffer
 	// Raytracing output texture (irradiance)
-	Microsoft::WRL::ComPtr<ID3D12Resource> raytraceOutputResource;
+	Renderer::GpuTextureAllocation raytraceOutputTexture;
 
 	auto raytraceOutputTextureResourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R11G11B10_FLOAT,
 		static_cast<UINT64>(Renderer::RAYTRACE_IRRADIANCE_OUTPUT_DIMS.x), static_cast<UINT64>(Renderer::RAYTRACE_IRRADIANCE_OUTPUT_DIMS.y));
 	raytraceOutputTextureResourceDesc.MipLevels = 1;
 	raytraceOutputTextureResourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-	auto raytraceOutputTextureHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-	if (FAILED(Renderer::GetDevice()->CreateCommittedResource(&raytraceOutputTextureHeapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&raytraceOutputTextureResourceDesc,
-		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-		nullptr,
-		IID_PPV_ARGS(&raytraceOutputResource))))
+	if (!Renderer::CreateTexture(raytraceOutputTextureResourceDesc, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, nullptr, raytraceOutputTexture))
 	{
 		assert(false && "Failed to create raytrace output texture resource.");
 	}
-	Renderer::AddUAVDescriptorToShaderVisibleHeap(raytraceOutputResource.Get(), nullptr, Renderer::RAYTRACE_IRRADIANCE_UAV_DESCRIPTOR_INDEX);
-	Renderer::AddSRVDescriptorToShaderVisibleHeap(raytraceOutputResource.Get(), nullptr, Renderer::RAYTRACE_IRRADIANCE_SRV_DESCRIPTOR_INDEX);
+	Renderer::AddUAVDescriptorToShaderVisibleHeap(raytraceOutputTexture.Resource.Get(), nullptr, rayGenDescriptorTable + 1);
+	Renderer::AddSRVDescriptorToShaderVisibleHeap(raytraceOutputTexture.Resource.Get(), nullptr, probeTextureDescriptors);
 
 	// Raytracing output 2 texture (visibility)
-	Microsoft::WRL::ComPtr<ID3D12Resource> raytraceOutput2Resource;
+	Renderer::GpuTextureAllocation raytraceOutput2Texture;
 
 	auto raytraceOutput2TextureResourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R16G16_FLOAT,
 		static_cast<UINT64>(Renderer::RAYTRACE_VISIBILITY_OUTPUT_DIMS.x), static_cast<UINT64>(Renderer::RAYTRACE_VISIBILITY_OUTPUT_DIMS.y));
 	raytraceOutput2TextureResourceDesc.MipLevels = 1;
 	raytraceOutput2TextureResourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-	auto raytraceOutput2TextureHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-	if (FAILED(Renderer::GetDevice()->CreateCommittedResource(&raytraceOutput2TextureHeapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&raytraceOutput2TextureResourceDesc,
-		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-		nullptr,
-		IID_PPV_ARGS(&raytraceOutput2Resource))))
+	if (!Renderer::CreateTexture(raytraceOutput2TextureResourceDesc, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, nullptr, raytraceOutput2Texture))
 	{
 		assert(false && "Failed to create raytrace output 2 texture resource.");
 	}
-	Renderer::AddUAVDescriptorToShaderVisibleHeap(raytraceOutput2Resource.Get(), nullptr, Renderer::RAYTRACE_VISIBILITY_UAV_DESCRIPTOR_INDEX);
-	Renderer::AddSRVDescriptorToShaderVisibleHeap(raytraceOutput2Resource.Get(), nullptr, Renderer::RAYTRACE_VISIBILITY_SRV_DESCRIPTOR_INDEX);
-
-	// Scene texture
-	Microsoft::WRL::ComPtr<ID3D12Resource> sceneBufferResource;
-
-	auto sceneBufferDesc = CD3DX12_RESOURCE_DESC::Tex2D(swapChain->GetFormat(),
-		static_cast<UINT>(swapChain->GetViewportWidth()), static_cast<UINT>(swapChain->GetViewportHeight()));
-	sceneBufferDesc.MipLevels = 1;
-	auto sceneBufferHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-
-	if (FAILED(Renderer::GetDevice()->CreateCommittedResource(&sceneBufferHeapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&sceneBufferDesc,
-		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-		nullptr,
-		IID_PPV_ARGS(&sceneBufferResource))))
-	{
-		assert(false && "Failed to create scene buffer resource.");
-	}
-	Renderer::AddSRVDescriptorToShaderVisibleHeap(sceneBufferResource.Get(), nullptr, Renderer::SCENE_SRV_DESCRIPTOR_INDEX);
-
-	// Scene depth texture
-	Microsoft::WRL::ComPtr<ID3D12Resource> sceneDepthBufferResource;
-
-	auto sceneDepthBufferDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_FLOAT,
-		static_cast<UINT>(swapChain->GetViewportWidth()), static_cast<UINT>(swapChain->GetViewportHeight()));
-	sceneDepthBufferDesc.MipLevels = 11;
-	auto sceneDepthBufferHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-
-	if (FAILED(Renderer::GetDevice()->CreateCommittedResource(&sceneDepthBufferHeapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&sceneDepthBufferDesc,
-		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-		nullptr,
-		IID_PPV_ARGS(&sceneDepthBufferResource))))
+	Renderer::AddUAVDescriptorToShaderVisibleHeap(raytraceOutput2Texture.Resource.Get(), nullptr, rayGenDescriptorTable + 2);
+	Renderer::AddSRVDescriptorToShaderVisibleHeap(raytraceOutput2Texture.Resource.Get(), nullptr, probeTextureDescriptors + 1);
+
+	// Scene color, scene depth and shadow map are transient textures of the frame's render graph, aliased in shared heaps where their
+	// lifetimes allow. Passes render straight into them and later passes sample them, the graph transitions them in between.
+	// Transients may be recreated, so descriptor tables reading them are written each frame
+	Renderer::RenderGraph renderGraph;
+	Renderer::RenderGraphResources renderGraphResources;
+	if (!renderGraphResources.Init(Renderer::GetDevice()))
 	{
-		assert(false && "Failed to create scene depth buffer resource.");
+		assert(false && "Failed to initialize render graph resources.");
 	}
-	Renderer::AddSRVDescriptorToShaderVisibleHeap(sceneDepthBufferResource.Get(), nullptr, Renderer::SCENE_DEPTH_SRV_DESCRIPTOR_INDEX);
 
-	// Shadow map texture
-	Microsoft::WRL::ComPtr<ID3D12Resource> shadowMapBufferResource;
-
-	auto shadowMapBufferDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_FLOAT,
-		static_cast<UINT>(Renderer::SHADOW_MAP_DIMS.x), static_cast<UINT>(Renderer::SHADOW_MAP_DIMS.y));
-	auto shadowMapBufferHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-
-	if (FAILED(Renderer::GetDevice()->CreateCommittedResource(&shadowMapBufferHeapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&shadowMapBufferDesc,
-		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-		nullptr,
-		IID_PPV_ARGS(&shadowMapBufferResource))))
+	Renderer::RenderGraph::TextureDesc sceneColorDesc = {};
+	sceneColorDesc.Width = static_cast<uint32_t>(swapChain->GetViewportWidth());
+	sceneColorDesc.Height = static_cast<uint32_t>(swapChain->GetViewportHeight());
+	sceneColorDesc.Format = swapChain->GetFormat();
+	sceneColorDesc.ClearColor = Renderer::CLEAR_COLOR;
+
+	Renderer::RenderGraph::TextureDesc sceneDepthDesc = {};
+	sceneDepthDesc.Width = sceneColorDesc.Width;
+	sceneDepthDesc.Height = sceneColorDesc.Height;
+	sceneDepthDesc.Format = DXGI_FORMAT_D32_FLOAT;
+
+	Renderer::RenderGraph::TextureDesc shadowMapDesc = {};
+	shadowMapDesc.Width = static_cast<uint32_t>(Renderer::SHADOW_MAP_DIMS.x);
+	shadowMapDesc.Height = static_cast<uint32_t>(Renderer::SHADOW_MAP_DIMS.y);
+	shadowMapDesc.Format = DXGI_FORMAT_D32_FLOAT;
+
+	// Regenerate the shader constants header if the permutation description changed since it was written
+	bool shaderConstantsUpdated = false;
+	if (!Renderer::ShaderPermutations::UpdateHlslHeader(Renderer::ShaderPermutations::SHADER_CONSTANTS_HEADER_FILEPATH, shaderConstantsUpdated))
 	{
-		assert(false && "Failed to create shadow map buffer resource.");
+		DEBUG_LOG("Failed to write the shader constants header.");
 	}
-	Renderer::AddSRVDescriptorToShaderVisibleHeap(shadowMapBufferResource.Get(), nullptr, Renderer::SHADOW_MAP_SRV_DESCRIPTOR_INDEX);
-
-	// Create shadow map depth stencil target
-	Microsoft::WRL::ComPtr<ID3D12Resource> shadowMapDepthStencilBuffer;
-
-	D3D12_DEPTH_STENCIL_VIEW_DESC depthStencilDesc = {};
-	depthStencilDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	depthStencilDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
-	depthStencilDesc.Flags = D3D12_DSV_FLAG_NONE;
-
-	D3D12_CLEAR_VALUE depthOptimizedClearValue = {};
-	depthOptimizedClearValue.Format = DXGI_FORMAT_D32_FLOAT;
-	depthOptimizedClearValue.DepthStencil.Depth = 1.0f;
-	depthOptimizedClearValue.DepthStencil.Stencil = 0;
-
-	auto shadowMapDSVHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-	auto shadowMapDSVResourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, static_cast<UINT64>(Renderer::SHADOW_MAP_DIMS.x), static_cast<UINT64>(Renderer::SHADOW_MAP_DIMS.y),
-		1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
-	if (FAILED(Renderer::GetDevice()->CreateCommittedResource(&shadowMapDSVHeapProperties, D3D12_HEAP_FLAG_NONE,
-		&shadowMapDSVResourceDesc, D3D12_RESOURCE_STATE_DEPTH_WRITE,
-		&depthOptimizedClearValue,
-		IID_PPV_ARGS(&shadowMapDepthStencilBuffer)
-	)))
+	else if (shaderConstantsUpdated)
 	{
-		assert(false && "Failed to create shadow map depth stencil resource.");
+		DEBUG_LOG("Shader constants header regenerated, rebuild to compile the rasterization shaders with it.");
 	}
 
-	Renderer::GetDevice()->CreateDepthStencilView(shadowMapDepthStencilBuffer.Get(), &depthStencilDesc, swapChain->GetShadowMapDSDescriptorHandle()); // Instead of using a descriptor heap per 
-																																					  // swap chain. Create a global dsv heap 
-																																					  // that is used by all objects requiring a dsv
-
-	// Load compiled raytracing shaders
-	BinaryBuffer rayGenBuffer;
-	if (!Binary::ReadBinaryIntoBuffer("Shaders/Binary/RayGen.dxil", rayGenBuffer))
+	// Compile raytracing shader libraries in parallel, reading them from the shader cache when they and their includes are unchanged.
+	// Ray gen is compiled once for each quality tier, each permutation exported from the pipeline under its own name
+	using Renderer::ShaderPermutations::ShaderQualityTier;
+	constexpr uint32_t qualityTierCount = Renderer::ShaderPermutations::SHADER_QUALITY_TIER_COUNT;
+	constexpr size_t closestHitShaderIndex = qualityTierCount;
+	constexpr size_t missShaderIndex = qualityTierCount + 1;
+	std::array<Renderer::ShaderCache::ShaderCompileDesc, qualityTierCount + 2> raytracingShaderDescs;
+	for (uint32_t tier = 0; tier < qualityTierCount; ++tier)
 	{
-		assert(false && "Failed to read compiled ray gen shader.");
+		raytracingShaderDescs[tier] = { "Shaders/RayGen.hlsl", "", "lib_6_3",
+			Renderer::ShaderPermutations::GetTierDefines(static_cast<ShaderQualityTier>(tier)) };
 	}
+	raytracingShaderDescs[closestHitShaderIndex] = { "Shaders/ClosestHit.hlsl", "", "lib_6_3", {} };
+	raytracingShaderDescs[missShaderIndex] = { "Shaders/Miss.hlsl", "", "lib_6_3", {} };
 
-	BinaryBuffer closestHitBuffer;
-	if (!Binary::ReadBinaryIntoBuffer("Shaders/Binary/ClosestHit.dxil", closestHitBuffer))
+	std::array<std::vector<uint8_t>, raytracingShaderDescs.size()> raytracingShaderBuffers;
+	if (!DXCHelper::CompileShaders(raytracingShaderDescs.data(), raytracingShaderDescs.size(), raytracingShaderBuffers.data()))
 	{
-		assert(false && "Failed to read compiled closest hit shader.");
+		assert(false && "Failed to compile raytracing shaders.");
 	}
+	const auto& closestHitBuffer = raytracingShaderBuffers[closestHitShaderIndex];
+	const auto& missBuffer = raytracingShaderBuffers[missShaderIndex];
 
-	BinaryBuffer missBuffer;
-	if (!Binary::ReadBinaryIntoBuffer("Shaders/Binary/Miss.dxil", missBuffer))
-	{
-		assert(false && "Failed to read compiled miss shader.");
-	}
+	// No other shaders are compiled at runtime
+	DXCHelper::Shutdown();
 
 	// Create raytracing pipeline state object
 	Microsoft::WRL::ComPtr<ID3D12StateObject> raytracingPipelineStateObject;
@@ -346,18 +319,25 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 	CD3DX12_STATE_OBJECT_DESC rtpsoDesc = {};
 	rtpsoDesc.SetStateObjectType(D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE);
 
-	// Add ray gen shader
-	constexpr LPCWSTR rayGenExportName = L"RayGen";
-	CD3DX12_DXIL_LIBRARY_SUBOBJECT rayGenLibSubobject = {};
-	auto rayGenBytecode = CD3DX12_SHADER_BYTECODE(rayGenBuffer.GetBufferPointer(), rayGenBuffer.GetBufferLength());
-	rayGenLibSubobject.SetDXILLibrary(&rayGenBytecode);
-	rayGenLibSubobject.DefineExport(rayGenExportName);
-	rayGenLibSubobject.AddToStateObject(rtpsoDesc);
+	// Add ray gen shader of each quality tier, renaming the entry point so each permutation has an export of its own
+	constexpr LPCWSTR rayGenEntryPointName = L"RayGen";
+	std::array<std::wstring, qualityTierCount> rayGenExportNames;
+	std::array<CD3DX12_DXIL_LIBRARY_SUBOBJECT, qualityTierCount> rayGenLibSubobjects;
+	std::array<D3D12_SHADER_BYTECODE, qualityTierCount> rayGenBytecodes;
+	for (uint32_t tier = 0; tier < qualityTierCount; ++tier)
+	{
+		const std::string tierName = Renderer::ShaderPermutations::GetTierName(static_cast<ShaderQualityTier>(tier));
+		rayGenExportNames[tier] = rayGenEntryPointName + std::wstring(tierName.begin(), tierName.end());
+		rayGenBytecodes[tier] = CD3DX12_SHADER_BYTECODE(raytracingShaderBuffers[tier].data(), raytracingShaderBuffers[tier].size());
+		rayGenLibSubobjects[tier].SetDXILLibrary(&rayGenBytecodes[tier]);
+		rayGenLibSubobjects[tier].DefineExport(rayGenExportNames[tier].c_str(), rayGenEntryPointName);
+		rayGenLibSubobjects[tier].AddToStateObject(rtpsoDesc);
+	}
 
 	// Add miss shader
 	constexpr LPCWSTR missExportName = L"Miss";
 	CD3DX12_DXIL_LIBRARY_SUBOBJECT missLibSubobject = {};
-	auto missBytecode = CD3DX12_SHADER_BYTECODE(missBuffer.GetBufferPointer(), missBuffer.GetBufferLength());
+	auto missBytecode = CD3DX12_SHADER_BYTECODE(missBuffer.data(), missBuffer.size());
 	missLibSubobject.SetDXILLibrary(&missBytecode);
 	missLibSubobject.DefineExport(missExportName);
 	missLibSubobject.AddToStateObject(rtpsoDesc);
@@ -365,7 +345,7 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 	// Add closest hit shader
 	constexpr LPCWSTR closestHitExportName = L"ClosestHit";
 	CD3DX12_DXIL_LIBRARY_SUBOBJECT closestHitLibSubobject = {};
-	auto closestHitBytecode = CD3DX12_SHADER_BYTECODE(closestHitBuffer.GetBufferPointer(), closestHitBuffer.GetBufferLength());
+	auto closestHitBytecode = CD3DX12_SHADER_BYTECODE(closestHitBuffer.data(), closestHitBuffer.size());
 	closestHitLibSubobject.SetDXILLibrary(&closestHitBytecode);
 	closestHitLibSubobject.DefineExport(closestHitExportName);
 	closestHitLibSubobject.AddToStateObject(rtpsoDesc);
@@ -421,7 +401,10 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 
 	// Create association sub object for ray gen shader and ray gen root signature
 	CD3DX12_SUBOBJECT_TO_EXPORTS_ASSOCIATION_SUBOBJECT rayGenAssociationSubObject = {};
-	rayGenAssociationSubObject.AddExport(rayGenExportName);
+	for (const auto& rayGenExportName : rayGenExportNames)
+	{
+		rayGenAssociationSubObject.AddExport(rayGenExportName.c_str());
+	}
 	rayGenAssociationSubObject.SetSubobjectToAssociate(rayGenRootSignatureSubObject);
 	rayGenAssociationSubObject.AddToStateObject(rtpsoDesc);
 
@@ -441,12 +424,12 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 	closestHitDescriptorRanges[0].RegisterSpace = 0;
 	closestHitDescriptorRanges[0].OffsetInDescriptorsFromTableStart = 0;
 
-	// Cube vertex buffer srv
+	// Cube vertex buffer srv, after the probe textures in the frame's lighting table
 	closestHitDescriptorRanges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
 	closestHitDescriptorRanges[1].NumDescriptors = 1;
 	closestHitDescriptorRanges[1].BaseShaderRegister = 1;
 	closestHitDescriptorRanges[1].RegisterSpace = 0;
-	closestHitDescriptorRanges[1].OffsetInDescriptorsFromTableStart = 2;
+	closestHitDescriptorRanges[1].OffsetInDescriptorsFromTableStart = 3;
 
 	hitGroupRootSignature.AddRootDescriptorTableParameter(closestHitDescriptorRanges, _countof(closestHitDescriptorRanges), D3D12_SHADER_VISIBILITY_ALL);
 
@@ -497,24 +480,10 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 
 	constexpr uint32_t shaderTableSize = rayGenShaderRecordSize + ALIGN_TO(missShaderRecordSize, 64) + ALIGN_TO(hitGroupShaderRecordSize, 64);
 
-	// Create shader table GPU memory
-	Microsoft::WRL::ComPtr<ID3D12Resource> shaderTable;
-	auto shaderTableHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	auto shaderTableResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(shaderTableSize);
-	Renderer::GetDevice()->CreateCommittedResource(&shaderTableHeapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&shaderTableResourceDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&shaderTable)
-	);
-
-	// Map shader table memory
-	uint8_t* pShaderTableStart;
-	if (FAILED(shaderTable->Map(0, nullptr, reinterpret_cast<void**>(&pShaderTableStart))))
-	{
-		assert(false && "Failed to map shader table GPU memory.");
-	}
+	// Shader records are kept on the CPU, root arguments point at constants allocated each frame so the table is copied into
+	// frame upload memory with them written in before each dispatch
+	std::array<uint8_t, shaderTableSize> shaderTableRecords = {};
+	uint8_t* pShaderTableStart = shaderTableRecords.data();
 
 	// Get raytracing pipeline state object properties to query shader identifiers
 	Microsoft::WRL::ComPtr<ID3D12StateObjectProperties> raytracingPipelineStateObjectProperties;
@@ -527,14 +496,20 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 
 	// Shader record 0: Ray gen
 	// Shader identifier + descriptor table + root descriptor
-	memcpy(pShaderTableStart, 
-		raytracingPipelineStateObjectProperties->GetShaderIdentifier(rayGenExportName),
-		D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+	// The identifier selects the quality tier's permutation. Records are copied into frame memory each dispatch, so switching tiers
+	// only rewrites the identifier
+	auto SetRayGenQualityTier = [&](const ShaderQualityTier tier)
+	{
+		memcpy(pShaderTableStart,
+			raytracingPipelineStateObjectProperties->GetShaderIdentifier(rayGenExportNames[static_cast<uint32_t>(tier)].c_str()),
+			D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+	};
+	auto raytracingQualityTier = Renderer::ShaderPermutations::DEFAULT_SHADER_QUALITY_TIER;
+	SetRayGenQualityTier(raytracingQualityTier);
 	*(uint64_t*)(pShaderTableStart + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES) = 
-		(Renderer::GetShaderVisibleDescriptorHeap()->GetGPUDescriptorHandle(Renderer::RAYTRACE_IRRADIANCE_UAV_DESCRIPTOR_INDEX).ptr - 8); // This is a Pointer to the start of a descriptor range (UAV x 2) 
-																																		  // in a descriptor table
-																																		  
-	*(D3D12_GPU_VIRTUAL_ADDRESS*)(pShaderTableStart + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8) = Renderer::GetPerFrameConstantBufferGPUVirtualAddress();
+		Renderer::GetShaderVisibleDescriptorHeap()->GetGPUDescriptorHandle(rayGenDescriptorTable).ptr;
+
+	// Root descriptor (per frame constants) is written per dispatch
 
 	// Shader record 1: Miss
 	// Shader identifier
@@ -544,17 +519,11 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 
 	// Shader record 2: Hit group
 	// Shader identifier + root descriptor + root descriptor + root descriptor + descriptor table
+	// Root descriptors (material, per frame and per pass constants) and the descriptor table of the frame's lighting descriptors are written per dispatch
+	constexpr uint32_t hitGroupRootArgumentsOffset = rayGenShaderRecordSize + (missShaderRecordSize + 32) + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES;
 	memcpy(pShaderTableStart + rayGenShaderRecordSize + (missShaderRecordSize + 32), // Adding 32 bytes of padding to miss shader record for 64 byte table allignment requirement
 		raytracingPipelineStateObjectProperties->GetShaderIdentifier(hitGroupExportName),
 		D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
-	*(D3D12_GPU_VIRTUAL_ADDRESS*)(pShaderTableStart + rayGenShaderRecordSize + (missShaderRecordSize + 32) + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES) =
-		Renderer::GetMaterialConstantBufferGPUVirtualAddress();
-	*(D3D12_GPU_VIRTUAL_ADDRESS*)(pShaderTableStart + rayGenShaderRecordSize + (missShaderRecordSize + 32) + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8) =
-		Renderer::GetPerFrameConstantBufferGPUVirtualAddress();
-	*(D3D12_GPU_VIRTUAL_ADDRESS*)(pShaderTableStart + rayGenShaderRecordSize + (missShaderRecordSize + 32) + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8 + 8) =
-		Renderer::GetPerPassConstantBufferGPUVirtualAddress();
-	*(uint64_t*)(pShaderTableStart + rayGenShaderRecordSize + (missShaderRecordSize + 32) + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8 + 8 + 8) =
-		(Renderer::GetShaderVisibleDescriptorHeap()->GetGPUDescriptorHandle(Renderer::SHADOW_MAP_SRV_DESCRIPTOR_INDEX).ptr);
 
 	// Begin demo scene
 	demoScene->Begin();
@@ -596,48 +565,91 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 		static const auto& lightDirection = demoScene->GetLightDirectionWS();
 		Renderer::Commands::UpdatePerFrameConstants(probeVolume.GetProbeTransforms(), lightDirection, demoScene->GetLightIntensity(), demoScene->GetProbeVolume().GetProbeSpacing());
 
-		//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		//// Render shadow map pass
-		uint32_t passIndex = 0;
-
-		// Set pipeline
-		Renderer::Commands::SetGraphicsPipeline(shadowMapPassPipeline.get());
-
-		// Set per frame constant buffer view for pipeline
-		Renderer::Commands::SetGraphicsConstantBufferViewRootParam(1, Renderer::GetPerFrameConstantBufferGPUVirtualAddress());
-
-		// Does not set per pass constant buffer view as this data is not used by the shadow map pass
-
-		// Set viewport
-		D3D12_VIEWPORT shadowMapViewport = {};
-		shadowMapViewport.Width = Renderer::SHADOW_MAP_DIMS.x;
-		shadowMapViewport.Height = Renderer::SHADOW_MAP_DIMS.y;
-		shadowMapViewport.TopLeftX = 0.0f;
-		shadowMapViewport.TopLeftY = 0.0f;
-		shadowMapViewport.MinDepth = 0.0f;
-		shadowMapViewport.MaxDepth = 1.0f;
-
-		D3D12_RECT shadowMapScissor = {};
-		shadowMapScissor.top = 0;
-		shadowMapScissor.left = 0;
-		shadowMapScissor.right = static_cast<LONG>(Renderer::SHADOW_MAP_DIMS.x);
-		shadowMapScissor.bottom = static_cast<LONG>(Renderer::SHADOW_MAP_DIMS.y);
-
-		Renderer::Commands::SetViewport(shadowMapViewport, shadowMapScissor);
+		// Update per pass constants of the scene pass. The raytracer runs before the scene pass and also reads its camera position
+		static const auto& camera = demoScene->GetMainCamera();
+		Renderer::Commands::UpdatePerPassConstants(static_cast<uint32_t>(DemoScene::DrawPass::Camera), glm::vec2(pSwapChain->GetViewportWidth(), pSwapChain->GetViewportHeight()), camera);
 
-		// Set only depth target
-		Renderer::Commands::SetBackBufferRenderTargets(pSwapChain, true, pSwapChain->GetShadowMapDSDescriptorHandle());
+		// Update material constants
+		static const auto* pMaterials = demoScene->GetMaterialsPtr();
+		Renderer::Commands::UpdateMaterialConstants(pMaterials, static_cast<uint32_t>(demoScene->GetMaterialCount()));
+		// Do not set any graphics root constant buffer view here yet as the material buffer is not used by the rasterizer, only the raytracer
 
-		// Clear only depth target
-		Renderer::Commands::ClearRenderTargets(pSwapChain, true, pSwapChain->GetShadowMapDSDescriptorHandle());
+		// Build the visible sets of the shadow and scene passes
+		demoScene->Cull(glm::vec2(pSwapChain->GetViewportWidth(), pSwapChain->GetViewportHeight()));
 
-		// Submit draw calls
-		// Draw scene into shadow map
-		demoScene->SetDrawProbes(false);
-		demoScene->Draw(0);
+		// Record draws of the shadow and scene passes
+		static bool visualizeProbeVolume = false;
+		drawList.Clear();
+		demoScene->SetDrawPass(DemoScene::DrawPass::Shadow);
+		demoScene->Draw(drawList, shadowMapPassPipeline.get());
+		demoScene->SetDrawPass(DemoScene::DrawPass::Camera);
+		demoScene->Draw(drawList, graphicsPipeline.get());
+		demoScene->SetDrawProbes(visualizeProbeVolume);
+		if (visualizeProbeVolume)
+		{
+			// Probe spheres use compressed vertices
+			demoScene->DrawProbeSpheres(drawList, compressedGraphicsPipeline.get(), glm::vec2(pSwapChain->GetViewportWidth(), pSwapChain->GetViewportHeight()));
+		}
+		drawList.Sort();
+
+		// Build the frame's render graph. Passes declare the textures they read and write, compiling culls passes whose results are unused,
+		// places transients in shared heaps and derives the barriers between passes. Passes run when the graph executes, within this frame
+		renderGraph.Reset();
+
+		const auto backBufferIndex = pSwapChain->GetCurrentBackBufferIndex();
+		const auto backBuffer = renderGraph.ImportTexture("Back buffer", pSwapChain->GetBackBuffers()[backBufferIndex].Get(),
+			Renderer::RenderGraph::AccessRenderTarget, Renderer::RenderGraph::AccessRenderTarget);
+		const auto irradianceProbes = renderGraph.ImportTexture("Irradiance probes", raytraceOutputTexture.Resource.Get(),
+			Renderer::RenderGraph::AccessPixelShaderResource, Renderer::RenderGraph::AccessPixelShaderResource);
+		const auto visibilityProbes = renderGraph.ImportTexture("Visibility probes", raytraceOutput2Texture.Resource.Get(),
+			Renderer::RenderGraph::AccessPixelShaderResource, Renderer::RenderGraph::AccessPixelShaderResource);
+		const auto shadowMap = renderGraph.CreateTexture("Shadow map", shadowMapDesc);
+		const auto sceneColor = renderGraph.CreateTexture("Scene color", sceneColorDesc);
+		const auto sceneDepth = renderGraph.CreateTexture("Scene depth", sceneDepthDesc);
+
+		// Descriptor tables reading transients, written once the graph's resources are up to date. The lighting table holds the shadow map,
+		// irradiance and visibility probes, then the cube vertices the closest hit shader reads. The screen table holds scene color, scene
+		// depth and shadow map
+		uint32_t lightingDescriptorTable = Renderer::INVALID_DESCRIPTOR_INDEX;
+		uint32_t screenDescriptorTable = Renderer::INVALID_DESCRIPTOR_INDEX;
 
-		// Copy shadow map depth buffer to shadow map buffer resource
-		Renderer::Commands::CopyDepthTargetToResource(shadowMapDepthStencilBuffer.Get(), shadowMapBufferResource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		//// Render shadow map pass
+		const auto shadowMapPass = renderGraph.AddPass("Shadow map", [&]()
+			{
+				// Pipeline is bound by the draw list, which then sets the per frame constant buffer view
+				// Does not set per pass constant buffer view as this data is not used by the shadow map pass
+
+				// Set viewport
+				D3D12_VIEWPORT shadowMapViewport = {};
+				shadowMapViewport.Width = Renderer::SHADOW_MAP_DIMS.x;
+				shadowMapViewport.Height = Renderer::SHADOW_MAP_DIMS.y;
+				shadowMapViewport.TopLeftX = 0.0f;
+				shadowMapViewport.TopLeftY = 0.0f;
+				shadowMapViewport.MinDepth = 0.0f;
+				shadowMapViewport.MaxDepth = 1.0f;
+
+				D3D12_RECT shadowMapScissor = {};
+				shadowMapScissor.top = 0;
+				shadowMapScissor.left = 0;
+				shadowMapScissor.right = static_cast<LONG>(Renderer::SHADOW_MAP_DIMS.x);
+				shadowMapScissor.bottom = static_cast<LONG>(Renderer::SHADOW_MAP_DIMS.y);
+
+				Renderer::Commands::SetViewport(shadowMapViewport, shadowMapScissor);
+
+				// Set and clear only depth target
+				const auto shadowMapView = renderGraphResources.GetDepthStencilView(shadowMap);
+				Renderer::Commands::SetRenderTargets(nullptr, &shadowMapView);
+				Renderer::Commands::ClearDepthStencil(shadowMapView);
+
+				// Submit draw calls
+				// Draw scene into shadow map
+				drawList.SubmitParallel(static_cast<uint32_t>(DemoScene::DrawPass::Shadow), 0, [](Renderer::GraphicsPipelineBase*)
+					{
+						Renderer::Commands::SetGraphicsConstantBufferViewRootParam(1, Renderer::GetPerFrameConstantBufferGPUVirtualAddress());
+					});
+			});
+		renderGraph.Write(shadowMapPass, shadowMap, Renderer::RenderGraph::AccessDepthWrite);
 		//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 		//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -654,99 +666,152 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 				// Store time that this gather is happening on
 				lastGIGatherTime = currentTime;
 
-				// Rebuild acceleration structures
-				Renderer::Commands::RebuildTlas(demoScene->GetTlas());
-
-				// Describe dispatch rays
-				D3D12_DISPATCH_RAYS_DESC dispatchRaysDesc = {};
-				dispatchRaysDesc.Width = 1;
-				dispatchRaysDesc.Height = 1;
-				dispatchRaysDesc.Depth = 1;
-
-				dispatchRaysDesc.RayGenerationShaderRecord.StartAddress = shaderTable->GetGPUVirtualAddress();
-				dispatchRaysDesc.RayGenerationShaderRecord.SizeInBytes = rayGenShaderRecordSize;
-
-				dispatchRaysDesc.MissShaderTable.StartAddress = shaderTable->GetGPUVirtualAddress() + rayGenShaderRecordSize;
-				dispatchRaysDesc.MissShaderTable.StrideInBytes = missShaderRecordSize;
-				dispatchRaysDesc.MissShaderTable.SizeInBytes = missShaderRecordSize;
-
-				dispatchRaysDesc.HitGroupTable.StartAddress = shaderTable->GetGPUVirtualAddress() + rayGenShaderRecordSize + ALIGN_TO(dispatchRaysDesc.MissShaderTable.SizeInBytes, 64);
-				dispatchRaysDesc.HitGroupTable.StrideInBytes = hitGroupShaderRecordSize;
-				dispatchRaysDesc.HitGroupTable.SizeInBytes = hitGroupShaderRecordSize;
-
-				// Dispatch rays
-				Renderer::Commands::Raytrace(dispatchRaysDesc, raytracingPipelineStateObject.Get(), raytraceOutputResource.Get(), raytraceOutput2Resource.Get());
+				const auto raytracePass = renderGraph.AddPass("Raytrace GI", [&]()
+					{
+						// Bring the tlas up to date with instances moved since the last gather, nothing is built when none moved
+						Renderer::Commands::SyncTlas(demoScene->GetTlas());
+
+						// Copy the shader table into frame upload memory and write root arguments pointing at this frame's constants
+						Renderer::UploadAllocation shaderTable = {};
+						if (!Renderer::AllocateFrameUploadMemory(shaderTableSize, D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT, shaderTable))
+						{
+							assert(false && "Failed to allocate shader table.");
+						}
+						memcpy(shaderTable.pCPU, shaderTableRecords.data(), shaderTableSize);
+						*(D3D12_GPU_VIRTUAL_ADDRESS*)(shaderTable.pCPU + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8) = Renderer::GetPerFrameConstantBufferGPUVirtualAddress();
+						*(D3D12_GPU_VIRTUAL_ADDRESS*)(shaderTable.pCPU + hitGroupRootArgumentsOffset) = Renderer::GetMaterialConstantBufferGPUVirtualAddress();
+						*(D3D12_GPU_VIRTUAL_ADDRESS*)(shaderTable.pCPU + hitGroupRootArgumentsOffset + 8) = Renderer::GetPerFrameConstantBufferGPUVirtualAddress();
+						*(D3D12_GPU_VIRTUAL_ADDRESS*)(shaderTable.pCPU + hitGroupRootArgumentsOffset + 8 + 8) =
+							Renderer::GetPerPassConstantBufferGPUVirtualAddress(static_cast<uint32_t>(DemoScene::DrawPass::Camera));
+						*(uint64_t*)(shaderTable.pCPU + hitGroupRootArgumentsOffset + 8 + 8 + 8) =
+							Renderer::GetShaderVisibleDescriptorHeap()->GetGPUDescriptorHandle(lightingDescriptorTable).ptr;
+
+						// Describe dispatch rays
+						D3D12_DISPATCH_RAYS_DESC dispatchRaysDesc = {};
+						dispatchRaysDesc.Width = 1;
+						dispatchRaysDesc.Height = 1;
+						dispatchRaysDesc.Depth = 1;
+
+						dispatchRaysDesc.RayGenerationShaderRecord.StartAddress = shaderTable.GPUAddress;
+						dispatchRaysDesc.RayGenerationShaderRecord.SizeInBytes = rayGenShaderRecordSize;
+
+						dispatchRaysDesc.MissShaderTable.StartAddress = shaderTable.GPUAddress + rayGenShaderRecordSize;
+						dispatchRaysDesc.MissShaderTable.StrideInBytes = missShaderRecordSize;
+						dispatchRaysDesc.MissShaderTable.SizeInBytes = missShaderRecordSize;
+
+						dispatchRaysDesc.HitGroupTable.StartAddress = shaderTable.GPUAddress + rayGenShaderRecordSize + ALIGN_TO(dispatchRaysDesc.MissShaderTable.SizeInBytes, 64);
+						dispatchRaysDesc.HitGroupTable.StrideInBytes = hitGroupShaderRecordSize;
+						dispatchRaysDesc.HitGroupTable.SizeInBytes = hitGroupShaderRecordSize;
+
+						// Dispatch rays
+						Renderer::Commands::Raytrace(dispatchRaysDesc, raytracingPipelineStateObject.Get());
+					});
+				renderGraph.Read(raytracePass, shadowMap, Renderer::RenderGraph::AccessNonPixelShaderResource);
+				renderGraph.Write(raytracePass, irradianceProbes, Renderer::RenderGraph::AccessUnorderedAccess);
+				renderGraph.Write(raytracePass, visibilityProbes, Renderer::RenderGraph::AccessUnorderedAccess);
 			}
 		}
 		//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
 		//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		// Render scene color and depth pass applying direct lighting and diffuse GI
-		++passIndex;
-
-		// Update per pass constants
-		static const auto& camera = demoScene->GetMainCamera();
-		Renderer::Commands::UpdatePerPassConstants(passIndex, glm::vec2(pSwapChain->GetViewportWidth(), pSwapChain->GetViewportHeight()), camera);
-
-		// Set graphics pipeline
-		Renderer::Commands::SetGraphicsPipeline(graphicsPipeline.get());
-
-		// Set per frame constant buffer view for pipeline
-		Renderer::Commands::SetGraphicsConstantBufferViewRootParam(1, Renderer::GetPerFrameConstantBufferGPUVirtualAddress());
-
-		// Set per pass constant buffer view for pipeline
-		Renderer::Commands::SetGraphicsConstantBufferViewRootParam(2,
-			Renderer::GetPerPassConstantBufferGPUVirtualAddress() + (Renderer::GetConstantBufferAllignmentSize() * passIndex));
-
-		// Set descriptor table pointer for pipeline
-		Renderer::Commands::SetGraphicsDescriptorTableRootParam(3, Renderer::SHADOW_MAP_SRV_DESCRIPTOR_INDEX);
-
-		// Set pixel shader per frame constant buffer view for pipeline
-		Renderer::Commands::SetGraphicsConstantBufferViewRootParam(4, Renderer::GetPerFrameConstantBufferGPUVirtualAddress());
-
-		// Set viewport
-		Renderer::Commands::SetViewport(pSwapChain);
-
-		// Set render targets
-		Renderer::Commands::SetBackBufferRenderTargets(pSwapChain, false, pSwapChain->GetDSDescriptorHandle());
-
-		// Clear render targets
-		Renderer::Commands::ClearRenderTargets(pSwapChain, false, pSwapChain->GetDSDescriptorHandle());
-
-		// Update material constants
-		static const auto* pMaterials = demoScene->GetMaterialsPtr();
-		Renderer::Commands::UpdateMaterialConstants(pMaterials, static_cast<uint32_t>(demoScene->GetMaterialCount()));
-		// Do not set any graphics root constant buffer view here yet as the material buffer is not used by the rasterizer, only the raytracer
-
-		// Submit draw calls
-		// Draw scene
-		static bool visualizeProbeVolume = false;
-		demoScene->SetDrawProbes(visualizeProbeVolume);
-		demoScene->Draw(0);
-
-		// Copy backbuffer to scene color shader resource
-		Renderer::Commands::CopyRenderTargetToResource(pSwapChain, sceneBufferResource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-		// Copy depth buffer to scene depth shader resource
-		Renderer::Commands::CopyDepthTargetToResource(pSwapChain->GetDepthStencilBuffer(), sceneDepthBufferResource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		const auto scenePass = renderGraph.AddPass("Scene", [&]()
+			{
+				// Per pass constants were updated at the start of the frame
+
+				// Set viewport
+				Renderer::Commands::SetViewport(pSwapChain);
+
+				// Set and clear render targets
+				const auto sceneColorView = renderGraphResources.GetRenderTargetView(sceneColor);
+				const auto sceneDepthView = renderGraphResources.GetDepthStencilView(sceneDepth);
+				Renderer::Commands::SetRenderTargets(&sceneColorView, &sceneDepthView);
+				Renderer::Commands::ClearRenderTarget(sceneColorView);
+				Renderer::Commands::ClearDepthStencil(sceneDepthView);
+
+				// Submit draw calls
+				// Draw scene and probe spheres in parallel chunks. Root signatures differ between pipelines, so pass wide root parameters are set after each is bound
+				drawList.SubmitParallel(static_cast<uint32_t>(DemoScene::DrawPass::Camera), 0, [lightingDescriptorTable](Renderer::GraphicsPipelineBase*)
+					{
+						// Set per frame constant buffer view for pipeline
+						Renderer::Commands::SetGraphicsConstantBufferViewRootParam(1, Renderer::GetPerFrameConstantBufferGPUVirtualAddress());
+
+						// Set per pass constant buffer view for pipeline
+						Renderer::Commands::SetGraphicsConstantBufferViewRootParam(2,
+							Renderer::GetPerPassConstantBufferGPUVirtualAddress(static_cast<uint32_t>(DemoScene::DrawPass::Camera)));
+
+						// Set descriptor table pointer for pipeline
+						Renderer::Commands::SetGraphicsDescriptorTableRootParam(3, lightingDescriptorTable);
+
+						// Set pixel shader per frame constant buffer view for pipeline
+						Renderer::Commands::SetGraphicsConstantBufferViewRootParam(4, Renderer::GetPerFrameConstantBufferGPUVirtualAddress());
+					});
+			});
+		renderGraph.Write(scenePass, sceneColor, Renderer::RenderGraph::AccessRenderTarget);
+		renderGraph.Write(scenePass, sceneDepth, Renderer::RenderGraph::AccessDepthWrite);
+		renderGraph.Read(scenePass, shadowMap, Renderer::RenderGraph::AccessPixelShaderResource);
+		renderGraph.Read(scenePass, irradianceProbes, Renderer::RenderGraph::AccessPixelShaderResource);
+		renderGraph.Read(scenePass, visibilityProbes, Renderer::RenderGraph::AccessPixelShaderResource);
 
 		//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		// Render screen pass
-		++passIndex;
-
-		// Does not set per pass constant buffer view as this data is not used by the screen pass
-		// Does not set per frame constant buffer view as this data is not used by the screen pass
+		const auto screenPass = renderGraph.AddPass("Screen", [&]()
+			{
+				// Does not set per pass constant buffer view as this data is not used by the screen pass
+				// Does not set per frame constant buffer view as this data is not used by the screen pass
+
+				// Set viewport and back buffer render target
+				Renderer::Commands::SetViewport(pSwapChain);
+				const auto backBufferView = pSwapChain->GetRTDescriptorHandleForFrame(backBufferIndex);
+				Renderer::Commands::SetRenderTargets(&backBufferView, nullptr);
+
+				// Set graphics pipeline
+				Renderer::Commands::SetGraphicsPipeline(screenPassPipeline.get());
+
+				// Set descriptor table pointer for pipeline. The table holds scene color, scene depth and shadow map
+				Renderer::Commands::SetGraphicsDescriptorTableRootParam(0, screenDescriptorTable);
+
+				// Draw screen quad mesh
+				Renderer::Commands::SubmitScreenMesh(*screenMesh.get());
+			});
+		renderGraph.Read(screenPass, sceneColor, Renderer::RenderGraph::AccessPixelShaderResource);
+		renderGraph.Read(screenPass, sceneDepth, Renderer::RenderGraph::AccessPixelShaderResource);
+		renderGraph.Read(screenPass, shadowMap, Renderer::RenderGraph::AccessPixelShaderResource);
+		renderGraph.Write(screenPass, backBuffer, Renderer::RenderGraph::AccessRenderTarget);
+
+		// Compile, create transients the first time and whenever their layout changes, then record every pass
+		if (!renderGraph.Compile([&renderGraphResources](const Renderer::RenderGraph::TextureDesc& desc, const uint32_t accessMask)
+			{
+				return renderGraphResources.QueryAllocation(desc, accessMask);
+			}))
+		{
+			assert(false && "Failed to compile render graph.");
+		}
 
-		// Set graphics pipeline
-		Renderer::Commands::SetGraphicsPipeline(screenPassPipeline.get());
+		if (!renderGraphResources.Update(renderGraph))
+		{
+			assert(false && "Failed to create render graph resources.");
+		}
 
-		// Set descriptor table pointer for pipeline
-		Renderer::Commands::SetGraphicsDescriptorTableRootParam(0, Renderer::SCENE_SRV_DESCRIPTOR_INDEX);
+		lightingDescriptorTable = Renderer::AllocateFrameDescriptors(4);
+		screenDescriptorTable = Renderer::AllocateFrameDescriptors(3);
+		if (lightingDescriptorTable == Renderer::INVALID_DESCRIPTOR_INDEX || screenDescriptorTable == Renderer::INVALID_DESCRIPTOR_INDEX)
+		{
+			assert(false && "Failed to allocate frame descriptor tables.");
+		}
+		const auto& cubeMesh = *demoScene->GetMeshes()[0];
+		renderGraphResources.WriteShaderResourceView(shadowMap, lightingDescriptorTable);
+		Renderer::AddSRVDescriptorToShaderVisibleHeap(raytraceOutputTexture.Resource.Get(), nullptr, lightingDescriptorTable + 1);
+		Renderer::AddSRVDescriptorToShaderVisibleHeap(raytraceOutput2Texture.Resource.Get(), nullptr, lightingDescriptorTable + 2);
+		Renderer::AddSRVDescriptorToShaderVisibleHeap(cubeMesh.GetVertexBuffer(), &cubeMesh.GetVertexBufferSRVDesc(), lightingDescriptorTable + 3);
+		renderGraphResources.WriteShaderResourceView(sceneColor, screenDescriptorTable);
+		renderGraphResources.WriteShaderResourceView(sceneDepth, screenDescriptorTable + 1);
+		renderGraphResources.WriteShaderResourceView(shadowMap, screenDescriptorTable + 2);
 
-		// Draw screen quad mesh
-		Renderer::Commands::SubmitScreenMesh(*screenMesh.get());
+		Renderer::Commands::ExecuteRenderGraph(renderGraph, renderGraphResources);
 
 		//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		// Begin immediate mode GUI for the frame
+		// Begin immediate mode GUI for the frame. It draws over the back buffer the screen pass left bound
 		Renderer::Commands::BeginImGui();
 
 		// Submit ImGui calls
@@ -777,7 +842,7 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 			ImGui::DragFloat("Zoom", &zoom);
 			if (zoom < 1.0f) zoom = 1.0f;
 			ImGui::Image((void*)Renderer::GetShaderVisibleDescriptorHeap()->
-				GetGPUDescriptorHandle(Renderer::RAYTRACE_IRRADIANCE_SRV_DESCRIPTOR_INDEX).ptr, 
+				GetGPUDescriptorHandle(probeTextureDescriptors).ptr, 
 				ImVec2(Renderer::RAYTRACE_IRRADIANCE_OUTPUT_DIMS.x * zoom, Renderer::RAYTRACE_IRRADIANCE_OUTPUT_DIMS.y * zoom));
 			ImGui::End();
 		}
@@ -790,11 +855,21 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 			ImGui::DragFloat("Zoom", &zoom);
 			if (zoom < 1.0f) zoom = 1.0f;
 			ImGui::Image((void*)Renderer::GetShaderVisibleDescriptorHeap()->
-				GetGPUDescriptorHandle(Renderer::RAYTRACE_VISIBILITY_SRV_DESCRIPTOR_INDEX).ptr, 
+				GetGPUDescriptorHandle(probeTextureDescriptors + 1).ptr, 
 				ImVec2(Renderer::RAYTRACE_VISIBILITY_OUTPUT_DIMS.x * zoom, Renderer::RAYTRACE_VISIBILITY_OUTPUT_DIMS.y * zoom));
 			ImGui::End();
 		}
 
+		// Benchmark results
+		static std::string benchmarkReport;
+		static bool showBenchmarkReport = false;
+		if (showBenchmarkReport)
+		{
+			ImGui::Begin("Benchmark results", &showBenchmarkReport);
+			ImGui::TextUnformatted(benchmarkReport.c_str());
+			ImGui::End();
+		}
+
 		// Main menu bar
 		ImGui::BeginMainMenuBar();
 
@@ -813,6 +888,21 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 			ImGui::Separator();
 			ImGui::InputFloat("Probe update rate (s)", &GIGatherRateSeconds);
 			ImGui::Checkbox("Enable raytracing", &dispatchRays);
+			if (ImGui::BeginCombo("Probe quality", Renderer::ShaderPermutations::GetTierName(raytracingQualityTier)))
+			{
+				for (uint32_t tier = 0; tier < qualityTierCount; ++tier)
+				{
+					const auto qualityTier = static_cast<ShaderQualityTier>(tier);
+					const auto label = std::string(Renderer::ShaderPermutations::GetTierName(qualityTier)) + " (" +
+						std::to_string(Renderer::ShaderPermutations::GetOptionValue("PROBE_RAY_COUNT", qualityTier)) + " rays per probe)";
+					if (ImGui::Selectable(label.c_str(), qualityTier == raytracingQualityTier))
+					{
+						raytracingQualityTier = qualityTier;
+						SetRayGenQualityTier(raytracingQualityTier);
+					}
+				}
+				ImGui::EndCombo();
+			}
 			ImGui::Separator();
 
 			ImGui::Text("Light");
@@ -826,6 +916,7 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 			ImGui::Checkbox("Show irradiance probe texture", &showIrradianceRaytraceOutput);
 			ImGui::Checkbox("Show visibility probe texture", &showVisibilityRaytraceOutput);
 			ImGui::Checkbox("Visualize probe volume", &visualizeProbeVolume);
+			ImGui::Checkbox("Show visibility stats", &demoScene->GetShowVisibilityStatistics());
 			ImGui::DragFloat3("Probe volume position", &demoScene->GetProbeVolumePositionWS().x, 0.1f);
 			probeVolume.Update();
 			ImGui::Separator();
@@ -838,6 +929,81 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 			ImGui::EndMenu();
 		}
 
+		if (ImGui::BeginMenu("Benchmarks"))
+		{
+			if (ImGui::MenuItem("Mesh simplification"))
+			{
+				benchmarkReport = Benchmarks::RunMeshSimplificationBenchmark();
+				showBenchmarkReport = true;
+			}
+			if (ImGui::MenuItem("Mesh import"))
+			{
+				benchmarkReport = Benchmarks::RunMeshImportBenchmark();
+				showBenchmarkReport = true;
+			}
+			if (ImGui::MenuItem("Mesh cache"))
+			{
+				benchmarkReport = Benchmarks::RunMeshCacheBenchmark();
+				showBenchmarkReport = true;
+			}
+			if (ImGui::MenuItem("Transform update"))
+			{
+				benchmarkReport = Benchmarks::RunTransformUpdateBenchmark();
+				showBenchmarkReport = true;
+			}
+			if (ImGui::MenuItem("Transform hierarchy"))
+			{
+				benchmarkReport = Benchmarks::RunTransformHierarchyBenchmark();
+				showBenchmarkReport = true;
+			}
+			if (ImGui::MenuItem("Frustum culling"))
+			{
+				benchmarkReport = Benchmarks::RunFrustumCullingBenchmark();
+				showBenchmarkReport = true;
+			}
+			if (ImGui::MenuItem("Occlusion culling"))
+			{
+				benchmarkReport = Benchmarks::RunOcclusionCullingBenchmark();
+				showBenchmarkReport = true;
+			}
+			if (ImGui::MenuItem("Spatial index"))
+			{
+				benchmarkReport = Benchmarks::RunSpatialIndexBenchmark();
+				showBenchmarkReport = true;
+			}
+			if (ImGui::MenuItem("Render graph"))
+			{
+				benchmarkReport = Benchmarks::RunRenderGraphBenchmark();
+				showBenchmarkReport = true;
+			}
+			if (ImGui::MenuItem("Command recording"))
+			{
+				benchmarkReport = Benchmarks::RunCommandRecordingBenchmark();
+				showBenchmarkReport = true;
+			}
+			if (ImGui::MenuItem("Descriptor allocator"))
+			{
+				benchmarkReport = Benchmarks::RunDescriptorAllocatorBenchmark();
+				showBenchmarkReport = true;
+			}
+			if (ImGui::MenuItem("GPU memory allocator"))
+			{
+				benchmarkReport = Benchmarks::RunGpuMemoryAllocatorBenchmark();
+				showBenchmarkReport = true;
+			}
+			if (ImGui::MenuItem("Shader cache"))
+			{
+				benchmarkReport = Benchmarks::RunShaderCacheBenchmark();
+				showBenchmarkReport = true;
+			}
+			if (ImGui::MenuItem("Shader permutations"))
+			{
+				benchmarkReport = Benchmarks::RunShaderPermutationBenchmark();
+				showBenchmarkReport = true;
+			}
+			ImGui::EndMenu();
+		}
+
 		ImGui::EndMainMenuBar();
 
 		// Draw scene ImGui
@@ -862,6 +1028,12 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 		assert(false && "Failed to shutdown renderer.");
 	}
 
+	// Shutdown the task system
+	if (!TaskSystem::Shutdown())
+	{
+		assert(false && "Failed to shutdown task system.");
+	}
+
 #ifdef _DEBUG
 	ReleaseConsole();
 #endif
@@ -60,3 +60,64 @@ glm::vec3 Math::FindLookAtRotation(const glm::vec3& currentPosition, const glm::
 	return eulerRotation;
 }
 
+Math::Frustum Math::ExtractFrustum(const glm::mat4& viewProjectionMatrix)
+{
+	// Gribb and Hartmann plane extraction for a zero to one depth range
+	auto Row = [&viewProjectionMatrix](const int row)
+	{
+		return glm::vec4(viewProjectionMatrix[0][row], viewProjectionMatrix[1][row], viewProjectionMatrix[2][row], viewProjectionMatrix[3][row]);
+	};
+
+	Frustum frustum;
+	frustum.Planes[0] = Row(3) + Row(0);
+	frustum.Planes[1] = Row(3) - Row(0);
+	frustum.Planes[2] = Row(3) + Row(1);
+	frustum.Planes[3] = Row(3) - Row(1);
+	frustum.Planes[4] = Row(2);
+	frustum.Planes[5] = Row(3) - Row(2);
+
+	for (auto& plane : frustum.Planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	return frustum;
+}
+
+bool Math::IsSphereInFrustum(const Frustum& frustum, const glm::vec3& center, const float radius)
+{
+	for (const auto& plane : frustum.Planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Math::IsAABBInFrustum(const Frustum& frustum, const AABB& box)
+{
+	for (const auto& plane : frustum.Planes)
+	{
+		// Projected half extent of the box onto the plane normal
+		auto radius = glm::dot(glm::abs(glm::vec3(plane)), box.HalfExtent);
+		if (glm::dot(glm::vec3(plane), box.Center) + plane.w < -radius)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Math::AABB Math::TransformAABB(const AABB& box, const glm::mat4& matrix)
+{
+	// Arvo's method, the new half extent is the absolute rotation and scale applied to the old one
+	AABB result;
+	result.Center = glm::vec3(matrix * glm::vec4(box.Center, 1.0f));
+	auto absoluteMatrix = glm::mat3(glm::vec3(glm::abs(matrix[0])), glm::vec3(glm::abs(matrix[1])), glm::vec3(glm::abs(matrix[2])));
+	result.HalfExtent = absoluteMatrix * box.HalfExtent;
+	return result;
+}
\ No newline at end of file
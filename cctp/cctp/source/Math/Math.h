@@ -4,10 +4,28 @@ struct Transform;
 
 namespace Math
 {
+	// Planes are stored as (normal, distance) with normals pointing into the frustum. Order is left, right, bottom, top, near, far
+	struct Frustum
+	{
+		glm::vec4 Planes[6];
+	};
+
+	struct AABB
+	{
+		glm::vec3 Center = glm::vec3(0.0f);
+		glm::vec3 HalfExtent = glm::vec3(0.0f);
+	};
+
 	glm::mat4 CalculateWorldMatrix(const Transform& transform);
 	glm::mat4 CalculateViewMatrix(const glm::vec3& viewPosition, const glm::vec3& viewRotation);
 	glm::mat4 CalculatePerspectiveProjectionMatrix(const float fov, const float width, const float height, const float nearClipPlane, const float farClipPlane);
 	glm::mat4 CalculateOrthographicProjectionMatrix(const float width, const float height, const float nearClipPlane, const float farClipPlane);
 	glm::vec3 RotateVector(const glm::vec3& rotation, const glm::vec3& vector);
 	glm::vec3 FindLookAtRotation(const glm::vec3& currentPosition, const glm::vec3& targetPosition, const glm::vec3& up);
+	// Planes are in the space the matrix transforms from, pass a model view projection matrix to get object space planes
+	Frustum ExtractFrustum(const glm::mat4& viewProjectionMatrix);
+	bool IsSphereInFrustum(const Frustum& frustum, const glm::vec3& center, const float radius);
+	bool IsAABBInFrustum(const Frustum& frustum, const AABB& box);
+	// Smallest box containing the transformed box
+	AABB TransformAABB(const AABB& box, const glm::mat4& matrix);
 }
\ No newline at end of file
@@ -0,0 +1,435 @@
+#include "Pch.h"
+#include "SpatialHashGrid.h"
+#include "Tasks/TaskSystem.h"
+
+namespace
+{
+	constexpr uint32_t LARGE_OBJECT_CELL = UINT32_MAX - 1;
+	constexpr uint32_t FREE_CELL = UINT32_MAX;
+
+	// Cell coordinates are packed into 21 bits per axis
+	constexpr int32_t CELL_COORDINATE_BITS = 21;
+	constexpr int32_t CELL_COORDINATE_OFFSET = 1 << (CELL_COORDINATE_BITS - 1);
+	constexpr uint64_t CELL_COORDINATE_MASK = (1ull << CELL_COORDINATE_BITS) - 1;
+	// Sorts after every packed cell key
+	constexpr uint64_t LARGE_OBJECT_KEY = UINT64_MAX;
+
+	// Bulk builds calculate a key per object, which is too little work to split into small batches
+	constexpr size_t MIN_BUILD_BATCH_SIZE = 16384;
+
+	uint64_t PackCellKey(const glm::ivec3& coordinates)
+	{
+		assert(glm::all(glm::greaterThanEqual(coordinates, glm::ivec3(-CELL_COORDINATE_OFFSET))) &&
+			glm::all(glm::lessThan(coordinates, glm::ivec3(CELL_COORDINATE_OFFSET))) && "Spatial hash grid cell coordinates out of range.");
+		return (static_cast<uint64_t>(coordinates.x + CELL_COORDINATE_OFFSET) & CELL_COORDINATE_MASK) |
+			((static_cast<uint64_t>(coordinates.y + CELL_COORDINATE_OFFSET) & CELL_COORDINATE_MASK) << CELL_COORDINATE_BITS) |
+			((static_cast<uint64_t>(coordinates.z + CELL_COORDINATE_OFFSET) & CELL_COORDINATE_MASK) << (CELL_COORDINATE_BITS * 2));
+	}
+
+	glm::ivec3 UnpackCellKey(const uint64_t key)
+	{
+		return glm::ivec3(
+			static_cast<int32_t>(key & CELL_COORDINATE_MASK),
+			static_cast<int32_t>((key >> CELL_COORDINATE_BITS) & CELL_COORDINATE_MASK),
+			static_cast<int32_t>((key >> (CELL_COORDINATE_BITS * 2)) & CELL_COORDINATE_MASK)) - CELL_COORDINATE_OFFSET;
+	}
+
+	bool Overlaps(const Math::AABB& a, const Math::AABB& b)
+	{
+		return glm::all(glm::lessThanEqual(glm::abs(a.Center - b.Center), a.HalfExtent + b.HalfExtent));
+	}
+
+	// Point shared by three planes, each stored as (normal, distance)
+	glm::vec3 IntersectPlanes(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+	{
+		auto normalA = glm::vec3(a), normalB = glm::vec3(b), normalC = glm::vec3(c);
+		auto bc = glm::cross(normalB, normalC);
+		return -(a.w * bc + b.w * glm::cross(normalC, normalA) + c.w * glm::cross(normalA, normalB)) / glm::dot(normalA, bc);
+	}
+
+	bool OverlapsSphere(const Math::AABB& box, const glm::vec3& center, const float radius)
+	{
+		// Distance from the sphere center to the closest point of the box
+		auto offset = glm::max(glm::abs(center - box.Center) - box.HalfExtent, glm::vec3(0.0f));
+		return glm::dot(offset, offset) <= radius * radius;
+	}
+}
+
+SpatialHashGrid::SpatialHashGrid(const float cellSize)
+	: CellSize(cellSize), InverseCellSize(1.0f / cellSize)
+{
+	assert(cellSize > 0.0f && "Spatial hash grid cell size must be positive.");
+}
+
+glm::ivec3 SpatialHashGrid::CalculateCellCoordinates(const glm::vec3& position) const
+{
+	return glm::ivec3(glm::floor(position * InverseCellSize));
+}
+
+bool SpatialHashGrid::IsLargeObject(const Math::AABB& box) const
+{
+	return std::max({ box.HalfExtent.x, box.HalfExtent.y, box.HalfExtent.z }) > CellSize * 0.5f;
+}
+
+void SpatialHashGrid::Build(const Math::AABB* pBoxes, const size_t count)
+{
+	Objects.resize(count);
+	FreeHandles.clear();
+	LargeObjects.clear();
+	CellLookup.clear();
+	Cells.clear();
+	FreeCells.clear();
+	ActiveCells.clear();
+
+	std::vector<std::pair<uint64_t, uint32_t>> keys(count);
+	TaskSystem::ParallelFor(count, MIN_BUILD_BATCH_SIZE, [this, pBoxes, &keys](size_t begin, size_t end)
+		{
+			for (auto i = begin; i < end; ++i)
+			{
+				Objects[i].Box = pBoxes[i];
+				keys[i].first = IsLargeObject(pBoxes[i]) ? LARGE_OBJECT_KEY : PackCellKey(CalculateCellCoordinates(pBoxes[i].Center));
+				keys[i].second = static_cast<uint32_t>(i);
+			}
+		});
+
+	// Sort a chunk per worker, then merge neighbouring chunks in parallel until one sorted range remains
+	const auto chunkCount = std::max<size_t>(std::min<size_t>(TaskSystem::GetWorkerCount(), count / MIN_BUILD_BATCH_SIZE), 1);
+	const auto chunkSize = (count + chunkCount - 1) / chunkCount;
+	TaskSystem::ParallelFor(chunkCount, 1, [&keys, chunkSize](size_t begin, size_t end)
+		{
+			for (auto chunk = begin; chunk < end; ++chunk)
+			{
+				auto first = std::min(chunk * chunkSize, keys.size());
+				auto last = std::min(first + chunkSize, keys.size());
+				std::sort(keys.begin() + first, keys.begin() + last);
+			}
+		});
+	for (auto width = chunkSize; width < count; width *= 2)
+	{
+		const auto pairCount = (count + width * 2 - 1) / (width * 2);
+		TaskSystem::ParallelFor(pairCount, 1, [&keys, width](size_t begin, size_t end)
+			{
+				for (auto pair = begin; pair < end; ++pair)
+				{
+					auto first = pair * width * 2;
+					auto middle = std::min(first + width, keys.size());
+					auto last = std::min(first + width * 2, keys.size());
+					std::inplace_merge(keys.begin() + first, keys.begin() + middle, keys.begin() + last);
+				}
+			});
+	}
+
+	// One cell per run of equal keys. Large objects sort last
+	std::vector<size_t> runStarts;
+	for (size_t i = 0; i < count && keys[i].first != LARGE_OBJECT_KEY; ++i)
+	{
+		if (i == 0 || keys[i].first != keys[i - 1].first)
+		{
+			runStarts.push_back(i);
+		}
+	}
+	const auto cellObjectCount = runStarts.empty() ? 0 : static_cast<size_t>(std::partition_point(keys.begin(), keys.end(),
+		[](const std::pair<uint64_t, uint32_t>& key) { return key.first != LARGE_OBJECT_KEY; }) - keys.begin());
+	runStarts.push_back(cellObjectCount);
+
+	const auto cellCount = runStarts.size() - 1;
+	Cells.resize(cellCount);
+	ActiveCells.resize(cellCount);
+	CellLookup.reserve(cellCount);
+	for (uint32_t cell = 0; cell < cellCount; ++cell)
+	{
+		CellLookup.emplace(keys[runStarts[cell]].first, cell);
+	}
+
+	// Cells own separate object lists, so they are filled in parallel
+	TaskSystem::ParallelFor(cellCount, MIN_BUILD_BATCH_SIZE / 16, [this, &keys, &runStarts](size_t begin, size_t end)
+		{
+			for (auto cell = begin; cell < end; ++cell)
+			{
+				auto& cellData = Cells[cell];
+				cellData.Coordinates = UnpackCellKey(keys[runStarts[cell]].first);
+				cellData.ActiveIndex = static_cast<uint32_t>(cell);
+				cellData.Objects.resize(runStarts[cell + 1] - runStarts[cell]);
+				for (auto i = runStarts[cell]; i < runStarts[cell + 1]; ++i)
+				{
+					auto handle = keys[i].second;
+					cellData.Objects[i - runStarts[cell]] = handle;
+					Objects[handle].Cell = static_cast<uint32_t>(cell);
+					Objects[handle].IndexInCell = static_cast<uint32_t>(i - runStarts[cell]);
+				}
+				ActiveCells[cell] = static_cast<uint32_t>(cell);
+			}
+		});
+
+	for (auto i = cellObjectCount; i < count; ++i)
+	{
+		auto handle = keys[i].second;
+		Objects[handle].Cell = LARGE_OBJECT_CELL;
+		Objects[handle].IndexInCell = static_cast<uint32_t>(LargeObjects.size());
+		LargeObjects.push_back(handle);
+	}
+}
+
+uint32_t SpatialHashGrid::Insert(const Math::AABB& box)
+{
+	uint32_t handle;
+	if (FreeHandles.empty())
+	{
+		handle = static_cast<uint32_t>(Objects.size());
+		Objects.emplace_back();
+	}
+	else
+	{
+		handle = FreeHandles.back();
+		FreeHandles.pop_back();
+	}
+
+	Objects[handle].Box = box;
+	AddToCell(handle, IsLargeObject(box) ? LARGE_OBJECT_CELL : FindOrAddCell(CalculateCellCoordinates(box.Center)));
+	return handle;
+}
+
+void SpatialHashGrid::Remove(const uint32_t handle)
+{
+	assert(handle < Objects.size() && Objects[handle].Cell != FREE_CELL && "Removing an invalid spatial hash grid handle.");
+	RemoveFromCell(handle);
+	Objects[handle].Cell = FREE_CELL;
+	FreeHandles.push_back(handle);
+}
+
+void SpatialHashGrid::Move(const uint32_t handle, const Math::AABB& box)
+{
+	assert(handle < Objects.size() && Objects[handle].Cell != FREE_CELL && "Moving an invalid spatial hash grid handle.");
+	auto& object = Objects[handle];
+	object.Box = box;
+
+	if (IsLargeObject(box))
+	{
+		if (object.Cell != LARGE_OBJECT_CELL)
+		{
+			RemoveFromCell(handle);
+			AddToCell(handle, LARGE_OBJECT_CELL);
+		}
+		return;
+	}
+
+	auto coordinates = CalculateCellCoordinates(box.Center);
+	if (object.Cell != LARGE_OBJECT_CELL && Cells[object.Cell].Coordinates == coordinates)
+	{
+		return;
+	}
+
+	RemoveFromCell(handle);
+	AddToCell(handle, FindOrAddCell(coordinates));
+}
+
+uint32_t SpatialHashGrid::FindOrAddCell(const glm::ivec3& coordinates)
+{
+	auto key = PackCellKey(coordinates);
+	auto it = CellLookup.find(key);
+	if (it != CellLookup.end())
+	{
+		return it->second;
+	}
+
+	uint32_t cell;
+	if (FreeCells.empty())
+	{
+		cell = static_cast<uint32_t>(Cells.size());
+		Cells.emplace_back();
+	}
+	else
+	{
+		cell = FreeCells.back();
+		FreeCells.pop_back();
+	}
+
+	Cells[cell].Coordinates = coordinates;
+	Cells[cell].ActiveIndex = static_cast<uint32_t>(ActiveCells.size());
+	ActiveCells.push_back(cell);
+	CellLookup.emplace(key, cell);
+	return cell;
+}
+
+void SpatialHashGrid::AddToCell(const uint32_t handle, const uint32_t cell)
+{
+	auto& objects = cell == LARGE_OBJECT_CELL ? LargeObjects : Cells[cell].Objects;
+	Objects[handle].Cell = cell;
+	Objects[handle].IndexInCell = static_cast<uint32_t>(objects.size());
+	objects.push_back(handle);
+}
+
+void SpatialHashGrid::RemoveFromCell(const uint32_t handle)
+{
+	const auto cell = Objects[handle].Cell;
+	auto& objects = cell == LARGE_OBJECT_CELL ? LargeObjects : Cells[cell].Objects;
+
+	// Swap with the last object of the list so removal is constant time
+	auto last = objects.back();
+	objects[Objects[handle].IndexInCell] = last;
+	Objects[last].IndexInCell = Objects[handle].IndexInCell;
+	objects.pop_back();
+
+	if (cell == LARGE_OBJECT_CELL || !objects.empty())
+	{
+		return;
+	}
+
+	// Empty cells leave the lookup and the active list, keeping their object list memory for reuse
+	CellLookup.erase(PackCellKey(Cells[cell].Coordinates));
+	auto movedCell = ActiveCells.back();
+	ActiveCells[Cells[cell].ActiveIndex] = movedCell;
+	Cells[movedCell].ActiveIndex = Cells[cell].ActiveIndex;
+	ActiveCells.pop_back();
+	FreeCells.push_back(cell);
+}
+
+template<typename Func>
+void SpatialHashGrid::ForEachCellOverlapping(const Math::AABB& box, Func&& func) const
+{
+	// Objects in a cell extend at most half a cell past it, so cells within half a cell of the box may hold overlapping objects
+	auto minCoordinates = CalculateCellCoordinates(box.Center - box.HalfExtent - CellSize * 0.5f);
+	auto maxCoordinates = CalculateCellCoordinates(box.Center + box.HalfExtent + CellSize * 0.5f);
+	auto range = glm::u64vec3(maxCoordinates - minCoordinates + 1);
+
+	// Large queries visit the occupied cells instead of looking up every cell in range
+	if (range.x * range.y * range.z > ActiveCells.size())
+	{
+		for (auto cell : ActiveCells)
+		{
+			const auto& coordinates = Cells[cell].Coordinates;
+			if (glm::all(glm::greaterThanEqual(coordinates, minCoordinates)) && glm::all(glm::lessThanEqual(coordinates, maxCoordinates)))
+			{
+				func(Cells[cell]);
+			}
+		}
+		return;
+	}
+
+	for (auto z = minCoordinates.z; z <= maxCoordinates.z; ++z)
+	{
+		for (auto y = minCoordinates.y; y <= maxCoordinates.y; ++y)
+		{
+			for (auto x = minCoordinates.x; x <= maxCoordinates.x; ++x)
+			{
+				auto it = CellLookup.find(PackCellKey(glm::ivec3(x, y, z)));
+				if (it != CellLookup.end())
+				{
+					func(Cells[it->second]);
+				}
+			}
+		}
+	}
+}
+
+void SpatialHashGrid::QueryAABB(const Math::AABB& box, std::vector<uint32_t>& results) const
+{
+	results.clear();
+	ForEachCellOverlapping(box, [this, &box, &results](const Cell& cell)
+		{
+			for (auto handle : cell.Objects)
+			{
+				if (Overlaps(Objects[handle].Box, box))
+				{
+					results.push_back(handle);
+				}
+			}
+		});
+
+	for (auto handle : LargeObjects)
+	{
+		if (Overlaps(Objects[handle].Box, box))
+		{
+			results.push_back(handle);
+		}
+	}
+}
+
+void SpatialHashGrid::QuerySphere(const glm::vec3& center, const float radius, std::vector<uint32_t>& results) const
+{
+	results.clear();
+	Math::AABB sphereBox;
+	sphereBox.Center = center;
+	sphereBox.HalfExtent = glm::vec3(radius);
+	ForEachCellOverlapping(sphereBox, [this, &center, radius, &results](const Cell& cell)
+		{
+			for (auto handle : cell.Objects)
+			{
+				if (OverlapsSphere(Objects[handle].Box, center, radius))
+				{
+					results.push_back(handle);
+				}
+			}
+		});
+
+	for (auto handle : LargeObjects)
+	{
+		if (OverlapsSphere(Objects[handle].Box, center, radius))
+		{
+			results.push_back(handle);
+		}
+	}
+}
+
+void SpatialHashGrid::QueryFrustum(const Math::Frustum& frustum, std::vector<uint32_t>& results) const
+{
+	results.clear();
+
+	// Cells are gathered from the bounding box of the frustum corners, each corner is shared by a near or far plane and two side planes
+	auto minCorner = glm::vec3(std::numeric_limits<float>::max());
+	auto maxCorner = glm::vec3(std::numeric_limits<float>::lowest());
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		auto corner = IntersectPlanes(frustum.Planes[i & 1], frustum.Planes[2 + ((i >> 1) & 1)], frustum.Planes[4 + (i >> 2)]);
+		minCorner = glm::min(minCorner, corner);
+		maxCorner = glm::max(maxCorner, corner);
+	}
+	Math::AABB frustumBox;
+	frustumBox.Center = (minCorner + maxCorner) * 0.5f;
+	frustumBox.HalfExtent = (maxCorner - minCorner) * 0.5f;
+
+	// Loose cell bounds are a cell wide in every direction from the cell center
+	const auto looseHalfExtent = glm::vec3(CellSize);
+	ForEachCellOverlapping(frustumBox, [this, &frustum, &looseHalfExtent, &results](const Cell& cell)
+		{
+			auto looseCenter = (glm::vec3(cell.Coordinates) + 0.5f) * CellSize;
+
+			bool outside = false;
+			bool inside = true;
+			for (const auto& plane : frustum.Planes)
+			{
+				auto distance = glm::dot(glm::vec3(plane), looseCenter) + plane.w;
+				auto radius = glm::dot(glm::abs(glm::vec3(plane)), looseHalfExtent);
+				outside |= distance < -radius;
+				inside &= distance >= radius;
+			}
+
+			if (outside)
+			{
+				return;
+			}
+
+			// Cells fully inside the frustum need no per object tests
+			if (inside)
+			{
+				results.insert(results.end(), cell.Objects.begin(), cell.Objects.end());
+				return;
+			}
+
+			for (auto handle : cell.Objects)
+			{
+				if (Math::IsAABBInFrustum(frustum, Objects[handle].Box))
+				{
+					results.push_back(handle);
+				}
+			}
+		});
+
+	for (auto handle : LargeObjects)
+	{
+		if (Math::IsAABBInFrustum(frustum, Objects[handle].Box))
+		{
+			results.push_back(handle);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Math.h"
+#include <unordered_map>
+
+// Loose grid of cubic cells stored in a hash map, for finding objects near a point, box or frustum without scanning every object.
+// Objects are placed in the cell containing their center, so a cell's loose bounds extend half a cell past its edges. Objects larger
+// than half a cell are kept in a separate list that every query tests. Objects are referred to by the handle returned when added
+class SpatialHashGrid
+{
+public:
+	static constexpr uint32_t INVALID_HANDLE = UINT32_MAX;
+
+	explicit SpatialHashGrid(const float cellSize = 4.0f);
+
+	// Replaces every object, handle i refers to boxes[i]. Cell keys are calculated and sorted across the task system
+	void Build(const Math::AABB* pBoxes, const size_t count);
+	uint32_t Insert(const Math::AABB& box);
+	void Remove(const uint32_t handle);
+	// Moves within a cell only replace the stored box, moving to another cell is a constant time removal and a hash lookup
+	void Move(const uint32_t handle, const Math::AABB& box);
+
+	const Math::AABB& GetBox(const uint32_t handle) const { return Objects[handle].Box; }
+	size_t GetObjectCount() const { return Objects.size() - FreeHandles.size(); }
+	size_t GetCellCount() const { return ActiveCells.size(); }
+	size_t GetLargeObjectCount() const { return LargeObjects.size(); }
+	float GetCellSize() const { return CellSize; }
+
+	// Queries replace results with the handles of objects whose boxes intersect the query, in no particular order.
+	// Frustum queries only visit cells within the bounds of the frustum, so the frustum must have a far plane
+	void QueryFrustum(const Math::Frustum& frustum, std::vector<uint32_t>& results) const;
+	void QuerySphere(const glm::vec3& center, const float radius, std::vector<uint32_t>& results) const;
+	void QueryAABB(const Math::AABB& box, std::vector<uint32_t>& results) const;
+
+private:
+	struct Object
+	{
+		Math::AABB Box;
+		// Cell the object is in, LARGE_OBJECT_CELL for the large object list or FREE_CELL for removed handles
+		uint32_t Cell;
+		// Position of the handle in the cell's object list or the large object list
+		uint32_t IndexInCell;
+	};
+
+	struct Cell
+	{
+		glm::ivec3 Coordinates;
+		// Position of the cell in the active cell list
+		uint32_t ActiveIndex;
+		std::vector<uint32_t> Objects;
+	};
+
+	glm::ivec3 CalculateCellCoordinates(const glm::vec3& position) const;
+	bool IsLargeObject(const Math::AABB& box) const;
+	uint32_t FindOrAddCell(const glm::ivec3& coordinates);
+	void AddToCell(const uint32_t handle, const uint32_t cell);
+	void RemoveFromCell(const uint32_t handle);
+	// Calls func(cell) for every occupied cell whose loose bounds may overlap the box
+	template<typename Func>
+	void ForEachCellOverlapping(const Math::AABB& box, Func&& func) const;
+
+private:
+	float CellSize;
+	float InverseCellSize;
+
+	std::vector<Object> Objects;
+	std::vector<uint32_t> FreeHandles;
+	std::vector<uint32_t> LargeObjects;
+
+	// Cells are recycled through the free list once they become empty, so the active list holds only occupied cells
+	std::unordered_map<uint64_t, uint32_t> CellLookup;
+	std::vector<Cell> Cells;
+	std::vector<uint32_t> FreeCells;
+	std::vector<uint32_t> ActiveCells;
+};
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "Pch.h"
+#include "TransformHierarchy.h"
+#include "Tasks/TaskSystem.h"
+
+namespace
+{
+	// Two matrix multiplies per node, so small levels are cheaper to run on one thread
+	constexpr size_t MIN_PROPAGATION_BATCH_SIZE = 1024;
+}
+
+uint32_t TransformHierarchy::AddNode(const Transform& localTransform, const uint32_t parent)
+{
+	auto node = static_cast<uint32_t>(NodeParents.size());
+	assert((parent == INVALID_NODE || parent < node) && "Transform hierarchy parents must be added before their children.");
+
+	NodeParents.push_back(parent);
+	NodeDepths.push_back(parent == INVALID_NODE ? 0 : NodeDepths[parent] + 1);
+	NodeSlots.push_back(LocalTransforms.Add(localTransform));
+	Dirty.push_back(0);
+
+	// Slots are put into breadth first order on the next update
+	OrderDirty = true;
+	return node;
+}
+
+void TransformHierarchy::SetLocalPosition(const uint32_t node, const glm::vec3& position)
+{
+	LocalTransforms.SetPosition(NodeSlots[node], position);
+	MarkDirty(NodeSlots[node]);
+}
+
+void TransformHierarchy::SetLocalRotation(const uint32_t node, const glm::vec3& rotation)
+{
+	LocalTransforms.SetRotation(NodeSlots[node], rotation);
+	MarkDirty(NodeSlots[node]);
+}
+
+void TransformHierarchy::SetLocalScale(const uint32_t node, const glm::vec3& scale)
+{
+	LocalTransforms.SetScale(NodeSlots[node], scale);
+	MarkDirty(NodeSlots[node]);
+}
+
+void TransformHierarchy::SetLocalTransform(const uint32_t node, const Transform& transform)
+{
+	LocalTransforms.SetTransform(NodeSlots[node], transform);
+	MarkDirty(NodeSlots[node]);
+}
+
+void TransformHierarchy::MarkDirty(const uint32_t slot)
+{
+	if (!Dirty[slot])
+	{
+		Dirty[slot] = 1;
+		DirtySlots.push_back(slot);
+	}
+}
+
+void TransformHierarchy::SortBreadthFirst()
+{
+	const auto nodeCount = NodeParents.size();
+
+	// Children of each node, in handle order
+	std::vector<uint32_t> childStarts(nodeCount + 1, 0);
+	for (auto parent : NodeParents)
+	{
+		if (parent != INVALID_NODE)
+		{
+			++childStarts[parent + 1];
+		}
+	}
+	for (size_t i = 0; i < nodeCount; ++i)
+	{
+		childStarts[i + 1] += childStarts[i];
+	}
+	std::vector<uint32_t> children(childStarts[nodeCount]);
+	std::vector<uint32_t> childOffsets(childStarts.begin(), childStarts.end() - 1);
+	for (uint32_t node = 0; node < nodeCount; ++node)
+	{
+		if (NodeParents[node] != INVALID_NODE)
+		{
+			children[childOffsets[NodeParents[node]]++] = node;
+		}
+	}
+
+	// Roots first, then the children of each slot appended in slot order. Depth never decreases along the order
+	// and the children of a slot end up next to each other
+	std::vector<uint32_t> order;
+	order.reserve(nodeCount);
+	for (uint32_t node = 0; node < nodeCount; ++node)
+	{
+		if (NodeParents[node] == INVALID_NODE)
+		{
+			order.push_back(node);
+		}
+	}
+
+	FirstChildSlots.assign(nodeCount, 0);
+	ChildCounts.assign(nodeCount, 0);
+	for (size_t slot = 0; slot < order.size(); ++slot)
+	{
+		auto node = order[slot];
+		FirstChildSlots[slot] = static_cast<uint32_t>(order.size());
+		ChildCounts[slot] = childStarts[node + 1] - childStarts[node];
+		order.insert(order.end(), children.begin() + childStarts[node], children.begin() + childStarts[node + 1]);
+	}
+
+	// Move local transforms into their new slots
+	TransformStorage sortedLocalTransforms;
+	sortedLocalTransforms.Resize(nodeCount);
+	for (uint32_t slot = 0; slot < nodeCount; ++slot)
+	{
+		sortedLocalTransforms.SetTransform(slot, LocalTransforms.GetTransform(NodeSlots[order[slot]]));
+	}
+	LocalTransforms = std::move(sortedLocalTransforms);
+
+	SlotParents.resize(nodeCount);
+	SlotDepths.resize(nodeCount);
+	for (uint32_t slot = 0; slot < nodeCount; ++slot)
+	{
+		NodeSlots[order[slot]] = slot;
+	}
+	for (uint32_t slot = 0; slot < nodeCount; ++slot)
+	{
+		auto parent = NodeParents[order[slot]];
+		SlotParents[slot] = parent == INVALID_NODE ? INVALID_NODE : NodeSlots[parent];
+		SlotDepths[slot] = NodeDepths[order[slot]];
+	}
+
+	WorldMatrices.resize(nodeCount);
+	LevelSlots.resize(nodeCount > 0 ? SlotDepths.back() + 1 : 0);
+
+	// Every world matrix is recalculated after a reorder, marking the roots dirty reaches every node
+	std::fill(Dirty.begin(), Dirty.end(), static_cast<uint8_t>(0));
+	DirtySlots.clear();
+	for (uint32_t slot = 0; slot < nodeCount && SlotParents[slot] == INVALID_NODE; ++slot)
+	{
+		MarkDirty(slot);
+	}
+
+	OrderDirty = false;
+}
+
+size_t TransformHierarchy::UpdateWorldMatrices()
+{
+	if (OrderDirty)
+	{
+		SortBreadthFirst();
+	}
+
+	LocalTransforms.UpdateDirty();
+
+	for (auto& slots : LevelSlots)
+	{
+		slots.clear();
+	}
+	// Sorted so each level is walked in memory order
+	std::sort(DirtySlots.begin(), DirtySlots.end());
+	for (auto slot : DirtySlots)
+	{
+		LevelSlots[SlotDepths[slot]].push_back(slot);
+	}
+	DirtySlots.clear();
+
+	size_t updatedCount = 0;
+	for (size_t level = 0; level < LevelSlots.size(); ++level)
+	{
+		auto& slots = LevelSlots[level];
+		if (slots.empty())
+		{
+			continue;
+		}
+
+		// Parents are on the previous level, which is already complete, so every slot of a level can be updated in parallel
+		TaskSystem::ParallelFor(slots.size(), MIN_PROPAGATION_BATCH_SIZE, [this, &slots](size_t begin, size_t end)
+			{
+				for (auto i = begin; i < end; ++i)
+				{
+					auto slot = slots[i];
+					const auto& local = LocalTransforms.GetMatrices(slot);
+					auto parent = SlotParents[slot];
+					if (parent == INVALID_NODE)
+					{
+						WorldMatrices[slot] = local;
+						continue;
+					}
+
+					// Inverse transpose of a product is the product of the inverse transposes, so normal matrices multiply like world matrices
+					const auto& parentWorld = WorldMatrices[parent];
+					WorldMatrices[slot].WorldMatrix = parentWorld.WorldMatrix * local.WorldMatrix;
+					WorldMatrices[slot].NormalMatrix = parentWorld.NormalMatrix * local.NormalMatrix;
+				}
+			});
+
+		// Children of updated slots are updated on the next level. Slots that are already dirty were queued by MarkDirty
+		if (level + 1 < LevelSlots.size())
+		{
+			auto& nextSlots = LevelSlots[level + 1];
+			for (auto slot : slots)
+			{
+				for (auto child = FirstChildSlots[slot]; child < FirstChildSlots[slot] + ChildCounts[slot]; ++child)
+				{
+					if (!Dirty[child])
+					{
+						Dirty[child] = 1;
+						nextSlots.push_back(child);
+					}
+				}
+			}
+		}
+
+		for (auto slot : slots)
+		{
+			Dirty[slot] = 0;
+		}
+		updatedCount += slots.size();
+	}
+
+	return updatedCount;
+}
\ No newline at end of file
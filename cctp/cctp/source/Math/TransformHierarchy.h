@@ -0,0 +1,60 @@
+#pragma once
+
+#include "TransformStorage.h"
+
+// Parent and child transforms stored in breadth first order, so every depth level is a contiguous range and the children of a node
+// are contiguous in the next level. World matrices are propagated one level at a time and only through dirty subtrees.
+// Nodes are referred to by the handle returned from AddNode, which stays valid when the storage is reordered
+class TransformHierarchy
+{
+public:
+	static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+
+	// Parents must be added before their children. Adding nodes reorders the storage on the next update and makes every node dirty
+	uint32_t AddNode(const Transform& localTransform, const uint32_t parent = INVALID_NODE);
+	size_t GetNodeCount() const { return NodeParents.size(); }
+	uint32_t GetParent(const uint32_t node) const { return NodeParents[node]; }
+	uint32_t GetDepth(const uint32_t node) const { return NodeDepths[node]; }
+	size_t GetLevelCount() const { return LevelSlots.size(); }
+
+	Transform GetLocalTransform(const uint32_t node) const { return LocalTransforms.GetTransform(NodeSlots[node]); }
+	void SetLocalPosition(const uint32_t node, const glm::vec3& position);
+	// Pitch, yaw, roll rotation, expressed in degrees
+	void SetLocalRotation(const uint32_t node, const glm::vec3& rotation);
+	void SetLocalScale(const uint32_t node, const glm::vec3& scale);
+	void SetLocalTransform(const uint32_t node, const Transform& transform);
+
+	// Updates the local matrices of changed nodes, then world matrices of changed nodes and their descendants one level at a time,
+	// splitting each level across the task system. Returns the number of world matrices recalculated
+	size_t UpdateWorldMatrices();
+	const TransformMatrices& GetWorldMatrices(const uint32_t node) const
+	{
+		assert(!OrderDirty && !Dirty[NodeSlots[node]] && "World matrices are read before UpdateWorldMatrices was called.");
+		return WorldMatrices[NodeSlots[node]];
+	}
+
+private:
+	void SortBreadthFirst();
+	void MarkDirty(const uint32_t slot);
+
+private:
+	// Indexed by node handle
+	std::vector<uint32_t> NodeParents;
+	std::vector<uint32_t> NodeDepths;
+	std::vector<uint32_t> NodeSlots;
+
+	// Indexed by slot, in breadth first order
+	TransformStorage LocalTransforms;
+	std::vector<TransformMatrices> WorldMatrices;
+	std::vector<uint32_t> SlotParents;
+	std::vector<uint32_t> SlotDepths;
+	std::vector<uint32_t> FirstChildSlots;
+	std::vector<uint32_t> ChildCounts;
+	std::vector<uint8_t> Dirty;
+
+	// Slots changed since the last update
+	std::vector<uint32_t> DirtySlots;
+	// Slots to recalculate at each depth level during an update, kept between updates to reuse their memory
+	std::vector<std::vector<uint32_t>> LevelSlots;
+	bool OrderDirty = false;
+};
\ No newline at end of file
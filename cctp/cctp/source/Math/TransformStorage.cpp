@@ -0,0 +1,161 @@
+#include "Pch.h"
+#include "TransformStorage.h"
+#include <xmmintrin.h>
+
+namespace
+{
+	constexpr size_t SIMD_WIDTH = 4;
+}
+
+uint32_t TransformStorage::Add(const Transform& transform)
+{
+	auto index = static_cast<uint32_t>(Positions.size());
+	Resize(Positions.size() + 1, transform);
+	return index;
+}
+
+void TransformStorage::Resize(const size_t count, const Transform& transform)
+{
+	auto previousCount = Positions.size();
+	Positions.resize(count, transform.Position);
+	Rotations.resize(count, transform.Rotation);
+	Scales.resize(count, transform.Scale);
+	Matrices.resize(count);
+	DirtyFlags.resize(count, 0);
+
+	// Entries removed by shrinking must not be updated
+	if (count < previousCount)
+	{
+		DirtyIndices.erase(std::remove_if(DirtyIndices.begin(), DirtyIndices.end(), [count](const uint32_t index) { return index >= count; }),
+			DirtyIndices.end());
+		UpdatedIndices.erase(std::remove_if(UpdatedIndices.begin(), UpdatedIndices.end(), [count](const uint32_t index) { return index >= count; }),
+			UpdatedIndices.end());
+	}
+
+	for (auto i = previousCount; i < count; ++i)
+	{
+		MarkDirty(static_cast<uint32_t>(i));
+	}
+}
+
+void TransformStorage::SetPosition(const uint32_t index, const glm::vec3& position)
+{
+	Positions[index] = position;
+	MarkDirty(index);
+}
+
+void TransformStorage::SetRotation(const uint32_t index, const glm::vec3& rotation)
+{
+	Rotations[index] = rotation;
+	MarkDirty(index);
+}
+
+void TransformStorage::SetScale(const uint32_t index, const glm::vec3& scale)
+{
+	Scales[index] = scale;
+	MarkDirty(index);
+}
+
+void TransformStorage::SetTransform(const uint32_t index, const Transform& transform)
+{
+	Positions[index] = transform.Position;
+	Rotations[index] = transform.Rotation;
+	Scales[index] = transform.Scale;
+	MarkDirty(index);
+}
+
+void TransformStorage::MarkDirty(const uint32_t index)
+{
+	if (!DirtyFlags[index])
+	{
+		DirtyFlags[index] = 1;
+		DirtyIndices.push_back(index);
+	}
+}
+
+void TransformStorage::UpdateDirty()
+{
+	// Same result as Math::CalculateWorldMatrix, translation * rotation * scale with the rotation built from a pitch, yaw, roll quaternion.
+	// Normal matrix of a rotation and scale is the rotation with each column divided by its scale, so no general inverse is needed
+	for (size_t first = 0; first < DirtyIndices.size(); first += SIMD_WIDTH)
+	{
+		const auto laneCount = std::min(SIMD_WIDTH, DirtyIndices.size() - first);
+
+		// Gather the batch into lanes, unused lanes repeat the last entry. There is no SSE sine, so half angles are evaluated per lane
+		alignas(16) float sinX[SIMD_WIDTH], cosX[SIMD_WIDTH], sinY[SIMD_WIDTH], cosY[SIMD_WIDTH], sinZ[SIMD_WIDTH], cosZ[SIMD_WIDTH];
+		alignas(16) float scaleX[SIMD_WIDTH], scaleY[SIMD_WIDTH], scaleZ[SIMD_WIDTH];
+		for (size_t lane = 0; lane < SIMD_WIDTH; ++lane)
+		{
+			auto index = DirtyIndices[first + std::min(lane, laneCount - 1)];
+			auto halfAngles = glm::radians(Rotations[index]) * 0.5f;
+			sinX[lane] = std::sin(halfAngles.x);
+			cosX[lane] = std::cos(halfAngles.x);
+			sinY[lane] = std::sin(halfAngles.y);
+			cosY[lane] = std::cos(halfAngles.y);
+			sinZ[lane] = std::sin(halfAngles.z);
+			cosZ[lane] = std::cos(halfAngles.z);
+			scaleX[lane] = Scales[index].x;
+			scaleY[lane] = Scales[index].y;
+			scaleZ[lane] = Scales[index].z;
+		}
+
+		const auto sx = _mm_load_ps(sinX), cx = _mm_load_ps(cosX);
+		const auto sy = _mm_load_ps(sinY), cy = _mm_load_ps(cosY);
+		const auto sz = _mm_load_ps(sinZ), cz = _mm_load_ps(cosZ);
+
+		// Quaternion from euler angles
+		const auto cxcy = _mm_mul_ps(cx, cy), sxsy = _mm_mul_ps(sx, sy);
+		const auto sxcy = _mm_mul_ps(sx, cy), cxsy = _mm_mul_ps(cx, sy);
+		const auto qw = _mm_add_ps(_mm_mul_ps(cxcy, cz), _mm_mul_ps(sxsy, sz));
+		const auto qx = _mm_sub_ps(_mm_mul_ps(sxcy, cz), _mm_mul_ps(cxsy, sz));
+		const auto qy = _mm_add_ps(_mm_mul_ps(cxsy, cz), _mm_mul_ps(sxcy, sz));
+		const auto qz = _mm_sub_ps(_mm_mul_ps(cxcy, sz), _mm_mul_ps(sxsy, cz));
+
+		// Rotation matrix from the quaternion, rXY is column X row Y
+		const auto one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+		const auto xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+		const auto xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+		const auto wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+		__m128 rotation[3][3];
+		rotation[0][0] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+		rotation[0][1] = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+		rotation[0][2] = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+		rotation[1][0] = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+		rotation[1][1] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+		rotation[1][2] = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+		rotation[2][0] = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+		rotation[2][1] = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+		rotation[2][2] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+
+		const __m128 scales[3] = { _mm_load_ps(scaleX), _mm_load_ps(scaleY), _mm_load_ps(scaleZ) };
+		alignas(16) float world[3][3][SIMD_WIDTH];
+		alignas(16) float normal[3][3][SIMD_WIDTH];
+		for (size_t column = 0; column < 3; ++column)
+		{
+			for (size_t row = 0; row < 3; ++row)
+			{
+				_mm_store_ps(world[column][row], _mm_mul_ps(rotation[column][row], scales[column]));
+				_mm_store_ps(normal[column][row], _mm_div_ps(rotation[column][row], scales[column]));
+			}
+		}
+
+		// Scatter the lanes back to their entries
+		for (size_t lane = 0; lane < laneCount; ++lane)
+		{
+			auto index = DirtyIndices[first + lane];
+			auto& matrices = Matrices[index];
+			for (glm::length_t column = 0; column < 3; ++column)
+			{
+				matrices.WorldMatrix[column] = glm::vec4(world[column][0][lane], world[column][1][lane], world[column][2][lane], 0.0f);
+				matrices.NormalMatrix[column] = glm::vec4(normal[column][0][lane], normal[column][1][lane], normal[column][2][lane], 0.0f);
+			}
+			matrices.WorldMatrix[3] = glm::vec4(Positions[index], 1.0f);
+			matrices.NormalMatrix[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			DirtyFlags[index] = 0;
+		}
+	}
+
+	UpdatedIndices.swap(DirtyIndices);
+	DirtyIndices.clear();
+}
\ No newline at end of file
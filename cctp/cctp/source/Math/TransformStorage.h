@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Transform.h"
+
+// Matrices of a transform, kept together because every draw reads both
+struct TransformMatrices
+{
+	glm::mat4 WorldMatrix = glm::identity<glm::mat4>();
+	// Inverse transpose of the upper 3x3 of the world matrix, stored in a 4x4 matrix to match the instance data layout
+	glm::mat4 NormalMatrix = glm::identity<glm::mat4>();
+};
+
+// Transforms stored as separate position, rotation and scale arrays. World and normal matrices are cached per entry
+// and only recalculated for entries changed since the last UpdateDirty call
+class TransformStorage
+{
+public:
+	uint32_t Add(const Transform& transform);
+	void Resize(const size_t count, const Transform& transform = {});
+	size_t GetCount() const { return Positions.size(); }
+
+	const glm::vec3& GetPosition(const uint32_t index) const { return Positions[index]; }
+	const glm::vec3& GetRotation(const uint32_t index) const { return Rotations[index]; }
+	const glm::vec3& GetScale(const uint32_t index) const { return Scales[index]; }
+	Transform GetTransform(const uint32_t index) const { return { Positions[index], Rotations[index], Scales[index] }; }
+	const glm::vec3* GetPositionsData() const { return Positions.data(); }
+
+	void SetPosition(const uint32_t index, const glm::vec3& position);
+	// Pitch, yaw, roll rotation, expressed in degrees
+	void SetRotation(const uint32_t index, const glm::vec3& rotation);
+	void SetScale(const uint32_t index, const glm::vec3& scale);
+	void SetTransform(const uint32_t index, const Transform& transform);
+
+	// Recalculates the matrices of every dirty entry, four entries at a time with SSE
+	void UpdateDirty();
+	size_t GetDirtyCount() const { return DirtyIndices.size(); }
+	// Entries whose matrices the last UpdateDirty call recalculated, for mirroring changes into other copies of the transforms
+	const std::vector<uint32_t>& GetUpdatedIndices() const { return UpdatedIndices; }
+	const TransformMatrices& GetMatrices(const uint32_t index) const
+	{
+		assert(!DirtyFlags[index] && "Transform matrices are read before UpdateDirty was called.");
+		return Matrices[index];
+	}
+
+private:
+	void MarkDirty(const uint32_t index);
+
+private:
+	std::vector<glm::vec3> Positions;
+	std::vector<glm::vec3> Rotations;
+	std::vector<glm::vec3> Scales;
+	std::vector<TransformMatrices> Matrices;
+	std::vector<uint8_t> DirtyFlags;
+	std::vector<uint32_t> DirtyIndices;
+	std::vector<uint32_t> UpdatedIndices;
+};
\ No newline at end of file
@@ -0,0 +1,341 @@
+#include "Pch.h"
+#include "AccelerationStructureBuilder.h"
+#include "BottomLevelAccelerationStructure.h"
+#include "TopLevelAccelerationStructure.h"
+
+namespace
+{
+	using CompactedSizeDesc = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC;
+	constexpr UINT64 POSTBUILD_INFO_SIZE = sizeof(CompactedSizeDesc) * Renderer::AccelerationStructureBuilder::MaxBuildsPerBatch;
+}
+
+bool Renderer::AccelerationStructureBuilder::Init(ID3D12Device5* pDevice, GpuMemoryAllocator& memoryAllocator, UploadQueue& uploadQueue)
+{
+	this->pDevice = pDevice;
+	pMemoryAllocator = &memoryAllocator;
+	pUploadQueue = &uploadQueue;
+
+	// Builds run on a compute queue so they overlap with the frames drawn while they run
+	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COMPUTE;
+	if (FAILED(pDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&CommandQueue))))
+	{
+		DEBUG_LOG("ERROR: Failed to create acceleration structure build command queue.");
+		return false;
+	}
+
+	if (FAILED(pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&Fence))))
+	{
+		DEBUG_LOG("ERROR: Failed to create acceleration structure build fence.");
+		return false;
+	}
+	return true;
+}
+
+bool Renderer::AccelerationStructureBuilder::BuildBottomLevel(std::unique_ptr<BottomLevelAccelerationStructure>* pStructures, const size_t structureCount)
+{
+	for (size_t i = 0; i < structureCount; ++i)
+	{
+		auto* pStructure = pStructures[i].get();
+		assert(!pStructure->IsCompacted() && "A compacted blas is too small to build into.");
+		const UINT64 scratchSize = pStructure->GetScratchSize();
+		if (!ReserveBuild(scratchSize))
+		{
+			return false;
+		}
+
+		GpuBufferAllocation scratch;
+		if (!pMemoryAllocator->AllocateBuffer(GpuMemoryPool::Scratch, scratchSize, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, scratch))
+		{
+			DEBUG_LOG("ERROR: Failed to allocate blas build scratch.");
+			return false;
+		}
+
+		auto buildDesc = pStructure->GetBuildDesc();
+		buildDesc.ScratchAccelerationStructureData = scratch.GPUAddress;
+
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postbuildDesc = {};
+		postbuildDesc.DestBuffer = CurrentBatch.PostbuildInfo->GetGPUVirtualAddress() + CurrentBatch.Built.size() * sizeof(CompactedSizeDesc);
+		postbuildDesc.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE;
+		CurrentBatch.CommandList->BuildRaytracingAccelerationStructure(&buildDesc, 1, &postbuildDesc);
+
+		CurrentBatch.Scratch.push_back(scratch);
+		CurrentBatch.ScratchBytes += scratch.Size;
+		CurrentBatch.Built.push_back(pStructure);
+		++CurrentBatch.BuildCount;
+		CurrentBatch.GeometryUploads.FenceValue = std::max(CurrentBatch.GeometryUploads.FenceValue, pStructure->GetGeometryUploadTicket().FenceValue);
+
+		++Statistics.BottomLevelBuildCount;
+		Statistics.ScratchBytesInFlight += scratch.Size;
+		Statistics.PeakScratchBytes = std::max(Statistics.PeakScratchBytes, Statistics.ScratchBytesInFlight);
+	}
+	return true;
+}
+
+bool Renderer::AccelerationStructureBuilder::BuildTopLevel(std::unique_ptr<TopLevelAccelerationStructure>* pStructures, const size_t structureCount)
+{
+	for (size_t i = 0; i < structureCount; ++i)
+	{
+		if (!ReserveBuild(0))
+		{
+			return false;
+		}
+
+		// Bottom level structures the instances reference must be finished
+		if (CurrentBatch.BuildCount > 0)
+		{
+			auto barrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+			CurrentBatch.CommandList->ResourceBarrier(1, &barrier);
+		}
+
+		CurrentBatch.CommandList->BuildRaytracingAccelerationStructure(&pStructures[i]->GetBuildDesc(), 0, nullptr);
+		++CurrentBatch.BuildCount;
+		++Statistics.TopLevelBuildCount;
+	}
+	return true;
+}
+
+bool Renderer::AccelerationStructureBuilder::Submit()
+{
+	if (!BatchOpen)
+	{
+		return true;
+	}
+
+	auto& commandList = CurrentBatch.CommandList;
+	auto barrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+	commandList->ResourceBarrier(1, &barrier);
+
+	// Copy compacted sizes back for the CPU to read once the batch finishes
+	if (!CurrentBatch.Built.empty())
+	{
+		auto toCopySource = CD3DX12_RESOURCE_BARRIER::Transition(CurrentBatch.PostbuildInfo.Get(),
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+		commandList->ResourceBarrier(1, &toCopySource);
+		commandList->CopyBufferRegion(CurrentBatch.PostbuildReadback.Get(), 0, CurrentBatch.PostbuildInfo.Get(), 0,
+			CurrentBatch.Built.size() * sizeof(CompactedSizeDesc));
+		auto toUnorderedAccess = CD3DX12_RESOURCE_BARRIER::Transition(CurrentBatch.PostbuildInfo.Get(),
+			D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		commandList->ResourceBarrier(1, &toUnorderedAccess);
+	}
+
+	if (FAILED(commandList->Close()))
+	{
+		DEBUG_LOG("ERROR: Failed to close acceleration structure build command list.");
+		return false;
+	}
+
+	// Builds read the mesh buffers, the build queue waits for their uploads on the GPU
+	if (!pUploadQueue->WaitOnQueue(CommandQueue.Get(), CurrentBatch.GeometryUploads))
+	{
+		return false;
+	}
+
+	ID3D12CommandList* commandLists[] = { commandList.Get() };
+	CommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+
+	CurrentBatch.FenceValue = ++LastSubmittedFenceValue;
+	if (CurrentBatch.BuildCount > CurrentBatch.Compactions.size())
+	{
+		LastBuildFenceValue = CurrentBatch.FenceValue;
+	}
+	if (FAILED(CommandQueue->Signal(Fence.Get(), CurrentBatch.FenceValue)))
+	{
+		DEBUG_LOG("ERROR: Failed to signal acceleration structure build fence.");
+		return false;
+	}
+
+	InFlightBatches.push_back(std::move(CurrentBatch));
+	CurrentBatch = Batch();
+	BatchOpen = false;
+	++Statistics.SubmittedBatchCount;
+	return true;
+}
+
+bool Renderer::AccelerationStructureBuilder::Update()
+{
+	const UINT64 completedValue = Fence->GetCompletedValue();
+	while (!InFlightBatches.empty() && InFlightBatches.front().FenceValue <= completedValue)
+	{
+		// Retiring may submit the open batch, so the finished one leaves the queue first
+		Batch batch = std::move(InFlightBatches.front());
+		InFlightBatches.pop_front();
+
+		const bool retired = RetireBatch(batch);
+		FreeBatches.push_back(std::move(batch));
+		if (!retired)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Renderer::AccelerationStructureBuilder::Flush()
+{
+	// Finished builds record compaction copies into a new batch, so flushing repeats until nothing is left
+	while (BatchOpen || !InFlightBatches.empty())
+	{
+		if (!Submit() || !WaitForFenceValue(LastSubmittedFenceValue) || !Update())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Renderer::AccelerationStructureBuilder::WaitOnQueue(ID3D12CommandQueue* pQueue)
+{
+	if (LastBuildFenceValue <= Fence->GetCompletedValue())
+	{
+		return true;
+	}
+
+	return SUCCEEDED(pQueue->Wait(Fence.Get(), LastBuildFenceValue));
+}
+
+bool Renderer::AccelerationStructureBuilder::OpenBatch()
+{
+	if (!FreeBatches.empty())
+	{
+		CurrentBatch = std::move(FreeBatches.back());
+		FreeBatches.pop_back();
+
+		// The batch finished before it was freed, so its allocator can be reset
+		if (FAILED(CurrentBatch.Allocator->Reset()) || FAILED(CurrentBatch.CommandList->Reset(CurrentBatch.Allocator.Get(), nullptr)))
+		{
+			DEBUG_LOG("ERROR: Failed to reset acceleration structure build command list.");
+			return false;
+		}
+	}
+	else
+	{
+		if (FAILED(pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COMPUTE, IID_PPV_ARGS(&CurrentBatch.Allocator))) ||
+			FAILED(pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COMPUTE, CurrentBatch.Allocator.Get(), nullptr,
+				IID_PPV_ARGS(&CurrentBatch.CommandList))))
+		{
+			DEBUG_LOG("ERROR: Failed to create acceleration structure build command list.");
+			return false;
+		}
+
+		// Room for the compacted size of every build the batch can hold
+		auto defaultHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+		auto infoDesc = CD3DX12_RESOURCE_DESC::Buffer(POSTBUILD_INFO_SIZE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+		auto readbackHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+		auto readbackDesc = CD3DX12_RESOURCE_DESC::Buffer(POSTBUILD_INFO_SIZE);
+		if (FAILED(pDevice->CreateCommittedResource(&defaultHeapProperties, D3D12_HEAP_FLAG_NONE, &infoDesc,
+				D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&CurrentBatch.PostbuildInfo))) ||
+			FAILED(pDevice->CreateCommittedResource(&readbackHeapProperties, D3D12_HEAP_FLAG_NONE, &readbackDesc,
+				D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&CurrentBatch.PostbuildReadback))))
+		{
+			DEBUG_LOG("ERROR: Failed to create acceleration structure postbuild info buffers.");
+			return false;
+		}
+	}
+
+	CurrentBatch.GeometryUploads = UploadTicket();
+	CurrentBatch.Scratch.clear();
+	CurrentBatch.ScratchBytes = 0;
+	CurrentBatch.Built.clear();
+	CurrentBatch.Compactions.clear();
+	CurrentBatch.BuildCount = 0;
+	BatchOpen = true;
+	return true;
+}
+
+bool Renderer::AccelerationStructureBuilder::ReserveBuild(const UINT64 scratchSize)
+{
+	if (BatchOpen && (CurrentBatch.BuildCount == MaxBuildsPerBatch ||
+		(CurrentBatch.ScratchBytes > 0 && CurrentBatch.ScratchBytes + scratchSize > MaxScratchBytesPerBatch)))
+	{
+		if (!Submit())
+		{
+			return false;
+		}
+	}
+
+	return BatchOpen || OpenBatch();
+}
+
+bool Renderer::AccelerationStructureBuilder::RetireBatch(Batch& batch)
+{
+	for (auto& scratch : batch.Scratch)
+	{
+		pMemoryAllocator->Free(scratch);
+	}
+	Statistics.ScratchBytesInFlight -= batch.ScratchBytes;
+
+	// Compacted copies have finished and replace their originals, which are freed once frames using them have completed
+	if (!batch.Compactions.empty())
+	{
+		UINT64 bytesBefore = 0;
+		UINT64 bytesAfter = 0;
+		for (auto& compaction : batch.Compactions)
+		{
+			bytesBefore += compaction.pStructure->GetSize();
+			bytesAfter += compaction.Compacted.Size;
+			compaction.pStructure->ReplaceWithCompacted(compaction.Compacted);
+		}
+
+		Statistics.CompactedCount += static_cast<uint32_t>(batch.Compactions.size());
+		Statistics.PendingCompactionCount -= static_cast<uint32_t>(batch.Compactions.size());
+		Statistics.BytesBeforeCompaction += bytesBefore;
+		Statistics.BytesAfterCompaction += bytesAfter;
+		DEBUG_LOG("Compacted " + std::to_string(batch.Compactions.size()) + " blas from " + std::to_string(bytesBefore) + " to " +
+			std::to_string(bytesAfter) + " bytes, " + std::to_string(Statistics.BytesBeforeCompaction) + " to " +
+			std::to_string(Statistics.BytesAfterCompaction) + " bytes in total");
+	}
+
+	if (batch.Built.empty())
+	{
+		return true;
+	}
+
+	const D3D12_RANGE readRange(0, batch.Built.size() * sizeof(CompactedSizeDesc));
+	void* pMapped;
+	if (FAILED(batch.PostbuildReadback->Map(0, &readRange, &pMapped)))
+	{
+		DEBUG_LOG("ERROR: Failed to map acceleration structure postbuild info.");
+		return false;
+	}
+	const auto* pCompactedSizes = static_cast<const CompactedSizeDesc*>(pMapped);
+
+	// Record a copy of each structure into an allocation of its compacted size, unless compaction would not save anything
+	bool succeeded = true;
+	for (size_t i = 0; i < batch.Built.size() && succeeded; ++i)
+	{
+		auto* pStructure = batch.Built[i];
+		const UINT64 compactedSize = pCompactedSizes[i].CompactedSizeInBytes;
+		if (compactedSize == 0 || compactedSize >= pStructure->GetSize())
+		{
+			continue;
+		}
+
+		Compaction compaction;
+		compaction.pStructure = pStructure;
+		succeeded = ReserveBuild(0) && pMemoryAllocator->AllocateBuffer(GpuMemoryPool::AccelerationStructure, compactedSize,
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, compaction.Compacted);
+		if (succeeded)
+		{
+			CurrentBatch.CommandList->CopyRaytracingAccelerationStructure(compaction.Compacted.GPUAddress, pStructure->GetBlasGPUVirtualAddress(),
+				D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT);
+			CurrentBatch.Compactions.push_back(compaction);
+			++CurrentBatch.BuildCount;
+			++Statistics.PendingCompactionCount;
+		}
+	}
+
+	const D3D12_RANGE writtenRange(0, 0);
+	batch.PostbuildReadback->Unmap(0, &writtenRange);
+	if (!succeeded)
+	{
+		DEBUG_LOG("ERROR: Failed to record blas compaction.");
+	}
+	return succeeded;
+}
+
+bool Renderer::AccelerationStructureBuilder::WaitForFenceValue(const UINT64 fenceValue)
+{
+	// Without an event the call returns once the fence reaches the value
+	return Fence->GetCompletedValue() >= fenceValue || SUCCEEDED(Fence->SetEventOnCompletion(fenceValue, nullptr));
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <deque>
+
+#include "GpuMemoryAllocator.h"
+#include "UploadQueue.h"
+
+namespace Renderer
+{
+	class BottomLevelAccelerationStructure;
+	class TopLevelAccelerationStructure;
+
+	struct AccelerationStructureBuildStatistics
+	{
+		uint32_t BottomLevelBuildCount = 0;
+		uint32_t TopLevelBuildCount = 0;
+		uint32_t SubmittedBatchCount = 0;
+		// Bottom level structures replaced by their compacted copy, and those whose copy has not finished
+		uint32_t CompactedCount = 0;
+		uint32_t PendingCompactionCount = 0;
+		// Sizes of the compacted structures before and after compaction
+		UINT64 BytesBeforeCompaction = 0;
+		UINT64 BytesAfterCompaction = 0;
+		UINT64 ScratchBytesInFlight = 0;
+		UINT64 PeakScratchBytes = 0;
+	};
+
+	// Builds acceleration structures on a compute queue of its own without blocking the CPU. Builds are recorded into an open batch
+	// that is submitted as a whole, each bottom level build taking scratch from the memory allocator's scratch pool that is freed once
+	// its batch finishes. Bottom level builds also write their compacted size, and once their batch has finished each is copied into an
+	// allocation of that size in a later batch, replacing the original when the copy finishes. Batches wait on the GPU for the uploads
+	// of the geometry they read. Structures must stay alive until their builds and compaction have finished. Not thread safe
+	class AccelerationStructureBuilder
+	{
+	public:
+		// Batches are submitted early once their builds reach either limit
+		static constexpr uint32_t MaxBuildsPerBatch = 256;
+		static constexpr UINT64 MaxScratchBytesPerBatch = 64 * 1024 * 1024;
+
+		AccelerationStructureBuilder() = default;
+		AccelerationStructureBuilder(const AccelerationStructureBuilder&) = delete;
+		AccelerationStructureBuilder& operator=(const AccelerationStructureBuilder&) = delete;
+
+		// The memory allocator and upload queue must outlive the builder
+		bool Init(ID3D12Device5* pDevice, GpuMemoryAllocator& memoryAllocator, UploadQueue& uploadQueue);
+
+		bool BuildBottomLevel(std::unique_ptr<BottomLevelAccelerationStructure>* pStructures, const size_t structureCount);
+		// Top level builds are recorded after every bottom level build already in the batch has finished. Their instances must have been
+		// synced for a full build
+		bool BuildTopLevel(std::unique_ptr<TopLevelAccelerationStructure>* pStructures, const size_t structureCount);
+		// Submits the open batch, if it holds any builds
+		bool Submit();
+		// Frees the scratch of finished batches, records the compaction of structures built by them, and swaps in compacted copies
+		// that have finished. Call once per frame
+		bool Update();
+		// Submits and blocks until every build and compaction has finished
+		bool Flush();
+
+		// Makes the queue wait until every build submitted so far has finished without blocking the CPU. Compaction copies are not waited
+		// on, structures only switch to their compacted copy once it has finished
+		bool WaitOnQueue(ID3D12CommandQueue* pQueue);
+
+		const AccelerationStructureBuildStatistics& GetStatistics() const { return Statistics; }
+
+	private:
+		struct Compaction
+		{
+			BottomLevelAccelerationStructure* pStructure = nullptr;
+			GpuBufferAllocation Compacted;
+		};
+
+		struct Batch
+		{
+			Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Allocator;
+			Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> CommandList;
+			UINT64 FenceValue = 0;
+			UploadTicket GeometryUploads;
+
+			std::vector<GpuBufferAllocation> Scratch;
+			UINT64 ScratchBytes = 0;
+			// Compacted sizes of the bottom level structures built, in build order. Written on the GPU and copied back for the CPU
+			std::vector<BottomLevelAccelerationStructure*> Built;
+			Microsoft::WRL::ComPtr<ID3D12Resource> PostbuildInfo;
+			Microsoft::WRL::ComPtr<ID3D12Resource> PostbuildReadback;
+			std::vector<Compaction> Compactions;
+			uint32_t BuildCount = 0;
+		};
+
+		bool OpenBatch();
+		// Submits the open batch once it cannot take the build, then opens one if none is open
+		bool ReserveBuild(const UINT64 scratchSize);
+		// Frees the finished batch's scratch, swaps in its compacted copies and records the compaction of its builds
+		bool RetireBatch(Batch& batch);
+		bool WaitForFenceValue(const UINT64 fenceValue);
+
+	private:
+		ID3D12Device5* pDevice = nullptr;
+		GpuMemoryAllocator* pMemoryAllocator = nullptr;
+		UploadQueue* pUploadQueue = nullptr;
+		Microsoft::WRL::ComPtr<ID3D12CommandQueue> CommandQueue;
+		Microsoft::WRL::ComPtr<ID3D12Fence> Fence;
+		UINT64 LastSubmittedFenceValue = 0;
+		// Of the last batch holding builds rather than only compaction copies
+		UINT64 LastBuildFenceValue = 0;
+
+		Batch CurrentBatch;
+		bool BatchOpen = false;
+		// Submitted in order, so they finish in order
+		std::deque<Batch> InFlightBatches;
+		std::vector<Batch> FreeBatches;
+
+		AccelerationStructureBuildStatistics Statistics;
+	};
+}
\ No newline at end of file
@@ -2,23 +2,68 @@
 #include "BottomLevelAccelerationStructure.h"
 #include "Mesh.h"
 
-Renderer::BottomLevelAccelerationStructure::BottomLevelAccelerationStructure(ID3D12Device5* device, Mesh& mesh)
+Renderer::BottomLevelAccelerationStructure::BottomLevelAccelerationStructure(ID3D12Device5* device, GpuMemoryAllocator& memoryAllocator, Mesh& mesh)
+	: pMemoryAllocator(&memoryAllocator), GeometryUploadTicket(mesh.GetUploadTicket())
 {
 	// Describe the geometry
 	GeometryDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
-	GeometryDesc.Triangles.VertexBuffer.StartAddress = mesh.GetVertexBuffer()->GetGPUVirtualAddress();
-	GeometryDesc.Triangles.VertexBuffer.StrideInBytes = sizeof(Vertex1Pos1UV1Norm);
-	GeometryDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+	GeometryDesc.Triangles.VertexBuffer.StartAddress = mesh.GetVertexBufferView().BufferLocation;
+	GeometryDesc.Triangles.VertexBuffer.StrideInBytes = mesh.GetVertexStride();
+	GeometryDesc.Triangles.VertexFormat = mesh.GetPositionFormat();
 	GeometryDesc.Triangles.VertexCount = mesh.GetVertexCount();
-	GeometryDesc.Triangles.IndexBuffer = mesh.GetIndexBuffer()->GetGPUVirtualAddress();
-	GeometryDesc.Triangles.IndexCount = mesh.GetIndexCount();
+	// Only the most detailed level is raytraced
+	GeometryDesc.Triangles.IndexBuffer = mesh.GetIndexBufferView().BufferLocation + mesh.GetLOD(0).IndexOffset * sizeof(uint32_t);
+	GeometryDesc.Triangles.IndexCount = mesh.GetLOD(0).IndexCount;
 	GeometryDesc.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
 	GeometryDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE; // Use D3D12_RAYTRACING_GEOMETRY_FLAG_NONE if geometry is not opaque
 
+	// Compressed meshes store quantized positions, fold the dequantization matrix into the geometry so the blas is built in object space
+	if (mesh.IsCompressed())
+	{
+		auto transformHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+		auto transformResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(float) * 12);
+
+		if (FAILED(device->CreateCommittedResource(&transformHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&transformResourceDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&Transform))))
+		{
+			assert(false && "Failed to create transform resource for blas.");
+		}
+
+		// Transform3x4 is a row major affine matrix, glm matrices are column major
+		const glm::mat4& dequantizationMatrix = mesh.GetDequantizationMatrix();
+		float transform[3][4];
+		for (int row = 0; row < 3; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				transform[row][column] = dequantizationMatrix[column][row];
+			}
+		}
+
+		void* pTransformData = nullptr;
+		if (FAILED(Transform->Map(0, nullptr, &pTransformData)))
+		{
+			assert(false && "Failed to map transform resource for blas.");
+		}
+		memcpy(pTransformData, transform, sizeof(transform));
+		Transform->Unmap(0, nullptr);
+
+		GeometryDesc.Triangles.Transform3x4 = Transform->GetGPUVirtualAddress();
+	}
+	else
+	{
+		GeometryDesc.Triangles.Transform3x4 = 0;
+	}
+
 	// Query blas memory requirements
 	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
 	inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-	inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE;
+	// Built once and traced every frame, so compacted and built for trace speed
+	inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
 	inputs.NumDescs = 1;
 	inputs.pGeometryDescs = &GeometryDesc;
 	inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
@@ -26,33 +71,34 @@ Renderer::BottomLevelAccelerationStructure::BottomLevelAccelerationStructure(ID3
 	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info;
 	device->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
 
-	// Create GPU resources for the blas buffer
-	auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-	auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(info.ResultDataMaxSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-
-	if (FAILED(device->CreateCommittedResource(&heapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&resourceDesc,
-		D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
-		nullptr,
-		IID_PPV_ARGS(&Blas))))
+	// Allocate the blas from pool buffers kept in the acceleration structure state
+	if (!memoryAllocator.AllocateBuffer(GpuMemoryPool::AccelerationStructure, info.ResultDataMaxSizeInBytes,
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, Blas))
 	{
-		assert(false && "Failed to create resource for blas.");
+		assert(false && "Failed to allocate blas buffer.");
 	}
+	ScratchSize = info.ScratchDataSizeInBytes;
 
-	// Create GPU resources for the scratch buffer
-	if (FAILED(device->CreateCommittedResource(&heapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&resourceDesc,
-		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-		nullptr,
-		IID_PPV_ARGS(&Scratch))))
+	// Fill out build description, the scratch address is set for each build
+	BuildDesc.Inputs = inputs;
+	BuildDesc.DestAccelerationStructureData = Blas.GPUAddress;
+	BuildDesc.SourceAccelerationStructureData = 0;
+	BuildDesc.ScratchAccelerationStructureData = 0;
+}
+
+Renderer::BottomLevelAccelerationStructure::~BottomLevelAccelerationStructure()
+{
+	if (Blas.pResource != nullptr)
 	{
-		assert(false && "Failed to create scratch resource for blas.");
+		pMemoryAllocator->Free(Blas);
 	}
-
-	// Fill out build description
-	BuildDesc.Inputs = inputs;
-	BuildDesc.DestAccelerationStructureData = Blas->GetGPUVirtualAddress();
-	BuildDesc.ScratchAccelerationStructureData = Scratch->GetGPUVirtualAddress();
 }
+
+void Renderer::BottomLevelAccelerationStructure::ReplaceWithCompacted(const GpuBufferAllocation& compacted)
+{
+	// Frames in flight may still trace the original, the allocator defers reusing it until they complete
+	pMemoryAllocator->Free(Blas);
+	Blas = compacted;
+	BuildDesc.DestAccelerationStructureData = Blas.GPUAddress;
+	Compacted = true;
+}
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "GpuMemoryAllocator.h"
+#include "UploadQueue.h"
+
 namespace Renderer
 {
 	class Mesh;
@@ -7,14 +10,32 @@ namespace Renderer
 	class BottomLevelAccelerationStructure
 	{
 	public:
-		BottomLevelAccelerationStructure(ID3D12Device5* device, Mesh& mesh);
+		// The blas is sub-allocated from the memory allocator's pools, which must outlive the blas. Build scratch is allocated by the builder
+		BottomLevelAccelerationStructure(ID3D12Device5* device, GpuMemoryAllocator& memoryAllocator, Mesh& mesh);
+		BottomLevelAccelerationStructure(const BottomLevelAccelerationStructure&) = delete;
+		BottomLevelAccelerationStructure& operator=(const BottomLevelAccelerationStructure&) = delete;
+		~BottomLevelAccelerationStructure();
 		const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC& GetBuildDesc() const { return BuildDesc; }
-		ID3D12Resource* GetBlas() const { return Blas.Get(); }
+		// Pool buffer shared with other acceleration structures
+		ID3D12Resource* GetBlas() const { return Blas.pResource; }
+		// Changes when the blas is replaced by its compacted copy
+		D3D12_GPU_VIRTUAL_ADDRESS GetBlasGPUVirtualAddress() const { return Blas.GPUAddress; }
+		UINT64 GetSize() const { return Blas.Size; }
+		UINT64 GetScratchSize() const { return ScratchSize; }
+		bool IsCompacted() const { return Compacted; }
+		// Takes ownership of a finished compacted copy of the blas and frees the original. A compacted blas cannot be built again
+		void ReplaceWithCompacted(const GpuBufferAllocation& compacted);
+		// Upload of the mesh buffers the build reads
+		UploadTicket GetGeometryUploadTicket() const { return GeometryUploadTicket; }
 
 	private:
 		uint32_t GeometryID = 0;
-		Microsoft::WRL::ComPtr<ID3D12Resource> Blas;
-		Microsoft::WRL::ComPtr<ID3D12Resource> Scratch;
+		GpuMemoryAllocator* pMemoryAllocator = nullptr;
+		GpuBufferAllocation Blas;
+		UINT64 ScratchSize = 0;
+		bool Compacted = false;
+		UploadTicket GeometryUploadTicket;
+		Microsoft::WRL::ComPtr<ID3D12Resource> Transform;
 		D3D12_RAYTRACING_GEOMETRY_DESC GeometryDesc;
 		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC BuildDesc;
 	};
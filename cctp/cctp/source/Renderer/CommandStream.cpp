@@ -0,0 +1,201 @@
+#include "Pch.h"
+#include "CommandStream.h"
+
+const char* Renderer::GetCommandTypeName(const CommandType type)
+{
+	switch (type)
+	{
+	case CommandType::SetRenderTargets: return "Set render targets";
+	case CommandType::ClearRenderTarget: return "Clear render target";
+	case CommandType::ClearDepthStencil: return "Clear depth stencil";
+	case CommandType::ResourceBarriers: return "Resource barriers";
+	case CommandType::CopyResource: return "Copy resource";
+	case CommandType::SetPrimitiveTopology: return "Set primitive topology";
+	case CommandType::SetViewport: return "Set viewport";
+	case CommandType::SetGraphicsPipeline: return "Set graphics pipeline";
+	case CommandType::SetDescriptorHeap: return "Set descriptor heap";
+	case CommandType::SetVertexBuffer: return "Set vertex buffer";
+	case CommandType::SetIndexBuffer: return "Set index buffer";
+	case CommandType::SetGraphicsRootDescriptorTable: return "Set root descriptor table";
+	case CommandType::SetGraphicsRootConstantBufferView: return "Set root constant buffer view";
+	case CommandType::SetGraphicsRootShaderResourceView: return "Set root shader resource view";
+	case CommandType::DrawIndexedInstanced: return "Draw indexed instanced";
+	case CommandType::BuildAccelerationStructure: return "Build acceleration structure";
+	case CommandType::SetRaytracingPipeline: return "Set raytracing pipeline";
+	case CommandType::DispatchRays: return "Dispatch rays";
+	case CommandType::Native: return "Native";
+	default: return "Unknown";
+	}
+}
+
+template<typename T>
+T& Renderer::CommandStream::Push(const CommandType type, const size_t trailingBytes)
+{
+	static_assert(alignof(T) <= PacketAlignment, "Command packets must not need more than the packet alignment.");
+
+	const size_t offset = Data.size();
+	const size_t size = (sizeof(T) + trailingBytes + PacketAlignment - 1) / PacketAlignment * PacketAlignment;
+	Data.resize(offset + size);
+	++CommandCount;
+
+	auto* pCommand = new (Data.data() + offset) T();
+	pCommand->Header.Type = type;
+	pCommand->Header.Size = static_cast<uint32_t>(size);
+	return *pCommand;
+}
+
+void Renderer::CommandStream::Reset()
+{
+	Data.clear();
+	CommandCount = 0;
+}
+
+void Renderer::CommandStream::SetRenderTargets(const uint64_t renderTargetView, const uint64_t depthStencilView)
+{
+	auto& command = Push<SetRenderTargetsCommand>(CommandType::SetRenderTargets);
+	command.RenderTargetView = renderTargetView;
+	command.DepthStencilView = depthStencilView;
+}
+
+void Renderer::CommandStream::ClearRenderTarget(const uint64_t renderTargetView, const std::array<float, 4>& color)
+{
+	auto& command = Push<ClearRenderTargetCommand>(CommandType::ClearRenderTarget);
+	command.RenderTargetView = renderTargetView;
+	command.Color = color;
+}
+
+void Renderer::CommandStream::ClearDepthStencil(const uint64_t depthStencilView, const float depth)
+{
+	auto& command = Push<ClearDepthStencilCommand>(CommandType::ClearDepthStencil);
+	command.DepthStencilView = depthStencilView;
+	command.Depth = depth;
+}
+
+void Renderer::CommandStream::ResourceBarriers(const ResourceBarrier* pBarriers, const uint32_t barrierCount)
+{
+	if (barrierCount == 0)
+	{
+		return;
+	}
+
+	static_assert(sizeof(ResourceBarriersCommand) % alignof(ResourceBarrier) == 0, "Barriers following the packet must be aligned.");
+	auto& command = Push<ResourceBarriersCommand>(CommandType::ResourceBarriers, barrierCount * sizeof(ResourceBarrier));
+	command.BarrierCount = barrierCount;
+	memcpy(reinterpret_cast<uint8_t*>(&command + 1), pBarriers, barrierCount * sizeof(ResourceBarrier));
+}
+
+void Renderer::CommandStream::CopyResource(void* pDst, void* pSrc)
+{
+	auto& command = Push<CopyResourceCommand>(CommandType::CopyResource);
+	command.pDst = pDst;
+	command.pSrc = pSrc;
+}
+
+void Renderer::CommandStream::SetPrimitiveTopology(const uint32_t topology)
+{
+	Push<SetPrimitiveTopologyCommand>(CommandType::SetPrimitiveTopology).Topology = topology;
+}
+
+void Renderer::CommandStream::SetViewport(const float x, const float y, const float width, const float height, const float minDepth, const float maxDepth,
+	const int32_t scissorLeft, const int32_t scissorTop, const int32_t scissorRight, const int32_t scissorBottom)
+{
+	auto& command = Push<SetViewportCommand>(CommandType::SetViewport);
+	command.X = x;
+	command.Y = y;
+	command.Width = width;
+	command.Height = height;
+	command.MinDepth = minDepth;
+	command.MaxDepth = maxDepth;
+	command.ScissorLeft = scissorLeft;
+	command.ScissorTop = scissorTop;
+	command.ScissorRight = scissorRight;
+	command.ScissorBottom = scissorBottom;
+}
+
+void Renderer::CommandStream::SetGraphicsPipeline(void* pPipelineState, void* pRootSignature)
+{
+	auto& command = Push<SetGraphicsPipelineCommand>(CommandType::SetGraphicsPipeline);
+	command.pPipelineState = pPipelineState;
+	command.pRootSignature = pRootSignature;
+}
+
+void Renderer::CommandStream::SetDescriptorHeap(void* pHeap)
+{
+	Push<SetDescriptorHeapCommand>(CommandType::SetDescriptorHeap).pHeap = pHeap;
+}
+
+void Renderer::CommandStream::SetVertexBuffer(const uint64_t address, const uint32_t size, const uint32_t stride)
+{
+	auto& command = Push<SetVertexBufferCommand>(CommandType::SetVertexBuffer);
+	command.Address = address;
+	command.Size = size;
+	command.Stride = stride;
+}
+
+void Renderer::CommandStream::SetIndexBuffer(const uint64_t address, const uint32_t size, const uint32_t format)
+{
+	auto& command = Push<SetIndexBufferCommand>(CommandType::SetIndexBuffer);
+	command.Address = address;
+	command.Size = size;
+	command.Format = format;
+}
+
+void Renderer::CommandStream::SetGraphicsRootDescriptorTable(const uint32_t parameterIndex, const uint64_t descriptorHandle)
+{
+	auto& command = Push<SetGraphicsRootParameterCommand>(CommandType::SetGraphicsRootDescriptorTable);
+	command.ParameterIndex = parameterIndex;
+	command.Value = descriptorHandle;
+}
+
+void Renderer::CommandStream::SetGraphicsRootConstantBufferView(const uint32_t parameterIndex, const uint64_t address)
+{
+	auto& command = Push<SetGraphicsRootParameterCommand>(CommandType::SetGraphicsRootConstantBufferView);
+	command.ParameterIndex = parameterIndex;
+	command.Value = address;
+}
+
+void Renderer::CommandStream::SetGraphicsRootShaderResourceView(const uint32_t parameterIndex, const uint64_t address)
+{
+	auto& command = Push<SetGraphicsRootParameterCommand>(CommandType::SetGraphicsRootShaderResourceView);
+	command.ParameterIndex = parameterIndex;
+	command.Value = address;
+}
+
+void Renderer::CommandStream::DrawIndexedInstanced(const uint32_t indexCount, const uint32_t instanceCount, const uint32_t startIndex,
+	const int32_t baseVertex, const uint32_t startInstance)
+{
+	auto& command = Push<DrawIndexedInstancedCommand>(CommandType::DrawIndexedInstanced);
+	command.IndexCount = indexCount;
+	command.InstanceCount = instanceCount;
+	command.StartIndex = startIndex;
+	command.BaseVertex = baseVertex;
+	command.StartInstance = startInstance;
+}
+
+void Renderer::CommandStream::BuildAccelerationStructure(const BuildAccelerationStructureCommand& command)
+{
+	auto& packet = Push<BuildAccelerationStructureCommand>(CommandType::BuildAccelerationStructure);
+	const auto header = packet.Header;
+	packet = command;
+	packet.Header = header;
+}
+
+void Renderer::CommandStream::SetRaytracingPipeline(void* pStateObject)
+{
+	Push<SetRaytracingPipelineCommand>(CommandType::SetRaytracingPipeline).pStateObject = pStateObject;
+}
+
+void Renderer::CommandStream::DispatchRays(const DispatchRaysCommand& command)
+{
+	auto& packet = Push<DispatchRaysCommand>(CommandType::DispatchRays);
+	const auto header = packet.Header;
+	packet = command;
+	packet.Header = header;
+}
+
+void Renderer::CommandStream::Native(NativeCommandFunction pExecute, void* pUserData)
+{
+	auto& command = Push<NativeCommand>(CommandType::Native);
+	command.pExecute = pExecute;
+	command.pUserData = pUserData;
+}
\ No newline at end of file
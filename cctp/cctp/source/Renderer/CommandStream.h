@@ -0,0 +1,267 @@
+#pragma once
+
+#include "RenderGraph.h"
+
+namespace Renderer
+{
+	enum class CommandType : uint32_t
+	{
+		SetRenderTargets = 0,
+		ClearRenderTarget,
+		ClearDepthStencil,
+		ResourceBarriers,
+		CopyResource,
+		SetPrimitiveTopology,
+		SetViewport,
+		SetGraphicsPipeline,
+		SetDescriptorHeap,
+		SetVertexBuffer,
+		SetIndexBuffer,
+		SetGraphicsRootDescriptorTable,
+		SetGraphicsRootConstantBufferView,
+		SetGraphicsRootShaderResourceView,
+		DrawIndexedInstanced,
+		BuildAccelerationStructure,
+		SetRaytracingPipeline,
+		DispatchRays,
+		// Calls back into the backend with its native command list, for libraries that record their own commands
+		Native,
+
+		Count
+	};
+	constexpr uint32_t COMMAND_TYPE_COUNT = static_cast<uint32_t>(CommandType::Count);
+
+	const char* GetCommandTypeName(const CommandType type);
+
+	// Every packet starts with a header. Size is the bytes from the header to the next packet, including any trailing arguments
+	struct CommandHeader
+	{
+		CommandType Type = CommandType::Count;
+		uint32_t Size = 0;
+	};
+
+	// Descriptor handles and GPU addresses are held as integers, zero when unset. Native objects are the backend's object pointers
+	struct SetRenderTargetsCommand
+	{
+		CommandHeader Header;
+		uint64_t RenderTargetView = 0;
+		uint64_t DepthStencilView = 0;
+	};
+
+	struct ClearRenderTargetCommand
+	{
+		CommandHeader Header;
+		uint64_t RenderTargetView = 0;
+		std::array<float, 4> Color = {};
+	};
+
+	struct ClearDepthStencilCommand
+	{
+		CommandHeader Header;
+		uint64_t DepthStencilView = 0;
+		float Depth = 1.0f;
+	};
+
+	// Accesses are render graph accesses, a resource with no access is in the common state it is presented in
+	struct ResourceBarrier
+	{
+		RenderGraph::Barrier::Type BarrierType = RenderGraph::Barrier::Type::Transition;
+		uint32_t AccessBefore = RenderGraph::AccessNone;
+		uint32_t AccessAfter = RenderGraph::AccessNone;
+		void* pResource = nullptr;
+		// Previous user of an aliased resource's memory, null when there could be several
+		void* pResourceBefore = nullptr;
+	};
+
+	// Followed by BarrierCount barriers
+	struct alignas(alignof(ResourceBarrier)) ResourceBarriersCommand
+	{
+		CommandHeader Header;
+		uint32_t BarrierCount = 0;
+
+		const ResourceBarrier* GetBarriers() const { return reinterpret_cast<const ResourceBarrier*>(this + 1); }
+	};
+
+	struct CopyResourceCommand
+	{
+		CommandHeader Header;
+		void* pDst = nullptr;
+		void* pSrc = nullptr;
+	};
+
+	struct SetPrimitiveTopologyCommand
+	{
+		CommandHeader Header;
+		// Backend topology value
+		uint32_t Topology = 0;
+	};
+
+	struct SetViewportCommand
+	{
+		CommandHeader Header;
+		float X = 0.0f;
+		float Y = 0.0f;
+		float Width = 0.0f;
+		float Height = 0.0f;
+		float MinDepth = 0.0f;
+		float MaxDepth = 1.0f;
+		int32_t ScissorLeft = 0;
+		int32_t ScissorTop = 0;
+		int32_t ScissorRight = 0;
+		int32_t ScissorBottom = 0;
+	};
+
+	struct SetGraphicsPipelineCommand
+	{
+		CommandHeader Header;
+		void* pPipelineState = nullptr;
+		void* pRootSignature = nullptr;
+	};
+
+	struct SetDescriptorHeapCommand
+	{
+		CommandHeader Header;
+		void* pHeap = nullptr;
+	};
+
+	struct SetVertexBufferCommand
+	{
+		CommandHeader Header;
+		uint64_t Address = 0;
+		uint32_t Size = 0;
+		uint32_t Stride = 0;
+	};
+
+	struct SetIndexBufferCommand
+	{
+		CommandHeader Header;
+		uint64_t Address = 0;
+		uint32_t Size = 0;
+		// Backend format value
+		uint32_t Format = 0;
+	};
+
+	// Value is a GPU descriptor handle for descriptor tables and a GPU address for root views
+	struct SetGraphicsRootParameterCommand
+	{
+		CommandHeader Header;
+		uint32_t ParameterIndex = 0;
+		uint64_t Value = 0;
+	};
+
+	struct DrawIndexedInstancedCommand
+	{
+		CommandHeader Header;
+		uint32_t IndexCount = 0;
+		uint32_t InstanceCount = 0;
+		uint32_t StartIndex = 0;
+		int32_t BaseVertex = 0;
+		uint32_t StartInstance = 0;
+	};
+
+	// Top level build. A source address updates the structure in place of a full build
+	struct BuildAccelerationStructureCommand
+	{
+		CommandHeader Header;
+		uint64_t DestAddress = 0;
+		uint64_t SourceAddress = 0;
+		uint64_t InstanceDescsAddress = 0;
+		uint64_t ScratchAddress = 0;
+		uint32_t InstanceCount = 0;
+		// Backend build flags
+		uint32_t Flags = 0;
+	};
+
+	struct SetRaytracingPipelineCommand
+	{
+		CommandHeader Header;
+		void* pStateObject = nullptr;
+	};
+
+	struct ShaderTableRange
+	{
+		uint64_t StartAddress = 0;
+		uint64_t SizeInBytes = 0;
+		uint64_t StrideInBytes = 0;
+	};
+
+	struct DispatchRaysCommand
+	{
+		CommandHeader Header;
+		// Ray generation records have no stride
+		ShaderTableRange RayGeneration;
+		ShaderTableRange Miss;
+		ShaderTableRange HitGroup;
+		ShaderTableRange Callable;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t Depth = 0;
+	};
+
+	using NativeCommandFunction = void(*)(void* pNativeCommandList, void* pUserData);
+
+	struct NativeCommand
+	{
+		CommandHeader Header;
+		NativeCommandFunction pExecute = nullptr;
+		void* pUserData = nullptr;
+	};
+
+	// Commands recorded as compact packets into one growing buffer, replayed later by a backend. Recording needs no graphics API, so a frame
+	// can be recorded, counted and validated anywhere. Storage is kept between resets, so a frame of similar size records without allocating
+	class CommandStream
+	{
+	public:
+		static constexpr size_t PacketAlignment = 8;
+
+		// Removes every command, storage is kept
+		void Reset();
+
+		// Either view can be zero to leave it unbound
+		void SetRenderTargets(const uint64_t renderTargetView, const uint64_t depthStencilView);
+		void ClearRenderTarget(const uint64_t renderTargetView, const std::array<float, 4>& color);
+		void ClearDepthStencil(const uint64_t depthStencilView, const float depth);
+		void ResourceBarriers(const ResourceBarrier* pBarriers, const uint32_t barrierCount);
+		void CopyResource(void* pDst, void* pSrc);
+		void SetPrimitiveTopology(const uint32_t topology);
+		void SetViewport(const float x, const float y, const float width, const float height, const float minDepth, const float maxDepth,
+			const int32_t scissorLeft, const int32_t scissorTop, const int32_t scissorRight, const int32_t scissorBottom);
+		void SetGraphicsPipeline(void* pPipelineState, void* pRootSignature);
+		void SetDescriptorHeap(void* pHeap);
+		void SetVertexBuffer(const uint64_t address, const uint32_t size, const uint32_t stride);
+		void SetIndexBuffer(const uint64_t address, const uint32_t size, const uint32_t format);
+		void SetGraphicsRootDescriptorTable(const uint32_t parameterIndex, const uint64_t descriptorHandle);
+		void SetGraphicsRootConstantBufferView(const uint32_t parameterIndex, const uint64_t address);
+		void SetGraphicsRootShaderResourceView(const uint32_t parameterIndex, const uint64_t address);
+		void DrawIndexedInstanced(const uint32_t indexCount, const uint32_t instanceCount, const uint32_t startIndex, const int32_t baseVertex,
+			const uint32_t startInstance);
+		void BuildAccelerationStructure(const BuildAccelerationStructureCommand& command);
+		void SetRaytracingPipeline(void* pStateObject);
+		void DispatchRays(const DispatchRaysCommand& command);
+		void Native(NativeCommandFunction pExecute, void* pUserData);
+
+		// Calls function with the header of each packet in recording order
+		template<typename Function>
+		void ForEach(Function&& function) const
+		{
+			for (size_t offset = 0; offset < Data.size();)
+			{
+				const auto& header = *reinterpret_cast<const CommandHeader*>(Data.data() + offset);
+				function(header);
+				offset += header.Size;
+			}
+		}
+
+		uint32_t GetCommandCount() const { return CommandCount; }
+		size_t GetByteSize() const { return Data.size(); }
+
+	private:
+		// Appends a packet of type T followed by trailingBytes of arguments
+		template<typename T>
+		T& Push(const CommandType type, const size_t trailingBytes = 0);
+
+	private:
+		std::vector<uint8_t> Data;
+		uint32_t CommandCount = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "Pch.h"
+#include "D3D12CommandBackend.h"
+#include "RenderGraphResources.h"
+
+namespace
+{
+	D3D12_GPU_VIRTUAL_ADDRESS_RANGE_AND_STRIDE MakeAddressRangeAndStride(const Renderer::ShaderTableRange& range)
+	{
+		return { range.StartAddress, range.SizeInBytes, range.StrideInBytes };
+	}
+}
+
+void Renderer::D3D12CommandBackend::Submit(const CommandStream& stream, ID3D12GraphicsCommandList4* pCommandList)
+{
+	stream.ForEach([&](const CommandHeader& header)
+		{
+			switch (header.Type)
+			{
+			case CommandType::SetRenderTargets:
+			{
+				const auto& command = reinterpret_cast<const SetRenderTargetsCommand&>(header);
+				const D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView = { static_cast<SIZE_T>(command.RenderTargetView) };
+				const D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView = { static_cast<SIZE_T>(command.DepthStencilView) };
+				pCommandList->OMSetRenderTargets(command.RenderTargetView != 0 ? 1 : 0, command.RenderTargetView != 0 ? &renderTargetView : nullptr,
+					FALSE, command.DepthStencilView != 0 ? &depthStencilView : nullptr);
+				break;
+			}
+			case CommandType::ClearRenderTarget:
+			{
+				const auto& command = reinterpret_cast<const ClearRenderTargetCommand&>(header);
+				const D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView = { static_cast<SIZE_T>(command.RenderTargetView) };
+				pCommandList->ClearRenderTargetView(renderTargetView, command.Color.data(), 0, nullptr);
+				break;
+			}
+			case CommandType::ClearDepthStencil:
+			{
+				const auto& command = reinterpret_cast<const ClearDepthStencilCommand&>(header);
+				const D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView = { static_cast<SIZE_T>(command.DepthStencilView) };
+				pCommandList->ClearDepthStencilView(depthStencilView, D3D12_CLEAR_FLAG_DEPTH, command.Depth, 0, 0, nullptr);
+				break;
+			}
+			case CommandType::ResourceBarriers:
+				SubmitBarriers(reinterpret_cast<const ResourceBarriersCommand&>(header), pCommandList);
+				break;
+			case CommandType::CopyResource:
+			{
+				const auto& command = reinterpret_cast<const CopyResourceCommand&>(header);
+				pCommandList->CopyResource(static_cast<ID3D12Resource*>(command.pDst), static_cast<ID3D12Resource*>(command.pSrc));
+				break;
+			}
+			case CommandType::SetPrimitiveTopology:
+				pCommandList->IASetPrimitiveTopology(static_cast<D3D12_PRIMITIVE_TOPOLOGY>(reinterpret_cast<const SetPrimitiveTopologyCommand&>(header).Topology));
+				break;
+			case CommandType::SetViewport:
+			{
+				const auto& command = reinterpret_cast<const SetViewportCommand&>(header);
+				const D3D12_VIEWPORT viewport = { command.X, command.Y, command.Width, command.Height, command.MinDepth, command.MaxDepth };
+				const D3D12_RECT scissorRect = { command.ScissorLeft, command.ScissorTop, command.ScissorRight, command.ScissorBottom };
+				pCommandList->RSSetViewports(1, &viewport);
+				pCommandList->RSSetScissorRects(1, &scissorRect);
+				break;
+			}
+			case CommandType::SetGraphicsPipeline:
+			{
+				const auto& command = reinterpret_cast<const SetGraphicsPipelineCommand&>(header);
+				pCommandList->SetPipelineState(static_cast<ID3D12PipelineState*>(command.pPipelineState));
+				pCommandList->SetGraphicsRootSignature(static_cast<ID3D12RootSignature*>(command.pRootSignature));
+				break;
+			}
+			case CommandType::SetDescriptorHeap:
+			{
+				ID3D12DescriptorHeap* heaps[] = { static_cast<ID3D12DescriptorHeap*>(reinterpret_cast<const SetDescriptorHeapCommand&>(header).pHeap) };
+				pCommandList->SetDescriptorHeaps(_countof(heaps), heaps);
+				break;
+			}
+			case CommandType::SetVertexBuffer:
+			{
+				const auto& command = reinterpret_cast<const SetVertexBufferCommand&>(header);
+				const D3D12_VERTEX_BUFFER_VIEW view = { command.Address, command.Size, command.Stride };
+				pCommandList->IASetVertexBuffers(0, 1, &view);
+				break;
+			}
+			case CommandType::SetIndexBuffer:
+			{
+				const auto& command = reinterpret_cast<const SetIndexBufferCommand&>(header);
+				const D3D12_INDEX_BUFFER_VIEW view = { command.Address, command.Size, static_cast<DXGI_FORMAT>(command.Format) };
+				pCommandList->IASetIndexBuffer(&view);
+				break;
+			}
+			case CommandType::SetGraphicsRootDescriptorTable:
+			{
+				const auto& command = reinterpret_cast<const SetGraphicsRootParameterCommand&>(header);
+				const D3D12_GPU_DESCRIPTOR_HANDLE descriptorHandle = { command.Value };
+				pCommandList->SetGraphicsRootDescriptorTable(command.ParameterIndex, descriptorHandle);
+				break;
+			}
+			case CommandType::SetGraphicsRootConstantBufferView:
+			{
+				const auto& command = reinterpret_cast<const SetGraphicsRootParameterCommand&>(header);
+				pCommandList->SetGraphicsRootConstantBufferView(command.ParameterIndex, command.Value);
+				break;
+			}
+			case CommandType::SetGraphicsRootShaderResourceView:
+			{
+				const auto& command = reinterpret_cast<const SetGraphicsRootParameterCommand&>(header);
+				pCommandList->SetGraphicsRootShaderResourceView(command.ParameterIndex, command.Value);
+				break;
+			}
+			case CommandType::DrawIndexedInstanced:
+			{
+				const auto& command = reinterpret_cast<const DrawIndexedInstancedCommand&>(header);
+				pCommandList->DrawIndexedInstanced(command.IndexCount, command.InstanceCount, command.StartIndex, command.BaseVertex, command.StartInstance);
+				break;
+			}
+			case CommandType::BuildAccelerationStructure:
+			{
+				const auto& command = reinterpret_cast<const BuildAccelerationStructureCommand&>(header);
+				D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = {};
+				buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+				buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+				buildDesc.Inputs.Flags = static_cast<D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS>(command.Flags);
+				buildDesc.Inputs.NumDescs = command.InstanceCount;
+				buildDesc.Inputs.InstanceDescs = command.InstanceDescsAddress;
+				buildDesc.DestAccelerationStructureData = command.DestAddress;
+				buildDesc.SourceAccelerationStructureData = command.SourceAddress;
+				buildDesc.ScratchAccelerationStructureData = command.ScratchAddress;
+				pCommandList->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
+				break;
+			}
+			case CommandType::SetRaytracingPipeline:
+				pCommandList->SetPipelineState1(static_cast<ID3D12StateObject*>(reinterpret_cast<const SetRaytracingPipelineCommand&>(header).pStateObject));
+				break;
+			case CommandType::DispatchRays:
+			{
+				const auto& command = reinterpret_cast<const DispatchRaysCommand&>(header);
+				D3D12_DISPATCH_RAYS_DESC desc = {};
+				desc.RayGenerationShaderRecord = { command.RayGeneration.StartAddress, command.RayGeneration.SizeInBytes };
+				desc.MissShaderTable = MakeAddressRangeAndStride(command.Miss);
+				desc.HitGroupTable = MakeAddressRangeAndStride(command.HitGroup);
+				desc.CallableShaderTable = MakeAddressRangeAndStride(command.Callable);
+				desc.Width = command.Width;
+				desc.Height = command.Height;
+				desc.Depth = command.Depth;
+				pCommandList->DispatchRays(&desc);
+				break;
+			}
+			case CommandType::Native:
+			{
+				const auto& command = reinterpret_cast<const NativeCommand&>(header);
+				command.pExecute(pCommandList, command.pUserData);
+				break;
+			}
+			default:
+				assert(false && "Unknown command type in command stream.");
+				break;
+			}
+		});
+}
+
+void Renderer::D3D12CommandBackend::SubmitBarriers(const ResourceBarriersCommand& command, ID3D12GraphicsCommandList4* pCommandList)
+{
+	Barriers.clear();
+	Discards.clear();
+
+	const auto* pBarriers = command.GetBarriers();
+	for (uint32_t i = 0; i < command.BarrierCount; ++i)
+	{
+		const auto& barrier = pBarriers[i];
+		auto* pResource = static_cast<ID3D12Resource*>(barrier.pResource);
+		switch (barrier.BarrierType)
+		{
+		case RenderGraph::Barrier::Type::Transition:
+			Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(pResource,
+				RenderGraphResources::GetResourceStates(barrier.AccessBefore), RenderGraphResources::GetResourceStates(barrier.AccessAfter)));
+			break;
+		case RenderGraph::Barrier::Type::Aliasing:
+			Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(static_cast<ID3D12Resource*>(barrier.pResourceBefore), pResource));
+			Discards.push_back(pResource);
+			break;
+		case RenderGraph::Barrier::Type::UnorderedAccess:
+			Barriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(pResource));
+			break;
+		}
+	}
+
+	pCommandList->ResourceBarrier(static_cast<UINT>(Barriers.size()), Barriers.data());
+
+	for (auto* pResource : Discards)
+	{
+		pCommandList->DiscardResource(pResource, nullptr);
+	}
+}
\ No newline at end of file
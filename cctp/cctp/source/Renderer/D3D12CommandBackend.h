@@ -0,0 +1,22 @@
+#pragma once
+
+#include "CommandStream.h"
+
+namespace Renderer
+{
+	// Replays command streams into a D3D12 command list. Aliased resources are discarded after their aliasing barrier, as memory taken over
+	// from another resource holds undefined contents until initialized
+	class D3D12CommandBackend
+	{
+	public:
+		void Submit(const CommandStream& stream, ID3D12GraphicsCommandList4* pCommandList);
+
+	private:
+		void SubmitBarriers(const ResourceBarriersCommand& command, ID3D12GraphicsCommandList4* pCommandList);
+
+	private:
+		// Kept between submits to avoid allocating
+		std::vector<D3D12_RESOURCE_BARRIER> Barriers;
+		std::vector<ID3D12Resource*> Discards;
+	};
+}
\ No newline at end of file
@@ -1,51 +1,234 @@
 #include "Pch.h"
 #include "DXCHelper.h"
+#include "Binary/Hash.h"
+#include "Tasks/TaskSystem.h"
+#include <mutex>
 
-void DXCHelper::CompileShaderFile(LPCWSTR filepath, LPCWSTR entryPoint, LPCWSTR target, std::unique_ptr<DXCBlob>& blob)
+namespace
 {
-	blob = std::make_unique<DXCBlob>();
-
-	Microsoft::WRL::ComPtr<IDxcLibrary> library;
-	HRESULT hr = DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&library));
-	assert(SUCCEEDED(hr) && "Failed to create DXC library instance.");
-
-	Microsoft::WRL::ComPtr<IDxcCompiler> compiler;
-	hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
-	assert(SUCCEEDED(hr) && "Failed to create DXC compiler instance.");
-
-	uint32_t codePage = CP_UTF8;
-	Microsoft::WRL::ComPtr<IDxcBlobEncoding> sourceBlob;
-	hr = library->CreateBlobFromFile(filepath, &codePage, &sourceBlob);
-	assert(SUCCEEDED(hr) && "Failed to create DXC blob from shader file.");
-
-	Microsoft::WRL::ComPtr<IDxcOperationResult> result;
-	hr = compiler->Compile(
-		sourceBlob.Get(),
-		filepath,
-		entryPoint,
-		target,
-		NULL, 0,
-		NULL, 0,
-		NULL,
-		&result
-	);
-	result->GetStatus(&hr);
-	if (FAILED(hr))
-	{
-		if (result)
-		{
-			Microsoft::WRL::ComPtr<IDxcBlobEncoding> errorsBlob;
-			HRESULT hr = result->GetErrorBuffer(&errorsBlob);
-			if (SUCCEEDED(hr) && errorsBlob)
+	// Arguments passed to every compile. Part of every shader's key, so changing them recompiles every shader
+#ifdef _DEBUG
+	constexpr LPCWSTR COMPILE_ARGUMENTS[] = { L"-Zi", L"-Qembed_debug", L"-Od" };
+#else
+	constexpr LPCWSTR COMPILE_ARGUMENTS[] = { L"-O3" };
+#endif
+
+	// Compiler instances are not thread safe, so each compile takes one from the pool for its duration
+	struct CompilerInstance
+	{
+		Microsoft::WRL::ComPtr<IDxcLibrary> Library;
+		Microsoft::WRL::ComPtr<IDxcCompiler> Compiler;
+		Microsoft::WRL::ComPtr<IDxcIncludeHandler> IncludeHandler;
+	};
+
+	// Guards the pool and the statistics
+	std::mutex Mutex;
+	std::vector<CompilerInstance> FreeCompilers;
+	DXCHelper::ShaderCompileStatistics Statistics;
+
+	uint64_t CalculateCompilerKey()
+	{
+		uint64_t hash = Binary::HashBytes(nullptr, 0);
+		for (const auto argument : COMPILE_ARGUMENTS)
+		{
+			hash = Binary::HashBytes(argument, wcslen(argument) * sizeof(wchar_t), hash);
+			// Separates arguments so they cannot trade characters and keep the same hash
+			hash = Binary::HashBytes(L"", sizeof(wchar_t), hash);
+		}
+		return hash;
+	}
+
+	bool CreateCompiler(CompilerInstance& instance)
+	{
+		if (FAILED(DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&instance.Library))))
+		{
+			assert(false && "Failed to create DXC library instance.");
+			return false;
+		}
+
+		if (FAILED(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&instance.Compiler))))
+		{
+			assert(false && "Failed to create DXC compiler instance.");
+			return false;
+		}
+
+		// Resolves includes relative to the including file, matching how the shader cache finds dependencies
+		if (FAILED(instance.Library->CreateIncludeHandler(&instance.IncludeHandler)))
+		{
+			assert(false && "Failed to create DXC include handler.");
+			return false;
+		}
+		return true;
+	}
+
+	bool AcquireCompiler(CompilerInstance& instance)
+	{
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			if (!FreeCompilers.empty())
 			{
-				std::wcout << (const char*)errorsBlob->GetBufferPointer() << std::endl;
+				instance = std::move(FreeCompilers.back());
+				FreeCompilers.pop_back();
+				return true;
 			}
-			assert(false && "Shader compilation error: Check console output for more information.");
 		}
+		return CreateCompiler(instance);
 	}
-	else
+
+	void ReleaseCompiler(CompilerInstance&& instance)
 	{
-		assert(SUCCEEDED(hr));
-		result->GetResult(blob->GetAddressOf());
+		std::lock_guard<std::mutex> lock(Mutex);
+		FreeCompilers.push_back(std::move(instance));
 	}
+
+	std::wstring Widen(const std::string& string)
+	{
+		return std::wstring(string.begin(), string.end());
+	}
+
+	bool Compile(const CompilerInstance& instance, const Renderer::ShaderCache::ShaderCompileDesc& desc, std::vector<uint8_t>& bytecode)
+	{
+		const auto filepath = std::filesystem::path(desc.Filepath).wstring();
+		uint32_t codePage = CP_UTF8;
+		Microsoft::WRL::ComPtr<IDxcBlobEncoding> sourceBlob;
+		if (FAILED(instance.Library->CreateBlobFromFile(filepath.c_str(), &codePage, &sourceBlob)))
+		{
+			DEBUG_LOG("Failed to read shader source " << desc.Filepath << ".");
+			return false;
+		}
+
+		// Wide strings must stay alive until the compile returns
+		const auto entryPoint = Widen(desc.EntryPoint);
+		const auto target = Widen(desc.Target);
+		std::vector<std::wstring> defineStrings;
+		defineStrings.reserve(desc.Defines.size() * 2);
+		std::vector<DxcDefine> defines;
+		defines.reserve(desc.Defines.size());
+		for (const auto& define : desc.Defines)
+		{
+			defineStrings.push_back(Widen(define.Name));
+			defineStrings.push_back(Widen(define.Value));
+			defines.push_back({ defineStrings[defineStrings.size() - 2].c_str(), defineStrings.back().c_str() });
+		}
+
+		Microsoft::WRL::ComPtr<IDxcOperationResult> result;
+		HRESULT hr = instance.Compiler->Compile(
+			sourceBlob.Get(),
+			filepath.c_str(),
+			entryPoint.c_str(),
+			target.c_str(),
+			const_cast<LPCWSTR*>(COMPILE_ARGUMENTS), _countof(COMPILE_ARGUMENTS),
+			defines.data(), static_cast<UINT32>(defines.size()),
+			instance.IncludeHandler.Get(),
+			&result
+		);
+		if (SUCCEEDED(hr))
+		{
+			result->GetStatus(&hr);
+		}
+
+		if (FAILED(hr))
+		{
+			if (result)
+			{
+				Microsoft::WRL::ComPtr<IDxcBlobEncoding> errorsBlob;
+				if (SUCCEEDED(result->GetErrorBuffer(&errorsBlob)) && errorsBlob)
+				{
+					std::cout << static_cast<const char*>(errorsBlob->GetBufferPointer()) << std::endl;
+				}
+			}
+			std::cout << "Failed to compile shader " << desc.Filepath << "." << std::endl;
+			return false;
+		}
+
+		Microsoft::WRL::ComPtr<IDxcBlob> blob;
+		if (FAILED(result->GetResult(&blob)) || !blob)
+		{
+			return false;
+		}
+
+		auto pData = static_cast<const uint8_t*>(blob->GetBufferPointer());
+		bytecode.assign(pData, pData + blob->GetBufferSize());
+		return true;
+	}
+}
+
+bool DXCHelper::CompileShader(const Renderer::ShaderCache::ShaderCompileDesc& desc, std::vector<uint8_t>& bytecode)
+{
+	static const uint64_t compilerKey = CalculateCompilerKey();
+
+	// Counted locally and added to the statistics once, so compiles on other threads only wait for the pool
+	ShaderCompileStatistics statistics;
+	auto RecordStatistics = [&statistics]()
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Statistics.CacheHits += statistics.CacheHits;
+		Statistics.Compiles += statistics.Compiles;
+		Statistics.Failures += statistics.Failures;
+		Statistics.CacheMilliseconds += statistics.CacheMilliseconds;
+		Statistics.CompileMilliseconds += statistics.CompileMilliseconds;
+	};
+
+	// Without a key the shader is compiled uncached, leaving the compiler to report why its source cannot be read
+	auto start = std::chrono::high_resolution_clock::now();
+	uint64_t key = 0;
+	const bool keyed = Renderer::ShaderCache::CalculateShaderKey(desc, compilerKey, key);
+	const auto cacheFilepath = Renderer::ShaderCache::GetCacheFilepath(Renderer::ShaderCache::GetShaderCacheName(key));
+	const bool cached = keyed && Renderer::ShaderCache::ReadCacheFile(cacheFilepath, key, bytecode);
+	auto cacheEnd = std::chrono::high_resolution_clock::now();
+	statistics.CacheMilliseconds = std::chrono::duration<double, std::milli>(cacheEnd - start).count();
+	if (cached)
+	{
+		statistics.CacheHits = 1;
+		RecordStatistics();
+		return true;
+	}
+
+	CompilerInstance instance;
+	bool compiled = AcquireCompiler(instance);
+	if (compiled)
+	{
+		compiled = Compile(instance, desc, bytecode);
+		ReleaseCompiler(std::move(instance));
+	}
+	statistics.CompileMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cacheEnd).count();
+	statistics.Compiles = compiled ? 1 : 0;
+	statistics.Failures = compiled ? 0 : 1;
+	RecordStatistics();
+	if (!compiled)
+	{
+		return false;
+	}
+
+	// A failed write only costs a compile on the next start
+	if (keyed && !Renderer::ShaderCache::WriteCacheFile(cacheFilepath, key, bytecode.data(), bytecode.size()))
+	{
+		DEBUG_LOG("Failed to write shader cache file " << cacheFilepath << ".");
+	}
+	return true;
+}
+
+bool DXCHelper::CompileShaders(const Renderer::ShaderCache::ShaderCompileDesc* pDescs, const size_t shaderCount, std::vector<uint8_t>* pBytecodes)
+{
+	std::vector<uint8_t> succeeded(shaderCount, 0);
+	TaskSystem::ParallelFor(shaderCount, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			succeeded[i] = CompileShader(pDescs[i], pBytecodes[i]) ? 1 : 0;
+		}
+	});
+	return std::all_of(succeeded.begin(), succeeded.end(), [](const uint8_t success) { return success != 0; });
 }
+
+DXCHelper::ShaderCompileStatistics DXCHelper::GetStatistics()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	return Statistics;
+}
+
+void DXCHelper::Shutdown()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	FreeCompilers.clear();
+}
\ No newline at end of file
@@ -1,7 +1,27 @@
 #pragma once
-#include "DXCBlob.h"
+
+#include "Renderer/ShaderCache.h"
 
 namespace DXCHelper
 {
-	void CompileShaderFile(LPCWSTR filepath, LPCWSTR entryPoint, LPCWSTR target, std::unique_ptr<DXCBlob>& blob);
+	struct ShaderCompileStatistics
+	{
+		uint32_t CacheHits = 0;
+		uint32_t Compiles = 0;
+		uint32_t Failures = 0;
+		// Time spent hashing sources and reading the cache, and time spent in the compiler
+		double CacheMilliseconds = 0.0;
+		double CompileMilliseconds = 0.0;
+	};
+
+	// Reads the bytecode from the shader cache when the shader, the files it includes and its settings are unchanged since it was last
+	// compiled, without creating a compiler. Otherwise compiles it with a compiler from a pool, created when every compiler is in use,
+	// and writes the result to the cache. Compile errors are printed to the console. Thread safe
+	bool CompileShader(const Renderer::ShaderCache::ShaderCompileDesc& desc, std::vector<uint8_t>& bytecode);
+	// Compiles each shader into the matching bytecode on the task system's workers, as permutations of one shader are. Descriptions
+	// must differ from each other, as shaders with the same key would write the same cache file. Fails if any shader fails
+	bool CompileShaders(const Renderer::ShaderCache::ShaderCompileDesc* pDescs, const size_t shaderCount, std::vector<uint8_t>* pBytecodes);
+	ShaderCompileStatistics GetStatistics();
+	// Releases the pooled compilers, compiles missing the cache afterwards create them again
+	void Shutdown();
 }
\ No newline at end of file
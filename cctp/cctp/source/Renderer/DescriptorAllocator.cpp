@@ -0,0 +1,144 @@
+#include "Pch.h"
+#include "DescriptorAllocator.h"
+
+void Renderer::DescriptorAllocator::Init(const uint32_t persistentCount, const uint32_t transientCountPerFrame, const uint32_t frameCount)
+{
+	assert(frameCount > 0 && "At least one frame of transient descriptors is required.");
+
+	PersistentCount = persistentCount;
+	TransientCountPerFrame = transientCountPerFrame;
+	FrameCount = frameCount;
+
+	FreeRanges.clear();
+	if (persistentCount > 0)
+	{
+		FreeRanges.push_back({ 0, persistentCount });
+	}
+	PendingFrees.clear();
+	PersistentAllocatedCount = 0;
+	PersistentPeakCount = 0;
+
+	TransientBegin = persistentCount;
+	TransientOffset = 0;
+	TransientPeakCount = 0;
+	FailedAllocationCount = 0;
+}
+
+uint32_t Renderer::DescriptorAllocator::AllocatePersistent(const uint32_t count)
+{
+	assert(count > 0 && "Descriptor allocations must not be empty.");
+
+	const auto it = std::find_if(FreeRanges.begin(), FreeRanges.end(), [count](const Range& range) { return range.Count >= count; });
+	if (it == FreeRanges.end())
+	{
+		++FailedAllocationCount;
+		return InvalidIndex;
+	}
+
+	const uint32_t index = it->Offset;
+	if (it->Count == count)
+	{
+		FreeRanges.erase(it);
+	}
+	else
+	{
+		it->Offset += count;
+		it->Count -= count;
+	}
+
+	PersistentAllocatedCount += count;
+	PersistentPeakCount = std::max(PersistentPeakCount, PersistentAllocatedCount);
+	return index;
+}
+
+void Renderer::DescriptorAllocator::FreePersistent(const uint32_t index, const uint32_t count, const uint64_t retireSerial)
+{
+	assert(count > 0 && index + count <= PersistentCount && "Freed descriptors are outside the persistent range.");
+	PendingFrees.push_back({ { index, count }, retireSerial });
+}
+
+void Renderer::DescriptorAllocator::BeginFrame(const uint32_t frameIndex, const uint64_t completedSerial)
+{
+	assert(frameIndex < FrameCount && "Frame index is outside the frames in flight.");
+
+	std::erase_if(PendingFrees, [this, completedSerial](const PendingFree& pending)
+		{
+			if (pending.RetireSerial > completedSerial)
+			{
+				return false;
+			}
+
+			Release(pending.Freed);
+			return true;
+		});
+
+	TransientPeakCount = std::max(TransientPeakCount, std::min(TransientOffset.load(), TransientCountPerFrame));
+	TransientBegin = PersistentCount + frameIndex * TransientCountPerFrame;
+	TransientOffset = 0;
+}
+
+uint32_t Renderer::DescriptorAllocator::AllocateTransient(const uint32_t count)
+{
+	assert(count > 0 && "Descriptor allocations must not be empty.");
+
+	const uint32_t offset = TransientOffset.fetch_add(count);
+	if (offset + count > TransientCountPerFrame)
+	{
+		++FailedAllocationCount;
+		return InvalidIndex;
+	}
+
+	return TransientBegin + offset;
+}
+
+Renderer::DescriptorAllocatorStatistics Renderer::DescriptorAllocator::GetStatistics() const
+{
+	DescriptorAllocatorStatistics statistics;
+	statistics.PersistentAllocatedCount = PersistentAllocatedCount;
+	statistics.PersistentPeakCount = PersistentPeakCount;
+	statistics.FreeRangeCount = static_cast<uint32_t>(FreeRanges.size());
+	for (const auto& range : FreeRanges)
+	{
+		statistics.LargestFreeRange = std::max(statistics.LargestFreeRange, range.Count);
+	}
+	for (const auto& pending : PendingFrees)
+	{
+		statistics.PendingFreeCount += pending.Freed.Count;
+	}
+	statistics.TransientPeakCount = std::max(TransientPeakCount, std::min(TransientOffset.load(), TransientCountPerFrame));
+	statistics.FailedAllocationCount = FailedAllocationCount;
+	return statistics;
+}
+
+void Renderer::DescriptorAllocator::Release(const Range& range)
+{
+	assert(PersistentAllocatedCount >= range.Count && "More descriptors freed than allocated.");
+	PersistentAllocatedCount -= range.Count;
+
+	auto next = std::lower_bound(FreeRanges.begin(), FreeRanges.end(), range.Offset,
+		[](const Range& freeRange, const uint32_t offset) { return freeRange.Offset < offset; });
+	assert((next == FreeRanges.end() || range.Offset + range.Count <= next->Offset) &&
+		(next == FreeRanges.begin() || std::prev(next)->Offset + std::prev(next)->Count <= range.Offset) && "Descriptor range freed twice.");
+
+	// Merge with the free range before, the one after, or both
+	const bool mergePrevious = next != FreeRanges.begin() && std::prev(next)->Offset + std::prev(next)->Count == range.Offset;
+	const bool mergeNext = next != FreeRanges.end() && range.Offset + range.Count == next->Offset;
+	if (mergePrevious && mergeNext)
+	{
+		std::prev(next)->Count += range.Count + next->Count;
+		FreeRanges.erase(next);
+	}
+	else if (mergePrevious)
+	{
+		std::prev(next)->Count += range.Count;
+	}
+	else if (mergeNext)
+	{
+		next->Offset = range.Offset;
+		next->Count += range.Count;
+	}
+	else
+	{
+		FreeRanges.insert(next, range);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+
+namespace Renderer
+{
+	struct DescriptorAllocatorStatistics
+	{
+		uint32_t PersistentAllocatedCount = 0;
+		uint32_t PersistentPeakCount = 0;
+		uint32_t FreeRangeCount = 0;
+		uint32_t LargestFreeRange = 0;
+		// Descriptors freed but possibly still read by frames in flight
+		uint32_t PendingFreeCount = 0;
+		uint32_t TransientPeakCount = 0;
+		uint32_t FailedAllocationCount = 0;
+	};
+
+	// Hands out indices into a shader visible descriptor heap without touching the heap itself. The front of the heap holds persistent
+	// ranges, allocated first fit from a free list of sorted ranges that merge with their neighbours when freed. Frees are deferred until
+	// a serial reaches the value given with them, so descriptors frames in flight may read are never reused early. The rest of the heap
+	// is split into a linear range for each frame in flight, reset when that frame starts again, for tables written each frame.
+	// Persistent allocations and frees are for a single thread, transient allocations are safe from several at once
+	class DescriptorAllocator
+	{
+	public:
+		static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+		DescriptorAllocator() = default;
+		DescriptorAllocator(const DescriptorAllocator&) = delete;
+		DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+		// The heap must hold persistentCount + transientCountPerFrame * frameCount descriptors
+		void Init(const uint32_t persistentCount, const uint32_t transientCountPerFrame, const uint32_t frameCount);
+
+		// Returns the first index of count contiguous descriptors, InvalidIndex when no free range is large enough
+		uint32_t AllocatePersistent(const uint32_t count = 1);
+		// The range is reused once the completed serial passed to BeginFrame reaches retireSerial
+		void FreePersistent(const uint32_t index, const uint32_t count, const uint64_t retireSerial);
+
+		// Returns frees whose serial has completed to the free list and resets the frame's transient range.
+		// The GPU must have finished the frame that last used frameIndex
+		void BeginFrame(const uint32_t frameIndex, const uint64_t completedSerial);
+		// Returns the first index of count contiguous descriptors valid until the frame's range is reset, InvalidIndex when it is full
+		uint32_t AllocateTransient(const uint32_t count);
+
+		uint32_t GetDescriptorCount() const { return PersistentCount + TransientCountPerFrame * FrameCount; }
+		DescriptorAllocatorStatistics GetStatistics() const;
+
+	private:
+		struct Range
+		{
+			uint32_t Offset = 0;
+			uint32_t Count = 0;
+		};
+
+		struct PendingFree
+		{
+			Range Freed;
+			uint64_t RetireSerial = 0;
+		};
+
+		// Inserts the range in offset order, merging it with adjacent free ranges
+		void Release(const Range& range);
+
+	private:
+		uint32_t PersistentCount = 0;
+		uint32_t TransientCountPerFrame = 0;
+		uint32_t FrameCount = 0;
+
+		// Sorted by offset, never adjacent
+		std::vector<Range> FreeRanges;
+		std::vector<PendingFree> PendingFrees;
+		uint32_t PersistentAllocatedCount = 0;
+		uint32_t PersistentPeakCount = 0;
+
+		uint32_t TransientBegin = 0;
+		std::atomic<uint32_t> TransientOffset = 0;
+		uint32_t TransientPeakCount = 0;
+
+		std::atomic<uint32_t> FailedAllocationCount = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include "Pch.h"
+#include "DrawList.h"
+#include "Renderer.h"
+#include "Math/TransformStorage.h"
+#include "Tasks/TaskSystem.h"
+
+namespace
+{
+	constexpr uint32_t RADIX_BITS = 8;
+	constexpr uint32_t RADIX_SIZE = 1 << RADIX_BITS;
+	constexpr uint32_t RADIX_MASK = RADIX_SIZE - 1;
+	constexpr uint32_t RADIX_DIGIT_COUNT = 64 / RADIX_BITS;
+}
+
+uint64_t Renderer::DrawList::MakeSortKey(const uint32_t pass, const uint32_t pipeline, const uint32_t mesh, const uint32_t lodIndex, const uint32_t material,
+	const float depth)
+{
+	assert(pass < (1u << PassBits) && "Pass does not fit in the sort key.");
+	assert(pipeline < (1u << PipelineBits) && "Pipeline does not fit in the sort key.");
+	assert(mesh < (1u << MeshBits) && "Mesh does not fit in the sort key.");
+	assert(lodIndex < (1u << LODBits) && "Level of detail does not fit in the sort key.");
+	assert(material < (1u << MaterialBits) && "Material does not fit in the sort key.");
+
+	const auto quantizedDepth = static_cast<uint64_t>(std::clamp(depth, 0.0f, 1.0f) * static_cast<float>((1u << DepthBits) - 1));
+
+	uint64_t key = pass;
+	key = (key << PipelineBits) | pipeline;
+	key = (key << MeshBits) | mesh;
+	key = (key << LODBits) | lodIndex;
+	key = (key << MaterialBits) | material;
+	key = (key << DepthBits) | quantizedDepth;
+	return key;
+}
+
+void Renderer::DrawList::Clear()
+{
+	Packets.clear();
+	Ranges.clear();
+	PipelineIds.clear();
+	MeshIds.clear();
+	Keys.clear();
+	Order.clear();
+	Sorted = true;
+	Statistics = {};
+}
+
+void Renderer::DrawList::Add(const uint32_t pass, GraphicsPipelineBase* pPipeline, const Mesh& mesh, const uint32_t lodIndex, const uint32_t material,
+	const float depth, const TransformMatrices& matrices, const glm::vec4& color, const bool lit)
+{
+	AddPacket(pass, pPipeline, mesh, lodIndex, material, depth, matrices, color, lit);
+}
+
+void Renderer::DrawList::AddRanges(const uint32_t pass, GraphicsPipelineBase* pPipeline, const Mesh& mesh, const std::vector<IndexRange>& ranges,
+	const uint32_t material, const float depth, const TransformMatrices& matrices, const glm::vec4& color, const bool lit)
+{
+	if (ranges.empty())
+	{
+		return;
+	}
+
+	Packet& packet = AddPacket(pass, pPipeline, mesh, 0, material, depth, matrices, color, lit);
+	packet.RangeOffset = static_cast<uint32_t>(Ranges.size());
+	packet.RangeCount = static_cast<uint32_t>(ranges.size());
+	Ranges.insert(Ranges.end(), ranges.begin(), ranges.end());
+}
+
+void Renderer::DrawList::Sort()
+{
+	const auto count = static_cast<uint32_t>(Keys.size());
+	if (count < 2)
+	{
+		Sorted = true;
+		return;
+	}
+
+	// Histograms of every digit are counted in one read of the keys
+	std::array<std::array<uint32_t, RADIX_SIZE>, RADIX_DIGIT_COUNT> histograms = {};
+	for (auto key : Keys)
+	{
+		for (uint32_t digit = 0; digit < RADIX_DIGIT_COUNT; ++digit)
+		{
+			++histograms[digit][(key >> (digit * RADIX_BITS)) & RADIX_MASK];
+		}
+	}
+
+	ScratchKeys.resize(count);
+	ScratchOrder.resize(count);
+
+	for (uint32_t digit = 0; digit < RADIX_DIGIT_COUNT; ++digit)
+	{
+		const uint32_t shift = digit * RADIX_BITS;
+		auto& histogram = histograms[digit];
+
+		// Unused key bits and fields with a single value are shared by every key, so the pass would only copy
+		if (histogram[(Keys[0] >> shift) & RADIX_MASK] == count)
+		{
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (auto& bucket : histogram)
+		{
+			const uint32_t bucketCount = bucket;
+			bucket = offset;
+			offset += bucketCount;
+		}
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const uint32_t destination = histogram[(Keys[i] >> shift) & RADIX_MASK]++;
+			ScratchKeys[destination] = Keys[i];
+			ScratchOrder[destination] = Order[i];
+		}
+
+		Keys.swap(ScratchKeys);
+		Order.swap(ScratchOrder);
+	}
+
+	Sorted = true;
+}
+
+void Renderer::DrawList::Submit(const uint32_t pass, UINT instanceDataParameterIndex, const std::function<void(GraphicsPipelineBase*)>& onPipelineBound)
+{
+	size_t begin = 0;
+	size_t end = 0;
+	GetPassRange(pass, begin, end);
+	SubmitRange(begin, end, instanceDataParameterIndex, onPipelineBound);
+}
+
+void Renderer::DrawList::SubmitParallel(const uint32_t pass, UINT instanceDataParameterIndex, const std::function<void(GraphicsPipelineBase*)>& onPipelineBound,
+	const uint32_t minPacketsPerChunk)
+{
+	size_t begin = 0;
+	size_t end = 0;
+	GetPassRange(pass, begin, end);
+
+	// Each chunk is recorded into a command list of its own, so there are no more chunks than threads
+	const size_t packetCount = end - begin;
+	const size_t chunkCount = std::clamp<size_t>(packetCount / std::max(minPacketsPerChunk, 1u), 1, TaskSystem::GetWorkerCount() + 1);
+
+	// Boundaries move forward to the end of the run they fall in, so runs are never split into separate draws
+	std::vector<size_t> boundaries(chunkCount + 1, end);
+	boundaries[0] = begin;
+	for (size_t chunk = 1; chunk < chunkCount; ++chunk)
+	{
+		size_t i = std::max(begin + packetCount * chunk / chunkCount, boundaries[chunk - 1]);
+		while (i > begin && i < end && (Keys[i] >> RunShift) == (Keys[i - 1] >> RunShift))
+		{
+			++i;
+		}
+		boundaries[chunk] = i;
+	}
+
+	Commands::RecordParallel(static_cast<uint32_t>(chunkCount), [&](const uint32_t chunk)
+		{
+			SubmitRange(boundaries[chunk], boundaries[chunk + 1], instanceDataParameterIndex, onPipelineBound);
+		});
+}
+
+void Renderer::DrawList::GetPassRange(const uint32_t pass, size_t& outBegin, size_t& outEnd) const
+{
+	assert(Sorted && "Draw list must be sorted before it is submitted.");
+
+	// Pass is the top key field, so the packets of a pass are contiguous once sorted
+	constexpr uint32_t passShift = 64 - PassBits;
+	outBegin = static_cast<size_t>(std::lower_bound(Keys.begin(), Keys.end(), static_cast<uint64_t>(pass) << passShift) - Keys.begin());
+	outEnd = pass + 1 < (1u << PassBits) ?
+		static_cast<size_t>(std::lower_bound(Keys.begin(), Keys.end(), static_cast<uint64_t>(pass + 1) << passShift) - Keys.begin()) : Keys.size();
+}
+
+void Renderer::DrawList::SubmitRange(const size_t begin, const size_t end, UINT instanceDataParameterIndex,
+	const std::function<void(GraphicsPipelineBase*)>& onPipelineBound)
+{
+	// Ranges may be submitted from several threads at once, so scratch and statistics are kept per call
+	thread_local std::vector<InstanceData> runInstances;
+	DrawListStatistics statistics;
+
+	GraphicsPipelineBase* pBoundPipeline = nullptr;
+	const Mesh* pBoundMesh = nullptr;
+	size_t i = begin;
+	while (i < end)
+	{
+		const Packet& packet = Packets[Order[i]];
+
+		if (packet.pPipeline != pBoundPipeline)
+		{
+			Commands::SetGraphicsPipeline(packet.pPipeline);
+			onPipelineBound(packet.pPipeline);
+			pBoundPipeline = packet.pPipeline;
+			++statistics.PipelineChangeCount;
+		}
+
+		if (packet.pMesh != pBoundMesh)
+		{
+			pBoundMesh = packet.pMesh;
+			++statistics.MeshChangeCount;
+		}
+
+		if (packet.RangeCount > 0)
+		{
+			Commands::SubmitMeshRanges(instanceDataParameterIndex, *packet.pMesh, packet.Instance, &Ranges[packet.RangeOffset], packet.RangeCount);
+			statistics.DrawCount += packet.RangeCount;
+			++i;
+			continue;
+		}
+
+		// Packets sharing every field above material merge into one instanced draw
+		runInstances.clear();
+		const uint64_t runKey = Keys[i] >> RunShift;
+		for (; i < end && (Keys[i] >> RunShift) == runKey && Packets[Order[i]].RangeCount == 0; ++i)
+		{
+			runInstances.push_back(Packets[Order[i]].Instance);
+		}
+
+		Commands::SubmitMeshInstances(instanceDataParameterIndex, *packet.pMesh, runInstances.data(), static_cast<uint32_t>(runInstances.size()), packet.LODIndex);
+		++statistics.DrawCount;
+	}
+
+	std::lock_guard<std::mutex> lock(StatisticsMutex);
+	Statistics.DrawCount += statistics.DrawCount;
+	Statistics.PipelineChangeCount += statistics.PipelineChangeCount;
+	Statistics.MeshChangeCount += statistics.MeshChangeCount;
+}
+
+uint32_t Renderer::DrawList::FindOrAddId(std::vector<const void*>& ids, const void* p, const uint32_t bits)
+{
+	// Lists hold a handful of pipelines and meshes, so ids are found with a linear search
+	auto it = std::find(ids.begin(), ids.end(), p);
+	if (it != ids.end())
+	{
+		return static_cast<uint32_t>(it - ids.begin());
+	}
+
+	assert(ids.size() < (1ull << bits) && "Too many distinct ids for the sort key.");
+	ids.push_back(p);
+	return static_cast<uint32_t>(ids.size() - 1);
+}
+
+Renderer::DrawList::Packet& Renderer::DrawList::AddPacket(const uint32_t pass, GraphicsPipelineBase* pPipeline, const Mesh& mesh, const uint32_t lodIndex,
+	const uint32_t material, const float depth, const TransformMatrices& matrices, const glm::vec4& color, const bool lit)
+{
+	const uint32_t pipelineId = FindOrAddId(PipelineIds, pPipeline, PipelineBits);
+	const uint32_t meshId = FindOrAddId(MeshIds, &mesh, MeshBits);
+
+	Keys.push_back(MakeSortKey(pass, pipelineId, meshId, lodIndex, material, depth));
+	Order.push_back(static_cast<uint32_t>(Packets.size()));
+	Sorted = Keys.size() < 2;
+	++Statistics.PacketCount;
+
+	Packet& packet = Packets.emplace_back();
+	packet.pPipeline = pPipeline;
+	packet.pMesh = &mesh;
+	packet.LODIndex = lodIndex;
+	packet.Instance = MakeInstanceData(matrices, color, lit);
+	return packet;
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "InstanceData.h"
+#include "Meshlets.h"
+
+#include <mutex>
+
+namespace Renderer
+{
+	class Mesh;
+	class GraphicsPipelineBase;
+
+	// Counts since the draw list was last cleared
+	struct DrawListStatistics
+	{
+		uint32_t PacketCount = 0;
+		uint32_t DrawCount = 0;
+		uint32_t PipelineChangeCount = 0;
+		uint32_t MeshChangeCount = 0;
+	};
+
+	// Draws of one or more passes, each carrying a packed 64 bit sort key. Sorting groups draws by pass, pipeline, mesh and level of detail,
+	// then material and depth, so runs of draws sharing state are submitted together and each run is drawn front to back as one instanced draw
+	class DrawList
+	{
+	public:
+		// Key fields from the most significant bit
+		static constexpr uint32_t PassBits = 4;
+		static constexpr uint32_t PipelineBits = 8;
+		static constexpr uint32_t MeshBits = 12;
+		static constexpr uint32_t LODBits = 4;
+		static constexpr uint32_t MaterialBits = 12;
+		static constexpr uint32_t DepthBits = 24;
+		static_assert(PassBits + PipelineBits + MeshBits + LODBits + MaterialBits + DepthBits == 64);
+
+		static constexpr uint32_t DefaultPacketsPerChunk = 256;
+
+		// Depth is clamped to [0, 1] and quantized, smaller depths sort first
+		static uint64_t MakeSortKey(const uint32_t pass, const uint32_t pipeline, const uint32_t mesh, const uint32_t lodIndex, const uint32_t material,
+			const float depth);
+
+		// Removes every packet, storage is kept for the next frame
+		void Clear();
+		// Pipelines and meshes are given key ids in the order they are first added
+		void Add(const uint32_t pass, GraphicsPipelineBase* pPipeline, const Mesh& mesh, const uint32_t lodIndex, const uint32_t material, const float depth,
+			const TransformMatrices& matrices, const glm::vec4& color, const bool lit);
+		// Draws each index range of the mesh as a single instance. Ranges are copied, so the source can be reused once this returns
+		void AddRanges(const uint32_t pass, GraphicsPipelineBase* pPipeline, const Mesh& mesh, const std::vector<IndexRange>& ranges, const uint32_t material,
+			const float depth, const TransformMatrices& matrices, const glm::vec4& color, const bool lit);
+		// Orders packets by key with a least significant digit radix sort, skipping digits every key shares
+		void Sort();
+		// Submits the sorted packets of a pass. Pipelines are bound as they change and onPipelineBound is called after each so pass wide
+		// root parameters can be set. Mesh and root parameter bindings matching the bound state are skipped by the renderer
+		void Submit(const uint32_t pass, UINT instanceDataParameterIndex, const std::function<void(GraphicsPipelineBase*)>& onPipelineBound);
+		// Submits the sorted packets of a pass in chunks recorded in parallel, each into its own command list. Chunks hold at least
+		// minPacketsPerChunk packets, so small passes are submitted as one. Each chunk binds its first pipeline again and calls
+		// onPipelineBound from the thread recording it. Separate passes may be submitted at the same time
+		void SubmitParallel(const uint32_t pass, UINT instanceDataParameterIndex, const std::function<void(GraphicsPipelineBase*)>& onPipelineBound,
+			const uint32_t minPacketsPerChunk = DefaultPacketsPerChunk);
+
+		const DrawListStatistics& GetStatistics() const { return Statistics; }
+
+	private:
+		struct Packet
+		{
+			GraphicsPipelineBase* pPipeline = nullptr;
+			const Mesh* pMesh = nullptr;
+			uint32_t LODIndex = 0;
+			// Packets with ranges are drawn one range at a time and never merged with other packets
+			uint32_t RangeOffset = 0;
+			uint32_t RangeCount = 0;
+			InstanceData Instance;
+		};
+
+		// Packets sharing every key field above material are drawn as one run
+		static constexpr uint32_t RunShift = MaterialBits + DepthBits;
+
+		// Returns the position of the pointer in ids, adding it if missing
+		static uint32_t FindOrAddId(std::vector<const void*>& ids, const void* p, const uint32_t bits);
+		Packet& AddPacket(const uint32_t pass, GraphicsPipelineBase* pPipeline, const Mesh& mesh, const uint32_t lodIndex, const uint32_t material,
+			const float depth, const TransformMatrices& matrices, const glm::vec4& color, const bool lit);
+		// Sorted packets of the pass are [outBegin, outEnd)
+		void GetPassRange(const uint32_t pass, size_t& outBegin, size_t& outEnd) const;
+		void SubmitRange(const size_t begin, const size_t end, UINT instanceDataParameterIndex, const std::function<void(GraphicsPipelineBase*)>& onPipelineBound);
+
+	private:
+		std::vector<Packet> Packets;
+		std::vector<IndexRange> Ranges;
+		std::vector<const void*> PipelineIds;
+		std::vector<const void*> MeshIds;
+
+		// Keys and packet indices are sorted together, packets stay where they were added
+		std::vector<uint64_t> Keys;
+		std::vector<uint32_t> Order;
+		std::vector<uint64_t> ScratchKeys;
+		std::vector<uint32_t> ScratchOrder;
+		bool Sorted = true;
+
+		DrawListStatistics Statistics;
+		// Guards statistics while passes are submitted in parallel
+		std::mutex StatisticsMutex;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "Pch.h"
+#include "FrustumCulling.h"
+#include <xmmintrin.h>
+
+namespace
+{
+	constexpr size_t SIMD_WIDTH = 4;
+
+	size_t PaddedCount(const size_t count)
+	{
+		return (count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+	}
+}
+
+void Renderer::CullingBoxes::Resize(const size_t count)
+{
+	// Padding boxes are empty and never reported, as lanes past the count are masked out
+	Count = count;
+	auto paddedCount = PaddedCount(count);
+	CenterX.resize(paddedCount, 0.0f);
+	CenterY.resize(paddedCount, 0.0f);
+	CenterZ.resize(paddedCount, 0.0f);
+	HalfExtentX.resize(paddedCount, 0.0f);
+	HalfExtentY.resize(paddedCount, 0.0f);
+	HalfExtentZ.resize(paddedCount, 0.0f);
+}
+
+void Renderer::CullingBoxes::Set(const uint32_t index, const Math::AABB& box)
+{
+	assert(index < Count && "Culling box index out of range.");
+	CenterX[index] = box.Center.x;
+	CenterY[index] = box.Center.y;
+	CenterZ[index] = box.Center.z;
+	HalfExtentX[index] = box.HalfExtent.x;
+	HalfExtentY[index] = box.HalfExtent.y;
+	HalfExtentZ[index] = box.HalfExtent.z;
+}
+
+void Renderer::CullingBoxes::Set(const uint32_t index, const Math::AABB& localBox, const glm::mat4& worldMatrix)
+{
+	Set(index, Math::TransformAABB(localBox, worldMatrix));
+}
+
+Math::AABB Renderer::CullingBoxes::Get(const uint32_t index) const
+{
+	assert(index < Count && "Culling box index out of range.");
+	Math::AABB box;
+	box.Center = glm::vec3(CenterX[index], CenterY[index], CenterZ[index]);
+	box.HalfExtent = glm::vec3(HalfExtentX[index], HalfExtentY[index], HalfExtentZ[index]);
+	return box;
+}
+
+void Renderer::CullBoxes(const CullingBoxes& boxes, const Math::Frustum& frustum, std::vector<uint32_t>& visibleIndices)
+{
+	visibleIndices.clear();
+
+	// Plane components broadcast once, absolute normals give the projected half extent of a box onto each plane
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6], absPlaneX[6], absPlaneY[6], absPlaneZ[6];
+	for (size_t i = 0; i < 6; ++i)
+	{
+		const auto& plane = frustum.Planes[i];
+		planeX[i] = _mm_set1_ps(plane.x);
+		planeY[i] = _mm_set1_ps(plane.y);
+		planeZ[i] = _mm_set1_ps(plane.z);
+		planeW[i] = _mm_set1_ps(plane.w);
+		absPlaneX[i] = _mm_set1_ps(std::abs(plane.x));
+		absPlaneY[i] = _mm_set1_ps(std::abs(plane.y));
+		absPlaneZ[i] = _mm_set1_ps(std::abs(plane.z));
+	}
+
+	const auto count = boxes.GetCount();
+	for (size_t first = 0; first < count; first += SIMD_WIDTH)
+	{
+		const auto centerX = _mm_loadu_ps(boxes.CenterX.data() + first);
+		const auto centerY = _mm_loadu_ps(boxes.CenterY.data() + first);
+		const auto centerZ = _mm_loadu_ps(boxes.CenterZ.data() + first);
+		const auto halfExtentX = _mm_loadu_ps(boxes.HalfExtentX.data() + first);
+		const auto halfExtentY = _mm_loadu_ps(boxes.HalfExtentY.data() + first);
+		const auto halfExtentZ = _mm_loadu_ps(boxes.HalfExtentZ.data() + first);
+
+		// A box is outside when it is fully behind any plane, distance + radius < 0
+		auto outside = _mm_setzero_ps();
+		for (size_t i = 0; i < 6; ++i)
+		{
+			auto distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[i], centerX), _mm_mul_ps(planeY[i], centerY)),
+				_mm_add_ps(_mm_mul_ps(planeZ[i], centerZ), planeW[i]));
+			auto radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absPlaneX[i], halfExtentX), _mm_mul_ps(absPlaneY[i], halfExtentY)),
+				_mm_mul_ps(absPlaneZ[i], halfExtentZ));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+
+		// Append visible lanes, masking out padding lanes past the box count
+		auto visibleMask = ~_mm_movemask_ps(outside) & ((1 << std::min(SIMD_WIDTH, count - first)) - 1);
+		while (visibleMask != 0)
+		{
+			auto lane = 0;
+			while (!(visibleMask & (1 << lane)))
+			{
+				++lane;
+			}
+			visibleIndices.push_back(static_cast<uint32_t>(first + lane));
+			visibleMask &= visibleMask - 1;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Math/Math.h"
+
+namespace Renderer
+{
+	// World space bounding boxes stored as separate arrays, padded to a multiple of four so four boxes can be tested per SSE instruction
+	class CullingBoxes
+	{
+	public:
+		void Resize(const size_t count);
+		size_t GetCount() const { return Count; }
+		void Set(const uint32_t index, const Math::AABB& box);
+		// Transforms a mesh space box into world space and stores it
+		void Set(const uint32_t index, const Math::AABB& localBox, const glm::mat4& worldMatrix);
+		Math::AABB Get(const uint32_t index) const;
+
+	private:
+		friend void CullBoxes(const CullingBoxes&, const Math::Frustum&, std::vector<uint32_t>&);
+
+		size_t Count = 0;
+		std::vector<float> CenterX;
+		std::vector<float> CenterY;
+		std::vector<float> CenterZ;
+		std::vector<float> HalfExtentX;
+		std::vector<float> HalfExtentY;
+		std::vector<float> HalfExtentZ;
+	};
+
+	// Replaces visibleIndices with the indices of the boxes intersecting the frustum, in ascending order
+	void CullBoxes(const CullingBoxes& boxes, const Math::Frustum& frustum, std::vector<uint32_t>& visibleIndices);
+}
\ No newline at end of file
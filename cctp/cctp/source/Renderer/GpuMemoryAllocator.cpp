@@ -0,0 +1,320 @@
+#include "Pch.h"
+#include "GpuMemoryAllocator.h"
+
+namespace
+{
+	bool IsBufferPool(const Renderer::GpuMemoryPool pool)
+	{
+		return pool == Renderer::GpuMemoryPool::Geometry || pool == Renderer::GpuMemoryPool::AccelerationStructure ||
+			pool == Renderer::GpuMemoryPool::Scratch;
+	}
+
+	// Acceleration structures and their scratch need 256 byte alignment, which also covers vertex and index buffer views.
+	// Placed textures are at least 64KB aligned
+	UINT64 GetPoolGranularity(const Renderer::GpuMemoryPool pool)
+	{
+		return IsBufferPool(pool) ? D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	}
+}
+
+bool Renderer::GpuMemoryAllocator::Init(ID3D12Device* pDevice, const UINT64 blockSize)
+{
+	assert(blockSize % D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT == 0 && "Block size must be a multiple of the placement alignment.");
+
+	this->pDevice = pDevice;
+	BlockSize = blockSize;
+	for (auto& pool : Pools)
+	{
+		pool.Blocks.clear();
+	}
+	PendingFrees.clear();
+	FrameSerial = 0;
+	return true;
+}
+
+bool Renderer::GpuMemoryAllocator::AllocateBuffer(const GpuMemoryPool pool, const UINT64 size, const UINT64 alignment, GpuBufferAllocation& outAllocation)
+{
+	assert(IsBufferPool(pool) && "Buffers must be allocated from a buffer pool.");
+	// Pool buffers start at the placement alignment, larger alignments can not be guaranteed within them
+	assert(alignment <= D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT && "Buffer alignment is larger than a pool buffer's.");
+
+	uint32_t block;
+	TlsfAllocation allocation;
+	if (!Allocate(pool, size, alignment, block, allocation))
+	{
+		return false;
+	}
+
+	const Block& poolBlock = Pools[static_cast<size_t>(pool)].Blocks[block];
+	outAllocation.pResource = poolBlock.Buffer.Get();
+	outAllocation.Offset = allocation.Offset;
+	outAllocation.Size = allocation.Size;
+	outAllocation.GPUAddress = poolBlock.GPUAddress + allocation.Offset;
+	outAllocation.Pool = pool;
+	outAllocation.Block = block;
+	outAllocation.Allocation = allocation.Block;
+	return true;
+}
+
+bool Renderer::GpuMemoryAllocator::CreateTexture(const D3D12_RESOURCE_DESC& desc, const D3D12_RESOURCE_STATES initialState,
+	const D3D12_CLEAR_VALUE* pClearValue, GpuTextureAllocation& outAllocation)
+{
+	assert(desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER && "Buffers must be allocated with AllocateBuffer.");
+
+	const auto allocationInfo = pDevice->GetResourceAllocationInfo(0, 1, &desc);
+	const GpuMemoryPool pool = (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0 ?
+		GpuMemoryPool::TargetTextures : GpuMemoryPool::Textures;
+
+	uint32_t block;
+	TlsfAllocation allocation;
+	if (!Allocate(pool, allocationInfo.SizeInBytes, allocationInfo.Alignment, block, allocation))
+	{
+		return false;
+	}
+
+	if (FAILED(pDevice->CreatePlacedResource(Pools[static_cast<size_t>(pool)].Blocks[block].Heap.Get(), allocation.Offset, &desc,
+		initialState, pClearValue, IID_PPV_ARGS(&outAllocation.Resource))))
+	{
+		DEBUG_LOG("ERROR: Failed to create placed texture.");
+		PendingFree failed;
+		failed.Pool = pool;
+		failed.Block = block;
+		failed.Allocation = allocation.Block;
+		Release(failed);
+		return false;
+	}
+
+	outAllocation.Size = allocation.Size;
+	outAllocation.Pool = pool;
+	outAllocation.Block = block;
+	outAllocation.Allocation = allocation.Block;
+	return true;
+}
+
+void Renderer::GpuMemoryAllocator::Free(GpuBufferAllocation& allocation)
+{
+	assert(allocation.pResource != nullptr && "Buffer is not allocated.");
+
+	PendingFree& pending = PendingFrees.emplace_back();
+	pending.Pool = allocation.Pool;
+	pending.Block = allocation.Block;
+	pending.Allocation = allocation.Allocation;
+	pending.Size = allocation.Size;
+	pending.RetireSerial = FrameSerial;
+	allocation = GpuBufferAllocation();
+}
+
+void Renderer::GpuMemoryAllocator::Free(GpuTextureAllocation& allocation)
+{
+	assert(allocation.Resource != nullptr && "Texture is not allocated.");
+
+	PendingFree& pending = PendingFrees.emplace_back();
+	pending.Pool = allocation.Pool;
+	pending.Block = allocation.Block;
+	pending.Allocation = allocation.Allocation;
+	pending.Size = allocation.Size;
+	pending.Resource = std::move(allocation.Resource);
+	pending.RetireSerial = FrameSerial;
+	allocation = GpuTextureAllocation();
+}
+
+void Renderer::GpuMemoryAllocator::BeginFrame(const uint64_t frameSerial, const uint64_t completedSerial)
+{
+	std::erase_if(PendingFrees, [this, completedSerial](const PendingFree& pending)
+		{
+			if (pending.RetireSerial > completedSerial)
+			{
+				return false;
+			}
+
+			Release(pending);
+			return true;
+		});
+
+	FrameSerial = frameSerial;
+}
+
+Renderer::GpuMemoryPoolStatistics Renderer::GpuMemoryAllocator::GetStatistics(const GpuMemoryPool pool) const
+{
+	GpuMemoryPoolStatistics statistics;
+	UINT64 freeBytes = 0;
+	UINT64 largestFreeBytes = 0;
+	for (const auto& block : Pools[static_cast<size_t>(pool)].Blocks)
+	{
+		if (block.Buffer == nullptr && block.Heap == nullptr)
+		{
+			continue;
+		}
+
+		const auto blockStatistics = block.Allocator.GetStatistics();
+		++statistics.BlockCount;
+		statistics.DedicatedBlockCount += block.Dedicated ? 1 : 0;
+		statistics.ReservedBytes += blockStatistics.Capacity;
+		statistics.UsedBytes += blockStatistics.UsedBytes;
+		statistics.LargestFreeBlock = std::max(statistics.LargestFreeBlock, blockStatistics.LargestFreeBlock);
+		statistics.AllocationCount += blockStatistics.AllocationCount;
+		statistics.FreeBlockCount += blockStatistics.FreeBlockCount;
+		freeBytes += blockStatistics.FreeBytes;
+		largestFreeBytes += blockStatistics.LargestFreeBlock;
+	}
+
+	for (const auto& pending : PendingFrees)
+	{
+		statistics.PendingFreeBytes += pending.Pool == pool ? pending.Size : 0;
+	}
+
+	if (freeBytes > 0)
+	{
+		statistics.Fragmentation = 1.0f - static_cast<float>(largestFreeBytes) / static_cast<float>(freeBytes);
+	}
+	return statistics;
+}
+
+const char* Renderer::GpuMemoryAllocator::GetPoolName(const GpuMemoryPool pool)
+{
+	switch (pool)
+	{
+	case GpuMemoryPool::Geometry: return "Geometry";
+	case GpuMemoryPool::AccelerationStructure: return "Acceleration structures";
+	case GpuMemoryPool::Scratch: return "Scratch";
+	case GpuMemoryPool::Textures: return "Textures";
+	case GpuMemoryPool::TargetTextures: return "Target textures";
+	default: return "Unknown";
+	}
+}
+
+bool Renderer::GpuMemoryAllocator::Allocate(const GpuMemoryPool pool, const UINT64 size, const UINT64 alignment, uint32_t& outBlock,
+	TlsfAllocation& outAllocation)
+{
+	auto& blocks = Pools[static_cast<size_t>(pool)].Blocks;
+	const UINT64 granularity = GetPoolGranularity(pool);
+
+	// Allocations too large for a block, or aligned beyond what a block's start guarantees, get a block of their own
+	if (size > BlockSize || alignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)
+	{
+		const UINT64 dedicatedSize = (size + granularity - 1) & ~(granularity - 1);
+		if (!CreateBlock(pool, dedicatedSize, alignment, true, outBlock))
+		{
+			return false;
+		}
+
+		const bool allocated = blocks[outBlock].Allocator.Allocate(size, alignment, outAllocation);
+		assert(allocated && "Dedicated block can not hold its allocation.");
+		return allocated;
+	}
+
+	for (uint32_t block = 0; block < blocks.size(); ++block)
+	{
+		if (!blocks[block].Dedicated && (blocks[block].Buffer != nullptr || blocks[block].Heap != nullptr) &&
+			blocks[block].Allocator.Allocate(size, alignment, outAllocation))
+		{
+			outBlock = block;
+			return true;
+		}
+	}
+
+	if (!CreateBlock(pool, BlockSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, false, outBlock))
+	{
+		return false;
+	}
+
+	const bool allocated = blocks[outBlock].Allocator.Allocate(size, alignment, outAllocation);
+	assert(allocated && "New block can not hold an allocation smaller than a block.");
+	return allocated;
+}
+
+bool Renderer::GpuMemoryAllocator::CreateBlock(const GpuMemoryPool pool, const UINT64 size, const UINT64 alignment, const bool dedicated,
+	uint32_t& outBlock)
+{
+	Block block;
+	if (IsBufferPool(pool))
+	{
+		D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE;
+		D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON;
+		if (pool == GpuMemoryPool::AccelerationStructure)
+		{
+			flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+			state = D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE;
+		}
+		else if (pool == GpuMemoryPool::Scratch)
+		{
+			flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+			state = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+		}
+
+		auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+		auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(size, flags);
+		if (FAILED(pDevice->CreateCommittedResource(&heapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&resourceDesc,
+			state,
+			nullptr,
+			IID_PPV_ARGS(&block.Buffer))))
+		{
+			DEBUG_LOG(std::string("ERROR: Failed to create ") + GetPoolName(pool) + " pool buffer.");
+			return false;
+		}
+		block.GPUAddress = block.Buffer->GetGPUVirtualAddress();
+	}
+	else
+	{
+		D3D12_HEAP_DESC heapDesc = {};
+		heapDesc.SizeInBytes = size;
+		heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+		heapDesc.Alignment = std::max<UINT64>(alignment, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+		heapDesc.Flags = pool == GpuMemoryPool::TargetTextures ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+		if (FAILED(pDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&block.Heap))))
+		{
+			DEBUG_LOG(std::string("ERROR: Failed to create ") + GetPoolName(pool) + " pool heap.");
+			return false;
+		}
+	}
+
+	// Set a debug name for the block
+	const std::string poolName = GetPoolName(pool);
+	const std::wstring blockName = std::wstring(poolName.begin(), poolName.end()) + (dedicated ? L" dedicated block" : L" pool block");
+	if (FAILED(block.Buffer != nullptr ? block.Buffer->SetName(blockName.c_str()) : block.Heap->SetName(blockName.c_str())))
+	{
+		DEBUG_LOG("ERROR: Failed to set debug name for pool block.");
+	}
+
+	block.Allocator.Init(size, GetPoolGranularity(pool));
+	block.Dedicated = dedicated;
+
+	auto& blocks = Pools[static_cast<size_t>(pool)].Blocks;
+	const auto slot = std::find_if(blocks.begin(), blocks.end(), [](const Block& existing) { return existing.Buffer == nullptr && existing.Heap == nullptr; });
+	if (slot != blocks.end())
+	{
+		*slot = std::move(block);
+		outBlock = static_cast<uint32_t>(slot - blocks.begin());
+	}
+	else
+	{
+		blocks.push_back(std::move(block));
+		outBlock = static_cast<uint32_t>(blocks.size() - 1);
+	}
+	return true;
+}
+
+void Renderer::GpuMemoryAllocator::Release(const PendingFree& pending)
+{
+	Block& block = Pools[static_cast<size_t>(pending.Pool)].Blocks[pending.Block];
+	block.Allocator.Free(pending.Allocation);
+
+	if (!block.Allocator.IsEmpty())
+	{
+		return;
+	}
+
+	// Dedicated blocks hold a single allocation, their memory goes back to the device. An empty shared block is kept while it is the
+	// pool's only one, so allocating and freeing around a single block does not create and release it each time
+	const auto& blocks = Pools[static_cast<size_t>(pending.Pool)].Blocks;
+	const bool otherSharedBlock = std::any_of(blocks.begin(), blocks.end(), [&block](const Block& other)
+		{
+			return &other != &block && !other.Dedicated && (other.Buffer != nullptr || other.Heap != nullptr);
+		});
+	if (block.Dedicated || otherSharedBlock)
+	{
+		block = Block();
+	}
+}
\ No newline at end of file
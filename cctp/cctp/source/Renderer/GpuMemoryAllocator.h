@@ -0,0 +1,138 @@
+#pragma once
+
+#include "TlsfAllocator.h"
+
+namespace Renderer
+{
+	// Pools of GPU memory, each sub-allocated by its own two level segregated fit allocators
+	enum class GpuMemoryPool : uint32_t
+	{
+		// Vertex and index buffers. Pool buffers are created in the common state, which buffers leave and return to implicitly for
+		// copies and reads, so sub-allocations never need barriers of their own
+		Geometry = 0,
+		// Acceleration structures, in pool buffers that stay in the acceleration structure state
+		AccelerationStructure,
+		// Acceleration structure build scratch, in pool buffers that stay in the unordered access state
+		Scratch,
+		// Textures placed in heaps. Render targets and depth stencils get their own heaps as resource heap tier 1 cannot mix them with
+		// other textures
+		Textures,
+		TargetTextures,
+
+		Count
+	};
+
+	struct GpuBufferAllocation
+	{
+		// The pool buffer holding the allocation, shared with other allocations
+		ID3D12Resource* pResource = nullptr;
+		UINT64 Offset = 0;
+		UINT64 Size = 0;
+		D3D12_GPU_VIRTUAL_ADDRESS GPUAddress = 0;
+
+		GpuMemoryPool Pool = GpuMemoryPool::Count;
+		uint32_t Block = TlsfAllocator::InvalidBlock;
+		uint32_t Allocation = TlsfAllocator::InvalidBlock;
+	};
+
+	struct GpuTextureAllocation
+	{
+		// Placed in a pool heap, released when the allocation is freed
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		UINT64 Size = 0;
+
+		GpuMemoryPool Pool = GpuMemoryPool::Count;
+		uint32_t Block = TlsfAllocator::InvalidBlock;
+		uint32_t Allocation = TlsfAllocator::InvalidBlock;
+	};
+
+	struct GpuMemoryPoolStatistics
+	{
+		uint32_t BlockCount = 0;
+		uint32_t DedicatedBlockCount = 0;
+		UINT64 ReservedBytes = 0;
+		UINT64 UsedBytes = 0;
+		UINT64 LargestFreeBlock = 0;
+		uint32_t AllocationCount = 0;
+		uint32_t FreeBlockCount = 0;
+		// Bytes freed but possibly still used by frames in flight
+		UINT64 PendingFreeBytes = 0;
+		// Share of each block's free bytes outside its largest free block, 0 when no block is split
+		float Fragmentation = 0.0f;
+	};
+
+	// Sub-allocates buffers and textures from large blocks instead of creating a committed resource each. Buffer pools are blocks of one
+	// large buffer handing out ranges of it, since placed buffers would each need 64KB alignment. Texture pools are blocks of one heap
+	// with textures placed in it. Allocations larger than a block get a dedicated block of their own, and blocks left empty are released
+	// once the pool has another. Frees are deferred until the frame they were made in has completed, so memory frames in flight may use
+	// is never reused early. Not thread safe
+	class GpuMemoryAllocator
+	{
+	public:
+		static constexpr UINT64 DefaultBlockSize = 16 * 1024 * 1024;
+
+		GpuMemoryAllocator() = default;
+		GpuMemoryAllocator(const GpuMemoryAllocator&) = delete;
+		GpuMemoryAllocator& operator=(const GpuMemoryAllocator&) = delete;
+
+		bool Init(ID3D12Device* pDevice, const UINT64 blockSize = DefaultBlockSize);
+
+		// Pool must be a buffer pool and alignment a power of two
+		bool AllocateBuffer(const GpuMemoryPool pool, const UINT64 size, const UINT64 alignment, GpuBufferAllocation& outAllocation);
+		// Places the texture in the pool its flags require. Multisampled textures, which need larger alignment than the heaps, get a
+		// dedicated block
+		bool CreateTexture(const D3D12_RESOURCE_DESC& desc, const D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* pClearValue,
+			GpuTextureAllocation& outAllocation);
+		// The memory is reused once the completed serial passed to BeginFrame reaches the serial of the frame the free was made in
+		void Free(GpuBufferAllocation& allocation);
+		void Free(GpuTextureAllocation& allocation);
+
+		// Returns frees whose frame has completed to their blocks, and makes later frees wait for frameSerial
+		void BeginFrame(const uint64_t frameSerial, const uint64_t completedSerial);
+
+		GpuMemoryPoolStatistics GetStatistics(const GpuMemoryPool pool) const;
+
+		static const char* GetPoolName(const GpuMemoryPool pool);
+
+	private:
+		struct Block
+		{
+			// Buffer pools own a buffer, texture pools a heap
+			Microsoft::WRL::ComPtr<ID3D12Resource> Buffer;
+			Microsoft::WRL::ComPtr<ID3D12Heap> Heap;
+			D3D12_GPU_VIRTUAL_ADDRESS GPUAddress = 0;
+			TlsfAllocator Allocator;
+			bool Dedicated = false;
+		};
+
+		struct Pool
+		{
+			// Released dedicated blocks leave an empty slot, reused by the next block created
+			std::vector<Block> Blocks;
+		};
+
+		struct PendingFree
+		{
+			GpuMemoryPool Pool = GpuMemoryPool::Count;
+			uint32_t Block = TlsfAllocator::InvalidBlock;
+			uint32_t Allocation = TlsfAllocator::InvalidBlock;
+			UINT64 Size = 0;
+			// Placed textures are kept alive until the frame completes
+			Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+			uint64_t RetireSerial = 0;
+		};
+
+		// Finds room in an existing block, or creates one. Returns the block index and the allocation within it
+		bool Allocate(const GpuMemoryPool pool, const UINT64 size, const UINT64 alignment, uint32_t& outBlock, TlsfAllocation& outAllocation);
+		bool CreateBlock(const GpuMemoryPool pool, const UINT64 size, const UINT64 alignment, const bool dedicated, uint32_t& outBlock);
+		void Release(const PendingFree& pending);
+
+	private:
+		ID3D12Device* pDevice = nullptr;
+		UINT64 BlockSize = DefaultBlockSize;
+
+		std::array<Pool, static_cast<size_t>(GpuMemoryPool::Count)> Pools;
+		std::vector<PendingFree> PendingFrees;
+		uint64_t FrameSerial = 0;
+	};
+}
\ No newline at end of file
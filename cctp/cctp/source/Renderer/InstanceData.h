@@ -0,0 +1,20 @@
+#pragma once
+
+struct TransformMatrices;
+
+namespace Renderer
+{
+	// Per instance data read by the vertex shaders from a structured buffer indexed by SV_InstanceID.
+	// Layout matches InstanceData in Common.hlsl, padded to a multiple of 16 bytes
+	struct InstanceData
+	{
+		glm::mat4 WorldMatrix = glm::identity<glm::mat4>();
+		glm::mat4 NormalMatrix = glm::identity<glm::mat4>();
+		glm::vec4 Color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+		uint32_t Lit = true;
+		uint32_t Padding[3] = {};
+	};
+	static_assert(sizeof(InstanceData) % 16 == 0);
+
+	InstanceData MakeInstanceData(const TransformMatrices& matrices, const glm::vec4& color, const bool lit);
+}
\ No newline at end of file
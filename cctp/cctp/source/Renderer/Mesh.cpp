@@ -1,50 +1,111 @@
 #include "Pch.h"
 #include "Mesh.h"
 
-Renderer::Mesh::Mesh(ID3D12Device* pDevice, const std::vector<Vertex1Pos1UV1Norm>& vertices, 
-    const std::vector<uint32_t> indices, const std::wstring& name)
-	: Vertices(vertices), Indices(indices)
+Renderer::Mesh::Mesh(GpuMemoryAllocator& memoryAllocator, std::vector<Vertex1Pos1UV1Norm>&& vertices, 
+    std::vector<uint32_t>&& indices, const std::wstring& name, const bool keepCPUData)
+	: Vertices(std::move(vertices)), Indices(std::move(indices)), KeepCPUData(keepCPUData), pMemoryAllocator(&memoryAllocator)
 {
-    auto CreateDefaultHeap = [](ID3D12Device* pDevice, const size_t bufferWidth, const void* pBufferData,
-        Microsoft::WRL::ComPtr<ID3D12Resource>& resource, const std::wstring& name)
+    VertexData = reinterpret_cast<const uint8_t*>(Vertices.data());
+    VertexDataSize = sizeof(Vertex1Pos1UV1Norm) * Vertices.size();
+    IndexData = Indices.data();
+    IndexDataCount = Indices.size();
+
+    if (!Vertices.empty())
     {
-        // Create default heap for mesh data on the GPU
-        auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-        auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferWidth);
-
-        if (FAILED(pDevice->CreateCommittedResource(&heapProperties,
-            D3D12_HEAP_FLAG_NONE,
-            &resourceDesc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            nullptr,
-            IID_PPV_ARGS(&resource)))
-            )
+        auto min = Vertices[0].Position;
+        auto max = Vertices[0].Position;
+        for (const auto& vertex : Vertices)
         {
-            assert(false && "Failed to create default heap for mesh buffer.");
+            min = glm::min(min, vertex.Position);
+            max = glm::max(max, vertex.Position);
         }
+        LocalBounds.Center = (min + max) * 0.5f;
+        LocalBounds.HalfExtent = (max - min) * 0.5f;
+    }
 
-        // Set a debug name for the resource
-        if (FAILED(resource->SetName(name.c_str())))
-        {
-            assert(false && "Failed to set debug name for buffer.");
-        }
-    };
+    CreateBuffers(sizeof(Vertex1Pos1UV1Norm), name);
+}
+
+Renderer::Mesh::Mesh(GpuMemoryAllocator& memoryAllocator, std::vector<CompressedVertex1Pos1UV1Norm>&& vertices, const VertexCompression::QuantizationBounds& bounds,
+    std::vector<uint32_t>&& indices, const std::wstring& name, const bool keepCPUData)
+	: CompressedVertices(std::move(vertices)), Indices(std::move(indices)), KeepCPUData(keepCPUData), pMemoryAllocator(&memoryAllocator),
+    PositionFormat(DXGI_FORMAT_R16G16B16A16_SNORM), DequantizationMatrix(VertexCompression::CalculateDequantizationMatrix(bounds)), QuantizationBounds(bounds)
+{
+    VertexData = reinterpret_cast<const uint8_t*>(CompressedVertices.data());
+    VertexDataSize = sizeof(CompressedVertex1Pos1UV1Norm) * CompressedVertices.size();
+    IndexData = Indices.data();
+    IndexDataCount = Indices.size();
+
+    // Quantized positions cover the quantization bounds
+    LocalBounds.Center = bounds.Center;
+    LocalBounds.HalfExtent = bounds.HalfExtent;
+
+    CreateBuffers(sizeof(CompressedVertex1Pos1UV1Norm), name);
+}
 
-    auto vertexBufferWidth = sizeof(Vertex1Pos1UV1Norm) * vertices.size();
-    auto indexBufferWidth = sizeof(uint32_t) * indices.size();
+Renderer::Mesh::Mesh(GpuMemoryAllocator& memoryAllocator, std::shared_ptr<const MeshCache::MappedMesh> mappedMesh, const std::wstring& name, const bool keepCPUData)
+    : MappedMesh(std::move(mappedMesh)), KeepCPUData(keepCPUData), pMemoryAllocator(&memoryAllocator)
+{
+    const auto& header = MappedMesh->GetHeader();
+    VertexData = MappedMesh->GetVertexData();
+    VertexDataSize = static_cast<size_t>(header.VertexSize);
+    IndexData = MappedMesh->GetIndexData();
+    IndexDataCount = header.IndexCount;
+
+    PositionFormat = static_cast<DXGI_FORMAT>(header.PositionFormat);
+    LocalBounds.Center = header.Bounds.Center;
+    LocalBounds.HalfExtent = header.Bounds.HalfExtent;
+    if (IsCompressed())
+    {
+        QuantizationBounds = header.Bounds;
+        DequantizationMatrix = VertexCompression::CalculateDequantizationMatrix(QuantizationBounds);
+    }
+
+    CreateBuffers(header.VertexStride, name);
+    SetLODs(std::vector<MeshLOD>(MappedMesh->GetLODs(), MappedMesh->GetLODs() + header.LODCount));
+}
 
-    CreateDefaultHeap(pDevice, vertexBufferWidth, vertices.data(), VertexBuffer, name);
-    CreateDefaultHeap(pDevice, indexBufferWidth, indices.data(), IndexBuffer, name);
+Renderer::Mesh::~Mesh()
+{
+    // Frees are deferred until the current frame completes, so frames in flight can still draw the mesh
+    if (VertexAllocation.pResource != nullptr)
+    {
+        pMemoryAllocator->Free(VertexAllocation);
+    }
+    if (IndexAllocation.pResource != nullptr)
+    {
+        pMemoryAllocator->Free(IndexAllocation);
+    }
+}
 
-    VertexBufferView.BufferLocation = VertexBuffer->GetGPUVirtualAddress();
+void Renderer::Mesh::CreateBuffers(const size_t vertexStride, const std::wstring& name)
+{
+    auto vertexBufferWidth = VertexDataSize;
+    auto indexBufferWidth = sizeof(uint32_t) * IndexDataCount;
+
+    // Pool allocations are 256 byte aligned, a multiple of every vertex stride, so buffer views can start at their offsets.
+    // Contents are copied in by LoadStagedMeshesOntoGPU
+    if (!pMemoryAllocator->AllocateBuffer(GpuMemoryPool::Geometry, vertexBufferWidth, vertexStride, VertexAllocation) ||
+        !pMemoryAllocator->AllocateBuffer(GpuMemoryPool::Geometry, indexBufferWidth, sizeof(uint32_t), IndexAllocation))
+    {
+        DEBUG_LOG("ERROR: Failed to allocate buffers for mesh " + std::string(name.begin(), name.end()) + ".");
+        assert(false && "Failed to allocate mesh buffers.");
+    }
+    assert(VertexAllocation.Offset % vertexStride == 0 && "Vertex buffer offset is not a multiple of the vertex stride.");
+
+    VertexBufferView.BufferLocation = VertexAllocation.GPUAddress;
     VertexBufferView.SizeInBytes = static_cast<UINT32>(vertexBufferWidth);
-    VertexBufferView.StrideInBytes = sizeof(Vertex1Pos1UV1Norm);
+    VertexBufferView.StrideInBytes = static_cast<UINT32>(vertexStride);
 
-    IndexBufferView.BufferLocation = IndexBuffer->GetGPUVirtualAddress();
+    IndexBufferView.BufferLocation = IndexAllocation.GPUAddress;
     IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
     IndexBufferView.SizeInBytes = static_cast<UINT32>(indexBufferWidth);
 
-    VertexBufferSRVDesc.Buffer.FirstElement = 0;
+    MeshLOD lod = {};
+    lod.IndexCount = static_cast<uint32_t>(IndexDataCount);
+    LODs.push_back(lod);
+
+    VertexBufferSRVDesc.Buffer.FirstElement = VertexAllocation.Offset / vertexStride;
     VertexBufferSRVDesc.Buffer.NumElements = VertexBufferView.SizeInBytes / VertexBufferView.StrideInBytes;
     VertexBufferSRVDesc.Buffer.StructureByteStride = VertexBufferView.StrideInBytes;
     VertexBufferSRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
@@ -52,11 +113,48 @@ Renderer::Mesh::Mesh(ID3D12Device* pDevice, const std::vector<Vertex1Pos1UV1Norm
     VertexBufferSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
     VertexBufferSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 
-    IndexBufferSRVDesc.Buffer.FirstElement = 0;
-    IndexBufferSRVDesc.Buffer.NumElements = static_cast<UINT>(Indices.size());
+    IndexBufferSRVDesc.Buffer.FirstElement = IndexAllocation.Offset / sizeof(UINT32);
+    IndexBufferSRVDesc.Buffer.NumElements = static_cast<UINT>(IndexDataCount);
     IndexBufferSRVDesc.Buffer.StructureByteStride = sizeof(UINT32);
     IndexBufferSRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
     IndexBufferSRVDesc.Format = DXGI_FORMAT_UNKNOWN;
     IndexBufferSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
     IndexBufferSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 }
+
+void Renderer::Mesh::SetLODs(const std::vector<MeshLOD>& lods)
+{
+    assert(!lods.empty() && "Mesh must have at least one level of detail.");
+    for (const auto& lod : lods)
+    {
+        assert(lod.IndexOffset + lod.IndexCount <= GetIndexCount() && "Level of detail is outside of the index buffer.");
+    }
+
+    LODs = lods;
+}
+
+void Renderer::Mesh::ReleaseCPUData()
+{
+    // Swapping with empty vectors frees their memory, clear would keep the capacity
+    std::vector<Vertex1Pos1UV1Norm>().swap(Vertices);
+    std::vector<CompressedVertex1Pos1UV1Norm>().swap(CompressedVertices);
+    std::vector<uint32_t>().swap(Indices);
+    MappedMesh.reset();
+
+    VertexData = nullptr;
+    IndexData = nullptr;
+}
+
+size_t Renderer::Mesh::GetResidentCPUBytes() const
+{
+    size_t bytes = sizeof(Mesh);
+    bytes += sizeof(Vertex1Pos1UV1Norm) * Vertices.capacity();
+    bytes += sizeof(CompressedVertex1Pos1UV1Norm) * CompressedVertices.capacity();
+    bytes += sizeof(uint32_t) * Indices.capacity();
+    bytes += sizeof(MeshLOD) * LODs.capacity();
+    if (MappedMesh)
+    {
+        bytes += MappedMesh->GetFileSize();
+    }
+    return bytes;
+}
\ No newline at end of file
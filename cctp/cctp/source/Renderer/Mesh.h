@@ -1,35 +1,96 @@
 #pragma once
 
 #include "Vertices/Vertex1Pos1UV1Norm.h"
+#include "VertexCompression.h"
+#include "MeshLOD.h"
+#include "MeshCache.h"
+#include "Math/Math.h"
+#include "GpuMemoryAllocator.h"
+#include "UploadQueue.h"
 
 namespace Renderer
 {
 	class Mesh
 	{
 	public:
-		Mesh(ID3D12Device* pDevice, const std::vector<Vertex1Pos1UV1Norm>& vertices, 
-			const std::vector<uint32_t> indices, const std::wstring& name);
-		size_t GetRequiredBufferWidthVertexBuffer() const { return sizeof(Vertex1Pos1UV1Norm) * Vertices.size(); }
-		size_t GetRequiredBufferWidthIndexBuffer() const { return sizeof(uint32_t) * Indices.size(); }
-		const Vertex1Pos1UV1Norm* GetVerticesData() const { return Vertices.data(); }
-		const uint32_t* GetIndicesData() const { return Indices.data(); }
-		ID3D12Resource* GetVertexBuffer() const { return VertexBuffer.Get(); }
-		ID3D12Resource* GetIndexBuffer() const { return IndexBuffer.Get(); }
+		// Vertex and index data are moved in and released once the mesh is loaded onto the GPU, unless keepCPUData is set
+		// Vertex and index buffers are sub-allocated from the memory allocator's geometry pool, which must outlive the mesh
+		Mesh(GpuMemoryAllocator& memoryAllocator, std::vector<Vertex1Pos1UV1Norm>&& vertices, 
+			std::vector<uint32_t>&& indices, const std::wstring& name, const bool keepCPUData = false);
+		// Positions of compressed meshes are dequantized by folding GetDequantizationMatrix into the world transform
+		Mesh(GpuMemoryAllocator& memoryAllocator, std::vector<CompressedVertex1Pos1UV1Norm>&& vertices, const VertexCompression::QuantizationBounds& bounds,
+			std::vector<uint32_t>&& indices, const std::wstring& name, const bool keepCPUData = false);
+		// Vertex and index data stay in the mapped cache file and are copied from the mapping when the mesh is loaded onto the GPU
+		Mesh(GpuMemoryAllocator& memoryAllocator, std::shared_ptr<const MeshCache::MappedMesh> mappedMesh, const std::wstring& name, const bool keepCPUData = false);
+		// Data pointers refer to the mesh's own vectors, so meshes are never copied
+		Mesh(const Mesh&) = delete;
+		Mesh& operator=(const Mesh&) = delete;
+		~Mesh();
+		size_t GetRequiredBufferWidthVertexBuffer() const { return VertexDataSize; }
+		size_t GetRequiredBufferWidthIndexBuffer() const { return sizeof(uint32_t) * IndexDataCount; }
+		// Null once CPU data has been released
+		const void* GetVerticesData() const { return VertexData; }
+		const uint32_t* GetIndicesData() const { return IndexData; }
+		bool HasCPUData() const { return VertexData != nullptr; }
+		bool KeepsCPUData() const { return KeepCPUData; }
+		// Frees the vertex and index vectors, or unmaps the cache file, after their contents have been uploaded
+		void ReleaseCPUData();
+		// Bytes held on the CPU by the mesh, including vector capacity and any mapped cache file
+		size_t GetResidentCPUBytes() const;
+		// Pool buffers shared with other meshes, the mesh's data starts at the buffer offset
+		ID3D12Resource* GetVertexBuffer() const { return VertexAllocation.pResource; }
+		ID3D12Resource* GetIndexBuffer() const { return IndexAllocation.pResource; }
+		UINT64 GetVertexBufferOffset() const { return VertexAllocation.Offset; }
+		UINT64 GetIndexBufferOffset() const { return IndexAllocation.Offset; }
+		// Buffer contents are valid on the GPU once the upload completes
+		void SetUploadTicket(const UploadTicket ticket) { Upload = ticket; }
+		UploadTicket GetUploadTicket() const { return Upload; }
 		const D3D12_VERTEX_BUFFER_VIEW& GetVertexBufferView() const { return VertexBufferView; }
 		const D3D12_INDEX_BUFFER_VIEW& GetIndexBufferView() const { return IndexBufferView; }
 		uint32_t GetIndexCount() const { return IndexBufferView.SizeInBytes / sizeof(uint32_t); }
-		uint32_t GetVertexCount() const { return static_cast<uint32_t>(Vertices.size()); }
+		uint32_t GetVertexCount() const { return VertexBufferView.SizeInBytes / VertexBufferView.StrideInBytes; }
+		uint32_t GetVertexStride() const { return VertexBufferView.StrideInBytes; }
+		DXGI_FORMAT GetPositionFormat() const { return PositionFormat; }
+		bool IsCompressed() const { return PositionFormat != DXGI_FORMAT_R32G32B32_FLOAT; }
+		const glm::mat4& GetDequantizationMatrix() const { return DequantizationMatrix; }
+		const VertexCompression::QuantizationBounds& GetQuantizationBounds() const { return QuantizationBounds; }
+		// Bounds of the vertex positions in mesh space, used for culling
+		const Math::AABB& GetLocalBounds() const { return LocalBounds; }
 		const D3D12_SHADER_RESOURCE_VIEW_DESC& GetVertexBufferSRVDesc() const { return VertexBufferSRVDesc; }
+		// Meshes have a single level of detail covering the whole index buffer unless levels are set
+		void SetLODs(const std::vector<MeshLOD>& lods);
+		const std::vector<MeshLOD>& GetLODs() const { return LODs; }
+		const MeshLOD& GetLOD(const uint32_t lodIndex) const { return LODs[lodIndex]; }
 		const D3D12_SHADER_RESOURCE_VIEW_DESC& GetIndexBufferSRVDesc() const { return IndexBufferSRVDesc; }
 
 	private:
+		void CreateBuffers(const size_t vertexStride, const std::wstring& name);
+
+	private:
+		// Only one of the vertex vectors is used, depending on the constructor
 		std::vector<Vertex1Pos1UV1Norm> Vertices;
+		std::vector<CompressedVertex1Pos1UV1Norm> CompressedVertices;
 		std::vector<uint32_t> Indices;
-		Microsoft::WRL::ComPtr<ID3D12Resource> VertexBuffer;
+		// Keeps the cache file mapped while the mesh data is read from it
+		std::shared_ptr<const MeshCache::MappedMesh> MappedMesh;
+		// Source of the GPU buffer contents, points into either the owned vectors or the mapped cache file
+		const uint8_t* VertexData = nullptr;
+		size_t VertexDataSize = 0;
+		const uint32_t* IndexData = nullptr;
+		size_t IndexDataCount = 0;
+		bool KeepCPUData = false;
+		GpuMemoryAllocator* pMemoryAllocator = nullptr;
+		GpuBufferAllocation VertexAllocation;
 		D3D12_VERTEX_BUFFER_VIEW VertexBufferView = {};
-		Microsoft::WRL::ComPtr<ID3D12Resource> IndexBuffer;
+		GpuBufferAllocation IndexAllocation;
+		UploadTicket Upload;
 		D3D12_INDEX_BUFFER_VIEW IndexBufferView = {};
 		D3D12_SHADER_RESOURCE_VIEW_DESC VertexBufferSRVDesc = {};
 		D3D12_SHADER_RESOURCE_VIEW_DESC IndexBufferSRVDesc = {};
+		DXGI_FORMAT PositionFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+		glm::mat4 DequantizationMatrix = glm::mat4(1.0f);
+		VertexCompression::QuantizationBounds QuantizationBounds;
+		Math::AABB LocalBounds;
+		std::vector<MeshLOD> LODs;
 	};
 }
\ No newline at end of file
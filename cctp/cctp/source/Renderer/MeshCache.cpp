@@ -0,0 +1,124 @@
+#include "Pch.h"
+#include "MeshCache.h"
+
+namespace
+{
+	uint64_t AlignUp(const uint64_t value, const uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// Blobs must lie inside the file and start on a blob aligned offset
+	bool IsBlobValid(const uint64_t offset, const uint64_t size, const uint64_t fileSize)
+	{
+		return offset % Renderer::MeshCache::MESH_CACHE_BLOB_ALIGNMENT == 0 && offset <= fileSize && size <= fileSize - offset;
+	}
+}
+
+bool Renderer::MeshCache::MappedMesh::Open(const std::string& filepath, const uint64_t sourceKey)
+{
+	pHeader = nullptr;
+	if (!File.Open(filepath))
+	{
+		return false;
+	}
+
+	const auto fileSize = static_cast<uint64_t>(File.GetSize());
+	if (fileSize < sizeof(MeshCacheHeader))
+	{
+		File.Close();
+		return false;
+	}
+
+	// Mappings are page aligned, so the header can be read in place
+	auto pFileHeader = reinterpret_cast<const MeshCacheHeader*>(File.GetData());
+	if (pFileHeader->Magic != MESH_CACHE_MAGIC || pFileHeader->Version != MESH_CACHE_VERSION || pFileHeader->SourceKey != sourceKey ||
+		pFileHeader->VertexStride == 0 || pFileHeader->LODCount == 0 ||
+		pFileHeader->VertexSize != static_cast<uint64_t>(pFileHeader->VertexCount) * pFileHeader->VertexStride ||
+		pFileHeader->IndexSize != static_cast<uint64_t>(pFileHeader->IndexCount) * sizeof(uint32_t) ||
+		!IsBlobValid(pFileHeader->LODOffset, static_cast<uint64_t>(pFileHeader->LODCount) * sizeof(MeshLOD), fileSize) ||
+		!IsBlobValid(pFileHeader->VertexOffset, pFileHeader->VertexSize, fileSize) ||
+		!IsBlobValid(pFileHeader->IndexOffset, pFileHeader->IndexSize, fileSize))
+	{
+		File.Close();
+		return false;
+	}
+
+	auto pLODs = reinterpret_cast<const MeshLOD*>(File.GetData() + pFileHeader->LODOffset);
+	for (uint32_t i = 0; i < pFileHeader->LODCount; ++i)
+	{
+		if (pLODs[i].IndexOffset > pFileHeader->IndexCount || pLODs[i].IndexCount > pFileHeader->IndexCount - pLODs[i].IndexOffset)
+		{
+			File.Close();
+			return false;
+		}
+	}
+
+	pHeader = pFileHeader;
+	return true;
+}
+
+bool Renderer::MeshCache::WriteMeshCache(const std::string& filepath, const uint64_t sourceKey, const MeshCacheData& data)
+{
+	assert(data.pVertices != nullptr && data.pIndices != nullptr && data.pLODs != nullptr && data.LODCount > 0 && "Mesh cache data is incomplete.");
+
+	MeshCacheHeader header = {};
+	header.SourceKey = sourceKey;
+	header.VertexStride = data.VertexStride;
+	header.PositionFormat = static_cast<uint32_t>(data.PositionFormat);
+	header.VertexCount = data.VertexCount;
+	header.IndexCount = data.IndexCount;
+	header.LODCount = data.LODCount;
+	header.Bounds = data.Bounds;
+
+	header.LODOffset = AlignUp(sizeof(MeshCacheHeader), MESH_CACHE_BLOB_ALIGNMENT);
+	header.VertexOffset = AlignUp(header.LODOffset + sizeof(MeshLOD) * data.LODCount, MESH_CACHE_BLOB_ALIGNMENT);
+	header.VertexSize = static_cast<uint64_t>(data.VertexCount) * data.VertexStride;
+	header.IndexOffset = AlignUp(header.VertexOffset + header.VertexSize, MESH_CACHE_BLOB_ALIGNMENT);
+	header.IndexSize = static_cast<uint64_t>(data.IndexCount) * sizeof(uint32_t);
+
+	std::error_code error;
+	auto directory = std::filesystem::path(filepath).parent_path();
+	if (!directory.empty())
+	{
+		std::filesystem::create_directories(directory, error);
+	}
+
+	// Write to a temporary file first so an interrupted write never leaves a truncated cache behind
+	auto temporaryFilepath = filepath + ".tmp";
+	{
+		std::ofstream fs(temporaryFilepath, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+		if (!fs.good())
+		{
+			return false;
+		}
+
+		auto WriteBlob = [&fs](const uint64_t offset, const void* pData, const uint64_t size)
+		{
+			// Pad up to the blob offset
+			static const char padding[MESH_CACHE_BLOB_ALIGNMENT] = {};
+			auto position = static_cast<uint64_t>(fs.tellp());
+			assert(position <= offset && "Mesh cache blobs must be written in order.");
+			fs.write(padding, static_cast<std::streamsize>(offset - position));
+			fs.write(static_cast<const char*>(pData), static_cast<std::streamsize>(size));
+		};
+
+		fs.write(reinterpret_cast<const char*>(&header), sizeof(MeshCacheHeader));
+		WriteBlob(header.LODOffset, data.pLODs, sizeof(MeshLOD) * data.LODCount);
+		WriteBlob(header.VertexOffset, data.pVertices, header.VertexSize);
+		WriteBlob(header.IndexOffset, data.pIndices, header.IndexSize);
+
+		if (!fs.good())
+		{
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporaryFilepath, filepath, error);
+	return !error;
+}
+
+std::string Renderer::MeshCache::GetCacheFilepath(const std::string& name)
+{
+	return (std::filesystem::path(MESH_CACHE_DIRECTORY) / (name + ".mesh")).string();
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Binary/MappedFile.h"
+#include "VertexCompression.h"
+#include "MeshLOD.h"
+
+namespace Renderer
+{
+	namespace MeshCache
+	{
+		constexpr uint32_t MESH_CACHE_MAGIC = 0x4853454D; // "MESH"
+		// Increment whenever the layout of the file or of any stored vertex format changes, older files are then treated as stale
+		constexpr uint32_t MESH_CACHE_VERSION = 1;
+		// Blobs start on this boundary so they can be copied into upload buffers with aligned loads
+		constexpr uint64_t MESH_CACHE_BLOB_ALIGNMENT = 256;
+		constexpr const char* MESH_CACHE_DIRECTORY = "MeshCache";
+
+		// File layout is the header, followed by the LOD table, vertex blob and index blob, each starting on a blob aligned offset
+		struct MeshCacheHeader
+		{
+			uint32_t Magic = MESH_CACHE_MAGIC;
+			uint32_t Version = MESH_CACHE_VERSION;
+			// Identifies the data and settings the mesh was generated from, a mismatch means the cache is stale
+			uint64_t SourceKey = 0;
+
+			uint32_t VertexStride = 0;
+			uint32_t PositionFormat = 0;
+			uint32_t VertexCount = 0;
+			uint32_t IndexCount = 0;
+			uint32_t LODCount = 0;
+			uint32_t Reserved = 0;
+
+			// Quantization bounds for compressed meshes, the position bounds of the mesh otherwise
+			VertexCompression::QuantizationBounds Bounds;
+
+			uint64_t LODOffset = 0;
+			uint64_t VertexOffset = 0;
+			uint64_t VertexSize = 0;
+			uint64_t IndexOffset = 0;
+			uint64_t IndexSize = 0;
+		};
+
+		static_assert(std::is_trivially_copyable<MeshCacheHeader>::value, "Mesh cache header must be trivially copyable.");
+		static_assert(std::is_trivially_copyable<MeshLOD>::value, "Mesh levels of detail must be trivially copyable.");
+
+		// Mesh data written to a cache file. Pointers are only read during the write
+		struct MeshCacheData
+		{
+			const void* pVertices = nullptr;
+			uint32_t VertexCount = 0;
+			uint32_t VertexStride = 0;
+			DXGI_FORMAT PositionFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+			const uint32_t* pIndices = nullptr;
+			uint32_t IndexCount = 0;
+			const MeshLOD* pLODs = nullptr;
+			uint32_t LODCount = 0;
+			VertexCompression::QuantizationBounds Bounds;
+		};
+
+		// A validated mesh cache file mapped into memory. Data pointers point into the mapping and stay valid while the object is alive
+		class MappedMesh
+		{
+		public:
+			// Fails if the file is missing, truncated, from another version or generated from another source
+			bool Open(const std::string& filepath, const uint64_t sourceKey);
+
+			const MeshCacheHeader& GetHeader() const { return *pHeader; }
+			const uint8_t* GetVertexData() const { return File.GetData() + pHeader->VertexOffset; }
+			const uint32_t* GetIndexData() const { return reinterpret_cast<const uint32_t*>(File.GetData() + pHeader->IndexOffset); }
+			const MeshLOD* GetLODs() const { return reinterpret_cast<const MeshLOD*>(File.GetData() + pHeader->LODOffset); }
+			size_t GetFileSize() const { return File.GetSize(); }
+
+		private:
+			MappedFile File;
+			const MeshCacheHeader* pHeader = nullptr;
+		};
+
+		bool WriteMeshCache(const std::string& filepath, const uint64_t sourceKey, const MeshCacheData& data);
+
+		// Path of a named mesh inside the mesh cache directory
+		std::string GetCacheFilepath(const std::string& name);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,1404 @@
+#include "Pch.h"
+#include "MeshImporter.h"
+#include "Binary/MappedFile.h"
+#include "Tasks/TaskSystem.h"
+#include <charconv>
+#include <atomic>
+
+namespace
+{
+	using ImportClock = std::chrono::high_resolution_clock;
+
+	constexpr uint32_t INVALID_INDEX = ~0u;
+
+	double ElapsedMilliseconds(const ImportClock::time_point& start)
+	{
+		return std::chrono::duration<double, std::milli>(ImportClock::now() - start).count();
+	}
+
+	uint64_t HashCombine(uint64_t hash, const uint32_t value)
+	{
+		hash = (hash ^ value) * 0x9E3779B97F4A7C15ull;
+		return hash ^ (hash >> 32);
+	}
+
+	// Open addressing table of unique vertex indices. Keys are compared through the unique vertex already stored for a slot
+	class UniqueVertexTable
+	{
+	public:
+		explicit UniqueVertexTable(const size_t maxVertexCount)
+		{
+			size_t capacity = 16;
+			while (capacity < maxVertexCount * 2)
+			{
+				capacity <<= 1;
+			}
+			Slots.assign(capacity, INVALID_INDEX);
+			Mask = capacity - 1;
+		}
+
+		template <typename IsEqual>
+		uint32_t& FindSlot(const uint64_t hash, IsEqual&& isEqual)
+		{
+			auto slot = static_cast<size_t>(hash) & Mask;
+			while (Slots[slot] != INVALID_INDEX && !isEqual(Slots[slot]))
+			{
+				slot = (slot + 1) & Mask;
+			}
+			return Slots[slot];
+		}
+
+	private:
+		std::vector<uint32_t> Slots;
+		size_t Mask = 0;
+	};
+
+	// Source files are right handed with counter clockwise front faces. Mirroring z converts to left handed coordinates but keeps the
+	// winding seen on screen, so triangles are also reversed to give clockwise front faces
+	glm::vec3 ToLeftHanded(const glm::vec3& v)
+	{
+		return glm::vec3(v.x, v.y, -v.z);
+	}
+
+	void FillStatistics(Renderer::MeshImporter::ImportStatistics* pStatistics, const size_t fileSize, const size_t vertexCount, const size_t indexCount,
+		const size_t duplicateVertexCount, const double parseMs, const double deduplicateMs, const ImportClock::time_point& start)
+	{
+		if (pStatistics == nullptr)
+		{
+			return;
+		}
+
+		pStatistics->FileSizeBytes = fileSize;
+		pStatistics->VertexCount = vertexCount;
+		pStatistics->IndexCount = indexCount;
+		pStatistics->DuplicateVertexCount = duplicateVertexCount;
+		pStatistics->ParseMilliseconds = parseMs;
+		pStatistics->DeduplicateMilliseconds = deduplicateMs;
+		pStatistics->TotalMilliseconds = ElapsedMilliseconds(start);
+		pStatistics->ThroughputMBPerSecond = pStatistics->TotalMilliseconds > 0.0 ?
+			(static_cast<double>(fileSize) / (1024.0 * 1024.0)) / (pStatistics->TotalMilliseconds / 1000.0) : 0.0;
+	}
+
+	// OBJ
+
+	struct ObjCorner
+	{
+		uint32_t Position = INVALID_INDEX;
+		uint32_t UV = INVALID_INDEX;
+		uint32_t Normal = INVALID_INDEX;
+
+		bool operator==(const ObjCorner& other) const
+		{
+			return Position == other.Position && UV == other.UV && Normal == other.Normal;
+		}
+	};
+
+	struct ObjChunk
+	{
+		const char* Begin = nullptr;
+		const char* End = nullptr;
+
+		size_t PositionCount = 0;
+		size_t UVCount = 0;
+		size_t NormalCount = 0;
+		size_t CornerCount = 0;
+
+		// Offsets of the chunk's elements in the whole file, from a prefix sum of the counts
+		size_t PositionOffset = 0;
+		size_t UVOffset = 0;
+		size_t NormalOffset = 0;
+		size_t CornerOffset = 0;
+
+		bool Failed = false;
+	};
+
+	bool IsSpace(const char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char* SkipSpaces(const char* p, const char* end)
+	{
+		while (p < end && IsSpace(*p))
+		{
+			++p;
+		}
+		return p;
+	}
+
+	const char* SkipLine(const char* p, const char* end)
+	{
+		while (p < end && *p != '\n')
+		{
+			++p;
+		}
+		return p < end ? p + 1 : end;
+	}
+
+	bool IsEndOfStatement(const char* p, const char* end)
+	{
+		return p >= end || *p == '\n' || *p == '#';
+	}
+
+	// Line type of an OBJ statement, the keyword must be followed by white space
+	bool IsKeyword(const char* p, const char* end, const char* keyword)
+	{
+		while (*keyword != '\0')
+		{
+			if (p >= end || *p != *keyword)
+			{
+				return false;
+			}
+			++p;
+			++keyword;
+		}
+		return p < end && IsSpace(*p);
+	}
+
+	const char* ParseFloat(const char* p, const char* end, float& out)
+	{
+		p = SkipSpaces(p, end);
+		if (p < end && *p == '+')
+		{
+			++p;
+		}
+
+		auto result = std::from_chars(p, end, out);
+		return result.ec == std::errc() ? result.ptr : nullptr;
+	}
+
+	const char* ParseInt(const char* p, const char* end, int64_t& out)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			++p;
+		}
+
+		if (p >= end || *p < '0' || *p > '9')
+		{
+			return nullptr;
+		}
+
+		int64_t value = 0;
+		while (p < end && *p >= '0' && *p <= '9')
+		{
+			value = value * 10 + (*p - '0');
+			++p;
+		}
+
+		out = negative ? -value : value;
+		return p;
+	}
+
+	// OBJ indices are one based, negative indices are relative to the elements read so far
+	bool ResolveObjIndex(const int64_t index, const size_t countSoFar, const size_t totalCount, uint32_t& out)
+	{
+		int64_t resolved = index > 0 ? index - 1 : static_cast<int64_t>(countSoFar) + index;
+		if (index == 0 || resolved < 0 || resolved >= static_cast<int64_t>(totalCount))
+		{
+			return false;
+		}
+
+		out = static_cast<uint32_t>(resolved);
+		return true;
+	}
+
+	void CountObjChunk(ObjChunk& chunk)
+	{
+		const char* p = chunk.Begin;
+		while (p < chunk.End)
+		{
+			p = SkipSpaces(p, chunk.End);
+
+			if (IsKeyword(p, chunk.End, "v"))
+			{
+				++chunk.PositionCount;
+			}
+			else if (IsKeyword(p, chunk.End, "vt"))
+			{
+				++chunk.UVCount;
+			}
+			else if (IsKeyword(p, chunk.End, "vn"))
+			{
+				++chunk.NormalCount;
+			}
+			else if (IsKeyword(p, chunk.End, "f"))
+			{
+				// Count white space separated corners, polygons become triangle fans
+				size_t cornerCount = 0;
+				p = SkipSpaces(p + 1, chunk.End);
+				while (!IsEndOfStatement(p, chunk.End))
+				{
+					++cornerCount;
+					while (!IsEndOfStatement(p, chunk.End) && !IsSpace(*p))
+					{
+						++p;
+					}
+					p = SkipSpaces(p, chunk.End);
+				}
+
+				if (cornerCount >= 3)
+				{
+					chunk.CornerCount += (cornerCount - 2) * 3;
+				}
+			}
+
+			p = SkipLine(p, chunk.End);
+		}
+	}
+
+	void ParseObjChunk(ObjChunk& chunk, const ObjChunk& totals, std::vector<glm::vec3>& positions, std::vector<glm::vec2>& uvs,
+		std::vector<glm::vec3>& normals, std::vector<ObjCorner>& corners)
+	{
+		auto positionIndex = chunk.PositionOffset;
+		auto uvIndex = chunk.UVOffset;
+		auto normalIndex = chunk.NormalOffset;
+		auto cornerIndex = chunk.CornerOffset;
+
+		std::vector<ObjCorner> polygon;
+
+		const char* p = chunk.Begin;
+		while (p < chunk.End && !chunk.Failed)
+		{
+			p = SkipSpaces(p, chunk.End);
+
+			if (IsKeyword(p, chunk.End, "v"))
+			{
+				glm::vec3 position;
+				p = ParseFloat(p + 1, chunk.End, position.x);
+				p = p ? ParseFloat(p, chunk.End, position.y) : nullptr;
+				p = p ? ParseFloat(p, chunk.End, position.z) : nullptr;
+				if (p == nullptr)
+				{
+					chunk.Failed = true;
+					break;
+				}
+				positions[positionIndex++] = position;
+			}
+			else if (IsKeyword(p, chunk.End, "vt"))
+			{
+				// The v coordinate is optional
+				glm::vec2 uv = glm::vec2(0.0f);
+				p = ParseFloat(p + 2, chunk.End, uv.x);
+				if (p == nullptr)
+				{
+					chunk.Failed = true;
+					break;
+				}
+				if (!IsEndOfStatement(SkipSpaces(p, chunk.End), chunk.End))
+				{
+					p = ParseFloat(p, chunk.End, uv.y);
+					if (p == nullptr)
+					{
+						chunk.Failed = true;
+						break;
+					}
+				}
+				uvs[uvIndex++] = uv;
+			}
+			else if (IsKeyword(p, chunk.End, "vn"))
+			{
+				glm::vec3 normal;
+				p = ParseFloat(p + 2, chunk.End, normal.x);
+				p = p ? ParseFloat(p, chunk.End, normal.y) : nullptr;
+				p = p ? ParseFloat(p, chunk.End, normal.z) : nullptr;
+				if (p == nullptr)
+				{
+					chunk.Failed = true;
+					break;
+				}
+				normals[normalIndex++] = normal;
+			}
+			else if (IsKeyword(p, chunk.End, "f"))
+			{
+				polygon.clear();
+				p = SkipSpaces(p + 1, chunk.End);
+				while (!IsEndOfStatement(p, chunk.End))
+				{
+					// Corners are p, p/t, p//n or p/t/n
+					ObjCorner corner;
+					int64_t index = 0;
+					p = ParseInt(p, chunk.End, index);
+					if (p == nullptr || !ResolveObjIndex(index, positionIndex, totals.PositionCount, corner.Position))
+					{
+						chunk.Failed = true;
+						break;
+					}
+
+					if (p < chunk.End && *p == '/')
+					{
+						++p;
+						if (p < chunk.End && *p != '/')
+						{
+							p = ParseInt(p, chunk.End, index);
+							if (p == nullptr || !ResolveObjIndex(index, uvIndex, totals.UVCount, corner.UV))
+							{
+								chunk.Failed = true;
+								break;
+							}
+						}
+
+						if (p < chunk.End && *p == '/')
+						{
+							p = ParseInt(p + 1, chunk.End, index);
+							if (p == nullptr || !ResolveObjIndex(index, normalIndex, totals.NormalCount, corner.Normal))
+							{
+								chunk.Failed = true;
+								break;
+							}
+						}
+					}
+
+					if (p < chunk.End && !IsSpace(*p) && !IsEndOfStatement(p, chunk.End))
+					{
+						chunk.Failed = true;
+						break;
+					}
+
+					polygon.push_back(corner);
+					p = SkipSpaces(p, chunk.End);
+				}
+
+				for (size_t i = 2; i < polygon.size() && !chunk.Failed; ++i)
+				{
+					corners[cornerIndex++] = polygon[0];
+					corners[cornerIndex++] = polygon[i];
+					corners[cornerIndex++] = polygon[i - 1];
+				}
+			}
+
+			p = p ? SkipLine(p, chunk.End) : chunk.End;
+		}
+	}
+
+	// GLB
+
+	constexpr uint32_t GLB_MAGIC = 0x46546C67;
+	constexpr uint32_t GLB_VERSION = 2;
+	constexpr uint32_t GLB_CHUNK_TYPE_JSON = 0x4E4F534A;
+	constexpr uint32_t GLB_CHUNK_TYPE_BIN = 0x004E4942;
+	constexpr size_t GLB_HEADER_SIZE_BYTES = 12;
+	constexpr size_t GLB_CHUNK_HEADER_SIZE_BYTES = 8;
+
+	constexpr uint32_t GLTF_COMPONENT_TYPE_BYTE = 5120;
+	constexpr uint32_t GLTF_COMPONENT_TYPE_UNSIGNED_BYTE = 5121;
+	constexpr uint32_t GLTF_COMPONENT_TYPE_SHORT = 5122;
+	constexpr uint32_t GLTF_COMPONENT_TYPE_UNSIGNED_SHORT = 5123;
+	constexpr uint32_t GLTF_COMPONENT_TYPE_UNSIGNED_INT = 5125;
+	constexpr uint32_t GLTF_COMPONENT_TYPE_FLOAT = 5126;
+	constexpr uint32_t GLTF_PRIMITIVE_MODE_TRIANGLES = 4;
+
+	constexpr uint32_t MAX_JSON_DEPTH = 256;
+	constexpr size_t INVALID_JSON_INDEX = ~size_t(0);
+	// Doubles represent every integer below this exactly
+	constexpr double MAX_JSON_INTEGER = 9007199254740992.0;
+
+	struct JsonValue
+	{
+		enum Kind
+		{
+			JSON_NULL,
+			JSON_BOOL,
+			JSON_NUMBER,
+			JSON_STRING,
+			JSON_ARRAY,
+			JSON_OBJECT
+		};
+
+		Kind Type = JSON_NULL;
+		bool Bool = false;
+		double Number = 0.0;
+		std::string String;
+		std::vector<JsonValue> Elements;
+		std::vector<std::pair<std::string, JsonValue>> Members;
+
+		const JsonValue* Find(const char* key) const
+		{
+			for (const auto& member : Members)
+			{
+				if (member.first == key)
+				{
+					return &member.second;
+				}
+			}
+			return nullptr;
+		}
+
+		double GetNumber(const char* key, const double defaultValue) const
+		{
+			auto pValue = Find(key);
+			return pValue != nullptr && pValue->Type == JSON_NUMBER ? pValue->Number : defaultValue;
+		}
+
+		// Converts a non-negative integral number, rejecting values that are negative, fractional, not finite or out of range
+		bool ToSize(size_t& out) const
+		{
+			if (Type != JSON_NUMBER || !(Number >= 0.0 && Number < MAX_JSON_INTEGER) || Number != std::floor(Number) ||
+				Number > static_cast<double>(std::numeric_limits<size_t>::max()))
+			{
+				return false;
+			}
+
+			out = static_cast<size_t>(Number);
+			return true;
+		}
+
+		// Missing keys use the default, present keys must hold a valid size
+		bool GetSize(const char* key, const size_t defaultValue, size_t& out) const
+		{
+			auto pValue = Find(key);
+			if (pValue == nullptr)
+			{
+				out = defaultValue;
+				return true;
+			}
+			return pValue->ToSize(out);
+		}
+
+		size_t GetIndex(const char* key) const
+		{
+			auto pValue = Find(key);
+			size_t index = INVALID_JSON_INDEX;
+			return pValue != nullptr && pValue->ToSize(index) ? index : INVALID_JSON_INDEX;
+		}
+
+		const JsonValue* GetElement(const char* key, const size_t index) const
+		{
+			auto pArray = Find(key);
+			return pArray != nullptr && pArray->Type == JSON_ARRAY && index < pArray->Elements.size() ? &pArray->Elements[index] : nullptr;
+		}
+	};
+
+	// Recursive descent parser for the JSON chunk. glTF JSON is small, so a document tree is simpler than streaming
+	class JsonParser
+	{
+	public:
+		JsonParser(const char* begin, const char* end)
+			: Cursor(begin), End(end)
+		{}
+
+		bool Parse(JsonValue& out)
+		{
+			if (!ParseValue(out, 0))
+			{
+				return false;
+			}
+			SkipWhitespace();
+			return Cursor == End;
+		}
+
+	private:
+		void SkipWhitespace()
+		{
+			while (Cursor < End && (*Cursor == ' ' || *Cursor == '\t' || *Cursor == '\r' || *Cursor == '\n'))
+			{
+				++Cursor;
+			}
+		}
+
+		bool Consume(const char* literal)
+		{
+			auto length = strlen(literal);
+			if (static_cast<size_t>(End - Cursor) < length || memcmp(Cursor, literal, length) != 0)
+			{
+				return false;
+			}
+			Cursor += length;
+			return true;
+		}
+
+		bool ParseValue(JsonValue& out, const uint32_t depth)
+		{
+			SkipWhitespace();
+			if (Cursor >= End || depth > MAX_JSON_DEPTH)
+			{
+				return false;
+			}
+
+			switch (*Cursor)
+			{
+			case '{':
+			{
+				out.Type = JsonValue::JSON_OBJECT;
+				++Cursor;
+				SkipWhitespace();
+				if (Cursor < End && *Cursor == '}')
+				{
+					++Cursor;
+					return true;
+				}
+				while (true)
+				{
+					std::pair<std::string, JsonValue> member;
+					SkipWhitespace();
+					if (!ParseString(member.first))
+					{
+						return false;
+					}
+					SkipWhitespace();
+					if (!Consume(":") || !ParseValue(member.second, depth + 1))
+					{
+						return false;
+					}
+					out.Members.emplace_back(std::move(member));
+					SkipWhitespace();
+					if (Consume("}"))
+					{
+						return true;
+					}
+					if (!Consume(","))
+					{
+						return false;
+					}
+				}
+			}
+			case '[':
+			{
+				out.Type = JsonValue::JSON_ARRAY;
+				++Cursor;
+				SkipWhitespace();
+				if (Cursor < End && *Cursor == ']')
+				{
+					++Cursor;
+					return true;
+				}
+				while (true)
+				{
+					out.Elements.emplace_back();
+					if (!ParseValue(out.Elements.back(), depth + 1))
+					{
+						return false;
+					}
+					SkipWhitespace();
+					if (Consume("]"))
+					{
+						return true;
+					}
+					if (!Consume(","))
+					{
+						return false;
+					}
+				}
+			}
+			case '"':
+				out.Type = JsonValue::JSON_STRING;
+				return ParseString(out.String);
+			case 't':
+				out.Type = JsonValue::JSON_BOOL;
+				out.Bool = true;
+				return Consume("true");
+			case 'f':
+				out.Type = JsonValue::JSON_BOOL;
+				out.Bool = false;
+				return Consume("false");
+			case 'n':
+				out.Type = JsonValue::JSON_NULL;
+				return Consume("null");
+			default:
+			{
+				out.Type = JsonValue::JSON_NUMBER;
+				auto result = std::from_chars(Cursor, End, out.Number);
+				if (result.ec != std::errc())
+				{
+					return false;
+				}
+				Cursor = result.ptr;
+				return true;
+			}
+			}
+		}
+
+		bool ParseString(std::string& out)
+		{
+			if (!Consume("\""))
+			{
+				return false;
+			}
+
+			while (Cursor < End && *Cursor != '"')
+			{
+				if (*Cursor != '\\')
+				{
+					out += *Cursor++;
+					continue;
+				}
+
+				if (++Cursor >= End)
+				{
+					return false;
+				}
+
+				switch (*Cursor++)
+				{
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u':
+				{
+					// Encode the code unit as UTF-8, surrogate pairs are not combined since glTF names are not used
+					uint32_t codeUnit = 0;
+					if (End - Cursor < 4 || std::from_chars(Cursor, Cursor + 4, codeUnit, 16).ptr != Cursor + 4)
+					{
+						return false;
+					}
+					Cursor += 4;
+					if (codeUnit < 0x80)
+					{
+						out += static_cast<char>(codeUnit);
+					}
+					else if (codeUnit < 0x800)
+					{
+						out += static_cast<char>(0xC0 | (codeUnit >> 6));
+						out += static_cast<char>(0x80 | (codeUnit & 0x3F));
+					}
+					else
+					{
+						out += static_cast<char>(0xE0 | (codeUnit >> 12));
+						out += static_cast<char>(0x80 | ((codeUnit >> 6) & 0x3F));
+						out += static_cast<char>(0x80 | (codeUnit & 0x3F));
+					}
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+
+			return Consume("\"");
+		}
+
+	private:
+		const char* Cursor;
+		const char* End;
+	};
+
+	struct AccessorView
+	{
+		const uint8_t* Data = nullptr;
+		size_t Count = 0;
+		size_t Stride = 0;
+		uint32_t ComponentType = 0;
+		uint32_t ComponentCount = 0;
+		bool Normalized = false;
+	};
+
+	size_t ComponentSize(const uint32_t componentType)
+	{
+		switch (componentType)
+		{
+		case GLTF_COMPONENT_TYPE_BYTE:
+		case GLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			return 1;
+		case GLTF_COMPONENT_TYPE_SHORT:
+		case GLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			return 2;
+		case GLTF_COMPONENT_TYPE_UNSIGNED_INT:
+		case GLTF_COMPONENT_TYPE_FLOAT:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	uint32_t ComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		return 0;
+	}
+
+	bool GetAccessorView(const JsonValue& gltf, const uint8_t* pBin, const size_t binSize, const size_t accessorIndex, AccessorView& out)
+	{
+		auto pAccessor = gltf.GetElement("accessors", accessorIndex);
+		if (pAccessor == nullptr || pAccessor->Find("sparse") != nullptr)
+		{
+			return false;
+		}
+
+		auto pView = gltf.GetElement("bufferViews", pAccessor->GetIndex("bufferView"));
+		auto pType = pAccessor->Find("type");
+		if (pView == nullptr || pType == nullptr || pView->GetIndex("buffer") != 0)
+		{
+			return false;
+		}
+
+		size_t componentType = 0;
+		if (!pAccessor->GetSize("componentType", 0, componentType) || !pAccessor->GetSize("count", 0, out.Count))
+		{
+			return false;
+		}
+		out.ComponentType = static_cast<uint32_t>(std::min<size_t>(componentType, std::numeric_limits<uint32_t>::max()));
+		out.ComponentCount = ComponentCount(pType->String);
+		auto pNormalized = pAccessor->Find("normalized");
+		out.Normalized = pNormalized != nullptr && pNormalized->Bool;
+
+		const auto elementSize = ComponentSize(out.ComponentType) * out.ComponentCount;
+		size_t viewOffset = 0;
+		size_t viewLength = 0;
+		size_t accessorOffset = 0;
+		if (!pView->GetSize("byteOffset", 0, viewOffset) || !pView->GetSize("byteLength", 0, viewLength) ||
+			!pAccessor->GetSize("byteOffset", 0, accessorOffset) || !pView->GetSize("byteStride", elementSize, out.Stride))
+		{
+			return false;
+		}
+
+		// Every bound is checked by subtraction so malicious sizes cannot wrap
+		if (elementSize == 0 || out.Count == 0 || out.Stride < elementSize || viewOffset > binSize || viewLength > binSize - viewOffset ||
+			accessorOffset > viewLength || elementSize > viewLength - accessorOffset ||
+			out.Count > (viewLength - accessorOffset - elementSize) / out.Stride + 1)
+		{
+			return false;
+		}
+
+		out.Data = pBin + viewOffset + accessorOffset;
+		return true;
+	}
+
+	// Reads an element as floats, applying normalization of integer components
+	void ReadFloats(const AccessorView& view, const size_t index, float* pOut, const uint32_t count)
+	{
+		const uint8_t* pElement = view.Data + view.Stride * index;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (i >= view.ComponentCount)
+			{
+				pOut[i] = 0.0f;
+				continue;
+			}
+
+			switch (view.ComponentType)
+			{
+			case GLTF_COMPONENT_TYPE_FLOAT:
+				memcpy(&pOut[i], pElement + i * 4, 4);
+				break;
+			case GLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+				pOut[i] = static_cast<float>(pElement[i]) / (view.Normalized ? 255.0f : 1.0f);
+				break;
+			case GLTF_COMPONENT_TYPE_BYTE:
+				pOut[i] = view.Normalized ? std::max(static_cast<float>(static_cast<int8_t>(pElement[i])) / 127.0f, -1.0f) :
+					static_cast<float>(static_cast<int8_t>(pElement[i]));
+				break;
+			case GLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			{
+				uint16_t value;
+				memcpy(&value, pElement + i * 2, 2);
+				pOut[i] = static_cast<float>(value) / (view.Normalized ? 65535.0f : 1.0f);
+				break;
+			}
+			case GLTF_COMPONENT_TYPE_SHORT:
+			{
+				int16_t value;
+				memcpy(&value, pElement + i * 2, 2);
+				pOut[i] = view.Normalized ? std::max(static_cast<float>(value) / 32767.0f, -1.0f) : static_cast<float>(value);
+				break;
+			}
+			default:
+				pOut[i] = 0.0f;
+				break;
+			}
+		}
+	}
+
+	uint32_t ReadIndex(const AccessorView& view, const size_t index)
+	{
+		const uint8_t* pElement = view.Data + view.Stride * index;
+		switch (view.ComponentType)
+		{
+		case GLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			return pElement[0];
+		case GLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			memcpy(&value, pElement, 2);
+			return value;
+		}
+		case GLTF_COMPONENT_TYPE_UNSIGNED_INT:
+		{
+			uint32_t value;
+			memcpy(&value, pElement, 4);
+			return value;
+		}
+		default:
+			return INVALID_INDEX;
+		}
+	}
+
+	struct MeshInstance
+	{
+		size_t MeshIndex = 0;
+		glm::mat4 WorldMatrix = glm::mat4(1.0f);
+	};
+
+	glm::mat4 CalculateNodeMatrix(const JsonValue& node)
+	{
+		auto pMatrix = node.Find("matrix");
+		if (pMatrix != nullptr && pMatrix->Elements.size() == 16)
+		{
+			// glTF matrices are column major like glm
+			glm::mat4 matrix;
+			for (int i = 0; i < 16; ++i)
+			{
+				matrix[i / 4][i % 4] = static_cast<float>(pMatrix->Elements[i].Number);
+			}
+			return matrix;
+		}
+
+		glm::vec3 translation = glm::vec3(0.0f);
+		glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		glm::vec3 scale = glm::vec3(1.0f);
+
+		auto pTranslation = node.Find("translation");
+		if (pTranslation != nullptr && pTranslation->Elements.size() == 3)
+		{
+			translation = glm::vec3(pTranslation->Elements[0].Number, pTranslation->Elements[1].Number, pTranslation->Elements[2].Number);
+		}
+
+		auto pRotation = node.Find("rotation");
+		if (pRotation != nullptr && pRotation->Elements.size() == 4)
+		{
+			rotation = glm::quat(static_cast<float>(pRotation->Elements[3].Number), static_cast<float>(pRotation->Elements[0].Number),
+				static_cast<float>(pRotation->Elements[1].Number), static_cast<float>(pRotation->Elements[2].Number));
+		}
+
+		auto pScale = node.Find("scale");
+		if (pScale != nullptr && pScale->Elements.size() == 3)
+		{
+			scale = glm::vec3(pScale->Elements[0].Number, pScale->Elements[1].Number, pScale->Elements[2].Number);
+		}
+
+		return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+	}
+
+	void CollectNodeMeshInstances(const JsonValue& gltf, const size_t nodeIndex, const glm::mat4& parentMatrix, std::vector<uint8_t>& visitedNodes,
+		std::vector<MeshInstance>& outInstances)
+	{
+		auto pNode = gltf.GetElement("nodes", nodeIndex);
+		// glTF nodes have at most one parent, so a node reached twice comes from a malformed file with cycles or shared children.
+		// Visiting each node once keeps such files linear
+		if (pNode == nullptr || visitedNodes[nodeIndex])
+		{
+			return;
+		}
+		visitedNodes[nodeIndex] = 1;
+
+		auto worldMatrix = parentMatrix * CalculateNodeMatrix(*pNode);
+
+		auto meshIndex = pNode->GetIndex("mesh");
+		if (meshIndex != INVALID_JSON_INDEX)
+		{
+			outInstances.push_back({ meshIndex, worldMatrix });
+		}
+
+		auto pChildren = pNode->Find("children");
+		if (pChildren != nullptr)
+		{
+			for (const auto& child : pChildren->Elements)
+			{
+				size_t childIndex = 0;
+				if (child.ToSize(childIndex))
+				{
+					CollectNodeMeshInstances(gltf, childIndex, worldMatrix, visitedNodes, outInstances);
+				}
+			}
+		}
+	}
+
+	void CollectMeshInstances(const JsonValue& gltf, std::vector<MeshInstance>& outInstances)
+	{
+		auto pNodes = gltf.Find("nodes");
+		auto sceneIndex = gltf.GetIndex("scene");
+		auto pScene = gltf.GetElement("scenes", sceneIndex == INVALID_JSON_INDEX ? 0 : sceneIndex);
+
+		if (pNodes != nullptr && pScene != nullptr)
+		{
+			auto pRootNodes = pScene->Find("nodes");
+			if (pRootNodes != nullptr)
+			{
+				std::vector<uint8_t> visitedNodes(pNodes->Elements.size(), 0);
+				for (const auto& root : pRootNodes->Elements)
+				{
+					size_t rootIndex = 0;
+					if (root.ToSize(rootIndex))
+					{
+						CollectNodeMeshInstances(gltf, rootIndex, glm::mat4(1.0f), visitedNodes, outInstances);
+					}
+				}
+			}
+			return;
+		}
+
+		// Files without a scene only describe meshes
+		auto pMeshes = gltf.Find("meshes");
+		for (size_t i = 0; pMeshes != nullptr && i < pMeshes->Elements.size(); ++i)
+		{
+			outInstances.push_back({ i, glm::mat4(1.0f) });
+		}
+	}
+
+	struct PrimitiveJob
+	{
+		AccessorView Positions;
+		AccessorView Normals;
+		AccessorView UVs;
+		AccessorView Indices;
+		bool HasNormals = false;
+		bool HasUVs = false;
+		bool HasIndices = false;
+
+		glm::mat4 WorldMatrix = glm::mat4(1.0f);
+		size_t VertexOffset = 0;
+		size_t VertexCount = 0;
+		size_t IndexOffset = 0;
+		size_t IndexCount = 0;
+	};
+
+	// Area weighted face normals summed at each vertex. Front faces are clockwise, the cross product of the edges points out of the front face
+	void GenerateNormals(std::vector<Renderer::Vertex1Pos1UV1Norm>& vertices, const std::vector<uint32_t>& indices, const size_t indexOffset,
+		const size_t indexCount, const size_t vertexOffset, const size_t vertexCount)
+	{
+		for (size_t i = vertexOffset; i < vertexOffset + vertexCount; ++i)
+		{
+			vertices[i].Normal = glm::vec3(0.0f);
+		}
+
+		for (size_t i = indexOffset; i < indexOffset + indexCount; i += 3)
+		{
+			auto& v0 = vertices[indices[i]];
+			auto& v1 = vertices[indices[i + 1]];
+			auto& v2 = vertices[indices[i + 2]];
+			auto normal = glm::cross(v1.Position - v0.Position, v2.Position - v0.Position);
+			v0.Normal += normal;
+			v1.Normal += normal;
+			v2.Normal += normal;
+		}
+
+		for (size_t i = vertexOffset; i < vertexOffset + vertexCount; ++i)
+		{
+			auto length = glm::length(vertices[i].Normal);
+			vertices[i].Normal = length > 0.0f ? vertices[i].Normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+	}
+}
+
+bool Renderer::MeshImporter::ImportMesh(const std::string& filepath, std::vector<Vertex1Pos1UV1Norm>& outVertices, std::vector<uint32_t>& outIndices,
+	ImportStatistics* pStatistics)
+{
+	auto extension = std::filesystem::path(filepath).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+
+	if (extension == ".obj")
+	{
+		return ImportOBJ(filepath, outVertices, outIndices, pStatistics);
+	}
+	else if (extension == ".glb")
+	{
+		return ImportGLB(filepath, outVertices, outIndices, pStatistics);
+	}
+
+	DEBUG_LOG("Unsupported mesh file type: " + filepath);
+	return false;
+}
+
+bool Renderer::MeshImporter::ImportOBJ(const std::string& filepath, std::vector<Vertex1Pos1UV1Norm>& outVertices, std::vector<uint32_t>& outIndices,
+	ImportStatistics* pStatistics)
+{
+	auto start = ImportClock::now();
+
+	MappedFile file;
+	if (!file.Open(filepath))
+	{
+		DEBUG_LOG("Failed to map mesh file: " + filepath);
+		return false;
+	}
+
+	const char* pBegin = reinterpret_cast<const char*>(file.GetData());
+	const char* pEnd = pBegin + file.GetSize();
+
+	// Split the file into chunks ending on line boundaries
+	const size_t maxChunkCount = (TaskSystem::GetWorkerCount() + 1) * 4;
+	const size_t chunkCount = std::clamp(file.GetSize() / MIN_PARSE_CHUNK_SIZE_BYTES, size_t(1), maxChunkCount);
+	std::vector<ObjChunk> chunks(chunkCount);
+	const char* pChunkBegin = pBegin;
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		chunks[i].Begin = pChunkBegin;
+		chunks[i].End = i + 1 == chunkCount ? pEnd : SkipLine(std::max(pChunkBegin, pBegin + file.GetSize() * (i + 1) / chunkCount), pEnd);
+		pChunkBegin = chunks[i].End;
+	}
+
+	// First pass counts elements so every chunk can parse straight into its own range of preallocated storage
+	TaskSystem::ParallelFor(chunks.size(), 1, [&chunks](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				CountObjChunk(chunks[i]);
+			}
+		});
+
+	ObjChunk totals;
+	for (auto& chunk : chunks)
+	{
+		chunk.PositionOffset = totals.PositionCount;
+		chunk.UVOffset = totals.UVCount;
+		chunk.NormalOffset = totals.NormalCount;
+		chunk.CornerOffset = totals.CornerCount;
+		totals.PositionCount += chunk.PositionCount;
+		totals.UVCount += chunk.UVCount;
+		totals.NormalCount += chunk.NormalCount;
+		totals.CornerCount += chunk.CornerCount;
+	}
+
+	if (totals.CornerCount == 0 || totals.CornerCount > INVALID_INDEX)
+	{
+		DEBUG_LOG("Mesh file has no triangles or too many to index: " + filepath);
+		return false;
+	}
+
+	std::vector<glm::vec3> positions(totals.PositionCount);
+	std::vector<glm::vec2> uvs(totals.UVCount);
+	std::vector<glm::vec3> normals(totals.NormalCount);
+	std::vector<ObjCorner> corners(totals.CornerCount);
+
+	TaskSystem::ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				ParseObjChunk(chunks[i], totals, positions, uvs, normals, corners);
+			}
+		});
+
+	for (const auto& chunk : chunks)
+	{
+		if (chunk.Failed)
+		{
+			DEBUG_LOG("Failed to parse mesh file: " + filepath);
+			return false;
+		}
+	}
+
+	const auto parseMs = ElapsedMilliseconds(start);
+	auto deduplicateStart = ImportClock::now();
+
+	// Each unique position, uv and normal combination becomes one vertex
+	std::vector<ObjCorner> uniqueCorners;
+	uniqueCorners.reserve(totals.CornerCount);
+	outIndices.resize(totals.CornerCount);
+
+	UniqueVertexTable table(totals.CornerCount);
+	bool missingNormals = false;
+	for (size_t i = 0; i < corners.size(); ++i)
+	{
+		const auto& corner = corners[i];
+		auto hash = HashCombine(HashCombine(HashCombine(0, corner.Position), corner.UV), corner.Normal);
+		auto& slot = table.FindSlot(hash, [&](uint32_t uniqueIndex) { return uniqueCorners[uniqueIndex] == corner; });
+		if (slot == INVALID_INDEX)
+		{
+			slot = static_cast<uint32_t>(uniqueCorners.size());
+			uniqueCorners.push_back(corner);
+			missingNormals |= corner.Normal == INVALID_INDEX;
+		}
+		outIndices[i] = slot;
+	}
+
+	const auto deduplicateMs = ElapsedMilliseconds(deduplicateStart);
+
+	outVertices.resize(uniqueCorners.size());
+	TaskSystem::ParallelFor(uniqueCorners.size(), MIN_DECODE_BATCH_SIZE, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				const auto& corner = uniqueCorners[i];
+				auto& vertex = outVertices[i];
+				vertex.Position = ToLeftHanded(positions[corner.Position]);
+				// OBJ texture space starts at the bottom left
+				vertex.UV = corner.UV != INVALID_INDEX ? glm::vec2(uvs[corner.UV].x, 1.0f - uvs[corner.UV].y) : glm::vec2(0.0f);
+				vertex.Normal = corner.Normal != INVALID_INDEX ? ToLeftHanded(normals[corner.Normal]) : glm::vec3(0.0f);
+			}
+		});
+
+	if (missingNormals)
+	{
+		// Generate smooth normals from faces sharing a position, so uv seams do not split shading
+		std::vector<glm::vec3> positionNormals(totals.PositionCount, glm::vec3(0.0f));
+		for (size_t i = 0; i < outIndices.size(); i += 3)
+		{
+			const auto& p0 = outVertices[outIndices[i]].Position;
+			auto normal = glm::cross(outVertices[outIndices[i + 1]].Position - p0, outVertices[outIndices[i + 2]].Position - p0);
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				positionNormals[uniqueCorners[outIndices[i + corner]].Position] += normal;
+			}
+		}
+
+		for (size_t i = 0; i < uniqueCorners.size(); ++i)
+		{
+			if (uniqueCorners[i].Normal == INVALID_INDEX)
+			{
+				auto normal = positionNormals[uniqueCorners[i].Position];
+				auto length = glm::length(normal);
+				outVertices[i].Normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+			}
+		}
+	}
+
+	FillStatistics(pStatistics, file.GetSize(), outVertices.size(), outIndices.size(), totals.CornerCount - outVertices.size(), parseMs, deduplicateMs, start);
+	return true;
+}
+
+bool Renderer::MeshImporter::ImportGLB(const std::string& filepath, std::vector<Vertex1Pos1UV1Norm>& outVertices, std::vector<uint32_t>& outIndices,
+	ImportStatistics* pStatistics)
+{
+	auto start = ImportClock::now();
+
+	MappedFile file;
+	if (!file.Open(filepath))
+	{
+		DEBUG_LOG("Failed to map mesh file: " + filepath);
+		return false;
+	}
+
+	const uint8_t* pData = file.GetData();
+	const size_t size = file.GetSize();
+
+	auto ReadUint32 = [pData](const size_t offset)
+	{
+		uint32_t value;
+		memcpy(&value, pData + offset, sizeof(uint32_t));
+		return value;
+	};
+
+	if (size < GLB_HEADER_SIZE_BYTES + GLB_CHUNK_HEADER_SIZE_BYTES || ReadUint32(0) != GLB_MAGIC || ReadUint32(4) != GLB_VERSION)
+	{
+		DEBUG_LOG("Not a glTF 2.0 binary file: " + filepath);
+		return false;
+	}
+
+	// The JSON chunk comes first, followed by an optional binary chunk
+	const size_t jsonLength = ReadUint32(GLB_HEADER_SIZE_BYTES);
+	const size_t jsonOffset = GLB_HEADER_SIZE_BYTES + GLB_CHUNK_HEADER_SIZE_BYTES;
+	if (ReadUint32(GLB_HEADER_SIZE_BYTES + 4) != GLB_CHUNK_TYPE_JSON || jsonOffset + jsonLength > size)
+	{
+		DEBUG_LOG("Invalid glTF JSON chunk: " + filepath);
+		return false;
+	}
+
+	const uint8_t* pBin = nullptr;
+	size_t binSize = 0;
+	const size_t binHeaderOffset = jsonOffset + jsonLength;
+	if (binHeaderOffset + GLB_CHUNK_HEADER_SIZE_BYTES <= size && ReadUint32(binHeaderOffset + 4) == GLB_CHUNK_TYPE_BIN)
+	{
+		binSize = std::min(static_cast<size_t>(ReadUint32(binHeaderOffset)), size - binHeaderOffset - GLB_CHUNK_HEADER_SIZE_BYTES);
+		pBin = pData + binHeaderOffset + GLB_CHUNK_HEADER_SIZE_BYTES;
+	}
+
+	JsonValue gltf;
+	JsonParser parser(reinterpret_cast<const char*>(pData + jsonOffset), reinterpret_cast<const char*>(pData + jsonOffset + jsonLength));
+	if (!parser.Parse(gltf) || gltf.Type != JsonValue::JSON_OBJECT)
+	{
+		DEBUG_LOG("Failed to parse glTF JSON: " + filepath);
+		return false;
+	}
+
+	auto pRequiredExtensions = gltf.Find("extensionsRequired");
+	if (pRequiredExtensions != nullptr && !pRequiredExtensions->Elements.empty())
+	{
+		DEBUG_LOG("glTF file requires unsupported extension " + pRequiredExtensions->Elements[0].String + ": " + filepath);
+		return false;
+	}
+
+	std::vector<MeshInstance> instances;
+	CollectMeshInstances(gltf, instances);
+
+	// Gather triangle primitives and their ranges of the output buffers
+	std::vector<PrimitiveJob> jobs;
+	size_t totalVertexCount = 0;
+	size_t totalIndexCount = 0;
+	for (const auto& instance : instances)
+	{
+		auto pMesh = gltf.GetElement("meshes", instance.MeshIndex);
+		auto pPrimitives = pMesh != nullptr ? pMesh->Find("primitives") : nullptr;
+		if (pPrimitives == nullptr)
+		{
+			continue;
+		}
+
+		for (const auto& primitive : pPrimitives->Elements)
+		{
+			auto pAttributes = primitive.Find("attributes");
+			if (pAttributes == nullptr || primitive.GetNumber("mode", GLTF_PRIMITIVE_MODE_TRIANGLES) != GLTF_PRIMITIVE_MODE_TRIANGLES)
+			{
+				continue;
+			}
+
+			PrimitiveJob job;
+			job.WorldMatrix = instance.WorldMatrix;
+			if (pBin == nullptr || !GetAccessorView(gltf, pBin, binSize, pAttributes->GetIndex("POSITION"), job.Positions) ||
+				job.Positions.ComponentType != GLTF_COMPONENT_TYPE_FLOAT || job.Positions.ComponentCount != 3)
+			{
+				DEBUG_LOG("Invalid glTF primitive positions: " + filepath);
+				return false;
+			}
+			job.VertexCount = job.Positions.Count;
+
+			auto normalIndex = pAttributes->GetIndex("NORMAL");
+			job.HasNormals = normalIndex != INVALID_JSON_INDEX;
+			if (job.HasNormals && (!GetAccessorView(gltf, pBin, binSize, normalIndex, job.Normals) || job.Normals.Count != job.VertexCount))
+			{
+				DEBUG_LOG("Invalid glTF primitive normals: " + filepath);
+				return false;
+			}
+
+			auto uvIndex = pAttributes->GetIndex("TEXCOORD_0");
+			job.HasUVs = uvIndex != INVALID_JSON_INDEX;
+			if (job.HasUVs && (!GetAccessorView(gltf, pBin, binSize, uvIndex, job.UVs) || job.UVs.Count != job.VertexCount))
+			{
+				DEBUG_LOG("Invalid glTF primitive uvs: " + filepath);
+				return false;
+			}
+
+			auto indicesIndex = primitive.GetIndex("indices");
+			job.HasIndices = indicesIndex != INVALID_JSON_INDEX;
+			if (job.HasIndices && !GetAccessorView(gltf, pBin, binSize, indicesIndex, job.Indices))
+			{
+				DEBUG_LOG("Invalid glTF primitive indices: " + filepath);
+				return false;
+			}
+
+			job.IndexCount = (job.HasIndices ? job.Indices.Count : job.VertexCount) / 3 * 3;
+			job.VertexOffset = totalVertexCount;
+			job.IndexOffset = totalIndexCount;
+			totalVertexCount += job.VertexCount;
+			totalIndexCount += job.IndexCount;
+			jobs.push_back(job);
+		}
+	}
+
+	if (totalIndexCount == 0 || totalVertexCount > INVALID_INDEX)
+	{
+		DEBUG_LOG("Mesh file has no triangles or too many to index: " + filepath);
+		return false;
+	}
+
+	outVertices.resize(totalVertexCount);
+	outIndices.resize(totalIndexCount);
+
+	std::atomic<bool> invalidIndex = false;
+	for (const auto& job : jobs)
+	{
+		const glm::mat3 normalMatrix = glm::inverse(glm::transpose(glm::mat3(job.WorldMatrix)));
+
+		TaskSystem::ParallelFor(job.VertexCount, MIN_DECODE_BATCH_SIZE, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					auto& vertex = outVertices[job.VertexOffset + i];
+
+					glm::vec3 position;
+					ReadFloats(job.Positions, i, &position.x, 3);
+					vertex.Position = ToLeftHanded(glm::vec3(job.WorldMatrix * glm::vec4(position, 1.0f)));
+
+					if (job.HasNormals)
+					{
+						glm::vec3 normal;
+						ReadFloats(job.Normals, i, &normal.x, 3);
+						vertex.Normal = ToLeftHanded(glm::normalize(normalMatrix * normal));
+					}
+
+					if (job.HasUVs)
+					{
+						ReadFloats(job.UVs, i, &vertex.UV.x, 2);
+					}
+				}
+			});
+
+		// Triangles are reversed for the left handed conversion, unless a mirrored node transform already reversed them
+		const bool flipWinding = glm::determinant(glm::mat3(job.WorldMatrix)) >= 0.0f;
+		const uint32_t vertexOffset = static_cast<uint32_t>(job.VertexOffset);
+
+		TaskSystem::ParallelFor(job.IndexCount / 3, MIN_DECODE_BATCH_SIZE, [&](size_t begin, size_t end)
+			{
+				for (size_t triangle = begin; triangle < end; ++triangle)
+				{
+					uint32_t triangleIndices[3];
+					for (size_t corner = 0; corner < 3; ++corner)
+					{
+						auto index = job.HasIndices ? ReadIndex(job.Indices, triangle * 3 + corner) : static_cast<uint32_t>(triangle * 3 + corner);
+						if (index >= job.VertexCount)
+						{
+							invalidIndex = true;
+							index = 0;
+						}
+						triangleIndices[corner] = vertexOffset + index;
+					}
+
+					if (flipWinding)
+					{
+						std::swap(triangleIndices[1], triangleIndices[2]);
+					}
+
+					memcpy(&outIndices[job.IndexOffset + triangle * 3], triangleIndices, sizeof(triangleIndices));
+				}
+			});
+
+		if (!job.HasNormals)
+		{
+			GenerateNormals(outVertices, outIndices, job.IndexOffset, job.IndexCount, job.VertexOffset, job.VertexCount);
+		}
+	}
+
+	if (invalidIndex)
+	{
+		DEBUG_LOG("glTF primitive index is out of range: " + filepath);
+		return false;
+	}
+
+	const auto parseMs = ElapsedMilliseconds(start);
+	auto deduplicateStart = ImportClock::now();
+
+	// Merge identical vertices, compacting unique vertices in place since a unique index is never past the vertex it comes from
+	std::vector<uint32_t> remap(totalVertexCount);
+	UniqueVertexTable table(totalVertexCount);
+	uint32_t uniqueCount = 0;
+	for (size_t i = 0; i < totalVertexCount; ++i)
+	{
+		uint32_t bits[sizeof(Vertex1Pos1UV1Norm) / sizeof(uint32_t)];
+		memcpy(bits, &outVertices[i], sizeof(Vertex1Pos1UV1Norm));
+
+		uint64_t hash = 0;
+		for (auto value : bits)
+		{
+			hash = HashCombine(hash, value);
+		}
+
+		auto& slot = table.FindSlot(hash, [&](uint32_t uniqueIndex) { return memcmp(&outVertices[uniqueIndex], bits, sizeof(bits)) == 0; });
+		if (slot == INVALID_INDEX)
+		{
+			slot = uniqueCount;
+			outVertices[uniqueCount++] = outVertices[i];
+		}
+		remap[i] = slot;
+	}
+	outVertices.resize(uniqueCount);
+
+	TaskSystem::ParallelFor(outIndices.size(), MIN_DECODE_BATCH_SIZE, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				outIndices[i] = remap[outIndices[i]];
+			}
+		});
+
+	const auto deduplicateMs = ElapsedMilliseconds(deduplicateStart);
+
+	FillStatistics(pStatistics, size, outVertices.size(), outIndices.size(), totalVertexCount - uniqueCount, parseMs, deduplicateMs, start);
+	return true;
+}
\ No newline at end of file
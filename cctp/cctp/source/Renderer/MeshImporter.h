@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Renderer/Vertices/Vertex1Pos1UV1Norm.h"
+
+namespace Renderer
+{
+	namespace MeshImporter
+	{
+		// Files are split into chunks of at least this size for parallel parsing
+		constexpr size_t MIN_PARSE_CHUNK_SIZE_BYTES = 1024 * 1024;
+		// Vertices and indices are decoded in batches of at least this many elements
+		constexpr size_t MIN_DECODE_BATCH_SIZE = 16 * 1024;
+
+		struct ImportStatistics
+		{
+			size_t FileSizeBytes = 0;
+			size_t VertexCount = 0;
+			size_t IndexCount = 0;
+			// Vertices merged into an identical vertex by the deduplication hash table
+			size_t DuplicateVertexCount = 0;
+			double ParseMilliseconds = 0.0;
+			double DeduplicateMilliseconds = 0.0;
+			double TotalMilliseconds = 0.0;
+			// File bytes imported per second, including mapping, parsing and deduplication
+			double ThroughputMBPerSecond = 0.0;
+		};
+
+		// Imports every triangle of the file into one vertex and index buffer, converted to the renderer's left handed coordinates with
+		// clockwise front faces. Missing normals are generated, missing uvs are zero. The file type is chosen from the extension
+		bool ImportMesh(const std::string& filepath, std::vector<Vertex1Pos1UV1Norm>& outVertices, std::vector<uint32_t>& outIndices,
+			ImportStatistics* pStatistics = nullptr);
+
+		// Wavefront OBJ. Polygons are triangulated as fans, materials and groups are ignored
+		bool ImportOBJ(const std::string& filepath, std::vector<Vertex1Pos1UV1Norm>& outVertices, std::vector<uint32_t>& outIndices,
+			ImportStatistics* pStatistics = nullptr);
+
+		// Binary glTF 2.0. Triangle primitives of every mesh in the default scene are imported with their node transforms applied.
+		// Only the embedded binary buffer is supported, external buffers and compression extensions are rejected
+		bool ImportGLB(const std::string& filepath, std::vector<Vertex1Pos1UV1Norm>& outVertices, std::vector<uint32_t>& outIndices,
+			ImportStatistics* pStatistics = nullptr);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+namespace Renderer
+{
+	// Range of a mesh index buffer holding one level of detail. All levels share the mesh vertex buffer
+	struct MeshLOD
+	{
+		uint32_t IndexOffset = 0;
+		uint32_t IndexCount = 0;
+		// Simplification error relative to the mesh bounds extent
+		float Error = 0.0f;
+		// Largest projected size in pixels this level is used at
+		float MaxScreenSize = std::numeric_limits<float>::max();
+	};
+}
\ No newline at end of file
@@ -0,0 +1,428 @@
+#include "Pch.h"
+#include "MeshOptimizer.h"
+
+namespace
+{
+	constexpr uint32_t INVALID_INDEX = ~0u;
+
+	// Forsyth scoring constants, see https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+	constexpr float CACHE_DECAY_POWER = 1.5f;
+	constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+	constexpr float VALENCE_BOOST_SCALE = 2.0f;
+	constexpr float VALENCE_BOOST_POWER = 0.5f;
+	constexpr uint32_t MAX_SCORED_VALENCE = 32;
+
+	float CalculateVertexScore(const int32_t cachePosition, const uint32_t remainingValence)
+	{
+		// Vertices with no triangles left to draw should never be chosen
+		if (remainingValence == 0)
+		{
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				// Vertices used by the last triangle get a fixed score so that strips are not always preferred
+				score = LAST_TRIANGLE_SCORE;
+			}
+			else
+			{
+				constexpr float scaler = 1.0f / (Renderer::MeshOptimizer::OPTIMIZER_VERTEX_CACHE_SIZE - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+			}
+		}
+
+		// Boost vertices with few triangles remaining so lone triangles are not left behind
+		auto valence = std::min(remainingValence, MAX_SCORED_VALENCE);
+		score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(valence), -VALENCE_BOOST_POWER);
+
+		return score;
+	}
+
+	struct TriangleCluster
+	{
+		size_t FirstTriangle = 0;
+		size_t TriangleCount = 0;
+		float SortKey = 0.0f;
+	};
+}
+
+Renderer::MeshOptimizer::VertexCacheStatistics Renderer::MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices,
+	const size_t vertexCount, const uint32_t cacheSize)
+{
+	assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3.");
+
+	VertexCacheStatistics statistics = {};
+	if (indices.empty())
+	{
+		return statistics;
+	}
+
+	// A vertex is in the FIFO cache if fewer than cacheSize misses happened since it was last transformed
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	uint32_t timestamp = cacheSize + 1;
+	uint32_t uniqueVertexCount = 0;
+
+	for (const auto index : indices)
+	{
+		assert(index < vertexCount && "Index buffer references a vertex out of range.");
+
+		if (timestamp - cacheTimestamps[index] > cacheSize)
+		{
+			cacheTimestamps[index] = timestamp++;
+			++statistics.VerticesTransformed;
+		}
+
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			++uniqueVertexCount;
+		}
+	}
+
+	statistics.ACMR = static_cast<float>(statistics.VerticesTransformed) / static_cast<float>(indices.size() / 3);
+	statistics.ATVR = static_cast<float>(statistics.VerticesTransformed) / static_cast<float>(uniqueVertexCount);
+
+	return statistics;
+}
+
+void Renderer::MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, const size_t vertexCount)
+{
+	assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3.");
+
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Build vertex to triangle adjacency
+	std::vector<uint32_t> remainingValence(vertexCount, 0);
+	for (const auto index : indices)
+	{
+		++remainingValence[index];
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + remainingValence[i];
+	}
+
+	std::vector<uint32_t> adjacentTriangles(indices.size());
+	{
+		std::vector<uint32_t> fillCounts(vertexCount, 0);
+		for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				auto vertex = indices[triangle * 3 + corner];
+				adjacentTriangles[adjacencyOffsets[vertex] + fillCounts[vertex]++] = static_cast<uint32_t>(triangle);
+			}
+		}
+	}
+
+	// Initial scores
+	std::vector<int32_t> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		vertexScores[i] = CalculateVertexScore(-1, remainingValence[i]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> triangleEmitted(triangleCount, false);
+	for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+	{
+		triangleScores[triangle] = vertexScores[indices[triangle * 3]] +
+			vertexScores[indices[triangle * 3 + 1]] +
+			vertexScores[indices[triangle * 3 + 2]];
+	}
+
+	// The cache holds 3 extra entries so the vertices of a newly emitted triangle can be pushed before evicting
+	std::array<uint32_t, OPTIMIZER_VERTEX_CACHE_SIZE + 3> cache;
+	std::array<uint32_t, OPTIMIZER_VERTEX_CACHE_SIZE + 3> newCache;
+	cache.fill(INVALID_INDEX);
+	uint32_t cacheCount = 0;
+
+	std::vector<uint32_t> outIndices;
+	outIndices.reserve(indices.size());
+
+	size_t inputCursor = 0;
+	uint32_t bestTriangle = INVALID_INDEX;
+
+	for (size_t emitted = 0; emitted < triangleCount; ++emitted)
+	{
+		// No candidate from the cache, fall back to the next unemitted triangle in input order
+		if (bestTriangle == INVALID_INDEX)
+		{
+			while (triangleEmitted[inputCursor])
+			{
+				++inputCursor;
+			}
+			bestTriangle = static_cast<uint32_t>(inputCursor);
+		}
+
+		// Emit the best triangle
+		const uint32_t triangleVertices[3] = { indices[bestTriangle * 3], indices[bestTriangle * 3 + 1], indices[bestTriangle * 3 + 2] };
+		outIndices.insert(outIndices.end(), std::begin(triangleVertices), std::end(triangleVertices));
+		triangleEmitted[bestTriangle] = true;
+
+		// Remove the triangle from the adjacency of its vertices
+		for (const auto vertex : triangleVertices)
+		{
+			auto* begin = adjacentTriangles.data() + adjacencyOffsets[vertex];
+			auto* end = begin + remainingValence[vertex];
+			auto* found = std::find(begin, end, bestTriangle);
+			assert(found != end && "Vertex triangle adjacency is out of sync.");
+			std::swap(*found, *(end - 1));
+			--remainingValence[vertex];
+		}
+
+		// Push the triangle vertices to the front of the LRU cache
+		uint32_t newCacheCount = 0;
+		for (const auto vertex : triangleVertices)
+		{
+			if (std::find(newCache.begin(), newCache.begin() + newCacheCount, vertex) == newCache.begin() + newCacheCount)
+			{
+				newCache[newCacheCount++] = vertex;
+			}
+		}
+
+		for (uint32_t i = 0; i < cacheCount; ++i)
+		{
+			auto vertex = cache[i];
+			if (vertex != triangleVertices[0] && vertex != triangleVertices[1] && vertex != triangleVertices[2])
+			{
+				newCache[newCacheCount++] = vertex;
+			}
+		}
+
+		// Update scores for every vertex that was touched, including evicted ones
+		for (uint32_t i = 0; i < newCacheCount; ++i)
+		{
+			auto vertex = newCache[i];
+			cachePositions[vertex] = i < OPTIMIZER_VERTEX_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+
+			auto newScore = CalculateVertexScore(cachePositions[vertex], remainingValence[vertex]);
+			auto scoreDelta = newScore - vertexScores[vertex];
+			vertexScores[vertex] = newScore;
+
+			auto* begin = adjacentTriangles.data() + adjacencyOffsets[vertex];
+			auto* end = begin + remainingValence[vertex];
+			for (auto* triangle = begin; triangle != end; ++triangle)
+			{
+				triangleScores[*triangle] += scoreDelta;
+			}
+		}
+
+		cacheCount = std::min(newCacheCount, OPTIMIZER_VERTEX_CACHE_SIZE);
+		std::copy(newCache.begin(), newCache.begin() + cacheCount, cache.begin());
+
+		// Pick the next triangle once every score is final, a triangle can share several of the updated vertices. Only triangles
+		// touching vertices still in the cache are candidates
+		bestTriangle = INVALID_INDEX;
+		float bestScore = -1.0f;
+		for (uint32_t i = 0; i < cacheCount; ++i)
+		{
+			auto* begin = adjacentTriangles.data() + adjacencyOffsets[cache[i]];
+			auto* end = begin + remainingValence[cache[i]];
+			for (auto* triangle = begin; triangle != end; ++triangle)
+			{
+				if (triangleScores[*triangle] > bestScore)
+				{
+					bestScore = triangleScores[*triangle];
+					bestTriangle = *triangle;
+				}
+			}
+		}
+	}
+
+	indices = std::move(outIndices);
+}
+
+void Renderer::MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex1Pos1UV1Norm>& vertices, const float threshold)
+{
+	assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3.");
+
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Simulate the FIFO cache and record the misses of every triangle
+	std::vector<uint32_t> triangleMisses(triangleCount, 0);
+	{
+		std::vector<uint32_t> cacheTimestamps(vertices.size(), 0);
+		uint32_t timestamp = ANALYSIS_VERTEX_CACHE_SIZE + 1;
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			auto index = indices[i];
+			if (timestamp - cacheTimestamps[index] > ANALYSIS_VERTEX_CACHE_SIZE)
+			{
+				cacheTimestamps[index] = timestamp++;
+				++triangleMisses[i / 3];
+			}
+		}
+	}
+
+	// Hard boundaries are triangles where the cache was fully flushed, splitting there costs nothing
+	std::vector<size_t> hardBoundaries;
+	for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+	{
+		if (triangle == 0 || triangleMisses[triangle] == 3)
+		{
+			hardBoundaries.push_back(triangle);
+		}
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	// Soft boundaries split hard clusters further wherever the running ACMR stays within the threshold
+	std::vector<TriangleCluster> clusters;
+	std::vector<uint32_t> cacheTimestamps(vertices.size(), 0);
+	uint32_t timestamp = 0;
+	for (size_t i = 0; i + 1 < hardBoundaries.size(); ++i)
+	{
+		const size_t start = hardBoundaries[i];
+		const size_t end = hardBoundaries[i + 1];
+
+		uint32_t clusterMisses = 0;
+		for (size_t triangle = start; triangle < end; ++triangle)
+		{
+			clusterMisses += triangleMisses[triangle];
+		}
+		const float clusterACMR = static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+		// Every hard cluster starts with a cold cache, moving the timestamp past the cache size invalidates all entries
+		timestamp += ANALYSIS_VERTEX_CACHE_SIZE + 1;
+		size_t clusterStart = start;
+		uint32_t runningMisses = 0;
+
+		for (size_t triangle = start; triangle < end; ++triangle)
+		{
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				auto index = indices[triangle * 3 + corner];
+				if (timestamp - cacheTimestamps[index] > ANALYSIS_VERTEX_CACHE_SIZE)
+				{
+					cacheTimestamps[index] = timestamp++;
+					++runningMisses;
+				}
+			}
+
+			const size_t runningTriangles = triangle - clusterStart + 1;
+			const float runningACMR = static_cast<float>(runningMisses) / static_cast<float>(runningTriangles);
+			if (triangle + 1 < end && runningACMR <= clusterACMR * threshold)
+			{
+				clusters.push_back({ clusterStart, runningTriangles, 0.0f });
+				clusterStart = triangle + 1;
+				runningMisses = 0;
+				// Flush the simulated cache, the next cluster may be drawn in any order
+				timestamp += ANALYSIS_VERTEX_CACHE_SIZE + 1;
+			}
+		}
+
+		if (clusterStart < end)
+		{
+			clusters.push_back({ clusterStart, end - clusterStart, 0.0f });
+		}
+	}
+
+	// Sort key is the distance of each cluster's centroid from the mesh centroid along the cluster's average normal,
+	// clusters that face outwards are likely to occlude the rest of the mesh
+	glm::vec3 meshCentroid = glm::vec3(0.0f);
+	for (const auto& vertex : vertices)
+	{
+		meshCentroid += vertex.Position;
+	}
+	meshCentroid /= static_cast<float>(std::max<size_t>(vertices.size(), 1));
+
+	for (auto& cluster : clusters)
+	{
+		glm::vec3 centroid = glm::vec3(0.0f);
+		glm::vec3 normal = glm::vec3(0.0f);
+		float areaSum = 0.0f;
+
+		for (size_t triangle = cluster.FirstTriangle; triangle < cluster.FirstTriangle + cluster.TriangleCount; ++triangle)
+		{
+			const auto& p0 = vertices[indices[triangle * 3]].Position;
+			const auto& p1 = vertices[indices[triangle * 3 + 1]].Position;
+			const auto& p2 = vertices[indices[triangle * 3 + 2]].Position;
+
+			// Cross product length is twice the triangle area, so the summed normal is area weighted
+			auto faceNormal = glm::cross(p1 - p0, p2 - p0);
+			auto area = glm::length(faceNormal);
+
+			centroid += (p0 + p1 + p2) * (area / 3.0f);
+			normal += faceNormal;
+			areaSum += area;
+		}
+
+		if (areaSum > 0.0f)
+		{
+			centroid /= areaSum;
+		}
+
+		auto normalLength = glm::length(normal);
+		cluster.SortKey = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const TriangleCluster& a, const TriangleCluster& b)
+		{
+			return a.SortKey > b.SortKey;
+		});
+
+	std::vector<uint32_t> outIndices;
+	outIndices.reserve(indices.size());
+	for (const auto& cluster : clusters)
+	{
+		outIndices.insert(outIndices.end(),
+			indices.begin() + cluster.FirstTriangle * 3,
+			indices.begin() + (cluster.FirstTriangle + cluster.TriangleCount) * 3);
+	}
+
+	indices = std::move(outIndices);
+}
+
+void Renderer::MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex1Pos1UV1Norm>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), INVALID_INDEX);
+	std::vector<Vertex1Pos1UV1Norm> outVertices;
+	outVertices.reserve(vertices.size());
+
+	for (auto& index : indices)
+	{
+		if (remap[index] == INVALID_INDEX)
+		{
+			remap[index] = static_cast<uint32_t>(outVertices.size());
+			outVertices.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices = std::move(outVertices);
+}
+
+Renderer::MeshOptimizer::OptimizationReport Renderer::MeshOptimizer::OptimizeMesh(std::vector<Vertex1Pos1UV1Norm>& vertices, std::vector<uint32_t>& indices,
+	const bool optimizeOverdraw, const float overdrawThreshold)
+{
+	OptimizationReport report = {};
+	report.Before = AnalyzeVertexCache(indices, vertices.size());
+
+	OptimizeVertexCache(indices, vertices.size());
+
+	if (optimizeOverdraw)
+	{
+		OptimizeOverdraw(indices, vertices, overdrawThreshold);
+	}
+
+	OptimizeVertexFetch(vertices, indices);
+
+	report.After = AnalyzeVertexCache(indices, vertices.size());
+	return report;
+}
\ No newline at end of file
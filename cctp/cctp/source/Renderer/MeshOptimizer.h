@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Renderer/Vertices/Vertex1Pos1UV1Norm.h"
+
+namespace Renderer
+{
+	namespace MeshOptimizer
+	{
+		// Size of the FIFO post-transform cache used when analyzing index buffers
+		constexpr uint32_t ANALYSIS_VERTEX_CACHE_SIZE = 16;
+		// Size of the LRU cache modelled by the vertex cache optimizer
+		constexpr uint32_t OPTIMIZER_VERTEX_CACHE_SIZE = 32;
+		// Maximum ACMR increase allowed when splitting triangles into overdraw clusters
+		constexpr float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+
+		struct VertexCacheStatistics
+		{
+			uint32_t VerticesTransformed = 0;
+			// Average cache miss ratio, transformed vertices per triangle. 0.5 is optimal for large grids, 3.0 is the worst case
+			float ACMR = 0.0f;
+			// Average transform to vertex ratio, transformed vertices per unique vertex. 1.0 is optimal
+			float ATVR = 0.0f;
+		};
+
+		struct OptimizationReport
+		{
+			VertexCacheStatistics Before = {};
+			VertexCacheStatistics After = {};
+		};
+
+		VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, const size_t vertexCount,
+			const uint32_t cacheSize = ANALYSIS_VERTEX_CACHE_SIZE);
+
+		// Reorders triangles for post-transform vertex cache locality using Forsyth's linear-speed algorithm
+		void OptimizeVertexCache(std::vector<uint32_t>& indices, const size_t vertexCount);
+
+		// Splits a cache optimized index buffer into clusters and sorts them so outward facing clusters are drawn first.
+		// Clusters are only split where doing so keeps the ACMR within threshold times the input ACMR
+		void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex1Pos1UV1Norm>& vertices, const float threshold);
+
+		// Reorders vertices into first use order of the index buffer and remaps the indices. Unreferenced vertices are removed
+		void OptimizeVertexFetch(std::vector<Vertex1Pos1UV1Norm>& vertices, std::vector<uint32_t>& indices);
+
+		// Runs the vertex cache, optional overdraw and vertex fetch stages in order and reports cache statistics before and after
+		OptimizationReport OptimizeMesh(std::vector<Vertex1Pos1UV1Norm>& vertices, std::vector<uint32_t>& indices, const bool optimizeOverdraw,
+			const float overdrawThreshold = DEFAULT_OVERDRAW_THRESHOLD);
+	}
+}
\ No newline at end of file
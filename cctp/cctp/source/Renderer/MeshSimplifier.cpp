@@ -0,0 +1,580 @@
+#include "Pch.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+	constexpr uint32_t INVALID_INDEX = ~0u;
+	constexpr float INVALID_COLLAPSE_ERROR = std::numeric_limits<float>::max();
+	// Border and seam edges are preserved by planes perpendicular to their triangles, weighted relative to the triangle planes
+	constexpr float BORDER_EDGE_WEIGHT = 10.0f;
+
+	enum VERTEX_KIND : uint8_t
+	{
+		// Interior vertex, can collapse onto any neighbour
+		VERTEX_KIND_MANIFOLD = 0,
+		// Vertex on an open border, can only collapse along the border
+		VERTEX_KIND_BORDER,
+		// Vertex on an attribute seam, both sides of the seam collapse together along the seam
+		VERTEX_KIND_SEAM,
+		// Vertex with complex topology, never collapses
+		VERTEX_KIND_LOCKED
+	};
+
+	// Symmetric 4x4 plane quadric, error of a point is its weighted squared distance to the accumulated planes
+	struct Quadric
+	{
+		float A00 = 0.0f, A11 = 0.0f, A22 = 0.0f;
+		float A10 = 0.0f, A20 = 0.0f, A21 = 0.0f;
+		float B0 = 0.0f, B1 = 0.0f, B2 = 0.0f;
+		float C = 0.0f;
+		float Weight = 0.0f;
+	};
+
+	struct Collapse
+	{
+		uint32_t Vertex = 0;
+		uint32_t Target = 0;
+		float Error = 0.0f;
+	};
+
+	struct PositionHasher
+	{
+		size_t operator()(const glm::vec3& position) const
+		{
+			uint32_t bits[3];
+			memcpy(bits, &position, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	Quadric CreatePlaneQuadric(const glm::vec3& normal, const float distance, const float weight)
+	{
+		Quadric quadric;
+		quadric.A00 = normal.x * normal.x * weight;
+		quadric.A11 = normal.y * normal.y * weight;
+		quadric.A22 = normal.z * normal.z * weight;
+		quadric.A10 = normal.y * normal.x * weight;
+		quadric.A20 = normal.z * normal.x * weight;
+		quadric.A21 = normal.z * normal.y * weight;
+		quadric.B0 = normal.x * distance * weight;
+		quadric.B1 = normal.y * distance * weight;
+		quadric.B2 = normal.z * distance * weight;
+		quadric.C = distance * distance * weight;
+		quadric.Weight = weight;
+		return quadric;
+	}
+
+	void AddQuadric(Quadric& quadric, const Quadric& other)
+	{
+		quadric.A00 += other.A00;
+		quadric.A11 += other.A11;
+		quadric.A22 += other.A22;
+		quadric.A10 += other.A10;
+		quadric.A20 += other.A20;
+		quadric.A21 += other.A21;
+		quadric.B0 += other.B0;
+		quadric.B1 += other.B1;
+		quadric.B2 += other.B2;
+		quadric.C += other.C;
+		quadric.Weight += other.Weight;
+	}
+
+	// Returns the weighted mean squared distance of the point to the planes of the quadric
+	float EvaluateQuadric(const Quadric& quadric, const glm::vec3& p)
+	{
+		float rx = quadric.A00 * p.x + quadric.A10 * p.y + quadric.A20 * p.z;
+		float ry = quadric.A10 * p.x + quadric.A11 * p.y + quadric.A21 * p.z;
+		float rz = quadric.A20 * p.x + quadric.A21 * p.y + quadric.A22 * p.z;
+
+		float error = rx * p.x + ry * p.y + rz * p.z;
+		error += 2.0f * (quadric.B0 * p.x + quadric.B1 * p.y + quadric.B2 * p.z);
+		error += quadric.C;
+
+		return quadric.Weight > 0.0f ? std::abs(error) / quadric.Weight : 0.0f;
+	}
+
+	uint64_t EdgeKey(const uint32_t a, const uint32_t b)
+	{
+		return (static_cast<uint64_t>(a) << 32) | b;
+	}
+}
+
+float Renderer::MeshSimplifier::Simplify(const std::vector<Vertex1Pos1UV1Norm>& vertices, const std::vector<uint32_t>& indices, const size_t targetIndexCount,
+	const float targetError, std::vector<uint32_t>& outIndices)
+{
+	assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3.");
+
+	outIndices = indices;
+	if (indices.size() <= targetIndexCount || vertices.empty())
+	{
+		return 0.0f;
+	}
+
+	const size_t vertexCount = vertices.size();
+
+	// Normalize positions into the unit cube so errors are relative to the mesh extent
+	glm::vec3 min = vertices[0].Position;
+	glm::vec3 max = vertices[0].Position;
+	for (const auto& vertex : vertices)
+	{
+		min = glm::min(min, vertex.Position);
+		max = glm::max(max, vertex.Position);
+	}
+
+	auto extentVector = max - min;
+	float extent = std::max({ extentVector.x, extentVector.y, extentVector.z });
+	extent = extent > 0.0f ? extent : 1.0f;
+
+	std::vector<glm::vec3> positions(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		positions[i] = (vertices[i].Position - min) / extent;
+	}
+
+	// Weld vertices sharing a position. Wedges link every vertex at the same position in a ring
+	std::vector<uint32_t> positionRemap(vertexCount);
+	std::vector<uint32_t> wedges(vertexCount);
+	{
+		std::unordered_map<glm::vec3, uint32_t, PositionHasher> firstVertexAtPosition;
+		firstVertexAtPosition.reserve(vertexCount);
+
+		for (uint32_t i = 0; i < static_cast<uint32_t>(vertexCount); ++i)
+		{
+			// Adding zero turns negative zero into positive zero so both hash the same
+			auto [it, inserted] = firstVertexAtPosition.emplace(vertices[i].Position + glm::vec3(0.0f), i);
+			positionRemap[i] = it->second;
+
+			if (inserted)
+			{
+				wedges[i] = i;
+			}
+			else
+			{
+				wedges[i] = wedges[it->second];
+				wedges[it->second] = i;
+			}
+		}
+	}
+
+	// Find open edges, half edges without an opposite, in both attribute and position space
+	std::unordered_set<uint64_t> attributeEdges;
+	std::unordered_set<uint64_t> positionEdges;
+	attributeEdges.reserve(indices.size());
+	positionEdges.reserve(indices.size());
+
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			auto a = indices[i + corner];
+			auto b = indices[i + (corner + 1) % 3];
+			attributeEdges.insert(EdgeKey(a, b));
+			positionEdges.insert(EdgeKey(positionRemap[a], positionRemap[b]));
+		}
+	}
+
+	std::vector<uint8_t> attributeOpenOutCount(vertexCount, 0);
+	std::vector<uint8_t> attributeOpenInCount(vertexCount, 0);
+	std::vector<uint32_t> attributeOpenOut(vertexCount, INVALID_INDEX);
+	std::vector<uint32_t> attributeOpenIn(vertexCount, INVALID_INDEX);
+
+	// Indexed by the position's first vertex, targets are stored as attribute vertices
+	std::vector<uint8_t> positionOpenOutCount(vertexCount, 0);
+	std::vector<uint8_t> positionOpenInCount(vertexCount, 0);
+	std::vector<uint32_t> positionOpenOut(vertexCount, INVALID_INDEX);
+	std::vector<uint32_t> positionOpenIn(vertexCount, INVALID_INDEX);
+
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			auto a = indices[i + corner];
+			auto b = indices[i + (corner + 1) % 3];
+
+			if (attributeEdges.count(EdgeKey(b, a)) == 0)
+			{
+				++attributeOpenOutCount[a];
+				++attributeOpenInCount[b];
+				attributeOpenOut[a] = b;
+				attributeOpenIn[b] = a;
+			}
+
+			if (positionEdges.count(EdgeKey(positionRemap[b], positionRemap[a])) == 0)
+			{
+				++positionOpenOutCount[positionRemap[a]];
+				++positionOpenInCount[positionRemap[b]];
+				positionOpenOut[positionRemap[a]] = b;
+				positionOpenIn[positionRemap[b]] = a;
+			}
+		}
+	}
+
+	// Classify vertices. Loops store the open edges a border or seam vertex may collapse along
+	std::vector<VERTEX_KIND> kinds(vertexCount, VERTEX_KIND_LOCKED);
+	std::vector<uint32_t> loops(vertexCount, INVALID_INDEX);
+	std::vector<uint32_t> loopBacks(vertexCount, INVALID_INDEX);
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(vertexCount); ++i)
+	{
+		auto position = positionRemap[i];
+		bool positionClosed = positionOpenOutCount[position] == 0 && positionOpenInCount[position] == 0;
+
+		if (wedges[i] == i)
+		{
+			if (positionClosed)
+			{
+				kinds[i] = VERTEX_KIND_MANIFOLD;
+			}
+			else if (positionOpenOutCount[position] == 1 && positionOpenInCount[position] == 1)
+			{
+				kinds[i] = VERTEX_KIND_BORDER;
+				loops[i] = positionOpenOut[position];
+				loopBacks[i] = positionOpenIn[position];
+			}
+		}
+		else if (wedges[wedges[i]] == i && positionClosed)
+		{
+			auto sibling = wedges[i];
+			if (attributeOpenOutCount[i] == 1 && attributeOpenInCount[i] == 1 &&
+				attributeOpenOutCount[sibling] == 1 && attributeOpenInCount[sibling] == 1)
+			{
+				kinds[i] = VERTEX_KIND_SEAM;
+				loops[i] = attributeOpenOut[i];
+				loopBacks[i] = attributeOpenIn[i];
+			}
+		}
+	}
+
+	// Accumulate quadrics per position
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		const auto& p0 = positions[indices[i]];
+		const auto& p1 = positions[indices[i + 1]];
+		const auto& p2 = positions[indices[i + 2]];
+
+		auto normal = glm::cross(p1 - p0, p2 - p0);
+		auto length = glm::length(normal);
+		if (length <= 0.0f)
+		{
+			continue;
+		}
+		normal /= length;
+
+		// Weighted by triangle area
+		auto planeQuadric = CreatePlaneQuadric(normal, -glm::dot(normal, p0), length * 0.5f);
+		AddQuadric(quadrics[positionRemap[indices[i]]], planeQuadric);
+		AddQuadric(quadrics[positionRemap[indices[i + 1]]], planeQuadric);
+		AddQuadric(quadrics[positionRemap[indices[i + 2]]], planeQuadric);
+
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			auto a = indices[i + corner];
+			auto b = indices[i + (corner + 1) % 3];
+			if (attributeEdges.count(EdgeKey(b, a)) != 0)
+			{
+				continue;
+			}
+
+			auto edge = positions[b] - positions[a];
+			auto edgeLength = glm::length(edge);
+			if (edgeLength <= 0.0f)
+			{
+				continue;
+			}
+
+			auto edgeNormal = glm::normalize(glm::cross(edge, normal));
+			auto edgeQuadric = CreatePlaneQuadric(edgeNormal, -glm::dot(edgeNormal, positions[a]), edgeLength * edgeLength * BORDER_EDGE_WEIGHT);
+			AddQuadric(quadrics[positionRemap[a]], edgeQuadric);
+			AddQuadric(quadrics[positionRemap[b]], edgeQuadric);
+		}
+	}
+
+	// Collapses are recorded in a remap that is followed to find the surviving vertex
+	std::vector<uint32_t> collapseRemap(vertexCount);
+	for (uint32_t i = 0; i < static_cast<uint32_t>(vertexCount); ++i)
+	{
+		collapseRemap[i] = i;
+	}
+
+	auto Resolve = [&collapseRemap](uint32_t vertex)
+	{
+		while (vertex != INVALID_INDEX && collapseRemap[vertex] != vertex)
+		{
+			vertex = collapseRemap[vertex];
+		}
+		return vertex;
+	};
+
+	auto IsLoopEdge = [&](const uint32_t vertex, const uint32_t target)
+	{
+		return Resolve(loops[vertex]) == target || Resolve(loopBacks[vertex]) == target;
+	};
+
+	auto CanCollapse = [&](const uint32_t vertex, const uint32_t target)
+	{
+		if (positionRemap[vertex] == positionRemap[target])
+		{
+			return false;
+		}
+
+		switch (kinds[vertex])
+		{
+		case VERTEX_KIND_MANIFOLD:
+			return true;
+		case VERTEX_KIND_BORDER:
+			return kinds[target] == VERTEX_KIND_BORDER && IsLoopEdge(vertex, target);
+		case VERTEX_KIND_SEAM:
+			// The other side of the seam must collapse along its own seam edge at the same time
+			return kinds[target] == VERTEX_KIND_SEAM && IsLoopEdge(vertex, target) && IsLoopEdge(wedges[vertex], wedges[target]);
+		default:
+			return false;
+		}
+	};
+
+	// Moves the open edge loop of a collapsed vertex onto its target
+	auto MergeLoops = [&](const uint32_t vertex, const uint32_t target)
+	{
+		if (Resolve(loops[vertex]) == target)
+		{
+			loopBacks[target] = loopBacks[vertex];
+		}
+		else
+		{
+			loops[target] = loops[vertex];
+		}
+	};
+
+	const float targetErrorSquared = targetError * targetError;
+	float resultError = 0.0f;
+
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t> adjacentTriangles;
+	std::vector<bool> positionLocked(vertexCount);
+
+	while (outIndices.size() > targetIndexCount)
+	{
+		const size_t triangleCount = outIndices.size() / 3;
+
+		// Triangles adjacent to each position
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (const auto index : outIndices)
+		{
+			++adjacencyOffsets[positionRemap[index] + 1];
+		}
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+		}
+
+		adjacentTriangles.resize(outIndices.size());
+		{
+			std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < outIndices.size(); ++i)
+			{
+				adjacentTriangles[fillOffsets[positionRemap[outIndices[i]]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		// Pick the cheapest direction of every edge
+		collapses.clear();
+		for (size_t i = 0; i < outIndices.size(); i += 3)
+		{
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				auto a = outIndices[i + corner];
+				auto b = outIndices[i + (corner + 1) % 3];
+
+				Quadric quadric = quadrics[positionRemap[a]];
+				AddQuadric(quadric, quadrics[positionRemap[b]]);
+
+				float errorAB = CanCollapse(a, b) ? EvaluateQuadric(quadric, positions[b]) : INVALID_COLLAPSE_ERROR;
+				float errorBA = CanCollapse(b, a) ? EvaluateQuadric(quadric, positions[a]) : INVALID_COLLAPSE_ERROR;
+
+				if (errorAB == INVALID_COLLAPSE_ERROR && errorBA == INVALID_COLLAPSE_ERROR)
+				{
+					continue;
+				}
+
+				collapses.push_back(errorAB <= errorBA ? Collapse{ a, b, errorAB } : Collapse{ b, a, errorBA });
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs)
+			{
+				return lhs.Error < rhs.Error;
+			});
+
+		// Apply the cheapest collapses that do not touch each other's neighbourhoods
+		std::fill(positionLocked.begin(), positionLocked.end(), false);
+		const size_t triangleRemovalGoal = (outIndices.size() - targetIndexCount) / 3;
+		size_t trianglesRemoved = 0;
+		size_t collapseCount = 0;
+
+		for (const auto& collapse : collapses)
+		{
+			if (collapse.Error > targetErrorSquared || trianglesRemoved >= triangleRemovalGoal)
+			{
+				break;
+			}
+
+			auto vertexPosition = positionRemap[collapse.Vertex];
+			auto targetPosition = positionRemap[collapse.Target];
+			if (positionLocked[vertexPosition] || positionLocked[targetPosition])
+			{
+				continue;
+			}
+
+			// Reject collapses that flip any remaining triangle
+			size_t removed = 0;
+			bool flips = false;
+			for (uint32_t j = adjacencyOffsets[vertexPosition]; j < adjacencyOffsets[vertexPosition + 1] && !flips; ++j)
+			{
+				auto triangle = adjacentTriangles[j] * 3;
+				uint32_t corners[3] = { positionRemap[outIndices[triangle]], positionRemap[outIndices[triangle + 1]], positionRemap[outIndices[triangle + 2]] };
+				if (corners[0] == targetPosition || corners[1] == targetPosition || corners[2] == targetPosition)
+				{
+					++removed;
+					continue;
+				}
+
+				glm::vec3 before[3] = { positions[corners[0]], positions[corners[1]], positions[corners[2]] };
+				glm::vec3 after[3] = { before[0], before[1], before[2] };
+				for (size_t k = 0; k < 3; ++k)
+				{
+					if (corners[k] == vertexPosition)
+					{
+						after[k] = positions[targetPosition];
+					}
+				}
+
+				auto normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				auto normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				flips = glm::dot(normalBefore, normalAfter) <= 0.0f;
+			}
+
+			if (flips)
+			{
+				continue;
+			}
+
+			if (kinds[collapse.Vertex] == VERTEX_KIND_SEAM)
+			{
+				auto sibling = wedges[collapse.Vertex];
+				auto siblingTarget = wedges[collapse.Target];
+				MergeLoops(sibling, siblingTarget);
+				collapseRemap[sibling] = siblingTarget;
+			}
+
+			if (kinds[collapse.Vertex] != VERTEX_KIND_MANIFOLD)
+			{
+				MergeLoops(collapse.Vertex, collapse.Target);
+			}
+
+			collapseRemap[collapse.Vertex] = collapse.Target;
+			AddQuadric(quadrics[targetPosition], quadrics[vertexPosition]);
+
+			// Lock the one ring so the flip test of later collapses in this pass stays valid
+			for (uint32_t j = adjacencyOffsets[vertexPosition]; j < adjacencyOffsets[vertexPosition + 1]; ++j)
+			{
+				auto triangle = adjacentTriangles[j] * 3;
+				positionLocked[positionRemap[outIndices[triangle]]] = true;
+				positionLocked[positionRemap[outIndices[triangle + 1]]] = true;
+				positionLocked[positionRemap[outIndices[triangle + 2]]] = true;
+			}
+
+			resultError = std::max(resultError, collapse.Error);
+			trianglesRemoved += removed;
+			++collapseCount;
+		}
+
+		if (collapseCount == 0)
+		{
+			break;
+		}
+
+		// Rewrite indices through the collapses and remove triangles that became degenerate
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < triangleCount * 3; i += 3)
+		{
+			auto a = Resolve(outIndices[i]);
+			auto b = Resolve(outIndices[i + 1]);
+			auto c = Resolve(outIndices[i + 2]);
+
+			if (positionRemap[a] == positionRemap[b] || positionRemap[b] == positionRemap[c] || positionRemap[a] == positionRemap[c])
+			{
+				continue;
+			}
+
+			outIndices[writeIndex++] = a;
+			outIndices[writeIndex++] = b;
+			outIndices[writeIndex++] = c;
+		}
+		outIndices.resize(writeIndex);
+	}
+
+	return std::sqrt(resultError);
+}
+
+void Renderer::MeshSimplifier::BuildLODChain(const std::vector<Vertex1Pos1UV1Norm>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLOD>& outLODs,
+	const size_t maxLODCount)
+{
+	outLODs.clear();
+
+	MeshLOD baseLOD = {};
+	baseLOD.IndexCount = static_cast<uint32_t>(indices.size());
+	outLODs.push_back(baseLOD);
+
+	std::vector<uint32_t> chainIndices = indices;
+	std::vector<uint32_t> previousIndices = indices;
+	float error = 0.0f;
+
+	while (outLODs.size() < maxLODCount)
+	{
+		// Each level is simplified from the previous one, which is much faster than starting from the full mesh every time
+		auto targetIndexCount = static_cast<size_t>(previousIndices.size() / 3 * LOD_TRIANGLE_RATIO) * 3;
+
+		std::vector<uint32_t> lodIndices;
+		auto lodError = Simplify(vertices, previousIndices, targetIndexCount, LOD_MAX_ERROR, lodIndices);
+
+		if (lodIndices.empty() || lodIndices.size() > previousIndices.size() * (1.0f - LOD_MIN_REDUCTION))
+		{
+			break;
+		}
+
+		MeshOptimizer::OptimizeVertexCache(lodIndices, vertices.size());
+
+		// Errors of levels built on top of each other accumulate
+		error += lodError;
+
+		MeshLOD lod = {};
+		lod.IndexOffset = static_cast<uint32_t>(chainIndices.size());
+		lod.IndexCount = static_cast<uint32_t>(lodIndices.size());
+		lod.Error = error;
+		lod.MaxScreenSize = error > 0.0f ? LOD_PIXEL_ERROR_TOLERANCE / error : std::numeric_limits<float>::max();
+		outLODs.push_back(lod);
+
+		chainIndices.insert(chainIndices.end(), lodIndices.begin(), lodIndices.end());
+		previousIndices = std::move(lodIndices);
+	}
+
+	indices = std::move(chainIndices);
+}
+
+uint32_t Renderer::MeshSimplifier::SelectLOD(const std::vector<MeshLOD>& lods, const float screenSizePixels)
+{
+	for (size_t i = lods.size(); i > 1; --i)
+	{
+		if (screenSizePixels <= lods[i - 1].MaxScreenSize)
+		{
+			return static_cast<uint32_t>(i - 1);
+		}
+	}
+
+	return 0;
+}
\ No newline at end of file
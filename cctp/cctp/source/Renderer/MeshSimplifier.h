@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Renderer/Vertices/Vertex1Pos1UV1Norm.h"
+#include "Renderer/MeshLOD.h"
+
+namespace Renderer
+{
+	namespace MeshSimplifier
+	{
+		constexpr size_t MAX_LOD_COUNT = 5;
+		// Each level of detail targets this fraction of the previous level's triangles
+		constexpr float LOD_TRIANGLE_RATIO = 0.5f;
+		// Levels that fail to remove at least this fraction of the previous level's triangles end the chain
+		constexpr float LOD_MIN_REDUCTION = 0.1f;
+		// Maximum simplification error of a level, relative to the mesh bounds extent
+		constexpr float LOD_MAX_ERROR = 0.1f;
+		// Projected simplification error in pixels accepted when selecting a level of detail
+		constexpr float LOD_PIXEL_ERROR_TOLERANCE = 1.0f;
+
+		// Quadric error metric edge collapse simplification. Vertices collapse onto existing vertices so the output indexes the input
+		// vertex buffer. Vertices sharing a position with different attributes form seams that only collapse along the seam, open borders
+		// only collapse along the border. Returns the resulting error relative to the mesh bounds extent
+		float Simplify(const std::vector<Vertex1Pos1UV1Norm>& vertices, const std::vector<uint32_t>& indices, const size_t targetIndexCount,
+			const float targetError, std::vector<uint32_t>& outIndices);
+
+		// Replaces indices with a chain of levels of detail concatenated into one index buffer. The first level is the input
+		void BuildLODChain(const std::vector<Vertex1Pos1UV1Norm>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLOD>& outLODs,
+			const size_t maxLODCount = MAX_LOD_COUNT);
+
+		// Returns the coarsest level whose projected error is within tolerance at the given projected size in pixels
+		uint32_t SelectLOD(const std::vector<MeshLOD>& lods, const float screenSizePixels);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "Pch.h"
+#include "Meshlets.h"
+
+namespace
+{
+	constexpr uint32_t INVALID_LOCAL_INDEX = ~0u;
+
+	// Ritter's bounding sphere, within a few percent of the minimal sphere
+	void CalculateBoundingSphere(const std::vector<Renderer::Vertex1Pos1UV1Norm>& vertices, const uint32_t* pVertexIndices, const uint32_t vertexCount,
+		glm::vec3& outCenter, float& outRadius)
+	{
+		auto FindFarthest = [&](const glm::vec3& from)
+		{
+			uint32_t farthest = pVertexIndices[0];
+			float farthestDistance = -1.0f;
+			for (uint32_t i = 0; i < vertexCount; ++i)
+			{
+				auto distance = glm::dot(vertices[pVertexIndices[i]].Position - from, vertices[pVertexIndices[i]].Position - from);
+				if (distance > farthestDistance)
+				{
+					farthestDistance = distance;
+					farthest = pVertexIndices[i];
+				}
+			}
+			return vertices[farthest].Position;
+		};
+
+		auto a = FindFarthest(vertices[pVertexIndices[0]].Position);
+		auto b = FindFarthest(a);
+
+		glm::vec3 center = (a + b) * 0.5f;
+		float radius = glm::length(b - a) * 0.5f;
+
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			const auto& position = vertices[pVertexIndices[i]].Position;
+			auto distance = glm::length(position - center);
+			if (distance > radius)
+			{
+				// Grow the sphere just enough to include the point
+				float newRadius = (radius + distance) * 0.5f;
+				center += (position - center) * ((newRadius - radius) / distance);
+				radius = newRadius;
+			}
+		}
+
+		outCenter = center;
+		outRadius = radius;
+	}
+
+	void CalculateNormalCone(const std::vector<Renderer::Vertex1Pos1UV1Norm>& vertices, const uint32_t* pIndices, const uint32_t triangleCount,
+		glm::vec3& outAxis, float& outCutoff)
+	{
+		glm::vec3 axis = glm::vec3(0.0f);
+		for (uint32_t i = 0; i < triangleCount * 3; i += 3)
+		{
+			// Front faces are clockwise, the cross product of the edges points out of the front face
+			const auto& p0 = vertices[pIndices[i]].Position;
+			auto normal = glm::cross(vertices[pIndices[i + 1]].Position - p0, vertices[pIndices[i + 2]].Position - p0);
+			auto length = glm::length(normal);
+			if (length > 0.0f)
+			{
+				axis += normal / length;
+			}
+		}
+
+		outAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+		outCutoff = 1.0f;
+
+		auto axisLength = glm::length(axis);
+		if (axisLength <= 0.0f)
+		{
+			return;
+		}
+		axis /= axisLength;
+
+		float minDot = 1.0f;
+		for (uint32_t i = 0; i < triangleCount * 3; i += 3)
+		{
+			const auto& p0 = vertices[pIndices[i]].Position;
+			auto normal = glm::cross(vertices[pIndices[i + 1]].Position - p0, vertices[pIndices[i + 2]].Position - p0);
+			auto length = glm::length(normal);
+			if (length > 0.0f)
+			{
+				minDot = std::min(minDot, glm::dot(axis, normal / length));
+			}
+		}
+
+		// Cones wider than a hemisphere can never be culled
+		if (minDot <= 0.0f)
+		{
+			return;
+		}
+
+		outAxis = axis;
+		outCutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+}
+
+void Renderer::Meshlets::BuildMeshlets(const std::vector<Vertex1Pos1UV1Norm>& vertices, const std::vector<uint32_t>& indices, const uint32_t indexOffset,
+	const uint32_t indexCount, MeshletData& outMeshletData, const uint32_t maxVertices, const uint32_t maxTriangles)
+{
+	assert(indexCount % 3 == 0 && "Index count must be a multiple of 3.");
+	assert(indexOffset + indexCount <= indices.size() && "Index range is outside of the index buffer.");
+	assert(maxVertices <= 256 && maxTriangles <= 256 && "Meshlet local indices are 8 bit.");
+
+	outMeshletData = {};
+
+	// Local index of each vertex in the meshlet being built
+	std::vector<uint32_t> localIndices(vertices.size(), INVALID_LOCAL_INDEX);
+	Meshlet meshlet = {};
+	meshlet.IndexOffset = indexOffset;
+
+	auto FinishMeshlet = [&]()
+	{
+		CalculateBoundingSphere(vertices, outMeshletData.Vertices.data() + meshlet.VertexOffset, meshlet.VertexCount,
+			meshlet.BoundingSphereCenter, meshlet.BoundingSphereRadius);
+		CalculateNormalCone(vertices, indices.data() + meshlet.IndexOffset, meshlet.TriangleCount, meshlet.ConeAxis, meshlet.ConeCutoff);
+
+		for (uint32_t i = 0; i < meshlet.VertexCount; ++i)
+		{
+			localIndices[outMeshletData.Vertices[meshlet.VertexOffset + i]] = INVALID_LOCAL_INDEX;
+		}
+
+		outMeshletData.Meshlets.push_back(meshlet);
+
+		Meshlet nextMeshlet = {};
+		nextMeshlet.IndexOffset = meshlet.IndexOffset + meshlet.TriangleCount * 3;
+		nextMeshlet.VertexOffset = static_cast<uint32_t>(outMeshletData.Vertices.size());
+		nextMeshlet.PrimitiveOffset = static_cast<uint32_t>(outMeshletData.Primitives.size());
+		meshlet = nextMeshlet;
+	};
+
+	for (uint32_t i = indexOffset; i < indexOffset + indexCount; i += 3)
+	{
+		uint32_t newVertexCount = 0;
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			newVertexCount += localIndices[indices[i + corner]] == INVALID_LOCAL_INDEX ? 1 : 0;
+		}
+
+		if (meshlet.VertexCount + newVertexCount > maxVertices || meshlet.TriangleCount + 1 > maxTriangles)
+		{
+			FinishMeshlet();
+		}
+
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			auto& localIndex = localIndices[indices[i + corner]];
+			if (localIndex == INVALID_LOCAL_INDEX)
+			{
+				localIndex = meshlet.VertexCount++;
+				outMeshletData.Vertices.push_back(indices[i + corner]);
+			}
+			outMeshletData.Primitives.push_back(static_cast<uint8_t>(localIndex));
+		}
+		++meshlet.TriangleCount;
+	}
+
+	if (meshlet.TriangleCount > 0)
+	{
+		FinishMeshlet();
+	}
+}
+
+void Renderer::Meshlets::CullMeshlets(const MeshletData& meshletData, const Math::Frustum& frustumLS, const glm::vec3& cameraPositionLS,
+	std::vector<IndexRange>& outVisibleRanges, MeshletCullStatistics& statistics)
+{
+	outVisibleRanges.clear();
+
+	for (const auto& meshlet : meshletData.Meshlets)
+	{
+		++statistics.MeshletCount;
+		statistics.TriangleCount += meshlet.TriangleCount;
+
+		if (!Math::IsSphereInFrustum(frustumLS, meshlet.BoundingSphereCenter, meshlet.BoundingSphereRadius))
+		{
+			++statistics.FrustumCulledCount;
+			continue;
+		}
+
+		// Every triangle faces away from the camera when it is outside the normal cone widened by the bounding sphere
+		auto toCenter = meshlet.BoundingSphereCenter - cameraPositionLS;
+		if (glm::dot(toCenter, meshlet.ConeAxis) >= meshlet.ConeCutoff * glm::length(toCenter) + meshlet.BoundingSphereRadius)
+		{
+			++statistics.BackfaceCulledCount;
+			continue;
+		}
+
+		statistics.VisibleTriangleCount += meshlet.TriangleCount;
+
+		// Merge with the previous range when the meshlets are adjacent in the index buffer
+		if (!outVisibleRanges.empty() && outVisibleRanges.back().IndexOffset + outVisibleRanges.back().IndexCount == meshlet.IndexOffset)
+		{
+			outVisibleRanges.back().IndexCount += meshlet.TriangleCount * 3;
+		}
+		else
+		{
+			outVisibleRanges.push_back({ meshlet.IndexOffset, meshlet.TriangleCount * 3 });
+		}
+	}
+}
\ No newline at end of file
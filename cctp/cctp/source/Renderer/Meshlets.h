@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Renderer/Vertices/Vertex1Pos1UV1Norm.h"
+#include "Math/Math.h"
+
+namespace Renderer
+{
+	constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+	constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+	struct Meshlet
+	{
+		// Meshlets are built from consecutive triangles so each one covers a contiguous range of the source index buffer
+		uint32_t IndexOffset = 0;
+		uint32_t TriangleCount = 0;
+
+		// Unique vertices and local triangle indices of the meshlet, stored in MeshletData
+		uint32_t VertexOffset = 0;
+		uint32_t VertexCount = 0;
+		uint32_t PrimitiveOffset = 0;
+
+		glm::vec3 BoundingSphereCenter = glm::vec3(0.0f);
+		float BoundingSphereRadius = 0.0f;
+
+		// Average front face normal and sine of the cone half angle. Cutoff is 1 when the triangles face too many directions to cull
+		glm::vec3 ConeAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+		float ConeCutoff = 1.0f;
+	};
+
+	struct MeshletData
+	{
+		std::vector<Meshlet> Meshlets;
+		std::vector<uint32_t> Vertices;
+		// Three local vertex indices per triangle
+		std::vector<uint8_t> Primitives;
+	};
+
+	struct IndexRange
+	{
+		uint32_t IndexOffset = 0;
+		uint32_t IndexCount = 0;
+	};
+
+	struct MeshletCullStatistics
+	{
+		uint32_t MeshletCount = 0;
+		uint32_t FrustumCulledCount = 0;
+		uint32_t BackfaceCulledCount = 0;
+		uint32_t TriangleCount = 0;
+		uint32_t VisibleTriangleCount = 0;
+	};
+
+	namespace Meshlets
+	{
+		// Splits the index range into meshlets of at most maxVertices unique vertices and maxTriangles triangles. Works best on vertex cache optimized indices
+		void BuildMeshlets(const std::vector<Vertex1Pos1UV1Norm>& vertices, const std::vector<uint32_t>& indices, const uint32_t indexOffset,
+			const uint32_t indexCount, MeshletData& outMeshletData, const uint32_t maxVertices = MAX_MESHLET_VERTICES,
+			const uint32_t maxTriangles = MAX_MESHLET_TRIANGLES);
+
+		// Culls meshlets outside the frustum or facing away from the camera. Frustum and camera position must be in mesh local space.
+		// Visible meshlets are merged into as few index ranges as possible. Statistics are accumulated
+		void CullMeshlets(const MeshletData& meshletData, const Math::Frustum& frustumLS, const glm::vec3& cameraPositionLS,
+			std::vector<IndexRange>& outVisibleRanges, MeshletCullStatistics& statistics);
+	}
+}
\ No newline at end of file
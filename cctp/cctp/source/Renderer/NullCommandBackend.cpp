@@ -0,0 +1,199 @@
+#include "Pch.h"
+#include "NullCommandBackend.h"
+
+bool Renderer::NullCommandBackend::Submit(const CommandStream& stream)
+{
+	State = {};
+	SubmitValid = true;
+	++BackendStatistics.SubmitCount;
+	BackendStatistics.CommandBytes += stream.GetByteSize();
+
+	uint32_t commandIndex = 0;
+	stream.ForEach([&](const CommandHeader& header)
+		{
+			const auto type = header.Type;
+			Validate(type < CommandType::Count, type, commandIndex, "Unknown command type");
+			if (type >= CommandType::Count)
+			{
+				++commandIndex;
+				return;
+			}
+			++BackendStatistics.CommandCounts[static_cast<uint32_t>(type)];
+
+			switch (type)
+			{
+			case CommandType::SetRenderTargets:
+			{
+				const auto& command = reinterpret_cast<const SetRenderTargetsCommand&>(header);
+				State.RenderTarget = command.RenderTargetView != 0;
+				State.DepthStencil = command.DepthStencilView != 0;
+				break;
+			}
+			case CommandType::ClearRenderTarget:
+				Validate(reinterpret_cast<const ClearRenderTargetCommand&>(header).RenderTargetView != 0, type, commandIndex, "Clearing a null view");
+				break;
+			case CommandType::ClearDepthStencil:
+				Validate(reinterpret_cast<const ClearDepthStencilCommand&>(header).DepthStencilView != 0, type, commandIndex, "Clearing a null view");
+				break;
+			case CommandType::ResourceBarriers:
+				ApplyBarriers(reinterpret_cast<const ResourceBarriersCommand&>(header), commandIndex);
+				break;
+			case CommandType::CopyResource:
+			{
+				const auto& command = reinterpret_cast<const CopyResourceCommand&>(header);
+				Validate(command.pDst && command.pSrc && command.pDst != command.pSrc, type, commandIndex, "Copy needs two distinct resources");
+				ValidateAccess(command.pDst, RenderGraph::AccessCopyDest, type, commandIndex);
+				ValidateAccess(command.pSrc, RenderGraph::AccessCopySource, type, commandIndex);
+				break;
+			}
+			case CommandType::SetPrimitiveTopology:
+				State.Topology = true;
+				break;
+			case CommandType::SetViewport:
+			{
+				const auto& command = reinterpret_cast<const SetViewportCommand&>(header);
+				Validate(command.Width > 0.0f && command.Height > 0.0f && command.ScissorRight > command.ScissorLeft &&
+					command.ScissorBottom > command.ScissorTop, type, commandIndex, "Empty viewport or scissor rectangle");
+				State.Viewport = true;
+				break;
+			}
+			case CommandType::SetGraphicsPipeline:
+			{
+				const auto& command = reinterpret_cast<const SetGraphicsPipelineCommand&>(header);
+				Validate(command.pPipelineState && command.pRootSignature, type, commandIndex, "Null pipeline state or root signature");
+				State.GraphicsPipeline = true;
+				State.RaytracingPipeline = false;
+				State.RootSignature = true;
+				break;
+			}
+			case CommandType::SetDescriptorHeap:
+				Validate(reinterpret_cast<const SetDescriptorHeapCommand&>(header).pHeap != nullptr, type, commandIndex, "Null descriptor heap");
+				State.DescriptorHeap = true;
+				break;
+			case CommandType::SetVertexBuffer:
+			{
+				const auto& command = reinterpret_cast<const SetVertexBufferCommand&>(header);
+				Validate(command.Address != 0 && command.Stride != 0, type, commandIndex, "Null vertex buffer");
+				State.VertexBuffer = true;
+				break;
+			}
+			case CommandType::SetIndexBuffer:
+				Validate(reinterpret_cast<const SetIndexBufferCommand&>(header).Address != 0, type, commandIndex, "Null index buffer");
+				State.IndexBuffer = true;
+				break;
+			case CommandType::SetGraphicsRootDescriptorTable:
+				Validate(State.DescriptorHeap, type, commandIndex, "Descriptor table set before a descriptor heap");
+				[[fallthrough]];
+			case CommandType::SetGraphicsRootConstantBufferView:
+			case CommandType::SetGraphicsRootShaderResourceView:
+				Validate(State.RootSignature, type, commandIndex, "Root parameter set before a root signature");
+				Validate(reinterpret_cast<const SetGraphicsRootParameterCommand&>(header).Value != 0, type, commandIndex, "Null root parameter");
+				break;
+			case CommandType::DrawIndexedInstanced:
+			{
+				const auto& command = reinterpret_cast<const DrawIndexedInstancedCommand&>(header);
+				Validate(State.GraphicsPipeline, type, commandIndex, "Draw without a graphics pipeline");
+				Validate(State.Topology && State.Viewport, type, commandIndex, "Draw without a topology or viewport");
+				Validate(State.VertexBuffer && State.IndexBuffer, type, commandIndex, "Draw without vertex and index buffers");
+				Validate(State.RenderTarget || State.DepthStencil, type, commandIndex, "Draw without a render or depth target");
+				Validate(command.IndexCount != 0 && command.InstanceCount != 0, type, commandIndex, "Empty draw");
+				BackendStatistics.IndexCount += static_cast<uint64_t>(command.IndexCount) * command.InstanceCount;
+				BackendStatistics.InstanceCount += command.InstanceCount;
+				break;
+			}
+			case CommandType::BuildAccelerationStructure:
+			{
+				const auto& command = reinterpret_cast<const BuildAccelerationStructureCommand&>(header);
+				Validate(command.DestAddress != 0 && command.ScratchAddress != 0 && command.InstanceDescsAddress != 0, type, commandIndex,
+					"Acceleration structure build with null buffers");
+				break;
+			}
+			case CommandType::SetRaytracingPipeline:
+				Validate(reinterpret_cast<const SetRaytracingPipelineCommand&>(header).pStateObject != nullptr, type, commandIndex, "Null state object");
+				State.RaytracingPipeline = true;
+				State.GraphicsPipeline = false;
+				break;
+			case CommandType::DispatchRays:
+			{
+				const auto& command = reinterpret_cast<const DispatchRaysCommand&>(header);
+				Validate(State.RaytracingPipeline, type, commandIndex, "Dispatch without a raytracing pipeline");
+				Validate(State.DescriptorHeap, type, commandIndex, "Dispatch without a descriptor heap");
+				Validate(command.RayGeneration.StartAddress != 0 && command.Width != 0 && command.Height != 0 && command.Depth != 0, type,
+					commandIndex, "Empty dispatch");
+				break;
+			}
+			case CommandType::Native:
+				// Native commands may bind anything
+				Validate(reinterpret_cast<const NativeCommand&>(header).pExecute != nullptr, type, commandIndex, "Null native function");
+				State = {};
+				break;
+			default:
+				break;
+			}
+
+			++commandIndex;
+		});
+
+	return SubmitValid;
+}
+
+void Renderer::NullCommandBackend::ResetTracking()
+{
+	TrackedAccesses.clear();
+}
+
+void Renderer::NullCommandBackend::ResetStatistics()
+{
+	BackendStatistics = {};
+}
+
+void Renderer::NullCommandBackend::Validate(const bool condition, const CommandType type, const uint32_t commandIndex, const char* message)
+{
+	if (condition)
+	{
+		return;
+	}
+
+	if (BackendStatistics.ErrorCount < MaxLoggedErrors)
+	{
+		DEBUG_LOG("Command " << commandIndex << " (" << GetCommandTypeName(type) << "): " << message);
+	}
+	++BackendStatistics.ErrorCount;
+	SubmitValid = false;
+}
+
+void Renderer::NullCommandBackend::ValidateAccess(void* pResource, const uint32_t access, const CommandType type, const uint32_t commandIndex)
+{
+	const auto tracked = TrackedAccesses.find(pResource);
+	Validate(tracked == TrackedAccesses.end() || (tracked->second & access) == access, type, commandIndex, "Resource is not in the access it is used in");
+}
+
+void Renderer::NullCommandBackend::ApplyBarriers(const ResourceBarriersCommand& command, const uint32_t commandIndex)
+{
+	constexpr auto type = CommandType::ResourceBarriers;
+	const auto* pBarriers = command.GetBarriers();
+	for (uint32_t i = 0; i < command.BarrierCount; ++i)
+	{
+		const auto& barrier = pBarriers[i];
+		Validate(barrier.pResource != nullptr, type, commandIndex, "Barrier on a null resource");
+
+		switch (barrier.BarrierType)
+		{
+		case RenderGraph::Barrier::Type::Transition:
+		{
+			Validate(barrier.AccessBefore != barrier.AccessAfter, type, commandIndex, "Transition to the same access");
+			auto tracked = TrackedAccesses.try_emplace(barrier.pResource, barrier.AccessBefore).first;
+			Validate(tracked->second == barrier.AccessBefore, type, commandIndex, "Transition from an access the resource is not in");
+			tracked->second = barrier.AccessAfter;
+			break;
+		}
+		case RenderGraph::Barrier::Type::UnorderedAccess:
+			ValidateAccess(barrier.pResource, RenderGraph::AccessUnorderedAccess, type, commandIndex);
+			break;
+		case RenderGraph::Barrier::Type::Aliasing:
+			Validate(barrier.pResourceBefore != barrier.pResource, type, commandIndex, "Resource aliased with itself");
+			break;
+		}
+	}
+	BackendStatistics.BarrierCount += command.BarrierCount;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "CommandStream.h"
+
+#include <unordered_map>
+
+namespace Renderer
+{
+	// Backend that executes nothing. Submitted streams are counted and checked against the rules the GPU backend relies on: draws need a
+	// pipeline, topology, viewport, buffers and a target, descriptor tables need a heap and transitions must start from the access the
+	// resource was last left in. Accesses are tracked across submits from the first barrier naming each resource, like resource states
+	class NullCommandBackend
+	{
+	public:
+		struct Statistics
+		{
+			std::array<uint32_t, COMMAND_TYPE_COUNT> CommandCounts = {};
+			uint32_t SubmitCount = 0;
+			uint64_t CommandBytes = 0;
+			uint64_t IndexCount = 0;
+			uint64_t InstanceCount = 0;
+			uint32_t BarrierCount = 0;
+			uint32_t ErrorCount = 0;
+		};
+
+		// Returns false if the stream breaks any rule. Bound state starts empty each submit, as it does for a reset command list
+		bool Submit(const CommandStream& stream);
+
+		// Forgets tracked resource accesses, for example after the resources are recreated
+		void ResetTracking();
+		void ResetStatistics();
+		const Statistics& GetStatistics() const { return BackendStatistics; }
+
+	private:
+		struct BoundState
+		{
+			bool GraphicsPipeline = false;
+			bool RaytracingPipeline = false;
+			bool RootSignature = false;
+			bool DescriptorHeap = false;
+			bool Topology = false;
+			bool Viewport = false;
+			bool VertexBuffer = false;
+			bool IndexBuffer = false;
+			bool RenderTarget = false;
+			bool DepthStencil = false;
+		};
+
+		void Validate(const bool condition, const CommandType type, const uint32_t commandIndex, const char* message);
+		void ValidateAccess(void* pResource, const uint32_t access, const CommandType type, const uint32_t commandIndex);
+		void ApplyBarriers(const ResourceBarriersCommand& command, const uint32_t commandIndex);
+
+	private:
+		static constexpr uint32_t MaxLoggedErrors = 8;
+
+		BoundState State;
+		// Last access each resource was transitioned to
+		std::unordered_map<void*, uint32_t> TrackedAccesses;
+		Statistics BackendStatistics;
+		bool SubmitValid = true;
+	};
+}
\ No newline at end of file
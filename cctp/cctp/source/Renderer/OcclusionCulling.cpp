@@ -0,0 +1,331 @@
+#include "Pch.h"
+#include "OcclusionCulling.h"
+#include "Tasks/TaskSystem.h"
+#include <emmintrin.h>
+
+namespace
+{
+	constexpr size_t SIMD_WIDTH = 4;
+	constexpr float FAR_DEPTH = 1.0f;
+	// Near plane clipping produces at most four vertices from a triangle
+	constexpr size_t MAX_CLIPPED_VERTEX_COUNT = 4;
+
+	glm::vec3 ReadPosition(const void* pVertices, const size_t vertexStride, const uint32_t index)
+	{
+		glm::vec3 position;
+		memcpy(&position, static_cast<const uint8_t*>(pVertices) + vertexStride * index, sizeof(glm::vec3));
+		return position;
+	}
+
+	bool IsFullyCovered(const __m128i mask)
+	{
+		return _mm_movemask_epi8(_mm_cmpeq_epi32(mask, _mm_set1_epi32(-1))) == 0xFFFF;
+	}
+
+	// Bits of the pixels in [begin, end) of a row of tile pixels starting at tileX
+	uint32_t RowCoverage(const int32_t begin, const int32_t end, const int32_t tileX)
+	{
+		auto first = std::max(begin, tileX) - tileX;
+		auto last = std::min(end, tileX + static_cast<int32_t>(Renderer::OcclusionBuffer::TILE_WIDTH)) - tileX;
+		if (first >= last)
+		{
+			return 0;
+		}
+		auto bits = last - first == 32 ? UINT32_MAX : (1u << (last - first)) - 1;
+		return bits << first;
+	}
+}
+
+void Renderer::OcclusionBuffer::Resize(const uint32_t width, const uint32_t height)
+{
+	assert(width % TILE_WIDTH == 0 && height % TILE_HEIGHT == 0 && "Occlusion buffer size must be a multiple of the tile size.");
+	Width = width;
+	Height = height;
+	TileCountX = width / TILE_WIDTH;
+	TileCountY = height / TILE_HEIGHT;
+
+	auto tileCount = static_cast<size_t>(TileCountX) * TileCountY;
+	TileFarDepths.resize(tileCount + SIMD_WIDTH - 1);
+	TileLayerDepths.resize(tileCount);
+	TileLayerMasks.resize(tileCount * TILE_HEIGHT);
+	Clear();
+}
+
+void Renderer::OcclusionBuffer::Clear()
+{
+	std::fill(TileFarDepths.begin(), TileFarDepths.end(), FAR_DEPTH);
+	std::fill(TileLayerDepths.begin(), TileLayerDepths.end(), 0.0f);
+	std::fill(TileLayerMasks.begin(), TileLayerMasks.end(), 0u);
+	Triangles.clear();
+}
+
+void Renderer::OcclusionBuffer::AddOccluder(const void* pVertices, const size_t vertexStride, const uint32_t* pIndices, const size_t indexCount,
+	const glm::mat4& worldViewProjectionMatrix)
+{
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		glm::vec4 clip[3];
+		uint32_t insideCount = 0;
+		for (size_t j = 0; j < 3; ++j)
+		{
+			clip[j] = worldViewProjectionMatrix * glm::vec4(ReadPosition(pVertices, vertexStride, pIndices[i + j]), 1.0f);
+			insideCount += clip[j].z >= 0.0f;
+		}
+
+		if (insideCount == 3)
+		{
+			AddScreenTriangle(clip[0], clip[1], clip[2]);
+			continue;
+		}
+		if (insideCount == 0)
+		{
+			continue;
+		}
+
+		// Clip against the near plane, z >= 0 in clip space, keeping the winding
+		glm::vec4 clipped[MAX_CLIPPED_VERTEX_COUNT];
+		size_t clippedCount = 0;
+		for (size_t j = 0; j < 3; ++j)
+		{
+			const auto& current = clip[j];
+			const auto& next = clip[(j + 1) % 3];
+			if (current.z >= 0.0f)
+			{
+				clipped[clippedCount++] = current;
+			}
+			if ((current.z >= 0.0f) != (next.z >= 0.0f))
+			{
+				clipped[clippedCount++] = glm::mix(current, next, current.z / (current.z - next.z));
+			}
+		}
+		for (size_t j = 2; j < clippedCount; ++j)
+		{
+			AddScreenTriangle(clipped[0], clipped[j - 1], clipped[j]);
+		}
+	}
+}
+
+void Renderer::OcclusionBuffer::AddScreenTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2)
+{
+	ScreenTriangle triangle;
+	const glm::vec4* clip[3] = { &clip0, &clip1, &clip2 };
+	for (size_t i = 0; i < 3; ++i)
+	{
+		auto inverseW = 1.0f / clip[i]->w;
+		triangle.Vertices[i] = glm::vec3(
+			(clip[i]->x * inverseW * 0.5f + 0.5f) * Width,
+			(0.5f - clip[i]->y * inverseW * 0.5f) * Height,
+			clip[i]->z * inverseW);
+	}
+
+	// With y down, clockwise front faces have a positive signed area
+	const auto& v0 = triangle.Vertices[0];
+	const auto& v1 = triangle.Vertices[1];
+	const auto& v2 = triangle.Vertices[2];
+	auto area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (area <= 0.0f)
+	{
+		return;
+	}
+
+	auto minX = std::min({ v0.x, v1.x, v2.x });
+	auto maxX = std::max({ v0.x, v1.x, v2.x });
+	auto minY = std::min({ v0.y, v1.y, v2.y });
+	auto maxY = std::max({ v0.y, v1.y, v2.y });
+	if (maxX < 0.0f || minX > Width || maxY < 0.0f || minY > Height)
+	{
+		return;
+	}
+
+	Triangles.push_back(triangle);
+}
+
+void Renderer::OcclusionBuffer::Rasterize()
+{
+	// Tile rows never share tiles, so each row rasterizes every triangle overlapping it without synchronisation
+	TaskSystem::ParallelFor(TileCountY, 1, [this](size_t begin, size_t end)
+		{
+			for (auto tileRow = begin; tileRow < end; ++tileRow)
+			{
+				RasterizeTileRow(static_cast<uint32_t>(tileRow));
+			}
+		});
+}
+
+void Renderer::OcclusionBuffer::RasterizeTileRow(const uint32_t tileRow)
+{
+	const auto rowTop = static_cast<float>(tileRow * TILE_HEIGHT);
+	const auto rowBottom = rowTop + TILE_HEIGHT;
+	const auto width = static_cast<float>(Width);
+
+	// Pixel centres of the four pixel rows of the tile row
+	const auto rowY = _mm_add_ps(_mm_set1_ps(rowTop + 0.5f), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+
+	for (const auto& triangle : Triangles)
+	{
+		const auto& v0 = triangle.Vertices[0];
+		const auto& v1 = triangle.Vertices[1];
+		const auto& v2 = triangle.Vertices[2];
+		if (std::max({ v0.y, v1.y, v2.y }) < rowTop || std::min({ v0.y, v1.y, v2.y }) > rowBottom)
+		{
+			continue;
+		}
+
+		// Each edge bounds the covered span of a row from the left or the right. Inside is to the right of an edge walking clockwise
+		auto spanLeft = _mm_setzero_ps();
+		auto spanRight = _mm_set1_ps(width);
+		for (size_t i = 0; i < 3; ++i)
+		{
+			const auto& a = triangle.Vertices[i];
+			const auto& b = triangle.Vertices[(i + 1) % 3];
+			auto dx = b.x - a.x;
+			auto dy = b.y - a.y;
+			if (dy == 0.0f)
+			{
+				// Horizontal edges only accept rows on their inner side
+				auto outside = _mm_cmplt_ps(_mm_mul_ps(_mm_set1_ps(dx), _mm_sub_ps(rowY, _mm_set1_ps(a.y))), _mm_setzero_ps());
+				spanLeft = _mm_or_ps(_mm_and_ps(outside, _mm_set1_ps(width)), _mm_andnot_ps(outside, spanLeft));
+				continue;
+			}
+
+			auto edgeX = _mm_add_ps(_mm_set1_ps(a.x), _mm_mul_ps(_mm_sub_ps(rowY, _mm_set1_ps(a.y)), _mm_set1_ps(dx / dy)));
+			if (dy < 0.0f)
+			{
+				spanLeft = _mm_max_ps(spanLeft, edgeX);
+			}
+			else
+			{
+				spanRight = _mm_min_ps(spanRight, edgeX);
+			}
+		}
+
+		// A pixel is covered when its centre is inside the span, rounding the span ends gives the first pixel and one past the last
+		alignas(16) int32_t spanBegins[TILE_HEIGHT];
+		alignas(16) int32_t spanEnds[TILE_HEIGHT];
+		_mm_store_si128(reinterpret_cast<__m128i*>(spanBegins), _mm_cvtps_epi32(_mm_min_ps(spanLeft, _mm_set1_ps(width))));
+		_mm_store_si128(reinterpret_cast<__m128i*>(spanEnds), _mm_cvtps_epi32(_mm_max_ps(spanRight, _mm_setzero_ps())));
+
+		auto minBegin = std::min({ spanBegins[0], spanBegins[1], spanBegins[2], spanBegins[3] });
+		auto maxEnd = std::max({ spanEnds[0], spanEnds[1], spanEnds[2], spanEnds[3] });
+		if (minBegin >= maxEnd)
+		{
+			continue;
+		}
+
+		// Depth is linear in screen space, the furthest point of the triangle plane over a tile is at one of its corners
+		auto area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+		auto depthDX = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+		auto depthDY = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+		auto maxTriangleDepth = std::max({ v0.z, v1.z, v2.z });
+		auto tileDepthOffset = std::max(depthDX * TILE_WIDTH, 0.0f) + std::max(depthDY * TILE_HEIGHT, 0.0f);
+
+		auto firstTile = static_cast<uint32_t>(minBegin) / TILE_WIDTH;
+		auto lastTile = std::min(static_cast<uint32_t>(maxEnd - 1) / TILE_WIDTH, TileCountX - 1);
+		for (auto tileX = firstTile; tileX <= lastTile; ++tileX)
+		{
+			auto pixelX = static_cast<int32_t>(tileX * TILE_WIDTH);
+			auto coverage = _mm_setr_epi32(
+				static_cast<int32_t>(RowCoverage(spanBegins[0], spanEnds[0], pixelX)),
+				static_cast<int32_t>(RowCoverage(spanBegins[1], spanEnds[1], pixelX)),
+				static_cast<int32_t>(RowCoverage(spanBegins[2], spanEnds[2], pixelX)),
+				static_cast<int32_t>(RowCoverage(spanBegins[3], spanEnds[3], pixelX)));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(coverage, _mm_setzero_si128())) == 0xFFFF)
+			{
+				continue;
+			}
+
+			auto tileDepth = std::min(maxTriangleDepth,
+				v0.z + depthDX * (pixelX - v0.x) + depthDY * (rowTop - v0.y) + tileDepthOffset);
+
+			// Triangles behind the far depth of the tile cannot tighten it
+			auto tile = static_cast<size_t>(tileRow) * TileCountX + tileX;
+			auto& farDepth = TileFarDepths[tile];
+			if (tileDepth >= farDepth)
+			{
+				continue;
+			}
+
+			auto* pLayerMask = reinterpret_cast<__m128i*>(TileLayerMasks.data() + tile * TILE_HEIGHT);
+			auto layerMask = _mm_loadu_si128(pLayerMask);
+			auto& layerDepth = TileLayerDepths[tile];
+
+			// When the triangle is much closer than the working layer, merging would push its depth far back. Restart the layer from
+			// the triangle instead, the pixels the layer covered fall back to the far depth
+			if (layerDepth - tileDepth > farDepth - layerDepth)
+			{
+				layerMask = _mm_setzero_si128();
+				layerDepth = 0.0f;
+			}
+
+			layerMask = _mm_or_si128(layerMask, coverage);
+			layerDepth = std::max(layerDepth, tileDepth);
+
+			// A fully covered layer becomes the far depth of the tile
+			if (IsFullyCovered(layerMask))
+			{
+				farDepth = layerDepth;
+				layerMask = _mm_setzero_si128();
+				layerDepth = 0.0f;
+			}
+			_mm_storeu_si128(pLayerMask, layerMask);
+		}
+	}
+}
+
+bool Renderer::OcclusionBuffer::IsVisible(const Math::AABB& box, const glm::mat4& viewProjectionMatrix) const
+{
+	auto minX = std::numeric_limits<float>::max();
+	auto minY = std::numeric_limits<float>::max();
+	auto maxX = std::numeric_limits<float>::lowest();
+	auto maxY = std::numeric_limits<float>::lowest();
+	auto minDepth = std::numeric_limits<float>::max();
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		auto corner = box.Center + box.HalfExtent * glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+		auto clip = viewProjectionMatrix * glm::vec4(corner, 1.0f);
+
+		// Boxes crossing the near plane cover the view and are never culled
+		if (clip.z < 0.0f)
+		{
+			return true;
+		}
+
+		auto inverseW = 1.0f / clip.w;
+		minX = std::min(minX, clip.x * inverseW);
+		maxX = std::max(maxX, clip.x * inverseW);
+		minY = std::min(minY, clip.y * inverseW);
+		maxY = std::max(maxY, clip.y * inverseW);
+		minDepth = std::min(minDepth, clip.z * inverseW);
+	}
+
+	// Pixel rectangle of the box, rows flipped so y is down
+	auto left = (minX * 0.5f + 0.5f) * Width;
+	auto right = (maxX * 0.5f + 0.5f) * Width;
+	auto top = (0.5f - maxY * 0.5f) * Height;
+	auto bottom = (0.5f - minY * 0.5f) * Height;
+	if (right < 0.0f || left >= Width || bottom < 0.0f || top >= Height)
+	{
+		return false;
+	}
+
+	auto firstTileX = static_cast<uint32_t>(std::max(left, 0.0f)) / TILE_WIDTH;
+	auto lastTileX = static_cast<uint32_t>(std::min(right, Width - 1.0f)) / TILE_WIDTH;
+	auto firstTileY = static_cast<uint32_t>(std::max(top, 0.0f)) / TILE_HEIGHT;
+	auto lastTileY = static_cast<uint32_t>(std::min(bottom, Height - 1.0f)) / TILE_HEIGHT;
+
+	// The box is hidden in a tile when its nearest point is behind the far depth of the tile, four tiles are tested at once
+	const auto depth = _mm_set1_ps(minDepth);
+	for (auto tileY = firstTileY; tileY <= lastTileY; ++tileY)
+	{
+		const auto* pFarDepths = TileFarDepths.data() + static_cast<size_t>(tileY) * TileCountX;
+		for (auto tileX = firstTileX; tileX <= lastTileX; tileX += SIMD_WIDTH)
+		{
+			auto laneMask = (1 << std::min<uint32_t>(SIMD_WIDTH, lastTileX - tileX + 1)) - 1;
+			if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(pFarDepths + tileX), depth)) & laneMask)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Math/Math.h"
+
+namespace Renderer
+{
+	// Low resolution CPU depth buffer for occlusion culling. Each tile of 32x4 pixels keeps a conservative far depth for the whole tile and
+	// a working layer of pixels covered since that depth was last tightened, with a coverage bit per pixel. Once the working layer covers the
+	// whole tile it becomes the tile's far depth. Depths are post projection, larger is further away
+	class OcclusionBuffer
+	{
+	public:
+		static constexpr uint32_t TILE_WIDTH = 32;
+		static constexpr uint32_t TILE_HEIGHT = 4;
+
+		// Width must be a multiple of the tile width and height a multiple of the tile height
+		void Resize(const uint32_t width, const uint32_t height);
+		uint32_t GetWidth() const { return Width; }
+		uint32_t GetHeight() const { return Height; }
+
+		// Resets every tile to the far plane and removes queued occluders
+		void Clear();
+		// Projects occluder triangles into the buffer, clipping them against the near plane and discarding back faces. Front faces are clockwise.
+		// Positions are read as three floats at the start of each vertex
+		void AddOccluder(const void* pVertices, const size_t vertexStride, const uint32_t* pIndices, const size_t indexCount,
+			const glm::mat4& worldViewProjectionMatrix);
+		// Rasterizes queued occluders, splitting rows of tiles across the task system
+		void Rasterize();
+		size_t GetOccluderTriangleCount() const { return Triangles.size(); }
+
+		// False only when the box is behind the occluders at every pixel it covers
+		bool IsVisible(const Math::AABB& box, const glm::mat4& viewProjectionMatrix) const;
+
+	private:
+		// Screen space triangle, x and y in pixels with y down, z the post projection depth
+		struct ScreenTriangle
+		{
+			glm::vec3 Vertices[3];
+		};
+
+		void AddScreenTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2);
+		void RasterizeTileRow(const uint32_t tileRow);
+
+	private:
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t TileCountX = 0;
+		uint32_t TileCountY = 0;
+
+		std::vector<ScreenTriangle> Triangles;
+
+		// Tile data as separate arrays in row major tile order. Far depths are padded so four tiles can be loaded starting from any tile
+		std::vector<float> TileFarDepths;
+		std::vector<float> TileLayerDepths;
+		// One 32 bit coverage mask per pixel row of a tile
+		std::vector<uint32_t> TileLayerMasks;
+	};
+}
\ No newline at end of file
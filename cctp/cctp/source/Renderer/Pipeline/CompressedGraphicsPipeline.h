@@ -0,0 +1,13 @@
+#pragma once
+
+#include "GraphicsPipeline.h"
+
+namespace Renderer
+{
+	// Graphics pipeline for meshes using CompressedVertex1Pos1UV1Norm vertices. Shares the GraphicsPipeline root signature layout
+	class CompressedGraphicsPipeline : public GraphicsPipeline
+	{
+	public:
+		CompressedGraphicsPipeline() { UseCompressedVertices = true; }
+	};
+}
\ No newline at end of file
@@ -1,8 +1,9 @@
 #include "Pch.h"
 #include "GraphicsPipeline.h"
 #include "Binary/Binary.h"
+#include "Renderer/Vertices/CompressedVertex1Pos1UV1Norm.h"
 
-bool Renderer::GraphicsPipeline::Init(ID3D12Device* pDevice, DXGI_FORMAT renderTargetFormat)
+bool Renderer::GraphicsPipeline::Init(ID3D12Device* pDevice, PipelineCache& pipelineCache, DXGI_FORMAT renderTargetFormat)
 {
     // Create root signature
     CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
@@ -36,9 +37,10 @@ bool Renderer::GraphicsPipeline::Init(ID3D12Device* pDevice, DXGI_FORMAT renderT
     sampDescs[1].RegisterSpace = 1;
     sampDescs[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
 
-    D3D12_ROOT_DESCRIPTOR perObjectConstantBufferDescriptorDesc = {};
-    perObjectConstantBufferDescriptorDesc.ShaderRegister = 0;
-    perObjectConstantBufferDescriptorDesc.RegisterSpace = 0;
+    // Instance data is a structured buffer in space 1 so it doesn't collide with the pixel shader's t0
+    D3D12_ROOT_DESCRIPTOR instanceDataDescriptorDesc = {};
+    instanceDataDescriptorDesc.ShaderRegister = 0;
+    instanceDataDescriptorDesc.RegisterSpace = 1;
 
     D3D12_ROOT_DESCRIPTOR perFrameConstantBufferDescriptorDesc = {};
     perFrameConstantBufferDescriptorDesc.ShaderRegister = 1;
@@ -79,8 +81,8 @@ bool Renderer::GraphicsPipeline::Init(ID3D12Device* pDevice, DXGI_FORMAT renderT
     dTable.pDescriptorRanges = tableRanges;
 
     D3D12_ROOT_PARAMETER rootParameters[5];
-    rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
-    rootParameters[0].Descriptor = perObjectConstantBufferDescriptorDesc;
+    rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+    rootParameters[0].Descriptor = instanceDataDescriptorDesc;
     rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
 
     rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
@@ -121,7 +123,8 @@ bool Renderer::GraphicsPipeline::Init(ID3D12Device* pDevice, DXGI_FORMAT renderT
 
     // Load vertex and pixel shader bytecode
     BinaryBuffer vertexShaderBinary;
-    if (!Binary::ReadBinaryIntoBuffer("Shaders/Binary/VertexShader.cso", vertexShaderBinary))
+    auto vertexShaderPath = UseCompressedVertices ? "Shaders/Binary/CompressedVertexShader.cso" : "Shaders/Binary/VertexShader.cso";
+    if (!Binary::ReadBinaryIntoBuffer(vertexShaderPath, vertexShaderBinary))
     {
         return false;
     }
@@ -145,9 +148,15 @@ bool Renderer::GraphicsPipeline::Init(ID3D12Device* pDevice, DXGI_FORMAT renderT
         {"VERTEX_NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, sizeof(glm::vec3) + sizeof(glm::vec2), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
     };
 
+    D3D12_INPUT_ELEMENT_DESC compressedInputLayout[] = {
+        {"LOCAL_SPACE_POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, offsetof(CompressedVertex1Pos1UV1Norm, Position), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+        {"VERTEX_NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(CompressedVertex1Pos1UV1Norm, Normal), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+        {"UV", 0, DXGI_FORMAT_R16G16_FLOAT, 0, offsetof(CompressedVertex1Pos1UV1Norm, UV), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
+    };
+
     D3D12_INPUT_LAYOUT_DESC inputLayoutDesc = {};
-    inputLayoutDesc.NumElements = _countof(inputLayout);
-    inputLayoutDesc.pInputElementDescs = inputLayout;
+    inputLayoutDesc.NumElements = UseCompressedVertices ? _countof(compressedInputLayout) : _countof(inputLayout);
+    inputLayoutDesc.pInputElementDescs = UseCompressedVertices ? compressedInputLayout : inputLayout;
 
     // Create pipeline state object
     D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
@@ -166,7 +175,7 @@ bool Renderer::GraphicsPipeline::Init(ID3D12Device* pDevice, DXGI_FORMAT renderT
     psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
     psoDesc.NumRenderTargets = 1;
 
-    if (FAILED(pDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&PipelineStateObject))))
+    if (!pipelineCache.CreateGraphicsPipelineState(UseCompressedVertices ? L"CompressedScene" : L"Scene", psoDesc, PipelineStateObject))
     {
         return false;
     }
@@ -7,9 +7,10 @@ namespace Renderer
 	class GraphicsPipeline : public Renderer::GraphicsPipelineBase
 	{
 	public:
-		bool Init(ID3D12Device* pDevice, DXGI_FORMAT renderTargetFormat) final;
-
-	private:
+		bool Init(ID3D12Device* pDevice, PipelineCache& pipelineCache, DXGI_FORMAT renderTargetFormat) final;
 
+	protected:
+		// Selects the CompressedVertex1Pos1UV1Norm input layout and vertex shader
+		bool UseCompressedVertices = false;
 	};
 }
\ No newline at end of file
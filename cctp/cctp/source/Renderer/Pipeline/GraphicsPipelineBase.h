@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Renderer/PipelineCache.h"
+
 namespace Renderer
 {
 	class GraphicsPipelineBase
@@ -10,7 +12,8 @@ namespace Renderer
 		ID3D12PipelineState* GetPipelineState() const { return PipelineStateObject.Get(); }
 		ID3D12RootSignature* GetRootSignature() const { return RootSignature.Get(); }
 
-		virtual bool Init(ID3D12Device* pDevice, DXGI_FORMAT renderTargetFormat) = 0;
+		// Pipeline state objects are created through the pipeline cache
+		virtual bool Init(ID3D12Device* pDevice, PipelineCache& pipelineCache, DXGI_FORMAT renderTargetFormat) = 0;
 
 	protected:
 		Microsoft::WRL::ComPtr<ID3D12PipelineState> PipelineStateObject;
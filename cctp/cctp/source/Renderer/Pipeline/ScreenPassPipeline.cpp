@@ -2,7 +2,7 @@
 #include "ScreenPassPipeline.h"
 #include "Binary/Binary.h"
 
-bool Renderer::ScreenPassPipeline::Init(ID3D12Device* pDevice, DXGI_FORMAT renderTargetFormat)
+bool Renderer::ScreenPassPipeline::Init(ID3D12Device* pDevice, PipelineCache& pipelineCache, DXGI_FORMAT renderTargetFormat)
 {
     // Create root signature
     CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
@@ -115,11 +115,13 @@ bool Renderer::ScreenPassPipeline::Init(ID3D12Device* pDevice, DXGI_FORMAT rende
     psoDesc.SampleMask = 0xffffffff;
     psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
     psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+    // The screen quad covers every pixel, no depth target is bound
     psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
-    psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+    psoDesc.DepthStencilState.DepthEnable = FALSE;
+    psoDesc.DSVFormat = DXGI_FORMAT_UNKNOWN;
     psoDesc.NumRenderTargets = 1;
 
-    if (FAILED(pDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&PipelineStateObject))))
+    if (!pipelineCache.CreateGraphicsPipelineState(L"ScreenPass", psoDesc, PipelineStateObject))
     {
         return false;
     }
@@ -7,6 +7,6 @@ namespace Renderer
 	class ScreenPassPipeline : public GraphicsPipelineBase
 	{
 	public:
-		bool Init(ID3D12Device* pDevice, DXGI_FORMAT renderTargetFormat) final;
+		bool Init(ID3D12Device* pDevice, PipelineCache& pipelineCache, DXGI_FORMAT renderTargetFormat) final;
 	};
 }
\ No newline at end of file
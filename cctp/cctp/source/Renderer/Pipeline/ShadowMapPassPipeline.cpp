@@ -2,22 +2,23 @@
 #include "ShadowMapPassPipeline.h"
 #include "Binary/Binary.h"
 
-bool Renderer::ShadowMapPassPipeline::Init(ID3D12Device* pDevice, DXGI_FORMAT renderTargetFormat)
+bool Renderer::ShadowMapPassPipeline::Init(ID3D12Device* pDevice, PipelineCache& pipelineCache, DXGI_FORMAT renderTargetFormat)
 {
     // Create root signature
     CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
 
-    D3D12_ROOT_DESCRIPTOR perObjectConstantBufferDescriptorDesc = {};
-    perObjectConstantBufferDescriptorDesc.ShaderRegister = 0;
-    perObjectConstantBufferDescriptorDesc.RegisterSpace = 0;
+    // Instance data structured buffer, in space 1 to match the scene pipelines
+    D3D12_ROOT_DESCRIPTOR instanceDataDescriptorDesc = {};
+    instanceDataDescriptorDesc.ShaderRegister = 0;
+    instanceDataDescriptorDesc.RegisterSpace = 1;
 
     D3D12_ROOT_DESCRIPTOR perFrameConstantBufferDescriptorDesc = {};
     perFrameConstantBufferDescriptorDesc.ShaderRegister = 1;
     perFrameConstantBufferDescriptorDesc.RegisterSpace = 0;
 
     D3D12_ROOT_PARAMETER rootParameters[2];
-    rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
-    rootParameters[0].Descriptor = perObjectConstantBufferDescriptorDesc;
+    rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+    rootParameters[0].Descriptor = instanceDataDescriptorDesc;
     rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
 
     rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
@@ -81,7 +82,7 @@ bool Renderer::ShadowMapPassPipeline::Init(ID3D12Device* pDevice, DXGI_FORMAT re
     psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
     psoDesc.NumRenderTargets = 1;
 
-    if (FAILED(pDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&PipelineStateObject))))
+    if (!pipelineCache.CreateGraphicsPipelineState(L"ShadowMapPass", psoDesc, PipelineStateObject))
     {
         return false;
     }
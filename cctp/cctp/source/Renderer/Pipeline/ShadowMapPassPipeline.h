@@ -7,7 +7,7 @@ namespace Renderer
 	class ShadowMapPassPipeline : public GraphicsPipelineBase
 	{
 	public:
-		bool Init(ID3D12Device* pDevice, DXGI_FORMAT renderTargetFormat) final;
+		bool Init(ID3D12Device* pDevice, PipelineCache& pipelineCache, DXGI_FORMAT renderTargetFormat) final;
 
 	private:
 
@@ -0,0 +1,159 @@
+#include "Pch.h"
+#include "PipelineCache.h"
+#include "Binary/Hash.h"
+#include "ShaderCache.h"
+
+namespace
+{
+	uint64_t HashShader(const D3D12_SHADER_BYTECODE& shader, const uint64_t seed)
+	{
+		const uint64_t length = shader.BytecodeLength;
+		auto hash = Binary::HashBytes(&length, sizeof(length), seed);
+		return Binary::HashBytes(shader.pShaderBytecode, shader.BytecodeLength, hash);
+	}
+
+	template<typename T>
+	uint64_t HashValue(const T& value, const uint64_t seed)
+	{
+		return Binary::HashBytes(&value, sizeof(T), seed);
+	}
+
+	// Hashes the shaders and fixed function state member by member, as the description holds pointers and may hold padding
+	uint64_t HashGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		uint64_t hash = Binary::HashBytes(nullptr, 0);
+		hash = HashShader(desc.VS, hash);
+		hash = HashShader(desc.PS, hash);
+		hash = HashShader(desc.DS, hash);
+		hash = HashShader(desc.HS, hash);
+		hash = HashShader(desc.GS, hash);
+		hash = HashValue(desc.BlendState, hash);
+		hash = HashValue(desc.SampleMask, hash);
+		hash = HashValue(desc.RasterizerState, hash);
+		hash = HashValue(desc.DepthStencilState, hash);
+
+		hash = HashValue(desc.InputLayout.NumElements, hash);
+		for (UINT i = 0; i < desc.InputLayout.NumElements; ++i)
+		{
+			const auto& element = desc.InputLayout.pInputElementDescs[i];
+			hash = Binary::HashBytes(element.SemanticName, strlen(element.SemanticName) + 1, hash);
+			hash = HashValue(element.SemanticIndex, hash);
+			hash = HashValue(element.Format, hash);
+			hash = HashValue(element.InputSlot, hash);
+			hash = HashValue(element.AlignedByteOffset, hash);
+			hash = HashValue(element.InputSlotClass, hash);
+			hash = HashValue(element.InstanceDataStepRate, hash);
+		}
+
+		hash = HashValue(desc.IBStripCutValue, hash);
+		hash = HashValue(desc.PrimitiveTopologyType, hash);
+		hash = HashValue(desc.NumRenderTargets, hash);
+		hash = HashValue(desc.RTVFormats, hash);
+		hash = HashValue(desc.DSVFormat, hash);
+		hash = HashValue(desc.SampleDesc, hash);
+		hash = HashValue(desc.NodeMask, hash);
+		hash = HashValue(desc.Flags, hash);
+		return hash;
+	}
+}
+
+bool Renderer::PipelineCache::Init(ID3D12Device1* device, const uint64_t adapterKey)
+{
+	pDevice = device;
+	AdapterKey = adapterKey;
+
+	const auto filepath = ShaderCache::GetCacheFilepath(PIPELINE_LIBRARY_NAME);
+	if (ShaderCache::ReadCacheFile(filepath, AdapterKey, SerializedLibrary) && CreateLibrary(SerializedLibrary.data(), SerializedLibrary.size()))
+	{
+		Statistics.LibraryLoaded = true;
+		return true;
+	}
+
+	// The driver may reject a library written by another driver version even when the key matches
+	SerializedLibrary.clear();
+	if (!CreateLibrary(nullptr, 0))
+	{
+		DEBUG_LOG("Pipeline libraries are not supported, pipelines will be compiled on every run.");
+	}
+	return true;
+}
+
+bool Renderer::PipelineCache::CreateGraphicsPipelineState(const std::wstring& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+	Microsoft::WRL::ComPtr<ID3D12PipelineState>& pipelineState)
+{
+	assert(pDevice != nullptr && "Pipeline cache used before it was initialised.");
+
+	wchar_t hashString[20];
+	swprintf(hashString, _countof(hashString), L"_%016llx", static_cast<unsigned long long>(HashGraphicsPipelineDesc(desc)));
+	auto libraryName = name + hashString;
+
+	if (Library && SUCCEEDED(Library->LoadGraphicsPipeline(libraryName.c_str(), &desc, IID_PPV_ARGS(&pipelineState))))
+	{
+		++Statistics.LoadedCount;
+		Pipelines.emplace_back(std::move(libraryName), pipelineState);
+		return true;
+	}
+
+	if (FAILED(pDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipelineState))))
+	{
+		return false;
+	}
+	++Statistics.CreatedCount;
+
+	if (Library)
+	{
+		Dirty = true;
+		if (FAILED(Library->StorePipeline(libraryName.c_str(), pipelineState.Get())))
+		{
+			RebuildRequired = true;
+		}
+	}
+	Pipelines.emplace_back(std::move(libraryName), pipelineState);
+	return true;
+}
+
+bool Renderer::PipelineCache::Save()
+{
+	if (!Library || !Dirty)
+	{
+		return true;
+	}
+
+	if (RebuildRequired)
+	{
+		// Libraries cannot remove pipelines, so start an empty one holding only the pipelines of this run
+		if (!CreateLibrary(nullptr, 0))
+		{
+			return false;
+		}
+		for (const auto& [name, pipelineState] : Pipelines)
+		{
+			if (FAILED(Library->StorePipeline(name.c_str(), pipelineState.Get())))
+			{
+				return false;
+			}
+		}
+		SerializedLibrary.clear();
+		RebuildRequired = false;
+	}
+
+	std::vector<uint8_t> data(Library->GetSerializedSize());
+	if (FAILED(Library->Serialize(data.data(), data.size())))
+	{
+		return false;
+	}
+
+	if (!ShaderCache::WriteCacheFile(ShaderCache::GetCacheFilepath(PIPELINE_LIBRARY_NAME), AdapterKey, data.data(), data.size()))
+	{
+		DEBUG_LOG("Failed to write pipeline library.");
+		return false;
+	}
+	Dirty = false;
+	return true;
+}
+
+bool Renderer::PipelineCache::CreateLibrary(const void* pData, const size_t size)
+{
+	Library.Reset();
+	return SUCCEEDED(pDevice->CreatePipelineLibrary(pData, size, IID_PPV_ARGS(&Library)));
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+namespace Renderer
+{
+	struct PipelineCacheStatistics
+	{
+		// Whether a library written by an earlier run was accepted
+		bool LibraryLoaded = false;
+		uint32_t LoadedCount = 0;
+		uint32_t CreatedCount = 0;
+	};
+
+	// Keeps pipeline state objects in a pipeline library written to the shader cache directory, so later runs load them rather than
+	// have the driver compile them again. The file is keyed on the adapter and driver version, and the driver also rejects libraries it
+	// cannot use, either of which starts an empty library. Not thread safe
+	class PipelineCache
+	{
+	public:
+		static constexpr const char* PIPELINE_LIBRARY_NAME = "Pipelines.bin";
+
+		PipelineCache() = default;
+		PipelineCache(const PipelineCache&) = delete;
+		PipelineCache& operator=(const PipelineCache&) = delete;
+
+		// adapterKey identifies the adapter and driver the library is written for. Pipelines are still created without a library when
+		// the device cannot create one
+		bool Init(ID3D12Device1* pDevice, const uint64_t adapterKey);
+
+		// Pipelines are stored under the name followed by a hash of their shaders and state, so editing a shader stores a new pipeline
+		// rather than failing to load the old one
+		bool CreateGraphicsPipelineState(const std::wstring& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+			Microsoft::WRL::ComPtr<ID3D12PipelineState>& pipelineState);
+
+		// Writes the library if pipelines were created since it was loaded
+		bool Save();
+
+		const PipelineCacheStatistics& GetStatistics() const { return Statistics; }
+
+	private:
+		bool CreateLibrary(const void* pData, const size_t size);
+
+	private:
+		ID3D12Device1* pDevice = nullptr;
+		uint64_t AdapterKey = 0;
+		Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> Library;
+		// The library reads from the data it was created from rather than copying it, so it is kept alive with the library
+		std::vector<uint8_t> SerializedLibrary;
+		// Every pipeline created or loaded through the cache. Stores fail when a pipeline of the same name but another root signature is
+		// in the loaded library, the library is then rebuilt from these when saved
+		std::vector<std::pair<std::wstring, Microsoft::WRL::ComPtr<ID3D12PipelineState>>> Pipelines;
+		bool Dirty = false;
+		bool RebuildRequired = false;
+
+		PipelineCacheStatistics Statistics;
+	};
+}
\ No newline at end of file
@@ -16,8 +16,9 @@ Renderer::ProbeVolume::ProbeVolume(const glm::vec3& position, const glm::vec3& v
 	auto probeCountTotal = ProbeCountX * ProbeCountY * ProbeCountZ;
 
 	// Initialize probe transforms
-	ProbeTransforms.resize(probeCountTotal, { {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {debugProbeSize, debugProbeSize, debugProbeSize} });
+	ProbeTransforms.Resize(probeCountTotal, { {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {debugProbeSize, debugProbeSize, debugProbeSize} });
 	UpdateProbePositions();
+	ProbeTransforms.UpdateDirty();
 }
 
 void Renderer::ProbeVolume::Update()
@@ -26,6 +27,7 @@ void Renderer::ProbeVolume::Update()
 	{
 		UpdateProbePositions();
 	}
+	ProbeTransforms.UpdateDirty();
 }
 
 void Renderer::ProbeVolume::UpdateProbePositions()
@@ -36,10 +38,13 @@ void Renderer::ProbeVolume::UpdateProbePositions()
 		{
 			for (auto z = 0; z < ProbeCountZ; ++z)
 			{
-				ProbeTransforms[x + ProbeCountX * (y + ProbeCountZ * z)].Position = Position + glm::vec3((x * ProbeSpacing) - ((Extents.x - ProbeSpacing) / 2.0f),
+				ProbeTransforms.SetPosition(static_cast<uint32_t>(x + ProbeCountX * (y + ProbeCountZ * z)), Position + glm::vec3((x * ProbeSpacing) - ((Extents.x - ProbeSpacing) / 2.0f),
 													   (y * ProbeSpacing) - ((Extents.y - ProbeSpacing) / 2.0f),
-													   (z * ProbeSpacing) - ((Extents.z - ProbeSpacing) / 2.0f));
+													   (z * ProbeSpacing) - ((Extents.z - ProbeSpacing) / 2.0f)));
 			}
 		}
 	}
+
+	// Probes only move again when the volume position changes
+	UpdatedPosition = Position;
 }
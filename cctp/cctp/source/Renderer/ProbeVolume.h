@@ -1,6 +1,6 @@
 #pragma once
 
-#include "Math/Transform.h"
+#include "Math/TransformStorage.h"
 
 namespace Renderer
 {
@@ -8,6 +8,7 @@ namespace Renderer
 	{
 	public:
 		ProbeVolume(const glm::vec3& position, const glm::vec3& volumeExtents, float probeSpacing, float debugProbeSize);
+		// Moves the probes if the volume position changed and updates the matrices of moved probes
 		void Update();
 
 		const auto& GetProbeTransforms() const { return ProbeTransforms; }
@@ -25,7 +26,7 @@ namespace Renderer
 		glm::vec3 Position;
 		glm::vec3 Extents;
 		float ProbeSpacing;
-		std::vector<Transform> ProbeTransforms;
+		TransformStorage ProbeTransforms;
 		glm::vec3 UpdatedPosition;
 		size_t ProbeCountX;
 		size_t ProbeCountY;
@@ -0,0 +1,465 @@
+#include "Pch.h"
+#include "RenderGraph.h"
+
+namespace
+{
+	uint64_t AlignUp(const uint64_t value, const uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool LifetimesOverlap(const uint32_t firstA, const uint32_t lastA, const uint32_t firstB, const uint32_t lastB)
+	{
+		return firstA <= lastB && firstB <= lastA;
+	}
+}
+
+void Renderer::RenderGraph::Reset()
+{
+	Resources.clear();
+	Passes.clear();
+	FinalBarriers.clear();
+	HeapSizes.clear();
+	GraphStatistics = {};
+	Compiled = false;
+}
+
+Renderer::RenderGraph::ResourceHandle Renderer::RenderGraph::CreateTexture(const std::string& name, const TextureDesc& desc)
+{
+	Resource& resource = Resources.emplace_back();
+	resource.Name = name;
+	resource.Desc = desc;
+	Compiled = false;
+	return static_cast<ResourceHandle>(Resources.size() - 1);
+}
+
+Renderer::RenderGraph::ResourceHandle Renderer::RenderGraph::ImportTexture(const std::string& name, void* pNative, const uint32_t initialAccess,
+	const uint32_t finalAccess)
+{
+	Resource& resource = Resources.emplace_back();
+	resource.Name = name;
+	resource.pNative = pNative;
+	resource.Imported = true;
+	resource.InitialAccess = initialAccess;
+	resource.FinalAccess = finalAccess;
+	Compiled = false;
+	return static_cast<ResourceHandle>(Resources.size() - 1);
+}
+
+Renderer::RenderGraph::PassHandle Renderer::RenderGraph::AddPass(const std::string& name, std::function<void()>&& execute)
+{
+	Pass& pass = Passes.emplace_back();
+	pass.Name = name;
+	pass.Execute = std::move(execute);
+	Compiled = false;
+	return static_cast<PassHandle>(Passes.size() - 1);
+}
+
+void Renderer::RenderGraph::Read(const PassHandle pass, const ResourceHandle resource, const uint32_t access)
+{
+	assert(pass < Passes.size() && resource < Resources.size() && "Invalid render graph handle.");
+	assert(access != AccessNone && (access & WriteAccessMask) == 0 && "Read access must only have read bits.");
+	assert(std::none_of(Passes[pass].Accesses.begin(), Passes[pass].Accesses.end(), [resource](const ResourceAccess& a) { return a.Resource == resource; }) &&
+		"A pass accesses each resource once.");
+
+	Passes[pass].Accesses.push_back({ resource, access, false });
+	Compiled = false;
+}
+
+void Renderer::RenderGraph::Write(const PassHandle pass, const ResourceHandle resource, const uint32_t access)
+{
+	assert(pass < Passes.size() && resource < Resources.size() && "Invalid render graph handle.");
+	assert((access == AccessRenderTarget || access == AccessDepthWrite || access == AccessUnorderedAccess) && "Write access must be a single write bit.");
+	assert(std::none_of(Passes[pass].Accesses.begin(), Passes[pass].Accesses.end(), [resource](const ResourceAccess& a) { return a.Resource == resource; }) &&
+		"A pass accesses each resource once.");
+
+	Passes[pass].Accesses.push_back({ resource, access, true });
+	Compiled = false;
+}
+
+void Renderer::RenderGraph::SetHasSideEffects(const PassHandle pass)
+{
+	assert(pass < Passes.size() && "Invalid render graph handle.");
+	Passes[pass].HasSideEffects = true;
+	Compiled = false;
+}
+
+bool Renderer::RenderGraph::Compile(const AllocationQuery& queryAllocation)
+{
+	GraphStatistics = {};
+	GraphStatistics.PassCount = static_cast<uint32_t>(Passes.size());
+
+	CullPasses();
+
+	if (!CalculateLifetimes())
+	{
+		return false;
+	}
+
+	PlaceTransients(queryAllocation);
+	BuildBarriers();
+
+	Compiled = true;
+	return true;
+}
+
+void Renderer::RenderGraph::Execute(const std::function<void(const Barrier* pBarriers, const uint32_t barrierCount)>& submitBarriers) const
+{
+	assert(Compiled && "Render graph must be compiled before it is executed.");
+
+	for (const auto& pass : Passes)
+	{
+		if (pass.Culled)
+		{
+			continue;
+		}
+
+		if (!pass.Barriers.empty())
+		{
+			submitBarriers(pass.Barriers.data(), static_cast<uint32_t>(pass.Barriers.size()));
+		}
+
+		if (pass.Execute)
+		{
+			pass.Execute();
+		}
+	}
+
+	if (!FinalBarriers.empty())
+	{
+		submitBarriers(FinalBarriers.data(), static_cast<uint32_t>(FinalBarriers.size()));
+	}
+}
+
+void Renderer::RenderGraph::ExecutePass(const PassHandle pass) const
+{
+	assert(Compiled && "Render graph must be compiled before it is executed.");
+	assert(pass < Passes.size() && !Passes[pass].Culled && "Executing an invalid or culled pass.");
+
+	if (Passes[pass].Execute)
+	{
+		Passes[pass].Execute();
+	}
+}
+
+void Renderer::RenderGraph::CullPasses()
+{
+	// Walking back from the end, a pass is needed if it writes a resource something after it reads or that leaves the graph.
+	// Earlier writers of a needed resource stay needed as later passes may blend over or load what they wrote
+	std::vector<bool> needed(Resources.size(), false);
+	for (size_t i = 0; i < Resources.size(); ++i)
+	{
+		needed[i] = Resources[i].Imported;
+	}
+
+	for (size_t i = Passes.size(); i-- > 0;)
+	{
+		Pass& pass = Passes[i];
+		pass.Culled = !pass.HasSideEffects && std::none_of(pass.Accesses.begin(), pass.Accesses.end(), [&needed](const ResourceAccess& access)
+			{
+				return access.Write && needed[access.Resource];
+			});
+
+		if (pass.Culled)
+		{
+			++GraphStatistics.CulledPassCount;
+			continue;
+		}
+
+		for (const auto& access : pass.Accesses)
+		{
+			needed[access.Resource] = true;
+		}
+	}
+}
+
+bool Renderer::RenderGraph::CalculateLifetimes()
+{
+	for (auto& resource : Resources)
+	{
+		resource.AccessMask = AccessNone;
+		resource.FirstPass = InvalidHandle;
+		resource.LastPass = InvalidHandle;
+		resource.HeapPlacement = {};
+		if (!resource.Imported)
+		{
+			resource.InitialAccess = AccessNone;
+		}
+	}
+
+	for (PassHandle p = 0; p < Passes.size(); ++p)
+	{
+		if (Passes[p].Culled)
+		{
+			continue;
+		}
+
+		for (const auto& access : Passes[p].Accesses)
+		{
+			Resource& resource = Resources[access.Resource];
+			if (resource.FirstPass == InvalidHandle)
+			{
+				resource.FirstPass = p;
+				if (!resource.Imported)
+				{
+					if (!access.Write)
+					{
+						DEBUG_LOG("ERROR: Render graph pass " << Passes[p].Name << " reads transient " << resource.Name << " before it is written.");
+						return false;
+					}
+					resource.InitialAccess = access.Access;
+				}
+			}
+
+			resource.LastPass = p;
+			resource.AccessMask |= access.Access;
+		}
+	}
+
+	return true;
+}
+
+void Renderer::RenderGraph::PlaceTransients(const AllocationQuery& queryAllocation)
+{
+	HeapSizes.clear();
+
+	std::vector<ResourceHandle> transients;
+	std::vector<uint64_t> alignments(Resources.size(), 1);
+	for (ResourceHandle r = 0; r < Resources.size(); ++r)
+	{
+		Resource& resource = Resources[r];
+		if (resource.Imported || resource.FirstPass == InvalidHandle)
+		{
+			continue;
+		}
+
+		const auto info = queryAllocation(resource.Desc, resource.AccessMask);
+		assert(info.Alignment > 0 && "Transient alignment must not be zero.");
+		resource.HeapPlacement.HeapType = info.HeapType;
+		resource.HeapPlacement.Size = info.Size;
+		alignments[r] = info.Alignment;
+		transients.push_back(r);
+
+		++GraphStatistics.TransientCount;
+		GraphStatistics.TransientBytes += info.Size;
+	}
+
+	// Largest first so small textures fill the gaps left between large ones
+	std::stable_sort(transients.begin(), transients.end(), [this](const ResourceHandle a, const ResourceHandle b)
+		{
+			return Resources[a].HeapPlacement.Size > Resources[b].HeapPlacement.Size;
+		});
+
+	std::vector<ResourceHandle> placed;
+	std::vector<ResourceHandle> conflicts;
+	for (auto r : transients)
+	{
+		Resource& resource = Resources[r];
+		const uint64_t alignment = alignments[r];
+		const uint64_t size = resource.HeapPlacement.Size;
+
+		// Memory of placed textures alive at the same time as this one is unavailable
+		conflicts.clear();
+		for (auto other : placed)
+		{
+			const Resource& otherResource = Resources[other];
+			if (otherResource.HeapPlacement.HeapType == resource.HeapPlacement.HeapType &&
+				LifetimesOverlap(resource.FirstPass, resource.LastPass, otherResource.FirstPass, otherResource.LastPass))
+			{
+				conflicts.push_back(other);
+			}
+		}
+
+		std::sort(conflicts.begin(), conflicts.end(), [this](const ResourceHandle a, const ResourceHandle b)
+			{
+				return Resources[a].HeapPlacement.Offset < Resources[b].HeapPlacement.Offset;
+			});
+
+		// Lowest aligned offset that fits before the next conflicting range
+		uint64_t offset = 0;
+		for (auto other : conflicts)
+		{
+			const Placement& otherPlacement = Resources[other].HeapPlacement;
+			if (AlignUp(offset, alignment) + size <= otherPlacement.Offset)
+			{
+				break;
+			}
+			offset = std::max(offset, otherPlacement.Offset + otherPlacement.Size);
+		}
+		offset = AlignUp(offset, alignment);
+
+		resource.HeapPlacement.Offset = offset;
+		placed.push_back(r);
+
+		const uint32_t heapType = resource.HeapPlacement.HeapType;
+		if (heapType >= HeapSizes.size())
+		{
+			HeapSizes.resize(heapType + 1, 0);
+		}
+		HeapSizes[heapType] = std::max(HeapSizes[heapType], offset + size);
+	}
+
+	for (auto heapSize : HeapSizes)
+	{
+		GraphStatistics.HeapBytes += heapSize;
+	}
+}
+
+void Renderer::RenderGraph::BuildBarriers()
+{
+	FinalBarriers.clear();
+
+	std::vector<uint32_t> accesses(Resources.size());
+	std::vector<bool> writtenThisFrame(Resources.size(), false);
+	for (size_t i = 0; i < Resources.size(); ++i)
+	{
+		accesses[i] = Resources[i].InitialAccess;
+	}
+
+	auto addTransition = [&accesses](std::vector<Barrier>& barriers, const ResourceHandle resource, const uint32_t access)
+		{
+			Barrier& barrier = barriers.emplace_back();
+			barrier.BarrierType = Barrier::Type::Transition;
+			barrier.Resource = resource;
+			barrier.AccessBefore = accesses[resource];
+			barrier.AccessAfter = access;
+			accesses[resource] = access;
+		};
+
+	// Transients return to their initial access once their last pass has run, before anything else can use their memory
+	std::vector<ResourceHandle> finishedTransients;
+	auto returnFinishedTransients = [&](std::vector<Barrier>& barriers)
+		{
+			for (auto r : finishedTransients)
+			{
+				if (accesses[r] != Resources[r].InitialAccess)
+				{
+					addTransition(barriers, r, Resources[r].InitialAccess);
+				}
+			}
+			finishedTransients.clear();
+		};
+
+	for (PassHandle p = 0; p < Passes.size(); ++p)
+	{
+		Pass& pass = Passes[p];
+		pass.Barriers.clear();
+		if (pass.Culled)
+		{
+			continue;
+		}
+
+		returnFinishedTransients(pass.Barriers);
+
+		for (const auto& access : pass.Accesses)
+		{
+			const ResourceHandle r = access.Resource;
+			const Resource& resource = Resources[r];
+
+			// A transient sharing memory with others takes it over at its first use. The previous user could be from the previous frame
+			if (!resource.Imported && resource.FirstPass == p)
+			{
+				uint32_t overlapCount = 0;
+				ResourceHandle previous = InvalidHandle;
+				for (ResourceHandle other = 0; other < Resources.size(); ++other)
+				{
+					const Resource& otherResource = Resources[other];
+					if (other == r || otherResource.Imported || otherResource.FirstPass == InvalidHandle ||
+						otherResource.HeapPlacement.HeapType != resource.HeapPlacement.HeapType)
+					{
+						continue;
+					}
+
+					const Placement& a = resource.HeapPlacement;
+					const Placement& b = otherResource.HeapPlacement;
+					if (a.Offset < b.Offset + b.Size && b.Offset < a.Offset + a.Size)
+					{
+						++overlapCount;
+						previous = other;
+					}
+				}
+
+				if (overlapCount > 0)
+				{
+					Barrier& barrier = pass.Barriers.emplace_back();
+					barrier.BarrierType = Barrier::Type::Aliasing;
+					barrier.Resource = r;
+					barrier.ResourceBefore = overlapCount == 1 ? previous : InvalidHandle;
+				}
+			}
+
+			if (access.Write)
+			{
+				if (accesses[r] != access.Access)
+				{
+					addTransition(pass.Barriers, r, access.Access);
+				}
+				else if (access.Access == AccessUnorderedAccess && writtenThisFrame[r])
+				{
+					Barrier& barrier = pass.Barriers.emplace_back();
+					barrier.BarrierType = Barrier::Type::UnorderedAccess;
+					barrier.Resource = r;
+				}
+				writtenThisFrame[r] = true;
+			}
+			else
+			{
+				// Reads already covered by the current read only access need no barrier
+				const uint32_t current = accesses[r];
+				if ((current & WriteAccessMask) != 0 || (current & access.Access) != access.Access)
+				{
+					addTransition(pass.Barriers, r, GatherReadAccess(r, p));
+				}
+			}
+
+			if (!resource.Imported && resource.LastPass == p)
+			{
+				finishedTransients.push_back(r);
+			}
+		}
+	}
+
+	returnFinishedTransients(FinalBarriers);
+
+	for (ResourceHandle r = 0; r < Resources.size(); ++r)
+	{
+		if (Resources[r].Imported && accesses[r] != Resources[r].FinalAccess)
+		{
+			addTransition(FinalBarriers, r, Resources[r].FinalAccess);
+		}
+	}
+
+	for (const auto& pass : Passes)
+	{
+		GraphStatistics.BarrierCount += static_cast<uint32_t>(pass.Barriers.size());
+	}
+	GraphStatistics.BarrierCount += static_cast<uint32_t>(FinalBarriers.size());
+}
+
+uint32_t Renderer::RenderGraph::GatherReadAccess(const ResourceHandle resource, const PassHandle firstPass) const
+{
+	uint32_t access = AccessNone;
+	for (PassHandle p = firstPass; p < Passes.size(); ++p)
+	{
+		if (Passes[p].Culled)
+		{
+			continue;
+		}
+
+		for (const auto& passAccess : Passes[p].Accesses)
+		{
+			if (passAccess.Resource != resource)
+			{
+				continue;
+			}
+
+			if (passAccess.Write)
+			{
+				return access;
+			}
+			access |= passAccess.Access;
+		}
+	}
+
+	return access;
+}
\ No newline at end of file
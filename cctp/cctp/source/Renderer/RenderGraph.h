@@ -0,0 +1,183 @@
+#pragma once
+
+namespace Renderer
+{
+	// Frame description of passes and the textures they read and write. Compiling culls passes whose results are never used, derives the
+	// state transitions between passes and places transient textures with disjoint lifetimes at the same memory of shared heaps.
+	// Compilation knows nothing of the graphics API, the backend reports allocation sizes and translates the barriers it produces
+	class RenderGraph
+	{
+	public:
+		using ResourceHandle = uint32_t;
+		using PassHandle = uint32_t;
+		static constexpr uint32_t InvalidHandle = UINT32_MAX;
+
+		// Ways a pass uses a resource. Read bits can be combined, a resource is only ever in one write access
+		enum Access : uint32_t
+		{
+			AccessNone = 0,
+			AccessRenderTarget = 1 << 0,
+			AccessDepthWrite = 1 << 1,
+			AccessUnorderedAccess = 1 << 2,
+			AccessDepthRead = 1 << 3,
+			AccessPixelShaderResource = 1 << 4,
+			AccessNonPixelShaderResource = 1 << 5,
+			AccessCopySource = 1 << 6,
+			AccessCopyDest = 1 << 7
+		};
+		static constexpr uint32_t WriteAccessMask = AccessRenderTarget | AccessDepthWrite | AccessUnorderedAccess | AccessCopyDest;
+		static constexpr uint32_t ShaderReadAccessMask = AccessPixelShaderResource | AccessNonPixelShaderResource;
+
+		struct TextureDesc
+		{
+			uint32_t Width = 0;
+			uint32_t Height = 0;
+			// Format value of the backend
+			uint32_t Format = 0;
+			std::array<float, 4> ClearColor = {};
+			float ClearDepth = 1.0f;
+		};
+
+		// Memory requirements of a transient texture, reported by the backend. Textures are only aliased with others of the same heap type
+		struct AllocationInfo
+		{
+			uint64_t Size = 0;
+			uint64_t Alignment = 1;
+			uint32_t HeapType = 0;
+		};
+		using AllocationQuery = std::function<AllocationInfo(const TextureDesc& desc, const uint32_t accessMask)>;
+
+		struct Placement
+		{
+			uint32_t HeapType = 0;
+			uint64_t Offset = 0;
+			uint64_t Size = 0;
+		};
+
+		struct Barrier
+		{
+			enum class Type : uint8_t
+			{
+				Transition,
+				// Resource becomes the user of its memory. ResourceBefore is the previous user, or InvalidHandle when there could be several
+				Aliasing,
+				// Orders unordered access writes of consecutive passes
+				UnorderedAccess
+			};
+
+			Type BarrierType = Type::Transition;
+			ResourceHandle Resource = InvalidHandle;
+			ResourceHandle ResourceBefore = InvalidHandle;
+			uint32_t AccessBefore = AccessNone;
+			uint32_t AccessAfter = AccessNone;
+		};
+
+		struct Statistics
+		{
+			uint32_t PassCount = 0;
+			uint32_t CulledPassCount = 0;
+			uint32_t BarrierCount = 0;
+			uint32_t TransientCount = 0;
+			// Sum of every transient's size against the heap memory they were placed in
+			uint64_t TransientBytes = 0;
+			uint64_t HeapBytes = 0;
+		};
+
+		// Removes every pass and resource, storage is kept for the next frame
+		void Reset();
+
+		// Transient textures live for the frame. The first pass using one must write it, and as its memory may have held another texture,
+		// must clear or fully overwrite it
+		ResourceHandle CreateTexture(const std::string& name, const TextureDesc& desc);
+		// Textures owned outside the graph, in initialAccess when the graph executes and left in finalAccess. Native is the backend's resource
+		ResourceHandle ImportTexture(const std::string& name, void* pNative, const uint32_t initialAccess, const uint32_t finalAccess);
+
+		// Passes execute in the order they are added
+		PassHandle AddPass(const std::string& name, std::function<void()>&& execute);
+		void Read(const PassHandle pass, const ResourceHandle resource, const uint32_t access);
+		void Write(const PassHandle pass, const ResourceHandle resource, const uint32_t access);
+		// Passes with effects outside the graph's resources are never culled
+		void SetHasSideEffects(const PassHandle pass);
+
+		// Culls passes, places transients and builds barriers. Returns false if the graph reads a transient before it is written
+		bool Compile(const AllocationQuery& queryAllocation);
+		// Runs the passes that were not culled, handing the barriers before each to submitBarriers
+		void Execute(const std::function<void(const Barrier* pBarriers, const uint32_t barrierCount)>& submitBarriers) const;
+		// Runs a single pass without its barriers, for backends recording passes in parallel. The backend must submit each pass's barriers
+		// before the pass and the final barriers after the last, in pass order
+		void ExecutePass(const PassHandle pass) const;
+
+		uint32_t GetResourceCount() const { return static_cast<uint32_t>(Resources.size()); }
+		const std::string& GetResourceName(const ResourceHandle resource) const { return Resources[resource].Name; }
+		const TextureDesc& GetTextureDesc(const ResourceHandle resource) const { return Resources[resource].Desc; }
+		bool IsImported(const ResourceHandle resource) const { return Resources[resource].Imported; }
+		void* GetNativeResource(const ResourceHandle resource) const { return Resources[resource].pNative; }
+		// Union of the accesses of passes that were not culled, zero for resources no such pass uses
+		uint32_t GetAccessMask(const ResourceHandle resource) const { return Resources[resource].AccessMask; }
+		// Transients are in the access of their first use between frames, so are created in it
+		uint32_t GetInitialAccess(const ResourceHandle resource) const { return Resources[resource].InitialAccess; }
+		const Placement& GetPlacement(const ResourceHandle resource) const { return Resources[resource].HeapPlacement; }
+		uint32_t GetHeapCount() const { return static_cast<uint32_t>(HeapSizes.size()); }
+		uint64_t GetHeapSize(const uint32_t heapType) const { return heapType < HeapSizes.size() ? HeapSizes[heapType] : 0; }
+
+		uint32_t GetPassCount() const { return static_cast<uint32_t>(Passes.size()); }
+		const std::string& GetPassName(const PassHandle pass) const { return Passes[pass].Name; }
+		bool IsPassCulled(const PassHandle pass) const { return Passes[pass].Culled; }
+		// Barriers submitted before the pass executes
+		const std::vector<Barrier>& GetPassBarriers(const PassHandle pass) const { return Passes[pass].Barriers; }
+		// Barriers submitted after the last pass
+		const std::vector<Barrier>& GetFinalBarriers() const { return FinalBarriers; }
+		const Statistics& GetStatistics() const { return GraphStatistics; }
+
+	private:
+		struct ResourceAccess
+		{
+			ResourceHandle Resource = InvalidHandle;
+			uint32_t Access = AccessNone;
+			bool Write = false;
+		};
+
+		struct Resource
+		{
+			std::string Name;
+			TextureDesc Desc;
+			void* pNative = nullptr;
+			bool Imported = false;
+			uint32_t InitialAccess = AccessNone;
+			uint32_t FinalAccess = AccessNone;
+
+			// Compiled
+			uint32_t AccessMask = AccessNone;
+			uint32_t FirstPass = InvalidHandle;
+			uint32_t LastPass = InvalidHandle;
+			Placement HeapPlacement;
+		};
+
+		struct Pass
+		{
+			std::string Name;
+			std::function<void()> Execute;
+			std::vector<ResourceAccess> Accesses;
+			bool HasSideEffects = false;
+
+			// Compiled
+			bool Culled = false;
+			std::vector<Barrier> Barriers;
+		};
+
+		void CullPasses();
+		bool CalculateLifetimes();
+		void PlaceTransients(const AllocationQuery& queryAllocation);
+		void BuildBarriers();
+		// Read accesses of the resource from the pass until it is next written, so consecutive reads need a single transition
+		uint32_t GatherReadAccess(const ResourceHandle resource, const PassHandle firstPass) const;
+
+	private:
+		std::vector<Resource> Resources;
+		std::vector<Pass> Passes;
+		std::vector<Barrier> FinalBarriers;
+		std::vector<uint64_t> HeapSizes;
+		Statistics GraphStatistics;
+		bool Compiled = false;
+	};
+}
\ No newline at end of file
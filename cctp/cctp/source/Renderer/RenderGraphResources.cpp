@@ -0,0 +1,326 @@
+#include "Pch.h"
+#include "RenderGraphResources.h"
+#include "Renderer.h"
+
+namespace
+{
+	bool IsDepthFormat(const DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_D32_FLOAT || format == DXGI_FORMAT_D24_UNORM_S8_UINT || format == DXGI_FORMAT_D16_UNORM;
+	}
+
+	// Depth textures read by shaders are created typeless so they can be viewed as both depth and color
+	DXGI_FORMAT GetTypelessDepthFormat(const DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_D32_FLOAT: return DXGI_FORMAT_R32_TYPELESS;
+		case DXGI_FORMAT_D24_UNORM_S8_UINT: return DXGI_FORMAT_R24G8_TYPELESS;
+		case DXGI_FORMAT_D16_UNORM: return DXGI_FORMAT_R16_TYPELESS;
+		default: return format;
+		}
+	}
+
+	DXGI_FORMAT GetDepthShaderResourceFormat(const DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_D32_FLOAT: return DXGI_FORMAT_R32_FLOAT;
+		case DXGI_FORMAT_D24_UNORM_S8_UINT: return DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+		case DXGI_FORMAT_D16_UNORM: return DXGI_FORMAT_R16_UNORM;
+		default: return format;
+		}
+	}
+}
+
+bool Renderer::RenderGraphResources::Init(ID3D12Device* pDevice)
+{
+	this->pDevice = pDevice;
+	RenderTargetViewHeap.Init(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, MaxTargetCount, false);
+	DepthStencilViewHeap.Init(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_DSV, MaxTargetCount, false);
+	return true;
+}
+
+Renderer::RenderGraph::AllocationInfo Renderer::RenderGraphResources::QueryAllocation(const RenderGraph::TextureDesc& desc, const uint32_t accessMask) const
+{
+	const auto resourceDesc = MakeResourceDesc(desc, accessMask);
+	const auto allocationInfo = pDevice->GetResourceAllocationInfo(0, 1, &resourceDesc);
+
+	RenderGraph::AllocationInfo info;
+	info.Size = allocationInfo.SizeInBytes;
+	info.Alignment = allocationInfo.Alignment;
+	info.HeapType = (resourceDesc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0 ?
+		HeapTypeRenderTargets : HeapTypeTextures;
+	return info;
+}
+
+bool Renderer::RenderGraphResources::Update(const RenderGraph& graph)
+{
+	if (MatchesLayout(graph))
+	{
+		return true;
+	}
+
+	// Views and heaps of the previous layout may still be used by frames in flight
+	if (!Transients.empty() && !Renderer::Flush())
+	{
+		DEBUG_LOG("ERROR: Failed to flush before recreating render graph resources.");
+		return false;
+	}
+
+	Transients.clear();
+	Transients.resize(graph.GetResourceCount());
+	HeapSizes = {};
+
+	for (uint32_t heapType = 0; heapType < HeapTypeCount; ++heapType)
+	{
+		Heaps[heapType].Reset();
+
+		const UINT64 heapSize = graph.GetHeapSize(heapType);
+		if (heapSize == 0)
+		{
+			continue;
+		}
+
+		D3D12_HEAP_DESC heapDesc = {};
+		heapDesc.SizeInBytes = heapSize;
+		heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+		heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		heapDesc.Flags = heapType == HeapTypeRenderTargets ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+		if (FAILED(pDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&Heaps[heapType]))))
+		{
+			DEBUG_LOG("ERROR: Failed to create render graph transient heap.");
+			return false;
+		}
+		HeapSizes[heapType] = heapSize;
+	}
+
+	uint32_t renderTargetCount = 0;
+	uint32_t depthStencilCount = 0;
+	for (RenderGraph::ResourceHandle r = 0; r < graph.GetResourceCount(); ++r)
+	{
+		if (graph.IsImported(r) || graph.GetAccessMask(r) == RenderGraph::AccessNone)
+		{
+			continue;
+		}
+
+		Transient& transient = Transients[r];
+		transient.Desc = graph.GetTextureDesc(r);
+		transient.AccessMask = graph.GetAccessMask(r);
+		transient.InitialAccess = graph.GetInitialAccess(r);
+		transient.Placement = graph.GetPlacement(r);
+
+		if ((transient.AccessMask & RenderGraph::AccessRenderTarget) != 0)
+		{
+			transient.RenderTargetViewIndex = renderTargetCount++;
+		}
+		if ((transient.AccessMask & (RenderGraph::AccessDepthWrite | RenderGraph::AccessDepthRead)) != 0)
+		{
+			transient.DepthStencilViewIndex = depthStencilCount++;
+		}
+		assert(renderTargetCount <= MaxTargetCount && depthStencilCount <= MaxTargetCount && "Too many render graph targets.");
+
+		if (!CreateTransient(transient))
+		{
+			DEBUG_LOG("ERROR: Failed to create render graph transient " << graph.GetResourceName(r) << ".");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+ID3D12Resource* Renderer::RenderGraphResources::GetResource(const RenderGraph& graph, const RenderGraph::ResourceHandle resource) const
+{
+	if (graph.IsImported(resource))
+	{
+		return static_cast<ID3D12Resource*>(graph.GetNativeResource(resource));
+	}
+
+	assert(resource < Transients.size() && Transients[resource].Resource && "Render graph transient has not been created.");
+	return Transients[resource].Resource.Get();
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE Renderer::RenderGraphResources::GetRenderTargetView(const RenderGraph::ResourceHandle resource) const
+{
+	assert(resource < Transients.size() && Transients[resource].RenderTargetViewIndex != RenderGraph::InvalidHandle && "Transient is not a render target.");
+	return RenderTargetViewHeap.GetCPUDescriptorHandle(Transients[resource].RenderTargetViewIndex);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE Renderer::RenderGraphResources::GetDepthStencilView(const RenderGraph::ResourceHandle resource) const
+{
+	assert(resource < Transients.size() && Transients[resource].DepthStencilViewIndex != RenderGraph::InvalidHandle && "Transient is not a depth stencil.");
+	return DepthStencilViewHeap.GetCPUDescriptorHandle(Transients[resource].DepthStencilViewIndex);
+}
+
+void Renderer::RenderGraphResources::WriteShaderResourceView(const RenderGraph::ResourceHandle resource, const uint32_t descriptorIndex) const
+{
+	assert(resource < Transients.size() && Transients[resource].Resource && (Transients[resource].AccessMask & RenderGraph::ShaderReadAccessMask) != 0 &&
+		"Transient is not read by shaders.");
+	const Transient& transient = Transients[resource];
+	const auto format = static_cast<DXGI_FORMAT>(transient.Desc.Format);
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc = {};
+	shaderResourceViewDesc.Format = IsDepthFormat(format) ? GetDepthShaderResourceFormat(format) : format;
+	shaderResourceViewDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	shaderResourceViewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	shaderResourceViewDesc.Texture2D.MipLevels = 1;
+	AddSRVDescriptorToShaderVisibleHeap(transient.Resource.Get(), &shaderResourceViewDesc, descriptorIndex);
+}
+
+UINT64 Renderer::RenderGraphResources::GetHeapBytes() const
+{
+	UINT64 bytes = 0;
+	for (auto size : HeapSizes)
+	{
+		bytes += size;
+	}
+	return bytes;
+}
+
+D3D12_RESOURCE_STATES Renderer::RenderGraphResources::GetResourceStates(const uint32_t access)
+{
+	D3D12_RESOURCE_STATES states = D3D12_RESOURCE_STATE_COMMON;
+	if (access & RenderGraph::AccessRenderTarget)
+	{
+		states |= D3D12_RESOURCE_STATE_RENDER_TARGET;
+	}
+	if (access & RenderGraph::AccessDepthWrite)
+	{
+		states |= D3D12_RESOURCE_STATE_DEPTH_WRITE;
+	}
+	if (access & RenderGraph::AccessUnorderedAccess)
+	{
+		states |= D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+	}
+	if (access & RenderGraph::AccessDepthRead)
+	{
+		states |= D3D12_RESOURCE_STATE_DEPTH_READ;
+	}
+	if (access & RenderGraph::AccessPixelShaderResource)
+	{
+		states |= D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+	}
+	if (access & RenderGraph::AccessNonPixelShaderResource)
+	{
+		states |= D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	}
+	if (access & RenderGraph::AccessCopySource)
+	{
+		states |= D3D12_RESOURCE_STATE_COPY_SOURCE;
+	}
+	if (access & RenderGraph::AccessCopyDest)
+	{
+		states |= D3D12_RESOURCE_STATE_COPY_DEST;
+	}
+	return states;
+}
+
+D3D12_RESOURCE_DESC Renderer::RenderGraphResources::MakeResourceDesc(const RenderGraph::TextureDesc& desc, const uint32_t accessMask) const
+{
+	const auto format = static_cast<DXGI_FORMAT>(desc.Format);
+	const bool shaderRead = (accessMask & RenderGraph::ShaderReadAccessMask) != 0;
+
+	D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE;
+	if (accessMask & RenderGraph::AccessRenderTarget)
+	{
+		flags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+	}
+	if (accessMask & (RenderGraph::AccessDepthWrite | RenderGraph::AccessDepthRead))
+	{
+		flags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+		if (!shaderRead)
+		{
+			flags |= D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
+		}
+	}
+	if (accessMask & RenderGraph::AccessUnorderedAccess)
+	{
+		flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+	}
+
+	return CD3DX12_RESOURCE_DESC::Tex2D(IsDepthFormat(format) && shaderRead ? GetTypelessDepthFormat(format) : format,
+		desc.Width, desc.Height, 1, 1, 1, 0, flags);
+}
+
+bool Renderer::RenderGraphResources::MatchesLayout(const RenderGraph& graph) const
+{
+	if (Transients.size() != graph.GetResourceCount())
+	{
+		return false;
+	}
+
+	for (uint32_t heapType = 0; heapType < HeapTypeCount; ++heapType)
+	{
+		if (HeapSizes[heapType] != graph.GetHeapSize(heapType))
+		{
+			return false;
+		}
+	}
+
+	for (RenderGraph::ResourceHandle r = 0; r < graph.GetResourceCount(); ++r)
+	{
+		const Transient& transient = Transients[r];
+		if (graph.IsImported(r))
+		{
+			if (transient.Resource)
+			{
+				return false;
+			}
+			continue;
+		}
+
+		const auto& desc = graph.GetTextureDesc(r);
+		const auto& placement = graph.GetPlacement(r);
+		if (transient.AccessMask != graph.GetAccessMask(r) || transient.InitialAccess != graph.GetInitialAccess(r) ||
+			transient.Desc.Width != desc.Width || transient.Desc.Height != desc.Height || transient.Desc.Format != desc.Format ||
+			transient.Placement.HeapType != placement.HeapType || transient.Placement.Offset != placement.Offset)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Renderer::RenderGraphResources::CreateTransient(Transient& transient)
+{
+	const auto format = static_cast<DXGI_FORMAT>(transient.Desc.Format);
+	const auto resourceDesc = MakeResourceDesc(transient.Desc, transient.AccessMask);
+
+	// Clears matching the optimized clear value are fastest
+	D3D12_CLEAR_VALUE clearValue = {};
+	clearValue.Format = format;
+	const bool renderTarget = (resourceDesc.Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET) != 0;
+	const bool depthStencil = (resourceDesc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL) != 0;
+	if (depthStencil)
+	{
+		clearValue.DepthStencil.Depth = transient.Desc.ClearDepth;
+	}
+	else
+	{
+		memcpy(clearValue.Color, transient.Desc.ClearColor.data(), sizeof(clearValue.Color));
+	}
+
+	if (FAILED(pDevice->CreatePlacedResource(Heaps[transient.Placement.HeapType].Get(), transient.Placement.Offset, &resourceDesc,
+		GetResourceStates(transient.InitialAccess), renderTarget || depthStencil ? &clearValue : nullptr, IID_PPV_ARGS(&transient.Resource))))
+	{
+		return false;
+	}
+
+	if (renderTarget)
+	{
+		pDevice->CreateRenderTargetView(transient.Resource.Get(), nullptr, RenderTargetViewHeap.GetCPUDescriptorHandle(transient.RenderTargetViewIndex));
+	}
+
+	if (depthStencil)
+	{
+		D3D12_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc = {};
+		depthStencilViewDesc.Format = format;
+		depthStencilViewDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+		depthStencilViewDesc.Flags = D3D12_DSV_FLAG_NONE;
+		pDevice->CreateDepthStencilView(transient.Resource.Get(), &depthStencilViewDesc, DepthStencilViewHeap.GetCPUDescriptorHandle(transient.DepthStencilViewIndex));
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "RenderGraph.h"
+#include "DescriptorHeap.h"
+
+namespace Renderer
+{
+	// D3D12 objects behind a compiled render graph. Transients are placed resources in one heap per heap type, recreated only when the
+	// compiled layout changes, so a graph built the same way each frame keeps its resources. Imported resources are the graph's native pointers
+	class RenderGraphResources
+	{
+	public:
+		// Heap types given to the graph. Render targets and depth stencils get their own heap as resource heap tier 1 cannot mix them with other textures
+		enum HeapType : uint32_t
+		{
+			HeapTypeRenderTargets = 0,
+			HeapTypeTextures,
+
+			HeapTypeCount
+		};
+
+		static constexpr uint32_t MaxTargetCount = 16;
+
+		bool Init(ID3D12Device* pDevice);
+		// Size and alignment of a transient texture with every flag its accesses need
+		RenderGraph::AllocationInfo QueryAllocation(const RenderGraph::TextureDesc& desc, const uint32_t accessMask) const;
+		// Must be called after the graph compiles and before it executes. If the transients differ from the last compile, waits for the GPU
+		// to idle and recreates them
+		bool Update(const RenderGraph& graph);
+
+		ID3D12Resource* GetResource(const RenderGraph& graph, const RenderGraph::ResourceHandle resource) const;
+		D3D12_CPU_DESCRIPTOR_HANDLE GetRenderTargetView(const RenderGraph::ResourceHandle resource) const;
+		D3D12_CPU_DESCRIPTOR_HANDLE GetDepthStencilView(const RenderGraph::ResourceHandle resource) const;
+		// Writes a shader resource view of a transient read by shaders to a shader visible descriptor. Transients may be recreated by
+		// Update, so views are written each frame into descriptors allocated for the frame
+		void WriteShaderResourceView(const RenderGraph::ResourceHandle resource, const uint32_t descriptorIndex) const;
+		UINT64 GetHeapBytes() const;
+
+		static D3D12_RESOURCE_STATES GetResourceStates(const uint32_t access);
+
+	private:
+		struct Transient
+		{
+			RenderGraph::TextureDesc Desc;
+			uint32_t AccessMask = RenderGraph::AccessNone;
+			uint32_t InitialAccess = RenderGraph::AccessNone;
+			RenderGraph::Placement Placement;
+
+			Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+			uint32_t RenderTargetViewIndex = RenderGraph::InvalidHandle;
+			uint32_t DepthStencilViewIndex = RenderGraph::InvalidHandle;
+		};
+
+		D3D12_RESOURCE_DESC MakeResourceDesc(const RenderGraph::TextureDesc& desc, const uint32_t accessMask) const;
+		bool MatchesLayout(const RenderGraph& graph) const;
+		bool CreateTransient(Transient& transient);
+
+	private:
+		ID3D12Device* pDevice = nullptr;
+		DescriptorHeap RenderTargetViewHeap;
+		DescriptorHeap DepthStencilViewHeap;
+
+		std::array<Microsoft::WRL::ComPtr<ID3D12Heap>, HeapTypeCount> Heaps;
+		std::array<UINT64, HeapTypeCount> HeapSizes = {};
+		// Indexed by graph resource handle, empty for imported and unused resources
+		std::vector<Transient> Transients;
+	};
+}
\ No newline at end of file
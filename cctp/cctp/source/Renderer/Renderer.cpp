@@ -1,18 +1,27 @@
 #include "Pch.h"
 #include "Renderer.h"
 #include "Math/Math.h"
-#include "Math/Transform.h"
+#include "Math/TransformStorage.h"
 #include "Window/Window.h"
 
 #include "Pipeline/GraphicsPipeline.h"
 #include "DescriptorHeap.h"
 #include "Material.h"
+#include "InstanceData.h"
+#include "UploadAllocator.h"
+#include "CommandStream.h"
+#include "D3D12CommandBackend.h"
+#include "Tasks/TaskSystem.h"
+#include "Binary/Hash.h"
+#include <mutex>
+#include <atomic>
 
-constexpr float CLEAR_COLOR[4] = { 0.005f, 0.005f, 0.005f, 1.0f };
 constexpr UINT64 CONSTANT_BUFFER_ALIGNMENT_SIZE_BYTES = 256;
-constexpr uint32_t SIZE_64KB = 65536;
+constexpr UINT64 INSTANCE_DATA_ALIGNMENT_SIZE_BYTES = 16;
 constexpr size_t BACK_BUFFER_COUNT = 3;
-constexpr uint32_t MAX_DRAWS_PER_FRAME = SIZE_64KB / CONSTANT_BUFFER_ALIGNMENT_SIZE_BYTES;
+constexpr uint32_t MAX_PASS_COUNT = 8;
+constexpr size_t MAX_TRACKED_ROOT_PARAMETERS = 8;
+constexpr UINT64 CONTEXT_UPLOAD_BLOCK_SIZE_BYTES = 64 * 1024;
 
 // Renderer
 Microsoft::WRL::ComPtr<IDXGIFactory4> DXGIFactory;
@@ -23,30 +32,22 @@ Microsoft::WRL::ComPtr<ID3D12Device5> Device;
 UINT RTDescriptorIncrementSize;
 UINT DSDescriptorIncrementSize;
 Microsoft::WRL::ComPtr<ID3D12CommandQueue> DirectCommandQueue;
-std::array<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>, BACK_BUFFER_COUNT> DirectCommandAllocators;
-Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> DirectCommandList;
 std::array<Microsoft::WRL::ComPtr<ID3D12Fence>, BACK_BUFFER_COUNT> FrameFences;
 std::array<UINT64, BACK_BUFFER_COUNT> FrameFenceValues;
 HANDLE MainThreadFenceEvent;
 bool VSyncEnabled = true;
 std::unique_ptr<DescriptorHeap> CBVSRVUAVDescriptorHeap;
+Renderer::DescriptorAllocator ShaderVisibleDescriptors;
+uint32_t ImGuiDescriptorIndex = Renderer::INVALID_DESCRIPTOR_INDEX;
+
+// Frames are numbered in submission order. The queue runs them in order, so every frame up to the completed serial has finished
+uint64_t FrameSerial = 0;
+uint64_t CompletedFrameSerial = 0;
+std::array<uint64_t, BACK_BUFFER_COUNT> BackBufferFrameSerials = {};
 
 // Asset loading command objects
-Microsoft::WRL::ComPtr<ID3D12CommandQueue> GraphicsLoadCommandQueue;
-Microsoft::WRL::ComPtr<ID3D12CommandAllocator> GraphicsLoadCommandAllocator;
-Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> GraphicsLoadCommandList;
-Microsoft::WRL::ComPtr<ID3D12Fence> GraphicsLoadFence;
-UINT64 GraphicsLoadFenceValue = 0;
 
 // Constant buffers
-struct PerObjectConstants
-{
-    glm::mat4 WorldMatrix = glm::identity<glm::mat4>();
-    glm::vec4 Color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
-    glm::mat4 NormalMatrix = glm::identity<glm::mat4>();
-    uint32_t Lit = true;
-};
-
 struct PerFrameConstants
 {
     glm::mat4 LightMatrix = glm::identity<glm::mat4>();
@@ -67,21 +68,88 @@ struct MaterialConstants
     glm::vec4 Colors[Renderer::MAX_MATERIAL_COUNT];
 };
 
-Microsoft::WRL::ComPtr<ID3D12Resource> PerFrameConstantBuffer;
-uint8_t* MappedPerFrameConstantBufferLocation;
+// Constants and instance data are written to upload memory allocated each frame, retired once the frame's fence is reached
+Renderer::UploadAllocator FrameUploadAllocator;
+// Mesh buffers, acceleration structures and textures are sub-allocated from pools instead of being committed resources each
+Renderer::GpuMemoryAllocator MemoryAllocator;
+// Mesh data is copied through a staging ring on a copy queue, batched per frame
+Renderer::UploadQueue MeshUploadQueue;
+// Acceleration structures are built on a compute queue and compacted once built
+Renderer::AccelerationStructureBuilder AccelerationStructureBuilds;
+// Graphics pipelines are loaded from the pipeline library written by the last run when their shaders and state are unchanged
+Renderer::PipelineCache GraphicsPipelines;
+D3D12_GPU_VIRTUAL_ADDRESS PerFrameConstantsAddress = 0;
+std::array<D3D12_GPU_VIRTUAL_ADDRESS, MAX_PASS_COUNT> PerPassConstantsAddresses = {};
+D3D12_GPU_VIRTUAL_ADDRESS MaterialConstantsAddress = 0;
 
-Microsoft::WRL::ComPtr<ID3D12Resource> PerObjectConstantBuffer;
-uint8_t* MappedPerObjectConstantBufferLocation;
+// Rendering
+size_t FrameIndex = 0;
 
-Microsoft::WRL::ComPtr<ID3D12Resource> PerPassConstantBuffer;
-uint8_t* MappedPerPassConstantBufferLocation;
+// Graphics state last bound on a context's command list, bindings matching it are skipped.
+// Root parameters hold the bound GPU address or descriptor handle, zero when unset
+struct BoundGraphicsState
+{
+    Renderer::GraphicsPipelineBase* pPipeline = nullptr;
+    D3D12_VERTEX_BUFFER_VIEW VertexBufferView = {};
+    D3D12_INDEX_BUFFER_VIEW IndexBufferView = {};
+    std::array<UINT64, MAX_TRACKED_ROOT_PARAMETERS> RootParameters = {};
+};
 
-Microsoft::WRL::ComPtr<ID3D12Resource> MaterialConstantBuffer;
-uint8_t* MappedMaterialConstantBufferLocation;
+// State a pass sets once for all of its draws. Command lists start without state, so contexts started part way through a pass record it again
+struct PassState
+{
+    void* pDescriptorHeap = nullptr;
+    D3D12_PRIMITIVE_TOPOLOGY PrimitiveTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+    bool ViewportSet = false;
+    D3D12_VIEWPORT Viewport = {};
+    D3D12_RECT ScissorRect = {};
+    bool RenderTargetsSet = false;
+    uint64_t RenderTargetView = 0;
+    uint64_t DepthStencilView = 0;
+};
 
-// Rendering
-size_t FrameIndex = 0;
-uint32_t FrameDrawCount = 0;
+// Commands recorded by one thread, replayed into a command list of its own when the frame ends. The contexts of a frame are linked in
+// execution order. Parallel work is recorded by linking a context for each item after the current one, followed by a context the current
+// work continues in, so a context's link is only ever changed by the thread recording into it
+struct CommandContext
+{
+    Renderer::CommandStream Stream;
+    // Commands recorded to restore the pass state, a context with no others is skipped
+    uint32_t InheritedCommandCount = 0;
+    BoundGraphicsState BoundState;
+    PassState Pass;
+    CommandContext* pNext = nullptr;
+
+    // Block of frame upload memory sub-allocated without locking
+    Renderer::UploadAllocation UploadBlock = {};
+    UINT64 UploadBlockSize = 0;
+    UINT64 UploadBlockOffset = 0;
+
+    uint32_t DrawCount = 0;
+    uint32_t InstanceCount = 0;
+    uint32_t StateChangesAvoided = 0;
+    // Latest upload of a mesh drawn from the context, the frame waits for it on the GPU
+    UINT64 UploadFenceValue = 0;
+};
+
+// Contexts are pooled and reused each frame. The mutex guards the pool and the frame upload allocator
+std::vector<std::unique_ptr<CommandContext>> CommandContexts;
+size_t FrameCommandContextCount = 0;
+CommandContext* pFrameFirstCommandContext = nullptr;
+std::mutex CommandContextMutex;
+thread_local CommandContext* pCurrentCommandContext = nullptr;
+
+// A direct command list with its own allocator for each context replayed in a frame. Pools are per back buffer, so allocators are only
+// reset once the GPU has finished the frame that last used them
+struct PooledCommandList
+{
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Allocator;
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> CommandList;
+    Renderer::D3D12CommandBackend Backend;
+};
+std::array<std::vector<PooledCommandList>, BACK_BUFFER_COUNT> DirectCommandListPools;
+std::vector<CommandContext*> FrameOrderedCommandContexts;
+std::vector<ID3D12CommandList*> FrameCommandLists;
 
 // ImGui
 
@@ -184,6 +252,20 @@ bool GetAdapter(Microsoft::WRL::ComPtr<IDXGIFactory4> factory, Microsoft::WRL::C
     return true;
 }
 
+// Identifies the adapter and the version of its driver, pipeline libraries written for another are not loaded
+uint64_t CalculateAdapterKey(Microsoft::WRL::ComPtr<IDXGIAdapter4> adapter, const DXGI_ADAPTER_DESC1& adapterDesc)
+{
+    LARGE_INTEGER driverVersion = {};
+    if (FAILED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion)))
+    {
+        driverVersion.QuadPart = 0;
+    }
+
+    const uint32_t ids[] = { adapterDesc.VendorId, adapterDesc.DeviceId, adapterDesc.SubSysId, adapterDesc.Revision };
+    auto hash = Binary::HashBytes(ids, sizeof(ids));
+    return Binary::HashBytes(&driverVersion.QuadPart, sizeof(driverVersion.QuadPart), hash);
+}
+
 bool CreateDevice(Microsoft::WRL::ComPtr<IDXGIAdapter4> adapter, Microsoft::WRL::ComPtr<ID3D12Device5>& device)
 {
     auto hr = D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&device));
@@ -278,7 +360,103 @@ bool WaitForFenceToReachValue(Microsoft::WRL::ComPtr<ID3D12Fence> fence, UINT64
     return true;
 }
 
-bool Renderer::Init(const uint32_t shaderVisibleCBVSRVUAVDescriptorCount)
+// Takes a context from the pool for this frame, recording inheritedPass into it so its commands continue where that pass state left off
+CommandContext* AcquireCommandContext(const PassState& inheritedPass)
+{
+    CommandContext* pContext = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(CommandContextMutex);
+        if (FrameCommandContextCount == CommandContexts.size())
+        {
+            CommandContexts.push_back(std::make_unique<CommandContext>());
+        }
+        pContext = CommandContexts[FrameCommandContextCount++].get();
+    }
+
+    pContext->Stream.Reset();
+    pContext->BoundState = {};
+    pContext->Pass = inheritedPass;
+    pContext->pNext = nullptr;
+    pContext->UploadBlock = {};
+    pContext->UploadBlockSize = 0;
+    pContext->UploadBlockOffset = 0;
+    pContext->DrawCount = 0;
+    pContext->InstanceCount = 0;
+    pContext->StateChangesAvoided = 0;
+    pContext->UploadFenceValue = 0;
+
+    auto& stream = pContext->Stream;
+    if (inheritedPass.pDescriptorHeap)
+    {
+        stream.SetDescriptorHeap(inheritedPass.pDescriptorHeap);
+    }
+    if (inheritedPass.PrimitiveTopology != D3D_PRIMITIVE_TOPOLOGY_UNDEFINED)
+    {
+        stream.SetPrimitiveTopology(inheritedPass.PrimitiveTopology);
+    }
+    if (inheritedPass.ViewportSet)
+    {
+        const auto& viewport = inheritedPass.Viewport;
+        const auto& scissorRect = inheritedPass.ScissorRect;
+        stream.SetViewport(viewport.TopLeftX, viewport.TopLeftY, viewport.Width, viewport.Height, viewport.MinDepth, viewport.MaxDepth,
+            scissorRect.left, scissorRect.top, scissorRect.right, scissorRect.bottom);
+    }
+    if (inheritedPass.RenderTargetsSet)
+    {
+        stream.SetRenderTargets(inheritedPass.RenderTargetView, inheritedPass.DepthStencilView);
+    }
+    pContext->InheritedCommandCount = stream.GetCommandCount();
+
+    return pContext;
+}
+
+CommandContext& GetCurrentCommandContext()
+{
+    assert(pCurrentCommandContext && "Commands can only be recorded between StartFrame and EndFrame.");
+    return *pCurrentCommandContext;
+}
+
+// Allocates from the current context's block of frame upload memory, taking a new block from the shared allocator when it is full.
+// Alignment must be a power of two no larger than the block alignment
+bool AllocateContextUploadMemory(const UINT64 size, const UINT64 alignment, Renderer::UploadAllocation& outAllocation)
+{
+    assert(alignment <= CONSTANT_BUFFER_ALIGNMENT_SIZE_BYTES && "Upload alignment is larger than the context block alignment.");
+    auto& context = GetCurrentCommandContext();
+
+    // Allocations larger than a block are taken from the shared allocator directly
+    if (size > CONTEXT_UPLOAD_BLOCK_SIZE_BYTES)
+    {
+        std::lock_guard<std::mutex> lock(CommandContextMutex);
+        return FrameUploadAllocator.Allocate(size, CONSTANT_BUFFER_ALIGNMENT_SIZE_BYTES, outAllocation);
+    }
+
+    UINT64 offset = (context.UploadBlockOffset + alignment - 1) & ~(alignment - 1);
+    if (context.UploadBlock.pCPU == nullptr || offset + size > context.UploadBlockSize)
+    {
+        std::lock_guard<std::mutex> lock(CommandContextMutex);
+        if (!FrameUploadAllocator.Allocate(CONTEXT_UPLOAD_BLOCK_SIZE_BYTES, CONSTANT_BUFFER_ALIGNMENT_SIZE_BYTES, context.UploadBlock))
+        {
+            context.UploadBlock = {};
+            return false;
+        }
+        context.UploadBlockSize = CONTEXT_UPLOAD_BLOCK_SIZE_BYTES;
+        offset = 0;
+    }
+
+    outAllocation.pCPU = context.UploadBlock.pCPU + offset;
+    outAllocation.GPUAddress = context.UploadBlock.GPUAddress + offset;
+    context.UploadBlockOffset = offset + size;
+    return true;
+}
+
+bool CreatePooledCommandList(PooledCommandList& list)
+{
+    return CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, Device, list.Allocator) &&
+        CreateCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT, Device, list.Allocator, list.CommandList) &&
+        SUCCEEDED(list.CommandList->Close());
+}
+
+bool Renderer::Init(const uint32_t persistentDescriptorCount, const uint32_t frameDescriptorCount)
 {
     // Enable debug features if in debug configuration
 #ifdef _DEBUG
@@ -332,30 +510,6 @@ bool Renderer::Init(const uint32_t shaderVisibleCBVSRVUAVDescriptorCount)
         return false;
     }
 
-    // Create direct command allocators
-    for (auto& allocator : DirectCommandAllocators)
-    {
-        if (!CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, Device, allocator))
-        {
-            DEBUG_LOG("ERROR: Failed to create direct command allocator.");
-            return false;
-        }
-    }
-
-    // Create a direct command list
-    if (!CreateCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT, Device, DirectCommandAllocators[0], DirectCommandList))
-    {
-        DEBUG_LOG("ERROR: Failed to create command list");
-        return false;
-    }
-
-    // Close the command list as it will not be recording now
-    if (FAILED(DirectCommandList->Close()))
-    {
-        DEBUG_LOG("ERROR: Failed to close direct command list.");
-        return false;
-    }
-
     // Create frame fences
     for (auto& fence : FrameFences)
     {
@@ -373,172 +527,51 @@ bool Renderer::Init(const uint32_t shaderVisibleCBVSRVUAVDescriptorCount)
         return false;
     }
 
-    // Create copy resources
-    if (!CreateCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT, Device, GraphicsLoadCommandQueue))
-    {
-        DEBUG_LOG("ERROR: Failed to create graphics load command queue.");
-        return false;
-    }
-
-    if (!CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, Device, GraphicsLoadCommandAllocator))
-    {
-        DEBUG_LOG("ERROR: Failed to create graphics load command allocator.");
-        return false;
-    }
-
-    if (!CreateCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT, Device, GraphicsLoadCommandAllocator, GraphicsLoadCommandList))
-    {
-        DEBUG_LOG("ERROR: Failed to create graphics load command list.");
-        return false;
-    }
-
-    if (FAILED(GraphicsLoadCommandList->Close()))
-    {
-        DEBUG_LOG("ERROR: Failed to close graphics load command list.");
-        return false;
-    }
-
-    if (!CreateFence(Device, GraphicsLoadFenceValue, D3D12_FENCE_FLAG_NONE, GraphicsLoadFence))
-    {
-        DEBUG_LOG("ERROR: Failed to create graphics load fence.");
-        return false;
-    }
-
-    // Create per frame constant buffer
-    auto perFrameHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    auto perFrameResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(SIZE_64KB);
-
-    if (FAILED(Device->CreateCommittedResource(&perFrameHeapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &perFrameResourceDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&PerFrameConstantBuffer))))
-    {
-        DEBUG_LOG("ERROR: Failed to create per frame constant buffer.");
-        return false;
-    }
-
-    // Set a debug name for the resource
-    if (FAILED(PerFrameConstantBuffer->SetName(L"PerFrameConstantBuffer")))
-    {
-        DEBUG_LOG("ERROR: Failed to name per frame constant buffer.");
-        return false;
-    }
-
-    // Map the per frame constant buffer
-    D3D12_RANGE perFrameReadRange(0, 0);
-    void* mappedPerFrameConstantBufferResource;
-    if FAILED(PerFrameConstantBuffer->Map(0, &perFrameReadRange, &mappedPerFrameConstantBufferResource))
-    {
-        DEBUG_LOG("ERROR: Failed to map per frame constant buffer.");
-        return false;
-    }
-    MappedPerFrameConstantBufferLocation = static_cast<uint8_t*>(mappedPerFrameConstantBufferResource);
-
-    // Create per object constant buffer
-    auto perObjectHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    auto perObjectResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(SIZE_64KB * 2);
-
-    if (FAILED(Device->CreateCommittedResource(&perObjectHeapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &perObjectResourceDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&PerObjectConstantBuffer))))
-    {
-        DEBUG_LOG("ERROR: Failed to create per object constant buffer.");
-        return false;
-    }
-
-    // Set a debug name for the resource
-    if (FAILED(PerFrameConstantBuffer->SetName(L"PerObjectConstantBuffer")))
-    {
-        DEBUG_LOG("ERROR: Failed to name per object constant buffer.");
-        return false;
-    }
-
-    // Map the per object constant buffer
-    D3D12_RANGE perObjectReadRange(0, 0);
-    void* mappedPerObjectConstantBufferResource;
-    if FAILED(PerObjectConstantBuffer->Map(0, &perObjectReadRange, &mappedPerObjectConstantBufferResource))
+    // Create upload allocator for constants and instance data written each frame
+    if (!FrameUploadAllocator.Init(Device.Get()))
     {
-        DEBUG_LOG("ERROR: Failed to map per frame constant buffer.");
+        DEBUG_LOG("ERROR: Failed to initialize frame upload allocator.");
         return false;
     }
-    MappedPerObjectConstantBufferLocation = static_cast<uint8_t*>(mappedPerObjectConstantBufferResource);
 
-    // Create material buffer
-    auto materialHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    auto materialResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(SIZE_64KB);
-
-    if (FAILED(Device->CreateCommittedResource(&materialHeapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &materialResourceDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&MaterialConstantBuffer))))
-    {
-        DEBUG_LOG("ERROR: Failed to create material constant buffer.");
-        return false;
-    }
-
-    // Set a debug name for the material buffer
-    if (FAILED(MaterialConstantBuffer->SetName(L"MaterialConstantBuffer")))
+    if (!MemoryAllocator.Init(Device.Get()))
     {
-        DEBUG_LOG("ERROR: Failed to name material constant buffer.");
+        DEBUG_LOG("ERROR: Failed to initialize GPU memory allocator.");
         return false;
     }
 
-    // Map the material buffer
-    D3D12_RANGE materialReadRange(0, 0);
-    void* mappedMaterialBufferResource;
-    if FAILED(MaterialConstantBuffer->Map(0, &materialReadRange, &mappedMaterialBufferResource))
+    if (!MeshUploadQueue.Init(Device.Get()))
     {
-        DEBUG_LOG("ERROR: Failed to map material constant buffer.");
+        DEBUG_LOG("ERROR: Failed to initialize mesh upload queue.");
         return false;
     }
-    MappedMaterialConstantBufferLocation = static_cast<uint8_t*>(mappedMaterialBufferResource);
-
-    // Create per pass buffer
-    auto perPassHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    auto perPassResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(SIZE_64KB);
 
-    if (FAILED(Device->CreateCommittedResource(&perPassHeapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &perPassResourceDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&PerPassConstantBuffer))))
+    if (!AccelerationStructureBuilds.Init(Device.Get(), MemoryAllocator, MeshUploadQueue))
     {
-        DEBUG_LOG("ERROR: Failed to create per pass constant buffer.");
+        DEBUG_LOG("ERROR: Failed to initialize acceleration structure builder.");
         return false;
     }
 
-    // Set a debug name for the per pass buffer
-    if (FAILED(PerPassConstantBuffer->SetName(L"PerPassConstantBuffer")))
+    if (!GraphicsPipelines.Init(Device.Get(), CalculateAdapterKey(Adapter, AdapterDesc)))
     {
-        DEBUG_LOG("ERROR: Failed to name per pass constant buffer.");
+        DEBUG_LOG("ERROR: Failed to initialize pipeline cache.");
         return false;
     }
 
-    // Map the per pass buffer
-    D3D12_RANGE perPassReadRange(0, 0);
-    void* mappedPerPassBufferResource;
-    if FAILED(PerPassConstantBuffer->Map(0, &perPassReadRange, &mappedPerPassBufferResource))
-    {
-        DEBUG_LOG("ERROR: Failed to map material constant buffer.");
-        return false;
-    }
-    MappedPerPassConstantBufferLocation = static_cast<uint8_t*>(mappedPerPassBufferResource);
-
     // Initialize shader visible descriptor heap
+    // Persistent descriptors come first, followed by a range for each frame in flight
+    ShaderVisibleDescriptors.Init(persistentDescriptorCount, frameDescriptorCount, static_cast<uint32_t>(BACK_BUFFER_COUNT));
     CBVSRVUAVDescriptorHeap = std::make_unique<DescriptorHeap>();
     CBVSRVUAVDescriptorHeap->Init(Device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 
-        shaderVisibleCBVSRVUAVDescriptorCount, true);
+        ShaderVisibleDescriptors.GetDescriptorCount(), true);
 
     // Initialize imgui
-    assert(shaderVisibleCBVSRVUAVDescriptorCount > 0 && "At least 1 shader visible CBV SRV UAV descriptor is required for ImGui resources.");
+    ImGuiDescriptorIndex = ShaderVisibleDescriptors.AllocatePersistent();
+    if (ImGuiDescriptorIndex == INVALID_DESCRIPTOR_INDEX)
+    {
+        DEBUG_LOG("ERROR: At least 1 persistent descriptor is required for ImGui resources.");
+        return false;
+    }
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
@@ -546,8 +579,8 @@ bool Renderer::Init(const uint32_t shaderVisibleCBVSRVUAVDescriptorCount)
     ImGui_ImplWin32_Init(Window::GetHandle());
     ImGui_ImplDX12_Init(Device.Get(), BACK_BUFFER_COUNT,
         DXGI_FORMAT_R8G8B8A8_UNORM, CBVSRVUAVDescriptorHeap->Get(),
-        CBVSRVUAVDescriptorHeap->GetCPUDescriptorHandle(0),
-        CBVSRVUAVDescriptorHeap->GetGPUDescriptorHandle(0));
+        CBVSRVUAVDescriptorHeap->GetCPUDescriptorHandle(ImGuiDescriptorIndex),
+        CBVSRVUAVDescriptorHeap->GetGPUDescriptorHandle(ImGuiDescriptorIndex));
 
 	return true;
 }
@@ -560,6 +593,12 @@ bool Renderer::Shutdown()
         return false;
     }
 
+    // A library that failed to save only costs pipeline compiles on the next run
+    if (!GraphicsPipelines.Save())
+    {
+        DEBUG_LOG("Failed to save pipeline library.");
+    }
+
     // Close main thread fence event handle
     if (::CloseHandle(MainThreadFenceEvent) == 0)
     {
@@ -576,6 +615,11 @@ bool Renderer::Shutdown()
 
 bool Renderer::Flush()
 {
+    if (!MeshUploadQueue.Flush() || !AccelerationStructureBuilds.Flush())
+    {
+        return false;
+    }
+
     size_t i = 0;
     for (const auto& fence : FrameFences)
     {
@@ -592,6 +636,9 @@ bool Renderer::Flush()
         ++i;
     }
 
+    // Every submitted frame has finished
+    CompletedFrameSerial = FrameSerial;
+
     return true;
 }
 
@@ -619,7 +666,19 @@ template<>
 bool Renderer::CreateGraphicsPipeline<Renderer::GraphicsPipeline>(SwapChain* pSwapChain, std::unique_ptr<Renderer::GraphicsPipelineBase>& pipeline)
 {
     auto temp = std::make_unique<Renderer::GraphicsPipeline>();
-    if (!temp->Init(Device.Get(), pSwapChain->GetFormat()))
+    if (!temp->Init(Device.Get(), GraphicsPipelines, pSwapChain->GetFormat()))
+    {
+        return false;
+    }
+    pipeline = std::move(temp);
+    return true;
+}
+
+template<>
+bool Renderer::CreateGraphicsPipeline<Renderer::CompressedGraphicsPipeline>(SwapChain* pSwapChain, std::unique_ptr<Renderer::GraphicsPipelineBase>& pipeline)
+{
+    auto temp = std::make_unique<Renderer::CompressedGraphicsPipeline>();
+    if (!temp->Init(Device.Get(), GraphicsPipelines, pSwapChain->GetFormat()))
     {
         return false;
     }
@@ -631,7 +690,7 @@ template<>
 bool Renderer::CreateGraphicsPipeline<Renderer::ScreenPassPipeline>(SwapChain* pSwapChain, std::unique_ptr<Renderer::GraphicsPipelineBase>& pipeline)
 {
     auto temp = std::make_unique<Renderer::ScreenPassPipeline>();
-    if (!temp->Init(Device.Get(), pSwapChain->GetFormat()))
+    if (!temp->Init(Device.Get(), GraphicsPipelines, pSwapChain->GetFormat()))
     {
         return false;
     }
@@ -643,7 +702,7 @@ template<>
 bool Renderer::CreateGraphicsPipeline<Renderer::ShadowMapPassPipeline>(SwapChain* pSwapChain, std::unique_ptr<Renderer::GraphicsPipelineBase>& pipeline)
 {
     auto temp = std::make_unique<Renderer::ShadowMapPassPipeline>();
-    if (!temp->Init(Device.Get(), pSwapChain->GetFormat()))
+    if (!temp->Init(Device.Get(), GraphicsPipelines, pSwapChain->GetFormat()))
     {
         return false;
     }
@@ -651,170 +710,81 @@ bool Renderer::CreateGraphicsPipeline<Renderer::ShadowMapPassPipeline>(SwapChain
     return true;
 }
 
-void Renderer::CreateStagedMesh(const std::vector<Vertex1Pos1UV1Norm>& vertices, const std::vector<uint32_t>& indices,
-    const std::wstring& name, std::unique_ptr<Mesh>& mesh)
+void Renderer::CreateStagedMesh(std::vector<Vertex1Pos1UV1Norm>&& vertices, std::vector<uint32_t>&& indices,
+    const std::wstring& name, std::unique_ptr<Mesh>& mesh, const bool keepCPUData)
 {
-    mesh = std::make_unique<Mesh>(Device.Get(), vertices, indices, name);
+    mesh = std::make_unique<Mesh>(MemoryAllocator, std::move(vertices), std::move(indices), name, keepCPUData);
 }
 
-bool Renderer::LoadStagedMeshesOntoGPU(std::unique_ptr<Mesh>* pMeshes, const size_t meshCount)
+void Renderer::CreateStagedMesh(std::vector<CompressedVertex1Pos1UV1Norm>&& vertices, const VertexCompression::QuantizationBounds& bounds,
+    std::vector<uint32_t>&& indices, const std::wstring& name, std::unique_ptr<Mesh>& mesh, const bool keepCPUData)
 {
-    auto CreateIntermediateUploadBuffer = [](const size_t bufferSize, const void* bufferData, 
-        Microsoft::WRL::ComPtr<ID3D12Resource>& intermediateBuffer, const std::wstring& name)
-    {
-        // Create intermediate vertex upload buffer
-        auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize);
-
-        if (FAILED(Device->CreateCommittedResource(&heapProperties,
-            D3D12_HEAP_FLAG_NONE,
-            &resourceDesc,
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&intermediateBuffer)))
-            )
-        {
-            assert(false && "Failed to create intermediate mesh buffer.");
-        }
-
-        // Set a debug name for the resource
-        if (FAILED(intermediateBuffer->SetName(name.c_str())))
-        {
-            assert(false && "Failed to set name for intermediate mesh buffer.");
-        }
-
-        // Map the intermediate buffer resource
-        D3D12_RANGE readRange(0, 0);
-        void* intermediateResourceStart;
-        if (FAILED(intermediateBuffer->Map(0, &readRange, &intermediateResourceStart)))
-        {
-            assert(false && "Failed to create intermediate mesh buffer.");
-        }
-
-        // Copy data into the intermediate upload buffer
-        memcpy(intermediateResourceStart, bufferData, bufferSize);
-
-        // Unmap intermediate buffer resource
-        intermediateBuffer->Unmap(0, nullptr);
-    };
-
-    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> intermediateUploadBuffers(meshCount * 2);
-
-    // For each mesh
-    for (size_t i = 0, j = 0; i < meshCount; ++i, j += 2)
-    {
-        // Create and fill intermediate upload buffers with vertex and index data
-        // Intermediate buffers are stored next to each other for each mesh
-        // [[inter vertex buffer mesh 0][inter index buffer mesh 0][inter vertex buffer mesh 1][inter index buffer mesh 1]...]
-        auto* pMesh = pMeshes[i].get();
-        auto& intermediateVertexUploadBuffer = intermediateUploadBuffers[j];
-        auto& intermediateIndexUploadBuffer = intermediateUploadBuffers[j + 1];
-
-        CreateIntermediateUploadBuffer(pMesh->GetRequiredBufferWidthVertexBuffer(), pMesh->GetVerticesData(), 
-            intermediateVertexUploadBuffer, L"VerticesIntermediateUploadBuffer" + std::to_wstring(i));
-
-        CreateIntermediateUploadBuffer(pMesh->GetRequiredBufferWidthIndexBuffer(), pMesh->GetIndicesData(),
-            intermediateIndexUploadBuffer, L"IndexIntermediateUploadBuffer" + std::to_wstring(i));
-    }
-
-    if (FAILED(GraphicsLoadCommandAllocator->Reset()))
-    {
-        DEBUG_LOG("Failed to reset copy command allocator.");
-        return false;
-    }
+    mesh = std::make_unique<Mesh>(MemoryAllocator, std::move(vertices), bounds, std::move(indices), name, keepCPUData);
+}
 
-    if (FAILED(GraphicsLoadCommandList->Reset(GraphicsLoadCommandAllocator.Get(), nullptr)))
+bool Renderer::CreateStagedMeshFromCache(const std::string& filepath, const uint64_t sourceKey, const std::wstring& name, std::unique_ptr<Mesh>& mesh,
+    const bool keepCPUData)
+{
+    auto mappedMesh = std::make_shared<MeshCache::MappedMesh>();
+    if (!mappedMesh->Open(filepath, sourceKey))
     {
-        DEBUG_LOG("Failed to reset copy command list.");
         return false;
     }
 
-    std::vector<CD3DX12_RESOURCE_BARRIER> transitionBarriers(meshCount * 2);
+    mesh = std::make_unique<Mesh>(MemoryAllocator, std::move(mappedMesh), name, keepCPUData);
+    return true;
+}
 
-    // For each mesh
-    for (size_t i = 0, j = 0; i < meshCount; ++i, j += 2)
+bool Renderer::LoadStagedMeshesOntoGPU(std::unique_ptr<Mesh>* pMeshes, const size_t meshCount)
+{
+    // Mesh data is staged in the upload ring and copied on the upload queue with the frame's other uploads, so the CPU copies are
+    // no longer needed once staged. Mesh buffers share geometry pool buffers in the common state, which copies promote to the copy
+    // destination state and which decay back once the copies complete, so no barriers are recorded that would affect other meshes
+    for (size_t i = 0; i < meshCount; ++i)
     {
         auto* pMesh = pMeshes[i].get();
-        auto* pMeshVertexBuffer = pMesh->GetVertexBuffer();
-        auto* pMeshIndexBuffer = pMesh->GetIndexBuffer();
-
-        GraphicsLoadCommandList->CopyResource(pMeshVertexBuffer, intermediateUploadBuffers[j].Get());
-        GraphicsLoadCommandList->CopyResource(pMeshIndexBuffer, intermediateUploadBuffers[j + 1].Get());
-
-        transitionBarriers[j] = CD3DX12_RESOURCE_BARRIER::Transition(pMeshVertexBuffer,
-            D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
-        transitionBarriers[j + 1] = CD3DX12_RESOURCE_BARRIER::Transition(pMeshIndexBuffer,
-            D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER);
-    }
+        assert(pMesh->HasCPUData() && "Mesh CPU data was released, meshes can only be loaded onto the GPU once.");
 
-    GraphicsLoadCommandList->ResourceBarrier(static_cast<UINT>(transitionBarriers.size()), transitionBarriers.data());
+        UploadTicket ticket;
+        if (!MeshUploadQueue.UploadBuffer(pMesh->GetVertexBuffer(), pMesh->GetVertexBufferOffset(), pMesh->GetVerticesData(),
+                pMesh->GetRequiredBufferWidthVertexBuffer(), ticket) ||
+            !MeshUploadQueue.UploadBuffer(pMesh->GetIndexBuffer(), pMesh->GetIndexBufferOffset(), pMesh->GetIndicesData(),
+                pMesh->GetRequiredBufferWidthIndexBuffer(), ticket))
+        {
+            DEBUG_LOG("ERROR: Failed to upload mesh " + std::to_string(i) + ".");
+            return false;
+        }
+        pMesh->SetUploadTicket(ticket);
 
-    if (FAILED(GraphicsLoadCommandList->Close()))
-    {
-        return false;
+        auto residentBytesBefore = pMesh->GetResidentCPUBytes();
+        if (!pMesh->KeepsCPUData())
+        {
+            pMesh->ReleaseCPUData();
+        }
+        DEBUG_LOG("Mesh " + std::to_string(i) + " resident CPU bytes: " + std::to_string(residentBytesBefore) +
+            " -> " + std::to_string(pMesh->GetResidentCPUBytes()));
     }
+    return true;
+}
 
-    ID3D12CommandList* commandLists[] = { GraphicsLoadCommandList.Get() };
-    GraphicsLoadCommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
-
-    ++GraphicsLoadFenceValue;
-    if (FAILED(GraphicsLoadCommandQueue->Signal(GraphicsLoadFence.Get(), GraphicsLoadFenceValue)))
-    {
-        return false;
-    }
+bool Renderer::IsUploadComplete(const UploadTicket ticket)
+{
+    return MeshUploadQueue.IsComplete(ticket);
+}
 
-    // Wait on CPU for graphics load queue to finish
-    return WaitForFenceToReachValue(GraphicsLoadFence, GraphicsLoadFenceValue, MainThreadFenceEvent,
-        static_cast<DWORD>(std::chrono::milliseconds::max().count()));
+bool Renderer::WaitForUpload(const UploadTicket ticket)
+{
+    return MeshUploadQueue.Wait(ticket);
 }
 
 void Renderer::CreateBottomLevelAccelerationStructure(Mesh& mesh, std::unique_ptr<BottomLevelAccelerationStructure>& blas)
 {
-    blas = std::make_unique<BottomLevelAccelerationStructure>(Device.Get(), mesh);
+    blas = std::make_unique<BottomLevelAccelerationStructure>(Device.Get(), MemoryAllocator, mesh);
 }
 
 bool Renderer::BuildBottomLevelAccelerationStructures(std::unique_ptr<BottomLevelAccelerationStructure>* pStructures, const size_t structureCount)
 {
-    if (FAILED(GraphicsLoadCommandAllocator->Reset()))
-    {
-        DEBUG_LOG("Failed to reset copy command allocator.");
-        return false;
-    }
-
-    if (FAILED(GraphicsLoadCommandList->Reset(GraphicsLoadCommandAllocator.Get(), nullptr)))
-    {
-        DEBUG_LOG("Failed to reset copy command list.");
-        return false;
-    }
-
-    std::vector<D3D12_RESOURCE_BARRIER> barriers(structureCount);
-
-    for (size_t i = 0; i < structureCount; ++i)
-    {
-        auto& structure = pStructures[i];
-        GraphicsLoadCommandList->BuildRaytracingAccelerationStructure(&structure->GetBuildDesc(), 0, nullptr);
-        barriers[i] = CD3DX12_RESOURCE_BARRIER::UAV(structure->GetBlas());
-    }
-
-    GraphicsLoadCommandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
-
-    if (FAILED(GraphicsLoadCommandList->Close()))
-    {
-        return false;
-    }
-
-    ID3D12CommandList* commandLists[] = { GraphicsLoadCommandList.Get() };
-    GraphicsLoadCommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
-
-    ++GraphicsLoadFenceValue;
-    if (FAILED(GraphicsLoadCommandQueue->Signal(GraphicsLoadFence.Get(), GraphicsLoadFenceValue)))
-    {
-        return false;
-    }
-
-    // Wait on CPU for graphics load queue to finish
-    return WaitForFenceToReachValue(GraphicsLoadFence, GraphicsLoadFenceValue, MainThreadFenceEvent,
-        static_cast<DWORD>(std::chrono::milliseconds::max().count()));
+    return AccelerationStructureBuilds.BuildBottomLevel(pStructures, structureCount);
 }
 
 void Renderer::CreateTopLevelAccelerationStructure(std::unique_ptr<TopLevelAccelerationStructure>& tlas, const bool allowUpdate, const uint32_t instanceCount)
@@ -824,60 +794,90 @@ void Renderer::CreateTopLevelAccelerationStructure(std::unique_ptr<TopLevelAccel
 
 bool Renderer::BuildTopLevelAccelerationStructures(std::unique_ptr<TopLevelAccelerationStructure>* pStructures, const size_t structureCount)
 {
-    if (FAILED(GraphicsLoadCommandAllocator->Reset()))
-    {
-        DEBUG_LOG("Failed to reset copy command allocator.");
-        return false;
-    }
-
-    if (FAILED(GraphicsLoadCommandList->Reset(GraphicsLoadCommandAllocator.Get(), nullptr)))
-    {
-        DEBUG_LOG("Failed to reset copy command list.");
-        return false;
-    }
-
-    std::vector<D3D12_RESOURCE_BARRIER> barriers(structureCount);
-
+    // Builds are submitted when the current frame ends, or the next one when called between frames
     for (size_t i = 0; i < structureCount; ++i)
     {
-        auto& structure = pStructures[i];
-        GraphicsLoadCommandList->BuildRaytracingAccelerationStructure(&structure->GetBuildDesc(), 0, nullptr);
-        barriers[i] = CD3DX12_RESOURCE_BARRIER::UAV(structure->GetTlasResource());
+        pStructures[i]->Sync(FrameSerial + 1, CompletedFrameSerial, true);
     }
+    return AccelerationStructureBuilds.BuildTopLevel(pStructures, structureCount);
+}
 
-    GraphicsLoadCommandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+const Renderer::AccelerationStructureBuildStatistics& Renderer::GetAccelerationStructureBuildStatistics()
+{
+    return AccelerationStructureBuilds.GetStatistics();
+}
 
-    if (FAILED(GraphicsLoadCommandList->Close()))
-    {
-        return false;
-    }
+uint32_t Renderer::AllocateDescriptors(const uint32_t count)
+{
+    return ShaderVisibleDescriptors.AllocatePersistent(count);
+}
 
-    ID3D12CommandList* commandLists[] = { GraphicsLoadCommandList.Get() };
-    GraphicsLoadCommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+void Renderer::FreeDescriptors(const uint32_t descriptorIndex, const uint32_t count)
+{
+    assert(descriptorIndex != ImGuiDescriptorIndex && "The ImGui descriptor is owned by the renderer.");
+    ShaderVisibleDescriptors.FreePersistent(descriptorIndex, count, FrameSerial);
+}
 
-    ++GraphicsLoadFenceValue;
-    if (FAILED(GraphicsLoadCommandQueue->Signal(GraphicsLoadFence.Get(), GraphicsLoadFenceValue)))
-    {
-        return false;
-    }
+uint32_t Renderer::AllocateFrameDescriptors(const uint32_t count)
+{
+    return ShaderVisibleDescriptors.AllocateTransient(count);
+}
 
-    // Wait on CPU for graphics load queue to finish
-    return WaitForFenceToReachValue(GraphicsLoadFence, GraphicsLoadFenceValue, MainThreadFenceEvent,
-        static_cast<DWORD>(std::chrono::milliseconds::max().count()));
+const Renderer::PipelineCacheStatistics& Renderer::GetPipelineCacheStatistics()
+{
+    return GraphicsPipelines.GetStatistics();
+}
+
+Renderer::DescriptorAllocatorStatistics Renderer::GetDescriptorStatistics()
+{
+    return ShaderVisibleDescriptors.GetStatistics();
 }
 
 void Renderer::AddSRVDescriptorToShaderVisibleHeap(ID3D12Resource* pResource, const D3D12_SHADER_RESOURCE_VIEW_DESC* pDesc, const uint32_t descriptorIndex)
 {
-    assert(descriptorIndex != 0 && "Descriptor index 0 is occupied by ImGui resources in CBV SRV UAV descriptor heap. Use another index.");
+    assert(descriptorIndex < ShaderVisibleDescriptors.GetDescriptorCount() && descriptorIndex != ImGuiDescriptorIndex &&
+        "Descriptor index must be allocated from the shader visible heap.");
     Device->CreateShaderResourceView(pResource, pDesc, CBVSRVUAVDescriptorHeap->GetCPUDescriptorHandle(descriptorIndex));
 }
 
 void Renderer::AddUAVDescriptorToShaderVisibleHeap(ID3D12Resource* pResource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* pDesc, const uint32_t descriptorIndex)
 {
-    assert(descriptorIndex != 0 && "Descriptor index 0 is occupied by ImGui resources in CBV SRV UAV descriptor heap. Use another index.");
+    assert(descriptorIndex < ShaderVisibleDescriptors.GetDescriptorCount() && descriptorIndex != ImGuiDescriptorIndex &&
+        "Descriptor index must be allocated from the shader visible heap.");
     Device->CreateUnorderedAccessView(pResource, nullptr, pDesc, CBVSRVUAVDescriptorHeap->GetCPUDescriptorHandle(descriptorIndex));
 }
 
+glm::mat4 Renderer::CalculateProjectionMatrix(const Camera& camera, const glm::vec2& viewportDims)
+{
+    switch (camera.Settings.ProjectionMode)
+    {
+    case Camera::CameraSettings::ProjectionMode::ORTHOGRAPHIC:
+        return Math::CalculateOrthographicProjectionMatrix(camera.Settings.OrthographicWidth,
+            camera.Settings.OrthographicHeight,
+            camera.Settings.OrthographicNearClipPlane,
+            camera.Settings.OrthographicFarClipPlane);
+
+    case Camera::CameraSettings::ProjectionMode::PERSPECTIVE:
+    default:
+        return Math::CalculatePerspectiveProjectionMatrix(camera.Settings.PerspectiveFOV,
+            viewportDims.x,
+            viewportDims.y,
+            camera.Settings.PerspectiveNearClipPlane,
+            camera.Settings.PerspectiveFarClipPlane);
+    }
+}
+
+glm::mat4 Renderer::CalculateLightMatrix(const glm::vec3& lightDirectionWS)
+{
+    auto lightPosition = glm::normalize(lightDirectionWS) * 7.0f;
+    lightPosition.x = -lightPosition.x;
+    lightPosition.y = -lightPosition.y;
+    return Math::CalculateOrthographicProjectionMatrix(10.0f, 10.0f, -10.0f, 10.0f) *
+        Math::CalculateViewMatrix(
+            lightPosition,
+            Math::FindLookAtRotation(lightPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+}
+
 UINT Renderer::GetRTDescriptorIncrementSize()
 {
     return RTDescriptorIncrementSize;
@@ -898,6 +898,33 @@ void Renderer::SetVSyncEnabled(const bool enabled)
     VSyncEnabled = enabled;
 }
 
+// Sums a count over the contexts recorded this frame
+template<typename T>
+T SumFrameCommandContexts(T CommandContext::* pCount)
+{
+    T sum = 0;
+    for (size_t i = 0; i < FrameCommandContextCount; ++i)
+    {
+        sum += (*CommandContexts[i]).*pCount;
+    }
+    return sum;
+}
+
+uint32_t Renderer::GetFrameDrawCount()
+{
+    return SumFrameCommandContexts(&CommandContext::DrawCount);
+}
+
+uint32_t Renderer::GetFrameInstanceCount()
+{
+    return SumFrameCommandContexts(&CommandContext::InstanceCount);
+}
+
+uint32_t Renderer::GetFrameStateChangesAvoided()
+{
+    return SumFrameCommandContexts(&CommandContext::StateChangesAvoided);
+}
+
 const DescriptorHeap* Renderer::GetShaderVisibleDescriptorHeap()
 {
     return CBVSRVUAVDescriptorHeap.get();
@@ -905,27 +932,46 @@ const DescriptorHeap* Renderer::GetShaderVisibleDescriptorHeap()
 
 D3D12_GPU_VIRTUAL_ADDRESS Renderer::GetPerFrameConstantBufferGPUVirtualAddress()
 {
-    return PerFrameConstantBuffer->GetGPUVirtualAddress();
+    assert(PerFrameConstantsAddress != 0 && "Per frame constants have not been updated this frame.");
+    return PerFrameConstantsAddress;
 }
 
-D3D12_GPU_VIRTUAL_ADDRESS Renderer::GetPerObjectConstantBufferGPUVirtualAddress()
+D3D12_GPU_VIRTUAL_ADDRESS Renderer::GetPerPassConstantBufferGPUVirtualAddress(const uint32_t passIndex)
 {
-    return PerObjectConstantBuffer->GetGPUVirtualAddress();
+    assert(passIndex < MAX_PASS_COUNT && PerPassConstantsAddresses[passIndex] != 0 && "Per pass constants have not been updated this frame.");
+    return PerPassConstantsAddresses[passIndex];
 }
 
-D3D12_GPU_VIRTUAL_ADDRESS Renderer::GetPerPassConstantBufferGPUVirtualAddress()
+D3D12_GPU_VIRTUAL_ADDRESS Renderer::GetMaterialConstantBufferGPUVirtualAddress()
 {
-    return PerPassConstantBuffer->GetGPUVirtualAddress();
+    assert(MaterialConstantsAddress != 0 && "Material constants have not been updated this frame.");
+    return MaterialConstantsAddress;
 }
 
-D3D12_GPU_VIRTUAL_ADDRESS Renderer::GetMaterialConstantBufferGPUVirtualAddress()
+bool Renderer::AllocateFrameUploadMemory(const UINT64 size, const UINT64 alignment, UploadAllocation& outAllocation)
+{
+    return AllocateContextUploadMemory(size, alignment, outAllocation);
+}
+
+UINT64 Renderer::GetFrameUploadBytes()
 {
-    return MaterialConstantBuffer->GetGPUVirtualAddress();
+    return FrameUploadAllocator.GetFrameAllocatedBytes();
 }
 
-UINT64 Renderer::GetConstantBufferAllignmentSize()
+bool Renderer::CreateTexture(const D3D12_RESOURCE_DESC& desc, const D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* pClearValue,
+    GpuTextureAllocation& outTexture)
 {
-    return CONSTANT_BUFFER_ALIGNMENT_SIZE_BYTES;
+    return MemoryAllocator.CreateTexture(desc, initialState, pClearValue, outTexture);
+}
+
+void Renderer::FreeTexture(GpuTextureAllocation& texture)
+{
+    MemoryAllocator.Free(texture);
+}
+
+Renderer::GpuMemoryPoolStatistics Renderer::GetGpuMemoryStatistics(const GpuMemoryPool pool)
+{
+    return MemoryAllocator.GetStatistics(pool);
 }
 
 ID3D12Device5* Renderer::GetDevice()
@@ -938,7 +984,6 @@ bool Renderer::Commands::StartFrame(SwapChain* pSwapChain)
 {
     // Get current frame resources
     FrameIndex = pSwapChain->GetCurrentBackBufferIndex();
-    auto* pCurrentFrameCommandAllocator = DirectCommandAllocators[FrameIndex].Get();
     auto& frameFenceValue = FrameFenceValues[FrameIndex];
 
     // Wait for previous frame
@@ -951,23 +996,34 @@ bool Renderer::Commands::StartFrame(SwapChain* pSwapChain)
     // Increment frame fence value for the next frame
     ++frameFenceValue;
 
-    // Reset command recording objects
-    if (FAILED(pCurrentFrameCommandAllocator->Reset()))
+    // The frame that last used this back buffer has finished, descriptors freed before it and its transient range can be reused
+    CompletedFrameSerial = std::max(CompletedFrameSerial, BackBufferFrameSerials[FrameIndex]);
+    BackBufferFrameSerials[FrameIndex] = ++FrameSerial;
+    ShaderVisibleDescriptors.BeginFrame(static_cast<uint32_t>(FrameIndex), CompletedFrameSerial);
+    MemoryAllocator.BeginFrame(FrameSerial, CompletedFrameSerial);
+    if (!AccelerationStructureBuilds.Update())
     {
+        DEBUG_LOG("ERROR: Failed to update acceleration structure builds.");
         return false;
     }
 
-    if (FAILED(DirectCommandList->Reset(pCurrentFrameCommandAllocator, nullptr)))
-    {
-        return false;
-    }
+    // Upload memory of frames the GPU has finished can be reused, constants must be written again before use this frame
+    FrameUploadAllocator.BeginFrame();
+    PerFrameConstantsAddress = 0;
+    PerPassConstantsAddresses = {};
+    MaterialConstantsAddress = 0;
+
+    // Start recording commands into the first context, contexts of the previous frame are reused
+    FrameCommandContextCount = 0;
+    pFrameFirstCommandContext = AcquireCommandContext(PassState());
+    pCurrentCommandContext = pFrameFirstCommandContext;
 
-    // Start recording commands into direct command list
     // Transition current frame render target from present state to render target state
-    auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(pSwapChain->GetBackBuffers()[FrameIndex].Get(),
-        D3D12_RESOURCE_STATE_PRESENT,
-        D3D12_RESOURCE_STATE_RENDER_TARGET);
-    DirectCommandList->ResourceBarrier(1, &barrier);
+    ResourceBarrier barrier = {};
+    barrier.pResource = pSwapChain->GetBackBuffers()[FrameIndex].Get();
+    barrier.AccessBefore = RenderGraph::AccessNone;
+    barrier.AccessAfter = RenderGraph::AccessRenderTarget;
+    pCurrentCommandContext->Stream.ResourceBarriers(&barrier, 1);
 
     return true;
 }
@@ -975,91 +1031,259 @@ bool Renderer::Commands::StartFrame(SwapChain* pSwapChain)
 bool Renderer::Commands::EndFrame(SwapChain* pSwapChain)
 {
     // Transition current frame render target from render target state to present state
-    auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(pSwapChain->GetBackBuffers()[FrameIndex].Get(),
-        D3D12_RESOURCE_STATE_RENDER_TARGET,
-        D3D12_RESOURCE_STATE_PRESENT);
-    DirectCommandList->ResourceBarrier(1, &barrier);
+    ResourceBarrier barrier = {};
+    barrier.pResource = pSwapChain->GetBackBuffers()[FrameIndex].Get();
+    barrier.AccessBefore = RenderGraph::AccessRenderTarget;
+    barrier.AccessAfter = RenderGraph::AccessNone;
+    GetCurrentCommandContext().Stream.ResourceBarriers(&barrier, 1);
+    pCurrentCommandContext = nullptr;
+
+    // Gather contexts in execution order, skipping those that only restored pass state
+    FrameOrderedCommandContexts.clear();
+    for (auto* pContext = pFrameFirstCommandContext; pContext; pContext = pContext->pNext)
+    {
+        if (pContext->Stream.GetCommandCount() > pContext->InheritedCommandCount)
+        {
+            FrameOrderedCommandContexts.push_back(pContext);
+        }
+    }
+
+    auto& pool = DirectCommandListPools[FrameIndex];
+    while (pool.size() < FrameOrderedCommandContexts.size())
+    {
+        if (!CreatePooledCommandList(pool.emplace_back()))
+        {
+            DEBUG_LOG("ERROR: Failed to create pooled direct command list.");
+            pool.pop_back();
+            return false;
+        }
+    }
+
+    // Replay each context into its own command list in parallel
+    std::atomic<bool> recorded = true;
+    TaskSystem::ParallelFor(FrameOrderedCommandContexts.size(), 1, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                auto& list = pool[i];
+                if (FAILED(list.Allocator->Reset()) || FAILED(list.CommandList->Reset(list.Allocator.Get(), nullptr)))
+                {
+                    recorded = false;
+                    continue;
+                }
+
+                list.Backend.Submit(FrameOrderedCommandContexts[i]->Stream, list.CommandList.Get());
+                if (FAILED(list.CommandList->Close()))
+                {
+                    recorded = false;
+                }
+            }
+        });
+
+    if (!recorded)
+    {
+        return false;
+    }
+
+    // Uploads staged since the last frame go out as one batch. The frame waits on the GPU for those of meshes it draws, the CPU never waits
+    UploadTicket drawnUploads;
+    for (const auto* pContext : FrameOrderedCommandContexts)
+    {
+        drawnUploads.FenceValue = std::max(drawnUploads.FenceValue, pContext->UploadFenceValue);
+    }
+    if (!MeshUploadQueue.Submit() || !MeshUploadQueue.WaitOnQueue(DirectCommandQueue.Get(), drawnUploads))
+    {
+        DEBUG_LOG("ERROR: Failed to submit mesh uploads.");
+        return false;
+    }
 
-    // Stop recording commands into direct command lists
-    if (FAILED(DirectCommandList->Close()))
+    // Acceleration structure builds go out the same way, the frame waits for them on the GPU in case it traces them
+    if (!AccelerationStructureBuilds.Submit() || !AccelerationStructureBuilds.WaitOnQueue(DirectCommandQueue.Get()))
     {
+        DEBUG_LOG("ERROR: Failed to submit acceleration structure builds.");
         return false;
     }
 
-    // Execute recorded command lists
-    ID3D12CommandList* commandListsToExecute[] = { DirectCommandList.Get() };
-    DirectCommandQueue->ExecuteCommandLists(_countof(commandListsToExecute), commandListsToExecute);
+    // Execute every list in order with a single call
+    FrameCommandLists.clear();
+    for (size_t i = 0; i < FrameOrderedCommandContexts.size(); ++i)
+    {
+        FrameCommandLists.push_back(pool[i].CommandList.Get());
+    }
+    DirectCommandQueue->ExecuteCommandLists(static_cast<UINT>(FrameCommandLists.size()), FrameCommandLists.data());
 
-    FrameDrawCount = 0;
+    // Upload memory written this frame is reused once the GPU reaches the frame's fence value
+    FrameUploadAllocator.EndFrame(FrameFences[FrameIndex].Get(), FrameFenceValues[FrameIndex]);
 
     return SUCCEEDED(DirectCommandQueue->Signal(FrameFences[FrameIndex].Get(), FrameFenceValues[FrameIndex]));
 }
 
-void Renderer::Commands::ClearRenderTargets(SwapChain* pSwapChain, bool depthOnly, const CD3DX12_CPU_DESCRIPTOR_HANDLE& depthTargetDescriptorHandle)
+void Renderer::Commands::SetRenderTargets(const D3D12_CPU_DESCRIPTOR_HANDLE* pRenderTargetView, const D3D12_CPU_DESCRIPTOR_HANDLE* pDepthStencilView)
+{
+    auto& context = GetCurrentCommandContext();
+    context.Pass.RenderTargetsSet = true;
+    context.Pass.RenderTargetView = pRenderTargetView ? pRenderTargetView->ptr : 0;
+    context.Pass.DepthStencilView = pDepthStencilView ? pDepthStencilView->ptr : 0;
+    context.Stream.SetRenderTargets(context.Pass.RenderTargetView, context.Pass.DepthStencilView);
+}
+
+void Renderer::Commands::ClearRenderTarget(const D3D12_CPU_DESCRIPTOR_HANDLE& renderTargetView)
+{
+    GetCurrentCommandContext().Stream.ClearRenderTarget(renderTargetView.ptr, CLEAR_COLOR);
+}
+
+void Renderer::Commands::ClearDepthStencil(const D3D12_CPU_DESCRIPTOR_HANDLE& depthStencilView)
+{
+    GetCurrentCommandContext().Stream.ClearDepthStencil(depthStencilView.ptr, 1.0f);
+}
+
+// Records render graph barriers into the current context with the graph's resources resolved to their D3D12 resources
+void RecordRenderGraphBarriers(const Renderer::RenderGraph& graph, const Renderer::RenderGraphResources& resources, const std::vector<Renderer::RenderGraph::Barrier>& graphBarriers)
 {
-    if (depthOnly)
+    if (graphBarriers.empty())
     {
-        DirectCommandList->ClearDepthStencilView(depthTargetDescriptorHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+        return;
     }
-    else
+
+    std::vector<Renderer::ResourceBarrier> barriers(graphBarriers.size());
+    for (size_t i = 0; i < graphBarriers.size(); ++i)
     {
-        auto rtvHandle = pSwapChain->GetRTDescriptorHandleForFrame(FrameIndex);
-        DirectCommandList->ClearRenderTargetView(rtvHandle, CLEAR_COLOR, 0, nullptr);
-        DirectCommandList->ClearDepthStencilView(depthTargetDescriptorHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+        const auto& barrier = graphBarriers[i];
+        barriers[i].BarrierType = barrier.BarrierType;
+        barriers[i].AccessBefore = barrier.AccessBefore;
+        barriers[i].AccessAfter = barrier.AccessAfter;
+        barriers[i].pResource = resources.GetResource(graph, barrier.Resource);
+        barriers[i].pResourceBefore = barrier.ResourceBefore != Renderer::RenderGraph::InvalidHandle ? resources.GetResource(graph, barrier.ResourceBefore) : nullptr;
     }
+    GetCurrentCommandContext().Stream.ResourceBarriers(barriers.data(), static_cast<uint32_t>(barriers.size()));
 }
 
-void Renderer::Commands::SetBackBufferRenderTargets(SwapChain* pSwapChain, bool depthOnly, const CD3DX12_CPU_DESCRIPTOR_HANDLE& depthTargetDescriptorHandle)
+void Renderer::Commands::ExecuteRenderGraph(const RenderGraph& graph, const RenderGraphResources& resources)
 {
-    if (depthOnly)
+    std::vector<RenderGraph::PassHandle> passes;
+    for (RenderGraph::PassHandle pass = 0; pass < graph.GetPassCount(); ++pass)
     {
-        DirectCommandList->OMSetRenderTargets(0, nullptr, FALSE, &depthTargetDescriptorHandle);
+        if (!graph.IsPassCulled(pass))
+        {
+            passes.push_back(pass);
+        }
     }
-    else
+
+    // Each pass records its barriers and commands into its own context, the final barriers follow them
+    RecordParallel(static_cast<uint32_t>(passes.size()), [&](const uint32_t index)
+        {
+            RecordRenderGraphBarriers(graph, resources, graph.GetPassBarriers(passes[index]));
+            graph.ExecutePass(passes[index]);
+        });
+    RecordRenderGraphBarriers(graph, resources, graph.GetFinalBarriers());
+}
+
+void Renderer::Commands::RecordParallel(const uint32_t itemCount, const std::function<void(uint32_t)>& recordItem)
+{
+    if (itemCount <= 1)
+    {
+        if (itemCount == 1)
+        {
+            recordItem(0);
+        }
+        return;
+    }
+
+    // Link a context for each item after the current one, then a context to continue recording in
+    CommandContext* pParent = &GetCurrentCommandContext();
+    CommandContext* pFollowing = pParent->pNext;
+    std::vector<CommandContext*> itemContexts(itemCount);
+    CommandContext* pPrevious = pParent;
+    for (auto& pContext : itemContexts)
     {
-        auto rtvHandle = pSwapChain->GetRTDescriptorHandleForFrame(FrameIndex);
-        DirectCommandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &depthTargetDescriptorHandle);
+        pContext = AcquireCommandContext(pParent->Pass);
+        pPrevious->pNext = pContext;
+        pPrevious = pContext;
     }
+    CommandContext* pContinuation = AcquireCommandContext(pParent->Pass);
+    pPrevious->pNext = pContinuation;
+    pContinuation->pNext = pFollowing;
+
+    TaskSystem::ParallelFor(itemCount, 1, [&](size_t begin, size_t end)
+        {
+            // Threads waiting on nested work may run these items, so their own context is restored after
+            CommandContext* pThreadContext = pCurrentCommandContext;
+            for (size_t i = begin; i < end; ++i)
+            {
+                pCurrentCommandContext = itemContexts[i];
+                recordItem(static_cast<uint32_t>(i));
+            }
+            pCurrentCommandContext = pThreadContext;
+        });
+
+    pCurrentCommandContext = pContinuation;
 }
 
 void Renderer::Commands::SetPrimitiveTopology()
 {
-    DirectCommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    auto& context = GetCurrentCommandContext();
+    context.Pass.PrimitiveTopology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+    context.Stream.SetPrimitiveTopology(context.Pass.PrimitiveTopology);
 }
 
 void Renderer::Commands::SetViewport(SwapChain* pSwapChain)
 {
-    DirectCommandList->RSSetViewports(1, &pSwapChain->GetViewport());
-    DirectCommandList->RSSetScissorRects(1, &pSwapChain->GetScissorRect());
+    SetViewport(pSwapChain->GetViewport(), pSwapChain->GetScissorRect());
 }
 
 void Renderer::Commands::SetViewport(const D3D12_VIEWPORT& viewport, const D3D12_RECT& scissorRect)
 {
-    DirectCommandList->RSSetViewports(1, &viewport);
-    DirectCommandList->RSSetScissorRects(1, &scissorRect);
+    auto& context = GetCurrentCommandContext();
+    context.Pass.ViewportSet = true;
+    context.Pass.Viewport = viewport;
+    context.Pass.ScissorRect = scissorRect;
+    context.Stream.SetViewport(viewport.TopLeftX, viewport.TopLeftY, viewport.Width, viewport.Height, viewport.MinDepth, viewport.MaxDepth,
+        scissorRect.left, scissorRect.top, scissorRect.right, scissorRect.bottom);
 }
 
 void Renderer::Commands::SetGraphicsPipeline(GraphicsPipelineBase* pPipeline)
 {
-    DirectCommandList->SetPipelineState(pPipeline->GetPipelineState());
-    DirectCommandList->SetGraphicsRootSignature(pPipeline->GetRootSignature());
+    auto& context = GetCurrentCommandContext();
+    if (context.BoundState.pPipeline == pPipeline)
+    {
+        ++context.StateChangesAvoided;
+        return;
+    }
+
+    context.Stream.SetGraphicsPipeline(pPipeline->GetPipelineState(), pPipeline->GetRootSignature());
+
+    // Setting a root signature leaves previously set root parameters undefined
+    context.BoundState.pPipeline = pPipeline;
+    context.BoundState.RootParameters = {};
 }
 
-void Renderer::Commands::UpdatePerFrameConstants(const std::vector<Transform>& probeTransformsWS, const glm::vec3& lightDirectionWS, const float lightIntensity, const float probeSpacing)
+// Copies constants into this frame's upload memory and returns their GPU address
+D3D12_GPU_VIRTUAL_ADDRESS WriteFrameConstants(const void* pConstants, const size_t size)
+{
+    Renderer::UploadAllocation allocation = {};
+    if (!AllocateContextUploadMemory(size, CONSTANT_BUFFER_ALIGNMENT_SIZE_BYTES, allocation))
+    {
+        assert(false && "Failed to allocate frame constants.");
+        return 0;
+    }
+
+    memcpy(allocation.pCPU, pConstants, size);
+    return allocation.GPUAddress;
+}
+
+void Renderer::Commands::UpdatePerFrameConstants(const TransformStorage& probeTransformsWS, const glm::vec3& lightDirectionWS, const float lightIntensity, const float probeSpacing)
 {
     PerFrameConstants perFrameConstants = {};
 
     // Update probe position
-    assert(probeTransformsWS.size() <= Renderer::MAX_PROBE_COUNT && "Attempting to use more probes than the max probe count.");
-    size_t index = 0;
-    for (const auto& transform : probeTransformsWS)
+    assert(probeTransformsWS.GetCount() <= Renderer::MAX_PROBE_COUNT && "Attempting to use more probes than the max probe count.");
+    for (uint32_t index = 0; index < probeTransformsWS.GetCount(); ++index)
     {
-        perFrameConstants.ProbePositionsWS[index] = glm::vec4(transform.Position.x, transform.Position.y, transform.Position.z, 1.0f);
-        ++index;
+        perFrameConstants.ProbePositionsWS[index] = glm::vec4(probeTransformsWS.GetPosition(index), 1.0f);
     }
 
     // Update probe count, spacing and light intensity
-    perFrameConstants.PackedData.x = static_cast<float>(probeTransformsWS.size());
+    perFrameConstants.PackedData.x = static_cast<float>(probeTransformsWS.GetCount());
     perFrameConstants.PackedData.y = probeSpacing;
     perFrameConstants.PackedData.z = lightIntensity;
 
@@ -1070,15 +1294,9 @@ void Renderer::Commands::UpdatePerFrameConstants(const std::vector<Transform>& p
     perFrameConstants.LightDirectionWS.w = 1.0f;
 
     // Update light matrix
-    auto lightPosition = glm::normalize(lightDirectionWS) * 7.0f;
-    lightPosition.x = -lightPosition.x;
-    lightPosition.y = -lightPosition.y;
-    perFrameConstants.LightMatrix = Math::CalculateOrthographicProjectionMatrix(10.0f, 10.0f, -10.0f, 10.0f) *
-        Math::CalculateViewMatrix(
-            lightPosition,
-            Math::FindLookAtRotation(lightPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+    perFrameConstants.LightMatrix = CalculateLightMatrix(lightDirectionWS);
 
-    memcpy(MappedPerFrameConstantBufferLocation, &perFrameConstants, sizeof(PerFrameConstants));
+    PerFrameConstantsAddress = WriteFrameConstants(&perFrameConstants, sizeof(PerFrameConstants));
 }
 
 void Renderer::Commands::UpdatePerPassConstants(const uint32_t passIndex, const glm::vec2& viewportDims, const Camera& camera)
@@ -1089,30 +1307,13 @@ void Renderer::Commands::UpdatePerPassConstants(const uint32_t passIndex, const
     perPassConstants.ViewMatrix = Math::CalculateViewMatrix(camera.Position, camera.Rotation);
 
     // Calculate pass projection matrix
-    switch (camera.Settings.ProjectionMode)
-    {
-    case Camera::CameraSettings::ProjectionMode::PERSPECTIVE:
-        perPassConstants.ProjectionMatrix = Math::CalculatePerspectiveProjectionMatrix(camera.Settings.PerspectiveFOV,
-            viewportDims.x,
-            viewportDims.y,
-            camera.Settings.PerspectiveNearClipPlane,
-            camera.Settings.PerspectiveFarClipPlane);
-        break;
-
-    case Camera::CameraSettings::ProjectionMode::ORTHOGRAPHIC:
-        perPassConstants.ProjectionMatrix = Math::CalculateOrthographicProjectionMatrix(camera.Settings.OrthographicWidth,
-            camera.Settings.OrthographicHeight,
-            camera.Settings.OrthographicNearClipPlane,
-            camera.Settings.OrthographicFarClipPlane);
-        break;
-    }
+    perPassConstants.ProjectionMatrix = CalculateProjectionMatrix(camera, viewportDims);
 
     // Update camera world space position
     perPassConstants.CameraPositionWS = glm::vec4(camera.Position.x, camera.Position.y, camera.Position.z, 1.0f);
 
-    assert(passIndex < 256 && "Unsupported pass index is being used in an UpdatePerPassConstants call.");
-    auto bufferOffset = passIndex * CONSTANT_BUFFER_ALIGNMENT_SIZE_BYTES;
-    memcpy(MappedPerPassConstantBufferLocation + bufferOffset, &perPassConstants, sizeof(PerPassConstants));
+    assert(passIndex < MAX_PASS_COUNT && "Unsupported pass index is being used in an UpdatePerPassConstants call.");
+    PerPassConstantsAddresses[passIndex] = WriteFrameConstants(&perPassConstants, sizeof(PerPassConstants));
 }
 
 void Renderer::Commands::UpdateMaterialConstants(const Renderer::Material* pMaterials, const uint32_t materialCount)
@@ -1127,156 +1328,269 @@ void Renderer::Commands::UpdateMaterialConstants(const Renderer::Material* pMate
         materialConstants.Colors[i] = pMaterials[i].GetColor();
     }
 
-    memcpy(MappedMaterialConstantBufferLocation, &materialConstants, sizeof(MaterialConstants));
+    MaterialConstantsAddress = WriteFrameConstants(&materialConstants, sizeof(MaterialConstants));
 }
 
-void Renderer::Commands::SubmitMesh(UINT perObjectConstantsParameterIndex, const Mesh& mesh, const Transform& transform, const glm::vec4& color, const bool lit)
+// Returns false and counts the avoided change when the root parameter already holds the value
+bool UpdateBoundRootParameter(UINT rootParameterIndex, const UINT64 value)
 {
-    // Update per object constant buffer
-    PerObjectConstants perObjectConstants = {};
-    perObjectConstants.WorldMatrix = Math::CalculateWorldMatrix(transform);
-    perObjectConstants.Color = color;
-    perObjectConstants.Lit = lit;
-
-    glm::mat3 worldMatrix3x3 = perObjectConstants.WorldMatrix;
-    perObjectConstants.NormalMatrix = glm::inverse(glm::transpose(worldMatrix3x3));
-
-    auto objectConstantBufferOffset = FrameDrawCount * CONSTANT_BUFFER_ALIGNMENT_SIZE_BYTES;
-    memcpy(MappedPerObjectConstantBufferLocation + objectConstantBufferOffset, &perObjectConstants, sizeof(PerObjectConstants));
+    if (rootParameterIndex >= MAX_TRACKED_ROOT_PARAMETERS)
+    {
+        return true;
+    }
 
-    DirectCommandList->SetGraphicsRootConstantBufferView(perObjectConstantsParameterIndex, PerObjectConstantBuffer->GetGPUVirtualAddress() + objectConstantBufferOffset);
-    DirectCommandList->IASetVertexBuffers(0, 1, &mesh.GetVertexBufferView());
-    DirectCommandList->IASetIndexBuffer(&mesh.GetIndexBufferView());
-    DirectCommandList->DrawIndexedInstanced(mesh.GetIndexCount(), 1, 0, 0, 0);
+    auto& context = GetCurrentCommandContext();
+    if (context.BoundState.RootParameters[rootParameterIndex] == value)
+    {
+        ++context.StateChangesAvoided;
+        return false;
+    }
 
-    ++FrameDrawCount;
+    context.BoundState.RootParameters[rootParameterIndex] = value;
+    return true;
 }
 
-void Renderer::Commands::SubmitScreenMesh(const Mesh& mesh)
+void SetMeshBuffers(const Renderer::Mesh& mesh)
 {
-    DirectCommandList->IASetVertexBuffers(0, 1, &mesh.GetVertexBufferView());
-    DirectCommandList->IASetIndexBuffer(&mesh.GetIndexBufferView());
-    DirectCommandList->DrawIndexedInstanced(mesh.GetIndexCount(), 1, 0, 0, 0);
+    auto& context = GetCurrentCommandContext();
+    auto& boundState = context.BoundState;
+    context.UploadFenceValue = std::max(context.UploadFenceValue, mesh.GetUploadTicket().FenceValue);
+
+    const auto& vertexBufferView = mesh.GetVertexBufferView();
+    if (boundState.VertexBufferView.BufferLocation == vertexBufferView.BufferLocation &&
+        boundState.VertexBufferView.SizeInBytes == vertexBufferView.SizeInBytes &&
+        boundState.VertexBufferView.StrideInBytes == vertexBufferView.StrideInBytes)
+    {
+        ++context.StateChangesAvoided;
+    }
+    else
+    {
+        context.Stream.SetVertexBuffer(vertexBufferView.BufferLocation, vertexBufferView.SizeInBytes, vertexBufferView.StrideInBytes);
+        boundState.VertexBufferView = vertexBufferView;
+    }
+
+    const auto& indexBufferView = mesh.GetIndexBufferView();
+    if (boundState.IndexBufferView.BufferLocation == indexBufferView.BufferLocation &&
+        boundState.IndexBufferView.SizeInBytes == indexBufferView.SizeInBytes &&
+        boundState.IndexBufferView.Format == indexBufferView.Format)
+    {
+        ++context.StateChangesAvoided;
+    }
+    else
+    {
+        context.Stream.SetIndexBuffer(indexBufferView.BufferLocation, indexBufferView.SizeInBytes, indexBufferView.Format);
+        boundState.IndexBufferView = indexBufferView;
+    }
 }
 
-void Renderer::Commands::SetDescriptorHeaps()
+// Copies instances into this frame's upload memory and binds them to the instance data parameter, SV_InstanceID of each draw indexes from the first copied instance
+void SetMeshAndInstances(UINT instanceDataParameterIndex, const Renderer::Mesh& mesh, const Renderer::InstanceData* pInstances, const uint32_t instanceCount)
 {
-    ID3D12DescriptorHeap* heaps[] = { CBVSRVUAVDescriptorHeap->Get() };
-    DirectCommandList->SetDescriptorHeaps(_countof(heaps), heaps);
+    Renderer::UploadAllocation allocation = {};
+    if (!AllocateContextUploadMemory(instanceCount * sizeof(Renderer::InstanceData), INSTANCE_DATA_ALIGNMENT_SIZE_BYTES, allocation))
+    {
+        assert(false && "Failed to allocate instance data.");
+        return;
+    }
+
+    auto* pDst = reinterpret_cast<Renderer::InstanceData*>(allocation.pCPU);
+    memcpy(pDst, pInstances, instanceCount * sizeof(Renderer::InstanceData));
+
+    // Normals are not quantized, so dequantization is only folded into the world matrix after the normal matrix is calculated.
+    // The buffer is write combined, so the world matrix is calculated from the source rather than read back
+    if (mesh.IsCompressed())
+    {
+        for (uint32_t i = 0; i < instanceCount; ++i)
+        {
+            pDst[i].WorldMatrix = pInstances[i].WorldMatrix * mesh.GetDequantizationMatrix();
+        }
+    }
+
+    const D3D12_GPU_VIRTUAL_ADDRESS instancesAddress = allocation.GPUAddress;
+    auto& context = GetCurrentCommandContext();
+    context.InstanceCount += instanceCount;
+
+    if (UpdateBoundRootParameter(instanceDataParameterIndex, instancesAddress))
+    {
+        context.Stream.SetGraphicsRootShaderResourceView(instanceDataParameterIndex, instancesAddress);
+    }
+    SetMeshBuffers(mesh);
 }
 
-void Renderer::Commands::BeginImGui()
+Renderer::InstanceData Renderer::MakeInstanceData(const TransformMatrices& matrices, const glm::vec4& color, const bool lit)
 {
-    ImGui_ImplDX12_NewFrame();
-    ImGui_ImplWin32_NewFrame();
-    ImGui::NewFrame();
+    // Matrices are cached by the transform storage
+    InstanceData instance = {};
+    instance.WorldMatrix = matrices.WorldMatrix;
+    instance.NormalMatrix = matrices.NormalMatrix;
+    instance.Color = color;
+    instance.Lit = lit;
+    return instance;
 }
 
-void Renderer::Commands::EndImGui()
+void Renderer::Commands::SubmitMesh(UINT instanceDataParameterIndex, const Mesh& mesh, const TransformMatrices& matrices, const glm::vec4& color, const bool lit,
+    const uint32_t lodIndex)
 {
-    ImGui::Render();
-    ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), DirectCommandList.Get());
+    const InstanceData instance = MakeInstanceData(matrices, color, lit);
+    SubmitMeshInstances(instanceDataParameterIndex, mesh, &instance, 1, lodIndex);
 }
 
-void Renderer::Commands::RebuildTlas(TopLevelAccelerationStructure* tlas)
+void Renderer::Commands::SubmitMeshInstances(UINT instanceDataParameterIndex, const Mesh& mesh, const InstanceData* pInstances, const uint32_t instanceCount,
+    const uint32_t lodIndex)
 {
-    assert(tlas->UpdateAllowed() && "Attempting to rebuild a tlas that does not allow updating.");
+    if (instanceCount == 0)
+    {
+        return;
+    }
 
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
-    inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-    inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
-    inputs.NumDescs = tlas->GetInstanceCount();
-    inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+    SetMeshAndInstances(instanceDataParameterIndex, mesh, pInstances, instanceCount);
 
-    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info;
-    Device->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
+    const auto& lod = mesh.GetLOD(lodIndex);
+    auto& context = GetCurrentCommandContext();
+    context.Stream.DrawIndexedInstanced(lod.IndexCount, instanceCount, lod.IndexOffset, 0, 0);
+    ++context.DrawCount;
+}
+
+void Renderer::Commands::SubmitMeshRanges(UINT instanceDataParameterIndex, const Mesh& mesh, const InstanceData& instance, const IndexRange* pRanges,
+    const uint32_t rangeCount)
+{
+    if (rangeCount == 0)
+    {
+        return;
+    }
 
-    auto* pTlas = tlas->GetTlasResource();
-    auto tlasGPUVirtualAddress = pTlas->GetGPUVirtualAddress();
+    SetMeshAndInstances(instanceDataParameterIndex, mesh, &instance, 1);
 
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = {};
-    buildDesc.Inputs = inputs;
-    buildDesc.Inputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
-    buildDesc.SourceAccelerationStructureData = tlasGPUVirtualAddress;
-    buildDesc.Inputs.InstanceDescs = tlas->GetInstancesBuffer()->GetGPUVirtualAddress();
-    buildDesc.DestAccelerationStructureData = tlasGPUVirtualAddress;
-    buildDesc.ScratchAccelerationStructureData = tlas->GetScratchBuffer()->GetGPUVirtualAddress();
+    auto& context = GetCurrentCommandContext();
+    for (uint32_t i = 0; i < rangeCount; ++i)
+    {
+        context.Stream.DrawIndexedInstanced(pRanges[i].IndexCount, 1, pRanges[i].IndexOffset, 0, 0);
+    }
 
-    DirectCommandList->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
-    auto barrier = CD3DX12_RESOURCE_BARRIER::UAV(pTlas);
-    DirectCommandList->ResourceBarrier(1, &barrier);
+    context.DrawCount += rangeCount;
 }
 
-void Renderer::Commands::Raytrace(const D3D12_DISPATCH_RAYS_DESC& dispatchRaysDesc, ID3D12StateObject* pPipelineStateObject, ID3D12Resource* pRaytraceOutputResource,
-    ID3D12Resource* pRaytraceOutput2Resource)
+void Renderer::Commands::SubmitScreenMesh(const Mesh& mesh)
 {
-    DirectCommandList->SetPipelineState1(pPipelineStateObject);
-    DirectCommandList->DispatchRays(&dispatchRaysDesc);
-    CD3DX12_RESOURCE_BARRIER barriers[] = { CD3DX12_RESOURCE_BARRIER::UAV(pRaytraceOutputResource), CD3DX12_RESOURCE_BARRIER::UAV(pRaytraceOutput2Resource) };
-    DirectCommandList->ResourceBarrier(_countof(barriers), barriers);
+    SetMeshBuffers(mesh);
+    GetCurrentCommandContext().Stream.DrawIndexedInstanced(mesh.GetIndexCount(), 1, 0, 0, 0);
 }
 
-void Renderer::Commands::SetGraphicsDescriptorTableRootParam(UINT rootParameterIndex, const uint32_t baseDescriptorIndex)
+void Renderer::Commands::SetDescriptorHeaps()
 {
-    DirectCommandList->SetGraphicsRootDescriptorTable(rootParameterIndex, CBVSRVUAVDescriptorHeap->GetGPUDescriptorHandle(baseDescriptorIndex));
+    auto& context = GetCurrentCommandContext();
+    context.Pass.pDescriptorHeap = CBVSRVUAVDescriptorHeap->Get();
+    context.Stream.SetDescriptorHeap(context.Pass.pDescriptorHeap);
+
+    // Descriptor tables set before the heaps changed are undefined
+    context.BoundState.RootParameters = {};
 }
 
-void Renderer::Commands::SetGraphicsConstantBufferViewRootParam(UINT rootParameterIndex, const D3D12_GPU_VIRTUAL_ADDRESS bufferAddress)
+void Renderer::Commands::BeginImGui()
 {
-    DirectCommandList->SetGraphicsRootConstantBufferView(rootParameterIndex, bufferAddress);
+    ImGui_ImplDX12_NewFrame();
+    ImGui_ImplWin32_NewFrame();
+    ImGui::NewFrame();
 }
 
-void Renderer::Commands::DebugCopyResourceToRenderTarget(SwapChain* pSwapChain, ID3D12Resource* pSrcResource, D3D12_RESOURCE_STATES srcResourceState)
+void Renderer::Commands::EndImGui()
 {
-    auto* pRenderTargetResource = pSwapChain->GetBackBuffers()[FrameIndex].Get();
-
-    CD3DX12_RESOURCE_BARRIER beginBarriers[] = {
-        CD3DX12_RESOURCE_BARRIER::Transition(pRenderTargetResource, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_DEST),
-        CD3DX12_RESOURCE_BARRIER::Transition(pSrcResource, srcResourceState, D3D12_RESOURCE_STATE_COPY_SOURCE)
-    };
-    DirectCommandList->ResourceBarrier(_countof(beginBarriers), beginBarriers);
-
-    DirectCommandList->CopyResource(pRenderTargetResource, pSrcResource);
+    // Draw data stays valid until the next ImGui frame, so it is recorded when the frame's commands are replayed
+    ImGui::Render();
+    auto& context = GetCurrentCommandContext();
+    context.Stream.Native([](void* pNativeCommandList, void*)
+        {
+            ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), static_cast<ID3D12GraphicsCommandList*>(pNativeCommandList));
+        }, nullptr);
 
-    CD3DX12_RESOURCE_BARRIER endBarriers[] = {
-    CD3DX12_RESOURCE_BARRIER::Transition(pRenderTargetResource, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_RENDER_TARGET),
-    CD3DX12_RESOURCE_BARRIER::Transition(pSrcResource, D3D12_RESOURCE_STATE_COPY_SOURCE, srcResourceState)
-    };
-    DirectCommandList->ResourceBarrier(_countof(endBarriers), endBarriers);
+    // ImGui binds its own pipeline, root parameters and buffers
+    context.BoundState = {};
 }
 
-void Renderer::Commands::CopyRenderTargetToResource(SwapChain* pSwapChain, ID3D12Resource* pDstResource, D3D12_RESOURCE_STATES dstResourceState)
+Renderer::TlasSyncAction Renderer::Commands::SyncTlas(TopLevelAccelerationStructure* tlas)
 {
-    auto* pRenderTargetResource = pSwapChain->GetBackBuffers()[FrameIndex].Get();
+    const auto action = tlas->Sync(FrameSerial, CompletedFrameSerial);
+    if (action == TlasSyncAction::Skip)
+    {
+        return action;
+    }
 
-    CD3DX12_RESOURCE_BARRIER beginBarriers[] = {
-        CD3DX12_RESOURCE_BARRIER::Transition(pRenderTargetResource, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE),
-        CD3DX12_RESOURCE_BARRIER::Transition(pDstResource, dstResourceState, D3D12_RESOURCE_STATE_COPY_DEST)
-    };
-    DirectCommandList->ResourceBarrier(_countof(beginBarriers), beginBarriers);
+    // Refits update the previous build in place
+    const auto& buildDesc = tlas->GetBuildDesc();
+    const bool refit = action == TlasSyncAction::Refit;
 
-    DirectCommandList->CopyResource(pDstResource, pRenderTargetResource);
+    BuildAccelerationStructureCommand build = {};
+    build.DestAddress = buildDesc.DestAccelerationStructureData;
+    build.SourceAddress = refit ? buildDesc.DestAccelerationStructureData : 0;
+    build.InstanceDescsAddress = buildDesc.Inputs.InstanceDescs;
+    build.ScratchAddress = buildDesc.ScratchAccelerationStructureData;
+    build.InstanceCount = tlas->GetInstanceCount();
+    build.Flags = buildDesc.Inputs.Flags | (refit ? D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE : 0);
+    auto& context = GetCurrentCommandContext();
+    context.Stream.BuildAccelerationStructure(build);
 
-    CD3DX12_RESOURCE_BARRIER endBarriers[] = {
-        CD3DX12_RESOURCE_BARRIER::Transition(pRenderTargetResource, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET),
-        CD3DX12_RESOURCE_BARRIER::Transition(pDstResource, D3D12_RESOURCE_STATE_COPY_DEST, dstResourceState)
-    };
-    DirectCommandList->ResourceBarrier(_countof(endBarriers), endBarriers);
+    ResourceBarrier barrier = {};
+    barrier.BarrierType = RenderGraph::Barrier::Type::UnorderedAccess;
+    barrier.pResource = tlas->GetTlasResource();
+    context.Stream.ResourceBarriers(&barrier, 1);
+    return action;
 }
 
-void Renderer::Commands::CopyDepthTargetToResource(ID3D12Resource* pDepthTarget, ID3D12Resource* pDstResource, D3D12_RESOURCE_STATES dstResourceState)
+void Renderer::Commands::Raytrace(const D3D12_DISPATCH_RAYS_DESC& dispatchRaysDesc, ID3D12StateObject* pPipelineStateObject)
+{
+    // Raytracing state objects replace the bound graphics pipeline state
+    auto& context = GetCurrentCommandContext();
+    context.Stream.SetRaytracingPipeline(pPipelineStateObject);
+    context.BoundState.pPipeline = nullptr;
+
+    DispatchRaysCommand dispatch = {};
+    dispatch.RayGeneration = { dispatchRaysDesc.RayGenerationShaderRecord.StartAddress, dispatchRaysDesc.RayGenerationShaderRecord.SizeInBytes, 0 };
+    dispatch.Miss = { dispatchRaysDesc.MissShaderTable.StartAddress, dispatchRaysDesc.MissShaderTable.SizeInBytes, dispatchRaysDesc.MissShaderTable.StrideInBytes };
+    dispatch.HitGroup = { dispatchRaysDesc.HitGroupTable.StartAddress, dispatchRaysDesc.HitGroupTable.SizeInBytes, dispatchRaysDesc.HitGroupTable.StrideInBytes };
+    dispatch.Callable = { dispatchRaysDesc.CallableShaderTable.StartAddress, dispatchRaysDesc.CallableShaderTable.SizeInBytes,
+        dispatchRaysDesc.CallableShaderTable.StrideInBytes };
+    dispatch.Width = dispatchRaysDesc.Width;
+    dispatch.Height = dispatchRaysDesc.Height;
+    dispatch.Depth = dispatchRaysDesc.Depth;
+    context.Stream.DispatchRays(dispatch);
+}
+
+void Renderer::Commands::SetGraphicsDescriptorTableRootParam(UINT rootParameterIndex, const uint32_t baseDescriptorIndex)
+{
+    assert(baseDescriptorIndex != INVALID_DESCRIPTOR_INDEX && "Descriptor table was not allocated.");
+    const auto descriptorHandle = CBVSRVUAVDescriptorHeap->GetGPUDescriptorHandle(baseDescriptorIndex);
+    if (UpdateBoundRootParameter(rootParameterIndex, descriptorHandle.ptr))
+    {
+        GetCurrentCommandContext().Stream.SetGraphicsRootDescriptorTable(rootParameterIndex, descriptorHandle.ptr);
+    }
+}
+
+void Renderer::Commands::SetGraphicsConstantBufferViewRootParam(UINT rootParameterIndex, const D3D12_GPU_VIRTUAL_ADDRESS bufferAddress)
 {
-    CD3DX12_RESOURCE_BARRIER beginBarriers[] = {
-        CD3DX12_RESOURCE_BARRIER::Transition(pDepthTarget, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_COPY_SOURCE),
-        CD3DX12_RESOURCE_BARRIER::Transition(pDstResource, dstResourceState, D3D12_RESOURCE_STATE_COPY_DEST)
-    };
-    DirectCommandList->ResourceBarrier(_countof(beginBarriers), beginBarriers);
+    if (UpdateBoundRootParameter(rootParameterIndex, bufferAddress))
+    {
+        GetCurrentCommandContext().Stream.SetGraphicsRootConstantBufferView(rootParameterIndex, bufferAddress);
+    }
+}
 
-    DirectCommandList->CopyResource(pDstResource, pDepthTarget);
+void Renderer::Commands::DebugCopyResourceToRenderTarget(SwapChain* pSwapChain, ID3D12Resource* pSrcResource, const uint32_t srcAccess)
+{
+    auto* pRenderTargetResource = pSwapChain->GetBackBuffers()[FrameIndex].Get();
 
-    CD3DX12_RESOURCE_BARRIER endBarriers[] = {
-        CD3DX12_RESOURCE_BARRIER::Transition(pDepthTarget, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE),
-        CD3DX12_RESOURCE_BARRIER::Transition(pDstResource, D3D12_RESOURCE_STATE_COPY_DEST, dstResourceState)
-    };
-    DirectCommandList->ResourceBarrier(_countof(endBarriers), endBarriers);
+    ResourceBarrier beginBarriers[2] = {};
+    beginBarriers[0].pResource = pRenderTargetResource;
+    beginBarriers[0].AccessBefore = RenderGraph::AccessRenderTarget;
+    beginBarriers[0].AccessAfter = RenderGraph::AccessCopyDest;
+    beginBarriers[1].pResource = pSrcResource;
+    beginBarriers[1].AccessBefore = srcAccess;
+    beginBarriers[1].AccessAfter = RenderGraph::AccessCopySource;
+    auto& context = GetCurrentCommandContext();
+    context.Stream.ResourceBarriers(beginBarriers, _countof(beginBarriers));
+
+    context.Stream.CopyResource(pRenderTargetResource, pSrcResource);
+
+    ResourceBarrier endBarriers[2] = { beginBarriers[0], beginBarriers[1] };
+    std::swap(endBarriers[0].AccessBefore, endBarriers[0].AccessAfter);
+    std::swap(endBarriers[1].AccessBefore, endBarriers[1].AccessAfter);
+    context.Stream.ResourceBarriers(endBarriers, _countof(endBarriers));
 }
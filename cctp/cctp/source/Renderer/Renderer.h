@@ -2,6 +2,7 @@
 
 #include "Renderer/SwapChain.h"
 #include "Renderer/Pipeline/GraphicsPipeline.h"
+#include "Renderer/Pipeline/CompressedGraphicsPipeline.h"
 #include "Renderer/Pipeline/ScreenPassPipeline.h"
 #include "Renderer/Pipeline/ShadowMapPassPipeline.h"
 
@@ -11,99 +12,164 @@
 #include "BottomLevelAccelerationStructure.h"
 #include "TopLevelAccelerationStructure.h"
 #include "DescriptorHeap.h"
+#include "DescriptorAllocator.h"
+#include "Meshlets.h"
+#include "InstanceData.h"
+#include "DrawList.h"
+#include "UploadAllocator.h"
+#include "GpuMemoryAllocator.h"
+#include "UploadQueue.h"
+#include "AccelerationStructureBuilder.h"
+#include "PipelineCache.h"
+#include "ShaderPermutations.h"
+#include "RenderGraph.h"
+#include "RenderGraphResources.h"
 
-struct Transform;
+struct TransformMatrices;
+class TransformStorage;
 
 namespace Renderer
 {
-	enum SHADER_VISIBLE_DESCRIPTOR_INDICES
-	{
-		IMGUI_DESCRIPTOR_INDEX = 0,
-
-		SCENE_BVH_SRV_DESCRIPTOR_INDEX,
-		RAYTRACE_IRRADIANCE_UAV_DESCRIPTOR_INDEX,
-		RAYTRACE_VISIBILITY_UAV_DESCRIPTOR_INDEX,
-		SCENE_SRV_DESCRIPTOR_INDEX,
-		SCENE_DEPTH_SRV_DESCRIPTOR_INDEX,
-		SHADOW_MAP_SRV_DESCRIPTOR_INDEX,
-		RAYTRACE_IRRADIANCE_SRV_DESCRIPTOR_INDEX,
-		RAYTRACE_VISIBILITY_SRV_DESCRIPTOR_INDEX,
-		CUBE_VERTEX_BUFFER_SRV_DESCRIPTOR_INDEX,
-
-		SHADER_VISIBLE_CBV_SRV_UAV_DESCRIPTOR_COUNT
-	};
+	// Shader visible CBV SRV UAV descriptors kept until freed, and written each frame for each frame in flight
+	constexpr uint32_t DEFAULT_PERSISTENT_DESCRIPTOR_COUNT = 1024;
+	constexpr uint32_t DEFAULT_FRAME_DESCRIPTOR_COUNT = 256;
+	constexpr uint32_t INVALID_DESCRIPTOR_INDEX = DescriptorAllocator::InvalidIndex;
 
-	constexpr glm::vec2 RAYTRACE_IRRADIANCE_OUTPUT_DIMS = glm::vec2(4300.0f, 16.0f);
-	constexpr glm::vec2 RAYTRACE_VISIBILITY_OUTPUT_DIMS = glm::vec2(7000.0f, 32.0f);
+	// Probe texture sizes and the probe count are shared with the shaders through the shader permutation description
+	constexpr glm::vec2 RAYTRACE_IRRADIANCE_OUTPUT_DIMS = glm::vec2(ShaderPermutations::IRRADIANCE_TEXTURE_WIDTH, ShaderPermutations::IRRADIANCE_TEXTURE_HEIGHT);
+	constexpr glm::vec2 RAYTRACE_VISIBILITY_OUTPUT_DIMS = glm::vec2(ShaderPermutations::VISIBILITY_TEXTURE_WIDTH, ShaderPermutations::VISIBILITY_TEXTURE_HEIGHT);
 	constexpr glm::vec2 SHADOW_MAP_DIMS = glm::vec2(1024.0f, 1024.0f);
+	constexpr std::array<float, 4> CLEAR_COLOR = { 0.005f, 0.005f, 0.005f, 1.0f };
 
 	class Material;
 
 	constexpr size_t MAX_MATERIAL_COUNT = 8;
 
-	constexpr size_t MAX_PROBE_COUNT = 350;
+	constexpr size_t MAX_PROBE_COUNT = ShaderPermutations::MAX_PROBE_COUNT;
 
-	bool Init(const uint32_t shaderVisibleCBVSRVUAVDescriptorCount);
+	bool Init(const uint32_t persistentDescriptorCount = DEFAULT_PERSISTENT_DESCRIPTOR_COUNT,
+		const uint32_t frameDescriptorCount = DEFAULT_FRAME_DESCRIPTOR_COUNT);
 	bool Shutdown();
 	bool Flush();
 	bool CreateSwapChain(HWND windowHandle, UINT width, UINT height, DXGI_FORMAT format, std::unique_ptr<SwapChain>& swapChain);
 	bool ResizeSwapChain(SwapChain* pSwapChain, UINT newWidth, UINT newHeight);
 	template<typename T>
 	bool CreateGraphicsPipeline(SwapChain* pSwapChain, std::unique_ptr<GraphicsPipelineBase>& pipeline);
-	void CreateStagedMesh(const std::vector<Vertex1Pos1UV1Norm>& vertices, const std::vector<uint32_t>& indices,
-		const std::wstring& name, std::unique_ptr<Mesh>& mesh);
+	// Pipelines are loaded from the library written when the renderer last shut down, and those not found are added to it
+	const PipelineCacheStatistics& GetPipelineCacheStatistics();
+	// Staged meshes take ownership of their vertex and index data. Set keepCPUData to keep it after the upload, for example for CPU side ray queries
+	void CreateStagedMesh(std::vector<Vertex1Pos1UV1Norm>&& vertices, std::vector<uint32_t>&& indices,
+		const std::wstring& name, std::unique_ptr<Mesh>& mesh, const bool keepCPUData = false);
+	void CreateStagedMesh(std::vector<CompressedVertex1Pos1UV1Norm>&& vertices, const VertexCompression::QuantizationBounds& bounds,
+		std::vector<uint32_t>&& indices, const std::wstring& name, std::unique_ptr<Mesh>& mesh, const bool keepCPUData = false);
+	// Maps a mesh cache file, fails if it is missing or stale. Mesh data is copied from the mapping into the upload buffers by LoadStagedMeshesOntoGPU
+	bool CreateStagedMeshFromCache(const std::string& filepath, const uint64_t sourceKey, const std::wstring& name, std::unique_ptr<Mesh>& mesh,
+		const bool keepCPUData = false);
+	// Stages mesh data for upload without waiting for it, setting each mesh's upload ticket. Staged uploads are submitted together when
+	// the frame ends, and frames drawing a mesh wait for its upload on the GPU. Releases the CPU data of each mesh once staged, unless
+	// the mesh was created to keep it
 	bool LoadStagedMeshesOntoGPU(std::unique_ptr<Mesh>* pMeshes, const size_t meshCount);
+	bool IsUploadComplete(const UploadTicket ticket);
+	// Blocks until the upload has finished, submitting it first if needed
+	bool WaitForUpload(const UploadTicket ticket);
 	void CreateBottomLevelAccelerationStructure(Mesh& mesh, std::unique_ptr<BottomLevelAccelerationStructure>& blas);
+	// Records builds without waiting for them. Builds are submitted to a compute queue when the frame ends, and the frame waits for them
+	// on the GPU. Each blas is compacted once built, frames after that trace the compacted copy. Structures must stay alive until Flush
+	// or until their compaction has finished
 	bool BuildBottomLevelAccelerationStructures(std::unique_ptr<BottomLevelAccelerationStructure>* pStructures, const size_t structureCount);
 	void CreateTopLevelAccelerationStructure(std::unique_ptr<TopLevelAccelerationStructure>& tlas, const bool allowUpdate, const uint32_t instanceCount);
+	// Writes every instance and records a full build, use Commands::SyncTlas to keep a tlas up to date with its instances afterwards
 	bool BuildTopLevelAccelerationStructures(std::unique_ptr<TopLevelAccelerationStructure>* pStructures, const size_t structureCount);
-	// First descriptor index is occupied by ImGui resources
+	const AccelerationStructureBuildStatistics& GetAccelerationStructureBuildStatistics();
+
+	// Bindless descriptors. Indices are into the shader visible CBV SRV UAV heap, usable as descriptor table starts or to index the heap.
+	// Persistent ranges are contiguous and kept until freed. Returns INVALID_DESCRIPTOR_INDEX when no free range is large enough
+	uint32_t AllocateDescriptors(const uint32_t count = 1);
+	// The range is reused once the GPU has finished every frame submitted so far, so it may still be read by frames in flight
+	void FreeDescriptors(const uint32_t descriptorIndex, const uint32_t count = 1);
+	// Contiguous range valid until the end of the current frame, for tables written each frame. Safe to call while recording in parallel
+	uint32_t AllocateFrameDescriptors(const uint32_t count);
+	DescriptorAllocatorStatistics GetDescriptorStatistics();
+	// Descriptor index must be allocated with one of the functions above
 	void AddSRVDescriptorToShaderVisibleHeap(ID3D12Resource* pResource, const D3D12_SHADER_RESOURCE_VIEW_DESC* pDesc, const uint32_t descriptorIndex);
-	// First descriptor index is occupied by ImGui resources
 	void AddUAVDescriptorToShaderVisibleHeap(ID3D12Resource* pResource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* pDesc, const uint32_t descriptorIndex);
 
+	glm::mat4 CalculateProjectionMatrix(const Camera& camera, const glm::vec2& viewportDims);
+	// View projection matrix of the orthographic shadow map pass
+	glm::mat4 CalculateLightMatrix(const glm::vec3& lightDirectionWS);
+
 	UINT GetRTDescriptorIncrementSize();
 	UINT GetDSDescriptorIncrementSize();
 	bool GetVSyncEnabled();
 	void SetVSyncEnabled(const bool enabled);
+	// Mesh draws and instances submitted since the frame started
+	uint32_t GetFrameDrawCount();
+	uint32_t GetFrameInstanceCount();
+	// Pipeline, mesh buffer and root parameter bindings skipped because they matched the bound state
+	uint32_t GetFrameStateChangesAvoided();
 	const DescriptorHeap* GetShaderVisibleDescriptorHeap();
+	// Constant buffers are allocated each frame, so their addresses are only valid after the matching update command this frame
 	D3D12_GPU_VIRTUAL_ADDRESS GetPerFrameConstantBufferGPUVirtualAddress();
-	D3D12_GPU_VIRTUAL_ADDRESS GetPerObjectConstantBufferGPUVirtualAddress();
-	D3D12_GPU_VIRTUAL_ADDRESS GetPerPassConstantBufferGPUVirtualAddress();
+	D3D12_GPU_VIRTUAL_ADDRESS GetPerPassConstantBufferGPUVirtualAddress(const uint32_t passIndex);
 	D3D12_GPU_VIRTUAL_ADDRESS GetMaterialConstantBufferGPUVirtualAddress();
-	UINT64 GetConstantBufferAllignmentSize();
+	// Allocates upload memory the GPU can read until the end of the current frame
+	bool AllocateFrameUploadMemory(const UINT64 size, const UINT64 alignment, UploadAllocation& outAllocation);
+	UINT64 GetFrameUploadBytes();
+	// Places a texture in a pooled heap instead of committing memory for it. Freed textures are released once the GPU has finished
+	// every frame submitted so far
+	bool CreateTexture(const D3D12_RESOURCE_DESC& desc, const D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* pClearValue,
+		GpuTextureAllocation& outTexture);
+	void FreeTexture(GpuTextureAllocation& texture);
+	GpuMemoryPoolStatistics GetGpuMemoryStatistics(const GpuMemoryPool pool);
 
 	// Temporary
 	ID3D12Device5* GetDevice();
 
 	// Commands
+	// Recorded into command streams, one for each thread recording in parallel. EndFrame replays each into a pooled direct command list
+	// and executes them in order with a single call
 	namespace Commands
 	{
 		bool StartFrame(SwapChain* pSwapChain);
 		bool EndFrame(SwapChain* pSwapChain);
-		void ClearRenderTargets(SwapChain* pSwapChain, bool depthOnly, const CD3DX12_CPU_DESCRIPTOR_HANDLE& depthTargetDescriptorHandle);
-		void SetBackBufferRenderTargets(SwapChain* pSwapChain, bool depthOnly, const CD3DX12_CPU_DESCRIPTOR_HANDLE& depthTargetDescriptorHandle);
+		// Either target can be null
+		void SetRenderTargets(const D3D12_CPU_DESCRIPTOR_HANDLE* pRenderTargetView, const D3D12_CPU_DESCRIPTOR_HANDLE* pDepthStencilView);
+		void ClearRenderTarget(const D3D12_CPU_DESCRIPTOR_HANDLE& renderTargetView);
+		void ClearDepthStencil(const D3D12_CPU_DESCRIPTOR_HANDLE& depthStencilView);
+		// Runs the passes of a compiled render graph in parallel, recording its barriers before each. Pass callbacks must only record commands
+		// and read shared state
+		void ExecuteRenderGraph(const RenderGraph& graph, const RenderGraphResources& resources);
+		// Calls recordItem for each item on the task system's threads, each item recording into its own command list. Lists execute in item
+		// order where RecordParallel was called, and start with the descriptor heap, topology, viewport and targets set before the call
+		void RecordParallel(const uint32_t itemCount, const std::function<void(uint32_t)>& recordItem);
 		void SetPrimitiveTopology();
 		void SetViewport(SwapChain* pSwapChain);
 		void SetViewport(const D3D12_VIEWPORT& viewport, const D3D12_RECT& scissorRect);
 		void SetGraphicsPipeline(GraphicsPipelineBase* pPipeline);
-		void UpdatePerFrameConstants(const std::vector<Transform>& probeTransformsWS, const glm::vec3& lightDirectionWS, const float lightIntensity, const float probeSpacing);
+		void UpdatePerFrameConstants(const TransformStorage& probeTransformsWS, const glm::vec3& lightDirectionWS, const float lightIntensity, const float probeSpacing);
 		void UpdatePerPassConstants(const uint32_t passIndex, const glm::vec2& viewportDims, const Camera& camera);
 		void UpdateMaterialConstants(const Renderer::Material* pMaterials, const uint32_t materialCount);
-		void SubmitMesh(UINT perObjectConstantsParameterIndex, const Mesh& mesh, const Transform& transform, const glm::vec4& color, const bool lit);
+		// Mesh draws read their instances from a root shader resource view at instanceDataParameterIndex
+		void SubmitMesh(UINT instanceDataParameterIndex, const Mesh& mesh, const TransformMatrices& matrices, const glm::vec4& color, const bool lit,
+			const uint32_t lodIndex = 0);
+		// Draws every instance of the mesh with one instanced draw
+		void SubmitMeshInstances(UINT instanceDataParameterIndex, const Mesh& mesh, const InstanceData* pInstances, const uint32_t instanceCount,
+			const uint32_t lodIndex = 0);
+		// Draws each index range of the mesh as a single instance
+		void SubmitMeshRanges(UINT instanceDataParameterIndex, const Mesh& mesh, const InstanceData& instance, const IndexRange* pRanges,
+			const uint32_t rangeCount);
 		void SubmitScreenMesh(const Mesh& mesh);
 		void SetDescriptorHeaps();
 		void BeginImGui();
 		void EndImGui();
-		void RebuildTlas(TopLevelAccelerationStructure* tlas);
-		void Raytrace(const D3D12_DISPATCH_RAYS_DESC& dispatchRaysDesc, ID3D12StateObject* pPipelineStateObject, ID3D12Resource* pRaytraceOutputResource, ID3D12Resource* pRaytraceOutput2Resource);
+		// Writes the tlas instances changed since it was last synced and records a refit or a full build, or nothing when no instance changed
+		TlasSyncAction SyncTlas(TopLevelAccelerationStructure* tlas);
+		void Raytrace(const D3D12_DISPATCH_RAYS_DESC& dispatchRaysDesc, ID3D12StateObject* pPipelineStateObject);
 		void SetGraphicsDescriptorTableRootParam(UINT rootParameterIndex, const uint32_t baseDescriptorIndex);
 		void SetGraphicsConstantBufferViewRootParam(UINT rootParameterIndex, const D3D12_GPU_VIRTUAL_ADDRESS bufferAddress);
 
 		// Copies the src resource to the current frame's swap chain backbuffer. Swap chain render target resource is returned to render target
-		// state after copy. Src resource is returned to srcResourceState after copy
-		void DebugCopyResourceToRenderTarget(SwapChain* pSwapChain, ID3D12Resource* pSrcResource, D3D12_RESOURCE_STATES srcResourceState);
-		void CopyRenderTargetToResource(SwapChain* pSwapChain, ID3D12Resource* pDstResource, D3D12_RESOURCE_STATES dstResourceState);
-		void CopyDepthTargetToResource(ID3D12Resource* pDepthTarget, ID3D12Resource* pDstResource, D3D12_RESOURCE_STATES dstResourceState);
+		// state after copy. Src resource is returned to srcAccess, a render graph access, after copy
+		void DebugCopyResourceToRenderTarget(SwapChain* pSwapChain, ID3D12Resource* pSrcResource, const uint32_t srcAccess);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,307 @@
+#include "Pch.h"
+#include "ShaderCache.h"
+#include "Binary/Hash.h"
+
+#include <unordered_set>
+
+namespace
+{
+	bool ReadTextFile(const std::string& filepath, std::string& text)
+	{
+		std::ifstream fs(filepath, std::ifstream::in | std::ifstream::binary);
+		if (!fs.good())
+		{
+			return false;
+		}
+		text.assign(std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>());
+		return !fs.bad();
+	}
+
+	bool IsSpace(const char c)
+	{
+		return c == ' ' || c == '\t' || c == '\f' || c == '\v';
+	}
+
+	// Appends the names of the files included by the source in the order they appear, skipping comments and string literals
+	void FindIncludes(const std::string& source, std::vector<std::string>& includes)
+	{
+		const size_t length = source.size();
+		size_t i = 0;
+		// Only whitespace has been seen since the last line break, so a '#' here starts a directive
+		bool lineStart = true;
+
+		while (i < length)
+		{
+			const char c = source[i];
+			if (c == '\n')
+			{
+				lineStart = true;
+				++i;
+			}
+			else if (IsSpace(c) || c == '\r')
+			{
+				++i;
+			}
+			else if (c == '/' && i + 1 < length && source[i + 1] == '/')
+			{
+				// Line comments end at the line break, which is left for the next iteration
+				while (i < length && source[i] != '\n')
+				{
+					++i;
+				}
+			}
+			else if (c == '/' && i + 1 < length && source[i + 1] == '*')
+			{
+				// Block comments do not end the line, directives may still follow one on the same line
+				auto end = source.find("*/", i + 2);
+				i = end == std::string::npos ? length : end + 2;
+			}
+			else if (c == '"' || c == '\'')
+			{
+				++i;
+				while (i < length && source[i] != c && source[i] != '\n')
+				{
+					i += source[i] == '\\' ? 2 : 1;
+				}
+				++i;
+				lineStart = false;
+			}
+			else if (c == '#' && lineStart)
+			{
+				++i;
+				while (i < length && IsSpace(source[i]))
+				{
+					++i;
+				}
+
+				constexpr const char* INCLUDE_DIRECTIVE = "include";
+				constexpr size_t INCLUDE_DIRECTIVE_LENGTH = 7;
+				if (source.compare(i, INCLUDE_DIRECTIVE_LENGTH, INCLUDE_DIRECTIVE) == 0)
+				{
+					i += INCLUDE_DIRECTIVE_LENGTH;
+					while (i < length && IsSpace(source[i]))
+					{
+						++i;
+					}
+
+					if (i < length && (source[i] == '"' || source[i] == '<'))
+					{
+						const char close = source[i] == '"' ? '"' : '>';
+						auto end = source.find_first_of(std::string(1, close) + "\n", i + 1);
+						if (end != std::string::npos && source[end] == close)
+						{
+							includes.push_back(source.substr(i + 1, end - i - 1));
+							i = end + 1;
+						}
+					}
+				}
+				lineStart = false;
+			}
+			else
+			{
+				lineStart = false;
+				++i;
+			}
+		}
+	}
+
+	std::string NormalizePath(const std::filesystem::path& path)
+	{
+		return path.lexically_normal().generic_string();
+	}
+
+	bool ScanFile(const std::string& filepath, std::unordered_set<std::string>& visited, std::vector<std::string>& dependencies,
+		std::vector<std::string>& unresolvedIncludes)
+	{
+		std::string source;
+		if (!ReadTextFile(filepath, source))
+		{
+			return false;
+		}
+
+		std::vector<std::string> includes;
+		FindIncludes(source, includes);
+
+		const auto directory = std::filesystem::path(filepath).parent_path();
+		for (const auto& include : includes)
+		{
+			auto includeFilepath = NormalizePath(directory / include);
+			if (!visited.insert(includeFilepath).second)
+			{
+				continue;
+			}
+
+			// An unreadable file read nothing else, so only it is moved to the unresolved includes
+			dependencies.push_back(includeFilepath);
+			if (!ScanFile(includeFilepath, visited, dependencies, unresolvedIncludes))
+			{
+				dependencies.pop_back();
+				unresolvedIncludes.push_back(includeFilepath);
+			}
+		}
+		return true;
+	}
+
+	uint64_t HashString(const std::string& string, const uint64_t seed)
+	{
+		// Length prefixed so neighbouring strings cannot trade characters and keep the same hash
+		const uint64_t length = string.size();
+		auto hash = Binary::HashBytes(&length, sizeof(length), seed);
+		return Binary::HashBytes(string.data(), string.size(), hash);
+	}
+
+	bool HashSourceFile(const std::string& filepath, uint64_t& hash)
+	{
+		std::string source;
+		if (!ReadTextFile(filepath, source))
+		{
+			return false;
+		}
+		source.erase(std::remove(source.begin(), source.end(), '\r'), source.end());
+
+		hash = HashString(filepath, hash);
+		hash = HashString(source, hash);
+		return true;
+	}
+}
+
+bool Renderer::ShaderCache::ScanDependencies(const std::string& filepath, std::vector<std::string>& dependencies,
+	std::vector<std::string>& unresolvedIncludes)
+{
+	dependencies.clear();
+	unresolvedIncludes.clear();
+
+	std::unordered_set<std::string> visited;
+	visited.insert(NormalizePath(filepath));
+	if (!ScanFile(filepath, visited, dependencies, unresolvedIncludes))
+	{
+		DEBUG_LOG("Failed to read shader source " << filepath << ".");
+		return false;
+	}
+	return true;
+}
+
+bool Renderer::ShaderCache::CalculateShaderKey(const ShaderCompileDesc& desc, const uint64_t compilerKey, uint64_t& key)
+{
+	std::vector<std::string> dependencies;
+	std::vector<std::string> unresolvedIncludes;
+	if (!ScanDependencies(desc.Filepath, dependencies, unresolvedIncludes))
+	{
+		return false;
+	}
+
+	uint64_t hash = Binary::HashBytes(&compilerKey, sizeof(compilerKey));
+	hash = HashString(desc.EntryPoint, hash);
+	hash = HashString(desc.Target, hash);
+
+	const uint64_t defineCount = desc.Defines.size();
+	hash = Binary::HashBytes(&defineCount, sizeof(defineCount), hash);
+	for (const auto& define : desc.Defines)
+	{
+		hash = HashString(define.Name, hash);
+		hash = HashString(define.Value, hash);
+	}
+
+	if (!HashSourceFile(NormalizePath(desc.Filepath), hash))
+	{
+		return false;
+	}
+	for (const auto& dependency : dependencies)
+	{
+		if (!HashSourceFile(dependency, hash))
+		{
+			return false;
+		}
+	}
+
+	// Unresolved includes count by name, so the key changes once one can be read and its contents are hashed instead
+	const uint64_t unresolvedCount = unresolvedIncludes.size();
+	hash = Binary::HashBytes(&unresolvedCount, sizeof(unresolvedCount), hash);
+	for (const auto& include : unresolvedIncludes)
+	{
+		hash = HashString(include, hash);
+	}
+
+	key = hash;
+	return true;
+}
+
+bool Renderer::ShaderCache::ReadCacheFile(const std::string& filepath, const uint64_t key, std::vector<uint8_t>& data)
+{
+	std::ifstream fs(filepath, std::ifstream::in | std::ifstream::binary | std::ifstream::ate);
+	if (!fs.good())
+	{
+		return false;
+	}
+
+	const auto fileSize = static_cast<uint64_t>(fs.tellg());
+	if (fileSize < sizeof(ShaderCacheHeader))
+	{
+		return false;
+	}
+
+	ShaderCacheHeader header;
+	fs.seekg(0);
+	fs.read(reinterpret_cast<char*>(&header), sizeof(ShaderCacheHeader));
+	if (!fs.good() || header.Magic != SHADER_CACHE_MAGIC || header.Version != SHADER_CACHE_VERSION || header.Key != key ||
+		header.DataSize != fileSize - sizeof(ShaderCacheHeader))
+	{
+		return false;
+	}
+
+	data.resize(static_cast<size_t>(header.DataSize));
+	fs.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(header.DataSize));
+	if (!fs.good() || Binary::HashBytes(data.data(), data.size()) != header.DataHash)
+	{
+		data.clear();
+		return false;
+	}
+	return true;
+}
+
+bool Renderer::ShaderCache::WriteCacheFile(const std::string& filepath, const uint64_t key, const void* pData, const size_t size)
+{
+	ShaderCacheHeader header = {};
+	header.Key = key;
+	header.DataSize = size;
+	header.DataHash = Binary::HashBytes(pData, size);
+
+	std::error_code error;
+	auto directory = std::filesystem::path(filepath).parent_path();
+	if (!directory.empty())
+	{
+		std::filesystem::create_directories(directory, error);
+	}
+
+	// Write to a temporary file first so an interrupted write never leaves a truncated cache behind
+	auto temporaryFilepath = filepath + ".tmp";
+	{
+		std::ofstream fs(temporaryFilepath, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+		if (!fs.good())
+		{
+			return false;
+		}
+
+		fs.write(reinterpret_cast<const char*>(&header), sizeof(ShaderCacheHeader));
+		fs.write(static_cast<const char*>(pData), static_cast<std::streamsize>(size));
+		if (!fs.good())
+		{
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporaryFilepath, filepath, error);
+	return !error;
+}
+
+std::string Renderer::ShaderCache::GetCacheFilepath(const std::string& name)
+{
+	return (std::filesystem::path(SHADER_CACHE_DIRECTORY) / name).string();
+}
+
+std::string Renderer::ShaderCache::GetShaderCacheName(const uint64_t key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.dxil", static_cast<unsigned long long>(key));
+	return name;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+namespace Renderer
+{
+	namespace ShaderCache
+	{
+		constexpr uint32_t SHADER_CACHE_MAGIC = 0x52444853; // "SHDR"
+		// Increment whenever the file layout or the way keys are calculated changes, older files are then treated as stale
+		constexpr uint32_t SHADER_CACHE_VERSION = 1;
+		constexpr const char* SHADER_CACHE_DIRECTORY = "ShaderCache";
+
+		struct ShaderDefine
+		{
+			std::string Name;
+			std::string Value;
+		};
+
+		// Everything that selects the bytecode compiled from a shader source file
+		struct ShaderCompileDesc
+		{
+			std::string Filepath;
+			// Empty for libraries, which export every entry point they define
+			std::string EntryPoint;
+			std::string Target;
+			std::vector<ShaderDefine> Defines;
+		};
+
+		// File layout is the header followed by the data
+		struct ShaderCacheHeader
+		{
+			uint32_t Magic = SHADER_CACHE_MAGIC;
+			uint32_t Version = SHADER_CACHE_VERSION;
+			// Identifies the sources and settings the data was built from, a mismatch means the cache is stale
+			uint64_t Key = 0;
+			uint64_t DataSize = 0;
+			// Catches files corrupted after they were written
+			uint64_t DataHash = 0;
+		};
+
+		static_assert(std::is_trivially_copyable<ShaderCacheHeader>::value, "Shader cache header must be trivially copyable.");
+
+		// Finds every file the shader includes, directly or through other includes, searching relative to the including file. Includes
+		// inside comments and string literals are ignored, and conditional compilation is not evaluated, so an include disabled by the
+		// preprocessor still counts as a dependency. Each file is listed once in the order it is first included, without the shader
+		// itself. Includes that cannot be read are listed as unresolved rather than failing the scan, they may be disabled by the
+		// preprocessor or found by the compiler elsewhere, and are otherwise its error to report. Fails if the shader cannot be read
+		bool ScanDependencies(const std::string& filepath, std::vector<std::string>& dependencies, std::vector<std::string>& unresolvedIncludes);
+
+		// Hashes the contents of the shader and every file it includes together with its entry point, target and defines. Line endings
+		// are ignored so checkouts with either convention share keys. Unresolved includes are hashed by name. compilerKey identifies
+		// the compiler and its arguments
+		bool CalculateShaderKey(const ShaderCompileDesc& desc, const uint64_t compilerKey, uint64_t& key);
+
+		// Fails if the file is missing, truncated, corrupt, from another version or was written for another key
+		bool ReadCacheFile(const std::string& filepath, const uint64_t key, std::vector<uint8_t>& data);
+		bool WriteCacheFile(const std::string& filepath, const uint64_t key, const void* pData, const size_t size);
+
+		// Path of a named file inside the shader cache directory
+		std::string GetCacheFilepath(const std::string& name);
+		// Shaders are cached under their key, so edited shaders write new files rather than overwrite the ones older checkouts still use
+		std::string GetShaderCacheName(const uint64_t key);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "Pch.h"
+#include "ShaderPermutations.h"
+
+namespace
+{
+	std::string FormatConstantValue(const Renderer::ShaderPermutations::ShaderConstantDesc& constant)
+	{
+		char value[32];
+		if (constant.Type == Renderer::ShaderPermutations::ShaderConstantType::Int)
+		{
+			snprintf(value, sizeof(value), "%lld", static_cast<long long>(constant.Value));
+			return value;
+		}
+
+		// Float constants are declared from floats, seven significant digits give back the same float
+		snprintf(value, sizeof(value), "%.7g", constant.Value);
+		std::string literal = value;
+		if (literal.find_first_of(".e") == std::string::npos)
+		{
+			literal += ".0";
+		}
+		return literal;
+	}
+
+	// Entries without a comment are grouped with the entry above them
+	void AppendComment(std::string& header, const char* comment)
+	{
+		if (comment != nullptr)
+		{
+			header += std::string("\n// ") + comment + "\n";
+		}
+	}
+}
+
+const char* Renderer::ShaderPermutations::GetTierName(const ShaderQualityTier tier)
+{
+	switch (tier)
+	{
+	case ShaderQualityTier::Low: return "Low";
+	case ShaderQualityTier::Medium: return "Medium";
+	case ShaderQualityTier::High: return "High";
+	default:
+		assert(false && "Invalid shader quality tier.");
+		return "";
+	}
+}
+
+uint32_t Renderer::ShaderPermutations::GetOptionValue(const char* name, const ShaderQualityTier tier)
+{
+	assert(tier < ShaderQualityTier::Count && "Invalid shader quality tier.");
+	for (const auto& option : SHADER_OPTIONS)
+	{
+		if (strcmp(option.Name, name) == 0)
+		{
+			return option.TierValues[static_cast<uint32_t>(tier)];
+		}
+	}
+
+	assert(false && "Getting the value of an unknown shader option.");
+	return 0;
+}
+
+std::vector<Renderer::ShaderCache::ShaderDefine> Renderer::ShaderPermutations::GetTierDefines(const ShaderQualityTier tier)
+{
+	assert(tier < ShaderQualityTier::Count && "Invalid shader quality tier.");
+
+	std::vector<ShaderCache::ShaderDefine> defines;
+	defines.reserve(std::size(SHADER_OPTIONS));
+	for (const auto& option : SHADER_OPTIONS)
+	{
+		defines.push_back({ option.Name, std::to_string(option.TierValues[static_cast<uint32_t>(tier)]) });
+	}
+	return defines;
+}
+
+std::string Renderer::ShaderPermutations::GenerateHlslHeader()
+{
+	std::string header;
+	header += "// Generated from Renderer/ShaderPermutations.h, edit the description there rather than this file\n";
+	header += "#ifndef SHADER_CONSTANTS\n";
+	header += "#define SHADER_CONSTANTS\n";
+
+	for (const auto& constant : SHADER_CONSTANTS)
+	{
+		AppendComment(header, constant.Comment);
+		header += std::string("static const ") + (constant.Type == ShaderConstantType::Int ? "int " : "float ") + constant.Name + " = " +
+			FormatConstantValue(constant) + ";\n";
+	}
+
+	header += "\n// Options set by the compiler for each quality tier, defaulting to the ";
+	header += GetTierName(DEFAULT_SHADER_QUALITY_TIER);
+	header += " tier\n";
+	for (const auto& option : SHADER_OPTIONS)
+	{
+		AppendComment(header, option.Comment);
+		header += std::string("#ifndef ") + option.Name + "\n";
+		header += std::string("#define ") + option.Name + " " +
+			std::to_string(option.TierValues[static_cast<uint32_t>(DEFAULT_SHADER_QUALITY_TIER)]) + "\n";
+		header += std::string("#endif // ") + option.Name + "\n";
+	}
+
+	header += "\n#endif // SHADER_CONSTANTS\n";
+	return header;
+}
+
+bool Renderer::ShaderPermutations::UpdateHlslHeader(const std::string& filepath, bool& updated)
+{
+	updated = false;
+	const auto header = GenerateHlslHeader();
+
+	std::string current;
+	{
+		std::ifstream fs(filepath, std::ifstream::in | std::ifstream::binary);
+		if (fs.good())
+		{
+			current.assign(std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>());
+			current.erase(std::remove(current.begin(), current.end(), '\r'), current.end());
+		}
+	}
+	if (current == header)
+	{
+		return true;
+	}
+
+	std::ofstream fs(filepath, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+	fs.write(header.data(), static_cast<std::streamsize>(header.size()));
+	if (!fs.good())
+	{
+		return false;
+	}
+	updated = true;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "ShaderCache.h"
+
+namespace Renderer
+{
+	// Single description of the constants shared by C++ and HLSL and of the options shaders are compiled with for each quality tier.
+	// C++ uses it directly, and the HLSL header is generated from it, so neither side repeats a value
+	namespace ShaderPermutations
+	{
+		enum class ShaderQualityTier : uint32_t
+		{
+			Low,
+			Medium,
+			High,
+			Count
+		};
+
+		constexpr uint32_t SHADER_QUALITY_TIER_COUNT = static_cast<uint32_t>(ShaderQualityTier::Count);
+		constexpr ShaderQualityTier DEFAULT_SHADER_QUALITY_TIER = ShaderQualityTier::Medium;
+		constexpr const char* SHADER_CONSTANTS_HEADER_FILEPATH = "Shaders/ShaderConstants.hlsl";
+
+		// Constants are described in SHADER_CONSTANTS below
+		constexpr uint32_t MAX_PROBE_COUNT = 350;
+		constexpr uint32_t IRRADIANCE_PROBE_SIDE_LENGTH = 8;
+		constexpr uint32_t VISIBILITY_PROBE_SIDE_LENGTH = 16;
+		constexpr uint32_t PROBE_PADDING = 1;
+		constexpr float MAX_DISTANCE = 1.0f;
+		constexpr float IRRADIANCE_TEXTURE_WIDTH = 4300.0f;
+		constexpr float IRRADIANCE_TEXTURE_HEIGHT = 16.0f;
+		constexpr float VISIBILITY_TEXTURE_WIDTH = 7000.0f;
+		constexpr float VISIBILITY_TEXTURE_HEIGHT = 32.0f;
+		constexpr float SHADOW_BIAS = 0.04f;
+
+		// Probes are packed in a row, each followed by its padding
+		static_assert(MAX_PROBE_COUNT * (IRRADIANCE_PROBE_SIDE_LENGTH + PROBE_PADDING) <= IRRADIANCE_TEXTURE_WIDTH &&
+			IRRADIANCE_PROBE_SIDE_LENGTH + PROBE_PADDING <= IRRADIANCE_TEXTURE_HEIGHT, "Irradiance texture cannot hold every probe.");
+		static_assert(MAX_PROBE_COUNT * (VISIBILITY_PROBE_SIDE_LENGTH + PROBE_PADDING) <= VISIBILITY_TEXTURE_WIDTH &&
+			VISIBILITY_PROBE_SIDE_LENGTH + PROBE_PADDING <= VISIBILITY_TEXTURE_HEIGHT, "Visibility texture cannot hold every probe.");
+
+		enum class ShaderConstantType
+		{
+			Int,
+			Float
+		};
+
+		struct ShaderConstantDesc
+		{
+			const char* Name;
+			ShaderConstantType Type;
+			double Value;
+			// Written above the constant in the header, may be null
+			const char* Comment;
+		};
+
+		// Constants the same in every permutation, declared as static constants in the header
+		constexpr ShaderConstantDesc SHADER_CONSTANTS[] =
+		{
+			{ "MAX_PROBE_COUNT", ShaderConstantType::Int, MAX_PROBE_COUNT, "The max number of probes in the probe field" },
+			{ "IRRADIANCE_PROBE_SIDE_LENGTH", ShaderConstantType::Int, IRRADIANCE_PROBE_SIDE_LENGTH,
+				"The amount of texels in a square side to use to store a probes irradiance data in" },
+			{ "VISIBILITY_PROBE_SIDE_LENGTH", ShaderConstantType::Int, VISIBILITY_PROBE_SIDE_LENGTH,
+				"The amount of texels in a square side to use to store a probes visibility data in" },
+			{ "PROBE_PADDING", ShaderConstantType::Int, PROBE_PADDING,
+				"Border size in pixels around each probe's data pack. Should be at least 1 to protect data from blurring with next probe" },
+			{ "MAX_DISTANCE", ShaderConstantType::Float, MAX_DISTANCE, "The maximum distance a ray can travel" },
+			{ "IRRADIANCE_TEXTURE_WIDTH", ShaderConstantType::Float, IRRADIANCE_TEXTURE_WIDTH, "Irradiance texture dimension" },
+			{ "IRRADIANCE_TEXTURE_HEIGHT", ShaderConstantType::Float, IRRADIANCE_TEXTURE_HEIGHT, nullptr },
+			{ "VISIBILITY_TEXTURE_WIDTH", ShaderConstantType::Float, VISIBILITY_TEXTURE_WIDTH, "Visibility texture dimension" },
+			{ "VISIBILITY_TEXTURE_HEIGHT", ShaderConstantType::Float, VISIBILITY_TEXTURE_HEIGHT, nullptr },
+			{ "SHADOW_BIAS", ShaderConstantType::Float, SHADOW_BIAS, "Shadow map depth bias, scaled down on surfaces facing the light" }
+		};
+
+		struct ShaderOptionDesc
+		{
+			const char* Name;
+			// Indexed by quality tier
+			std::array<uint32_t, SHADER_QUALITY_TIER_COUNT> TierValues;
+			const char* Comment;
+		};
+
+		// Options compiled into each tier's permutation. The header defines each as the default tier's value unless the compiler has,
+		// so shaders compiled without options, such as those built with the project, match the default tier. Only the ray gen library
+		// reads them, so tiers never change the layout of the probe textures the rasterized shaders sample
+		constexpr ShaderOptionDesc SHADER_OPTIONS[] =
+		{
+			{ "PROBE_RAY_COUNT", { 16, 32, 128 }, "The number of rays traced from a probe. McGuire uses up to 256 rays" },
+			{ "IRRADIANCE_BLUR_ITERATIONS", { 1, 2, 3 }, "The number of blur iterations to perform on each output texture" },
+			{ "VISIBILITY_BLUR_ITERATIONS", { 0, 0, 1 }, nullptr }
+		};
+
+		const char* GetTierName(const ShaderQualityTier tier);
+		uint32_t GetOptionValue(const char* name, const ShaderQualityTier tier);
+		// Defines giving each option the tier's value, to compile the tier's permutation with
+		std::vector<ShaderCache::ShaderDefine> GetTierDefines(const ShaderQualityTier tier);
+
+		// Header declaring every constant and the default of every option
+		std::string GenerateHlslHeader();
+		// Writes the generated header when the file differs from it, ignoring line endings. Leaves matching files untouched, so the keys
+		// of shaders including it do not change. Shaders compiled with the project only see the new header once rebuilt
+		bool UpdateHlslHeader(const std::string& filepath, bool& updated);
+	}
+}
\ No newline at end of file
@@ -59,19 +59,6 @@ bool Renderer::SwapChain::Init(Microsoft::WRL::ComPtr<IDXGIFactory4> factory, Mi
         return false;
     }
 
-    // Create descriptor heap for depth stencil buffer descriptors
-    D3D12_DESCRIPTOR_HEAP_DESC dsDescriptorHeapDesc = {};
-    dsDescriptorHeapDesc.NumDescriptors = 2;
-    dsDescriptorHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-    dsDescriptorHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    if (FAILED(device->CreateDescriptorHeap(&dsDescriptorHeapDesc, IID_PPV_ARGS(&DSDescriptorHeap))))
-    {
-        return false;
-    }
-
-    // Create depth stencil buffer
-    UpdateDepthStencilBuffer(device, width, height);
-
     // Describe viewport and scissor rect
     Viewport.TopLeftX = 0.0f;
     Viewport.TopLeftY = 0.0f;
@@ -124,9 +111,6 @@ bool Renderer::SwapChain::Resize(Microsoft::WRL::ComPtr<ID3D12Device> device, UI
         BackBuffers[i].Reset();
     }
 
-    // Release depth stencil buffer resource
-    DepthStencilBuffer.Reset();
-
     // Resize back buffers
     DXGI_SWAP_CHAIN_DESC swapChainDesc;
     if (FAILED(SwapChain3->GetDesc(&swapChainDesc)))
@@ -145,12 +129,6 @@ bool Renderer::SwapChain::Resize(Microsoft::WRL::ComPtr<ID3D12Device> device, UI
         return false;
     }
 
-    // Recreate depth stencil buffer
-    if (!UpdateDepthStencilBuffer(device, width, height))
-    {
-        return false;
-    }
-
     // Update viewport and scissor rect descriptions
     Viewport.TopLeftX = 0.0f;
     Viewport.TopLeftY = 0.0f;
@@ -198,17 +176,6 @@ CD3DX12_CPU_DESCRIPTOR_HANDLE Renderer::SwapChain::GetRTDescriptorHandleForFrame
         static_cast<INT>(frameIndex), Renderer::GetRTDescriptorIncrementSize());
 }
 
-CD3DX12_CPU_DESCRIPTOR_HANDLE Renderer::SwapChain::GetDSDescriptorHandle() const
-{
-    return CD3DX12_CPU_DESCRIPTOR_HANDLE(DSDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-}
-
-CD3DX12_CPU_DESCRIPTOR_HANDLE Renderer::SwapChain::GetShadowMapDSDescriptorHandle() const
-{
-    return CD3DX12_CPU_DESCRIPTOR_HANDLE(DSDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
-        1, Renderer::GetDSDescriptorIncrementSize());
-}
-
 bool Renderer::SwapChain::UpdateBackBuffers(Microsoft::WRL::ComPtr<ID3D12Device> device, UINT rtvDescriptorSize)
 {
     CD3DX12_CPU_DESCRIPTOR_HANDLE rtv(RTDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
@@ -226,31 +193,3 @@ bool Renderer::SwapChain::UpdateBackBuffers(Microsoft::WRL::ComPtr<ID3D12Device>
 
     return true;
 }
-
-bool Renderer::SwapChain::UpdateDepthStencilBuffer(Microsoft::WRL::ComPtr<ID3D12Device> device, UINT64 width, UINT height)
-{
-    D3D12_DEPTH_STENCIL_VIEW_DESC depthStencilDesc = {};
-    depthStencilDesc.Format = DXGI_FORMAT_D32_FLOAT;
-    depthStencilDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
-    depthStencilDesc.Flags = D3D12_DSV_FLAG_NONE;
-
-    D3D12_CLEAR_VALUE depthOptimizedClearValue = {};
-    depthOptimizedClearValue.Format = DXGI_FORMAT_D32_FLOAT;
-    depthOptimizedClearValue.DepthStencil.Depth = 1.0f;
-    depthOptimizedClearValue.DepthStencil.Stencil = 0;
-
-    auto dsvHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-    auto dsvResourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, width, height, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
-    if (FAILED(device->CreateCommittedResource(&dsvHeapProperties, D3D12_HEAP_FLAG_NONE,
-        &dsvResourceDesc, D3D12_RESOURCE_STATE_DEPTH_WRITE,
-        &depthOptimizedClearValue,
-        IID_PPV_ARGS(&DepthStencilBuffer)
-    )))
-    {
-        return false;
-    }
-
-    device->CreateDepthStencilView(DepthStencilBuffer.Get(), &depthStencilDesc, DSDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
-    return true;
-}
@@ -0,0 +1,317 @@
+#include "Pch.h"
+#include "TlsfAllocator.h"
+
+#include <bit>
+
+void Renderer::TlsfAllocator::Init(const uint64_t capacity, const uint64_t granularity)
+{
+	assert(std::has_single_bit(granularity) && "Granularity must be a power of two.");
+	assert(capacity > 0 && capacity % granularity == 0 && "Capacity must be a non zero multiple of the granularity.");
+
+	Capacity = capacity;
+	Granularity = granularity;
+	GranularityLog2 = static_cast<uint32_t>(std::countr_zero(granularity));
+	assert(std::bit_width(capacity >> GranularityLog2) <= FirstLevelCount + SecondLevelLog2 - 1 && "Capacity is too large for the size classes.");
+
+	Blocks.clear();
+	UnusedBlocks.clear();
+	FirstLevelBitmap = 0;
+	SecondLevelBitmaps.fill(0);
+	for (auto& freeLists : FreeLists)
+	{
+		freeLists.fill(InvalidBlock);
+	}
+	UsedBytes = 0;
+	AllocationCount = 0;
+	FreeBlockCount = 0;
+	FailedAllocationCount = 0;
+
+	// The whole range starts as one free block
+	const uint32_t block = CreateBlock();
+	Blocks[block].Size = capacity;
+	InsertFreeBlock(block);
+}
+
+bool Renderer::TlsfAllocator::Allocate(const uint64_t size, const uint64_t alignment, TlsfAllocation& outAllocation)
+{
+	assert(size > 0 && "Allocations must not be empty.");
+	assert(std::has_single_bit(alignment) && "Alignment must be a power of two.");
+
+	const uint64_t blockAlignment = std::max(alignment, Granularity);
+	const uint64_t units = (size + Granularity - 1) >> GranularityLog2;
+	const uint64_t alignedSize = units << GranularityLog2;
+	// Offsets are multiples of the granularity, so aligning one moves it by at most this many units
+	const uint64_t searchUnits = units + ((blockAlignment - Granularity) >> GranularityLog2);
+	if (searchUnits > Capacity >> GranularityLog2)
+	{
+		++FailedAllocationCount;
+		return false;
+	}
+
+	// Round the search up to the next size class, so every block of the class found is large enough
+	uint64_t roundedUnits = searchUnits;
+	if (searchUnits >= SecondLevelCount)
+	{
+		roundedUnits += (uint64_t(1) << (std::bit_width(searchUnits) - 1 - SecondLevelLog2)) - 1;
+	}
+
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	uint32_t block = InvalidBlock;
+	if (std::bit_width(roundedUnits) <= FirstLevelCount + SecondLevelLog2 - 1)
+	{
+		MapSize(roundedUnits, firstLevel, secondLevel);
+		block = FindFreeBlock(firstLevel, secondLevel);
+	}
+
+	// Blocks in the search size's own class may still be large enough, check them one by one before giving up
+	if (block == InvalidBlock)
+	{
+		MapSize(searchUnits, firstLevel, secondLevel);
+		for (uint32_t candidate = FreeLists[firstLevel][secondLevel]; candidate != InvalidBlock; candidate = Blocks[candidate].NextFree)
+		{
+			const Block& candidateBlock = Blocks[candidate];
+			const uint64_t alignedOffset = (candidateBlock.Offset + blockAlignment - 1) & ~(blockAlignment - 1);
+			if (alignedOffset + alignedSize <= candidateBlock.Offset + candidateBlock.Size)
+			{
+				block = candidate;
+				break;
+			}
+		}
+	}
+
+	if (block == InvalidBlock)
+	{
+		++FailedAllocationCount;
+		return false;
+	}
+
+	RemoveFreeBlock(block);
+
+	// Padding in front of an aligned allocation becomes a free block of its own. The block before is in use, free neighbours are
+	// always merged, so the padding block can not merge with it
+	const uint64_t padding = ((Blocks[block].Offset + blockAlignment - 1) & ~(blockAlignment - 1)) - Blocks[block].Offset;
+	if (padding > 0)
+	{
+		const uint32_t paddingBlock = CreateBlock();
+		Block& aligned = Blocks[block];
+		Block& leading = Blocks[paddingBlock];
+		leading.Offset = aligned.Offset;
+		leading.Size = padding;
+		leading.PreviousPhysical = aligned.PreviousPhysical;
+		leading.NextPhysical = block;
+		if (aligned.PreviousPhysical != InvalidBlock)
+		{
+			Blocks[aligned.PreviousPhysical].NextPhysical = paddingBlock;
+		}
+		aligned.PreviousPhysical = paddingBlock;
+		aligned.Offset += padding;
+		aligned.Size -= padding;
+		InsertFreeBlock(paddingBlock);
+	}
+
+	if (Blocks[block].Size > alignedSize)
+	{
+		SplitFreeTail(block, alignedSize);
+	}
+
+	UsedBytes += alignedSize;
+	++AllocationCount;
+
+	outAllocation.Offset = Blocks[block].Offset;
+	outAllocation.Size = alignedSize;
+	outAllocation.Block = block;
+	return true;
+}
+
+void Renderer::TlsfAllocator::Free(const uint32_t block)
+{
+	assert(block < Blocks.size() && Blocks[block].Size > 0 && !Blocks[block].Free && "Block is not allocated.");
+
+	UsedBytes -= Blocks[block].Size;
+	--AllocationCount;
+
+	uint32_t merged = block;
+	const uint32_t next = Blocks[merged].NextPhysical;
+	if (next != InvalidBlock && Blocks[next].Free)
+	{
+		RemoveFreeBlock(next);
+		MergeNext(merged);
+	}
+
+	const uint32_t previous = Blocks[merged].PreviousPhysical;
+	if (previous != InvalidBlock && Blocks[previous].Free)
+	{
+		RemoveFreeBlock(previous);
+		MergeNext(previous);
+		merged = previous;
+	}
+
+	InsertFreeBlock(merged);
+}
+
+Renderer::TlsfStatistics Renderer::TlsfAllocator::GetStatistics() const
+{
+	TlsfStatistics statistics;
+	statistics.Capacity = Capacity;
+	statistics.UsedBytes = UsedBytes;
+	statistics.FreeBytes = Capacity - UsedBytes;
+	statistics.AllocationCount = AllocationCount;
+	statistics.FreeBlockCount = FreeBlockCount;
+	statistics.FailedAllocationCount = FailedAllocationCount;
+
+	// The largest free block is in the highest non empty size class
+	if (FirstLevelBitmap != 0)
+	{
+		const uint32_t firstLevel = static_cast<uint32_t>(std::bit_width(FirstLevelBitmap) - 1);
+		const uint32_t secondLevel = static_cast<uint32_t>(std::bit_width(SecondLevelBitmaps[firstLevel]) - 1);
+		for (uint32_t block = FreeLists[firstLevel][secondLevel]; block != InvalidBlock; block = Blocks[block].NextFree)
+		{
+			statistics.LargestFreeBlock = std::max(statistics.LargestFreeBlock, Blocks[block].Size);
+		}
+	}
+
+	if (statistics.FreeBytes > 0)
+	{
+		statistics.Fragmentation = 1.0f - static_cast<float>(statistics.LargestFreeBlock) / static_cast<float>(statistics.FreeBytes);
+	}
+	return statistics;
+}
+
+void Renderer::TlsfAllocator::MapSize(const uint64_t units, uint32_t& outFirstLevel, uint32_t& outSecondLevel)
+{
+	// Sizes below the second level count are split linearly into the first level, each power of two above into equal steps
+	if (units < SecondLevelCount)
+	{
+		outFirstLevel = 0;
+		outSecondLevel = static_cast<uint32_t>(units);
+		return;
+	}
+
+	const uint32_t highestBit = static_cast<uint32_t>(std::bit_width(units) - 1);
+	outFirstLevel = highestBit - SecondLevelLog2 + 1;
+	outSecondLevel = static_cast<uint32_t>(units >> (highestBit - SecondLevelLog2)) - SecondLevelCount;
+	assert(outFirstLevel < FirstLevelCount && "Size is too large for the size classes.");
+}
+
+uint32_t Renderer::TlsfAllocator::FindFreeBlock(uint32_t firstLevel, uint32_t secondLevel) const
+{
+	uint32_t secondLevelBitmap = SecondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+	if (secondLevelBitmap == 0)
+	{
+		// No block in this power of two is large enough, take the smallest class of a larger one
+		const uint32_t firstLevelBitmap = firstLevel + 1 < FirstLevelCount ? FirstLevelBitmap & (~0u << (firstLevel + 1)) : 0;
+		if (firstLevelBitmap == 0)
+		{
+			return InvalidBlock;
+		}
+
+		firstLevel = static_cast<uint32_t>(std::countr_zero(firstLevelBitmap));
+		secondLevelBitmap = SecondLevelBitmaps[firstLevel];
+	}
+
+	secondLevel = static_cast<uint32_t>(std::countr_zero(secondLevelBitmap));
+	return FreeLists[firstLevel][secondLevel];
+}
+
+void Renderer::TlsfAllocator::InsertFreeBlock(const uint32_t block)
+{
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	MapSize(Blocks[block].Size >> GranularityLog2, firstLevel, secondLevel);
+
+	uint32_t& head = FreeLists[firstLevel][secondLevel];
+	Blocks[block].Free = true;
+	Blocks[block].PreviousFree = InvalidBlock;
+	Blocks[block].NextFree = head;
+	if (head != InvalidBlock)
+	{
+		Blocks[head].PreviousFree = block;
+	}
+	head = block;
+
+	FirstLevelBitmap |= 1u << firstLevel;
+	SecondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+	++FreeBlockCount;
+}
+
+void Renderer::TlsfAllocator::RemoveFreeBlock(const uint32_t block)
+{
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	MapSize(Blocks[block].Size >> GranularityLog2, firstLevel, secondLevel);
+
+	Block& removed = Blocks[block];
+	if (removed.PreviousFree != InvalidBlock)
+	{
+		Blocks[removed.PreviousFree].NextFree = removed.NextFree;
+	}
+	else
+	{
+		FreeLists[firstLevel][secondLevel] = removed.NextFree;
+	}
+	if (removed.NextFree != InvalidBlock)
+	{
+		Blocks[removed.NextFree].PreviousFree = removed.PreviousFree;
+	}
+	removed.Free = false;
+	removed.PreviousFree = InvalidBlock;
+	removed.NextFree = InvalidBlock;
+
+	// Clear the bitmaps once the class is empty
+	if (FreeLists[firstLevel][secondLevel] == InvalidBlock)
+	{
+		SecondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+		if (SecondLevelBitmaps[firstLevel] == 0)
+		{
+			FirstLevelBitmap &= ~(1u << firstLevel);
+		}
+	}
+	--FreeBlockCount;
+}
+
+void Renderer::TlsfAllocator::SplitFreeTail(const uint32_t block, const uint64_t size)
+{
+	const uint32_t tailBlock = CreateBlock();
+	Block& head = Blocks[block];
+	Block& tail = Blocks[tailBlock];
+	tail.Offset = head.Offset + size;
+	tail.Size = head.Size - size;
+	tail.PreviousPhysical = block;
+	tail.NextPhysical = head.NextPhysical;
+	if (head.NextPhysical != InvalidBlock)
+	{
+		Blocks[head.NextPhysical].PreviousPhysical = tailBlock;
+	}
+	head.NextPhysical = tailBlock;
+	head.Size = size;
+	InsertFreeBlock(tailBlock);
+}
+
+void Renderer::TlsfAllocator::MergeNext(const uint32_t block)
+{
+	const uint32_t next = Blocks[block].NextPhysical;
+	Block& merged = Blocks[block];
+	merged.Size += Blocks[next].Size;
+	merged.NextPhysical = Blocks[next].NextPhysical;
+	if (merged.NextPhysical != InvalidBlock)
+	{
+		Blocks[merged.NextPhysical].PreviousPhysical = block;
+	}
+
+	Blocks[next] = Block();
+	UnusedBlocks.push_back(next);
+}
+
+uint32_t Renderer::TlsfAllocator::CreateBlock()
+{
+	if (!UnusedBlocks.empty())
+	{
+		const uint32_t block = UnusedBlocks.back();
+		UnusedBlocks.pop_back();
+		return block;
+	}
+
+	Blocks.emplace_back();
+	return static_cast<uint32_t>(Blocks.size() - 1);
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+namespace Renderer
+{
+	struct TlsfAllocation
+	{
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+		// Identifies the allocation when it is freed
+		uint32_t Block = UINT32_MAX;
+	};
+
+	struct TlsfStatistics
+	{
+		uint64_t Capacity = 0;
+		uint64_t UsedBytes = 0;
+		uint64_t FreeBytes = 0;
+		uint64_t LargestFreeBlock = 0;
+		uint32_t AllocationCount = 0;
+		uint32_t FreeBlockCount = 0;
+		uint32_t FailedAllocationCount = 0;
+		// Share of the free bytes outside the largest free block, 0 when all free memory is one block
+		float Fragmentation = 0.0f;
+	};
+
+	// Two level segregated fit allocator over an abstract range of bytes, with no knowledge of what the range holds so it can manage GPU
+	// heaps and buffers alike. Free blocks are kept in lists by size class, found through two levels of bitmaps: the first splits sizes
+	// by power of two, the second splits each power of two linearly. Allocation and freeing are constant time, freed blocks merge with
+	// free neighbours straight away. Sizes and offsets are multiples of the granularity. Not thread safe
+	class TlsfAllocator
+	{
+	public:
+		static constexpr uint32_t InvalidBlock = UINT32_MAX;
+		static constexpr uint64_t DefaultGranularity = 256;
+
+		// Granularity must be a power of two
+		void Init(const uint64_t capacity, const uint64_t granularity = DefaultGranularity);
+
+		// Alignment must be a power of two. Returns false when no free block can hold the allocation
+		bool Allocate(const uint64_t size, const uint64_t alignment, TlsfAllocation& outAllocation);
+		void Free(const uint32_t block);
+
+		uint64_t GetCapacity() const { return Capacity; }
+		bool IsEmpty() const { return AllocationCount == 0; }
+		TlsfStatistics GetStatistics() const;
+
+	private:
+		static constexpr uint32_t SecondLevelLog2 = 4;
+		static constexpr uint32_t SecondLevelCount = 1 << SecondLevelLog2;
+		static constexpr uint32_t FirstLevelCount = 32;
+
+		struct Block
+		{
+			uint64_t Offset = 0;
+			uint64_t Size = 0;
+			// Neighbours in the range, whether free or not
+			uint32_t PreviousPhysical = InvalidBlock;
+			uint32_t NextPhysical = InvalidBlock;
+			// Neighbours in the free list of the block's size class
+			uint32_t PreviousFree = InvalidBlock;
+			uint32_t NextFree = InvalidBlock;
+			bool Free = false;
+		};
+
+		// Size class of a size in units of the granularity
+		static void MapSize(const uint64_t units, uint32_t& outFirstLevel, uint32_t& outSecondLevel);
+		// First free block of the lowest size class at or above the given one, InvalidBlock when there is none
+		uint32_t FindFreeBlock(uint32_t firstLevel, uint32_t secondLevel) const;
+		void InsertFreeBlock(const uint32_t block);
+		void RemoveFreeBlock(const uint32_t block);
+		// Splits the end of a block into a new free block
+		void SplitFreeTail(const uint32_t block, const uint64_t size);
+		// Absorbs the next physical block into the block, the next block must not be in a free list
+		void MergeNext(const uint32_t block);
+		uint32_t CreateBlock();
+
+	private:
+		uint64_t Capacity = 0;
+		uint64_t Granularity = DefaultGranularity;
+		uint32_t GranularityLog2 = 0;
+
+		std::vector<Block> Blocks;
+		// Indices of blocks merged away, reused before the block vector grows
+		std::vector<uint32_t> UnusedBlocks;
+
+		uint32_t FirstLevelBitmap = 0;
+		std::array<uint32_t, FirstLevelCount> SecondLevelBitmaps = {};
+		std::array<std::array<uint32_t, SecondLevelCount>, FirstLevelCount> FreeLists = {};
+
+		uint64_t UsedBytes = 0;
+		uint32_t AllocationCount = 0;
+		uint32_t FreeBlockCount = 0;
+		uint32_t FailedAllocationCount = 0;
+	};
+}
\ No newline at end of file
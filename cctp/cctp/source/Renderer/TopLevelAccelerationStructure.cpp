@@ -3,28 +3,9 @@
 #include "BottomLevelAccelerationStructure.h"
 
 Renderer::TopLevelAccelerationStructure::TopLevelAccelerationStructure(ID3D12Device5* device, bool allowUpdate, uint32_t instanceCount)
-	: AllowUpdate(allowUpdate), InstanceCount(instanceCount)
+	: pDevice(device), AllowUpdate(allowUpdate), InstanceCount(instanceCount), Instances(instanceCount), InstanceBlases(instanceCount, nullptr),
+	InstanceVersions(instanceCount, 0), DirtyFlags(instanceCount, 0)
 {
-	// Create GPU resource for instance descriptions
-	auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * instanceCount);
-
-	if (FAILED(device->CreateCommittedResource(&heapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&resourceDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&InstancesBuffer))))
-	{
-		assert(false && "Failed to create GPU resource for tlas instance descriptions buffer.");
-	}
-
-	// Map the instance description buffer GPU resource
-	if (FAILED(InstancesBuffer->Map(0, nullptr, (void**)&MappedInstancesBufferLocation)))
-	{
-		assert(false && "Failed to map instance buffer during tlas construction.");
-	}
-
 	// Query memory requirements for GPU resources
 	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
 	inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
@@ -36,9 +17,10 @@ Renderer::TopLevelAccelerationStructure::TopLevelAccelerationStructure(ID3D12Dev
 	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info;
 	device->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
 
-	// Create GPU resources for tlas and scratch buffers
-	heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-	auto scratchDesc = CD3DX12_RESOURCE_DESC::Buffer(info.ScratchDataSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+	// Create GPU resources for tlas and scratch buffers. Scratch is shared by rebuilds and refits
+	auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	auto scratchDesc = CD3DX12_RESOURCE_DESC::Buffer(std::max(info.ScratchDataSizeInBytes, info.UpdateScratchDataSizeInBytes),
+		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
 
 	if (FAILED(device->CreateCommittedResource(&heapProperties,
 		D3D12_HEAP_FLAG_NONE,
@@ -64,8 +46,9 @@ Renderer::TopLevelAccelerationStructure::TopLevelAccelerationStructure(ID3D12Dev
 	}
 
 	BuildDesc.Inputs = inputs;
-	BuildDesc.Inputs.InstanceDescs = InstancesBuffer->GetGPUVirtualAddress();
+	BuildDesc.Inputs.InstanceDescs = 0;
 	BuildDesc.DestAccelerationStructureData = Tlas->GetGPUVirtualAddress();
+	BuildDesc.SourceAccelerationStructureData = 0;
 	BuildDesc.ScratchAccelerationStructureData = Scratch->GetGPUVirtualAddress();
 }
 
@@ -73,11 +56,144 @@ void Renderer::TopLevelAccelerationStructure::SetInstanceBlasAndTransform(const
 {
 	assert(instanceID < InstanceCount && "Setting instance transform with invalid instance ID.");
 
-	MappedInstancesBufferLocation[instanceID].InstanceID = instanceID;
-	MappedInstancesBufferLocation[instanceID].InstanceContributionToHitGroupIndex = 0;
-	MappedInstancesBufferLocation[instanceID].Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
+	auto& instance = Instances[instanceID];
+	instance.InstanceID = instanceID;
+	instance.InstanceContributionToHitGroupIndex = 0;
+	instance.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
+	instance.AccelerationStructure = blas.GetBlasGPUVirtualAddress();
+	instance.InstanceMask = 0xFF;
+
+	// Updates cannot change the structure an instance references
+	if (InstanceBlases[instanceID] != &blas)
+	{
+		InstanceBlases[instanceID] = &blas;
+		RebuildRequired = true;
+	}
+	SetInstanceTransform(instanceID, transformMatrix);
+}
+
+void Renderer::TopLevelAccelerationStructure::SetInstanceTransform(const uint32_t instanceID, const glm::mat4& transformMatrix)
+{
+	assert(instanceID < InstanceCount && "Setting instance transform with invalid instance ID.");
+
 	auto transformMatrixTransposed = glm::transpose(transformMatrix);
-	memcpy(MappedInstancesBufferLocation[instanceID].Transform, &transformMatrixTransposed, sizeof(MappedInstancesBufferLocation[instanceID].Transform));
-	MappedInstancesBufferLocation[instanceID].AccelerationStructure = blas.GetBlas()->GetGPUVirtualAddress();
-	MappedInstancesBufferLocation[instanceID].InstanceMask = 0xFF;
+	memcpy(Instances[instanceID].Transform, &transformMatrixTransposed, sizeof(Instances[instanceID].Transform));
+	MarkDirty(instanceID);
+}
+
+Renderer::TlasSyncAction Renderer::TopLevelAccelerationStructure::Sync(const uint64_t frameSerial, const uint64_t completedSerial, const bool forceRebuild)
+{
+	for (uint32_t i = 0; i < InstanceCount; ++i)
+	{
+		assert(InstanceBlases[i] != nullptr && "Every tlas instance needs a blas before the tlas is built.");
+		const auto blasAddress = InstanceBlases[i]->GetBlasGPUVirtualAddress();
+		if (Instances[i].AccelerationStructure != blasAddress)
+		{
+			Instances[i].AccelerationStructure = blasAddress;
+			MarkDirty(i);
+			RebuildRequired = true;
+		}
+	}
+
+	TlasSyncAction action = TlasSyncAction::Rebuild;
+	if (!forceRebuild && !RebuildRequired && AllowUpdate)
+	{
+		if (DirtyInstances.empty())
+		{
+			action = TlasSyncAction::Skip;
+		}
+		else if (RefitsSinceRebuild < MaxRefitsBeforeRebuild && DirtyInstances.size() <= InstanceCount * MaxRefitDirtyFraction)
+		{
+			action = TlasSyncAction::Refit;
+		}
+	}
+
+	if (action == TlasSyncAction::Skip)
+	{
+		++SyncStatistics.SkipCount;
+		return action;
+	}
+
+	// Write the instances changed since this buffer was last synced, which covers those changed since any other buffer was
+	auto& buffer = AcquireInstanceBuffer(completedSerial);
+	for (uint32_t i = 0; i < InstanceCount; ++i)
+	{
+		if (buffer.WrittenVersions[i] != InstanceVersions[i])
+		{
+			buffer.pMapped[i] = Instances[i];
+			buffer.WrittenVersions[i] = InstanceVersions[i];
+			++SyncStatistics.InstancesWritten;
+		}
+	}
+	buffer.FrameSerial = frameSerial;
+	BuildDesc.Inputs.InstanceDescs = buffer.Resource->GetGPUVirtualAddress();
+
+	for (const auto instanceID : DirtyInstances)
+	{
+		DirtyFlags[instanceID] = 0;
+	}
+	DirtyInstances.clear();
+
+	if (action == TlasSyncAction::Refit)
+	{
+		++RefitsSinceRebuild;
+		++SyncStatistics.RefitCount;
+	}
+	else
+	{
+		RebuildRequired = false;
+		RefitsSinceRebuild = 0;
+		++SyncStatistics.RebuildCount;
+	}
+	return action;
+}
+
+void Renderer::TopLevelAccelerationStructure::MarkDirty(const uint32_t instanceID)
+{
+	InstanceVersions[instanceID] = NextVersion++;
+	if (!DirtyFlags[instanceID])
+	{
+		DirtyFlags[instanceID] = 1;
+		DirtyInstances.push_back(instanceID);
+	}
+}
+
+Renderer::TopLevelAccelerationStructure::InstanceBuffer& Renderer::TopLevelAccelerationStructure::AcquireInstanceBuffer(const uint64_t completedSerial)
+{
+	for (size_t i = 0; i < InstanceBuffers.size(); ++i)
+	{
+		if (i != CurrentInstanceBuffer && InstanceBuffers[i].FrameSerial <= completedSerial)
+		{
+			CurrentInstanceBuffer = i;
+			return InstanceBuffers[i];
+		}
+	}
+
+	// Every buffer may still be read, create another
+	InstanceBuffer buffer;
+	auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * InstanceCount);
+
+	if (FAILED(pDevice->CreateCommittedResource(&heapProperties,
+		D3D12_HEAP_FLAG_NONE,
+		&resourceDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&buffer.Resource))))
+	{
+		assert(false && "Failed to create GPU resource for tlas instance descriptions buffer.");
+	}
+
+	// The buffer stays mapped for its lifetime, the CPU never reads it
+	D3D12_RANGE readRange(0, 0);
+	if (FAILED(buffer.Resource->Map(0, &readRange, reinterpret_cast<void**>(&buffer.pMapped))))
+	{
+		assert(false && "Failed to map instance buffer during tlas construction.");
+	}
+	buffer.WrittenVersions.assign(InstanceCount, 0);
+
+	InstanceBuffers.push_back(std::move(buffer));
+	CurrentInstanceBuffer = InstanceBuffers.size() - 1;
+	SyncStatistics.InstanceBufferCount = static_cast<uint32_t>(InstanceBuffers.size());
+	return InstanceBuffers.back();
 }
@@ -6,25 +6,91 @@ namespace Renderer
 {
 	class BottomLevelAccelerationStructure;
 
+	// How a tlas is brought up to date with its instances
+	enum class TlasSyncAction
+	{
+		// No instance changed since the last build
+		Skip,
+		// Update the previous build in place with the moved instances
+		Refit,
+		Rebuild
+	};
+
+	struct TlasSyncStatistics
+	{
+		uint32_t SkipCount = 0;
+		uint32_t RefitCount = 0;
+		uint32_t RebuildCount = 0;
+		uint64_t InstancesWritten = 0;
+		uint32_t InstanceBufferCount = 0;
+	};
+
+	// Instances are kept on the CPU and marked dirty when changed. Sync writes only the instances an instance buffer has not seen yet,
+	// and picks whether the tlas needs no build, a refit or a full build. Each sync writes a different instance buffer than the last one,
+	// reusing those frames in flight no longer read, so instances frames in flight still read are never overwritten
 	class TopLevelAccelerationStructure
 	{
 	public:
+		// Refits lower trace quality as instances move away from where they were built, so a tlas is rebuilt after this many in a row
+		static constexpr uint32_t MaxRefitsBeforeRebuild = 64;
+		// A tlas is rebuilt rather than refit when more than this share of its instances changed
+		static constexpr float MaxRefitDirtyFraction = 0.5f;
+
 		TopLevelAccelerationStructure(ID3D12Device5* device, bool allowUpdate, uint32_t instanceCount);
+		// The blas must outlive the tlas
 		void SetInstanceBlasAndTransform(const uint32_t instanceID, const BottomLevelAccelerationStructure& blas, const glm::mat4& transformMatrix);
+		void SetInstanceTransform(const uint32_t instanceID, const glm::mat4& transformMatrix);
+
+		// Writes changed instances into an instance buffer frames up to completedSerial have finished with, tagging it with frameSerial,
+		// the serial of the frame that builds with it, and points the build description at it. Instances of a blas that was compacted
+		// since the last build point at a different structure and need a full build. Call at most once per build
+		TlasSyncAction Sync(const uint64_t frameSerial, const uint64_t completedSerial, const bool forceRebuild = false);
+
+		// Instance descs point at the buffer written by the last sync
 		const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC& GetBuildDesc() const { return BuildDesc; }
 		ID3D12Resource* GetTlasResource() const { return Tlas.Get(); }
 		bool UpdateAllowed() const { return AllowUpdate; }
 		uint32_t GetInstanceCount() const { return InstanceCount; }
-		ID3D12Resource* GetInstancesBuffer() const { return InstancesBuffer.Get(); }
 		ID3D12Resource* GetScratchBuffer() const { return Scratch.Get(); }
+		size_t GetDirtyInstanceCount() const { return DirtyInstances.size(); }
+		const TlasSyncStatistics& GetSyncStatistics() const { return SyncStatistics; }
+
+	private:
+		struct InstanceBuffer
+		{
+			Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+			D3D12_RAYTRACING_INSTANCE_DESC* pMapped = nullptr;
+			// Version of each instance last written to the buffer, zero before the first write
+			std::vector<uint64_t> WrittenVersions;
+			uint64_t FrameSerial = 0;
+		};
+
+		void MarkDirty(const uint32_t instanceID);
+		// Returns a buffer other than the current one that no frame in flight reads, creating one when there is none
+		InstanceBuffer& AcquireInstanceBuffer(const uint64_t completedSerial);
 
 	private:
+		ID3D12Device5* pDevice;
 		bool AllowUpdate;
 		uint32_t InstanceCount;
 		Microsoft::WRL::ComPtr<ID3D12Resource> Tlas;
 		Microsoft::WRL::ComPtr<ID3D12Resource> Scratch;
-		Microsoft::WRL::ComPtr<ID3D12Resource> InstancesBuffer;
-		D3D12_RAYTRACING_INSTANCE_DESC* MappedInstancesBufferLocation;
 		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC BuildDesc;
+
+		// Reading mapped upload buffers back is slow, so instances are kept on the CPU and copied to a buffer when synced
+		std::vector<D3D12_RAYTRACING_INSTANCE_DESC> Instances;
+		std::vector<const BottomLevelAccelerationStructure*> InstanceBlases;
+		// Bumped each time an instance changes
+		std::vector<uint64_t> InstanceVersions;
+		uint64_t NextVersion = 1;
+		std::vector<uint8_t> DirtyFlags;
+		std::vector<uint32_t> DirtyInstances;
+		bool RebuildRequired = true;
+		uint32_t RefitsSinceRebuild = 0;
+
+		std::vector<InstanceBuffer> InstanceBuffers;
+		size_t CurrentInstanceBuffer = SIZE_MAX;
+
+		TlasSyncStatistics SyncStatistics;
 	};
 }
\ No newline at end of file
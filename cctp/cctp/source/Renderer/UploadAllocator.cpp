@@ -0,0 +1,145 @@
+#include "Pch.h"
+#include "UploadAllocator.h"
+
+bool Renderer::UploadAllocator::Init(ID3D12Device* pDevice, const UINT64 pageSize)
+{
+	this->pDevice = pDevice;
+	PageSize = pageSize;
+
+	// Create the first page up front so the first frame doesn't stall on resource creation
+	Page page = {};
+	if (!CreatePage(PageSize, page))
+	{
+		return false;
+	}
+
+	FreePages.push_back(std::move(page));
+	return true;
+}
+
+void Renderer::UploadAllocator::BeginFrame()
+{
+	assert(FramePages.empty() && FrameDedicatedPages.empty() && "EndFrame must be called before the next BeginFrame.");
+
+	std::erase_if(RetiredPages, [this](RetiredPage& retired)
+		{
+			if (retired.pFence->GetCompletedValue() < retired.FenceValue)
+			{
+				return false;
+			}
+
+			// Dedicated pages of large allocations are released rather than kept
+			if (retired.Page.Size == PageSize)
+			{
+				FreePages.push_back(std::move(retired.Page));
+			}
+			else
+			{
+				--PageCount;
+			}
+			return true;
+		});
+
+	PageOffset = 0;
+	FrameAllocatedBytes = 0;
+}
+
+bool Renderer::UploadAllocator::Allocate(const UINT64 size, const UINT64 alignment, UploadAllocation& outAllocation)
+{
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Upload allocation alignment must be a power of two.");
+
+	if (size > PageSize)
+	{
+		Page page = {};
+		if (!CreatePage(size, page))
+		{
+			return false;
+		}
+
+		outAllocation.pCPU = page.pCPU;
+		outAllocation.GPUAddress = page.GPUAddress;
+		FrameAllocatedBytes += size;
+
+		FrameDedicatedPages.push_back(std::move(page));
+		return true;
+	}
+
+	// Page GPU addresses are 64KB aligned, so aligning the offset aligns the address
+	UINT64 offset = (PageOffset + alignment - 1) & ~(alignment - 1);
+	if (FramePages.empty() || offset + size > FramePages.back().Size)
+	{
+		if (!FreePages.empty())
+		{
+			FramePages.push_back(std::move(FreePages.back()));
+			FreePages.pop_back();
+		}
+		else
+		{
+			Page page = {};
+			if (!CreatePage(PageSize, page))
+			{
+				return false;
+			}
+			FramePages.push_back(std::move(page));
+		}
+
+		offset = 0;
+	}
+
+	const Page& page = FramePages.back();
+	outAllocation.pCPU = page.pCPU + offset;
+	outAllocation.GPUAddress = page.GPUAddress + offset;
+	PageOffset = offset + size;
+	FrameAllocatedBytes += size;
+	return true;
+}
+
+void Renderer::UploadAllocator::EndFrame(ID3D12Fence* pFence, const UINT64 fenceValue)
+{
+	auto retirePages = [this, pFence, fenceValue](std::vector<Page>& pages)
+		{
+			for (auto& page : pages)
+			{
+				RetiredPage& retired = RetiredPages.emplace_back();
+				retired.Page = std::move(page);
+				retired.pFence = pFence;
+				retired.FenceValue = fenceValue;
+			}
+			pages.clear();
+		};
+
+	retirePages(FramePages);
+	retirePages(FrameDedicatedPages);
+}
+
+bool Renderer::UploadAllocator::CreatePage(const UINT64 size, Page& outPage)
+{
+	auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+	if (FAILED(pDevice->CreateCommittedResource(&heapProperties,
+		D3D12_HEAP_FLAG_NONE,
+		&resourceDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&outPage.Resource))))
+	{
+		DEBUG_LOG("ERROR: Failed to create upload page.");
+		return false;
+	}
+
+	// Upload pages stay mapped for their lifetime, the CPU never reads them
+	D3D12_RANGE readRange(0, 0);
+	void* pMapped;
+	if (FAILED(outPage.Resource->Map(0, &readRange, &pMapped)))
+	{
+		DEBUG_LOG("ERROR: Failed to map upload page.");
+		return false;
+	}
+
+	outPage.pCPU = static_cast<uint8_t*>(pMapped);
+	outPage.GPUAddress = outPage.Resource->GetGPUVirtualAddress();
+	outPage.Size = size;
+	++PageCount;
+	return true;
+}
\ No newline at end of file
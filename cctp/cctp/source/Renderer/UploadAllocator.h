@@ -0,0 +1,63 @@
+#pragma once
+
+namespace Renderer
+{
+	struct UploadAllocation
+	{
+		uint8_t* pCPU = nullptr;
+		D3D12_GPU_VIRTUAL_ADDRESS GPUAddress = 0;
+	};
+
+	// Linear allocator over persistently mapped upload heap pages, for data the CPU writes once and the GPU reads within the same frame.
+	// Pages used during a frame are retired with that frame's fence and only reused once the GPU has passed it, so frames in flight
+	// are never overwritten. Pages are created whenever no retired page is free, allocations larger than a page get a dedicated page
+	// that is released rather than reused
+	class UploadAllocator
+	{
+	public:
+		static constexpr UINT64 DefaultPageSize = 256 * 1024;
+
+		bool Init(ID3D12Device* pDevice, const UINT64 pageSize = DefaultPageSize);
+		// Returns pages whose fences have completed to the free list
+		void BeginFrame();
+		// Alignment must be a power of two
+		bool Allocate(const UINT64 size, const UINT64 alignment, UploadAllocation& outAllocation);
+		// Retires every page used since BeginFrame until pFence reaches fenceValue
+		void EndFrame(ID3D12Fence* pFence, const UINT64 fenceValue);
+
+		UINT64 GetFrameAllocatedBytes() const { return FrameAllocatedBytes; }
+		size_t GetPageCount() const { return PageCount; }
+
+	private:
+		struct Page
+		{
+			Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+			uint8_t* pCPU = nullptr;
+			D3D12_GPU_VIRTUAL_ADDRESS GPUAddress = 0;
+			UINT64 Size = 0;
+		};
+
+		struct RetiredPage
+		{
+			Page Page;
+			ID3D12Fence* pFence = nullptr;
+			UINT64 FenceValue = 0;
+		};
+
+		bool CreatePage(const UINT64 size, Page& outPage);
+
+	private:
+		ID3D12Device* pDevice = nullptr;
+		UINT64 PageSize = DefaultPageSize;
+
+		std::vector<Page> FreePages;
+		// Pages allocated from this frame, the last is the one being filled. Dedicated pages hold a single large allocation
+		std::vector<Page> FramePages;
+		std::vector<Page> FrameDedicatedPages;
+		std::vector<RetiredPage> RetiredPages;
+		UINT64 PageOffset = 0;
+
+		UINT64 FrameAllocatedBytes = 0;
+		size_t PageCount = 0;
+	};
+}
\ No newline at end of file
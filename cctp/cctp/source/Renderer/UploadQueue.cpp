@@ -0,0 +1,250 @@
+#include "Pch.h"
+#include "UploadQueue.h"
+
+namespace
+{
+	// Buffer copies have no alignment requirement, staged data is aligned for the CPU's copies into the ring
+	constexpr UINT64 RING_ALIGNMENT = 16;
+}
+
+bool Renderer::UploadQueue::Init(ID3D12Device* pDevice, const UINT64 ringSize)
+{
+	this->pDevice = pDevice;
+	RingSize = ringSize;
+
+	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	if (FAILED(pDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&CommandQueue))))
+	{
+		DEBUG_LOG("ERROR: Failed to create upload command queue.");
+		return false;
+	}
+
+	if (FAILED(pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&Fence))))
+	{
+		DEBUG_LOG("ERROR: Failed to create upload fence.");
+		return false;
+	}
+
+	auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(ringSize);
+	if (FAILED(pDevice->CreateCommittedResource(&heapProperties,
+		D3D12_HEAP_FLAG_NONE,
+		&resourceDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&Ring))))
+	{
+		DEBUG_LOG("ERROR: Failed to create upload staging ring.");
+		return false;
+	}
+
+	// The ring stays mapped for its lifetime, the CPU never reads it
+	D3D12_RANGE readRange(0, 0);
+	void* pMapped;
+	if (FAILED(Ring->Map(0, &readRange, &pMapped)))
+	{
+		DEBUG_LOG("ERROR: Failed to map upload staging ring.");
+		return false;
+	}
+	pRingCPU = static_cast<uint8_t*>(pMapped);
+	return true;
+}
+
+bool Renderer::UploadQueue::UploadBuffer(ID3D12Resource* pDestination, const UINT64 destinationOffset, const void* pData, const UINT64 size,
+	UploadTicket& outTicket)
+{
+	// Empty uploads record nothing, so no batch would be submitted to reach a ticket for them
+	if (size == 0)
+	{
+		outTicket = {};
+		return true;
+	}
+
+	const auto* pSource = static_cast<const uint8_t*>(pData);
+	for (UINT64 copied = 0; copied < size;)
+	{
+		// Chunks of half the ring let one chunk be staged while the copy of the one before runs
+		const UINT64 chunkSize = std::min(size - copied, RingSize / 2);
+		UINT64 ringOffset;
+		if (!AllocateRing(chunkSize, ringOffset) || (!BatchOpen && !OpenBatch()))
+		{
+			return false;
+		}
+
+		memcpy(pRingCPU + ringOffset, pSource + copied, chunkSize);
+		CurrentBatch.CommandList->CopyBufferRegion(pDestination, destinationOffset + copied, Ring.Get(), ringOffset, chunkSize);
+		copied += chunkSize;
+	}
+
+	UploadedBytes += size;
+	outTicket.FenceValue = LastSubmittedFenceValue + 1;
+	return true;
+}
+
+bool Renderer::UploadQueue::Submit()
+{
+	if (!BatchOpen)
+	{
+		return true;
+	}
+
+	if (FAILED(CurrentBatch.CommandList->Close()))
+	{
+		DEBUG_LOG("ERROR: Failed to close upload command list.");
+		return false;
+	}
+
+	ID3D12CommandList* commandLists[] = { CurrentBatch.CommandList.Get() };
+	CommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+
+	CurrentBatch.FenceValue = ++LastSubmittedFenceValue;
+	CurrentBatch.RingEnd = RingHead;
+	if (FAILED(CommandQueue->Signal(Fence.Get(), CurrentBatch.FenceValue)))
+	{
+		DEBUG_LOG("ERROR: Failed to signal upload fence.");
+		return false;
+	}
+
+	InFlightBatches.push_back(std::move(CurrentBatch));
+	CurrentBatch = Batch();
+	BatchOpen = false;
+	++SubmittedBatchCount;
+	return true;
+}
+
+bool Renderer::UploadQueue::Flush()
+{
+	if (!Submit() || !WaitForFenceValue(LastSubmittedFenceValue))
+	{
+		return false;
+	}
+
+	RetireBatches();
+	return true;
+}
+
+bool Renderer::UploadQueue::IsComplete(const UploadTicket ticket) const
+{
+	return ticket.FenceValue <= Fence->GetCompletedValue();
+}
+
+bool Renderer::UploadQueue::WaitOnQueue(ID3D12CommandQueue* pQueue, const UploadTicket ticket)
+{
+	if (IsComplete(ticket))
+	{
+		return true;
+	}
+
+	if (ticket.FenceValue > LastSubmittedFenceValue && !Submit())
+	{
+		return false;
+	}
+
+	return SUCCEEDED(pQueue->Wait(Fence.Get(), ticket.FenceValue));
+}
+
+bool Renderer::UploadQueue::Wait(const UploadTicket ticket)
+{
+	if (IsComplete(ticket))
+	{
+		return true;
+	}
+
+	if (ticket.FenceValue > LastSubmittedFenceValue && !Submit())
+	{
+		return false;
+	}
+
+	return WaitForFenceValue(ticket.FenceValue);
+}
+
+bool Renderer::UploadQueue::OpenBatch()
+{
+	if (!FreeBatches.empty())
+	{
+		CurrentBatch = std::move(FreeBatches.back());
+		FreeBatches.pop_back();
+
+		// The batch finished before it was freed, so its allocator can be reset
+		if (FAILED(CurrentBatch.Allocator->Reset()) || FAILED(CurrentBatch.CommandList->Reset(CurrentBatch.Allocator.Get(), nullptr)))
+		{
+			DEBUG_LOG("ERROR: Failed to reset upload command list.");
+			return false;
+		}
+	}
+	else
+	{
+		if (FAILED(pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&CurrentBatch.Allocator))) ||
+			FAILED(pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, CurrentBatch.Allocator.Get(), nullptr,
+				IID_PPV_ARGS(&CurrentBatch.CommandList))))
+		{
+			DEBUG_LOG("ERROR: Failed to create upload command list.");
+			return false;
+		}
+	}
+
+	BatchOpen = true;
+	return true;
+}
+
+void Renderer::UploadQueue::RetireBatches()
+{
+	const UINT64 completedValue = Fence->GetCompletedValue();
+	while (!InFlightBatches.empty() && InFlightBatches.front().FenceValue <= completedValue)
+	{
+		RingTail = InFlightBatches.front().RingEnd;
+		FreeBatches.push_back(std::move(InFlightBatches.front()));
+		InFlightBatches.pop_front();
+	}
+}
+
+bool Renderer::UploadQueue::AllocateRing(const UINT64 size, UINT64& outOffset)
+{
+	assert(size <= RingSize && "Upload is larger than the staging ring.");
+
+	for (;;)
+	{
+		RetireBatches();
+
+		// Once every batch has finished the ring starts over, so a chunk never needs to wrap around an empty ring
+		if (RingHead == RingTail)
+		{
+			RingHead = 0;
+			RingTail = 0;
+		}
+
+		// Data that would run past the end of the ring starts at its beginning instead, skipping the space left at the end
+		const UINT64 position = RingHead % RingSize;
+		UINT64 padding = ((position + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1)) - position;
+		if (position + padding + size > RingSize)
+		{
+			padding = RingSize - position;
+		}
+
+		if (RingHead + padding + size - RingTail <= RingSize)
+		{
+			outOffset = (RingHead + padding) % RingSize;
+			RingHead += padding + size;
+			return true;
+		}
+
+		// The ring is full. Submit what is staged so its space can be reclaimed, then wait for the oldest batch
+		if (!Submit() || InFlightBatches.empty())
+		{
+			return false;
+		}
+
+		++StallCount;
+		if (!WaitForFenceValue(InFlightBatches.front().FenceValue))
+		{
+			return false;
+		}
+	}
+}
+
+bool Renderer::UploadQueue::WaitForFenceValue(const UINT64 fenceValue)
+{
+	// Without an event the call returns once the fence reaches the value
+	return Fence->GetCompletedValue() >= fenceValue || SUCCEEDED(Fence->SetEventOnCompletion(fenceValue, nullptr));
+}
\ No newline at end of file
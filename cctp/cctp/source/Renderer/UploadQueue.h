@@ -0,0 +1,88 @@
+#pragma once
+
+#include <deque>
+
+namespace Renderer
+{
+	// Identifies the batch an upload was recorded in. The upload has finished once the upload queue's fence reaches the value,
+	// zero is never waited on
+	struct UploadTicket
+	{
+		UINT64 FenceValue = 0;
+	};
+
+	// Uploads buffer contents through a persistently mapped staging ring on a copy queue of its own. Uploads are recorded into an open
+	// batch that is submitted as a whole, and return the ticket of their batch rather than waiting for it. Callers wait on tickets on
+	// the GPU with WaitOnQueue, or test them with IsComplete. Ring space is reclaimed as batches finish, the CPU only blocks when the
+	// ring is full of uploads the GPU has not finished. Not thread safe
+	class UploadQueue
+	{
+	public:
+		static constexpr UINT64 DefaultRingSize = 32 * 1024 * 1024;
+
+		UploadQueue() = default;
+		UploadQueue(const UploadQueue&) = delete;
+		UploadQueue& operator=(const UploadQueue&) = delete;
+
+		bool Init(ID3D12Device* pDevice, const UINT64 ringSize = DefaultRingSize);
+
+		// Copies the data into the ring and records a copy from it into the destination buffer, which must be in the common state.
+		// Data larger than half the ring is split into several copies. Empty uploads return a zero ticket, which is already complete
+		bool UploadBuffer(ID3D12Resource* pDestination, const UINT64 destinationOffset, const void* pData, const UINT64 size, UploadTicket& outTicket);
+		// Submits the open batch, if it holds any uploads
+		bool Submit();
+		// Submits and blocks until every upload has finished
+		bool Flush();
+
+		bool IsComplete(const UploadTicket ticket) const;
+		// Makes the queue wait until the ticket's batch has finished without blocking the CPU, submitting the batch if it is still open
+		bool WaitOnQueue(ID3D12CommandQueue* pQueue, const UploadTicket ticket);
+		// Blocks the CPU until the ticket's batch has finished
+		bool Wait(const UploadTicket ticket);
+
+		UINT64 GetRingSize() const { return RingSize; }
+		UINT64 GetUploadedBytes() const { return UploadedBytes; }
+		uint32_t GetSubmittedBatchCount() const { return SubmittedBatchCount; }
+		// Times an upload blocked for ring space
+		uint32_t GetStallCount() const { return StallCount; }
+
+	private:
+		struct Batch
+		{
+			Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Allocator;
+			Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> CommandList;
+			UINT64 FenceValue = 0;
+			// Ring position after the batch's data, reclaimed once the batch finishes
+			UINT64 RingEnd = 0;
+		};
+
+		bool OpenBatch();
+		// Returns the ring space of finished batches
+		void RetireBatches();
+		bool AllocateRing(const UINT64 size, UINT64& outOffset);
+		bool WaitForFenceValue(const UINT64 fenceValue);
+
+	private:
+		ID3D12Device* pDevice = nullptr;
+		Microsoft::WRL::ComPtr<ID3D12CommandQueue> CommandQueue;
+		Microsoft::WRL::ComPtr<ID3D12Fence> Fence;
+		UINT64 LastSubmittedFenceValue = 0;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> Ring;
+		uint8_t* pRingCPU = nullptr;
+		UINT64 RingSize = 0;
+		// Bytes ever allocated from and reclaimed by the ring, their difference is the space in use
+		UINT64 RingHead = 0;
+		UINT64 RingTail = 0;
+
+		Batch CurrentBatch;
+		bool BatchOpen = false;
+		// Submitted in order, so they finish in order
+		std::deque<Batch> InFlightBatches;
+		std::vector<Batch> FreeBatches;
+
+		UINT64 UploadedBytes = 0;
+		uint32_t SubmittedBatchCount = 0;
+		uint32_t StallCount = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "Pch.h"
+#include "VertexCompression.h"
+#include "Math/glm/gtc/packing.hpp"
+
+namespace
+{
+	int16_t EncodeSnorm16(const float value)
+	{
+		return static_cast<int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * Renderer::VertexCompression::SNORM16_MAX));
+	}
+
+	// Matches D3D SNORM conversion, -32768 and -32767 both decode to -1
+	float DecodeSnorm16(const int16_t value)
+	{
+		return std::max(static_cast<float>(value) / Renderer::VertexCompression::SNORM16_MAX, -1.0f);
+	}
+
+	glm::vec2 SignNotZero(const glm::vec2& v)
+	{
+		return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	float AngleBetween(const glm::vec3& a, const glm::vec3& b)
+	{
+		// atan2 form stays accurate for the very small angles produced by quantization
+		return std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b));
+	}
+}
+
+Renderer::VertexCompression::QuantizationBounds Renderer::VertexCompression::CalculateQuantizationBounds(const std::vector<Vertex1Pos1UV1Norm>& vertices)
+{
+	QuantizationBounds bounds = {};
+	if (vertices.empty())
+	{
+		return bounds;
+	}
+
+	glm::vec3 min = vertices[0].Position;
+	glm::vec3 max = vertices[0].Position;
+	for (const auto& vertex : vertices)
+	{
+		min = glm::min(min, vertex.Position);
+		max = glm::max(max, vertex.Position);
+	}
+
+	bounds.Center = (min + max) * 0.5f;
+	bounds.HalfExtent = (max - min) * 0.5f;
+
+	// Flat meshes have no extent along an axis, keep the scale invertible
+	for (int i = 0; i < 3; ++i)
+	{
+		if (bounds.HalfExtent[i] <= 0.0f)
+		{
+			bounds.HalfExtent[i] = 1.0f;
+		}
+	}
+
+	return bounds;
+}
+
+glm::mat4 Renderer::VertexCompression::CalculateDequantizationMatrix(const QuantizationBounds& bounds)
+{
+	return glm::scale(glm::translate(glm::mat4(1.0f), bounds.Center), bounds.HalfExtent);
+}
+
+Renderer::CompressedVertex1Pos1UV1Norm Renderer::VertexCompression::EncodeVertex(const Vertex1Pos1UV1Norm& vertex, const QuantizationBounds& bounds)
+{
+	assert(glm::all(glm::lessThanEqual(glm::abs(vertex.UV), glm::vec2(HALF_MAX))) && "UV is out of half float range.");
+
+	CompressedVertex1Pos1UV1Norm compressed = {};
+
+	auto position = (vertex.Position - bounds.Center) / bounds.HalfExtent;
+	compressed.Position = glm::i16vec4(EncodeSnorm16(position.x), EncodeSnorm16(position.y), EncodeSnorm16(position.z), 0);
+
+	auto normal = OctEncode(glm::normalize(vertex.Normal));
+	compressed.Normal = glm::i16vec2(EncodeSnorm16(normal.x), EncodeSnorm16(normal.y));
+
+	compressed.UV = glm::u16vec2(glm::packHalf1x16(vertex.UV.x), glm::packHalf1x16(vertex.UV.y));
+
+	return compressed;
+}
+
+Renderer::Vertex1Pos1UV1Norm Renderer::VertexCompression::DecodeVertex(const CompressedVertex1Pos1UV1Norm& vertex, const QuantizationBounds& bounds)
+{
+	Vertex1Pos1UV1Norm decoded = {};
+
+	auto position = glm::vec3(DecodeSnorm16(vertex.Position.x), DecodeSnorm16(vertex.Position.y), DecodeSnorm16(vertex.Position.z));
+	decoded.Position = bounds.Center + position * bounds.HalfExtent;
+	decoded.Normal = OctDecode(glm::vec2(DecodeSnorm16(vertex.Normal.x), DecodeSnorm16(vertex.Normal.y)));
+	decoded.UV = glm::vec2(glm::unpackHalf1x16(vertex.UV.x), glm::unpackHalf1x16(vertex.UV.y));
+
+	return decoded;
+}
+
+Renderer::VertexCompression::CompressionErrorBounds Renderer::VertexCompression::CompressVertices(const std::vector<Vertex1Pos1UV1Norm>& vertices,
+	std::vector<CompressedVertex1Pos1UV1Norm>& outVertices, QuantizationBounds& outBounds)
+{
+	outBounds = CalculateQuantizationBounds(vertices);
+
+	CompressionErrorBounds errorBounds = {};
+
+	// Rounding moves each position component by at most half a quantization step
+	errorBounds.PositionBound = glm::length(outBounds.HalfExtent) * 0.5f / SNORM16_MAX;
+
+	// Half a step in each octahedral component moves the unnormalized vector by at most sqrt(1.5) steps,
+	// and the vector is never shorter than 1 / sqrt(3), giving sqrt(4.5) steps of angle
+	errorBounds.NormalAngleBoundRadians = std::sqrt(4.5f) / SNORM16_MAX;
+
+	float maxAbsUV = 0.0f;
+	for (const auto& vertex : vertices)
+	{
+		maxAbsUV = std::max({ maxAbsUV, std::abs(vertex.UV.x), std::abs(vertex.UV.y) });
+	}
+	errorBounds.UVBound = maxAbsUV * HALF_RELATIVE_ERROR;
+
+	outVertices.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		outVertices[i] = EncodeVertex(vertices[i], outBounds);
+
+		auto decoded = DecodeVertex(outVertices[i], outBounds);
+		errorBounds.MaxPositionError = std::max(errorBounds.MaxPositionError, glm::length(decoded.Position - vertices[i].Position));
+		errorBounds.MaxNormalAngleErrorRadians = std::max(errorBounds.MaxNormalAngleErrorRadians, AngleBetween(decoded.Normal, glm::normalize(vertices[i].Normal)));
+		errorBounds.MaxUVError = std::max({ errorBounds.MaxUVError, std::abs(decoded.UV.x - vertices[i].UV.x), std::abs(decoded.UV.y - vertices[i].UV.y) });
+	}
+
+	return errorBounds;
+}
+
+glm::vec2 Renderer::VertexCompression::OctEncode(const glm::vec3& normal)
+{
+	float l1norm = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	glm::vec2 result = glm::vec2(normal.x, normal.y) * (1.0f / l1norm);
+	if (normal.z < 0.0f)
+	{
+		result = (1.0f - glm::abs(glm::vec2(result.y, result.x))) * SignNotZero(result);
+	}
+	return result;
+}
+
+glm::vec3 Renderer::VertexCompression::OctDecode(const glm::vec2& encoded)
+{
+	glm::vec3 v = glm::vec3(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+	if (v.z < 0.0f)
+	{
+		auto xy = (1.0f - glm::abs(glm::vec2(v.y, v.x))) * SignNotZero(glm::vec2(v.x, v.y));
+		v.x = xy.x;
+		v.y = xy.y;
+	}
+	return glm::normalize(v);
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Renderer/Vertices/Vertex1Pos1UV1Norm.h"
+#include "Renderer/Vertices/CompressedVertex1Pos1UV1Norm.h"
+
+namespace Renderer
+{
+	namespace VertexCompression
+	{
+		constexpr float SNORM16_MAX = 32767.0f;
+		// Half floats store 11 significant bits, rounding error is at most 2^-11 relative to the value
+		constexpr float HALF_RELATIVE_ERROR = 1.0f / 2048.0f;
+		constexpr float HALF_MAX = 65504.0f;
+
+		// Positions are stored relative to the center of the mesh bounds and scaled by the half extent into [-1, 1]
+		struct QuantizationBounds
+		{
+			glm::vec3 Center = glm::vec3(0.0f);
+			glm::vec3 HalfExtent = glm::vec3(1.0f);
+		};
+
+		struct CompressionErrorBounds
+		{
+			// Worst case errors guaranteed by the encoding
+			float PositionBound = 0.0f;
+			float NormalAngleBoundRadians = 0.0f;
+			float UVBound = 0.0f;
+
+			// Largest errors measured while encoding
+			float MaxPositionError = 0.0f;
+			float MaxNormalAngleErrorRadians = 0.0f;
+			float MaxUVError = 0.0f;
+		};
+
+		QuantizationBounds CalculateQuantizationBounds(const std::vector<Vertex1Pos1UV1Norm>& vertices);
+
+		// Matrix that maps decoded [-1, 1] positions back into mesh local space. Fold into the world or instance transform
+		glm::mat4 CalculateDequantizationMatrix(const QuantizationBounds& bounds);
+
+		CompressedVertex1Pos1UV1Norm EncodeVertex(const Vertex1Pos1UV1Norm& vertex, const QuantizationBounds& bounds);
+		Vertex1Pos1UV1Norm DecodeVertex(const CompressedVertex1Pos1UV1Norm& vertex, const QuantizationBounds& bounds);
+
+		// Encodes every vertex and returns the error bounds of the encoding along with the measured errors
+		CompressionErrorBounds CompressVertices(const std::vector<Vertex1Pos1UV1Norm>& vertices, std::vector<CompressedVertex1Pos1UV1Norm>& outVertices,
+			QuantizationBounds& outBounds);
+
+		// Matches OctEncode and OctDecode in Shaders/Octahedral.hlsl
+		glm::vec2 OctEncode(const glm::vec3& normal);
+		glm::vec3 OctDecode(const glm::vec2& encoded);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Math/glm/gtc/type_precision.hpp"
+
+namespace Renderer
+{
+	// 16 byte counterpart of Vertex1Pos1UV1Norm, see Renderer/VertexCompression.h for encoding
+	struct CompressedVertex1Pos1UV1Norm
+	{
+		// R16G16B16A16_SNORM position relative to the mesh quantization bounds, w is unused
+		glm::i16vec4 Position = glm::i16vec4(0, 0, 0, 0);
+		// R16G16_SNORM octahedral encoded normal
+		glm::i16vec2 Normal = glm::i16vec2(0, 0);
+		// R16G16_FLOAT half precision texture coordinate
+		glm::u16vec2 UV = glm::u16vec2(0, 0);
+	};
+
+	static_assert(sizeof(CompressedVertex1Pos1UV1Norm) == 16, "Compressed vertex must be 16 bytes.");
+}
\ No newline at end of file
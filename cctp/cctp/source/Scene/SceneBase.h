@@ -9,7 +9,8 @@ public:
 
 	virtual void Begin() = 0;
 	virtual void Tick(float deltaTime) = 0;
-	virtual void Draw(UINT perObjectConstantsRootParamIndex) = 0;
+	// Records the scene's draws into the draw list, to be submitted with the given pipeline
+	virtual void Draw(Renderer::DrawList& drawList, Renderer::GraphicsPipelineBase* pPipeline) = 0;
 	virtual void DrawImGui() = 0;
 
 	const Renderer::Camera& GetMainCamera() const { return MainCamera; }
@@ -5,12 +5,78 @@
 #include "Input/InputCodes.h"
 #include "Events/EventSystem.h"
 #include "Window/Window.h"
+#include "Renderer/MeshOptimizer.h"
+#include "Renderer/MeshSimplifier.h"
+#include "Binary/Hash.h"
 
 bool IsInputPressed(InputCode input)
 {
 	return 0x80000000 & GetAsyncKeyState(input);
 }
 
+// Settings the probe sphere is generated from, hashed into the mesh cache source key so changing any of them regenerates the cache
+struct SphereMeshSettings
+{
+	float Radius = 1.0f;
+	uint32_t SliceCount = 32;
+	uint32_t StackCount = 32;
+	uint32_t MaxLODCount = static_cast<uint32_t>(Renderer::MeshSimplifier::MAX_LOD_COUNT);
+	float LODTriangleRatio = Renderer::MeshSimplifier::LOD_TRIANGLE_RATIO;
+	float LODMaxError = Renderer::MeshSimplifier::LOD_MAX_ERROR;
+	uint32_t VertexStride = sizeof(Renderer::CompressedVertex1Pos1UV1Norm);
+};
+
+void GenerateSphereMesh(const SphereMeshSettings& settings, const std::string& cacheFilepath, const uint64_t sourceKey,
+	std::unique_ptr<Renderer::Mesh>& mesh, Renderer::MeshletData& meshlets)
+{
+	std::vector<Renderer::Vertex1Pos1UV1Norm> sphereVertices;
+	std::vector<uint32_t> sphereIndices;
+	Renderer::Geometry::GenerateSphereGeometry(sphereVertices, sphereIndices, settings.Radius, settings.SliceCount, settings.StackCount);
+	auto sphereReport = Renderer::MeshOptimizer::OptimizeMesh(sphereVertices, sphereIndices, true);
+	DEBUG_LOG("Sphere ACMR: " + std::to_string(sphereReport.Before.ACMR) + " -> " + std::to_string(sphereReport.After.ACMR));
+	DEBUG_LOG("Sphere ATVR: " + std::to_string(sphereReport.Before.ATVR) + " -> " + std::to_string(sphereReport.After.ATVR));
+
+	// Probe spheres are small on screen so build levels of detail for them
+	std::vector<Renderer::MeshLOD> sphereLODs;
+	Renderer::MeshSimplifier::BuildLODChain(sphereVertices, sphereIndices, sphereLODs, settings.MaxLODCount);
+	for (size_t i = 1; i < sphereLODs.size(); ++i)
+	{
+		DEBUG_LOG("Sphere LOD " + std::to_string(i) + " triangles: " + std::to_string(sphereLODs[i].IndexCount / 3) +
+			" saved: " + std::to_string((sphereLODs[0].IndexCount - sphereLODs[i].IndexCount) / 3) +
+			" max screen size: " + std::to_string(sphereLODs[i].MaxScreenSize));
+	}
+
+	// Sphere is only rasterized so it uses compressed vertices
+	std::vector<Renderer::CompressedVertex1Pos1UV1Norm> compressedSphereVertices;
+	Renderer::VertexCompression::QuantizationBounds sphereBounds;
+	auto sphereErrors = Renderer::VertexCompression::CompressVertices(sphereVertices, compressedSphereVertices, sphereBounds);
+	DEBUG_LOG("Sphere vertex bytes: " + std::to_string(sizeof(Renderer::Vertex1Pos1UV1Norm) * sphereVertices.size()) +
+		" -> " + std::to_string(sizeof(Renderer::CompressedVertex1Pos1UV1Norm) * compressedSphereVertices.size()));
+	DEBUG_LOG("Sphere max position error: " + std::to_string(sphereErrors.MaxPositionError) + " bound: " + std::to_string(sphereErrors.PositionBound));
+	DEBUG_LOG("Sphere max normal error radians: " + std::to_string(sphereErrors.MaxNormalAngleErrorRadians) + " bound: " + std::to_string(sphereErrors.NormalAngleBoundRadians));
+
+	Renderer::MeshCache::MeshCacheData cacheData = {};
+	cacheData.pVertices = compressedSphereVertices.data();
+	cacheData.VertexCount = static_cast<uint32_t>(compressedSphereVertices.size());
+	cacheData.VertexStride = sizeof(Renderer::CompressedVertex1Pos1UV1Norm);
+	cacheData.PositionFormat = DXGI_FORMAT_R16G16B16A16_SNORM;
+	cacheData.pIndices = sphereIndices.data();
+	cacheData.IndexCount = static_cast<uint32_t>(sphereIndices.size());
+	cacheData.pLODs = sphereLODs.data();
+	cacheData.LODCount = static_cast<uint32_t>(sphereLODs.size());
+	cacheData.Bounds = sphereBounds;
+	if (!Renderer::MeshCache::WriteMeshCache(cacheFilepath, sourceKey, cacheData))
+	{
+		DEBUG_LOG("Failed to write sphere mesh cache " + cacheFilepath);
+	}
+
+	// Meshlets are built from the full precision vertices before the mesh takes ownership of the indices
+	Renderer::Meshlets::BuildMeshlets(sphereVertices, sphereIndices, sphereLODs[0].IndexOffset, sphereLODs[0].IndexCount, meshlets);
+
+	Renderer::CreateStagedMesh(std::move(compressedSphereVertices), sphereBounds, std::move(sphereIndices), L"SphereMesh", mesh);
+	mesh->SetLODs(sphereLODs);
+}
+
 DemoScene::DemoScene()
 	: ProbeVolume(ProbeVolumeStartPosition, ProbeVolumeExtents, ProbeVolumeProbeSpacing, ProbeVolumeDebugProbeScale)
 {
@@ -32,13 +98,43 @@ DemoScene::DemoScene()
 	std::vector<Renderer::Vertex1Pos1UV1Norm> cubeVertices;
 	std::vector<uint32_t> cubeIndices;
 	Renderer::Geometry::GenerateCubeGeometry(cubeVertices, cubeIndices, 1.0f);
-	Renderer::CreateStagedMesh(cubeVertices, cubeIndices, L"CubeMesh", Meshes[0]);
+	// Cube is not optimized, the closest hit shader reads cube vertices directly using the primitive index.
+	// Its CPU data is kept as the occluder geometry rasterized by occlusion culling
+	Renderer::CreateStagedMesh(std::move(cubeVertices), std::move(cubeIndices), L"CubeMesh", Meshes[0], true);
+
+	// Sphere mesh, generating it is slow so the result is cached on disk and mapped on later launches
+	auto sphereStart = std::chrono::high_resolution_clock::now();
+	const SphereMeshSettings sphereSettings = {};
+	const auto sphereSourceKey = Binary::HashBytes(&sphereSettings, sizeof(SphereMeshSettings));
+	const auto sphereCacheFilepath = Renderer::MeshCache::GetCacheFilepath("Sphere");
+
+	const bool sphereCached = Renderer::CreateStagedMeshFromCache(sphereCacheFilepath, sphereSourceKey, L"SphereMesh", Meshes[1]);
+	if (sphereCached)
+	{
+		// Meshlets of cached spheres are built from vertices decoded from the mapping, before it is released by the upload
+		std::vector<Renderer::Vertex1Pos1UV1Norm> sphereVertices;
+		std::vector<uint32_t> sphereIndices;
+		auto pCompressedVertices = static_cast<const Renderer::CompressedVertex1Pos1UV1Norm*>(Meshes[1]->GetVerticesData());
+		const auto& sphereBounds = Meshes[1]->GetQuantizationBounds();
+
+		sphereVertices.resize(Meshes[1]->GetVertexCount());
+		for (size_t i = 0; i < sphereVertices.size(); ++i)
+		{
+			sphereVertices[i] = Renderer::VertexCompression::DecodeVertex(pCompressedVertices[i], sphereBounds);
+		}
+		sphereIndices.assign(Meshes[1]->GetIndicesData(), Meshes[1]->GetIndicesData() + Meshes[1]->GetIndexCount());
 
-	// Sphere mesh
-	std::vector<Renderer::Vertex1Pos1UV1Norm> sphereVertices;
-	std::vector<uint32_t> sphereIndices;
-	Renderer::Geometry::GenerateSphereGeometry(sphereVertices, sphereIndices, 1.0f, 32, 32);
-	Renderer::CreateStagedMesh(sphereVertices, sphereIndices, L"SphereMesh", Meshes[1]);
+		// Split the full detail level into meshlets for cluster culling
+		const auto& sphereBaseLOD = Meshes[1]->GetLOD(0);
+		Renderer::Meshlets::BuildMeshlets(sphereVertices, sphereIndices, sphereBaseLOD.IndexOffset, sphereBaseLOD.IndexCount, SphereMeshlets);
+	}
+	else
+	{
+		GenerateSphereMesh(sphereSettings, sphereCacheFilepath, sphereSourceKey, Meshes[1], SphereMeshlets);
+	}
+	DEBUG_LOG("Sphere meshlets: " + std::to_string(SphereMeshlets.Meshlets.size()));
+	DEBUG_LOG("Sphere mesh " + std::string(sphereCached ? "mapped from cache" : "generated") + " in " +
+		std::to_string(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - sphereStart).count()) + " ms");
 
 	// Load meshes onto GPU
 	if (!Renderer::LoadStagedMeshesOntoGPU(Meshes.data(), Meshes.size()))
@@ -46,9 +142,6 @@ DemoScene::DemoScene()
 		assert(false && "Failed to load mesh data onto GPU.");
 	}
 
-	// Add cube vertex srv descriptor to shader descriptor heap
-	Renderer::AddSRVDescriptorToShaderVisibleHeap(Meshes[0]->GetVertexBuffer(), &Meshes[0]->GetVertexBufferSRVDesc(), Renderer::CUBE_VERTEX_BUFFER_SRV_DESCRIPTOR_INDEX);
-
 	// Create bottom level acceleration structures
 	blAccelStructures.resize(1);
 
@@ -62,53 +155,58 @@ DemoScene::DemoScene()
 	}
 
 	// Setup scene mesh transforms and colors
-	MeshTransforms.resize(SceneMeshTransformCount);
+	MeshTransforms.Resize(SceneMeshTransformCount);
 	MeshMaterials.resize(SceneMeshTransformCount);
 	assert(MeshMaterials.size() <= Renderer::MAX_MATERIAL_COUNT && 
 		"Demo scene is creating an unsupported number of materials. Consider reducing the number of materials used by the scene.");
 
 	// Floor
-	MeshTransforms[0].Position = glm::vec3(0.0f, -0.5f, 0.0f);
-	MeshTransforms[0].Scale = glm::vec3(4.9f, 0.49f, 4.9f);
+	MeshTransforms.SetPosition(0, glm::vec3(0.0f, -0.5f, 0.0f));
+	MeshTransforms.SetScale(0, glm::vec3(4.9f, 0.49f, 4.9f));
 	MeshMaterials[0].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
 
 	// Identity cube
-	MeshTransforms[1].Position = glm::vec3(1.0f, 0.25f, -0.5f);
-	MeshTransforms[1].Scale = glm::vec3(1.0f, 1.0f, 1.0f);
+	MeshTransforms.SetPosition(1, glm::vec3(1.0f, 0.25f, -0.5f));
+	MeshTransforms.SetScale(1, glm::vec3(1.0f, 1.0f, 1.0f));
 	MeshMaterials[1].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
 
 	// Right wall
-	MeshTransforms[2].Position = glm::vec3(2.25f, 1.75f, 0.0f);
-	MeshTransforms[2].Scale = glm::vec3(0.5f, 5.0f, 5.0f);
+	MeshTransforms.SetPosition(2, glm::vec3(2.25f, 1.75f, 0.0f));
+	MeshTransforms.SetScale(2, glm::vec3(0.5f, 5.0f, 5.0f));
 	MeshMaterials[2].SetColor(glm::vec4(0.0f, 0.5f, 0.0f, 1.0f));
 
 	// Left wall
-	MeshTransforms[3].Position = glm::vec3(-2.25f, 1.75f, 0.0f);
-	MeshTransforms[3].Scale = glm::vec3(0.5f, 5.0f, 5.0f);
+	MeshTransforms.SetPosition(3, glm::vec3(-2.25f, 1.75f, 0.0f));
+	MeshTransforms.SetScale(3, glm::vec3(0.5f, 5.0f, 5.0f));
 	MeshMaterials[3].SetColor(glm::vec4(0.8f, 0.0f, 0.0f, 1.0f));
 
 	// Back wall
-	MeshTransforms[4].Position = glm::vec3(0.0f, 1.75f, 2.65f);
-	MeshTransforms[4].Scale = glm::vec3(5.0f, 5.0f, 0.5f);
+	MeshTransforms.SetPosition(4, glm::vec3(0.0f, 1.75f, 2.65f));
+	MeshTransforms.SetScale(4, glm::vec3(5.0f, 5.0f, 0.5f));
 	MeshMaterials[4].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
 
 	// Transformed cube
-	MeshTransforms[5].Position = glm::vec3(-1.0f, 0.5f, 0.5f);
-	MeshTransforms[5].Rotation = glm::vec3(0.0f, 45.0f, 0.0f);
-	MeshTransforms[5].Scale = glm::vec3(1.0f, 2.0f, 1.0f);
+	MeshTransforms.SetPosition(5, glm::vec3(-1.0f, 0.5f, 0.5f));
+	MeshTransforms.SetRotation(5, glm::vec3(0.0f, 45.0f, 0.0f));
+	MeshTransforms.SetScale(5, glm::vec3(1.0f, 2.0f, 1.0f));
 	MeshMaterials[5].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
 
 	// Ceiling
-	MeshTransforms[6].Position = glm::vec3(0.0f, 4.0f, 0.0f);
-	MeshTransforms[6].Scale = glm::vec3(4.9f, 0.49f, 4.9f);
+	MeshTransforms.SetPosition(6, glm::vec3(0.0f, 4.0f, 0.0f));
+	MeshTransforms.SetScale(6, glm::vec3(4.9f, 0.49f, 4.9f));
 	MeshMaterials[6].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
 
 	// Door
-	MeshTransforms[7].Position = glm::vec3(DoorOpenX, 1.75f, -2.65f);
-	MeshTransforms[7].Scale = glm::vec3(5.0f, 5.0f, 0.5f);
+	MeshTransforms.SetPosition(7, glm::vec3(DoorOpenX, 1.75f, -2.65f));
+	MeshTransforms.SetScale(7, glm::vec3(5.0f, 5.0f, 0.5f));
 	MeshMaterials[7].SetColor(glm::vec4(0.8f, 0.8f, 0.8f, 1.0f));
-	DoorStartX = MeshTransforms[7].Position.x;
+	DoorStartX = MeshTransforms.GetPosition(7).x;
 	DoorTargetX = DoorStartX;
+	MeshTransforms.UpdateDirty();
+
+	SceneBounds.Resize(SceneMeshTransformCount);
+	ProbeBounds.Resize(ProbeVolume.GetProbeTransforms().GetCount());
+	OcclusionBuffer.Resize(OcclusionBufferWidth, OcclusionBufferHeight);
 
 	// Create top level acceleration structure
 	Renderer::CreateTopLevelAccelerationStructure(tlAccelStructure, true, static_cast<uint32_t>(SceneMeshTransformCount));
@@ -116,7 +214,7 @@ DemoScene::DemoScene()
 	// Set tlas instances
 	for (size_t i = 0; i < SceneMeshTransformCount; ++i)
 	{
-		tlAccelStructure->SetInstanceBlasAndTransform(static_cast<uint32_t>(i), *blAccelStructures[0].get(), Math::CalculateWorldMatrix(MeshTransforms[i]));
+		tlAccelStructure->SetInstanceBlasAndTransform(static_cast<uint32_t>(i), *blAccelStructures[0].get(), MeshTransforms.GetMatrices(static_cast<uint32_t>(i)).WorldMatrix);
 	}
 
 	// Build tlas
@@ -137,30 +235,146 @@ void DemoScene::Tick(float deltaTime)
 {
 	PollInputs(deltaTime);
 
+	// Only mark the door dirty while it moves, static transforms keep their cached matrices
 	float doorX = glm::lerp(0.0f, DoorTargetX, LerpAccum);
-	MeshTransforms[7].Position.x = doorX;
+	const auto& doorPosition = MeshTransforms.GetPosition(7);
+	if (doorPosition.x != doorX)
+	{
+		MeshTransforms.SetPosition(7, glm::vec3(doorX, doorPosition.y, doorPosition.z));
+	}
 
 	if (OpenDoor)
 	{
 		LerpAccum = std::clamp(LerpAccum + deltaTime * DoorOpenSpeed, 0.0f, 1.0f);
 	}
+
+	MeshTransforms.UpdateDirty();
+	ProbeVolume.Update();
+
+	// Moved objects mark their tlas instances dirty, the next tlas sync writes and refits only those
+	for (const auto index : MeshTransforms.GetUpdatedIndices())
+	{
+		tlAccelStructure->SetInstanceTransform(index, MeshTransforms.GetMatrices(index).WorldMatrix);
+	}
 }
 
-void DemoScene::Draw(UINT perObjectConstantsRootParamIndex)
+void DemoScene::Cull(const glm::vec2& viewportDims)
 {
-	for (size_t i = 0; i < SceneMeshTransformCount; ++i)
+	// Bounds are rebuilt every frame, there are few enough objects that this is cheaper than tracking which transforms moved
+	const auto& cubeBounds = Meshes[0]->GetLocalBounds();
+	for (uint32_t i = 0; i < SceneMeshTransformCount; ++i)
+	{
+		SceneBounds.Set(i, cubeBounds, MeshTransforms.GetMatrices(i).WorldMatrix);
+	}
+
+	const auto& sphereBounds = Meshes[1]->GetLocalBounds();
+	const auto& probeTransforms = ProbeVolume.GetProbeTransforms();
+	for (uint32_t i = 0; i < probeTransforms.GetCount(); ++i)
 	{
-		// Cube meshes
-		Renderer::Commands::SubmitMesh(perObjectConstantsRootParamIndex, *Meshes[0].get(), MeshTransforms[i], MeshMaterials[i].GetColor(), true);
+		ProbeBounds.Set(i, sphereBounds, probeTransforms.GetMatrices(i).WorldMatrix);
 	}
 
+	const auto viewProjectionMatrix = Renderer::CalculateProjectionMatrix(MainCamera, viewportDims) *
+		Math::CalculateViewMatrix(MainCamera.Position, MainCamera.Rotation);
+	const auto cameraFrustum = Math::ExtractFrustum(viewProjectionMatrix);
+	const auto lightFrustum = Math::ExtractFrustum(Renderer::CalculateLightMatrix(LightDirectionWS));
+
+	Renderer::CullBoxes(SceneBounds, lightFrustum, VisibleShadowIndices);
+	Renderer::CullBoxes(SceneBounds, cameraFrustum, VisibleCameraIndices);
+	Renderer::CullBoxes(ProbeBounds, cameraFrustum, VisibleProbeIndices);
+
+	OcclusionCulledObjectCount = 0;
+	OcclusionCulledProbeCount = 0;
+	OcclusionTestedCount = VisibleCameraIndices.size() + VisibleProbeIndices.size();
+	if (!OcclusionCullingEnabled)
+	{
+		OcclusionCullingMilliseconds = 0.0;
+		return;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const auto& cubeMesh = *Meshes[0].get();
+	OcclusionBuffer.Clear();
+	for (auto i : OccluderIndices)
+	{
+		OcclusionBuffer.AddOccluder(cubeMesh.GetVerticesData(), cubeMesh.GetVertexStride(), cubeMesh.GetIndicesData(), cubeMesh.GetIndexCount(),
+			viewProjectionMatrix * MeshTransforms.GetMatrices(i).WorldMatrix);
+	}
+	OcclusionBuffer.Rasterize();
+
+	// Occluders are tested too, objects are never hidden by their own faces
+	auto isHidden = [this, &viewProjectionMatrix](const Math::AABB& box)
+	{
+		return !OcclusionBuffer.IsVisible(box, viewProjectionMatrix);
+	};
+	auto visibleCameraCount = VisibleCameraIndices.size();
+	std::erase_if(VisibleCameraIndices, [this, &isHidden](const uint32_t i) { return isHidden(SceneBounds.Get(i)); });
+	OcclusionCulledObjectCount = visibleCameraCount - VisibleCameraIndices.size();
+
+	auto visibleProbeCount = VisibleProbeIndices.size();
+	std::erase_if(VisibleProbeIndices, [this, &isHidden](const uint32_t i) { return isHidden(ProbeBounds.Get(i)); });
+	OcclusionCulledProbeCount = visibleProbeCount - VisibleProbeIndices.size();
+
+	OcclusionCullingMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void DemoScene::Draw(Renderer::DrawList& drawList, Renderer::GraphicsPipelineBase* pPipeline)
+{
+	const auto pass = static_cast<uint32_t>(CurrentDrawPass);
+	const auto& visibleIndices = CurrentDrawPass == DrawPass::Shadow ? VisibleShadowIndices : VisibleCameraIndices;
+
+	// Every scene object is a cube, so the pass sorts into a single instanced draw. Material colors are per instance data rather than
+	// bound state, so every draw uses material 0 and instances are ordered front to back from the camera
+	for (auto i : visibleIndices)
+	{
+		drawList.Add(pass, pPipeline, *Meshes[0].get(), 0, 0, CalculateSortDepth(MeshTransforms.GetPosition(i)), MeshTransforms.GetMatrices(i),
+			MeshMaterials[i].GetColor(), true);
+	}
+}
+
+void DemoScene::DrawProbeSpheres(Renderer::DrawList& drawList, Renderer::GraphicsPipelineBase* pPipeline, const glm::vec2& viewportDims)
+{
+	SphereMeshletStatistics = {};
+	const auto pass = static_cast<uint32_t>(DrawPass::Camera);
+
 	// Probe debug spheres
 	if (DrawProbes)
 	{
+		const auto viewProjectionMatrix = Renderer::CalculateProjectionMatrix(MainCamera, viewportDims) *
+			Math::CalculateViewMatrix(MainCamera.Position, MainCamera.Rotation);
+
+		// Height of the view frustum at a distance of one unit from the camera
+		const float frustumHeightPerUnit = 2.0f * std::tan(glm::radians(MainCamera.Settings.PerspectiveFOV) * 0.5f);
+		const auto& sphereLODs = Meshes[1]->GetLODs();
+
 		const auto& probeTransforms = ProbeVolume.GetProbeTransforms();
-		for (const auto& transform : probeTransforms)
+		for (auto i : VisibleProbeIndices)
 		{
-			Renderer::Commands::SubmitMesh(perObjectConstantsRootParamIndex, *Meshes[1].get(), transform, glm::vec4(0.1f, 0.9f, 0.9f, 1.0f), false);
+			// Select level of detail from the projected diameter of the sphere in pixels
+			const auto& scale = probeTransforms.GetScale(i);
+			const auto& matrices = probeTransforms.GetMatrices(i);
+			auto diameter = 2.0f * std::max({ scale.x, scale.y, scale.z });
+			const auto& position = probeTransforms.GetPosition(i);
+			auto distance = glm::length(position - MainCamera.Position);
+			auto lod = distance > diameter ?
+				Renderer::MeshSimplifier::SelectLOD(sphereLODs, diameter / (distance * frustumHeightPerUnit) * viewportDims.y) : 0;
+
+			if (lod == 0)
+			{
+				// Full detail spheres are large on screen, cull their meshlets in sphere local space
+				const auto& worldMatrix = matrices.WorldMatrix;
+				auto frustumLS = Math::ExtractFrustum(viewProjectionMatrix * worldMatrix);
+				auto cameraPositionLS = glm::vec3(glm::inverse(worldMatrix) * glm::vec4(MainCamera.Position, 1.0f));
+				Renderer::Meshlets::CullMeshlets(SphereMeshlets, frustumLS, cameraPositionLS, VisibleSphereRanges, SphereMeshletStatistics);
+
+				drawList.AddRanges(pass, pPipeline, *Meshes[1].get(), VisibleSphereRanges, 0, CalculateSortDepth(position), matrices,
+					glm::vec4(0.1f, 0.9f, 0.9f, 1.0f), false);
+				continue;
+			}
+
+			// Reduced detail spheres sort into one instanced draw per level of detail
+			drawList.Add(pass, pPipeline, *Meshes[1].get(), lod, 0, CalculateSortDepth(position), matrices, glm::vec4(0.1f, 0.9f, 0.9f, 1.0f), false);
 		}
 	}
 }
@@ -173,11 +387,46 @@ void DemoScene::DrawImGui()
 	if (ImGui::Button("Slide Door"))
 	{
 		OpenDoor = true;
-		MeshTransforms[7].Position.x = 0.0f;
+		const auto& doorPosition = MeshTransforms.GetPosition(7);
+		MeshTransforms.SetPosition(7, glm::vec3(0.0f, doorPosition.y, doorPosition.z));
 		LerpAccum = 0.0f;
 		DoorTargetX = DoorOpenX;
 	}
 	ImGui::End();
+
+	if (ShowVisibilityStatistics)
+	{
+		ImGui::Begin("Visibility", &ShowVisibilityStatistics, ImGuiWindowFlags_AlwaysAutoResize);
+		ImGui::Text("Camera objects: %zu / %zu", VisibleCameraIndices.size(), SceneBounds.GetCount());
+		ImGui::Text("Shadow objects: %zu / %zu", VisibleShadowIndices.size(), SceneBounds.GetCount());
+		ImGui::Text("Probe spheres: %zu / %zu", VisibleProbeIndices.size(), ProbeBounds.GetCount());
+		ImGui::Separator();
+		ImGui::Checkbox("Occlusion culling", &OcclusionCullingEnabled);
+		ImGui::Text("Occluded objects: %zu", OcclusionCulledObjectCount);
+		ImGui::Text("Occluded probe spheres: %zu", OcclusionCulledProbeCount);
+		ImGui::Text("Draws occlusion culled: %.1f%%", OcclusionTestedCount > 0 ?
+			100.0 * (OcclusionCulledObjectCount + OcclusionCulledProbeCount) / OcclusionTestedCount : 0.0);
+		ImGui::Text("Occluder triangles: %zu", OcclusionBuffer.GetOccluderTriangleCount());
+		ImGui::Text("Occlusion CPU time: %.3f ms", OcclusionCullingMilliseconds);
+		ImGui::Separator();
+		ImGui::Text("Draw calls: %u for %u instances", Renderer::GetFrameDrawCount(), Renderer::GetFrameInstanceCount());
+		ImGui::Text("State changes avoided: %u", Renderer::GetFrameStateChangesAvoided());
+		ImGui::Separator();
+		const auto& tlasStatistics = tlAccelStructure->GetSyncStatistics();
+		ImGui::Text("Tlas syncs: %u skipped, %u refit, %u rebuilt", tlasStatistics.SkipCount, tlasStatistics.RefitCount, tlasStatistics.RebuildCount);
+		ImGui::Text("Tlas instances written: %llu", static_cast<unsigned long long>(tlasStatistics.InstancesWritten));
+		ImGui::End();
+	}
+
+	if (DrawProbes && SphereMeshletStatistics.MeshletCount > 0)
+	{
+		ImGui::Begin("Probe sphere meshlets", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+		ImGui::Text("Meshlets: %u", SphereMeshletStatistics.MeshletCount);
+		ImGui::Text("Frustum culled: %u", SphereMeshletStatistics.FrustumCulledCount);
+		ImGui::Text("Backface culled: %u", SphereMeshletStatistics.BackfaceCulledCount);
+		ImGui::Text("Triangles: %u / %u", SphereMeshletStatistics.VisibleTriangleCount, SphereMeshletStatistics.TriangleCount);
+		ImGui::End();
+	}
 }
 
 void DemoScene::OnInputEvent(InputEvent&& event)
@@ -261,3 +510,9 @@ void DemoScene::PollInputs(float deltaTime)
 		}
 	}
 }
+
+
+float DemoScene::CalculateSortDepth(const glm::vec3& positionWS) const
+{
+	return glm::length(positionWS - MainCamera.Position) / MainCamera.Settings.PerspectiveFarClipPlane;
+}
\ No newline at end of file
@@ -1,20 +1,36 @@
 #pragma once
 
 #include "Scene/SceneBase.h"
-#include "Math/Transform.h"
+#include "Math/TransformStorage.h"
 #include "Renderer/Material.h"
 #include "Renderer/ProbeVolume.h"
+#include "Renderer/Meshlets.h"
+#include "Renderer/FrustumCulling.h"
+#include "Renderer/OcclusionCulling.h"
 
 struct InputEvent;
 
 class DemoScene : public SceneBase
 {
+public:
+	// Selects the visible set Draw submits
+	enum class DrawPass
+	{
+		Shadow,
+		Camera
+	};
+
 public:
 	DemoScene();
 	void Begin() final;
 	void Tick(float deltaTime) final;
-	void Draw(UINT perObjectConstantsRootParamIndex) final;
+	void Draw(Renderer::DrawList& drawList, Renderer::GraphicsPipelineBase* pPipeline) final;
 	void DrawImGui() final;
+	// Probe spheres use compressed vertices and must be drawn with a CompressedGraphicsPipeline
+	void DrawProbeSpheres(Renderer::DrawList& drawList, Renderer::GraphicsPipelineBase* pPipeline, const glm::vec2& viewportDims);
+	// Tests scene objects against the camera and light frustums and probe spheres against the camera frustum, then removes camera visible
+	// objects and probe spheres hidden behind the walls, filling the visible index lists read by Draw and DrawProbeSpheres. Call once per frame after Tick
+	void Cull(const glm::vec2& viewportDims);
 
 	Renderer::TopLevelAccelerationStructure* GetTlas() const { return tlAccelStructure.get(); }
 	glm::vec3& GetProbeVolumePositionWS() { return ProbeVolume.GetVolumePosition(); }
@@ -24,6 +40,8 @@ public:
 	const Renderer::Material* GetMaterialsPtr() const { return MeshMaterials.data(); }
 	size_t GetMaterialCount() const { return MeshMaterials.size(); }
 	void SetDrawProbes(const bool draw) { DrawProbes = draw; }
+	void SetDrawPass(const DrawPass pass) { CurrentDrawPass = pass; }
+	bool& GetShowVisibilityStatistics() { return ShowVisibilityStatistics; }
 	const auto& GetMeshes() const { return Meshes; }
 
 public:
@@ -34,6 +52,8 @@ public:
 private:
 	void OnInputEvent(InputEvent&& event);
 	void PollInputs(float deltaTime);
+	// Distance from the camera scaled to [0, 1] by the far plane, used to sort draws front to back
+	float CalculateSortDepth(const glm::vec3& positionWS) const;
 
 private:
 	static constexpr size_t SceneMeshTransformCount = 8;
@@ -47,15 +67,41 @@ private:
 	static constexpr glm::vec3 ProbeVolumeExtents = glm::vec3(5.0f);
 	static constexpr float ProbeVolumeProbeSpacing = 0.99f;
 	static constexpr float ProbeVolumeDebugProbeScale = 0.05f;
+	static constexpr uint32_t OcclusionBufferWidth = 256;
+	static constexpr uint32_t OcclusionBufferHeight = 128;
+	// Floor, walls, ceiling and door are large enough to hide other objects
+	static constexpr std::array<uint32_t, 6> OccluderIndices = { 0, 2, 3, 4, 6, 7 };
 
 	Renderer::ProbeVolume ProbeVolume;
 
 	std::vector<std::unique_ptr<Renderer::Mesh>> Meshes;
 	std::vector<std::unique_ptr<Renderer::BottomLevelAccelerationStructure>> blAccelStructures;
 	std::unique_ptr<Renderer::TopLevelAccelerationStructure> tlAccelStructure;
-	std::vector<Transform> MeshTransforms;
+	TransformStorage MeshTransforms;
 	std::vector<Renderer::Material> MeshMaterials;
 
+	// Meshlets of the full detail sphere, used to cull clusters of probe spheres close to the camera
+	Renderer::MeshletData SphereMeshlets;
+	std::vector<Renderer::IndexRange> VisibleSphereRanges;
+	Renderer::MeshletCullStatistics SphereMeshletStatistics;
+
+	// World space bounds of scene objects and probe spheres, and the indices of those visible to each pass
+	Renderer::CullingBoxes SceneBounds;
+	Renderer::CullingBoxes ProbeBounds;
+	std::vector<uint32_t> VisibleShadowIndices;
+	std::vector<uint32_t> VisibleCameraIndices;
+	std::vector<uint32_t> VisibleProbeIndices;
+	DrawPass CurrentDrawPass = DrawPass::Camera;
+	bool ShowVisibilityStatistics = false;
+
+	// Occluders are rasterized from the camera each frame, objects and probe spheres passing the camera frustum test are tested against them
+	Renderer::OcclusionBuffer OcclusionBuffer;
+	bool OcclusionCullingEnabled = true;
+	size_t OcclusionCulledObjectCount = 0;
+	size_t OcclusionCulledProbeCount = 0;
+	size_t OcclusionTestedCount = 0;
+	double OcclusionCullingMilliseconds = 0.0;
+
 	glm::vec3 LightDirectionWS = glm::vec3(-0.5f, -0.3f, 1.0f);
 	float LightIntensity = 1.0f;
 
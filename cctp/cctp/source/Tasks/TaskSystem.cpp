@@ -0,0 +1,144 @@
+#include "Pch.h"
+#include "TaskSystem.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+
+namespace
+{
+	// Batches per thread, more batches balance uneven work at the cost of queue traffic
+	constexpr size_t BATCHES_PER_THREAD = 4;
+
+	std::vector<std::thread> Workers;
+	std::deque<std::function<void()>> Tasks;
+	std::mutex TaskMutex;
+	std::condition_variable TaskAvailable;
+	bool ShuttingDown = false;
+
+	bool TryRunTask()
+	{
+		std::function<void()> task;
+		{
+			std::lock_guard<std::mutex> lock(TaskMutex);
+			if (Tasks.empty())
+			{
+				return false;
+			}
+			task = std::move(Tasks.front());
+			Tasks.pop_front();
+		}
+
+		task();
+		return true;
+	}
+
+	void WorkerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(TaskMutex);
+				TaskAvailable.wait(lock, []() { return ShuttingDown || !Tasks.empty(); });
+				if (Tasks.empty())
+				{
+					return;
+				}
+				task = std::move(Tasks.front());
+				Tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+}
+
+bool TaskSystem::Init()
+{
+	if (!Workers.empty())
+	{
+		return false;
+	}
+
+	// The main thread also works while waiting on a parallel for, so leave one hardware thread for it
+	auto workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+	ShuttingDown = false;
+	Workers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		Workers.emplace_back(WorkerLoop);
+	}
+
+	return true;
+}
+
+bool TaskSystem::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(TaskMutex);
+		ShuttingDown = true;
+	}
+	TaskAvailable.notify_all();
+
+	for (auto& worker : Workers)
+	{
+		worker.join();
+	}
+	Workers.clear();
+
+	return true;
+}
+
+uint32_t TaskSystem::GetWorkerCount()
+{
+	return static_cast<uint32_t>(Workers.size());
+}
+
+void TaskSystem::ParallelFor(const size_t count, const size_t minBatchSize, const std::function<void(size_t, size_t)>& func)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	auto batchCount = std::min((count + std::max(minBatchSize, size_t(1)) - 1) / std::max(minBatchSize, size_t(1)),
+		(Workers.size() + 1) * BATCHES_PER_THREAD);
+	if (Workers.empty() || batchCount <= 1)
+	{
+		func(0, count);
+		return;
+	}
+
+	const auto batchSize = (count + batchCount - 1) / batchCount;
+	batchCount = (count + batchSize - 1) / batchSize;
+
+	std::atomic<size_t> remainingBatches = batchCount - 1;
+	{
+		std::lock_guard<std::mutex> lock(TaskMutex);
+		for (size_t batch = 1; batch < batchCount; ++batch)
+		{
+			auto begin = batch * batchSize;
+			auto end = std::min(begin + batchSize, count);
+			Tasks.emplace_back([&func, &remainingBatches, begin, end]()
+				{
+					func(begin, end);
+					remainingBatches.fetch_sub(1, std::memory_order_release);
+				});
+		}
+	}
+	TaskAvailable.notify_all();
+
+	func(0, std::min(batchSize, count));
+
+	// Help with queued work instead of blocking until the other batches finish
+	while (remainingBatches.load(std::memory_order_acquire) > 0)
+	{
+		if (!TryRunTask())
+		{
+			std::this_thread::yield();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+
+// Persistent worker threads for splitting CPU work into parallel batches. Work runs on the calling thread when the system is not initialized
+namespace TaskSystem
+{
+	bool Init();
+	bool Shutdown();
+	uint32_t GetWorkerCount();
+
+	// Calls func(begin, end) over batches of [0, count) of at least minBatchSize items and waits for all of them to finish.
+	// The calling thread processes batches while it waits, so parallel for calls may be nested
+	void ParallelFor(const size_t count, const size_t minBatchSize, const std::function<void(size_t, size_t)>& func);
+}
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include "Pch.h"
+#include "Test.h"
+#include "FrameGraph.h"
+#include "Renderer/CommandStream.h"
+#include "Renderer/NullCommandBackend.h"
+#include "Tasks/TaskSystem.h"
+
+namespace
+{
+	using Graph = Renderer::RenderGraph;
+
+	constexpr uint32_t FRAME_COUNT = 8;
+	constexpr uint32_t DRAWS_PER_PASS = 64;
+	constexpr uint32_t MESH_COUNT = 8;
+	constexpr auto DRAW_INDEX = static_cast<uint32_t>(Renderer::CommandType::DrawIndexedInstanced);
+
+	// Records the deferred frame with draws in every pass, as the renderer would. Native objects are never dereferenced without a
+	// graphics API, any distinct non zero values stand in for them
+	class FrameRecorder
+	{
+	public:
+		FrameRecorder()
+		{
+			RecordPass = [this](const uint32_t pass) { RecordPassInto(*pActiveStream, pass); };
+			Tests::BuildDeferredFrameGraph(FrameGraph, PassAccesses, RecordPass);
+			Compiled = FrameGraph.Compile(Tests::QueryFrameAllocation);
+			NativeResources.resize(FrameGraph.GetResourceCount());
+		}
+
+		void RecordFrame(Renderer::CommandStream& stream)
+		{
+			pActiveStream = &stream;
+			stream.Reset();
+			stream.SetDescriptorHeap(&NativeHeap);
+			stream.SetPrimitiveTopology(4);
+			FrameGraph.Execute([&](const Graph::Barrier* pBarriers, const uint32_t barrierCount)
+				{
+					RecordBarriersInto(stream, pBarriers, barrierCount, Barriers);
+				});
+			stream.Native([](void*, void*) {}, nullptr);
+		}
+
+		// Each live pass records into a stream of its own, as the renderer gives each its own command list. Every stream starts by
+		// binding the state the frame set before the passes, the final barriers get a stream after them
+		void RecordFrameInParallel(std::vector<Renderer::CommandStream>& streams)
+		{
+			std::vector<Graph::PassHandle> livePasses;
+			for (Graph::PassHandle pass = 0; pass < FrameGraph.GetPassCount(); ++pass)
+			{
+				if (!FrameGraph.IsPassCulled(pass))
+				{
+					livePasses.push_back(pass);
+				}
+			}
+
+			streams.resize(livePasses.size() + 1);
+			std::vector<std::vector<Renderer::ResourceBarrier>> streamBarriers(streams.size());
+			TaskSystem::ParallelFor(livePasses.size(), 1, [&](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; ++i)
+					{
+						auto& stream = streams[i];
+						const auto& barriers = FrameGraph.GetPassBarriers(livePasses[i]);
+						stream.Reset();
+						stream.SetDescriptorHeap(&NativeHeap);
+						stream.SetPrimitiveTopology(4);
+						RecordBarriersInto(stream, barriers.data(), static_cast<uint32_t>(barriers.size()), streamBarriers[i]);
+						RecordPassInto(stream, livePasses[i]);
+					}
+				});
+
+			auto& finalStream = streams.back();
+			const auto& finalBarriers = FrameGraph.GetFinalBarriers();
+			finalStream.Reset();
+			RecordBarriersInto(finalStream, finalBarriers.data(), static_cast<uint32_t>(finalBarriers.size()), streamBarriers.back());
+			finalStream.Native([](void*, void*) {}, nullptr);
+		}
+
+		bool IsCompiled() const { return Compiled; }
+		uint32_t GetLivePassCount() const { return FrameGraph.GetPassCount() - FrameGraph.GetStatistics().CulledPassCount; }
+
+	private:
+		void RecordPassInto(Renderer::CommandStream& stream, const uint32_t pass)
+		{
+			stream.SetViewport(0.0f, 0.0f, 1920.0f, 1080.0f, 0.0f, 1.0f, 0, 0, 1920, 1080);
+			stream.SetRenderTargets(pass + 1, 0);
+			stream.ClearRenderTarget(pass + 1, {});
+			stream.SetGraphicsPipeline(&NativePipeline, &NativeRootSignature);
+			stream.SetGraphicsRootConstantBufferView(1, 0x1000);
+			stream.SetGraphicsRootDescriptorTable(3, 0x2000);
+
+			// Draws are sorted by mesh, so buffers change once per mesh run
+			for (uint32_t draw = 0; draw < DRAWS_PER_PASS; ++draw)
+			{
+				const uint32_t mesh = draw * MESH_COUNT / DRAWS_PER_PASS;
+				if (draw == 0 || mesh != (draw - 1) * MESH_COUNT / DRAWS_PER_PASS)
+				{
+					stream.SetVertexBuffer(0x100000 * (mesh + 1), 0x10000, 32);
+					stream.SetIndexBuffer(0x100000 * (mesh + 1) + 0x10000, 0x8000, 42);
+				}
+				stream.SetGraphicsRootShaderResourceView(0, 0x3000 + draw * 256);
+				stream.DrawIndexedInstanced(3 * (64 + mesh * 16), 1 + draw % 4, 0, 0, 0);
+			}
+		}
+
+		void RecordBarriersInto(Renderer::CommandStream& stream, const Graph::Barrier* pBarriers, const uint32_t barrierCount,
+			std::vector<Renderer::ResourceBarrier>& barriers)
+		{
+			barriers.resize(barrierCount);
+			for (uint32_t i = 0; i < barrierCount; ++i)
+			{
+				const auto& barrier = pBarriers[i];
+				barriers[i].BarrierType = barrier.BarrierType;
+				barriers[i].AccessBefore = barrier.AccessBefore;
+				barriers[i].AccessAfter = barrier.AccessAfter;
+				barriers[i].pResource = &NativeResources[barrier.Resource];
+				barriers[i].pResourceBefore = barrier.ResourceBefore != Graph::InvalidHandle ? &NativeResources[barrier.ResourceBefore] : nullptr;
+			}
+			stream.ResourceBarriers(barriers.data(), barrierCount);
+		}
+
+	private:
+		Graph FrameGraph;
+		std::vector<std::vector<Tests::FramePassAccess>> PassAccesses;
+		std::function<void(uint32_t)> RecordPass;
+		Renderer::CommandStream* pActiveStream = nullptr;
+		std::vector<Renderer::ResourceBarrier> Barriers;
+		bool Compiled = false;
+
+		std::vector<uint64_t> NativeResources;
+		uint64_t NativePipeline = 0;
+		uint64_t NativeRootSignature = 0;
+		uint64_t NativeHeap = 0;
+	};
+}
+
+TEST_CASE(CommandStream, PacketsAreVisitedInRecordingOrder)
+{
+	Renderer::CommandStream stream;
+	stream.SetPrimitiveTopology(4);
+	stream.SetVertexBuffer(0x1000, 0x100, 32);
+	Renderer::ResourceBarrier barriers[3] = {};
+	stream.ResourceBarriers(barriers, 3);
+	stream.DrawIndexedInstanced(3, 1, 0, 0, 0);
+
+	const Renderer::CommandType expectedTypes[] = { Renderer::CommandType::SetPrimitiveTopology, Renderer::CommandType::SetVertexBuffer,
+		Renderer::CommandType::ResourceBarriers, Renderer::CommandType::DrawIndexedInstanced };
+	std::vector<Renderer::CommandType> types;
+	size_t byteSize = 0;
+	stream.ForEach([&](const Renderer::CommandHeader& header)
+		{
+			types.push_back(header.Type);
+			byteSize += header.Size;
+		});
+
+	CHECK(types == std::vector<Renderer::CommandType>(std::begin(expectedTypes), std::end(expectedTypes)));
+	CHECK(stream.GetCommandCount() == std::size(expectedTypes));
+	// Trailing barriers are counted in the size of their packet
+	CHECK(byteSize == stream.GetByteSize());
+
+	stream.Reset();
+	CHECK(stream.GetCommandCount() == 0);
+	CHECK(stream.GetByteSize() == 0);
+}
+
+TEST_CASE(CommandStream, FramesValidateOnTheNullBackend)
+{
+	FrameRecorder recorder;
+	REQUIRE(recorder.IsCompiled());
+
+	// Submitting frame after frame also checks resources are left in the accesses the next frame expects
+	Renderer::CommandStream stream;
+	Renderer::NullCommandBackend backend;
+	for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+	{
+		recorder.RecordFrame(stream);
+		CHECK(backend.Submit(stream));
+	}
+
+	const auto& statistics = backend.GetStatistics();
+	CHECK(statistics.ErrorCount == 0);
+	CHECK(statistics.SubmitCount == FRAME_COUNT);
+	CHECK(statistics.CommandCounts[DRAW_INDEX] == FRAME_COUNT * recorder.GetLivePassCount() * DRAWS_PER_PASS);
+	CHECK(statistics.BarrierCount > 0);
+}
+
+TEST_CASE(CommandStream, ParallelStreamsValidateInOrder)
+{
+	FrameRecorder recorder;
+	REQUIRE(recorder.IsCompiled());
+
+	// Tracked accesses carry from one stream to the next, so the streams only validate when submitted in pass order
+	std::vector<Renderer::CommandStream> streams;
+	Renderer::NullCommandBackend backend;
+	for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+	{
+		recorder.RecordFrameInParallel(streams);
+		for (const auto& stream : streams)
+		{
+			CHECK(backend.Submit(stream));
+		}
+	}
+
+	Renderer::CommandStream singleStream;
+	Renderer::NullCommandBackend singleBackend;
+	recorder.RecordFrame(singleStream);
+	singleBackend.Submit(singleStream);
+
+	const auto& statistics = backend.GetStatistics();
+	CHECK(statistics.ErrorCount == 0);
+	CHECK(statistics.CommandCounts[DRAW_INDEX] == FRAME_COUNT * singleBackend.GetStatistics().CommandCounts[DRAW_INDEX]);
+	CHECK(statistics.BarrierCount == FRAME_COUNT * singleBackend.GetStatistics().BarrierCount);
+}
+
+TEST_CASE(CommandStream, BrokenStreamsAreRejected)
+{
+	// A draw before any pipeline and a transition from the wrong access must both be reported
+	uint64_t nativeResource = 0;
+	Renderer::CommandStream stream;
+	stream.SetPrimitiveTopology(4);
+	stream.SetViewport(0.0f, 0.0f, 64.0f, 64.0f, 0.0f, 1.0f, 0, 0, 64, 64);
+	stream.SetRenderTargets(1, 0);
+	stream.SetVertexBuffer(0x1000, 0x100, 32);
+	stream.SetIndexBuffer(0x2000, 0x100, 42);
+	stream.DrawIndexedInstanced(3, 1, 0, 0, 0);
+
+	Renderer::ResourceBarrier barriers[2] = {};
+	barriers[0].pResource = &nativeResource;
+	barriers[0].AccessBefore = Graph::AccessRenderTarget;
+	barriers[0].AccessAfter = Graph::AccessPixelShaderResource;
+	barriers[1] = barriers[0];
+	stream.ResourceBarriers(barriers, 2);
+
+	Renderer::NullCommandBackend backend;
+	CHECK(!backend.Submit(stream));
+	CHECK(backend.GetStatistics().ErrorCount == 2);
+
+	// Tracking forgets the resource, so its first transition is trusted again
+	backend.ResetTracking();
+	Renderer::CommandStream barrierStream;
+	barrierStream.ResourceBarriers(barriers, 1);
+	CHECK(backend.Submit(barrierStream));
+}
\ No newline at end of file
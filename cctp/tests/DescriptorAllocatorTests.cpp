@@ -0,0 +1,209 @@
+#include "Pch.h"
+#include "Test.h"
+#include "Renderer/DescriptorAllocator.h"
+#include "Tasks/TaskSystem.h"
+#include <random>
+
+namespace
+{
+	using Allocator = Renderer::DescriptorAllocator;
+
+	constexpr uint32_t PERSISTENT_COUNT = 4096;
+	constexpr uint32_t TRANSIENT_COUNT = 1024;
+	constexpr uint32_t FRAMES_IN_FLIGHT = 3;
+	constexpr uint32_t FRAME_COUNT = 500;
+	// Ranges allocated and freed each frame, from single descriptors up to small tables
+	constexpr uint32_t CHURN_PER_FRAME = 16;
+	constexpr uint32_t MAX_RANGE = 8;
+
+	struct LiveRange
+	{
+		uint32_t Index = 0;
+		uint32_t Count = 0;
+	};
+
+	// Fills half the heap with persistent ranges, then churns it frame by frame as a streaming scene would. Owners hold the state of every
+	// descriptor: zero is free, a frame serial marks a descriptor freed in that frame, otherwise it holds the live range's id
+	struct PersistentChurn
+	{
+		static constexpr uint64_t LiveBit = 1ull << 63;
+
+		Allocator DescriptorAllocator;
+		std::vector<uint64_t> Owners = std::vector<uint64_t>(PERSISTENT_COUNT, 0);
+		std::vector<LiveRange> LiveRanges;
+		std::mt19937 Generator = std::mt19937(0);
+		uint64_t NextId = 1;
+		uint64_t Serial = 0;
+		bool Disjoint = true;
+		bool RetiredBeforeReuse = true;
+
+		void Allocate(const uint64_t completedSerial)
+		{
+			const uint32_t count = std::uniform_int_distribution<uint32_t>(1, MAX_RANGE)(Generator);
+			const uint32_t index = DescriptorAllocator.AllocatePersistent(count);
+			if (index == Allocator::InvalidIndex)
+			{
+				return;
+			}
+
+			const uint64_t id = LiveBit | NextId++;
+			for (uint32_t i = index; i < index + count; ++i)
+			{
+				Disjoint &= (Owners[i] & LiveBit) == 0;
+				RetiredBeforeReuse &= Owners[i] <= completedSerial;
+				Owners[i] = id;
+			}
+			LiveRanges.push_back({ index, count });
+		}
+
+		void Run()
+		{
+			DescriptorAllocator.Init(PERSISTENT_COUNT, TRANSIENT_COUNT, FRAMES_IN_FLIGHT);
+			while (DescriptorAllocator.GetStatistics().PersistentAllocatedCount < PERSISTENT_COUNT / 2)
+			{
+				Allocate(0);
+			}
+
+			for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+			{
+				// Frames complete in order, the one started frames in flight ago has finished
+				++Serial;
+				const uint64_t completedSerial = Serial > FRAMES_IN_FLIGHT ? Serial - FRAMES_IN_FLIGHT : 0;
+				DescriptorAllocator.BeginFrame(static_cast<uint32_t>(Serial % FRAMES_IN_FLIGHT), completedSerial);
+
+				for (uint32_t i = 0; i < CHURN_PER_FRAME && !LiveRanges.empty(); ++i)
+				{
+					const size_t victim = std::uniform_int_distribution<size_t>(0, LiveRanges.size() - 1)(Generator);
+					const auto range = LiveRanges[victim];
+					LiveRanges[victim] = LiveRanges.back();
+					LiveRanges.pop_back();
+
+					DescriptorAllocator.FreePersistent(range.Index, range.Count, Serial);
+					std::fill(Owners.begin() + range.Index, Owners.begin() + range.Index + range.Count, Serial);
+				}
+
+				for (uint32_t i = 0; i < CHURN_PER_FRAME; ++i)
+				{
+					Allocate(completedSerial);
+				}
+			}
+		}
+	};
+}
+
+TEST_CASE(DescriptorAllocator, LiveRangesNeverOverlap)
+{
+	PersistentChurn churn;
+	churn.Run();
+	CHECK(churn.Disjoint);
+
+	uint32_t liveCount = 0;
+	for (const auto& range : churn.LiveRanges)
+	{
+		liveCount += range.Count;
+	}
+	// Freed ranges stay allocated until their frame retires
+	const auto statistics = churn.DescriptorAllocator.GetStatistics();
+	CHECK(statistics.PersistentAllocatedCount == liveCount + statistics.PendingFreeCount);
+}
+
+TEST_CASE(DescriptorAllocator, FreedRangesAreNotReusedBeforeTheirFrameRetires)
+{
+	PersistentChurn churn;
+	churn.Run();
+	CHECK(churn.RetiredBeforeReuse);
+	CHECK(churn.DescriptorAllocator.GetStatistics().PendingFreeCount > 0);
+}
+
+TEST_CASE(DescriptorAllocator, FreeListMergesBackIntoOneRange)
+{
+	PersistentChurn churn;
+	churn.Run();
+
+	// Freeing everything and retiring every frame must leave a single range covering the persistent part of the heap
+	for (const auto& range : churn.LiveRanges)
+	{
+		churn.DescriptorAllocator.FreePersistent(range.Index, range.Count, churn.Serial);
+	}
+	churn.DescriptorAllocator.BeginFrame(0, churn.Serial);
+
+	const auto statistics = churn.DescriptorAllocator.GetStatistics();
+	CHECK(statistics.FreeRangeCount == 1);
+	CHECK(statistics.LargestFreeRange == PERSISTENT_COUNT);
+	CHECK(statistics.PersistentAllocatedCount == 0);
+	CHECK(statistics.PendingFreeCount == 0);
+}
+
+TEST_CASE(DescriptorAllocator, ExhaustedHeapFailsAllocations)
+{
+	Allocator allocator;
+	allocator.Init(16, 4, 2);
+	CHECK(allocator.GetDescriptorCount() == 24);
+
+	CHECK(allocator.AllocatePersistent(16) == 0);
+	CHECK(allocator.AllocatePersistent(1) == Allocator::InvalidIndex);
+	CHECK(allocator.GetStatistics().FailedAllocationCount == 1);
+
+	// A freed range is only handed out again once its serial completes
+	allocator.FreePersistent(4, 4, 1);
+	CHECK(allocator.AllocatePersistent(4) == Allocator::InvalidIndex);
+	allocator.BeginFrame(0, 1);
+	CHECK(allocator.AllocatePersistent(4) == 4);
+}
+
+TEST_CASE(DescriptorAllocator, TransientRangesAreDisjointAcrossThreads)
+{
+	Allocator allocator;
+	allocator.Init(PERSISTENT_COUNT, TRANSIENT_COUNT, FRAMES_IN_FLIGHT);
+	allocator.BeginFrame(1, 0);
+
+	// More tables than fit are requested from every thread at once, those past the frame's range must fail
+	constexpr uint32_t tableSize = 4;
+	constexpr uint32_t allocationCount = TRANSIENT_COUNT / tableSize + 16;
+	std::vector<uint32_t> indices(allocationCount);
+	TaskSystem::ParallelFor(allocationCount, 16, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				indices[i] = allocator.AllocateTransient(tableSize);
+			}
+		});
+
+	const uint32_t frameBegin = PERSISTENT_COUNT + TRANSIENT_COUNT;
+	std::vector<bool> used(TRANSIENT_COUNT, false);
+	uint32_t failures = 0;
+	for (const uint32_t index : indices)
+	{
+		if (index == Allocator::InvalidIndex)
+		{
+			++failures;
+			continue;
+		}
+
+		REQUIRE(index >= frameBegin && index + tableSize <= frameBegin + TRANSIENT_COUNT);
+		for (uint32_t i = index - frameBegin; i < index - frameBegin + tableSize; ++i)
+		{
+			CHECK(!used[i]);
+			used[i] = true;
+		}
+	}
+	CHECK(failures == allocationCount - TRANSIENT_COUNT / tableSize);
+}
+
+TEST_CASE(DescriptorAllocator, TransientRangeResetsWhenItsFrameStartsAgain)
+{
+	Allocator allocator;
+	allocator.Init(PERSISTENT_COUNT, TRANSIENT_COUNT, FRAMES_IN_FLIGHT);
+
+	std::array<uint32_t, FRAMES_IN_FLIGHT> firstIndices;
+	for (uint32_t frame = 0; frame < FRAMES_IN_FLIGHT; ++frame)
+	{
+		allocator.BeginFrame(frame, 0);
+		firstIndices[frame] = allocator.AllocateTransient(TRANSIENT_COUNT);
+		CHECK(firstIndices[frame] == PERSISTENT_COUNT + TRANSIENT_COUNT * frame);
+		CHECK(allocator.AllocateTransient(1) == Allocator::InvalidIndex);
+	}
+
+	allocator.BeginFrame(0, 0);
+	CHECK(allocator.AllocateTransient(1) == firstIndices[0]);
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "Pch.h"
+#include "FrameGraph.h"
+
+namespace
+{
+	constexpr uint32_t BLOOM_LEVEL_COUNT = 5;
+	constexpr uint64_t TEXTURE_ALIGNMENT = 64 * 1024;
+}
+
+void Tests::BuildDeferredFrameGraph(Renderer::RenderGraph& graph, std::vector<std::vector<FramePassAccess>>& passAccesses,
+	const std::function<void(uint32_t)>& onExecute)
+{
+	using Graph = Renderer::RenderGraph;
+
+	graph.Reset();
+	passAccesses.clear();
+
+	auto texture = [&graph](const char* name, const uint32_t width, const uint32_t height, const uint32_t bytesPerPixel)
+	{
+		Graph::TextureDesc desc;
+		desc.Width = width;
+		desc.Height = height;
+		desc.Format = bytesPerPixel;
+		return graph.CreateTexture(name, desc);
+	};
+	auto addPass = [&](const char* name)
+	{
+		const uint32_t index = graph.GetPassCount();
+		passAccesses.emplace_back();
+		return graph.AddPass(name, [&onExecute, index]() { onExecute(index); });
+	};
+	auto read = [&](const Graph::PassHandle pass, const Graph::ResourceHandle resource, const uint32_t access)
+	{
+		graph.Read(pass, resource, access);
+		passAccesses[pass].push_back({ resource, access, false });
+	};
+	auto write = [&](const Graph::PassHandle pass, const Graph::ResourceHandle resource, const uint32_t access)
+	{
+		graph.Write(pass, resource, access);
+		passAccesses[pass].push_back({ resource, access, true });
+	};
+
+	const auto backBuffer = graph.ImportTexture("Back buffer", nullptr, Graph::AccessRenderTarget, Graph::AccessRenderTarget);
+	const auto shadowMap = texture("Shadow map", 2048, 2048, 4);
+	const auto albedo = texture("Albedo", 1920, 1080, 4);
+	const auto normals = texture("Normals", 1920, 1080, 8);
+	const auto depth = texture("Depth", 1920, 1080, 4);
+	const auto ambientOcclusion = texture("Ambient occlusion", 1920, 1080, 1);
+	const auto lighting = texture("Lighting", 1920, 1080, 8);
+	const auto debugView = texture("Debug view", 1920, 1080, 4);
+
+	auto pass = addPass("Shadow map");
+	write(pass, shadowMap, Graph::AccessDepthWrite);
+
+	pass = addPass("GBuffer");
+	write(pass, albedo, Graph::AccessRenderTarget);
+	write(pass, normals, Graph::AccessRenderTarget);
+	write(pass, depth, Graph::AccessDepthWrite);
+
+	pass = addPass("Ambient occlusion");
+	read(pass, normals, Graph::AccessNonPixelShaderResource);
+	read(pass, depth, Graph::AccessNonPixelShaderResource);
+	write(pass, ambientOcclusion, Graph::AccessUnorderedAccess);
+
+	pass = addPass("Lighting");
+	read(pass, albedo, Graph::AccessPixelShaderResource);
+	read(pass, normals, Graph::AccessPixelShaderResource);
+	read(pass, depth, Graph::AccessPixelShaderResource);
+	read(pass, ambientOcclusion, Graph::AccessPixelShaderResource);
+	read(pass, shadowMap, Graph::AccessPixelShaderResource);
+	write(pass, lighting, Graph::AccessRenderTarget);
+
+	pass = addPass("Debug view");
+	read(pass, normals, Graph::AccessPixelShaderResource);
+	write(pass, debugView, Graph::AccessRenderTarget);
+
+	// Bloom downsamples the lighting level by level, then upsamples back adding each level to the one above
+	std::array<Graph::ResourceHandle, BLOOM_LEVEL_COUNT> downLevels;
+	std::array<Graph::ResourceHandle, BLOOM_LEVEL_COUNT> upLevels;
+	auto source = lighting;
+	for (uint32_t level = 0; level < BLOOM_LEVEL_COUNT; ++level)
+	{
+		downLevels[level] = texture("Bloom down", 960 >> level, 540 >> level, 8);
+		pass = addPass("Bloom down");
+		read(pass, source, Graph::AccessNonPixelShaderResource);
+		write(pass, downLevels[level], Graph::AccessUnorderedAccess);
+		source = downLevels[level];
+	}
+	for (uint32_t level = BLOOM_LEVEL_COUNT - 1; level-- > 0;)
+	{
+		upLevels[level] = texture("Bloom up", 960 >> level, 540 >> level, 8);
+		pass = addPass("Bloom up");
+		read(pass, source, Graph::AccessNonPixelShaderResource);
+		read(pass, downLevels[level], Graph::AccessNonPixelShaderResource);
+		write(pass, upLevels[level], Graph::AccessUnorderedAccess);
+		source = upLevels[level];
+	}
+
+	pass = addPass("Tonemap");
+	read(pass, lighting, Graph::AccessPixelShaderResource);
+	read(pass, source, Graph::AccessPixelShaderResource);
+	write(pass, backBuffer, Graph::AccessRenderTarget);
+
+	pass = addPass("User interface");
+	write(pass, backBuffer, Graph::AccessRenderTarget);
+}
+
+Renderer::RenderGraph::AllocationInfo Tests::QueryFrameAllocation(const Renderer::RenderGraph::TextureDesc& desc, const uint32_t)
+{
+	Renderer::RenderGraph::AllocationInfo info;
+	const uint64_t size = static_cast<uint64_t>(desc.Width) * desc.Height * desc.Format;
+	info.Size = (size + TEXTURE_ALIGNMENT - 1) / TEXTURE_ALIGNMENT * TEXTURE_ALIGNMENT;
+	info.Alignment = TEXTURE_ALIGNMENT;
+	return info;
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Renderer/RenderGraph.h"
+
+namespace Tests
+{
+	struct FramePassAccess
+	{
+		Renderer::RenderGraph::ResourceHandle Resource = Renderer::RenderGraph::InvalidHandle;
+		uint32_t Access = Renderer::RenderGraph::AccessNone;
+		bool Write = false;
+	};
+
+	// Deferred frame with a shadow map, gbuffer, ambient occlusion, lighting and a bloom chain tonemapped into an imported back buffer, then
+	// a user interface drawn over it. A debug view nothing reads is added to be culled. Texture formats are bytes per pixel.
+	// Returns the accesses each pass declared, onExecute is called with the index of each pass that runs
+	void BuildDeferredFrameGraph(Renderer::RenderGraph& graph, std::vector<std::vector<FramePassAccess>>& passAccesses,
+		const std::function<void(uint32_t)>& onExecute);
+
+	// Sizes are width by height by bytes per pixel rounded up to the alignment, every texture sharing one heap type
+	Renderer::RenderGraph::AllocationInfo QueryFrameAllocation(const Renderer::RenderGraph::TextureDesc& desc, const uint32_t accessMask);
+}
\ No newline at end of file
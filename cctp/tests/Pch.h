@@ -0,0 +1,25 @@
+#pragma once
+
+// Stands in for the application's precompiled header when building the portable cores off Windows. Only the standard library is
+// available, so anything reaching for Windows, D3D12 or ImGui fails to build here rather than at runtime
+
+// Standard
+#include <iostream>
+#include <functional>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+// Macros
+#ifdef _DEBUG
+#define DEBUG_LOG(x) std::cout << x << "\n";
+#else
+#define DEBUG_LOG(x)
+#endif
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include "Pch.h"
+#include "Test.h"
+#include "FrameGraph.h"
+
+namespace
+{
+	using Graph = Renderer::RenderGraph;
+
+	// Executes a compiled frame, applying its barriers to tracked accesses and recording the order each transient is used in
+	struct FrameExecution
+	{
+		std::vector<uint32_t> Accesses;
+		std::vector<uint32_t> FirstUse;
+		std::vector<uint32_t> LastUse;
+		std::vector<bool> AliasingBarrierSubmitted;
+		std::vector<Graph::PassHandle> ExecutedPasses;
+		// Each pass found its resources in the accesses it declared, and each transition started from the tracked access
+		bool StatesMatch = true;
+		// Transients sharing memory with another were handed an aliasing barrier before their first use
+		bool AliasingBarriersSubmitted = true;
+	};
+
+	bool OverlapsMemory(const Graph& graph, const Graph::ResourceHandle a, const Graph::ResourceHandle b)
+	{
+		const auto& placementA = graph.GetPlacement(a);
+		const auto& placementB = graph.GetPlacement(b);
+		return placementA.HeapType == placementB.HeapType && placementA.Offset < placementB.Offset + placementB.Size &&
+			placementB.Offset < placementA.Offset + placementA.Size;
+	}
+
+	bool IsAliased(const Graph& graph, const Graph::ResourceHandle resource)
+	{
+		for (Graph::ResourceHandle other = 0; other < graph.GetResourceCount(); ++other)
+		{
+			if (other != resource && !graph.IsImported(other) && graph.GetAccessMask(other) != Graph::AccessNone &&
+				OverlapsMemory(graph, resource, other))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Builds, compiles and executes the deferred frame
+	bool ExecuteDeferredFrame(Graph& graph, FrameExecution& execution)
+	{
+		std::vector<std::vector<Tests::FramePassAccess>> passAccesses;
+		std::function<void(uint32_t)> onExecute = [&](const uint32_t pass)
+		{
+			const uint32_t executedCount = static_cast<uint32_t>(execution.ExecutedPasses.size());
+			for (const auto& access : passAccesses[pass])
+			{
+				const uint32_t current = execution.Accesses[access.Resource];
+				execution.StatesMatch &= access.Write ? current == access.Access :
+					(current & access.Access) == access.Access && (current & Graph::WriteAccessMask) == 0;
+
+				if (!graph.IsImported(access.Resource))
+				{
+					if (execution.FirstUse[access.Resource] == Graph::InvalidHandle)
+					{
+						execution.FirstUse[access.Resource] = executedCount;
+						execution.AliasingBarriersSubmitted &= !IsAliased(graph, access.Resource) ||
+							execution.AliasingBarrierSubmitted[access.Resource];
+					}
+					execution.LastUse[access.Resource] = executedCount;
+				}
+			}
+			execution.ExecutedPasses.push_back(pass);
+		};
+
+		Tests::BuildDeferredFrameGraph(graph, passAccesses, onExecute);
+		if (!graph.Compile(Tests::QueryFrameAllocation))
+		{
+			return false;
+		}
+
+		const uint32_t resourceCount = graph.GetResourceCount();
+		execution.Accesses.resize(resourceCount);
+		execution.FirstUse.assign(resourceCount, Graph::InvalidHandle);
+		execution.LastUse.assign(resourceCount, Graph::InvalidHandle);
+		execution.AliasingBarrierSubmitted.assign(resourceCount, false);
+		for (Graph::ResourceHandle r = 0; r < resourceCount; ++r)
+		{
+			execution.Accesses[r] = graph.GetInitialAccess(r);
+		}
+
+		graph.Execute([&](const Graph::Barrier* pBarriers, const uint32_t barrierCount)
+			{
+				for (uint32_t i = 0; i < barrierCount; ++i)
+				{
+					const auto& barrier = pBarriers[i];
+					if (barrier.BarrierType == Graph::Barrier::Type::Transition)
+					{
+						execution.StatesMatch &= execution.Accesses[barrier.Resource] == barrier.AccessBefore;
+						execution.Accesses[barrier.Resource] = barrier.AccessAfter;
+					}
+					else if (barrier.BarrierType == Graph::Barrier::Type::Aliasing)
+					{
+						execution.AliasingBarrierSubmitted[barrier.Resource] = true;
+					}
+				}
+			});
+		return true;
+	}
+}
+
+TEST_CASE(RenderGraph, CullsPassesWhoseResultsAreUnused)
+{
+	Graph graph;
+	FrameExecution execution;
+	REQUIRE(ExecuteDeferredFrame(graph, execution));
+
+	for (Graph::PassHandle pass = 0; pass < graph.GetPassCount(); ++pass)
+	{
+		CHECK(graph.IsPassCulled(pass) == (graph.GetPassName(pass) == "Debug view"));
+	}
+	CHECK(graph.GetStatistics().CulledPassCount == 1);
+	CHECK(execution.ExecutedPasses.size() == graph.GetPassCount() - 1);
+}
+
+TEST_CASE(RenderGraph, BarriersMatchTheAccessesOfEveryPass)
+{
+	Graph graph;
+	FrameExecution execution;
+	REQUIRE(ExecuteDeferredFrame(graph, execution));
+	CHECK(execution.StatesMatch);
+
+	// Transients must be back in their initial access for the next frame, imports in their final one
+	for (Graph::ResourceHandle r = 0; r < graph.GetResourceCount(); ++r)
+	{
+		if (!graph.IsImported(r))
+		{
+			CHECK(execution.Accesses[r] == graph.GetInitialAccess(r));
+		}
+	}
+}
+
+TEST_CASE(RenderGraph, AliasedTexturesAreNeverAliveTogether)
+{
+	Graph graph;
+	FrameExecution execution;
+	REQUIRE(ExecuteDeferredFrame(graph, execution));
+	CHECK(execution.AliasingBarriersSubmitted);
+
+	for (Graph::ResourceHandle a = 0; a < graph.GetResourceCount(); ++a)
+	{
+		for (Graph::ResourceHandle b = a + 1; b < graph.GetResourceCount(); ++b)
+		{
+			if (execution.FirstUse[a] == Graph::InvalidHandle || execution.FirstUse[b] == Graph::InvalidHandle || !OverlapsMemory(graph, a, b))
+			{
+				continue;
+			}
+			CHECK(execution.LastUse[a] < execution.FirstUse[b] || execution.LastUse[b] < execution.FirstUse[a]);
+		}
+	}
+
+	// The bloom chain and gbuffer cannot all be alive at once, so aliasing must save memory
+	const auto& statistics = graph.GetStatistics();
+	CHECK(statistics.HeapBytes < statistics.TransientBytes);
+}
+
+TEST_CASE(RenderGraph, RecompilingTheSameFrameGivesTheSameBarriers)
+{
+	Graph graph;
+	FrameExecution first;
+	REQUIRE(ExecuteDeferredFrame(graph, first));
+	const auto barrierCount = graph.GetStatistics().BarrierCount;
+	const auto heapBytes = graph.GetStatistics().HeapBytes;
+
+	// Storage is kept across frames, so a rebuilt frame must not carry state from the last one
+	FrameExecution second;
+	REQUIRE(ExecuteDeferredFrame(graph, second));
+	CHECK(graph.GetStatistics().BarrierCount == barrierCount);
+	CHECK(graph.GetStatistics().HeapBytes == heapBytes);
+	CHECK(second.ExecutedPasses == first.ExecutedPasses);
+	CHECK(second.StatesMatch);
+}
+
+TEST_CASE(RenderGraph, ReadingATransientBeforeItIsWrittenFails)
+{
+	Graph graph;
+	Graph::TextureDesc desc;
+	desc.Width = 64;
+	desc.Height = 64;
+	desc.Format = 4;
+	const auto texture = graph.CreateTexture("Unwritten", desc);
+	const auto backBuffer = graph.ImportTexture("Back buffer", nullptr, Graph::AccessRenderTarget, Graph::AccessRenderTarget);
+
+	const auto pass = graph.AddPass("Composite", []() {});
+	graph.Read(pass, texture, Graph::AccessPixelShaderResource);
+	graph.Write(pass, backBuffer, Graph::AccessRenderTarget);
+	CHECK(!graph.Compile(Tests::QueryFrameAllocation));
+}
+
+TEST_CASE(RenderGraph, PassesWithSideEffectsAreNotCulled)
+{
+	Graph graph;
+	Graph::TextureDesc desc;
+	desc.Width = 64;
+	desc.Height = 64;
+	desc.Format = 4;
+	const auto texture = graph.CreateTexture("Readback source", desc);
+
+	const auto pass = graph.AddPass("Readback", []() {});
+	graph.Write(pass, texture, Graph::AccessRenderTarget);
+	const auto unusedPass = graph.AddPass("Unused", []() {});
+	graph.Write(unusedPass, graph.CreateTexture("Unused", desc), Graph::AccessRenderTarget);
+	graph.SetHasSideEffects(pass);
+
+	REQUIRE(graph.Compile(Tests::QueryFrameAllocation));
+	CHECK(!graph.IsPassCulled(pass));
+	CHECK(graph.IsPassCulled(unusedPass));
+}
\ No newline at end of file
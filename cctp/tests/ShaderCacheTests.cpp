@@ -0,0 +1,249 @@
+#include "Pch.h"
+#include "Test.h"
+#include "Renderer/ShaderCache.h"
+#include <random>
+
+namespace
+{
+	using namespace Renderer::ShaderCache;
+
+	const std::string COMMON_SOURCE = "#ifndef COMMON_HLSL\n#define COMMON_HLSL\n#include \"Octahedral.hlsl\"\nstatic const float PI = 3.14159265f;\n#endif\n";
+	const std::string BRDF_SOURCE = "float Lambert(float nDotL) { return nDotL / PI; }\n";
+	const std::string EDITED_BRDF_SOURCE = "float Lambert(float nDotL) { return nDotL / PI; }\nfloat Unused() { return 0.0f; }\n";
+	constexpr uint64_t COMPILER_KEY = 1;
+
+	// A shader including files from its own directory and a subdirectory, one of them twice, with includes hidden in comments and
+	// strings. Written to a directory of its own, removed again when the sources go out of scope
+	class ShaderSources
+	{
+	public:
+		ShaderSources()
+		{
+			std::error_code error;
+			Directory = std::filesystem::temp_directory_path(error) / "cctp_shader_cache_tests";
+			std::filesystem::remove_all(Directory, error);
+			Root = Directory.generic_string() + "/";
+
+			const std::string mainSource =
+				"#include \"Common.hlsl\"\n"
+				"// #include \"Missing.hlsl\"\n"
+				"/* #include \"Missing.hlsl\"\n*/ #include <Lib/Lighting.hlsl>\n"
+				"static const char* Text = \"#include \\\"Missing.hlsl\\\"\";\n"
+				"[shader(\"raygeneration\")] void RayGen() {}\n";
+			Written = Write("Main.hlsl", mainSource) &&
+				Write("Common.hlsl", COMMON_SOURCE) &&
+				Write("Octahedral.hlsl", "float2 OctWrap(float2 v) { return v; }\n") &&
+				Write("Lib/Lighting.hlsl", "#include \"../Common.hlsl\"\n  #  include \"Brdf.hlsl\"\n") &&
+				Write("Lib/Brdf.hlsl", BRDF_SOURCE);
+		}
+
+		~ShaderSources()
+		{
+			std::error_code error;
+			std::filesystem::remove_all(Directory, error);
+		}
+
+		bool Write(const std::string& name, const std::string& source) const
+		{
+			const auto filepath = Directory / name;
+			std::error_code error;
+			std::filesystem::create_directories(filepath.parent_path(), error);
+			std::ofstream fs(filepath, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+			fs.write(source.data(), static_cast<std::streamsize>(source.size()));
+			return fs.good();
+		}
+
+		ShaderCompileDesc GetDesc(const std::string& name = "Main.hlsl") const
+		{
+			return { Root + name, "", "lib_6_3", {} };
+		}
+
+		uint64_t CalculateKey(const ShaderCompileDesc& desc, const uint64_t compilerKey = COMPILER_KEY) const
+		{
+			uint64_t key = 0;
+			const bool calculated = CalculateShaderKey(desc, compilerKey, key);
+			CHECK(calculated);
+			return key;
+		}
+
+	public:
+		std::filesystem::path Directory;
+		std::string Root;
+		bool Written = false;
+	};
+
+	// Bytecode stands in for a compiled library
+	std::vector<uint8_t> MakeBytecode()
+	{
+		std::mt19937 random(7);
+		std::vector<uint8_t> bytecode(16 * 1024);
+		for (auto& byte : bytecode)
+		{
+			byte = static_cast<uint8_t>(random());
+		}
+		return bytecode;
+	}
+}
+
+TEST_CASE(ShaderCache, DependenciesAreFoundInIncludeOrder)
+{
+	ShaderSources sources;
+	REQUIRE(sources.Written);
+
+	std::vector<std::string> dependencies;
+	std::vector<std::string> unresolvedIncludes;
+	REQUIRE(ScanDependencies(sources.Root + "Main.hlsl", dependencies, unresolvedIncludes));
+
+	// Includes in comments and strings are skipped, and Common.hlsl is listed once though Lighting.hlsl includes it again
+	const std::vector<std::string> expected = { sources.Root + "Common.hlsl", sources.Root + "Octahedral.hlsl", sources.Root + "Lib/Lighting.hlsl",
+		sources.Root + "Lib/Brdf.hlsl" };
+	CHECK(dependencies == expected);
+	CHECK(unresolvedIncludes.empty());
+}
+
+TEST_CASE(ShaderCache, UnreadableIncludesAreListedAsUnresolved)
+{
+	ShaderSources sources;
+	REQUIRE(sources.Written);
+	REQUIRE(sources.Write("Generated.hlsl", "#include \"Common.hlsl\"\n#include \"Lib/Generated.hlsl\"\n"));
+
+	std::vector<std::string> dependencies;
+	std::vector<std::string> unresolvedIncludes;
+	REQUIRE(ScanDependencies(sources.Root + "Generated.hlsl", dependencies, unresolvedIncludes));
+	CHECK(dependencies == std::vector<std::string>({ sources.Root + "Common.hlsl", sources.Root + "Octahedral.hlsl" }));
+	CHECK(unresolvedIncludes == std::vector<std::string>({ sources.Root + "Lib/Generated.hlsl" }));
+}
+
+TEST_CASE(ShaderCache, UnresolvedIncludesChangeTheKeyOnceTheyAppear)
+{
+	ShaderSources sources;
+	REQUIRE(sources.Written);
+	REQUIRE(sources.Write("Generated.hlsl", "#include \"Common.hlsl\"\n#include \"Lib/Generated.hlsl\"\n"));
+
+	// The shader still gets a key, it changes once the include can be read and then follows its contents
+	const auto desc = sources.GetDesc("Generated.hlsl");
+	const uint64_t unresolvedKey = sources.CalculateKey(desc);
+	CHECK(sources.CalculateKey(desc) == unresolvedKey);
+
+	REQUIRE(sources.Write("Lib/Generated.hlsl", "static const uint COUNT = 4;\n"));
+	const uint64_t resolvedKey = sources.CalculateKey(desc);
+	CHECK(resolvedKey != unresolvedKey);
+
+	REQUIRE(sources.Write("Lib/Generated.hlsl", "static const uint COUNT = 8;\n"));
+	CHECK(sources.CalculateKey(desc) != resolvedKey);
+}
+
+TEST_CASE(ShaderCache, MissingShadersAreRejected)
+{
+	ShaderSources sources;
+	REQUIRE(sources.Written);
+
+	std::vector<std::string> dependencies;
+	std::vector<std::string> unresolvedIncludes;
+	CHECK(!ScanDependencies(sources.Root + "Missing.hlsl", dependencies, unresolvedIncludes));
+
+	uint64_t key = 0;
+	CHECK(!CalculateShaderKey(sources.GetDesc("Missing.hlsl"), COMPILER_KEY, key));
+}
+
+TEST_CASE(ShaderCache, KeysAreStableAcrossLineEndingsAndRestoredFiles)
+{
+	ShaderSources sources;
+	REQUIRE(sources.Written);
+
+	const auto desc = sources.GetDesc();
+	const uint64_t baseKey = sources.CalculateKey(desc);
+	CHECK(sources.CalculateKey(desc) == baseKey);
+
+	std::string crlfCommonSource;
+	for (const char c : COMMON_SOURCE)
+	{
+		crlfCommonSource += c == '\n' ? "\r\n" : std::string(1, c);
+	}
+	REQUIRE(sources.Write("Common.hlsl", crlfCommonSource));
+	CHECK(sources.CalculateKey(desc) == baseKey);
+
+	REQUIRE(sources.Write("Lib/Brdf.hlsl", EDITED_BRDF_SOURCE));
+	CHECK(sources.CalculateKey(desc) != baseKey);
+	REQUIRE(sources.Write("Lib/Brdf.hlsl", BRDF_SOURCE));
+	CHECK(sources.CalculateKey(desc) == baseKey);
+}
+
+TEST_CASE(ShaderCache, KeysChangeWithEveryInput)
+{
+	ShaderSources sources;
+	REQUIRE(sources.Written);
+
+	const auto desc = sources.GetDesc();
+	const uint64_t baseKey = sources.CalculateKey(desc);
+
+	std::vector<uint64_t> changedKeys;
+	REQUIRE(sources.Write("Lib/Brdf.hlsl", EDITED_BRDF_SOURCE));
+	changedKeys.push_back(sources.CalculateKey(desc));
+	REQUIRE(sources.Write("Lib/Brdf.hlsl", BRDF_SOURCE));
+
+	auto changedDesc = desc;
+	changedDesc.Defines.push_back({ "SAMPLE_COUNT", "4" });
+	changedKeys.push_back(sources.CalculateKey(changedDesc));
+	changedDesc.Defines.back() = { "SAMPLE_COUNT", "8" };
+	changedKeys.push_back(sources.CalculateKey(changedDesc));
+	// Name and value boundaries must count, not only their characters
+	changedDesc.Defines.back() = { "SAMPLE_COUNT8", "" };
+	changedKeys.push_back(sources.CalculateKey(changedDesc));
+	changedDesc = desc;
+	changedDesc.Target = "lib_6_5";
+	changedKeys.push_back(sources.CalculateKey(changedDesc));
+	changedDesc = desc;
+	changedDesc.EntryPoint = "RayGen";
+	changedKeys.push_back(sources.CalculateKey(changedDesc));
+	changedKeys.push_back(sources.CalculateKey(desc, COMPILER_KEY + 1));
+
+	for (size_t i = 0; i < changedKeys.size(); ++i)
+	{
+		CHECK(changedKeys[i] != baseKey);
+		for (size_t j = 0; j < i; ++j)
+		{
+			CHECK(changedKeys[i] != changedKeys[j]);
+		}
+	}
+}
+
+TEST_CASE(ShaderCache, CacheFilesRoundTrip)
+{
+	ShaderSources sources;
+	const auto bytecode = MakeBytecode();
+	const auto cacheFilepath = (sources.Directory / "Cache" / GetShaderCacheName(1)).string();
+
+	std::vector<uint8_t> readBytecode;
+	REQUIRE(WriteCacheFile(cacheFilepath, 1, bytecode.data(), bytecode.size()));
+	REQUIRE(ReadCacheFile(cacheFilepath, 1, readBytecode));
+	CHECK(readBytecode == bytecode);
+}
+
+TEST_CASE(ShaderCache, StaleCorruptAndTruncatedCacheFilesAreRejected)
+{
+	ShaderSources sources;
+	const auto bytecode = MakeBytecode();
+	const auto cacheFilepath = (sources.Directory / "Cache" / GetShaderCacheName(1)).string();
+	REQUIRE(WriteCacheFile(cacheFilepath, 1, bytecode.data(), bytecode.size()));
+
+	std::vector<uint8_t> readBytecode;
+	CHECK(!ReadCacheFile(cacheFilepath, 2, readBytecode));
+
+	// Corrupt one byte of the data, then cut the file short
+	{
+		std::fstream fs(cacheFilepath, std::fstream::in | std::fstream::out | std::fstream::binary);
+		fs.seekp(static_cast<std::streamoff>(sizeof(ShaderCacheHeader) + bytecode.size() / 2));
+		fs.put(static_cast<char>(bytecode[bytecode.size() / 2] ^ 0xFF));
+	}
+	CHECK(!ReadCacheFile(cacheFilepath, 1, readBytecode));
+
+	REQUIRE(WriteCacheFile(cacheFilepath, 1, bytecode.data(), bytecode.size()));
+	REQUIRE(ReadCacheFile(cacheFilepath, 1, readBytecode));
+	std::error_code error;
+	std::filesystem::resize_file(cacheFilepath, sizeof(ShaderCacheHeader) + bytecode.size() - 1, error);
+	REQUIRE(!error);
+	CHECK(!ReadCacheFile(cacheFilepath, 1, readBytecode));
+
+	CHECK(!ReadCacheFile((sources.Directory / "Cache" / "Missing.dxil").string(), 1, readBytecode));
+}
\ No newline at end of file
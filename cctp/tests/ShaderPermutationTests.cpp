@@ -0,0 +1,179 @@
+#include "Pch.h"
+#include "Test.h"
+#include "Renderer/ShaderPermutations.h"
+#include "Tasks/TaskSystem.h"
+
+namespace
+{
+	using namespace Renderer::ShaderPermutations;
+
+	constexpr uint64_t COMPILER_KEY = 1;
+
+	std::string ReadFile(const std::filesystem::path& filepath, bool& found)
+	{
+		std::ifstream fs(filepath, std::ifstream::in | std::ifstream::binary);
+		found = fs.good();
+		return std::string(std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>());
+	}
+
+	bool WriteFile(const std::filesystem::path& filepath, const std::string& source)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(filepath.parent_path(), error);
+		std::ofstream fs(filepath, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+		fs.write(source.data(), static_cast<std::streamsize>(source.size()));
+		return fs.good();
+	}
+
+	// A shader including the generated header, in a directory of its own removed again when it goes out of scope
+	class PermutedShader
+	{
+	public:
+		PermutedShader()
+		{
+			std::error_code error;
+			Directory = std::filesystem::temp_directory_path(error) / "cctp_shader_permutation_tests";
+			std::filesystem::remove_all(Directory, error);
+			HeaderFilepath = (Directory / "ShaderConstants.hlsl").string();
+
+			bool updated = false;
+			Written = WriteFile(Directory / "Main.hlsl",
+				"#include \"ShaderConstants.hlsl\"\n[shader(\"raygeneration\")] void RayGen() { float rays[PROBE_RAY_COUNT]; }\n") &&
+				UpdateHlslHeader(HeaderFilepath, updated) && updated;
+		}
+
+		~PermutedShader()
+		{
+			std::error_code error;
+			std::filesystem::remove_all(Directory, error);
+		}
+
+		Renderer::ShaderCache::ShaderCompileDesc GetDesc(const ShaderQualityTier tier) const
+		{
+			return { Directory.generic_string() + "/Main.hlsl", "", "lib_6_3", GetTierDefines(tier) };
+		}
+
+	public:
+		std::filesystem::path Directory;
+		std::string HeaderFilepath;
+		bool Written = false;
+	};
+}
+
+TEST_CASE(ShaderPermutations, GeneratedHeaderDeclaresEveryConstantAndOption)
+{
+	const auto header = GenerateHlslHeader();
+	for (const auto& constant : SHADER_CONSTANTS)
+	{
+		CHECK(header.find(std::string(" ") + constant.Name + " = ") != std::string::npos);
+	}
+	for (const auto& option : SHADER_OPTIONS)
+	{
+		CHECK(header.find(std::string("#ifndef ") + option.Name + "\n") != std::string::npos);
+	}
+}
+
+TEST_CASE(ShaderPermutations, HeaderInTheTreeMatchesTheDescription)
+{
+	// Shaders built with the project include the header from the tree, so it must be regenerated whenever the description changes
+	bool found = false;
+	auto treeHeader = ReadFile(std::filesystem::path(CCTP_APPLICATION_DIR) / SHADER_CONSTANTS_HEADER_FILEPATH, found);
+	REQUIRE(found);
+	treeHeader.erase(std::remove(treeHeader.begin(), treeHeader.end(), '\r'), treeHeader.end());
+	CHECK(treeHeader == GenerateHlslHeader());
+}
+
+TEST_CASE(ShaderPermutations, UnchangedHeadersAreLeftUntouched)
+{
+	PermutedShader shader;
+	REQUIRE(shader.Written);
+
+	bool updated = true;
+	REQUIRE(UpdateHlslHeader(shader.HeaderFilepath, updated));
+	CHECK(!updated);
+
+	// Line endings alone do not count as a change
+	std::string crlfHeader;
+	for (const char c : GenerateHlslHeader())
+	{
+		crlfHeader += c == '\n' ? "\r\n" : std::string(1, c);
+	}
+	REQUIRE(WriteFile(shader.HeaderFilepath, crlfHeader));
+	REQUIRE(UpdateHlslHeader(shader.HeaderFilepath, updated));
+	CHECK(!updated);
+
+	REQUIRE(WriteFile(shader.HeaderFilepath, "static const int MAX_PROBE_COUNT = 1;\n"));
+	REQUIRE(UpdateHlslHeader(shader.HeaderFilepath, updated));
+	CHECK(updated);
+
+	bool found = false;
+	CHECK(ReadFile(shader.HeaderFilepath, found) == GenerateHlslHeader());
+}
+
+TEST_CASE(ShaderPermutations, TierDefinesCoverEveryOption)
+{
+	// Each tier defines every option once, and the values C++ reads are the ones compiled in
+	for (uint32_t tier = 0; tier < SHADER_QUALITY_TIER_COUNT; ++tier)
+	{
+		const auto qualityTier = static_cast<ShaderQualityTier>(tier);
+		const auto defines = GetTierDefines(qualityTier);
+		CHECK(defines.size() == std::size(SHADER_OPTIONS));
+		for (size_t i = 0; i < defines.size(); ++i)
+		{
+			CHECK(defines[i].Name == SHADER_OPTIONS[i].Name);
+			CHECK(defines[i].Value == std::to_string(GetOptionValue(defines[i].Name.c_str(), qualityTier)));
+		}
+	}
+}
+
+TEST_CASE(ShaderPermutations, TierKeysAreDistinct)
+{
+	PermutedShader shader;
+	REQUIRE(shader.Written);
+
+	std::array<uint64_t, SHADER_QUALITY_TIER_COUNT> keys = {};
+	for (uint32_t tier = 0; tier < SHADER_QUALITY_TIER_COUNT; ++tier)
+	{
+		REQUIRE(Renderer::ShaderCache::CalculateShaderKey(shader.GetDesc(static_cast<ShaderQualityTier>(tier)), COMPILER_KEY, keys[tier]));
+		for (uint32_t other = 0; other < tier; ++other)
+		{
+			CHECK(keys[tier] != keys[other]);
+		}
+	}
+}
+
+TEST_CASE(ShaderPermutations, ParallelKeysMatchSerialKeys)
+{
+	PermutedShader shader;
+	REQUIRE(shader.Written);
+
+	// Keys are calculated as the compiler does before compiling or reading the cache, spread over the workers
+	constexpr uint32_t setCount = 16;
+	std::vector<Renderer::ShaderCache::ShaderCompileDesc> descs;
+	for (uint32_t set = 0; set < setCount; ++set)
+	{
+		for (uint32_t tier = 0; tier < SHADER_QUALITY_TIER_COUNT; ++tier)
+		{
+			descs.push_back(shader.GetDesc(static_cast<ShaderQualityTier>(tier)));
+		}
+	}
+
+	std::vector<uint64_t> serialKeys(descs.size(), 0);
+	for (size_t i = 0; i < descs.size(); ++i)
+	{
+		REQUIRE(Renderer::ShaderCache::CalculateShaderKey(descs[i], COMPILER_KEY, serialKeys[i]));
+	}
+
+	std::vector<uint64_t> parallelKeys(descs.size(), 0);
+	std::vector<uint8_t> parallelCalculated(descs.size(), 0);
+	TaskSystem::ParallelFor(descs.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				parallelCalculated[i] = Renderer::ShaderCache::CalculateShaderKey(descs[i], COMPILER_KEY, parallelKeys[i]) ? 1 : 0;
+			}
+		});
+
+	CHECK(std::all_of(parallelCalculated.begin(), parallelCalculated.end(), [](const uint8_t calculated) { return calculated != 0; }));
+	CHECK(parallelKeys == serialKeys);
+}
\ No newline at end of file
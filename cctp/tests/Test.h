@@ -0,0 +1,49 @@
+#pragma once
+
+// Minimal test registration. Cases are grouped into suites, each suite is registered with CTest and run by name
+namespace Tests
+{
+	struct TestCase
+	{
+		const char* Suite;
+		const char* Name;
+		void (*Function)();
+	};
+
+	std::vector<TestCase>& GetTestCases();
+	// Records a failed check against the running case, which carries on so every failure is reported
+	void ReportFailure(const char* file, const int line, const char* expression);
+
+	struct TestRegistrar
+	{
+		TestRegistrar(const char* suite, const char* name, void (*function)())
+		{
+			GetTestCases().push_back({ suite, name, function });
+		}
+	};
+}
+
+#define TEST_CASE(Suite, Name) \
+	static void Suite##_##Name(); \
+	static Tests::TestRegistrar Suite##_##Name##_Registrar(#Suite, #Name, &Suite##_##Name); \
+	static void Suite##_##Name()
+
+#define CHECK(expression) \
+	do \
+	{ \
+		if (!(expression)) \
+		{ \
+			Tests::ReportFailure(__FILE__, __LINE__, #expression); \
+		} \
+	} while (false)
+
+// Stops the running case, for checks later ones depend on
+#define REQUIRE(expression) \
+	do \
+	{ \
+		if (!(expression)) \
+		{ \
+			Tests::ReportFailure(__FILE__, __LINE__, #expression); \
+			return; \
+		} \
+	} while (false)
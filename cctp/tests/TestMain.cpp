@@ -0,0 +1,53 @@
+#include "Pch.h"
+#include "Test.h"
+#include "Tasks/TaskSystem.h"
+#include <atomic>
+
+namespace
+{
+	// Checks may fail on worker threads of cases running work in parallel
+	std::atomic<uint32_t> FailureCount = 0;
+}
+
+std::vector<Tests::TestCase>& Tests::GetTestCases()
+{
+	static std::vector<TestCase> testCases;
+	return testCases;
+}
+
+void Tests::ReportFailure(const char* file, const int line, const char* expression)
+{
+	std::cout << file << "(" << line << "): CHECK(" << expression << ") failed\n";
+	++FailureCount;
+}
+
+// Runs every case of the suite named by the first argument, or every case without one. Returns non zero if any check failed
+int main(int argc, char** argv)
+{
+	const std::string suite = argc > 1 ? argv[1] : "";
+
+	// Cases run on the worker threads the application would have
+	TaskSystem::Init();
+
+	uint32_t caseCount = 0;
+	uint32_t failedCaseCount = 0;
+	for (const auto& testCase : Tests::GetTestCases())
+	{
+		if (!suite.empty() && suite != testCase.Suite)
+		{
+			continue;
+		}
+
+		const uint32_t failuresBefore = FailureCount;
+		testCase.Function();
+		const bool passed = FailureCount == failuresBefore;
+		std::cout << (passed ? "[ PASSED ] " : "[ FAILED ] ") << testCase.Suite << "." << testCase.Name << "\n";
+		failedCaseCount += passed ? 0 : 1;
+		++caseCount;
+	}
+
+	TaskSystem::Shutdown();
+
+	std::cout << caseCount - failedCaseCount << " of " << caseCount << " cases passed\n";
+	return caseCount > 0 && failedCaseCount == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "Pch.h"
+#include "Test.h"
+#include "Renderer/TlsfAllocator.h"
+#include <cmath>
+#include <map>
+#include <random>
+
+namespace
+{
+	using Allocator = Renderer::TlsfAllocator;
+
+	constexpr uint64_t CAPACITY = 64 * 1024 * 1024;
+	// Allocations made before churning starts, enough to fill most of the range
+	constexpr uint32_t FILL_COUNT = 200;
+	constexpr uint32_t CHURN_COUNT = 20000;
+	constexpr uint32_t MIN_SIZE_LOG2 = 8;
+	constexpr uint32_t MAX_SIZE_LOG2 = 21;
+
+	// Fills the range with buffer and texture sized allocations, then frees one at random before each further allocation. Every
+	// allocation is checked against the live ones and the statistics against what is live
+	struct TlsfChurn
+	{
+		Allocator TlsfAllocator;
+		std::map<uint64_t, uint64_t> LiveRanges;
+		uint64_t LiveBytes = 0;
+		uint32_t Failures = 0;
+		bool Disjoint = true;
+		bool Aligned = true;
+		bool StatisticsMatch = true;
+
+		void Run()
+		{
+			// One in four requests is aligned as a placed texture, the rest as buffers
+			std::mt19937 generator(0);
+			std::uniform_real_distribution<float> sizeLog2Distribution(static_cast<float>(MIN_SIZE_LOG2), static_cast<float>(MAX_SIZE_LOG2));
+			std::uniform_int_distribution<uint32_t> textureDistribution(0, 3);
+
+			TlsfAllocator.Init(CAPACITY);
+			std::vector<Renderer::TlsfAllocation> live;
+			for (uint32_t i = 0; i < FILL_COUNT + CHURN_COUNT; ++i)
+			{
+				if (i >= FILL_COUNT && !live.empty())
+				{
+					const size_t victim = generator() % live.size();
+					Free(live[victim]);
+					live[victim] = live.back();
+					live.pop_back();
+				}
+
+				const uint64_t size = static_cast<uint64_t>(std::exp2(sizeLog2Distribution(generator)));
+				const uint64_t alignment = textureDistribution(generator) == 0 ? 64 * 1024 : Allocator::DefaultGranularity;
+				Renderer::TlsfAllocation allocation;
+				if (Allocate(size, alignment, allocation))
+				{
+					live.push_back(allocation);
+				}
+			}
+
+			for (const auto& allocation : live)
+			{
+				Free(allocation);
+			}
+		}
+
+		bool Allocate(const uint64_t size, const uint64_t alignment, Renderer::TlsfAllocation& outAllocation)
+		{
+			if (!TlsfAllocator.Allocate(size, alignment, outAllocation))
+			{
+				++Failures;
+				return false;
+			}
+
+			Aligned &= outAllocation.Offset % alignment == 0 && outAllocation.Size >= size && outAllocation.Offset + outAllocation.Size <= CAPACITY;
+			const auto next = LiveRanges.lower_bound(outAllocation.Offset);
+			Disjoint &= next == LiveRanges.end() || outAllocation.Offset + outAllocation.Size <= next->first;
+			Disjoint &= next == LiveRanges.begin() || std::prev(next)->second <= outAllocation.Offset;
+			LiveRanges[outAllocation.Offset] = outAllocation.Offset + outAllocation.Size;
+			LiveBytes += outAllocation.Size;
+			CheckStatistics();
+			return true;
+		}
+
+		void Free(const Renderer::TlsfAllocation& allocation)
+		{
+			LiveRanges.erase(allocation.Offset);
+			LiveBytes -= allocation.Size;
+			TlsfAllocator.Free(allocation.Block);
+			CheckStatistics();
+		}
+
+		void CheckStatistics()
+		{
+			const auto statistics = TlsfAllocator.GetStatistics();
+			StatisticsMatch &= statistics.UsedBytes == LiveBytes && statistics.AllocationCount == LiveRanges.size() &&
+				statistics.UsedBytes + statistics.FreeBytes == CAPACITY && statistics.LargestFreeBlock <= statistics.FreeBytes;
+		}
+	};
+}
+
+TEST_CASE(TlsfAllocator, AllocationsNeverOverlap)
+{
+	TlsfChurn churn;
+	churn.Run();
+	CHECK(churn.Disjoint);
+}
+
+TEST_CASE(TlsfAllocator, AllocationsAreAlignedAndInsideTheRange)
+{
+	TlsfChurn churn;
+	churn.Run();
+	CHECK(churn.Aligned);
+}
+
+TEST_CASE(TlsfAllocator, StatisticsMatchTheLiveAllocations)
+{
+	TlsfChurn churn;
+	churn.Run();
+	CHECK(churn.StatisticsMatch);
+	CHECK(churn.TlsfAllocator.GetStatistics().FailedAllocationCount == churn.Failures);
+	CHECK(churn.LiveRanges.empty());
+	CHECK(churn.TlsfAllocator.IsEmpty());
+}
+
+TEST_CASE(TlsfAllocator, FreeBlocksMergeBackIntoOneBlock)
+{
+	TlsfChurn churn;
+	churn.Run();
+
+	const auto statistics = churn.TlsfAllocator.GetStatistics();
+	CHECK(statistics.FreeBlockCount == 1);
+	CHECK(statistics.LargestFreeBlock == CAPACITY);
+	CHECK(statistics.UsedBytes == 0);
+	CHECK(statistics.AllocationCount == 0);
+	CHECK(statistics.Fragmentation == 0.0f);
+}
+
+TEST_CASE(TlsfAllocator, FreedBlockMergesWithBothNeighbours)
+{
+	constexpr uint64_t granularity = Allocator::DefaultGranularity;
+	Allocator allocator;
+	allocator.Init(granularity * 4);
+
+	std::array<Renderer::TlsfAllocation, 4> allocations;
+	for (auto& allocation : allocations)
+	{
+		REQUIRE(allocator.Allocate(granularity, granularity, allocation));
+	}
+
+	allocator.Free(allocations[0].Block);
+	allocator.Free(allocations[2].Block);
+	CHECK(allocator.GetStatistics().FreeBlockCount == 2);
+	CHECK(allocator.GetStatistics().Fragmentation == 0.5f);
+
+	allocator.Free(allocations[1].Block);
+	CHECK(allocator.GetStatistics().FreeBlockCount == 1);
+	CHECK(allocator.GetStatistics().LargestFreeBlock == granularity * 3);
+}
+
+TEST_CASE(TlsfAllocator, ExhaustedRangeFailsAllocations)
+{
+	constexpr uint64_t granularity = Allocator::DefaultGranularity;
+	Allocator allocator;
+	allocator.Init(granularity * 16);
+
+	Renderer::TlsfAllocation whole;
+	REQUIRE(allocator.Allocate(granularity * 16, granularity, whole));
+	CHECK(whole.Offset == 0);
+
+	Renderer::TlsfAllocation extra;
+	CHECK(!allocator.Allocate(1, granularity, extra));
+	CHECK(allocator.GetStatistics().FailedAllocationCount == 1);
+
+	allocator.Free(whole.Block);
+	CHECK(allocator.Allocate(1, granularity, extra));
+	CHECK(extra.Size == granularity);
+}
\ No newline at end of file